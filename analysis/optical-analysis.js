@@ -9,6 +9,55 @@ import { expandBlocksToOpticalSystemRows } from '../data/block-schema.js';
 import { getScene, getCamera, getRenderer, getControls, getTableOpticalSystem, getTableObject, getTableSource,
          getIsGeneratingSpotDiagram, getIsGeneratingTransverseAberration,
          setIsGeneratingSpotDiagram, setIsGeneratingTransverseAberration } from '../core/app-config.js';
+import { getOrComputeAnalysis, replayProgressOnHit } from '../evaluation/analysis-cache.js';
+
+// キャッシュヒット時に出し直す generateSpotDiagramAsync() の完了通知（同じ順・同じ文言）
+const SPOT_COMPLETION_PROGRESS = [
+    { percent: 95, message: 'Finalizing...' },
+    { percent: 100, message: 'Done' }
+];
+
+// 解析キャッシュの鍵に入れる主波長（Source テーブル由来、計算側が window から読むもの）
+function getAnalysisPrimaryWavelength() {
+    try {
+        if (typeof window !== 'undefined' && typeof window.getPrimaryWavelength === 'function') {
+            const w = Number(window.getPrimaryWavelength());
+            if (Number.isFinite(w) && w > 0) return w;
+        }
+    } catch (_) {}
+    return null;
+}
+
+// 直前に showSpotDiagram() で描いたスポット図（previewSpotDiagram() が同じ開始光線で描き直す）
+let lastSpotDiagramForPreview = null;
+
+/**
+ * 直前に描いたスポット図を、編集中の光学系で描き直す（パラメータのドラッグ中のプレビュー）。
+ * tracer は createPreviewRefineTracer() の戻り値で、f32 で即時に描き、操作が止まったら f64 で描き直す。
+ * 開始光線は直前のスポット図のまま（エイミングし直さない）。
+ * @param {Array<Object>} opticalSystemRows 編集中の光学系
+ * @param {{preview: Function}} tracer createPreviewRefineTracer() の戻り値
+ * @returns {boolean} プレビューを描いたか（スポット図が表示されていなければ false）
+ */
+export function previewSpotDiagram(opticalSystemRows, tracer) {
+    const last = lastSpotDiagramForPreview;
+    if (!last || !Array.isArray(opticalSystemRows) || !tracer) return false;
+    const container = typeof last.containerTarget === 'string'
+        ? document.getElementById(last.containerTarget)
+        : last.containerTarget;
+    if (!container || !container.isConnected) return false;
+
+    const job = last.prepare(last.spotDiagramData, last.surfaceNumber);
+    if (!job) return false;
+    tracer.preview(opticalSystemRows, job.rays, (hits) => {
+        try {
+            last.draw(job.toSpotDiagramData(opticalSystemRows, hits), last.surfaceNumber, container, last.wavelengthUm);
+        } catch (e) {
+            console.warn('⚠️ Spot diagram preview failed:', e);
+        }
+    }, job.traceOptions);
+    return true;
+}
 
 /**
  * Create field setting from object data for PSF calculation
@@ -544,14 +593,20 @@ export async function showSpotDiagram(options = {}) {
             // Import functions and use default object data
             const { generateSpotDiagramAsync, drawSpotDiagram } = await import('../eva-spot-diagram.js');
             
-            const spotDiagramData = await generateSpotDiagramAsync(
+            const spotDiagramData = await getOrComputeAnalysis(
+                'spot',
                 opticalSystemRows,
-                sourceRows || [],
-                defaultObjectRows,
-                surfaceNumber,
-                rayCount,
-                ringCount,
-                { onProgress, physicalVignetting: true }
+                { sourceRows: sourceRows || [], objectRows: defaultObjectRows, surfaceNumber, rayCount, ringCount, physicalVignetting: true },
+                () => generateSpotDiagramAsync(
+                    opticalSystemRows,
+                    sourceRows || [],
+                    defaultObjectRows,
+                    surfaceNumber,
+                    rayCount,
+                    ringCount,
+                    { onProgress, physicalVignetting: true }
+                ),
+                { onHit: replayProgressOnHit(onProgress, SPOT_COMPLETION_PROGRESS) }
             );
             
             if (!spotDiagramData) {
@@ -570,16 +625,22 @@ export async function showSpotDiagram(options = {}) {
             
         } else {
             // Generate spot diagram with existing object data
-            const { generateSpotDiagramAsync, drawSpotDiagram } = await import('../evaluation/spot-diagram.js');
+            const { generateSpotDiagramAsync, drawSpotDiagram, prepareSpotPreviewRetrace } = await import('../evaluation/spot-diagram.js');
             
-            const spotDiagramData = await generateSpotDiagramAsync(
+            const spotDiagramData = await getOrComputeAnalysis(
+                'spot',
                 opticalSystemRows,
-                sourceRows || [],
-                objectRows,
-                surfaceNumber,
-                rayCount,
-                ringCount,
-                { onProgress, physicalVignetting: true }
+                { sourceRows: sourceRows || [], objectRows, surfaceNumber, rayCount, ringCount, physicalVignetting: true },
+                () => generateSpotDiagramAsync(
+                    opticalSystemRows,
+                    sourceRows || [],
+                    objectRows,
+                    surfaceNumber,
+                    rayCount,
+                    ringCount,
+                    { onProgress, physicalVignetting: true }
+                ),
+                { onHit: replayProgressOnHit(onProgress, SPOT_COMPLETION_PROGRESS) }
             );
             
             if (!spotDiagramData) {
@@ -603,6 +664,14 @@ export async function showSpotDiagram(options = {}) {
                 containerTarget,
                 wavelength / 1000 // convert nm to μm
             );
+            lastSpotDiagramForPreview = {
+                spotDiagramData,
+                surfaceNumber,
+                containerTarget,
+                wavelengthUm: wavelength / 1000,
+                prepare: prepareSpotPreviewRetrace,
+                draw: drawSpotDiagram
+            };
 
             try { onProgress?.({ percent: 100, message: 'Done' }); } catch (_) {}
             
@@ -719,13 +788,20 @@ export async function showTransverseAberrationDiagram(options = {}) {
         const wavelength = getPrimaryWavelengthForAberration(); // μm
         console.log(`📊 Wavelength: ${wavelength} μm`);
 
-        const aberrationData = await calculateTransverseAberrationAsync(
+        // fieldSettings = null のときは Object テーブルからフィールドを読むので鍵に含める
+        const aberrationData = await getOrComputeAnalysis(
+            'transverse',
             opticalSystemRows,
-            targetSurfaceIndex,
-            null,
-            wavelength,
-            rayCount,
-            { onProgress }
+            { objectRows: getObjectRows(), targetSurfaceIndex, wavelength, rayCount },
+            () => calculateTransverseAberrationAsync(
+                opticalSystemRows,
+                targetSurfaceIndex,
+                null,
+                wavelength,
+                rayCount,
+                { onProgress }
+            ),
+            { onHit: replayProgressOnHit(onProgress) }
         );
 
         if (!aberrationData) {
@@ -853,18 +929,32 @@ export async function showAstigmatismDiagram(options = {}) {
         const { plotAstigmaticFieldCurves } = await import('../evaluation/aberrations/astigmatism-plot.js');
 
         console.log('🎯 非点収差曲線データ生成中（RMS最小値探索）...');
-        const fieldCurvesData = await calculateAstigmatismData(
+        const fieldCurvesData = await getOrComputeAnalysis(
+            'astigmatism',
             opticalSystemRows,
-            sourceRows || [],
-            processedObjectRows || [],
-            targetSurfaceIndex,
             {
+                sourceRows: sourceRows || [],
+                objectRows: processedObjectRows || [],
+                targetSurfaceIndex,
                 spotDiagramMode: false,
-                rayCount: rayCount,
+                rayCount,
                 interpolationPoints: 10,
-                verbose: true,
-                onProgress
-            }
+                primaryWavelength: getAnalysisPrimaryWavelength()
+            },
+            () => calculateAstigmatismData(
+                opticalSystemRows,
+                sourceRows || [],
+                processedObjectRows || [],
+                targetSurfaceIndex,
+                {
+                    spotDiagramMode: false,
+                    rayCount: rayCount,
+                    interpolationPoints: 10,
+                    verbose: true,
+                    onProgress
+                }
+            ),
+            { onHit: replayProgressOnHit(onProgress) }
         );
 
         if (!fieldCurvesData || !fieldCurvesData.data || fieldCurvesData.data.length === 0) {
@@ -1365,12 +1455,25 @@ export async function showIntegratedAberrationDiagram(options = {}) {
         console.log('📊 Calculating astigmatism...');
         const { calculateAstigmatismData } = await import('../evaluation/aberrations/astigmatism.js');
         
-        const astigmatismData = await calculateAstigmatismData(
+        const astigmatismData = await getOrComputeAnalysis(
+            'astigmatism',
             opticalSystemRows,
-            sourceRows,
-            objectRows,
-            surfaceIndex,
-            { rayCount: rayCountAstigmatism, interpolationPoints: 10, onProgress: mapProgress(35, 35, 'Astigmatism') }
+            {
+                sourceRows: sourceRows || [],
+                objectRows: objectRows || [],
+                targetSurfaceIndex: surfaceIndex,
+                rayCount: rayCountAstigmatism,
+                interpolationPoints: 10,
+                primaryWavelength: getAnalysisPrimaryWavelength()
+            },
+            () => calculateAstigmatismData(
+                opticalSystemRows,
+                sourceRows,
+                objectRows,
+                surfaceIndex,
+                { rayCount: rayCountAstigmatism, interpolationPoints: 10, onProgress: mapProgress(35, 35, 'Astigmatism') }
+            ),
+            { onHit: replayProgressOnHit(mapProgress(35, 35, 'Astigmatism')) }
         );
         
         if (!astigmatismData) {
@@ -1441,11 +1544,17 @@ export async function showIntegratedAberrationDiagram(options = {}) {
             const wavelength = wavelengths[wlIndex];
             const wlBase = 70 + (25 * wlIndex) / Math.max(1, wavelengths.length);
             const wlSpan = 25 / Math.max(1, wavelengths.length);
-            const distData = await calculateDistortionData(
+            const distData = await getOrComputeAnalysis(
+                'distortion',
                 opticalSystemRows,
-                fieldValues,
-                wavelength,
-                { heightMode, onProgress: mapProgress(wlBase, wlSpan, `Distortion (λ=${wavelength.toFixed(4)}μm)`) }
+                { objectRows: objectRows || [], fieldValues, wavelength, heightMode },
+                () => calculateDistortionData(
+                    opticalSystemRows,
+                    fieldValues,
+                    wavelength,
+                    { heightMode, onProgress: mapProgress(wlBase, wlSpan, `Distortion (λ=${wavelength.toFixed(4)}μm)`) }
+                ),
+                { onHit: replayProgressOnHit(mapProgress(wlBase, wlSpan, `Distortion (λ=${wavelength.toFixed(4)}μm)`)) }
             );
             if (distData) {
                 distortionDataByWavelength.push({
@@ -85,7 +85,7 @@ function parseOverrideKey(variableId) {
   return { blockId, key };
 }
 
-function applyOverridesToBlocks(blocks, overrides) {
+export function applyOverridesToBlocks(blocks, overrides) {
   const cloned = cloneJson(blocks);
   if (!Array.isArray(cloned)) return Array.isArray(blocks) ? blocks : [];
   if (!isPlainObject(overrides)) return cloned;
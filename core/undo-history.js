@@ -789,6 +789,30 @@ class UndoHistory {
     this.redoStack = [];
     this.maxSize = maxSize;
     this.isExecuting = false; // Prevent recording during undo/redo
+    this.revision = 0; // Bumped on every edit / undo / redo / clear
+    this.changeListeners = new Set();
+  }
+  
+  /**
+   * Subscribe to history changes (e.g. evaluation/analysis-cache.js drops stale traces)
+   * @param {(revision:number, reason:string) => void} listener
+   * @returns {() => void} unsubscribe
+   */
+  addChangeListener(listener) {
+    if (typeof listener !== 'function') return () => {};
+    this.changeListeners.add(listener);
+    return () => this.changeListeners.delete(listener);
+  }
+  
+  notifyChange(reason) {
+    this.revision++;
+    for (const listener of this.changeListeners) {
+      try {
+        listener(this.revision, reason);
+      } catch (error) {
+        console.error('[Undo] Change listener error:', error);
+      }
+    }
   }
   
   /**
@@ -811,6 +835,7 @@ class UndoHistory {
       this.undoStack.shift();
     }
     
+    this.notifyChange('record');
     this.notifyListeners();
     
     console.log(`[Undo] Recorded: ${command.description}`);
@@ -832,6 +857,7 @@ class UndoHistory {
       console.log(`[Undo] Undoing: ${command.description}`, command);
       command.undo();
       this.redoStack.push(command);
+      this.notifyChange('undo');
       this.notifyListeners();
       console.log('[Undo] Undo completed successfully');
       return true;
@@ -859,6 +885,7 @@ class UndoHistory {
       console.log(`[Undo] Redoing: ${command.description}`, command);
       command.execute();
       this.undoStack.push(command);
+      this.notifyChange('redo');
       this.notifyListeners();
       console.log('[Undo] Redo completed successfully');
       return true;
@@ -884,6 +911,7 @@ class UndoHistory {
   clear() {
     this.undoStack = [];
     this.redoStack = [];
+    this.notifyChange('clear');
     this.notifyListeners();
     console.log('[Undo] History cleared');
   }
@@ -919,7 +947,8 @@ class UndoHistory {
       redoStackSize: this.redoStack.length,
       canUndo: this.canUndo(),
       canRedo: this.canRedo(),
-      isExecuting: this.isExecuting
+      isExecuting: this.isExecuting,
+      revision: this.revision
     };
   }
 }
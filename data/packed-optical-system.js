@@ -0,0 +1,442 @@
+// Packed binary optical system (versioned, little-endian)
+// - JSON rows stay the editable source of truth; this is a derived form for hot paths:
+//   one ArrayBuffer that can be posted to a worker as a transferable and read without parsing.
+// - Row fields are stored as columns (field-major): a Float64Array of values plus a Uint8Array of
+//   value tags, with all strings (field names, materials, comments, ...) in one UTF-8 string table.
+//   unpackOpticalSystemRows() restores the rows exactly (numbers, numeric strings like "144.296",
+//   '', null, booleans, nested JSON), including per-row missing keys.
+// - Optional RT10 section: the surface table of trace_system_rt10 (RT10_LAYOUT, stride 40) with its
+//   wavelength slots, stored 8-byte aligned so readPackedOpticalSystem() returns a zero-copy
+//   Float64Array that can be copied straight into the WASM heap (see packOpticalSystemBinary() in
+//   raytracing/core/ray-batch-trace.js).
+// - packAllData()/unpackAllData() wrap a whole save-file object: every `opticalSystem` row array is
+//   replaced by a packed section, the rest stays JSON (used by utils/url-share.js).
+//   Sections there use compactValues: the value plane is written as shortest round-trip decimal text
+//   (only cells that carry a value) and strings are NUL-separated. Deflated, that is ~15% smaller
+//   than the JSON rows; dense f64 cells would deflate ~40% larger than the JSON.
+//
+// Layout v1 (byte offsets; sections in this order, each 8-byte aligned):
+//   header (40 B): u32 magic 'COPS' | u16 version | u16 flags | u32 rowCount | u32 fieldCount |
+//                  u32 stringCount | u32 stringBytes | u32 rt10SurfaceCount | u32 rt10WavelengthCount |
+//                  u32 rt10Stride | u32 signature (flags & SIGNATURE: content hash of the rows it was packed
+//                  from, set by packOpticalSystemBinary(); a packed RT10 table is only used for matching rows)
+//   values  f64[fieldCount * rowCount]           (field-major; empty with flags & TEXT_VALUES)
+//   rt10Wl  f64[rt10WavelengthCount]             (flags & RT10)
+//   rt10    f64[rt10SurfaceCount * rt10Stride]   (flags & RT10)
+//   strOfs  u32[stringCount + 1]                 (absent with TEXT_VALUES: strings are NUL-separated)
+//   tags    u8 [fieldCount * rowCount]
+//   strings utf-8[stringBytes]                   (strings 0 .. fieldCount-1 are the field names;
+//                                                 with TEXT_VALUES the last string is the value text)
+
+export const PACKED_SYSTEM_MAGIC = 0x53504f43; // 'COPS'
+export const PACKED_SYSTEM_VERSION = 1;
+export const PACKED_SYSTEM_FLAG_RT10 = 1;
+export const PACKED_SYSTEM_FLAG_TEXT_VALUES = 2;
+export const PACKED_SYSTEM_FLAG_SIGNATURE = 4;
+
+const HEADER_BYTES = 40;
+
+// 値のタグ（values[] の解釈）
+export const PACKED_TAG = Object.freeze({
+  MISSING: 0,        // キーなし
+  NUMBER: 1,         // values = 数値
+  STRING: 2,         // values = 文字列表の番号
+  EMPTY: 3,          // ''
+  NULL: 4,
+  FALSE: 5,
+  TRUE: 6,
+  NUMERIC_STRING: 7, // String(values) で元の文字列に戻るもの（"144.296" 等）
+  JSON: 8            // values = JSON.stringify の文字列表番号（配列・オブジェクト）
+});
+
+const ALL_DATA_MAGIC = 0x41504f43; // 'COPA'
+const ALL_DATA_VERSION = 1;
+const ALL_DATA_HEADER_BYTES = 16;
+const PACKED_ROWS_PLACEHOLDER_KEY = '__cooptPackedRows';
+
+const align8 = (n) => (n + 7) & ~7;
+
+let __textEncoder = null;
+let __textDecoder = null;
+function utf8Encode(s) {
+  if (!__textEncoder) __textEncoder = new TextEncoder();
+  return __textEncoder.encode(s);
+}
+function utf8Decode(bytes) {
+  if (!__textDecoder) __textDecoder = new TextDecoder();
+  return __textDecoder.decode(bytes);
+}
+
+// values[] を使うタグ
+function hasValue(tag) {
+  return tag === PACKED_TAG.NUMBER || tag === PACKED_TAG.STRING || tag === PACKED_TAG.NUMERIC_STRING || tag === PACKED_TAG.JSON;
+}
+
+function isPlainObject(v) {
+  return !!v && typeof v === 'object' && !Array.isArray(v);
+}
+
+function isRowArray(v) {
+  return Array.isArray(v) && v.every(isPlainObject);
+}
+
+/**
+ * @param {ArrayBuffer|ArrayBufferView} buffer
+ * @returns {boolean} packOpticalSystemRows() の出力（このバージョンで読めるもの）か
+ */
+export function isPackedOpticalSystem(buffer) {
+  const view = toDataView(buffer);
+  return !!view && view.byteLength >= HEADER_BYTES &&
+    view.getUint32(0, true) === PACKED_SYSTEM_MAGIC &&
+    view.getUint16(4, true) === PACKED_SYSTEM_VERSION;
+}
+
+function toDataView(buffer) {
+  if (buffer instanceof ArrayBuffer) return new DataView(buffer);
+  if (ArrayBuffer.isView(buffer)) return new DataView(buffer.buffer, buffer.byteOffset, buffer.byteLength);
+  return null;
+}
+
+/**
+ * 光学系の行配列をパックする。
+ * @param {Array<Object>} rows 光学系テーブル（OpticalSystemTableData と同形式）
+ * @param {Object} [options]
+ * @param {{surfaces: Float64Array, surfaceCount: number, wavelengths: number[]}} [options.rt10]
+ *   packOpticalSystemForWasm() の結果（同じ rows から作ったもの）
+ * @param {number} [options.rt10Stride=40] RT10_LAYOUT.STRIDE
+ * @param {boolean} [options.compactValues=false] 値を 10 進テキストで持つ（転送・圧縮向け, 読み込み時に展開）
+ * @param {number} [options.signature] 行の内容ハッシュ（u32, computeRowsContentHash()）。ヘッダに記録する
+ * @returns {ArrayBuffer}
+ */
+export function packOpticalSystemRows(rows, options = {}) {
+  const list = Array.isArray(rows) ? rows : [];
+  const rowCount = list.length;
+
+  const fields = [];
+  const fieldIndex = new Map();
+  for (const row of list) {
+    if (!isPlainObject(row)) continue;
+    for (const key of Object.keys(row)) {
+      if (!fieldIndex.has(key)) {
+        fieldIndex.set(key, fields.length);
+        fields.push(key);
+      }
+    }
+  }
+  const fieldCount = fields.length;
+
+  const strings = fields.slice();
+  const stringIndex = new Map();
+  const internString = (s) => {
+    let id = stringIndex.get(s);
+    if (id === undefined) {
+      id = strings.length;
+      strings.push(s);
+      stringIndex.set(s, id);
+    }
+    return id;
+  };
+
+  const cells = fieldCount * rowCount;
+  const values = new Float64Array(cells);
+  const tags = new Uint8Array(cells);
+  for (let r = 0; r < rowCount; r++) {
+    const row = list[r];
+    if (!isPlainObject(row)) continue;
+    for (const key of Object.keys(row)) {
+      const c = fieldIndex.get(key) * rowCount + r;
+      const v = row[key];
+      if (v === undefined) {
+        tags[c] = PACKED_TAG.MISSING;
+      } else if (typeof v === 'number') {
+        tags[c] = PACKED_TAG.NUMBER;
+        values[c] = v;
+      } else if (typeof v === 'string') {
+        if (v === '') {
+          tags[c] = PACKED_TAG.EMPTY;
+        } else {
+          const num = Number(v);
+          if (String(num) === v) {
+            tags[c] = PACKED_TAG.NUMERIC_STRING;
+            values[c] = num;
+          } else {
+            tags[c] = PACKED_TAG.STRING;
+            values[c] = internString(v);
+          }
+        }
+      } else if (v === null) {
+        tags[c] = PACKED_TAG.NULL;
+      } else if (typeof v === 'boolean') {
+        tags[c] = v ? PACKED_TAG.TRUE : PACKED_TAG.FALSE;
+      } else {
+        const json = JSON.stringify(v);
+        if (json === undefined) continue; // 関数など（JSON でも消える）
+        tags[c] = PACKED_TAG.JSON;
+        values[c] = internString(json);
+      }
+    }
+  }
+
+  // テキスト形式は文字列を NUL 区切りで持つので、NUL を含む文字列があれば通常形式にする
+  const compactValues = !!options?.compactValues && !strings.some(str => str.includes('\u0000'));
+  if (compactValues) {
+    const text = [];
+    for (let c = 0; c < cells; c++) {
+      if (hasValue(tags[c])) text.push(Object.is(values[c], -0) ? '-0' : String(values[c]));
+    }
+    strings.push(text.join(','));
+  }
+
+  const encoded = compactValues ? [utf8Encode(strings.join('\u0000'))] : strings.map(utf8Encode);
+  const stringCount = strings.length;
+  let stringBytes = 0;
+  for (const b of encoded) stringBytes += b.length;
+
+  const rt10 = options?.rt10;
+  const rt10Stride = Number.isInteger(options?.rt10Stride) ? options.rt10Stride : 40;
+  const hasRt10 = !!(rt10 && rt10.surfaces instanceof Float64Array && rt10.surfaceCount > 0 &&
+    rt10.surfaces.length >= rt10.surfaceCount * rt10Stride);
+  const rt10SurfaceCount = hasRt10 ? rt10.surfaceCount : 0;
+  const rt10Wavelengths = hasRt10 ? Array.from(rt10.wavelengths || []) : [];
+
+  let off = HEADER_BYTES;
+  const valueCells = compactValues ? 0 : cells;
+  const valuesOff = off; off = align8(off + valueCells * 8);
+  const rt10WlOff = off; off = align8(off + rt10Wavelengths.length * 8);
+  const rt10Off = off; off = align8(off + rt10SurfaceCount * rt10Stride * 8);
+  const strOfsOff = off; off += compactValues ? 0 : (stringCount + 1) * 4;
+  const tagsOff = off; off += cells;
+  const stringsOff = off; off = align8(off + stringBytes);
+
+  const buffer = new ArrayBuffer(off);
+  const view = new DataView(buffer);
+  view.setUint32(0, PACKED_SYSTEM_MAGIC, true);
+  view.setUint16(4, PACKED_SYSTEM_VERSION, true);
+  const hasSignature = Number.isFinite(options?.signature);
+  view.setUint16(6, (hasRt10 ? PACKED_SYSTEM_FLAG_RT10 : 0) | (compactValues ? PACKED_SYSTEM_FLAG_TEXT_VALUES : 0) |
+    (hasSignature ? PACKED_SYSTEM_FLAG_SIGNATURE : 0), true);
+  view.setUint32(8, rowCount, true);
+  view.setUint32(12, fieldCount, true);
+  view.setUint32(16, stringCount, true);
+  view.setUint32(20, stringBytes, true);
+  view.setUint32(24, rt10SurfaceCount, true);
+  view.setUint32(28, rt10Wavelengths.length, true);
+  view.setUint32(32, rt10Stride, true);
+  view.setUint32(36, hasSignature ? (options.signature >>> 0) : 0, true);
+
+  if (!compactValues) new Float64Array(buffer, valuesOff, cells).set(values);
+  if (hasRt10) {
+    new Float64Array(buffer, rt10WlOff, rt10Wavelengths.length).set(rt10Wavelengths);
+    new Float64Array(buffer, rt10Off, rt10SurfaceCount * rt10Stride)
+      .set(rt10.surfaces.subarray(0, rt10SurfaceCount * rt10Stride));
+  }
+  const bytes = new Uint8Array(buffer);
+  bytes.set(tags, tagsOff);
+  if (compactValues) {
+    bytes.set(encoded[0], stringsOff);
+    return buffer;
+  }
+  let s = 0;
+  for (let i = 0; i < stringCount; i++) {
+    view.setUint32(strOfsOff + i * 4, s, true);
+    bytes.set(encoded[i], stringsOff + s);
+    s += encoded[i].length;
+  }
+  view.setUint32(strOfsOff + stringCount * 4, s, true);
+  return buffer;
+}
+
+/**
+ * パック済みバッファの各セクションへのビュー（コピーなし）。
+ * @param {ArrayBuffer|ArrayBufferView} buffer packOpticalSystemRows() の出力
+ * @returns {{rowCount:number, fields:string[], values:Float64Array, tags:Uint8Array, string:(i:number)=>string,
+ *   rt10: ({surfaces: Float64Array, surfaceCount: number, wavelengths: number[], stride: number}|null),
+ *   signature: (number|null)}}
+ */
+export function readPackedOpticalSystem(buffer) {
+  if (!isPackedOpticalSystem(buffer)) throw new Error('Not a packed optical system (or unsupported version)');
+  const view = toDataView(buffer);
+  const base = view.byteOffset;
+  const ab = view.buffer;
+  if (base % 8 !== 0) throw new Error('Packed optical system must start 8-byte aligned');
+
+  const flags = view.getUint16(6, true);
+  const rowCount = view.getUint32(8, true);
+  const fieldCount = view.getUint32(12, true);
+  const stringCount = view.getUint32(16, true);
+  const stringBytes = view.getUint32(20, true);
+  const rt10SurfaceCount = view.getUint32(24, true);
+  const rt10WavelengthCount = view.getUint32(28, true);
+  const rt10Stride = view.getUint32(32, true);
+  const signature = (flags & PACKED_SYSTEM_FLAG_SIGNATURE) ? view.getUint32(36, true) : null;
+  const cells = fieldCount * rowCount;
+
+  const textValues = (flags & PACKED_SYSTEM_FLAG_TEXT_VALUES) !== 0;
+
+  let off = HEADER_BYTES;
+  const valuesOff = off; off = align8(off + (textValues ? 0 : cells) * 8);
+  const rt10WlOff = off; off = align8(off + rt10WavelengthCount * 8);
+  const rt10Off = off; off = align8(off + rt10SurfaceCount * rt10Stride * 8);
+  const strOfsOff = off; off += textValues ? 0 : (stringCount + 1) * 4;
+  const tagsOff = off; off += cells;
+  const stringsOff = off;
+  if (stringsOff + stringBytes > view.byteLength) throw new Error('Packed optical system is truncated');
+
+  const stringBytesView = new Uint8Array(ab, base + stringsOff, stringBytes);
+  const cache = textValues ? utf8Decode(stringBytesView).split('\u0000') : new Array(stringCount);
+  if (cache.length !== stringCount) throw new Error('Packed optical system string table is corrupt');
+  const string = (i) => {
+    if (!(i >= 0 && i < stringCount)) return '';
+    if (cache[i] === undefined) {
+      const a = view.getUint32(strOfsOff + i * 4, true);
+      const b = view.getUint32(strOfsOff + (i + 1) * 4, true);
+      cache[i] = utf8Decode(stringBytesView.subarray(a, b));
+    }
+    return cache[i];
+  };
+
+  const fields = [];
+  for (let f = 0; f < fieldCount; f++) fields.push(string(f));
+
+  const rt10 = (flags & PACKED_SYSTEM_FLAG_RT10) && rt10SurfaceCount > 0
+    ? {
+      surfaces: new Float64Array(ab, base + rt10Off, rt10SurfaceCount * rt10Stride),
+      surfaceCount: rt10SurfaceCount,
+      wavelengths: Array.from(new Float64Array(ab, base + rt10WlOff, rt10WavelengthCount)),
+      stride: rt10Stride
+    }
+    : null;
+
+  const tags = new Uint8Array(ab, base + tagsOff, cells);
+  let values;
+  if (textValues) {
+    values = new Float64Array(cells);
+    const text = string(stringCount - 1);
+    const parts = text === '' ? [] : text.split(',');
+    let k = 0;
+    for (let c = 0; c < cells; c++) {
+      if (hasValue(tags[c])) values[c] = Number(parts[k++]);
+    }
+  } else {
+    values = new Float64Array(ab, base + valuesOff, cells);
+  }
+
+  return {
+    rowCount,
+    fields,
+    values,
+    tags,
+    string,
+    rt10,
+    signature
+  };
+}
+
+/**
+ * packOpticalSystemRows() の逆変換。
+ * @param {ArrayBuffer|ArrayBufferView} buffer
+ * @returns {Array<Object>} 光学系テーブル（元の行と同じ値）
+ */
+export function unpackOpticalSystemRows(buffer) {
+  const p = readPackedOpticalSystem(buffer);
+  const T = PACKED_TAG;
+  const rows = [];
+  for (let r = 0; r < p.rowCount; r++) {
+    const row = {};
+    for (let f = 0; f < p.fields.length; f++) {
+      const c = f * p.rowCount + r;
+      const v = p.values[c];
+      switch (p.tags[c]) {
+        case T.NUMBER: row[p.fields[f]] = v; break;
+        case T.STRING: row[p.fields[f]] = p.string(v); break;
+        case T.EMPTY: row[p.fields[f]] = ''; break;
+        case T.NULL: row[p.fields[f]] = null; break;
+        case T.FALSE: row[p.fields[f]] = false; break;
+        case T.TRUE: row[p.fields[f]] = true; break;
+        case T.NUMERIC_STRING: row[p.fields[f]] = String(v); break;
+        case T.JSON: row[p.fields[f]] = JSON.parse(p.string(v)); break;
+        default: break;
+      }
+    }
+    rows.push(row);
+  }
+  return rows;
+}
+
+// --- 保存データ全体（URL 共有用） ---
+//   header (16 B): u32 magic 'COPA' | u16 version | u16 sectionCount | u32 jsonBytes | u32 reserved
+//   json utf-8 (opticalSystem 配列は { __cooptPackedRows: k } に置き換え), 8-byte aligned
+//   section k: u32 byteLength | u32 reserved | packOpticalSystemRows() の出力（8-byte aligned）
+
+/**
+ * @param {Object} allData 保存ファイルと同じ形のオブジェクト
+ * @returns {Uint8Array}
+ */
+export function packAllData(allData) {
+  const sections = [];
+  const replacer = (key, value) => {
+    if (key === 'opticalSystem' && Array.isArray(value) && value.length > 0 && isRowArray(value)) {
+      sections.push(packOpticalSystemRows(value, { compactValues: true }));
+      return { [PACKED_ROWS_PLACEHOLDER_KEY]: sections.length - 1 };
+    }
+    return value;
+  };
+  const json = utf8Encode(JSON.stringify(allData ?? null, replacer));
+
+  let size = align8(ALL_DATA_HEADER_BYTES + json.length);
+  for (const s of sections) size += 8 + align8(s.byteLength);
+  const out = new Uint8Array(size);
+  const view = new DataView(out.buffer);
+  view.setUint32(0, ALL_DATA_MAGIC, true);
+  view.setUint16(4, ALL_DATA_VERSION, true);
+  view.setUint16(6, sections.length, true);
+  view.setUint32(8, json.length, true);
+  out.set(json, ALL_DATA_HEADER_BYTES);
+  let off = align8(ALL_DATA_HEADER_BYTES + json.length);
+  for (const s of sections) {
+    view.setUint32(off, s.byteLength, true);
+    out.set(new Uint8Array(s), off + 8);
+    off += 8 + align8(s.byteLength);
+  }
+  return out;
+}
+
+/**
+ * packAllData() の逆変換。
+ * @param {Uint8Array|ArrayBuffer} bytes
+ * @returns {Object}
+ */
+export function unpackAllData(bytes) {
+  const u8 = (bytes instanceof Uint8Array) ? bytes : new Uint8Array(bytes);
+  // 各セクションを 8-byte 境界から読めるようにする（subarray のままだと Float64Array が作れない場合がある）
+  const data = (u8.byteOffset % 8 === 0) ? u8 : u8.slice();
+  const view = new DataView(data.buffer, data.byteOffset, data.byteLength);
+  if (data.byteLength < ALL_DATA_HEADER_BYTES || view.getUint32(0, true) !== ALL_DATA_MAGIC) {
+    throw new Error('Not packed design data');
+  }
+  if (view.getUint16(4, true) !== ALL_DATA_VERSION) throw new Error('Unsupported packed design data version');
+  const sectionCount = view.getUint16(6, true);
+  const jsonBytes = view.getUint32(8, true);
+  if (ALL_DATA_HEADER_BYTES + jsonBytes > data.byteLength) throw new Error('Packed design data is truncated');
+
+  const sections = [];
+  let off = align8(ALL_DATA_HEADER_BYTES + jsonBytes);
+  for (let k = 0; k < sectionCount; k++) {
+    if (off + 8 > data.byteLength) throw new Error('Packed design data is truncated');
+    const len = view.getUint32(off, true);
+    if (off + 8 + len > data.byteLength) throw new Error('Packed design data is truncated');
+    sections.push(data.subarray(off + 8, off + 8 + len));
+    off += 8 + align8(len);
+  }
+
+  const json = utf8Decode(data.subarray(ALL_DATA_HEADER_BYTES, ALL_DATA_HEADER_BYTES + jsonBytes));
+  return JSON.parse(json, (key, value) => {
+    if (key === 'opticalSystem' && isPlainObject(value) && Object.keys(value).length === 1 &&
+        Number.isInteger(value[PACKED_ROWS_PLACEHOLDER_KEY])) {
+      const section = sections[value[PACKED_ROWS_PLACEHOLDER_KEY]];
+      if (!section) throw new Error('Packed design data references a missing section');
+      return unpackOpticalSystemRows(section);
+    }
+    return value;
+  });
+}
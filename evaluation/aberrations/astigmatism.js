@@ -25,7 +25,7 @@
  * 更新日: 2025/11/14 - Draw Cross光線を直接使用する簡潔な実装に変更
  */
 
-import { calculateChiefRayNewton } from './transverse-aberration.js';
+import { calculateChiefRayNewtonCached } from './transverse-aberration.js';
 import { getObjectRows, getSourceRows } from '../../utils/data-utils.js';
 import { traceRay, traceRayHitPoint, calculateSurfaceOrigins } from '../../raytracing/core/ray-tracing.js';
 
@@ -1353,7 +1353,7 @@ export async function calculateAstigmatismData(opticalSystemRows, sourceRows, ob
         
         if (referenceField) {
             console.log(`   🎯 主波長の基準フィールドで基準像面を計算: ${referenceField.displayName}`);
-            const referenceChiefResult = calculateChiefRayNewton(
+            const referenceChiefResult = calculateChiefRayNewtonCached(
                 opticalSystemRows,
                 referenceField,
                 primaryWavelength,
@@ -1508,7 +1508,7 @@ function calculateFieldData(
     try {
         // 主光線を計算（近軸像点計算に必要）
         // rayCount オプションでクロスビームの光線本数を指定
-        const chiefRayResult = calculateChiefRayNewton(
+        const chiefRayResult = calculateChiefRayNewtonCached(
             opticalSystemRows, 
             fieldSetting, 
             wavelength, 
@@ -6,8 +6,8 @@
 // This module sweeps either field angles (deg) or object heights (mm, Y) and traces the chief ray.
 // Returns both absolute heights and distortion ratio (percentage).
 
-import { calculateParaxialData } from '../../raytracing/core/ray-paraxial.js';
-import { calculateChiefRayNewton } from './transverse-aberration.js';
+import { getParaxialData } from '../../raytracing/core/first-order-cache.js';
+import { calculateChiefRayNewtonCached } from './transverse-aberration.js';
 import { calculateSurfaceOrigins } from '../../raytracing/core/ray-tracing.js';
 
 // Helper function to detect mirror surfaces
@@ -147,7 +147,7 @@ export async function calculateDistortionData(opticalSystemRows, fieldSamples, w
   }
   const imageSurfaceInfo = surfaceOrigins?.[imageSurfaceIndex] || null;
 
-  const paraxial = calculateParaxialData(opticalSystemRows, wavelength);
+  const paraxial = getParaxialData(opticalSystemRows, wavelength);
   const fPrime = paraxial?.focalLength; // 有効焦点距離
   if (!fPrime || !isFinite(fPrime)) {
     console.error('❌ calculateDistortionData: focal length unavailable');
@@ -200,7 +200,7 @@ export async function calculateDistortionData(opticalSystemRows, fieldSamples, w
 
     let hReal = null;
     try {
-      const chief = calculateChiefRayNewton(opticalSystemRows, fieldSetting, wavelength, 'unified', { rayCount: 11 });
+      const chief = calculateChiefRayNewtonCached(opticalSystemRows, fieldSetting, wavelength, 'unified', { rayCount: 11 });
       if (chief?.success && chief?.ray?.path?.length) {
         const lastPointGlobal = chief.ray.path[chief.ray.path.length - 1];
         
@@ -321,7 +321,7 @@ export async function calculateGridDistortion(opticalSystemRows, gridSize = 20,
   }
   const imageSurfaceInfo = surfaceOrigins?.[imageSurfaceIndex] || null;
 
-  const paraxial = calculateParaxialData(opticalSystemRows, wavelength);
+  const paraxial = getParaxialData(opticalSystemRows, wavelength);
   const fPrime = paraxial?.focalLength;
   if (!fPrime || !isFinite(fPrime)) {
     console.error('❌ calculateGridDistortion: focal length unavailable');
@@ -382,7 +382,7 @@ export async function calculateGridDistortion(opticalSystemRows, gridSize = 20,
       let hRealX = null;
       let hRealY = null;
       try {
-        const chief = calculateChiefRayNewton(
+        const chief = calculateChiefRayNewtonCached(
           opticalSystemRows, 
           fieldSetting, 
           wavelength, 
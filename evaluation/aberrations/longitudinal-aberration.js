@@ -19,7 +19,8 @@ import { generateFiniteSystemCrossBeam } from '../../raytracing/generation/gen-r
 import { generateInfiniteSystemCrossBeam } from '../../raytracing/generation/gen-ray-cross-infinite.js';
 import { traceRay, traceRayHitPoint, calculateSurfaceOrigins } from '../../raytracing/core/ray-tracing.js';
 import { getObjectRows } from '../../utils/data-utils.js';
-import { calculateBackFocalLength, getRefractiveIndex } from '../../raytracing/core/ray-paraxial.js';
+import { getRefractiveIndex } from '../../raytracing/core/ray-paraxial.js';
+import { getBackFocalLength } from '../../raytracing/core/first-order-cache.js';
 
 function applyRotationMatrixToVector(matrix, v) {
     if (!matrix) return { x: v.x, y: v.y, z: v.z };
@@ -819,7 +820,7 @@ export function calculateLongitudinalAberration(
     
     // 主波長のBFL（近軸像点位置）を計算
     const lastSurfaceZ = imagePlaneZ; // 最終面のZ座標
-    const primaryBFL = calculateBackFocalLength(opticalSystemRows, primaryWavelength);
+    const primaryBFL = getBackFocalLength(opticalSystemRows, primaryWavelength);
     const primaryImageZ = lastSurfaceZ + primaryBFL;
     console.log(`📊 主波長の近軸像点位置: ${primaryImageZ.toFixed(6)} mm (BFL: ${primaryBFL.toFixed(6)} mm)`);
     
@@ -860,7 +861,7 @@ export function calculateLongitudinalAberration(
             dbg('🐞 [SA] wavelength start', { wlIndex, wavelength });
         
         // この波長のBFLを計算
-        const currentBFL = calculateBackFocalLength(opticalSystemRows, wavelength);
+        const currentBFL = getBackFocalLength(opticalSystemRows, wavelength);
         const currentImageZ = lastSurfaceZ + currentBFL;
         wavelengthBFLs[wavelength] = currentBFL;
         console.log(`  この波長の近軸像点位置: ${currentImageZ.toFixed(6)} mm (BFL: ${currentBFL.toFixed(6)} mm)`);
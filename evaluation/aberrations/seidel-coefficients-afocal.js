@@ -12,9 +12,9 @@ import {
     getRefractiveIndex as getRefractiveIndexFromSurface,
     getSafeRadius,
     getSafeThickness,
-    calculateFullSystemParaxialTrace,
     isCoordTransSurface
 } from '../../raytracing/core/ray-paraxial.js';
+import { getFullSystemParaxialTrace } from '../../raytracing/core/first-order-cache.js';
 import { tableSource } from '../../data/table-source.js';
 
 // ガラス情報の補完: Ref Index/Abbeが無い場合でも、Materialが数値ならndとして扱う
@@ -422,7 +422,7 @@ export function performAfocalParaxialTrace(opticalSystemRows, wavelength, stopIn
     console.log(`📍 N₁ = ${N1.toFixed(6)} (空気)`);
     
     // 横倍率βを取得（Paraxial Magnification = initialAlpha / finalAlpha）
-    const fullSystemResult = calculateFullSystemParaxialTrace(opticalSystemRows, wavelength);
+    const fullSystemResult = getFullSystemParaxialTrace(opticalSystemRows, wavelength);
     
     if (!fullSystemResult || !fullSystemResult.finalAlpha) {
         console.error('❌ Paraxial trace failed');
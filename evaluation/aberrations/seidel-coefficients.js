@@ -19,12 +19,10 @@ import {
     getSafeThickness, 
     getRefractiveIndex as getRefractiveIndexFromSurface,
     findStopSurfaceIndex,
-    calculateFocalLength,
-    calculateBackFocalLength,
-    calculatePupilsByNewSpec,
     calculateFullSystemParaxialTrace,
     isCoordTransSurface
 } from '../../raytracing/core/ray-paraxial.js';
+import { getFocalLength, getBackFocalLength, getPupilsByNewSpec } from '../../raytracing/core/first-order-cache.js';
 import { tableSource, loadTableData as loadSourceTableData } from '../../data/table-source.js';
 
 function getSourceRowsSafe() {
@@ -234,11 +232,11 @@ export function calculateSeidelCoefficients(opticalSystemRows, wavelength = 0.58
     console.log('📊 Trace data length:', traceData.length);
 
     // 焦点距離を計算（ray-paraxial.jsの標準関数を使用）
-    const focalLength = calculateFocalLength(opticalSystemRows, wavelength);
+    const focalLength = getFocalLength(opticalSystemRows, wavelength);
     console.log(`📊 Focal Length (from calculateFocalLength): ${focalLength?.toFixed(6)} mm`);
     
     // 後側焦点距離を計算
-    const backFocalLength = calculateBackFocalLength(opticalSystemRows, wavelength);
+    const backFocalLength = getBackFocalLength(opticalSystemRows, wavelength);
     console.log(`📊 Back Focal Length: ${backFocalLength?.toFixed(6)} mm`);
     
     if (!focalLength || !isFinite(focalLength) || Math.abs(focalLength) < 1e-10) {
@@ -305,7 +303,7 @@ export function calculateSeidelCoefficients(opticalSystemRows, wavelength = 0.58
     });
     
     // 入射瞳位置を計算（色収差計算で必要）
-    const pupilsData = calculatePupilsByNewSpec(normalizedOpticalSystem, wavelength);
+    const pupilsData = getPupilsByNewSpec(normalizedOpticalSystem, wavelength);
     const entrancePupilPosition = pupilsData?.entrancePupil?.position || 0; // 正規化された入射瞳位置
     
     // 正規化された系で周辺光線追跡を実行（NFL = h[1]）
@@ -382,7 +380,7 @@ export function calculateSeidelCoefficients(opticalSystemRows, wavelength = 0.58
             const g_k_prime = (r_k !== 0 && isFinite(r_k)) ? (n_k_right * r_k) / (n_k_right - n_k_left) : Infinity;
             
             // 入射瞳からこのレンズ面までの距離を計算（ℓk）正規化済み
-            const pupilsData = calculatePupilsByNewSpec(normalizedOpticalSystem, wavelength);
+            const pupilsData = getPupilsByNewSpec(normalizedOpticalSystem, wavelength);
             let l_k = 0;
             if (pupilsData && pupilsData.entrancePupil && isFinite(pupilsData.entrancePupil.position)) {
                 // entrance pupil position は最初の面からの相対位置なので、Object面からの絶対位置に変換
@@ -1195,7 +1193,7 @@ function getAbbeNumber(surface, wavelength) {
     if (!surface.glass) return 0;
     
     // 3. Glass data からアッベ数を取得
-    const glassData = window.glassData;
+    const glassData = (typeof window !== 'undefined') ? window.glassData : null;
     if (glassData && glassData[surface.glass]) {
         const glass = glassData[surface.glass];
         if (glass.abbe) return glass.abbe;
@@ -1617,7 +1615,7 @@ function performChiefRayTrace(opticalSystemRows, wavelength, NFL = 1.0, maxField
     if (isFiniteSystem) {
         // 有限系の場合（式3・2・13）
         // ℓ₁: 第1面から入射瞳までの距離
-        const pupilsData = calculatePupilsByNewSpec(opticalSystemRows, wavelength);
+        const pupilsData = getPupilsByNewSpec(opticalSystemRows, wavelength);
         let l1 = 0; // デフォルト値
         
         if (pupilsData && pupilsData.entrancePupil && isFinite(pupilsData.entrancePupil.position)) {
@@ -1684,7 +1682,7 @@ function performChiefRayTrace(opticalSystemRows, wavelength, NFL = 1.0, maxField
     } else {
         // 無限系の場合
         // 正規化された系で入射瞳位置を計算する必要がある
-        const pupilsData = calculatePupilsByNewSpec(opticalSystemRows, wavelength);
+        const pupilsData = getPupilsByNewSpec(opticalSystemRows, wavelength);
         
         let t1_normalized = 0; // 第1面からの入射瞳位置（正規化済み）
         let entrancePupilPos_normalized = 0; // Object面からの入射瞳位置（正規化済み）
@@ -1846,7 +1844,7 @@ function performChiefRayTraceWithColorAtSurface(opticalSystemRows, targetSurface
     const referenceWavelength = 0.5875618;
     
     // 入射瞳位置を計算
-    const pupilsData = calculatePupilsByNewSpec(opticalSystemRows, referenceWavelength);
+    const pupilsData = getPupilsByNewSpec(opticalSystemRows, referenceWavelength);
     let t1_normalized = 0;
     let entrancePupilPos_normalized = 0;
     
@@ -2531,8 +2529,8 @@ export function formatSeidelCoefficients(seidelData) {
         });
         
         // 正規化した光学系での焦点距離を計算
-        const normalizedFocalLength = calculateFocalLength(normalizedOpticalSystem, wavelength);
-        const normalizedBackFocalLength = calculateBackFocalLength(normalizedOpticalSystem, wavelength);
+        const normalizedFocalLength = getFocalLength(normalizedOpticalSystem, wavelength);
+        const normalizedBackFocalLength = getBackFocalLength(normalizedOpticalSystem, wavelength);
         output += `Normalized Focal Length: ${normalizedFocalLength?.toFixed(6) || 'N/A'} (should be ${NFL.toFixed(6)})\n`;
         output += `Normalized Back Focal Length: ${normalizedBackFocalLength?.toFixed(6) || 'N/A'}\n\n`;
         
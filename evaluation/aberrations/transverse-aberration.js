@@ -16,7 +16,9 @@ import { generateFiniteSystemCrossBeam } from '../../raytracing/generation/gen-r
 import { generateInfiniteSystemCrossBeam } from '../../raytracing/generation/gen-ray-cross-infinite.js';
 import { traceRay, calculateSurfaceOrigins } from '../../raytracing/core/ray-tracing.js';
 import { getObjectRows, getSourceRows } from '../../utils/data-utils.js';
-import { calculateEntrancePupilDiameter, calculateParaxialData } from '../../raytracing/core/ray-paraxial.js';
+import { calculateEntrancePupilDiameter } from '../../raytracing/core/ray-paraxial.js';
+import { getParaxialData } from '../../raytracing/core/first-order-cache.js';
+import { getOrComputeAnalysisSync } from '../analysis-cache.js';
 
 const TRANSVERSE_DEBUG = !!(typeof globalThis !== 'undefined' && (globalThis.__TRANSVERSE_DEBUG || globalThis.__OPD_DEBUG || globalThis.__PSF_DEBUG));
 
@@ -2849,7 +2851,7 @@ function solveQuadraticEquation(a, b, c) {
 export function getEstimatedEntrancePupilDiameter(opticalSystemRows, wavelength = 0.5876) {
     try {
         // まず包括的な近軸計算を実行
-        const paraxialData = calculateParaxialData(opticalSystemRows, wavelength);
+        const paraxialData = getParaxialData(opticalSystemRows, wavelength);
         
         if (paraxialData && paraxialData.entrancePupilDiameter && 
             isFinite(paraxialData.entrancePupilDiameter) && 
@@ -3049,6 +3051,19 @@ export function calculateChiefRayNewton(opticalSystemRows, fieldSetting, wavelen
     }
 }
 
+/**
+ * calculateChiefRayNewton() の共有版（歪曲・非点収差・像面湾曲が同じフィールド・波長の主光線を使い回す）
+ * 光学系の内容シグネチャ + フィールド + 波長 + options をキーに evaluation/analysis-cache.js に保持する
+ */
+export function calculateChiefRayNewtonCached(opticalSystemRows, fieldSetting, wavelength = 0.5876, rayType = 'unified', options = {}) {
+    return getOrComputeAnalysisSync(
+        'chief-ray',
+        opticalSystemRows,
+        { fieldSetting, wavelength, rayType, options },
+        () => calculateChiefRayNewton(opticalSystemRows, fieldSetting, wavelength, rayType, options)
+    );
+}
+
 /**
  * 十字光線の詳細分類を行う
  * @param {Array} rays - 光線配列
@@ -0,0 +1,442 @@
+/**
+ * Adaptive Pupil Sampling
+ * 瞳の適応サンプリング（OPD・横収差の曲率が大きい所とケラレ・瞳縁だけを細かくする）
+ *
+ * 固定格子（gridSize² / ringCount × rayNumber）は収差が滑らかな瞳中央にも縁と同じ密度で光線を使う。
+ * ここでは単位円瞳 [-1, 1]² を粗い四分木から始め、セルごとに
+ *   - 4 隅の双一次補間と、辺の中点・中心の実測値のずれ（tolerance 単位）
+ *   - 有効 / 無効（ケラレ・瞳外）が混在するか
+ * を見て、どちらかに当たるセルだけを 4 分割する。中点・中心は子セルの隅になるので追跡し直さない。
+ *
+ * - 評価関数は evaluate(uv) → { values, valid }（同期 / Promise）。1 ラウンドの新しい点をまとめて渡す
+ * - 結果の weights は葉セルごとの Simpson 重み（面積込み）。statistics() の平均・RMS は固定格子の
+ *   点数平均の代わりにこれを使う（密な所に偏らない）
+ * - toRayData() は PSFCalculator / PSFWasmWrapper の opdData.rayData（散布点）形式。散布点の補間は
+ *   interpolate_opd_grid（バケット索引）が行い、opdInterpolation: 'barycentric' で点間が線形になる
+ *
+ * 評価関数:
+ * - createWasmOPDEvaluator(): trace_opd_points_rt10（traceOPDGridWasm と同じ瞳定義・参照球, µm）
+ * - createOPDCalculatorEvaluator(): OpticalPathDifferenceCalculator.calculateOPD（wavefront.js, µm）
+ * - createTransverseRayEvaluator(): traceRaysBatch の評価面交点 (x, y)（スポットの横収差）
+ */
+
+import { isOPDPointsWasmAvailable, traceOPDPointsWasm, traceRaysBatch } from '../raytracing/core/ray-batch-trace.js';
+
+const DEFAULT_INITIAL_LEVEL = 3;   // 8 × 8 セル
+const DEFAULT_MAX_LEVEL = 7;       // 128 × 128 セル（最小間隔は 257² 格子と同じ）
+const DEFAULT_MAX_RAYS = 4096;
+const MAX_LEVEL_LIMIT = 10;
+const EDGE_PRIORITY = 1e3;         // ケラレ・瞳縁のセルの優先度（誤差推定の代わり）
+
+// Simpson 重み（隅 1, 辺 4, 中心 16）/ 36
+const SIMPSON_CORNER = 1 / 36;
+const SIMPSON_EDGE = 4 / 36;
+const SIMPSON_CENTER = 16 / 36;
+
+function normalizeTolerance(tolerance, components) {
+    const tol = new Float64Array(components);
+    for (let c = 0; c < components; c++) {
+        const t = Array.isArray(tolerance) || ArrayBuffer.isView(tolerance) ? Number(tolerance[c]) : Number(tolerance);
+        tol[c] = (Number.isFinite(t) && t > 0) ? t : 0.005;
+    }
+    return tol;
+}
+
+/**
+ * 細分化の本体（ジェネレータ）。新しい点の uv を yield し、その評価結果を next() で受け取る。
+ * 同期版・非同期版はこれを回すだけ。
+ */
+function* adaptiveRounds(options) {
+    const components = Math.max(1, Math.floor(Number(options?.components) || 1));
+    const tol = normalizeTolerance(options?.tolerance, components);
+    const maxLevel = Math.max(1, Math.min(MAX_LEVEL_LIMIT, Math.floor(Number(options?.maxLevel) || DEFAULT_MAX_LEVEL)));
+    const initialLevel = Math.max(1, Math.min(maxLevel, Math.floor(Number(options?.initialLevel) || DEFAULT_INITIAL_LEVEL)));
+    const maxRays = Math.max(16, Math.floor(Number(options?.maxRays) || DEFAULT_MAX_RAYS));
+    const refineEdges = options?.refineEdges !== false;
+
+    // 格子点は最細レベルの辺中点まで表せる整数座標（0..N）で持つ
+    const N = 1 << (maxLevel + 1);
+    const toPupil = (i) => (2 * i) / N - 1;
+    const index = new Map();
+    let pu = new Float64Array(1024), pv = new Float64Array(1024);
+    let vals = new Float64Array(1024 * components);
+    let ok = new Uint8Array(1024);
+    let keys = new Float64Array(1024);
+    let count = 0;
+    let traced = 0;
+
+    const ensure = (n) => {
+        if (n <= pu.length) return;
+        const cap = Math.max(n, pu.length * 2);
+        const grow = (a, len) => { const b = new a.constructor(len); b.set(a); return b; };
+        pu = grow(pu, cap); pv = grow(pv, cap); ok = grow(ok, cap); keys = grow(keys, cap);
+        vals = grow(vals, cap * components);
+    };
+
+    // ix, iy の点の番号（無ければ登録して pending に積む）
+    const pointAt = (ix, iy, pending) => {
+        const key = iy * (N + 1) + ix;
+        let k = index.get(key);
+        if (k === undefined) {
+            k = count++;
+            ensure(count);
+            index.set(key, k);
+            keys[k] = key;
+            pu[k] = toPupil(ix);
+            pv[k] = toPupil(iy);
+            ok[k] = 0;
+            if (pu[k] * pu[k] + pv[k] * pv[k] <= 1 + 1e-12) pending.push(k);
+        }
+        return k;
+    };
+
+    // セル: [ix, iy] から s（格子単位）の正方形。9 点（隅・辺中点・中心）の番号を持つ
+    const cellPoints = (ix, iy, s, pending) => {
+        const h = s >> 1;
+        const p = new Int32Array(9);
+        let q = 0;
+        for (let b = 0; b <= 2; b++) {
+            for (let a = 0; a <= 2; a++) p[q++] = pointAt(ix + a * h, iy + b * h, pending);
+        }
+        return p;
+    };
+
+    const evaluatePending = function* (pending) {
+        if (pending.length === 0) return;
+        const uv = new Float64Array(pending.length * 2);
+        for (let t = 0; t < pending.length; t++) {
+            uv[2 * t] = pu[pending[t]];
+            uv[2 * t + 1] = pv[pending[t]];
+        }
+        const res = yield uv;
+        traced += pending.length;
+        const rv = res?.values, rok = res?.valid;
+        for (let t = 0; t < pending.length; t++) {
+            const k = pending[t];
+            let good = !!(rok ? rok[t] : true);
+            for (let c = 0; c < components; c++) {
+                const v = rv ? Number(rv[t * components + c]) : NaN;
+                vals[k * components + c] = v;
+                if (!Number.isFinite(v)) good = false;
+            }
+            ok[k] = good ? 1 : 0;
+        }
+    };
+
+    // 9 点のずれ（tolerance 単位, 双一次補間との差の最大）。混在セルは -1
+    const cellError = (p) => {
+        let nValid = 0;
+        for (let q = 0; q < 9; q++) nValid += ok[p[q]];
+        if (nValid === 0) return 0;
+        if (nValid < 9) return -1;
+        let e = 0;
+        for (let c = 0; c < components; c++) {
+            const f = (q) => vals[p[q] * components + c];
+            const f00 = f(0), f20 = f(2), f02 = f(6), f22 = f(8);
+            const d = [
+                f(1) - 0.5 * (f00 + f20),
+                f(3) - 0.5 * (f00 + f02),
+                f(5) - 0.5 * (f20 + f22),
+                f(7) - 0.5 * (f02 + f22),
+                f(4) - 0.25 * (f00 + f20 + f02 + f22)
+            ];
+            for (let t = 0; t < d.length; t++) e = Math.max(e, Math.abs(d[t]) / tol[c]);
+        }
+        return e;
+    };
+
+    // 初期セル（単位円と交わるものだけ）
+    const s0 = N >> initialLevel;
+    let active = [];
+    {
+        const pending = [];
+        for (let iy = 0; iy < N; iy += s0) {
+            for (let ix = 0; ix < N; ix += s0) {
+                const x0 = toPupil(ix), x1 = toPupil(ix + s0), y0 = toPupil(iy), y1 = toPupil(iy + s0);
+                const nx = Math.max(x0, Math.min(0, x1)), ny = Math.max(y0, Math.min(0, y1));
+                if (nx * nx + ny * ny > 1) continue;
+                active.push({ ix, iy, s: s0, level: initialLevel, p: cellPoints(ix, iy, s0, pending) });
+            }
+        }
+        yield* evaluatePending(pending);
+    }
+
+    const leaves = [];
+    let finestLevel = initialLevel;
+    while (active.length > 0) {
+        const candidates = [];
+        for (const cell of active) {
+            const e = cellError(cell.p);
+            const refine = cell.level < maxLevel && (e > 1 || (e < 0 && refineEdges));
+            if (!refine) {
+                leaves.push(cell);
+                continue;
+            }
+            const area = (cell.s / N) * (cell.s / N);
+            cell.priority = (e < 0 ? EDGE_PRIORITY : Math.min(e, EDGE_PRIORITY)) * area;
+            candidates.push(cell);
+        }
+        if (candidates.length === 0) break;
+        candidates.sort((a, b) => b.priority - a.priority);
+
+        // 予算内で優先度の高い順に分割（新しく追跡する点数で数える）
+        const pending = [];
+        const next = [];
+        for (let t = 0; t < candidates.length; t++) {
+            const cell = candidates[t];
+            const before = pending.length;
+            const mark = count;
+            const h = cell.s >> 1;
+            const children = [];
+            for (let b = 0; b < 2; b++) {
+                for (let a = 0; a < 2; a++) {
+                    const cx = cell.ix + a * h, cy = cell.iy + b * h;
+                    children.push({ ix: cx, iy: cy, s: h, level: cell.level + 1, p: cellPoints(cx, cy, h, pending) });
+                }
+            }
+            if (traced + pending.length > maxRays) {
+                // 取り消し（このセルで登録した点は末尾にあるので巻き戻せる）
+                for (let k = mark; k < count; k++) index.delete(keys[k]);
+                count = mark;
+                pending.length = before;
+                for (let r = t; r < candidates.length; r++) leaves.push(candidates[r]);
+                break;
+            }
+            next.push(...children);
+            finestLevel = Math.max(finestLevel, cell.level + 1);
+        }
+        yield* evaluatePending(pending);
+        active = next;
+    }
+
+    // 葉セルの Simpson 重み（面積 = (2s / N)²）。無効な点の分は捨てる
+    const weights = new Float64Array(count);
+    const simpson = [SIMPSON_CORNER, SIMPSON_EDGE, SIMPSON_CORNER, SIMPSON_EDGE, SIMPSON_CENTER,
+        SIMPSON_EDGE, SIMPSON_CORNER, SIMPSON_EDGE, SIMPSON_CORNER];
+    for (const cell of leaves) {
+        const area = (2 * cell.s / N) * (2 * cell.s / N);
+        for (let q = 0; q < 9; q++) {
+            const k = cell.p[q];
+            if (ok[k]) weights[k] += simpson[q] * area;
+        }
+    }
+
+    return createAdaptiveResult({
+        components,
+        count,
+        u: pu.slice(0, count),
+        v: pv.slice(0, count),
+        values: vals.slice(0, count * components),
+        valid: ok.slice(0, count),
+        weights,
+        rayCount: traced,
+        leafCount: leaves.length,
+        finestLevel,
+        equivalentGridSize: (1 << finestLevel) * 2 + 1
+    });
+}
+
+function createAdaptiveResult(r) {
+    return {
+        ...r,
+        /**
+         * 重み付き平均・RMS（平均まわり）・PV
+         * @param {number} [component=0]
+         */
+        statistics(component = 0) {
+            const k = r.components;
+            let w = 0, m = 0, min = Infinity, max = -Infinity;
+            for (let i = 0; i < r.count; i++) {
+                if (!r.valid[i]) continue;
+                const x = r.values[i * k + component];
+                min = Math.min(min, x);
+                max = Math.max(max, x);
+                if (!(r.weights[i] > 0)) continue;
+                w += r.weights[i];
+                m += r.weights[i] * x;
+            }
+            if (!(w > 0)) return { mean: NaN, rms: NaN, pv: NaN, weightSum: 0 };
+            m /= w;
+            let s = 0;
+            for (let i = 0; i < r.count; i++) {
+                if (!r.valid[i] || !(r.weights[i] > 0)) continue;
+                const d = r.values[i * k + component] - m;
+                s += r.weights[i] * d * d;
+            }
+            return { mean: m, rms: Math.sqrt(s / w), pv: max - min, weightSum: w };
+        },
+        /**
+         * 2 成分（横収差 x, y）の重心と RMS 半径（重心まわり）
+         */
+        radialStatistics(cx = 0, cy = 1) {
+            const k = r.components;
+            let w = 0, mx = 0, my = 0;
+            for (let i = 0; i < r.count; i++) {
+                if (!r.valid[i] || !(r.weights[i] > 0)) continue;
+                w += r.weights[i];
+                mx += r.weights[i] * r.values[i * k + cx];
+                my += r.weights[i] * r.values[i * k + cy];
+            }
+            if (!(w > 0)) return { centroidX: NaN, centroidY: NaN, rmsRadius: NaN, weightSum: 0 };
+            mx /= w;
+            my /= w;
+            let s = 0;
+            for (let i = 0; i < r.count; i++) {
+                if (!r.valid[i] || !(r.weights[i] > 0)) continue;
+                const dx = r.values[i * k + cx] - mx, dy = r.values[i * k + cy] - my;
+                s += r.weights[i] * (dx * dx + dy * dy);
+            }
+            return { centroidX: mx, centroidY: my, rmsRadius: Math.sqrt(s / w), weightSum: w };
+        },
+        /**
+         * opdData.rayData 形式（有効な点のみ）
+         * @param {number} [component=0]
+         * @param {number} [pupilScale=1] pupilX / pupilY に掛ける係数（wavefront.js の pupilRange など）
+         */
+        toRayData(component = 0, pupilScale = 1) {
+            const out = [];
+            for (let i = 0; i < r.count; i++) {
+                if (!r.valid[i]) continue;
+                out.push({ pupilX: r.u[i] * pupilScale, pupilY: r.v[i] * pupilScale, opd: r.values[i * r.components + component], isVignetted: false });
+            }
+            return out;
+        }
+    };
+}
+
+/**
+ * 適応サンプリング（同期版）
+ *
+ * @param {(uv: Float64Array) => {values: ArrayLike<number>, valid?: ArrayLike<number>}} evaluate
+ *   新しい点の瞳座標（u0, v0, u1, ...）を受け取り、点ごとに components 個の値（点順に連続）と有効フラグを返す。
+ *   非有限の値は無効扱い
+ * @param {Object} [options]
+ * @param {number} [options.components=1] 1 点あたりの値の数（OPD = 1, 横収差 = 2）
+ * @param {number|number[]} [options.tolerance=0.005] 成分ごとの許容ずれ（値と同じ単位。OPD µm なら λ/100 程度）
+ * @param {number} [options.initialLevel=3] 初期セル（2^level 分割）
+ * @param {number} [options.maxLevel=7] 最大分割レベル
+ * @param {number} [options.maxRays=4096] 追跡する点数の上限（優先度の高いセルから分割する）
+ * @param {boolean} [options.refineEdges=true] ケラレ・瞳縁（有効 / 無効の混在セル）を分割する
+ * @returns {Object} { count, u, v, values, valid, weights, rayCount, leafCount, finestLevel, equivalentGridSize,
+ *   statistics(), radialStatistics(), toRayData() }
+ */
+export function samplePupilAdaptive(evaluate, options = {}) {
+    const it = adaptiveRounds(options);
+    let step = it.next();
+    while (!step.done) step = it.next(evaluate(step.value));
+    return step.value;
+}
+
+/**
+ * 適応サンプリング（非同期版, evaluate は Promise を返してよい）。ラウンドごとに UI へ制御を返す。
+ */
+export async function samplePupilAdaptiveAsync(evaluate, options = {}) {
+    const it = adaptiveRounds(options);
+    let step = it.next();
+    while (!step.done) {
+        const res = await evaluate(step.value);
+        await new Promise((resolve) => setTimeout(resolve, 0));
+        step = it.next(res);
+    }
+    return step.value;
+}
+
+/**
+ * trace_opd_points_rt10 による OPD 評価関数（µm）。WASM が使えなければ null。
+ * @param {Array<Object>} opticalSystemRows
+ * @param {Object} pupil traceOPDGridWasm と同じ瞳定義
+ * @param {Object} [options] traceOPDPointsWasm と同じ
+ */
+export function createWasmOPDEvaluator(opticalSystemRows, pupil, options = {}) {
+    if (!isOPDPointsWasmAvailable()) return null;
+    return (uv) => {
+        const res = traceOPDPointsWasm(opticalSystemRows, pupil, uv, options);
+        if (!res) return { values: new Float64Array(uv.length / 2).fill(NaN), valid: null };
+        return { values: res.opd, valid: res.valid };
+    };
+}
+
+/**
+ * OpticalPathDifferenceCalculator（wavefront.js）による OPD 評価関数（µm, 光線ごとに JS で追跡）。
+ * @param {Object} opdCalculator createOPDCalculator() の戻り値（setReferenceRay 済み）
+ * @param {Object} fieldSetting
+ * @param {Object} [options]
+ * @param {number} [options.pupilRange=1] u, v に掛ける瞳座標の範囲
+ */
+export function createOPDCalculatorEvaluator(opdCalculator, fieldSetting, options = {}) {
+    const range = Number(options?.pupilRange) > 0 ? Number(options.pupilRange) : 1;
+    return (uv) => {
+        const n = uv.length / 2;
+        const values = new Float64Array(n);
+        for (let i = 0; i < n; i++) {
+            const v = Number(opdCalculator.calculateOPD(uv[2 * i] * range, uv[2 * i + 1] * range, fieldSetting));
+            values[i] = Number.isFinite(v) ? v : NaN;
+        }
+        return { values, valid: null };
+    };
+}
+
+/**
+ * 評価面交点 (x, y) の評価関数（スポット・横収差）。traceRaysBatch を 1 ラウンド 1 回呼ぶ。
+ * @param {Array<Object>} opticalSystemRows
+ * @param {(u:number, v:number) => ({pos:{x,y,z}, dir:{x,y,z}}|null)} makeRay 瞳座標 → 入力光線
+ * @param {Object} [options] traceRaysBatch と同じ（maxSurfaceIndex, n0, wavelength）
+ */
+export function createTransverseRayEvaluator(opticalSystemRows, makeRay, options = {}) {
+    return (uv) => {
+        const n = uv.length / 2;
+        const values = new Float64Array(n * 2).fill(NaN);
+        const rays = [];
+        const slot = [];
+        for (let i = 0; i < n; i++) {
+            const ray = makeRay(uv[2 * i], uv[2 * i + 1]);
+            if (!ray) continue;
+            if (options?.wavelength !== undefined && ray.wavelength === undefined) ray.wavelength = options.wavelength;
+            rays.push(ray);
+            slot.push(i);
+        }
+        const hits = rays.length > 0
+            ? traceRaysBatch(opticalSystemRows, rays, { ...options, returnHitPointOnly: true })
+            : [];
+        for (let t = 0; t < slot.length; t++) {
+            const h = hits[t];
+            if (!h || !Number.isFinite(h.x) || !Number.isFinite(h.y)) continue;
+            values[slot[t] * 2] = h.x;
+            values[slot[t] * 2 + 1] = h.y;
+        }
+        return { values, valid: null };
+    };
+}
+
+/**
+ * PSF 入力（opdData.rayData）を適応サンプリングで作る。OPD は createOPDCalculatorEvaluator（単位円瞳, µm）。
+ * opdCalculator は基準光線を設定済みであること（generateWavefrontMap() の後など）。
+ *
+ * @param {Object} opdCalculator createOPDCalculator() の戻り値
+ * @param {Object} fieldSetting
+ * @param {Object} [options]
+ * @param {number} [options.gridSize=64] 置き換える固定格子の一辺。光線数の上限（円内の格子点数）と最小間隔をこれに合わせる
+ * @param {number} [options.tolerance=0.005] OPD の許容ずれ（µm）
+ * @param {number} [options.minValidPoints=16] 有効点がこれ未満なら null（呼び出し側で固定格子に戻す）
+ * @param {() => void} [options.beforeRound] ラウンドごとに呼ぶ（中断するなら例外を投げる）
+ * @returns {Promise<{rayData: Array<Object>, sampling: Object}|null>}
+ */
+export async function sampleOPDRayDataAdaptive(opdCalculator, fieldSetting, options = {}) {
+    const gridSize = Math.max(8, Math.floor(Number(options?.gridSize) || 64));
+    const minValidPoints = Math.max(1, Math.floor(Number(options?.minValidPoints) || 16));
+    const beforeRound = typeof options?.beforeRound === 'function' ? options.beforeRound : null;
+    const evaluate = createOPDCalculatorEvaluator(opdCalculator, fieldSetting);
+
+    const sampling = await samplePupilAdaptiveAsync((uv) => {
+        if (beforeRound) beforeRound();
+        return evaluate(uv);
+    }, {
+        components: 1,
+        tolerance: options?.tolerance,
+        maxLevel: Math.min(MAX_LEVEL_LIMIT, Math.max(DEFAULT_INITIAL_LEVEL, Math.round(Math.log2(gridSize)))),
+        maxRays: Math.round(Math.PI / 4 * gridSize * gridSize)
+    });
+
+    const rayData = sampling.toRayData(0, 1);
+    return rayData.length >= minValidPoints ? { rayData, sampling } : null;
+}
@@ -0,0 +1,213 @@
+/**
+ * Analysis Cache
+ *
+ * スポット図・横収差・非点収差・歪曲・波面の各パネルは、同じ光学系・同じフィールド・同じ波長でも
+ * それぞれ光線束・主光線・OPD グリッドを一から追跡していた。ここでは計算結果を
+ *   種類 + 光学系シグネチャ（first-order-cache.js と同じ内容ハッシュ）+ 大域モード（Force stop/entrance pupil）
+ *   + パラメータ（フィールド・波長・サンプリング）
+ * をキーに保持し、2 つ目のパネルや再描画では追跡をやり直さない。
+ *
+ * - 遅延評価: 初めて要求されたときだけ compute() を呼ぶ。同じキーの計算中に来た要求は同じ Promise を待つ
+ * - 無効化: core/undo-history.js が編集（record / undo / redo / clear）を通知したら全エントリを捨てる。
+ *   undo を経由しない変更（オプティマイザなど）でもシグネチャが変わるので古い結果は使われない
+ * - 結果は structuredClone で保持・返却する（描画側が書き換えてもキャッシュは壊れない）。
+ *   複製できない結果（関数を含むなど）はキャッシュしない
+ * - 件数上限つきの LRU（Map の挿入順）
+ */
+
+import { computeFirstOrderSignature } from '../raytracing/core/first-order-cache.js';
+
+const MAX_ENTRIES = 48;
+
+// key → { value?, pending?: Promise, revision }
+const entries = new Map();
+const stats = { hits: 0, misses: 0, invalidations: 0 };
+let revision = 0;
+let attachedHistory = null;
+let detachHistory = null;
+
+function snapshot(value) {
+    if (value === null || typeof value !== 'object') return { ok: true, value };
+    if (typeof structuredClone !== 'function') return { ok: false };
+    try {
+        return { ok: true, value: structuredClone(value) };
+    } catch (_) {
+        return { ok: false };
+    }
+}
+
+function paramsKey(params) {
+    if (params === undefined || params === null) return '';
+    try {
+        return JSON.stringify(params, (_, v) => {
+            if (typeof v === 'function') return undefined;
+            if (typeof v === 'number' && !Number.isFinite(v)) return String(v);
+            if (ArrayBuffer.isView(v)) return Array.from(v);
+            return v;
+        });
+    } catch (_) {
+        return null;
+    }
+}
+
+// 光学系・パラメータの外で結果を変える大域設定（Force stop/entrance pupil: wavefront.js _getForcedInfinitePupilMode と同じ読み方）
+function globalModeKey() {
+    let mode = '';
+    try {
+        const v = globalThis?.__COOPT_FORCE_INFINITE_PUPIL_MODE ?? globalThis?.COOPT_FORCE_INFINITE_PUPIL_MODE
+            ?? globalThis?.localStorage?.getItem?.('coopt.forceInfinitePupilMode');
+        const s = (typeof v === 'string') ? v.trim().toLowerCase() : '';
+        if (s === 'stop' || s === 'entrance') mode = s;
+    } catch (_) {}
+    return `pupil=${mode}`;
+}
+
+function ensureUndoHistoryAttached() {
+    if (typeof window === 'undefined') return;
+    const history = window.undoHistory;
+    if (!history || history === attachedHistory || typeof history.addChangeListener !== 'function') return;
+    if (detachHistory) detachHistory();
+    attachedHistory = history;
+    detachHistory = history.addChangeListener(() => invalidateAnalysisCache('undo-history'));
+}
+
+/**
+ * 解析キャッシュのキー（光学系が空・パラメータが文字列化できない場合は null = キャッシュしない）
+ * @param {string} kind 解析の種類（'spot', 'transverse', 'chief-ray', 'wavefront-map' など）
+ * @param {Array<Object>} opticalSystemRows
+ * @param {Object} params フィールド・波長・サンプリングなど結果を決めるもの（関数は無視）
+ * @returns {string|null}
+ */
+export function getAnalysisCacheKey(kind, opticalSystemRows, params) {
+    if (!Array.isArray(opticalSystemRows) || opticalSystemRows.length === 0) return null;
+    const p = paramsKey(params);
+    if (p === null) return null;
+    return `${kind}|${computeFirstOrderSignature(opticalSystemRows)}|${globalModeKey()}|${p}`;
+}
+
+function touch(key, entry) {
+    entries.delete(key);
+    entries.set(key, entry);
+    while (entries.size > MAX_ENTRIES) entries.delete(entries.keys().next().value);
+}
+
+function store(key, startRevision, result) {
+    // 計算中に編集が入ったら結果は残さない（呼び出し元にはそのまま返す）
+    if (startRevision !== revision) {
+        entries.delete(key);
+        return;
+    }
+    const snap = snapshot(result);
+    if (snap.ok) touch(key, { value: snap.value, revision });
+    else entries.delete(key);
+}
+
+function cachedValue(entry) {
+    const snap = snapshot(entry.value);
+    return snap.ok ? snap.value : entry.value;
+}
+
+/**
+ * キャッシュにあれば複製を返し、なければ compute() を実行して保持する（非同期版）
+ * @param {string} kind
+ * @param {Array<Object>} opticalSystemRows
+ * @param {Object} params
+ * @param {() => Promise<any>|any} compute
+ * @param {{onHit?: Function}} [options] onHit: キャッシュから返すとき（進捗表示の完了通知など）
+ * @returns {Promise<any>}
+ */
+export async function getOrComputeAnalysis(kind, opticalSystemRows, params, compute, options = {}) {
+    ensureUndoHistoryAttached();
+    const key = getAnalysisCacheKey(kind, opticalSystemRows, params);
+    if (key === null) return compute();
+
+    const entry = entries.get(key);
+    if (entry && Object.prototype.hasOwnProperty.call(entry, 'value')) {
+        stats.hits++;
+        touch(key, entry);
+        try { options?.onHit?.(); } catch (_) {}
+        return cachedValue(entry);
+    }
+    if (entry && entry.pending) {
+        stats.hits++;
+        const result = await entry.pending;
+        const done = entries.get(key);
+        return (done && Object.prototype.hasOwnProperty.call(done, 'value')) ? cachedValue(done) : result;
+    }
+
+    stats.misses++;
+    const startRevision = revision;
+    const pending = (async () => compute())();
+    entries.set(key, { pending, revision: startRevision });
+    try {
+        const result = await pending;
+        if (result === null || result === undefined) entries.delete(key);
+        else store(key, startRevision, result);
+        return result;
+    } catch (error) {
+        entries.delete(key);
+        throw error;
+    }
+}
+
+/**
+ * getOrComputeAnalysis() の同期版（主光線など同期 API 用）
+ */
+export function getOrComputeAnalysisSync(kind, opticalSystemRows, params, compute) {
+    ensureUndoHistoryAttached();
+    const key = getAnalysisCacheKey(kind, opticalSystemRows, params);
+    if (key === null) return compute();
+
+    const entry = entries.get(key);
+    if (entry && Object.prototype.hasOwnProperty.call(entry, 'value')) {
+        stats.hits++;
+        touch(key, entry);
+        return cachedValue(entry);
+    }
+    stats.misses++;
+    const result = compute();
+    if (result !== null && result !== undefined) store(key, revision, result);
+    return result;
+}
+
+/**
+ * キャッシュから返すときに、compute() が最後に出していた進捗通知を同じ順で出し直す onHit を作る
+ * （進捗バー・ストリーミング表示が「完了」を受け取れるように）
+ * @param {Function|null} onProgress compute() に渡している進捗コールバック
+ * @param {Array<{percent:number, message:string}>} [stages] 完了までの通知（既定: 100% 'Done (cached)'）
+ * @returns {Function|undefined} getOrComputeAnalysis() の options.onHit
+ */
+export function replayProgressOnHit(onProgress, stages = [{ percent: 100, message: 'Done (cached)' }]) {
+    if (typeof onProgress !== 'function') return undefined;
+    return () => {
+        for (const stage of stages) {
+            try { onProgress({ ...stage, cached: true }); } catch (_) {}
+        }
+    };
+}
+
+/**
+ * 全エントリを捨てる（undo-history の編集通知、設定切り替えなど）
+ * @param {string} [reason]
+ */
+export function invalidateAnalysisCache(reason = 'manual') {
+    revision++;
+    entries.clear();
+    stats.invalidations++;
+    if (typeof globalThis !== 'undefined' && globalThis.__COOPT_ANALYSIS_CACHE_DEBUG === true) {
+        console.log(`🗑️ [AnalysisCache] invalidated (${reason}), revision=${revision}`);
+    }
+}
+
+export function getAnalysisCacheRevision() {
+    return revision;
+}
+
+/**
+ * @returns {{hits:number, misses:number, invalidations:number, entries:number, revision:number}}
+ */
+export function getAnalysisCacheStats() {
+    return { ...stats, entries: entries.size, revision };
+}
+
+ensureUndoHistoryAttached();
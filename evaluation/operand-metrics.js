@@ -0,0 +1,336 @@
+/**
+ * Operand Metrics (DOM-free)
+ * 近軸諸量・Seidel 合計のオペランド評価本体
+ *
+ * System Evaluation Editor（merit-function-editor.js）と最適化のメリットワーカー
+ * （optimization/merit-eval-worker.js）が同じ実装を使うための切り出し。
+ * UI テーブル・localStorage には触れない。光学系行・Source/Object 行は呼び出し側が渡す。
+ *
+ * - computePrimarySystemMetrics(): FL/EFL/BFL/IMD/... の一括計算（System Data と同じ定義）
+ * - computeSeidelTotal(): TOT3_* / TOT_LCA / TOT_TCA（Mode リストの RMS 合成を含む）
+ */
+
+import { findStopSurfaceIndex } from '../raytracing/core/ray-paraxial.js';
+import { getFullSystemParaxialTrace, getParaxialData } from '../raytracing/core/first-order-cache.js';
+import { calculateSeidelCoefficients } from './aberrations/seidel-coefficients.js';
+import { calculateAfocalSeidelCoefficientsIntegrated } from './aberrations/seidel-coefficients-afocal.js';
+
+const DEFAULT_WAVELENGTH_UM = 0.5875618;
+
+// calculatePrimarySystemMetric() が扱うキー（オペランド名と同じ）
+export const PRIMARY_SYSTEM_METRIC_KEYS = Object.freeze([
+    'FL', 'BFL', 'IMD', 'OBJD', 'TSL', 'BEXP', 'EXPD', 'EXPP', 'ENPD', 'ENPP', 'ENPM',
+    'PMAG', 'FNO_OBJ', 'FNO_IMG', 'FNO_WRK', 'NA_OBJ', 'NA_IMG'
+]);
+
+// Seidel 合計オペランド → totals のキー
+export const SEIDEL_TOTAL_OPERANDS = Object.freeze({
+    TOT3_SPH: 'I',
+    TOT3_COMA: 'II',
+    TOT3_ASTI: 'III',
+    TOT3_FCUR: 'IV',
+    TOT3_DIST: 'V',
+    TOT_LCA: 'LCA',
+    TOT_TCA: 'TCA'
+});
+
+export function safeFiniteNumberOrZero(v) {
+    const n = Number(v);
+    return Number.isFinite(n) ? n : 0;
+}
+
+export function getWavelengthFromSourceRows(sourceRows, sourceIndex1Based) {
+    const idx = Number.isFinite(Number(sourceIndex1Based)) ? Math.floor(Number(sourceIndex1Based)) : 1;
+    const index0 = Math.max(0, idx - 1);
+    const row = Array.isArray(sourceRows) ? sourceRows[index0] : null;
+    const wl = row ? Number(row.wavelength) : NaN;
+    return (Number.isFinite(wl) && wl > 0) ? wl : DEFAULT_WAVELENGTH_UM;
+}
+
+export function getPrimaryWavelengthFromSourceRows(sourceRows) {
+    if (!Array.isArray(sourceRows) || sourceRows.length === 0) return DEFAULT_WAVELENGTH_UM;
+    const primaryRow = sourceRows.find(r => r && r.primary && String(r.primary).toLowerCase().includes('primary'));
+    const wl = primaryRow ? Number(primaryRow.wavelength) : NaN;
+    if (Number.isFinite(wl) && wl > 0) return wl;
+    // フォールバック: 1行目
+    const wl0 = Number(sourceRows[0]?.wavelength);
+    return (Number.isFinite(wl0) && wl0 > 0) ? wl0 : DEFAULT_WAVELENGTH_UM;
+}
+
+export function getSystemWavelengthFromOperandOrPrimary(operand, sourceRows) {
+    const raw = (operand && operand.param1 !== undefined && operand.param1 !== null) ? String(operand.param1).trim() : '';
+    if (raw === '') return getPrimaryWavelengthFromSourceRows(sourceRows);
+
+    const n = Number(raw);
+    if (!Number.isFinite(n) || n <= 0) return getPrimaryWavelengthFromSourceRows(sourceRows);
+
+    // Backward compatible behavior: most operands historically used "λ idx" (Source row number).
+    // In practice, users often type the wavelength value itself (e.g. 0.4861, 0.5876, 0.6563).
+    // If we treat 0.4861 as an index, Math.floor() -> 0, and we incorrectly fall back to Primary.
+    // Heuristic:
+    // - n < 1 : almost certainly wavelength in µm
+    // - non-integer with '.' or 'e' : treat as wavelength in µm
+    const s = raw.toLowerCase();
+    const isNonIntegerLiteral = (s.includes('.') || s.includes('e')) && Math.abs(n - Math.round(n)) > 1e-12;
+    const looksLikeWavelengthUm = (n < 1) || isNonIntegerLiteral;
+    if (looksLikeWavelengthUm) return n;
+
+    const idx1 = Math.floor(n);
+    if (idx1 > 0) return getWavelengthFromSourceRows(sourceRows, idx1);
+    return getPrimaryWavelengthFromSourceRows(sourceRows);
+}
+
+export function computeTotalSystemLengthMm(opticalSystemData) {
+    if (!Array.isArray(opticalSystemData) || opticalSystemData.length === 0) return 0;
+    let total = 0;
+    for (const row of opticalSystemData) {
+        const tRaw = row ? row.thickness : undefined;
+        if (tRaw === undefined || tRaw === null) continue;
+        const s = String(tRaw).trim().toUpperCase();
+        if (s === 'INF' || s === 'INFINITY') continue;
+        const t = Number(tRaw);
+        if (Number.isFinite(t)) total += t;
+    }
+    return total;
+}
+
+export function computeObjectDistanceMm(opticalSystemData) {
+    const tRaw = opticalSystemData?.[0]?.thickness;
+    if (tRaw === undefined || tRaw === null) return 0;
+    const s = String(tRaw).trim().toUpperCase();
+    if (s === 'INF' || s === 'INFINITY') return 0;
+    const t = Number(tRaw);
+    return Number.isFinite(t) ? t : 0;
+}
+
+/**
+ * 近軸諸量を一括で求める（System Data と同じ定義、非有限値は 0）
+ * @param {Array} opticalSystemData - 光学系行
+ * @param {number} wavelength - 波長（μm）
+ * @returns {Record<string, number>} PRIMARY_SYSTEM_METRIC_KEYS + EFL
+ */
+export function computePrimarySystemMetrics(opticalSystemData, wavelength) {
+    const paraxial = getParaxialData(opticalSystemData, wavelength);
+
+    const fl = safeFiniteNumberOrZero(paraxial?.focalLength);
+    const bfl = safeFiniteNumberOrZero(paraxial?.backFocalLength);
+    const imd = safeFiniteNumberOrZero(paraxial?.imageDistance);
+    const finalAlpha = Number(paraxial?.finalAlpha);
+
+    // EFL (System Data): EFL = 1 / alpha(final) with h[1]=1
+    const eflTrace = getFullSystemParaxialTrace(opticalSystemData, wavelength);
+    const efl = (eflTrace && Number.isFinite(eflTrace.finalAlpha) && Math.abs(eflTrace.finalAlpha) > 1e-12)
+        ? (1.0 / eflTrace.finalAlpha)
+        : 0;
+
+    const totalLength = computeTotalSystemLengthMm(opticalSystemData);
+    const objd = computeObjectDistanceMm(opticalSystemData);
+
+    const exitPupilDetails = paraxial?.exitPupilDetails;
+    const newSpecPupils = paraxial?.newSpecPupils;
+    const exitPupil = newSpecPupils?.exitPupil;
+    const entrancePupil = newSpecPupils?.entrancePupil;
+
+    // Prefer new method details if available
+    const expd = safeFiniteNumberOrZero(exitPupilDetails?.diameter ?? exitPupil?.diameter ?? paraxial?.exitPupilDiameter);
+    const exPosOrigin = safeFiniteNumberOrZero(exitPupilDetails?.position ?? exitPupil?.position);
+    const exppFromImage = (Number.isFinite(exPosOrigin) && Number.isFinite(imd)) ? (exPosOrigin - imd) : 0;
+
+    // βexp: prefer explicit betaExp, else magnification
+    const betaExpRaw = (typeof exitPupil?.betaExp === 'number') ? exitPupil.betaExp
+        : (typeof exitPupilDetails?.betaExp === 'number') ? exitPupilDetails.betaExp
+        : (typeof exitPupilDetails?.magnification === 'number') ? exitPupilDetails.magnification
+        : (typeof exitPupil?.magnification === 'number') ? exitPupil.magnification
+        : NaN;
+    const betaExp = safeFiniteNumberOrZero(betaExpRaw);
+
+    const enpd = safeFiniteNumberOrZero(entrancePupil?.diameter ?? paraxial?.entrancePupilDiameter);
+    const enpp = safeFiniteNumberOrZero(entrancePupil?.position);
+    const enpm = safeFiniteNumberOrZero(entrancePupil?.magnification);
+
+    // Paraxial magnification (finite object): beta = alpha[1]/alpha[final], alpha[1] = -1/objd (h[1]=1, n=1)
+    let pmag = 0;
+    if (objd > 0 && Number.isFinite(finalAlpha) && Math.abs(finalAlpha) > 1e-12) {
+        const initialAlpha = -1.0 / objd;
+        pmag = initialAlpha / finalAlpha;
+    }
+
+    // Working F#: (-ExP + id) / ExPD (using origin position)
+    let fnoWrk = 0;
+    if (Number.isFinite(exPosOrigin) && Number.isFinite(imd) && expd > 0) {
+        fnoWrk = (-exPosOrigin + imd) / expd;
+    }
+
+    // Object Space F# = abs(F#work / beta) if beta != 0
+    let fnoObj = 0;
+    if (Math.abs(pmag) > 1e-12 && Number.isFinite(fnoWrk)) {
+        fnoObj = Math.abs(fnoWrk / pmag);
+    }
+
+    // Image Space F# = f' / EnPD (System Data uses FL)
+    let fnoImg = 0;
+    if (fl > 0 && enpd > 0) {
+        fnoImg = fl / enpd;
+    }
+
+    // NAimg = 1/(2*F#work), NAobj = abs(NAimg * beta)
+    let naImg = 0;
+    let naObj = 0;
+    if (Number.isFinite(fnoWrk) && Math.abs(fnoWrk) > 1e-12) {
+        naImg = 1.0 / (2.0 * fnoWrk);
+        if (Number.isFinite(pmag)) {
+            naObj = Math.abs(naImg * pmag);
+        }
+    }
+
+    return {
+        FL: safeFiniteNumberOrZero(fl),
+        EFL: safeFiniteNumberOrZero(efl),
+        BFL: safeFiniteNumberOrZero(bfl),
+        IMD: safeFiniteNumberOrZero(imd),
+        OBJD: safeFiniteNumberOrZero(objd),
+        TSL: safeFiniteNumberOrZero(totalLength),
+        BEXP: safeFiniteNumberOrZero(betaExp),
+        EXPD: safeFiniteNumberOrZero(expd),
+        EXPP: safeFiniteNumberOrZero(exppFromImage),
+        ENPD: safeFiniteNumberOrZero(enpd),
+        ENPP: safeFiniteNumberOrZero(enpp),
+        ENPM: safeFiniteNumberOrZero(enpm),
+        PMAG: safeFiniteNumberOrZero(pmag),
+        FNO_OBJ: safeFiniteNumberOrZero(fnoObj),
+        FNO_IMG: safeFiniteNumberOrZero(fnoImg),
+        FNO_WRK: safeFiniteNumberOrZero(fnoWrk),
+        NA_OBJ: safeFiniteNumberOrZero(naObj),
+        NA_IMG: safeFiniteNumberOrZero(naImg),
+    };
+}
+
+/**
+ * Seidel係数合計（I/II/III/IV/V/LCA/TCA）を評価値として返す
+ * - param1(λ): Sourceテーブルの行番号（1始まり）
+ * - param2(Mode): 0=imaging, 1=afocal, "0,1" は各 Mode の RMS
+ * - param3(S1): 0 => total, else surface
+ * - param4(Ref FL): blank/0 => Auto
+ * - LCA/TCA: Primary波長に対する差（selected - primary）
+ * @param {Map|null} cache - 同一評価内で使い回すキャッシュ（editor の _runtimeCache と同じキー）
+ */
+export function computeSeidelTotal(operand, opticalSystemData, totalKey, sourceRows, objectRows, cache = null) {
+    if (!opticalSystemData || opticalSystemData.length < 2) return 0;
+
+    // Parse Mode parameter: accept single value (0 or 1) or comma-separated list (e.g., "0,1")
+    const modeRaw = (operand?.param2 !== undefined && operand?.param2 !== null) ? String(operand.param2).trim() : '';
+    const modeList = (() => {
+        if (modeRaw === '') return [0];
+        if (modeRaw.includes(',')) {
+            // Parse comma-separated list
+            return modeRaw.split(',')
+                .map(s => parseInt(s.trim(), 10))
+                .filter(n => n === 0 || n === 1);
+        }
+        const single = parseInt(modeRaw, 10);
+        return (single === 0 || single === 1) ? [single] : [0];
+    })();
+
+    // If list contains multiple modes, compute RMS over all modes
+    if (modeList.length > 1) {
+        let sumSq = 0;
+        for (const mode of modeList) {
+            const value = computeSeidelTotalSingleMode(
+                operand, opticalSystemData, totalKey, sourceRows, objectRows, mode === 1, cache
+            );
+            sumSq += value * value;
+        }
+        return Math.sqrt(sumSq);
+    }
+
+    const mode = modeList[0] || 0;
+    return computeSeidelTotalSingleMode(operand, opticalSystemData, totalKey, sourceRows, objectRows, mode === 1, cache);
+}
+
+export function computeSeidelTotalSingleMode(operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal, cache = null) {
+    // S1 (Context3): 0 => total, else surface
+    const s1Num = Number.isFinite(Number(operand?.param3)) ? Math.floor(Number(operand.param3)) : 0;
+    const s1 = (Number.isFinite(s1Num) && s1Num > 0) ? s1Num : 0;
+
+    // Reference Focal Length (Context4)
+    // - blank => Auto
+    // - 0 => Auto
+    // Imaging: Auto means use calculated FL (ignore textbox)
+    // Afocal: Auto means default unit scale (see afocal module)
+    const refFLRaw = (operand && operand.param4 !== undefined && operand.param4 !== null) ? String(operand.param4).trim() : '';
+    const refFLNum = (refFLRaw === '') ? 0 : Number(refFLRaw);
+    const referenceFocalLengthAfocal = (Number.isFinite(refFLNum) && refFLNum !== 0) ? refFLNum : undefined;
+    const referenceFocalLengthOverrideImaging = (Number.isFinite(refFLNum) && refFLNum !== 0) ? refFLNum : 0;
+
+    const primaryWavelength = getPrimaryWavelengthFromSourceRows(sourceRows);
+
+    // param1 (λ): blank/empty => use Primary wavelength, else use specified wavelength index
+    const param1Raw = (operand && operand.param1 !== undefined && operand.param1 !== null) ? String(operand.param1).trim() : '';
+    const selectedWavelength = (param1Raw === '')
+        ? primaryWavelength
+        : getSystemWavelengthFromOperandOrPrimary(operand, sourceRows);
+
+    // LCA/TCA は System Data の波長設定を使用（operand param1 では指定しない）
+    const baseWavelength = (totalKey === 'LCA' || totalKey === 'TCA') ? primaryWavelength : selectedWavelength;
+
+    // キャッシュキー（同一run内）
+    const cfgKey = operand?.configId ? String(operand.configId) : 'active';
+    const cacheKey = `seidel:${cfgKey}:mode=${isAfocal ? 'afocal' : 'imaging'}:wl=${baseWavelength}:s1=${s1}:refFL=${(isAfocal ? (referenceFocalLengthAfocal ?? 'auto') : (referenceFocalLengthOverrideImaging === 0 ? 'auto' : referenceFocalLengthOverrideImaging))}:key=${totalKey}`;
+    if (cache && cache.has(cacheKey)) {
+        return cache.get(cacheKey);
+    }
+
+    try {
+        let seidel;
+
+        if (isAfocal) {
+            // Stop index (0-based). fallback to 1 like existing afocal handler.
+            let stopIndex = opticalSystemData.findIndex(row => row && (row['object type'] === 'Stop' || row.object === 'Stop'));
+            if (stopIndex === -1) {
+                const fallback = findStopSurfaceIndex ? findStopSurfaceIndex(opticalSystemData) : -1;
+                stopIndex = (fallback >= 0) ? fallback : 1;
+            }
+
+            seidel = calculateAfocalSeidelCoefficientsIntegrated(
+                opticalSystemData,
+                baseWavelength,
+                stopIndex,
+                objectRows,
+                referenceFocalLengthAfocal
+            );
+        } else {
+            // Imaging: match System Data (no chromaticOverrides)
+            seidel = calculateSeidelCoefficients(
+                opticalSystemData,
+                baseWavelength,
+                objectRows,
+                { referenceFocalLengthOverride: referenceFocalLengthOverrideImaging }
+            );
+        }
+
+        let v = NaN;
+        if (s1 === 0) {
+            v = seidel?.totals ? Number(seidel.totals[totalKey]) : NaN;
+        } else {
+            const coeffs = seidel?.surfaceCoefficients;
+            const c = Array.isArray(coeffs)
+                ? (
+                    // Prefer matching by Surf id shown in System Data (row.id)
+                    coeffs.find(sc => sc && Number(opticalSystemData?.[Number(sc.surfaceIndex)]?.id) === Number(s1))
+                    // Fallback: treat S1 as surfaceIndex (array index)
+                    || coeffs.find(sc => sc && Number(sc.surfaceIndex) === Number(s1))
+                  )
+                : null;
+            v = c ? Number(c[totalKey]) : NaN;
+        }
+
+        const value = Number.isFinite(v) ? v : 0;
+
+        if (cache) cache.set(cacheKey, value);
+        return value;
+    } catch (e) {
+        console.warn('⚠️ Seidel total evaluation failed:', e);
+        if (cache) cache.set(cacheKey, 0);
+        return 0;
+    }
+}
@@ -0,0 +1,523 @@
+/**
+ * Operand Ray Metrics (DOM-free)
+ * スポットサイズ・Zernike（OPD）オペランドの評価本体
+ *
+ * System Evaluation Editor（merit-function-editor.js）と最適化のメリットワーカー
+ * （optimization/merit-worker.js）が同じ定義で値を出すための切り出し。
+ * UI テーブル・localStorage・window には触れない。光学系行・Source/Object 行は呼び出し側が渡す。
+ *
+ * - computeSpotSizeStatsUm(): 主光線基準の RMS / 直径 [µm]（Spot Diagram と同じ定義）
+ * - createSpotSizeProbe() / evaluateSpotSizeProbeUm(): メインスレッドで作ったスポット図の開始光線を
+ *   別の光学系（Jacobian 列の摂動系）で追跡し直す。光線エイミングはやり直さない
+ * - evaluateSpotSizeProbeDerivativesUm(): 同じプローブの値と面パラメータに対する解析微分（LM の Jacobian 列）
+ * - resolveZernikeOperandInputs() / computeZernikeFitLive() / zernikeCoefficientFromFit(): ZERN_COEFF
+ */
+
+import { calculateSurfaceOrigins, transformPointToLocal } from '../raytracing/core/ray-tracing.js';
+import { RT10_STATUS, traceRaysBatch, traceRaysBatchDerivatives } from '../raytracing/core/ray-batch-trace.js';
+import { createOPDCalculator, WavefrontAberrationAnalyzer } from './wavefront/wavefront.js';
+import { getSystemWavelengthFromOperandOrPrimary } from './operand-metrics.js';
+
+// calculateSpotSizeUm() が失敗時に返す値（Requirements で NG にするための大きな値）
+export const SPOT_SIZE_FAIL_UM = 1e9;
+
+// Spot Diagram と同じ実装で評価するスポットサイズオペランド
+export const SPOT_SIZE_OPERANDS = Object.freeze(['SPOT_SIZE_ANNULAR', 'SPOT_SIZE_RECT', 'SPOT_SIZE_CURRENT']);
+
+const SPOT_SIZE_OPERAND_SET = new Set(SPOT_SIZE_OPERANDS);
+
+export const ZERNIKE_OPERAND = 'ZERN_COEFF';
+
+// ZERN_COEFF のライブフィットで求める最大 Noll 次数
+export const ZERNIKE_LIVE_MAX_NOLL = 37;
+
+export function isSpotSizeOperand(operand) {
+    return SPOT_SIZE_OPERAND_SET.has(String(operand ?? ''));
+}
+
+function toFiniteNumber(v, fallback = 0) {
+    const n = Number(v);
+    return Number.isFinite(n) ? n : fallback;
+}
+
+/**
+ * param3（Metric）の正規化。空欄は RMS。
+ * @returns {'rms'|'diameter'|string}
+ */
+export function parseSpotSizeMetric(raw) {
+    const metricRaw = (raw === undefined || raw === null) ? '' : String(raw);
+    const metricNorm0 = metricRaw.trim().toLowerCase();
+    const metricNorm = metricNorm0.replace(/[^a-z0-9]/g, '');
+    if (!metricNorm0 || metricNorm === '') return 'rms';
+    if (metricNorm === 'rms' || metricNorm === 'rmstotal' || metricNorm === 'rmsxy' || metricNorm === 'r') return 'rms';
+    if (metricNorm === 'diameter' || metricNorm === 'dia' || metricNorm === 'diam' || metricNorm === 'd') return 'diameter';
+    return metricNorm0;
+}
+
+/**
+ * スポット点（評価面ローカル座標 mm）から主光線基準の RMS / 直径を求める。
+ * 主光線フラグが無いときは Spot Diagram と同じく重心に最も近い点を基準にする。
+ *
+ * @param {Array<{x:number, y:number, isChiefRay?:boolean}>} spotPoints
+ * @returns {{ok:true, chiefFound:boolean, chiefXmm:number, chiefYmm:number, n:number,
+ *   rmsXUm:number, rmsYUm:number, rmsTotalUm:number, diameterUm:number, maxRUm:number}
+ *   | {ok:false, reason:string, n:number}}
+ */
+export function computeSpotSizeStatsUm(spotPoints) {
+    if (!Array.isArray(spotPoints) || spotPoints.length === 0) return { ok: false, reason: 'no-spot-points', n: 0 };
+
+    let chiefPt = spotPoints.find(p => p && p.isChiefRay) || null;
+    const chiefFound = !!chiefPt;
+    if (!chiefPt) {
+        const cx = spotPoints.reduce((sum, p) => sum + Number(p?.x || 0), 0) / spotPoints.length;
+        const cy = spotPoints.reduce((sum, p) => sum + Number(p?.y || 0), 0) / spotPoints.length;
+        let bestIdx = 0;
+        let bestDist = Infinity;
+        for (let i = 0; i < spotPoints.length; i++) {
+            const p = spotPoints[i];
+            const x = Number(p?.x);
+            const y = Number(p?.y);
+            if (!Number.isFinite(x) || !Number.isFinite(y)) continue;
+            const d = Math.hypot(x - cx, y - cy);
+            if (d < bestDist) {
+                bestDist = d;
+                bestIdx = i;
+            }
+        }
+        chiefPt = spotPoints[bestIdx] || spotPoints[0];
+    }
+
+    const chiefX = Number(chiefPt?.x);
+    const chiefY = Number(chiefPt?.y);
+    if (!Number.isFinite(chiefX) || !Number.isFinite(chiefY)) {
+        return { ok: false, reason: 'invalid-chief-point', n: spotPoints.length };
+    }
+
+    let maxRUm = 0;
+    let sumX2 = 0;
+    let sumY2 = 0;
+    let n = 0;
+    for (const p of spotPoints) {
+        const x = Number(p?.x);
+        const y = Number(p?.y);
+        if (!Number.isFinite(x) || !Number.isFinite(y)) continue;
+        const dxUm = (x - chiefX) * 1000;
+        const dyUm = (y - chiefY) * 1000;
+        const rUm = Math.hypot(dxUm, dyUm);
+        if (rUm > maxRUm) maxRUm = rUm;
+        sumX2 += dxUm * dxUm;
+        sumY2 += dyUm * dyUm;
+        n++;
+    }
+    if (n <= 0) return { ok: false, reason: 'no-finite-spot-points', n: 0 };
+
+    const rmsX = Math.sqrt(sumX2 / n);
+    const rmsY = Math.sqrt(sumY2 / n);
+    return {
+        ok: true,
+        chiefFound,
+        chiefXmm: chiefX,
+        chiefYmm: chiefY,
+        n,
+        rmsXUm: rmsX,
+        rmsYUm: rmsY,
+        rmsTotalUm: Math.sqrt(rmsX * rmsX + rmsY * rmsY),
+        diameterUm: 2 * maxRUm,
+        maxRUm
+    };
+}
+
+export function spotSizeValueFromStats(stats, metric) {
+    if (!stats || !stats.ok) return SPOT_SIZE_FAIL_UM;
+    return (metric === 'diameter') ? stats.diameterUm : stats.rmsTotalUm;
+}
+
+/**
+ * generateSpotDiagram() のスポット点から、同じ開始光線を追跡し直すためのプローブを作る。
+ * @param {Array<Object>} spotPoints - spotData[i].spotPoints（startPoint / initialDir を持つ）
+ * @param {number} targetSurfaceIndex - 評価面（0 始まりの行番号）
+ * @param {string} metric - parseSpotSizeMetric() の戻り値
+ * @returns {{targetSurfaceIndex:number, metric:string, rays:Array<{startP,dir,wavelength,isChief}>}|null}
+ */
+export function createSpotSizeProbe(spotPoints, targetSurfaceIndex, metric) {
+    if (!Array.isArray(spotPoints) || !Number.isInteger(targetSurfaceIndex) || targetSurfaceIndex < 0) return null;
+    const rays = [];
+    for (const p of spotPoints) {
+        if (!p || !p.startPoint || !p.initialDir) continue;
+        rays.push({
+            startP: { x: p.startPoint.x, y: p.startPoint.y, z: p.startPoint.z },
+            dir: { x: p.initialDir.x, y: p.initialDir.y, z: p.initialDir.z },
+            wavelength: Number(p.wavelength) || 0.5876,
+            isChief: !!p.isChiefRay
+        });
+    }
+    return rays.length > 0 ? { targetSurfaceIndex, metric: String(metric || 'rms'), rays } : null;
+}
+
+/**
+ * プローブの光線を opticalSystemRows で追跡してスポットサイズ [µm] を返す。
+ * 基準点の光学系ではプローブを作ったスポット図と同じ点・同じ値になる。
+ */
+export function evaluateSpotSizeProbeUm(opticalSystemRows, probe) {
+    if (!Array.isArray(opticalSystemRows) || !probe || !Array.isArray(probe.rays) || probe.rays.length === 0) {
+        return SPOT_SIZE_FAIL_UM;
+    }
+    const target = Math.floor(Number(probe.targetSurfaceIndex));
+    if (!Number.isInteger(target) || target < 0 || target >= opticalSystemRows.length) return SPOT_SIZE_FAIL_UM;
+
+    const rays = probe.rays.map(r => ({ pos: r.startP, dir: r.dir, wavelength: r.wavelength }));
+    const hits = traceRaysBatch(opticalSystemRows, rays, { maxSurfaceIndex: target, returnHitPointOnly: true });
+    const frame = calculateSurfaceOrigins(opticalSystemRows)[target] || null;
+    const points = [];
+    for (let k = 0; k < probe.rays.length; k++) {
+        const hit = hits?.[k];
+        if (!hit) continue;
+        const local = frame ? transformPointToLocal(hit, frame) : hit;
+        if (!local || typeof local.x !== 'number' || typeof local.y !== 'number') continue;
+        points.push({ x: local.x, y: local.y, isChiefRay: probe.rays[k].isChief });
+    }
+    return spotSizeValueFromStats(computeSpotSizeStatsUm(points), probe.metric);
+}
+
+// traceRaysBatchDerivatives() の 1 光線分: [px, py, pz, dx, dy, dz, opl]
+const RAY_DERIV_STRIDE = 7;
+
+/**
+ * evaluateSpotSizeProbeUm() の値と、面パラメータ（radius / thickness / conic / coefN）に対する微分 [µm / 単位]。
+ * traceRaysBatchDerivatives() の 1 回の追跡で求める。主光線基準の差 R_targetᵀ(P_i - P_chief) を微分するので
+ * 評価面の原点移動は打ち消し合う。主光線（または重心に最も近い点）と直径の最大点の選び直しは微分しない。
+ * 評価面より後ろの面のパラメータは値に効かないので 0。
+ *
+ * @param {Array<Object>} opticalSystemRows
+ * @param {Object} probe - createSpotSizeProbe() の戻り値
+ * @param {Array<{surface:number, param:string}>} params - traceRaysBatchDerivatives() と同じ指定
+ * @returns {{value:number, gradient:Float64Array}|null} 微分版 WASM が無い・スポットが作れないときは null
+ */
+export function evaluateSpotSizeProbeDerivativesUm(opticalSystemRows, probe, params) {
+    if (!Array.isArray(opticalSystemRows) || !probe || !Array.isArray(probe.rays) || probe.rays.length === 0) return null;
+    if (!Array.isArray(params)) return null;
+    const target = Math.floor(Number(probe.targetSurfaceIndex));
+    if (!Number.isInteger(target) || target < 0 || target >= opticalSystemRows.length) return null;
+    const frame = calculateSurfaceOrigins(opticalSystemRows)[target] || null;
+    if (!frame || !frame.rotationMatrix) return null;
+    // 微分ベクトル用（回転のみ）
+    const axes = { origin: { x: 0, y: 0, z: 0 }, rotationMatrix: frame.rotationMatrix };
+
+    const active = [];
+    for (let j = 0; j < params.length; j++) {
+        const s = Number(params[j]?.surface);
+        if (Number.isInteger(s) && s <= target) active.push(j);
+    }
+    const gradient = new Float64Array(params.length);
+    if (active.length === 0) {
+        const value = evaluateSpotSizeProbeUm(opticalSystemRows, probe);
+        return (value === SPOT_SIZE_FAIL_UM) ? null : { value, gradient };
+    }
+
+    const rays = probe.rays.map(r => ({ pos: r.startP, dir: r.dir, wavelength: r.wavelength }));
+    const res = traceRaysBatchDerivatives(opticalSystemRows, rays, active.map(j => params[j]), { maxSurfaceIndex: target });
+    if (!res) return null;
+    const P = res.paramCount;
+    const per = P * RAY_DERIV_STRIDE;
+
+    const points = [];
+    const rayOf = [];
+    for (let k = 0; k < probe.rays.length; k++) {
+        if (res.status[k] !== RT10_STATUS.OK) continue;
+        const b = k * RAY_DERIV_STRIDE;
+        const local = transformPointToLocal({ x: res.rays[b], y: res.rays[b + 1], z: res.rays[b + 2] }, frame);
+        if (!Number.isFinite(local.x) || !Number.isFinite(local.y)) continue;
+        points.push({ x: local.x, y: local.y, isChiefRay: probe.rays[k].isChief });
+        rayOf.push(k);
+    }
+    const stats = computeSpotSizeStatsUm(points);
+    if (!stats.ok) return null;
+    const chief = points.findIndex(p => p.x === stats.chiefXmm && p.y === stats.chiefYmm);
+    if (chief < 0) return null;
+
+    // 点 i のパラメータ q に対する主光線基準オフセットの微分 [µm]
+    const offsetDerivUm = (i, q) => {
+        const a = rayOf[i] * per + q * RAY_DERIV_STRIDE;
+        const c = rayOf[chief] * per + q * RAY_DERIV_STRIDE;
+        const d = res.derivatives;
+        const v = transformPointToLocal({ x: d[a] - d[c], y: d[a + 1] - d[c + 1], z: d[a + 2] - d[c + 2] }, axes);
+        return { x: v.x * 1000, y: v.y * 1000 };
+    };
+
+    const value = spotSizeValueFromStats(stats, probe.metric);
+    if (probe.metric === 'diameter') {
+        // 2·max r を最大点で微分する
+        let imax = -1;
+        for (let i = 0; i < points.length; i++) {
+            const r = Math.hypot((points[i].x - stats.chiefXmm) * 1000, (points[i].y - stats.chiefYmm) * 1000);
+            if (r === stats.maxRUm) { imax = i; break; }
+        }
+        if (imax >= 0 && stats.maxRUm > 0) {
+            const dx = (points[imax].x - stats.chiefXmm) * 1000;
+            const dy = (points[imax].y - stats.chiefYmm) * 1000;
+            for (let q = 0; q < P; q++) {
+                const dd = offsetDerivUm(imax, q);
+                gradient[active[q]] = 2 * (dx * dd.x + dy * dd.y) / stats.maxRUm;
+            }
+        }
+    } else if (stats.rmsTotalUm > 0) {
+        // RMS = sqrt(Σ(dx² + dy²) / n)
+        const scale = 1 / (stats.n * stats.rmsTotalUm);
+        for (let q = 0; q < P; q++) {
+            let sum = 0;
+            for (let i = 0; i < points.length; i++) {
+                if (i === chief) continue;
+                const dd = offsetDerivUm(i, q);
+                sum += (points[i].x - stats.chiefXmm) * 1000 * dd.x + (points[i].y - stats.chiefYmm) * 1000 * dd.y;
+            }
+            gradient[active[q]] = sum * scale;
+        }
+    }
+    return { value, gradient };
+}
+
+// --- ZERN_COEFF ---
+
+export function parseZernikeUnit(raw) {
+    const s = String(raw ?? '').trim().toLowerCase();
+    if (!s) return 'waves';
+    if (s === 'waves' || s === 'wave' || s === 'w' || s === 'lambda' || s === 'λ') return 'waves';
+    if (s === 'um' || s === 'µm' || s === 'micron' || s === 'microns') return 'um';
+    return 'waves';
+}
+
+export function isInfiniteSystemFromRows(opticalSystemRows) {
+    const t = opticalSystemRows?.[0]?.thickness;
+    return t === 'INF' || t === 'Infinity' || t === Infinity;
+}
+
+export function toFieldSettingFromObjectRow(objRow, index0, isInfiniteSystem) {
+    const pos = String(objRow?.position ?? objRow?.Position ?? objRow?.type ?? '').toLowerCase();
+    const xVal = toFiniteNumber(objRow?.xHeightAngle, 0);
+    const yVal = toFiniteNumber(objRow?.yHeightAngle, 0);
+
+    const isAngleMode = pos === 'angle' || pos === 'field angle' || pos === 'angles';
+    const isHeightMode = pos === 'rectangle' || pos === 'height' || pos === 'point';
+
+    let fieldAngle = { x: 0, y: 0 };
+    let xHeight = 0;
+    let yHeight = 0;
+    let type = objRow?.position ?? objRow?.type ?? '';
+
+    if (isAngleMode) {
+        fieldAngle = { x: xVal, y: yVal };
+        type = 'Angle';
+    } else if (isHeightMode) {
+        xHeight = xVal;
+        yHeight = yVal;
+        type = 'Rectangle';
+    } else {
+        // Fallback: infer from system type.
+        if (isInfiniteSystem) {
+            fieldAngle = { x: xVal, y: yVal };
+            type = 'Angle';
+        } else {
+            xHeight = xVal;
+            yHeight = yVal;
+            type = 'Rectangle';
+        }
+    }
+
+    return {
+        id: objRow?.id || index0 + 1,
+        type,
+        fieldAngle,
+        xHeight,
+        yHeight,
+        objectIndex: index0
+    };
+}
+
+/**
+ * ZERN_COEFF のパラメータ解釈（λ idx, Object idx, Unit, Sampling, n (Noll)）。
+ * @returns {{wavelength:number, fieldSetting:Object, unit:'waves'|'um', samplingSize:number, noll:number}|null}
+ *   null は不正な Noll 指定（呼び出し側で FAIL）
+ */
+export function resolveZernikeOperandInputs(operand, opticalSystemRows, sourceRows, objectRows) {
+    // param1: λ idx (1-based, blank=Primary)
+    const wavelength = getSystemWavelengthFromOperandOrPrimary({ param1: operand?.param1 }, sourceRows);
+
+    // param2: Object idx (1-based, default 1)
+    const fieldIdx1 = Number.isFinite(Number(operand?.param2)) ? Math.max(1, Math.floor(Number(operand.param2))) : 1;
+    const objRow = Array.isArray(objectRows) ? objectRows[Math.max(0, Math.min(objectRows.length - 1, fieldIdx1 - 1))] : null;
+    const fieldSetting = toFieldSettingFromObjectRow(objRow || {}, fieldIdx1 - 1, isInfiniteSystemFromRows(opticalSystemRows));
+
+    // param3: Unit (waves or um)
+    const unit = parseZernikeUnit(operand?.param3);
+
+    // param4: Sampling (grid size, default 32)
+    const samplingSize = Number.isFinite(Number(operand?.param4)) && Number(operand.param4) > 0
+        ? Math.floor(Number(operand.param4))
+        : 32;
+
+    // param5: n (Noll) - coefficient index, 0 = RMS of j >= 4
+    const param5Value = operand?.param5;
+    const nollRaw = param5Value !== undefined && param5Value !== null && String(param5Value).trim() !== ''
+        ? Number(param5Value)
+        : 0;
+    if (!Number.isFinite(nollRaw)) return null;
+    const noll = Math.floor(nollRaw);
+    if (noll < 0) return null;
+
+    return { wavelength, fieldSetting, unit, samplingSize, noll };
+}
+
+/**
+ * OPD Analysis と同じ矩形グリッド（円形マスク）で基準球 OPD をサンプリングし、Zernike フィットする。
+ * @returns {Object|null} WavefrontAberrationAnalyzer.fitZernikePolynomials() の戻り値
+ */
+export function computeZernikeFitLive({ opticalSystemData, wavelengthUm, fieldSetting, zernikeMaxNoll = 15, samplingSize = 32, onDebug = null }) {
+    if (!Array.isArray(opticalSystemData) || opticalSystemData.length === 0) return null;
+    if (!Number.isFinite(wavelengthUm) || wavelengthUm <= 0) return null;
+    if (!fieldSetting || typeof fieldSetting !== 'object') return null;
+    const debug = (info) => {
+        if (typeof onDebug !== 'function') return;
+        try { onDebug({ wavelengthUm, zernikeMaxNoll, fieldSetting, ...info }); } catch (_) {}
+    };
+    const opdCalculator = createOPDCalculator(opticalSystemData, wavelengthUm);
+    const analyzer = new WavefrontAberrationAnalyzer(opdCalculator);
+
+    try {
+        opdCalculator.setReferenceRay(fieldSetting);
+    } catch (_) {
+        // If reference ray setup fails, return null.
+        return null;
+    }
+
+    // OPD Analysis と同じサンプリング（gridSize × gridSize の矩形グリッド + 円形マスク）
+    const gridSize = samplingSize;
+    const pupilRange = 1.0;
+
+    const pupilCoordinates = [];
+    const opds = [];
+    for (let i = 0; i < gridSize; i++) {
+        for (let j = 0; j < gridSize; j++) {
+            const pupilX = (i / (gridSize - 1)) * 2 * pupilRange - pupilRange;
+            const pupilY = (j / (gridSize - 1)) * 2 * pupilRange - pupilRange;
+            const pupilRadius = Math.sqrt(pupilX * pupilX + pupilY * pupilY);
+            if (pupilRadius > pupilRange) continue;
+            let opd = NaN;
+            try {
+                opd = opdCalculator.calculateOPDReferenceSphere(pupilX, pupilY, fieldSetting, false, { fastMarginalRay: true });
+            } catch (_) {
+                opd = NaN;
+            }
+            if (Number.isFinite(opd)) {
+                pupilCoordinates.push({ x: pupilX, y: pupilY, r: pupilRadius });
+                opds.push(opd);
+            }
+        }
+    }
+
+    if (pupilCoordinates.length < 6) {
+        debug({ ok: false, reason: 'insufficient-valid-opd-samples', validCount: pupilCoordinates.length });
+        return null;
+    }
+
+    try {
+        const fit = analyzer.fitZernikePolynomials({ pupilCoordinates, opds }, zernikeMaxNoll);
+        debug({ ok: true, validSamples: pupilCoordinates.length, maxNoll: fit?.maxNoll ?? null });
+        return fit;
+    } catch (_) {
+        debug({ ok: false, reason: 'fit-failed', validSamples: pupilCoordinates.length });
+        return null;
+    }
+}
+
+// Noll → OSA index (-1 for invalid / 0 = RMS)
+function nollToOSA(nollIndex) {
+    if (nollIndex === 0) return -1;
+    const jj = Math.floor(Number(nollIndex));
+    if (!Number.isFinite(jj) || jj < 1) return -1;
+
+    // Noll → (n,m) conversion (from eva-wavefront.js nollToNM_deprecated)
+    let n = 0;
+    while (((n + 1) * (n + 2)) / 2 < jj) n++;
+    const j0 = (n * (n + 1)) / 2 + 1;
+    const k = jj - j0; // 0..n
+    const m = -n + 2 * k;
+
+    // (n,m) → OSA index
+    return Math.floor((n * (n + 2) + m) / 2);
+}
+
+function readCoeff(container, osaIndex) {
+    if (!container || typeof container !== 'object') return null;
+    const v = container[osaIndex];
+    return (v !== undefined && v !== null && Number.isFinite(Number(v))) ? Number(v) : null;
+}
+
+/**
+ * Zernike フィット結果から ZERN_COEFF の値を取り出す。
+ * noll = 0 は j >= 4（ピストン・チルト・デフォーカスを除く）の RMS 合成。
+ * @returns {number} 取れないときは failValue
+ */
+export function zernikeCoefficientFromFit(zernike, noll, unit, wavelength, failValue = 1e9) {
+    if (!zernike) return failValue;
+    const coeffWaves = zernike?.coefficientsWaves || null;
+    const coeffUm = zernike?.coefficientsMicrons || null;
+
+    const maxNoll = Number(zernike?.maxNoll);
+    const termMax = Number.isFinite(maxNoll) ? Math.max(1, Math.floor(maxNoll)) : null;
+
+    const getCoeffInUnit = (nollIndex) => {
+        const osaIndex = nollToOSA(nollIndex);
+        if (osaIndex < 0) return null;
+
+        if (unit === 'um') {
+            const direct = readCoeff(coeffUm, osaIndex);
+            if (direct !== null) return direct;
+            const w = readCoeff(coeffWaves, osaIndex);
+            if (w === null) return null;
+            if (!(Number.isFinite(wavelength) && wavelength > 0)) return null;
+            return w * wavelength;
+        }
+        return readCoeff(coeffWaves, osaIndex);
+    };
+
+    if (noll === 0) {
+        let sumSq = 0;
+        if (termMax !== null) {
+            for (let j = 4; j <= termMax; j++) {
+                const c = getCoeffInUnit(j);
+                if (c === null) continue;
+                sumSq += c * c;
+            }
+            return Number.isFinite(sumSq) ? Math.sqrt(sumSq) : failValue;
+        }
+        const container = (unit === 'um' && coeffUm) ? coeffUm : coeffWaves;
+        if (!container || typeof container !== 'object') return failValue;
+        for (const [k] of Object.entries(container)) {
+            const j = Number(k);
+            if (!Number.isFinite(j) || j < 4) continue;
+            const c = getCoeffInUnit(Math.floor(j));
+            if (c === null) continue;
+            sumSq += c * c;
+        }
+        return Number.isFinite(sumSq) ? Math.sqrt(sumSq) : failValue;
+    }
+
+    const c = getCoeffInUnit(noll);
+    return (c === null) ? failValue : c;
+}
+
+/**
+ * ZERN_COEFF をライブフィットで評価する（OPD Analysis の wavefrontMap を使わない経路）。
+ */
+export function computeZernikeOperandValue(operand, opticalSystemRows, sourceRows, objectRows, failValue = 1e9) {
+    const inputs = resolveZernikeOperandInputs(operand, opticalSystemRows, sourceRows, objectRows);
+    if (!inputs) return failValue;
+    const fit = computeZernikeFitLive({
+        opticalSystemData: opticalSystemRows,
+        wavelengthUm: inputs.wavelength,
+        fieldSetting: inputs.fieldSetting,
+        zernikeMaxNoll: ZERNIKE_LIVE_MAX_NOLL,
+        samplingSize: inputs.samplingSize
+    });
+    return zernikeCoefficientFromFit(fit, inputs.noll, inputs.unit, inputs.wavelength, failValue);
+}
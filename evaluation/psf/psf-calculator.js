@@ -321,6 +321,25 @@ export class PSFCalculator {
         }
     }
 
+    /**
+     * WASM計算器の初期化完了を待って返す（calculatePSF を経由しない呼び出し元向け）
+     * @returns {Promise<Object|null>} 利用可能なWASM計算器、未対応・初期化失敗時は null
+     */
+    async ensureWasmCalculator() {
+        if (!this.useWasm || this.performanceMode === 'javascript') return null;
+        if (!this.wasmCalculator && !this._wasmInitPromise) {
+            this._wasmInitPromise = this.initializeWasmCalculator();
+        }
+        if (this._wasmInitPromise) {
+            try {
+                await this._wasmInitPromise;
+            } catch {
+                // 初期化失敗時は null を返して呼び出し元でJSへフォールバック
+            }
+        }
+        return this.wasmCalculator || null;
+    }
+
     /**
      * Sourceから主波長を取得
      * @returns {number} 波長（μm）
@@ -2,8 +2,10 @@
 // 仕様書に基づくスポットダイアグラム機能
 
 import { traceRay, calculateSurfaceOrigins, transformPointToLocal } from '../raytracing/core/ray-tracing.js';
-import { findStopSurfaceIndex, calculateFocalLength, calculateParaxialData } from '../raytracing/core/ray-paraxial.js';
+import { findStopSurfaceIndex } from '../raytracing/core/ray-paraxial.js';
+import { getFocalLength, getParaxialData } from '../raytracing/core/first-order-cache.js';
 import { generateRayStartPointsForObject } from '../optical/ray-renderer.js';
+import { isSpotStreamWasmAvailable, traceSpotWasmAsync } from '../raytracing/core/ray-batch-trace.js';
 
 function derivePupilAndFocalLengthMmFromParaxial(opticalSystemRows, wavelengthMicrons, preferEntrancePupil) {
     let pupilDiameterMm = 10.0;
@@ -11,7 +13,7 @@ function derivePupilAndFocalLengthMmFromParaxial(opticalSystemRows, wavelengthMi
 
     // Prefer paraxial pupils (EnPD/ExPD). Fallback to Stop.semidia/aperture.
     try {
-        const paraxial = calculateParaxialData(opticalSystemRows, wavelengthMicrons);
+        const paraxial = getParaxialData(opticalSystemRows, wavelengthMicrons);
         const enpd = Number(paraxial?.entrancePupilDiameter);
         const expd = Number(paraxial?.exitPupilDiameter);
 
@@ -49,7 +51,7 @@ function derivePupilAndFocalLengthMmFromParaxial(opticalSystemRows, wavelengthMi
 
     // Focal length fallback
     try {
-        const fl = calculateFocalLength(opticalSystemRows, wavelengthMicrons);
+        const fl = getFocalLength(opticalSystemRows, wavelengthMicrons);
         if (Number.isFinite(fl) && Math.abs(fl) > 1e-9 && fl !== Infinity) {
             focalLengthMm = Math.abs(fl);
         }
@@ -1273,6 +1275,8 @@ export async function generateSpotDiagramAsync(
     const totalObjects = objectRows.length;
     let completedWork = 0;
     const estimatedTotalWork = Math.max(1, totalObjects * Math.max(1, rayNumber));
+    // options.nativeSpot = false で従来どおり光線ごとに traceRay() する
+    const useNativeSpot = options?.nativeSpot !== false && isSpotStreamWasmAvailable();
 
     for (let objectIndex = 0; objectIndex < objectRows.length; objectIndex++) {
         const obj = objectRows[objectIndex];
@@ -1375,6 +1379,51 @@ export async function generateSpotDiagramAsync(
             let ok = 0;
             const maxRaysThisObject = Math.min(starts.length, rayNumber);
 
+            // WASM: 同じ開始点をチャンク単位で追跡する。1 本も届かない場合は失敗した面の内訳を残すため、
+            // 下の JS ループで追跡し直す。
+            if (useNativeSpot) {
+                const done0 = completedWork;
+                const native = await traceSpotWasmAsync(opticalSystemRows, { starts: starts.slice(0, maxRaysThisObject) }, {
+                    targetSurfaceIndex,
+                    wavelength: Number(primaryWavelength?.wavelength) || 0.5876,
+                    maxPoints: maxRaysThisObject,
+                    yieldEvery: Math.max(256, yieldEvery * 40),
+                    onProgress: onProgress ? ({ done }) => {
+                        const pct = 5 + (85 * ((done0 + done) / estimatedTotalWork));
+                        safeProgress(Math.min(90, Math.max(0, pct)), `Tracing rays (${done0 + done}/${estimatedTotalWork})...`);
+                    } : null
+                });
+                if (native && native.hits > 0) {
+                    for (const p of native.points) {
+                        const rayStart = starts[p.rayIndex];
+                        pts.push({
+                            x: p.x,
+                            y: p.y,
+                            z: p.z,
+                            globalX: p.globalX,
+                            globalY: p.globalY,
+                            globalZ: p.globalZ,
+                            wavelength: primaryWavelength.wavelength,
+                            wavelengthName: primaryWavelength.name,
+                            isPrimary: true,
+                            objectId: obj.id,
+                            rayIndex: p.rayIndex,
+                            isChiefRay: rayStart.isChief === true || (rayStart.isChief === undefined && p.rayIndex === 0),
+                            startPoint: { x: rayStart.startP.x, y: rayStart.startP.y, z: rayStart.startP.z },
+                            initialDir: { ...rayStart.dir }
+                        });
+                    }
+                    const f = native.failures;
+                    for (const [kind, n] of [['NO_INTERSECTION', f.miss], ['PHYSICAL_APERTURE_BLOCK', f.blocked],
+                        ['TOTAL_INTERNAL_REFLECTION', f.tir], ['INVALID_HIT_POINT', f.invalid]]) {
+                        if (n > 0) diag.kindCounts[kind] = (diag.kindCounts[kind] || 0) + n;
+                    }
+                    diag.nativeSpot = true;
+                    completedWork += maxRaysThisObject;
+                    return { starts, ok: pts.length, spotPoints: pts, diagnostics: diag };
+                }
+            }
+
             for (let i = 0; i < maxRaysThisObject; i++) {
                 const rayStart = starts[i];
                 if (!rayStart || !rayStart.startP || !rayStart.dir) continue;
@@ -2025,6 +2074,79 @@ try {
     }
 } catch (_) {}
 
+/**
+ * 直前のスポット図と同じ開始光線を、編集中の光学系で追跡し直すための入力を作る（パラメータのドラッグ中のプレビュー用）。
+ * 光線のエイミングや瞳スケールの再試行はしないので、確定値は generateSpotDiagramAsync() で作り直すこと。
+ *
+ * @param {Object} spotDiagramData generateSpotDiagramAsync() の戻り値
+ * @param {number} surfaceNumber 評価面番号（generateSpotDiagramAsync と同じ 1 始まり）
+ * @returns {{rays: Array<{pos,dir,wavelength}>, traceOptions: {maxSurfaceIndex:number, returnHitPointOnly:boolean},
+ *   toSpotDiagramData: (opticalSystemRows: Array<Object>, hits: Array<{x,y,z}|null>) => Object}|null}
+ *   rays を traceRaysBatch(rows, rays, traceOptions) で追跡し、その結果を toSpotDiagramData() に渡すと
+ *   drawSpotDiagram() にそのまま渡せるデータになる
+ */
+export function prepareSpotPreviewRetrace(spotDiagramData, surfaceNumber) {
+    const objects = Array.isArray(spotDiagramData?.spotData) ? spotDiagramData.spotData : null;
+    const targetSurfaceIndex = Number(surfaceNumber) - 1;
+    if (!objects || !Number.isInteger(targetSurfaceIndex) || targetSurfaceIndex < 0) return null;
+
+    const rays = [];
+    const refs = [];
+    objects.forEach((o, objectIndex) => {
+        const pts = Array.isArray(o?.spotPoints) ? o.spotPoints : [];
+        for (const p of pts) {
+            if (!p || !p.startPoint || !p.initialDir) continue;
+            rays.push({ pos: p.startPoint, dir: p.initialDir, wavelength: Number(p.wavelength) || 0.5876 });
+            refs.push({ objectIndex, point: p });
+        }
+    });
+    if (rays.length === 0) return null;
+
+    const toSpotDiagramData = (opticalSystemRows, hits) => {
+        const surfaceInfoList = calculateSurfaceOrigins(opticalSystemRows);
+        const surfaceInfo = surfaceInfoList[targetSurfaceIndex];
+        const perObject = objects.map(() => []);
+        for (let k = 0; k < refs.length; k++) {
+            const hit = hits?.[k];
+            if (!hit) continue;
+            const local = surfaceInfo ? transformPointToLocal(hit, surfaceInfo) : hit;
+            if (!local || !Number.isFinite(local.x) || !Number.isFinite(local.y)) continue;
+            perObject[refs[k].objectIndex].push({
+                ...refs[k].point,
+                x: local.x,
+                y: local.y,
+                z: local.z,
+                globalX: hit.x,
+                globalY: hit.y,
+                globalZ: hit.z
+            });
+        }
+        const spotData = objects.map((o, i) => {
+            const spotPoints = perObject[i];
+            const n = spotPoints.length;
+            const centroidRaw = n > 0
+                ? { x: spotPoints.reduce((s, p) => s + p.x, 0) / n, y: spotPoints.reduce((s, p) => s + p.y, 0) / n }
+                : { x: 0, y: 0 };
+            return {
+                ...o,
+                spotPoints,
+                successfulRays: n,
+                successRate: o.totalRays > 0 ? n / o.totalRays : 0,
+                centroidRaw,
+                centroidAdjusted: centroidRaw,
+                hasCentroid: n > 0
+            };
+        });
+        return { ...spotDiagramData, spotData, surfaceInfoList };
+    };
+
+    return {
+        rays,
+        traceOptions: { maxSurfaceIndex: targetSurfaceIndex, returnHitPointOnly: true },
+        toSpotDiagramData
+    };
+}
+
 // スポットダイアグラムの描画（仕様書準拠）
 export function drawSpotDiagram(spotData, surfaceNumber, containerId, primaryWavelength = null) {
     console.log('🎨 [SPOT DIAGRAM] Drawing spot diagram...');
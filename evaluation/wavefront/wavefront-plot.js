@@ -11,6 +11,11 @@
  * データ生成には `eva-wavefront.js` をimportして使用する。
  */
 
+import { getOrComputeAnalysis, replayProgressOnHit } from '../analysis-cache.js';
+
+// 結果に影響しない（進捗・診断表示だけの）オプションは解析キャッシュの鍵から外す
+const WAVEFRONT_MAP_UNKEYED_OPTIONS = new Set(['cancelToken', 'onProgress', 'profile', 'progressEvery']);
+
 /**
  * 波面収差プロット生成クラス
  * Plotly.jsを使用した3D可視化を担当
@@ -148,6 +153,27 @@ export class WavefrontPlotter {
         } catch (_) {}
     }
 
+    /**
+     * analyzer.generateWavefrontMap() を evaluation/analysis-cache.js 経由で呼ぶ
+     * 同じ光学系・フィールド・波長・グリッドの OPD マップは OPD / Wλ / ヒートマップ間で共有する。
+     * 光線記録や不連続診断を伴う呼び出しは毎回計算する。
+     */
+    async _generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, mapOptions = {}) {
+        const compute = () => analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', mapOptions);
+        if (mapOptions?.recordRays || mapOptions?.diagnoseDiscontinuities) return compute();
+        const keyedOptions = {};
+        for (const [k, v] of Object.entries(mapOptions || {})) {
+            if (!WAVEFRONT_MAP_UNKEYED_OPTIONS.has(k)) keyedOptions[k] = v;
+        }
+        return getOrComputeAnalysis(
+            'wavefront-map',
+            opticalSystemRows,
+            { fieldSetting, wavelength, gridSize, gridPattern: 'circular', options: keyedOptions },
+            compute,
+            { onHit: replayProgressOnHit(mapOptions?.onProgress) }
+        );
+    }
+
     _updateSystemDataWithZernike(analyzer, wavefrontMap, maxNoll = 37) {
         try {
             if (!analyzer || typeof analyzer.formatZernikeReportText !== 'function') return;
@@ -185,7 +211,7 @@ export class WavefrontPlotter {
 
             // 波面収差マップを生成
             if (profileEnabled) console.time('⏱️ plotOPDSurface.generateWavefrontMap');
-            const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+            const wavefrontMap = await this._generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, {
                 recordRays: false,
                 // Avoid console-log progress (it can dominate runtime on large grids)
                 progressEvery: 0,
@@ -407,7 +433,7 @@ export class WavefrontPlotter {
 
             // 波面収差マップを生成
             if (profileEnabled) console.time('⏱️ plotWavefrontSurface.generateWavefrontMap');
-            const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+            const wavefrontMap = await this._generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, {
                 recordRays: false,
                 progressEvery: 512,
                 diagnoseDiscontinuities,
@@ -607,7 +633,7 @@ export class WavefrontPlotter {
             }
             // 波面収差マップを生成（Zernike 37項で関数面を描画）
             const diagnoseDiscontinuities = (typeof globalThis !== 'undefined' && globalThis.__WAVEFRONT_DIAG_DISCONTINUITIES === true);
-            const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+            const wavefrontMap = await this._generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, {
                 recordRays: false,
                 // Avoid console-log progress (it can dominate runtime on large grids)
                 progressEvery: 0,
@@ -715,7 +741,7 @@ export class WavefrontPlotter {
             }
 
             const diagnoseDiscontinuities = (typeof globalThis !== 'undefined' && globalThis.__WAVEFRONT_DIAG_DISCONTINUITIES === true);
-            const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+            const wavefrontMap = await this._generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, {
                 recordRays: false,
                 progressEvery: 512,
                 diagnoseDiscontinuities,
@@ -805,7 +831,7 @@ export class WavefrontPlotter {
                 // - renderFromZernike: true でpiston/tilt除去後の波面を表示
                 // - zernikeMaxNoll: 37 で高次収差まで正確にフィッティング
                 // - これにより各フィールドの"本質的な高次収差"が比較可能になる
-                const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+                const wavefrontMap = await this._generateWavefrontMapShared(opticalSystemRows, wavelength, analyzer, fieldSetting, gridSize, {
                     recordRays: false,
                     progressEvery: 512,
                     // Use reference-sphere OPD (geometric tilt correction for off-axis fields)
@@ -9,6 +9,82 @@
  * Implements weighted least-squares Zernike fitting for pupils with vignetting/obscuration
  */
 
+/**
+ * Optional WASM kernel (wasm/zernike-fit.c, linked into the PSF WASM module).
+ * psf-wasm-wrapper.js registers the module once it is ready; until then, and with
+ * builds that lack the export, the JS implementation below is used.
+ */
+let zernikeWasmModule = null;
+const ZERNIKE_WASM_MIN_POINTS = 256;
+const ZERNIKE_WASM_MAX_ORDER = 20;
+
+/**
+ * Register (or clear with null) the WASM module providing _zernike_fit_wasm / _zernike_reconstruct_wasm.
+ * @param {Object|null} mod - Emscripten module
+ */
+export function setZernikeWasmModule(mod) {
+  zernikeWasmModule = (mod && typeof mod._zernike_fit_wasm === 'function' && typeof mod._malloc === 'function')
+    ? mod
+    : null;
+}
+
+function zernikeWasmHeap(mod) {
+  const heap = mod?.HEAPF64;
+  return (heap && heap.buffer && heap.buffer.byteLength > 0) ? heap : null;
+}
+
+/**
+ * WASM path of fitZernikeWeighted (single streaming pass + Cholesky).
+ * Unlike the JS path, residual statistics stay aligned with the coefficients when
+ * skipPiston/skipTilt are used.
+ * Vignetted (non-finite) and out-of-pupil samples are dropped before upload: modules
+ * built with -ffast-math alone compile the kernel's isfinite() mask away.
+ * @returns {Object|null} Same shape as fitZernikeWeighted, or null if WASM is unavailable
+ */
+function fitZernikeWeightedWasm(points, maxOrder, flags, epsilon) {
+  const mod = zernikeWasmModule;
+  const numTerms = (maxOrder + 1) * (maxOrder + 2) / 2;
+  const valid = [];
+  for (const pt of points) {
+    const x = Number(pt?.x), y = Number(pt?.y), opd = Number(pt?.opd);
+    if (!Number.isFinite(x) || !Number.isFinite(y) || !Number.isFinite(opd)) continue;
+    const rho = Math.sqrt(x * x + y * y);
+    if (!(rho <= 1.0) || rho < epsilon) continue;
+    valid.push(pt);
+  }
+  const count = valid.length;
+  if (count === 0) return null;
+  const ptr = mod._malloc((4 * count + numTerms + 3) * 8);
+  if (!ptr) return null;
+  try {
+    const heap = zernikeWasmHeap(mod);
+    if (!heap) return null;
+    const ix = ptr >> 3, iy = ix + count, io = iy + count, iw = io + count;
+    for (let k = 0; k < count; k++) {
+      const pt = valid[k];
+      heap[ix + k] = Number(pt.x);
+      heap[iy + k] = Number(pt.y);
+      heap[io + k] = Number(pt.opd);
+      heap[iw + k] = pt.weight || 1.0;
+    }
+    const pc = ptr + 4 * count * 8;
+    const ps = pc + numTerms * 8;
+    const rc = mod._zernike_fit_wasm(ptr, ptr + count * 8, ptr + 2 * count * 8, ptr + 3 * count * 8, count,
+      maxOrder, epsilon, flags, pc, ps);
+    if (rc !== 0) return null;
+    const out = zernikeWasmHeap(mod);
+    if (!out) return null;
+    return {
+      coefficients: Array.from(out.subarray(pc >> 3, (pc >> 3) + numTerms)),
+      rms: out[ps >> 3],
+      pv: out[(ps >> 3) + 1],
+      numPoints: out[(ps >> 3) + 2]
+    };
+  } finally {
+    mod._free(ptr);
+  }
+}
+
 /**
  * OSA/ANSI Standard Zernike Polynomials
  * Single index j = n(n+2)/2 + m
@@ -134,6 +210,7 @@ export function nmToJ(n, m) {
  * @param {boolean} options.removeTilt - Remove tilt (Z1, Z2) terms
  * @param {boolean} options.skipPiston - Skip piston term in fitting (for hybrid approach)
  * @param {boolean} options.skipTilt - Skip tilt terms in fitting (for hybrid approach)
+ * @param {boolean} options.forceJS - Do not use the WASM kernel even if registered
  * @returns {{coefficients: Array<number>, rms: number, pv: number}} Zernike coefficients and residual statistics
  */
 export function fitZernikeWeighted(points, maxOrder, options = {}) {
@@ -142,6 +219,13 @@ export function fitZernikeWeighted(points, maxOrder, options = {}) {
   const removeTilt = options.removeTilt || false;
   const skipPiston = options.skipPiston || false;
   const skipTilt = options.skipTilt || false;
+
+  if (zernikeWasmModule && !options.forceJS && points.length >= ZERNIKE_WASM_MIN_POINTS &&
+      Number.isInteger(maxOrder) && maxOrder >= 0 && maxOrder <= ZERNIKE_WASM_MAX_ORDER) {
+    const flags = (skipPiston ? 1 : 0) | (skipTilt ? 2 : 0) | (removePiston ? 4 : 0) | (removeTilt ? 8 : 0);
+    const result = fitZernikeWeightedWasm(points, maxOrder, flags, epsilon);
+    if (result) return result;
+  }
   
   // Calculate number of Zernike terms
   const numTerms = (maxOrder + 1) * (maxOrder + 2) / 2;
@@ -349,6 +433,45 @@ export function reconstructOPD(coefficients, x, y) {
   return opd;
 }
 
+/**
+ * Reconstruct OPD at many points (batch form of reconstructOPD; 0 outside the unit circle)
+ *
+ * @param {Array<number>} coefficients - Zernike coefficients (OSA/ANSI ordering)
+ * @param {ArrayLike<number>} xs - Normalized X coordinates
+ * @param {ArrayLike<number>} ys - Normalized Y coordinates
+ * @returns {Float64Array} Reconstructed OPD values
+ */
+export function reconstructOPDBatch(coefficients, xs, ys) {
+  const count = Math.min(xs.length, ys.length);
+  const terms = coefficients.length;
+  const mod = zernikeWasmModule;
+  if (mod && typeof mod._zernike_reconstruct_wasm === 'function' && count >= ZERNIKE_WASM_MIN_POINTS &&
+      terms <= (ZERNIKE_WASM_MAX_ORDER + 1) * (ZERNIKE_WASM_MAX_ORDER + 2) / 2) {
+    const ptr = mod._malloc((terms + 3 * count) * 8);
+    if (ptr) {
+      try {
+        const heap = zernikeWasmHeap(mod);
+        if (heap) {
+          const ic = ptr >> 3, ix = ic + terms, iy = ix + count, io = iy + count;
+          for (let j = 0; j < terms; j++) heap[ic + j] = Number(coefficients[j]) || 0;
+          for (let k = 0; k < count; k++) {
+            heap[ix + k] = xs[k];
+            heap[iy + k] = ys[k];
+          }
+          if (mod._zernike_reconstruct_wasm(ptr, terms, ix * 8, iy * 8, count, io * 8) === 0) {
+            return zernikeWasmHeap(mod).slice(io, io + count);
+          }
+        }
+      } finally {
+        mod._free(ptr);
+      }
+    }
+  }
+  const out = new Float64Array(count);
+  for (let k = 0; k < count; k++) out[k] = reconstructOPD(coefficients, xs[k], ys[k]);
+  return out;
+}
+
 /**
  * Get Zernike term name (OSA/ANSI standard)
  * 
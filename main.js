@@ -1499,7 +1499,7 @@ if (typeof document !== 'undefined' && document?.addEventListener) document.addE
         
         console.log('✅ Application initialization completed');
 
-        // URL share load (hash: #compressed_data=...)
+        // URL share load (hash: #!packed_data=... / #compressed_data=...)
         // Run on next tick so other DOMContentLoaded listeners can finish too.
         setTimeout(() => {
             try {
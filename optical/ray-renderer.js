@@ -618,6 +618,40 @@ export function optimizeAngleObjectPosition(angleX, angleY, opticalSystemRows) {
     };
 }
 
+/**
+ * Get start point / initial direction of the rays drawn by drawRayWithSegmentColors() that are still in the scene
+ * (the first segment of each ray keeps them in userData.rayStart)
+ * @param {THREE.Scene} scene - Three.js scene
+ * @returns {Array<{pos:{x,y,z}, dir:{x,y,z}, objectId:*, rayNumber:number}>}
+ */
+export function getDrawnRayStarts(scene) {
+    const starts = [];
+    if (!scene) return starts;
+    scene.traverse((child) => {
+        const ud = child.userData;
+        if (ud && ud.rayType === 'crossBeam' && ud.segment === 1 && ud.rayStart) {
+            starts.push({ ...ud.rayStart, objectId: ud.objectId, rayNumber: ud.rayNumber });
+        }
+    });
+    return starts;
+}
+
+/**
+ * Remove the rays drawn by drawRayWithSegmentColors() (other ray lines stay in the scene)
+ * @param {THREE.Scene} scene - Three.js scene
+ */
+export function clearDrawnRays(scene) {
+    const raysToRemove = [];
+    scene.traverse((child) => {
+        if (child.userData && child.userData.rayType === 'crossBeam') raysToRemove.push(child);
+    });
+    raysToRemove.forEach(ray => {
+        if (ray.parent) ray.parent.remove(ray);
+        if (ray.geometry) ray.geometry.dispose();
+        if (ray.material) ray.material.dispose();
+    });
+}
+
 /**
  * Draw ray with segment colors
  * @param {Array} rayPath - Ray path data
@@ -668,6 +702,17 @@ export function drawRayWithSegmentColors(rayPath, objectId, rayNumber, scene) {
     const segmentsToShow = rayPath.length - 1;
     // console.log(`🎨 Drawing ${segmentsToShow} segments for ray ${rayNumber}`);
     
+    // 開始点と初期方向（getDrawnRayStarts() 用に最初のセグメントへ持たせる）
+    const rayStart = (() => {
+        const dx = rayPath[1].x - firstPoint.x, dy = rayPath[1].y - firstPoint.y, dz = rayPath[1].z - firstPoint.z;
+        const len = Math.hypot(dx, dy, dz);
+        if (!Number.isFinite(len) || len < 1e-12) return null;
+        return {
+            pos: { x: firstPoint.x, y: firstPoint.y, z: firstPoint.z },
+            dir: { x: dx / len, y: dy / len, z: dz / len }
+        };
+    })();
+    
     // Color palettes for different modes (避けるべき色: 白、薄い色)
     const segmentColors = [
         0xff0000, // Red
@@ -808,6 +853,7 @@ export function drawRayWithSegmentColors(rayPath, objectId, rayNumber, scene) {
             colorMode: rayColorMode,
             isRayLine: true
         };
+        if (i === 0 && rayStart) line.userData.rayStart = rayStart;
         
         scene.add(line);
         // console.log(`✅ Ray segment ${i + 1} added to scene for ray ${rayNumber}, object ${objectId}`);
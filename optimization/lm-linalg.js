@@ -0,0 +1,281 @@
+/**
+ * Linear algebra for the LM step in optimizer-mvp.
+ *
+ * - The Jacobian is a column-major Float64Array (J[j * m + i]), so every entry of J^T J is a
+ *   dot product of two contiguous columns.
+ * - Optional WASM kernel (wasm/lm-linalg.c, linked into the PSF WASM module): blocked f64x2
+ *   J^T J / J^T r and a damped Cholesky solve. psf-wasm-wrapper.js registers the module once it
+ *   is ready; until then, and with builds that lack the export, the JS loops below are used.
+ * - createDampedSolver(A) uploads A once; solve(b, lambda) applies A + lambda*diag(A) + lambda*I
+ *   while factoring, so retrying several lambda values never re-forms the normal equations.
+ */
+
+let lmWasmModule = null;
+const LM_WASM_MIN_ENTRIES = 256; // m * n below this: JS is faster than the copy in/out
+
+// Grow-only heap scratch shared by formNormalEquations / createDampedSolver
+let lmScratch = { ptr: 0, doubles: 0, generation: 0 };
+
+/**
+ * Register (or clear with null) the WASM module providing _lm_normal_equations_wasm / _lm_damped_solve_wasm.
+ * @param {Object|null} mod - Emscripten module
+ */
+export function setLmLinalgWasmModule(mod) {
+  const ok = !!mod
+    && typeof mod._lm_normal_equations_wasm === 'function'
+    && typeof mod._lm_damped_solve_wasm === 'function'
+    && typeof mod._malloc === 'function';
+  if (lmWasmModule && lmWasmModule !== mod && lmScratch.ptr) {
+    try { lmWasmModule._free(lmScratch.ptr); } catch (_) {}
+  }
+  if (lmWasmModule !== mod) lmScratch = { ptr: 0, doubles: 0, generation: lmScratch.generation + 1 };
+  lmWasmModule = ok ? mod : null;
+}
+
+export function isLmLinalgWasmAvailable() {
+  return !!lmWasmModule;
+}
+
+function lmWasmHeap(mod) {
+  const heap = mod?.HEAPF64;
+  return (heap && heap.buffer && heap.buffer.byteLength > 0) ? heap : null;
+}
+
+// Every reservation bumps the generation: whoever reserved last owns the contents.
+function reserveScratch(mod, doubles) {
+  if (lmScratch.ptr && lmScratch.doubles >= doubles) {
+    lmScratch.generation++;
+    return lmScratch.ptr;
+  }
+  if (lmScratch.ptr) mod._free(lmScratch.ptr);
+  const cap = Math.max(doubles, lmScratch.doubles * 2);
+  const ptr = mod._malloc(cap * 8);
+  lmScratch = { ptr: ptr || 0, doubles: ptr ? cap : 0, generation: lmScratch.generation + 1 };
+  return lmScratch.ptr;
+}
+
+export function solveSymmetricPositiveDefinite(A, b) {
+  // Cholesky decomposition: A = L L^T.
+  const n = b.length;
+  /** @type {number[][]} */
+  const L = Array.from({ length: n }, () => Array(n).fill(0));
+
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j <= i; j++) {
+      let sum = A[i][j];
+      for (let k = 0; k < j; k++) sum -= L[i][k] * L[j][k];
+      if (i === j) {
+        if (!(sum > 0) || !Number.isFinite(sum)) return null;
+        L[i][j] = Math.sqrt(sum);
+      } else {
+        const denom = L[j][j];
+        if (!Number.isFinite(denom) || denom === 0) return null;
+        L[i][j] = sum / denom;
+      }
+    }
+  }
+
+  // Solve L y = b
+  const y = Array(n).fill(0);
+  for (let i = 0; i < n; i++) {
+    let sum = b[i];
+    for (let k = 0; k < i; k++) sum -= L[i][k] * y[k];
+    const denom = L[i][i];
+    if (!Number.isFinite(denom) || denom === 0) return null;
+    y[i] = sum / denom;
+  }
+
+  // Solve L^T x = y
+  const x = Array(n).fill(0);
+  for (let i = n - 1; i >= 0; i--) {
+    let sum = y[i];
+    for (let k = i + 1; k < n; k++) sum -= L[k][i] * x[k];
+    const denom = L[i][i];
+    if (!Number.isFinite(denom) || denom === 0) return null;
+    x[i] = sum / denom;
+  }
+
+  return x;
+}
+
+export function solveLinearSystemFallback(A, b) {
+  // Gaussian elimination with partial pivoting.
+  const n = b.length;
+  const M = A.map((row) => row.slice());
+  const x = b.slice();
+
+  for (let k = 0; k < n; k++) {
+    // pivot
+    let pivotRow = k;
+    let pivotVal = Math.abs(M[k][k]);
+    for (let i = k + 1; i < n; i++) {
+      const v = Math.abs(M[i][k]);
+      if (v > pivotVal) {
+        pivotVal = v;
+        pivotRow = i;
+      }
+    }
+    if (!Number.isFinite(pivotVal) || pivotVal === 0) return null;
+    if (pivotRow !== k) {
+      const tmp = M[k];
+      M[k] = M[pivotRow];
+      M[pivotRow] = tmp;
+      const t = x[k];
+      x[k] = x[pivotRow];
+      x[pivotRow] = t;
+    }
+
+    // eliminate
+    const pivot = M[k][k];
+    for (let i = k + 1; i < n; i++) {
+      const f = M[i][k] / pivot;
+      if (!Number.isFinite(f)) return null;
+      M[i][k] = 0;
+      for (let j = k + 1; j < n; j++) {
+        M[i][j] -= f * M[k][j];
+      }
+      x[i] -= f * x[k];
+    }
+  }
+
+  // back substitute
+  const out = Array(n).fill(0);
+  for (let i = n - 1; i >= 0; i--) {
+    let sum = x[i];
+    for (let j = i + 1; j < n; j++) sum -= M[i][j] * out[j];
+    const denom = M[i][i];
+    if (!Number.isFinite(denom) || denom === 0) return null;
+    out[i] = sum / denom;
+  }
+  return out;
+}
+
+function normalEquationsWasm(J, r, m, n) {
+  const mod = lmWasmModule;
+  const ptr = reserveScratch(mod, m * n + m + n * n + n);
+  if (!ptr) return null;
+  let heap = lmWasmHeap(mod);
+  if (!heap) return null;
+  const ij = ptr >> 3, ir = ij + m * n, ia = ir + m, ig = ia + n * n;
+  heap.set(J.subarray(0, m * n), ij);
+  for (let i = 0; i < m; i++) heap[ir + i] = r[i];
+  const rc = mod._lm_normal_equations_wasm(ij * 8, ir * 8, m, n, ia * 8, ig * 8);
+  if (rc !== 0) return null;
+  heap = lmWasmHeap(mod);
+  if (!heap) return null;
+  /** @type {number[][]} */
+  const A = Array.from({ length: n }, (_, j) => Array.from(heap.subarray(ia + j * n, ia + (j + 1) * n)));
+  const g = Array.from(heap.subarray(ig, ig + n));
+  return { A, g };
+}
+
+/**
+ * Normal equations A = J^T J, g = J^T r.
+ * @param {Float64Array} J - column-major Jacobian (J[j * m + i])
+ * @param {ArrayLike<number>} r - residuals (m)
+ * @returns {{A:number[][], g:number[]}}
+ */
+export function formNormalEquations(J, r, m, n) {
+  if (lmWasmModule && m * n >= LM_WASM_MIN_ENTRIES) {
+    try {
+      const out = normalEquationsWasm(J, r, m, n);
+      if (out) return out;
+    } catch (_) {}
+  }
+
+  /** @type {number[][]} */
+  const A = Array.from({ length: n }, () => Array(n).fill(0));
+  const g = Array(n).fill(0);
+  for (let j = 0; j < n; j++) {
+    const cj = j * m;
+    let gj = 0;
+    for (let i = 0; i < m; i++) gj += J[cj + i] * r[i];
+    g[j] = gj;
+    for (let k = 0; k <= j; k++) {
+      const ck = k * m;
+      let s = 0;
+      for (let i = 0; i < m; i++) s += J[cj + i] * J[ck + i];
+      A[j][k] = s;
+      A[k][j] = s;
+    }
+  }
+  return { A, g };
+}
+
+function dampedMatrix(A, lambda) {
+  const n = A.length;
+  /** @type {number[][]} */
+  const Ad = A.map((row) => row.slice());
+  for (let i = 0; i < n; i++) {
+    const d = A[i][i];
+    const diag = (Number.isFinite(d) && d > 0) ? d : 1;
+    Ad[i][i] = d + lambda * diag + lambda;
+  }
+  return Ad;
+}
+
+/**
+ * Solver for the Marquardt-damped system (A + lambda*diag(A) + lambda*I) dx = b.
+ * A must not be modified while the solver is in use.
+ * @param {number[][]} A - symmetric n x n
+ * @returns {{ solve: (b:number[], lambda:number) => (number[]|null) }}
+ */
+export function createDampedSolver(A) {
+  const n = A.length;
+  const mod = lmWasmModule;
+  let wasm = null;
+  if (mod && n > 0) {
+    try {
+      // Layout: A (n²) | work (n² + n) | b (n) | x (n)
+      const ptr = reserveScratch(mod, 2 * n * n + 3 * n);
+      const heap = ptr ? lmWasmHeap(mod) : null;
+      if (heap) {
+        const ia = ptr >> 3;
+        for (let i = 0; i < n; i++) {
+          const row = A[i];
+          for (let j = 0; j < n; j++) heap[ia + i * n + j] = row[j];
+        }
+        wasm = { ia, iw: ia + n * n, ib: ia + 2 * n * n + n, ix: ia + 2 * n * n + 2 * n, generation: lmScratch.generation };
+      }
+    } catch (_) {
+      wasm = null;
+    }
+  }
+
+  // undefined: kernel not usable (fall back to JS Cholesky) / null: not positive definite
+  const solveWasm = (b, lambda) => {
+    // Another caller may have reused (or grown) the scratch since A was uploaded.
+    if (lmWasmModule !== mod || lmScratch.generation !== wasm.generation) return undefined;
+    let heap = lmWasmHeap(mod);
+    if (!heap) return undefined;
+    for (let i = 0; i < n; i++) heap[wasm.ib + i] = b[i];
+    const rc = mod._lm_damped_solve_wasm(wasm.ia * 8, wasm.ib * 8, n, lambda, wasm.iw * 8, wasm.ix * 8);
+    if (rc !== 0) return null;
+    heap = lmWasmHeap(mod);
+    if (!heap) return undefined;
+    const x = Array.from(heap.subarray(wasm.ix, wasm.ix + n));
+    for (let i = 0; i < n; i++) {
+      if (!Number.isFinite(x[i])) return null;
+    }
+    return x;
+  };
+
+  return {
+    solve(b, lambda) {
+      let choleskyFailed = false;
+      if (wasm) {
+        try {
+          const x = solveWasm(b, lambda);
+          if (x) return x;
+          choleskyFailed = (x === null);
+        } catch (_) {}
+      }
+      const Ad = dampedMatrix(A, lambda);
+      if (!choleskyFailed) {
+        const x = solveSymmetricPositiveDefinite(Ad, b);
+        if (x) return x;
+      }
+      return solveLinearSystemFallback(Ad, b);
+    }
+  };
+}
@@ -0,0 +1,182 @@
+/**
+ * Merit worker pool for optimizer-mvp (main-thread side of optimization/merit-worker.js).
+ *
+ * - start() spawns module workers and waits for their 'ready' message; workers that fail
+ *   to load (no module-worker support, blocked URL, ...) are dropped. A pool with no
+ *   workers reports start() === false and the caller keeps the serial path.
+ * - setSnapshot() posts the serialized system only when it changed since the last call.
+ *   Fixed rows (cfg.rowsOverride) go as packOpticalSystemBinary() buffers (rows + RT10 table for the
+ *   Source wavelengths), transferred rather than structured-cloned; the worker unpacks them once.
+ * - run(tasks) distributes independent tasks round-robin up front, so workers keep
+ *   computing while the main thread is busy with its own (non-worker) operands.
+ */
+
+import { packOpticalSystemBinary } from '../raytracing/core/ray-batch-trace.js';
+import { computeFirstOrderSignature } from '../raytracing/core/first-order-cache.js';
+
+const DEFAULT_START_TIMEOUT_MS = 8000;
+const MAX_POOL_WORKERS = 8;
+
+export function isMeritWorkerPoolAvailable() {
+  try {
+    return typeof Worker === 'function' && typeof URL === 'function';
+  } catch (_) {
+    return false;
+  }
+}
+
+export function defaultMeritWorkerCount() {
+  const hc = (typeof navigator !== 'undefined' && Number.isFinite(Number(navigator.hardwareConcurrency)))
+    ? Math.floor(Number(navigator.hardwareConcurrency))
+    : 4;
+  // メインスレッド（UI + 非対応オペランド）に 1 コア残す
+  return Math.max(1, Math.min(MAX_POOL_WORKERS, hc - 1));
+}
+
+function sourceWavelengths(sourceRows) {
+  const wls = [];
+  for (const r of Array.isArray(sourceRows) ? sourceRows : []) {
+    const wl = Number(r?.wavelength);
+    if (Number.isFinite(wl) && wl > 0 && !wls.includes(wl)) wls.push(wl);
+  }
+  return wls;
+}
+
+export class MeritWorkerPool {
+  constructor({ size = defaultMeritWorkerCount() } = {}) {
+    this.requestedSize = Math.max(1, Math.min(MAX_POOL_WORKERS, Math.floor(Number(size) || 1)));
+    this.workers = [];
+    this.version = 0;
+    this._snapshotJson = null;
+    this._nextTaskId = 1;
+    this._pending = new Map();
+  }
+
+  get size() {
+    return this.workers.length;
+  }
+
+  async start(timeoutMs = DEFAULT_START_TIMEOUT_MS) {
+    if (!isMeritWorkerPoolAvailable()) return false;
+
+    const spawnOne = () => new Promise((resolve) => {
+      let worker = null;
+      let settled = false;
+      const finish = (ok) => {
+        if (settled) return;
+        settled = true;
+        clearTimeout(timer);
+        if (!ok && worker) {
+          try { worker.terminate(); } catch (_) {}
+        }
+        resolve(ok ? worker : null);
+      };
+      const timer = setTimeout(() => finish(false), timeoutMs);
+      try {
+        worker = new Worker(new URL('./merit-worker.js', import.meta.url), { type: 'module' });
+      } catch (_) {
+        finish(false);
+        return;
+      }
+      worker.onmessage = (e) => {
+        if (e.data && e.data.type === 'ready') finish(true);
+      };
+      worker.onerror = () => finish(false);
+    });
+
+    const spawned = await Promise.all(Array.from({ length: this.requestedSize }, spawnOne));
+    this.workers = spawned.filter(Boolean);
+    for (const w of this.workers) {
+      w.onmessage = (e) => this._onMessage(e.data);
+      w.onerror = (e) => this._failAll(new Error(`merit worker error: ${e?.message || 'unknown'}`));
+    }
+    return this.workers.length > 0;
+  }
+
+  /**
+   * Post the snapshot to every worker if it differs from the last one.
+   * @returns {number} snapshot version to tag tasks with
+   */
+  setSnapshot(snapshot) {
+    // rowsOverride は内容シグネチャで比較し、行そのものはパック形式で送る
+    const configs = {};
+    const fixedRows = [];
+    for (const [id, cfg] of Object.entries(snapshot?.configs || {})) {
+      if (cfg && Array.isArray(cfg.rowsOverride) && cfg.rowsOverride.length > 0) {
+        const { rowsOverride, ...rest } = cfg;
+        configs[id] = { ...rest, rowsOverride: null, rowsSignature: computeFirstOrderSignature(rowsOverride) };
+        fixedRows.push([id, rowsOverride]);
+      } else {
+        configs[id] = cfg;
+      }
+    }
+    const base = { ...snapshot, configs };
+    const json = JSON.stringify(base);
+    if (json !== this._snapshotJson) {
+      this._snapshotJson = json;
+      this.version++;
+      const packed = fixedRows.map(([id, rows]) => [id, packOpticalSystemBinary(rows, sourceWavelengths(configs[id].source))]);
+      for (const w of this.workers) {
+        const msgConfigs = { ...configs };
+        const transfer = [];
+        for (const [id, buffer] of packed) {
+          const copy = buffer.slice(0);
+          msgConfigs[id] = { ...configs[id], rowsPacked: copy };
+          transfer.push(copy);
+        }
+        w.postMessage({ ...base, configs: msgConfigs, type: 'snapshot', version: this.version }, transfer);
+      }
+    }
+    return this.version;
+  }
+
+  /**
+   * @param {Array<{configId:string, scenarioId:string|null, items:number[], set:{baseId:string,value:any}|null, perturb?:number[]|null}>} tasks
+   * @returns {Promise<Float64Array[]>} raw operand values per task (parallel to task.items)
+   */
+  run(tasks) {
+    const list = Array.isArray(tasks) ? tasks : [];
+    if (this.workers.length === 0) return Promise.reject(new Error('merit worker pool is not started'));
+    if (list.length === 0) return Promise.resolve([]);
+
+    const version = this.version;
+    return Promise.all(list.map((task, i) => new Promise((resolve, reject) => {
+      const taskId = this._nextTaskId++;
+      this._pending.set(taskId, { resolve, reject });
+      const w = this.workers[i % this.workers.length];
+      w.postMessage({
+        type: 'eval',
+        taskId,
+        version,
+        configId: task.configId,
+        scenarioId: task.scenarioId ?? null,
+        items: task.items,
+        set: task.set ?? null,
+        perturb: task.perturb ?? null
+      });
+    })));
+  }
+
+  terminate() {
+    for (const w of this.workers) {
+      try { w.terminate(); } catch (_) {}
+    }
+    this.workers = [];
+    this._failAll(new Error('merit worker pool terminated'));
+  }
+
+  _onMessage(msg) {
+    if (!msg || (msg.type !== 'result' && msg.type !== 'error')) return;
+    const p = this._pending.get(msg.taskId);
+    if (!p) return;
+    this._pending.delete(msg.taskId);
+    if (msg.type === 'result') p.resolve(msg.values);
+    else p.reject(new Error(msg.message || 'merit worker task failed'));
+  }
+
+  _failAll(err) {
+    const pending = Array.from(this._pending.values());
+    this._pending.clear();
+    for (const p of pending) p.reject(err);
+  }
+}
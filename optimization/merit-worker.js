@@ -0,0 +1,248 @@
+/**
+ * Merit evaluation worker (module worker) for optimizer-mvp.
+ *
+ * The main thread posts a serialized system snapshot (blocks / scenarios / Source・Object
+ * rows per config + the residual operand list) once per Jacobian build, then one small
+ * task per (perturbed variable × config × scenario). The worker rebuilds the optical
+ * system rows exactly as merit-function-editor's getOpticalSystemDataByConfigId() does
+ * for block-based configs and returns the raw operand values; residual / penalty
+ * shaping stays on the main thread.
+ *
+ * Only operands whose implementation is DOM-free (evaluation/operand-metrics.js,
+ * evaluation/operand-ray-metrics.js) can be evaluated here. Everything else (CLRH / LA_RMS_UM / ...)
+ * stays on the main thread.
+ *
+ * SPOT_SIZE_* operands carry `spotProbe` (createSpotSizeProbe()): the start rays of the spot diagram
+ * the main thread traced at the base point. The worker re-traces those rays through the task's rows
+ * (no re-aiming), so the base column reproduces the main-thread value and the FD columns follow
+ * the perturbed system. ZERN_COEFF uses the same live OPD/Zernike fit as the editor.
+ *
+ * Tolerancing (optimization/tolerance-monte-carlo.js) reuses the same tasks: the snapshot
+ * carries `tolerance: { tolerances, probes }` and each task a `perturb` vector (one value per
+ * tolerance, see tolerance-model.js) applied to the resolved rows. TOL_SPOT_RMS operands
+ * trace `tolerance.probes[operand.probe]`.
+ *
+ * On start the worker loads its own single-threaded ray-tracing WASM (initializeWorkerRayTracingWasm())
+ * before posting 'ready', so spot traces use traceSpotWasm() / the packed RT10 table like the main thread.
+ *
+ * Fixed rows arrive as configs[id].rowsPacked (packOpticalSystemBinary(), transferred) and are
+ * unpacked into rowsOverride once per snapshot; the buffer is kept as packedSystem for traces
+ * of the unperturbed rows.
+ *
+ * Messages (main → worker):
+ *   { type: 'snapshot', version, configs, operands, tolerance? }
+ *   { type: 'eval', taskId, version, configId, scenarioId, items, set, perturb? }
+ * Messages (worker → main):
+ *   { type: 'ready' } | { type: 'result', taskId, values } | { type: 'error', taskId, message }
+ */
+
+import { expandBlocksToOpticalSystemRows } from '../data/block-schema.js';
+import { setDesignVariableValue } from './design-variables.js';
+import { applyOverridesToBlocks } from '../core/scenarios.js';
+import {
+  PRIMARY_SYSTEM_METRIC_KEYS,
+  SEIDEL_TOTAL_OPERANDS,
+  computePrimarySystemMetrics,
+  computeSeidelTotal,
+  getSystemWavelengthFromOperandOrPrimary,
+  safeFiniteNumberOrZero
+} from '../evaluation/operand-metrics.js';
+import {
+  ZERNIKE_OPERAND,
+  computeZernikeOperandValue,
+  evaluateSpotSizeProbeUm,
+  isSpotSizeOperand
+} from '../evaluation/operand-ray-metrics.js';
+import { TOLERANCE_SPOT_OPERAND, applyTolerancePerturbations, evaluateSpotProbe } from './tolerance-model.js';
+import { unpackOpticalSystemRows } from '../data/packed-optical-system.js';
+
+const PRIMARY_METRIC_SET = new Set(PRIMARY_SYSTEM_METRIC_KEYS);
+// merit-worker-pool.js の DEFAULT_START_TIMEOUT_MS (8000) 以内に ready を返す
+const WORKER_WASM_INIT_TIMEOUT_MS = 5000;
+
+function isPlainObject(v) {
+  return !!v && typeof v === 'object' && !Array.isArray(v);
+}
+
+function cloneJson(v) {
+  try {
+    return JSON.parse(JSON.stringify(v));
+  } catch {
+    return null;
+  }
+}
+
+/**
+ * True when the operand can be evaluated inside the worker.
+ * @param {string} operand
+ */
+export function isMeritWorkerOperand(operand) {
+  const op = String(operand ?? '');
+  return PRIMARY_METRIC_SET.has(op) || Object.prototype.hasOwnProperty.call(SEIDEL_TOTAL_OPERANDS, op) ||
+    op === TOLERANCE_SPOT_OPERAND || isSpotSizeOperand(op) || op === ZERNIKE_OPERAND;
+}
+
+/**
+ * Optical system rows for one config snapshot, with an optional design-variable
+ * assignment applied before the scenario overrides (same order as the optimizer:
+ * variables live in blocks, scenarios are layered on top).
+ *
+ * @param {object} cfg - snapshot.configs[configId]
+ * @param {string|null} scenarioId - null => cfg.activeScenarioId
+ * @param {{baseId:string, value:any}|null} set
+ */
+export function resolveMeritWorkerRows(cfg, scenarioId, set) {
+  if (!cfg) return [];
+  if (Array.isArray(cfg.rowsOverride) && cfg.rowsOverride.length > 0) return cfg.rowsOverride;
+  if (!Array.isArray(cfg.blocks)) return [];
+
+  let blocks = cfg.blocks;
+  if (set && set.baseId) {
+    blocks = cloneJson(blocks);
+    setDesignVariableValue({ blocks }, set.baseId, set.value);
+  }
+
+  const sid = scenarioId ? String(scenarioId) : (cfg.activeScenarioId ? String(cfg.activeScenarioId) : null);
+  const scenarios = Array.isArray(cfg.scenarios) ? cfg.scenarios : null;
+  if (sid && scenarios) {
+    const scn = scenarios.find(s => s && String(s.id) === sid);
+    const overrides = scn && isPlainObject(scn.overrides) ? scn.overrides : null;
+    blocks = applyOverridesToBlocks(blocks, overrides);
+  }
+
+  const expanded = expandBlocksToOpticalSystemRows(blocks);
+  const rows = (expanded && Array.isArray(expanded.rows)) ? expanded.rows : [];
+  if (rows.length > 0 && !cfg.hasObjectSurface && cfg.objectThickness !== undefined && cfg.objectThickness !== null) {
+    rows[0] = { ...rows[0], thickness: cfg.objectThickness };
+  }
+  return rows;
+}
+
+/**
+ * Raw operand value (what MeritFunctionEditor.calculateOperandValue() returns).
+ */
+export function evaluateMeritWorkerOperand(operand, rows, cfg, metricsCache = null, tolerance = null, packedSystem = null) {
+  const name = String(operand?.operand ?? '');
+  if (name === TOLERANCE_SPOT_OPERAND) {
+    const probes = Array.isArray(tolerance?.probes) ? tolerance.probes : [];
+    return evaluateSpotProbe(rows, probes[Math.floor(Number(operand?.probe) || 0)], { packedSystem });
+  }
+  if (PRIMARY_METRIC_SET.has(name)) {
+    if (!Array.isArray(rows) || rows.length === 0) return 0;
+    const wavelength = getSystemWavelengthFromOperandOrPrimary(operand, cfg?.source);
+    let metrics = metricsCache ? metricsCache.get(wavelength) : null;
+    if (!metrics) {
+      metrics = computePrimarySystemMetrics(rows, wavelength);
+      if (metricsCache) metricsCache.set(wavelength, metrics);
+    }
+    return safeFiniteNumberOrZero(metrics ? metrics[name] : 0);
+  }
+  if (Object.prototype.hasOwnProperty.call(SEIDEL_TOTAL_OPERANDS, name)) {
+    return computeSeidelTotal(operand, rows, SEIDEL_TOTAL_OPERANDS[name], cfg?.source, cfg?.object, null);
+  }
+  if (isSpotSizeOperand(name)) {
+    return evaluateSpotSizeProbeUm(rows, operand?.spotProbe || null);
+  }
+  if (name === ZERNIKE_OPERAND) {
+    return computeZernikeOperandValue(operand, rows, cfg?.source, cfg?.object);
+  }
+  return NaN;
+}
+
+/**
+ * Evaluate one task against a snapshot.
+ * @returns {Float64Array} raw values, parallel to task.items
+ */
+export function evaluateMeritWorkerTask(snapshot, task) {
+  const items = Array.isArray(task?.items) ? task.items : [];
+  const values = new Float64Array(items.length).fill(NaN);
+  const cfg = snapshot?.configs ? snapshot.configs[String(task.configId)] : null;
+  if (!cfg) return values;
+
+  let rows = resolveMeritWorkerRows(cfg, task.scenarioId ?? null, task.set ?? null);
+  const tolerance = snapshot.tolerance || null;
+  if (task.perturb && Array.isArray(tolerance?.tolerances)) {
+    // rowsOverride はスナップショットそのものなので、書き換えずに摂動したコピーを使う
+    rows = applyTolerancePerturbations(rows, tolerance.tolerances, task.perturb);
+  }
+  // パック済みの面テーブルは摂動していない固定行にだけ対応する
+  const packedSystem = (cfg.rowsPacked && rows === cfg.rowsOverride) ? cfg.rowsPacked : null;
+  const metricsCache = new Map();
+  const operands = Array.isArray(snapshot.operands) ? snapshot.operands : [];
+  for (let k = 0; k < items.length; k++) {
+    const op = operands[items[k]];
+    if (!op) continue;
+    const v = Number(evaluateMeritWorkerOperand(op, rows, cfg, metricsCache, tolerance, packedSystem));
+    values[k] = v;
+  }
+  return values;
+}
+
+// --- worker entry ---
+
+const isWorkerScope = (typeof WorkerGlobalScope !== 'undefined')
+  && (typeof self !== 'undefined')
+  && (self instanceof WorkerGlobalScope);
+
+/**
+ * Load the single-threaded ray-tracing WASM (ray-tracing-wasm-v3.js) into this worker and expose it
+ * through globalThis.getWASMSystem, the hook ray-tracing.js / ray-batch-trace.js look for. The
+ * factory is a classic script (no importScripts() in module workers), so its source is fetched and
+ * evaluated; the .wasm is located next to it. Failure leaves the JS trace path in place.
+ */
+async function initializeWorkerRayTracingWasm(timeoutMs = WORKER_WASM_INIT_TIMEOUT_MS) {
+  try {
+    if (typeof fetch !== 'function' || typeof WebAssembly === 'undefined') return false;
+    const scriptUrl = new URL('../wasm/raytracing/ray-tracing-wasm-v3.js', import.meta.url);
+    const load = (async () => {
+      const res = await fetch(scriptUrl);
+      if (!res.ok) throw new Error(`HTTP ${res.status}`);
+      const factory = new Function(`${await res.text()}\n;return RayTracingWASM;`)();
+      if (typeof factory !== 'function') throw new Error('RayTracingWASM not defined');
+      return factory({ locateFile: (path) => new URL(String(path || ''), scriptUrl).href });
+    })();
+    let timer = null;
+    const timeout = new Promise((_, reject) => {
+      timer = setTimeout(() => reject(new Error('WASM initialization timeout')), timeoutMs);
+    });
+    const wasmModule = await Promise.race([load, timeout]).finally(() => clearTimeout(timer));
+    if (!wasmModule || typeof wasmModule._malloc !== 'function') return false;
+    const wasmSystem = { wasmModule, isWASMReady: true, wasmThreads: false, wasmThreadCount: 1 };
+    globalThis.getWASMSystem = () => wasmSystem;
+    return true;
+  } catch (err) {
+    console.warn('⚠️ [merit-worker] ray-tracing WASM unavailable, using the JS trace path:', err?.message || err);
+    return false;
+  }
+}
+
+if (isWorkerScope) {
+  // 最適化中は詳細ログを出さない（メインスレッドと同じ扱い）
+  globalThis.__COOPT_DISABLE_RAYTRACE_DEBUG = true;
+
+  let snapshot = null;
+
+  self.onmessage = (e) => {
+    const msg = e.data || {};
+    if (msg.type === 'snapshot') {
+      for (const cfg of Object.values(msg.configs || {})) {
+        if (cfg && cfg.rowsPacked) cfg.rowsOverride = unpackOpticalSystemRows(cfg.rowsPacked);
+      }
+      snapshot = msg;
+      return;
+    }
+    if (msg.type !== 'eval') return;
+    try {
+      if (!snapshot || snapshot.version !== msg.version) {
+        throw new Error(`snapshot version mismatch (have ${snapshot ? snapshot.version : 'none'}, want ${msg.version})`);
+      }
+      const values = evaluateMeritWorkerTask(snapshot, msg);
+      self.postMessage({ type: 'result', taskId: msg.taskId, values }, [values.buffer]);
+    } catch (err) {
+      self.postMessage({ type: 'error', taskId: msg.taskId, message: String(err?.message || err) });
+    }
+  };
+
+  // WASM の初期化を待ってから ready を返す（pool の start() タイムアウトより短く打ち切る）
+  initializeWorkerRayTracingWasm().finally(() => self.postMessage({ type: 'ready' }));
+}
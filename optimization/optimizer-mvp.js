@@ -11,6 +11,12 @@
 import { expandBlocksToOpticalSystemRows } from '../data/block-schema.js';
 import { listDesignVariablesFromBlocks, setDesignVariableValue } from './design-variables.js';
 import { getGlassDataWithSellmeier } from '../data/glass.js';
+import { isMeritWorkerOperand } from './merit-worker.js';
+import { ZERNIKE_OPERAND, isSpotSizeOperand, evaluateSpotSizeProbeDerivativesUm } from '../evaluation/operand-ray-metrics.js';
+import { RT10_DERIV_PARAM, isTraceDerivativesWasmAvailable } from '../raytracing/core/ray-batch-trace.js';
+import { findStopSurfaceIndex } from '../raytracing/core/ray-paraxial.js';
+import { MeritWorkerPool, defaultMeritWorkerCount, isMeritWorkerPoolAvailable } from './merit-worker-pool.js';
+import { createDampedSolver, formNormalEquations } from './lm-linalg.js';
 
 let __optimizerStopRequested = false;
 
@@ -177,102 +183,6 @@ function norm2Squared(v) {
   return s;
 }
 
-function solveSymmetricPositiveDefinite(A, b) {
-  // Cholesky decomposition: A = L L^T.
-  const n = b.length;
-  /** @type {number[][]} */
-  const L = Array.from({ length: n }, () => Array(n).fill(0));
-
-  for (let i = 0; i < n; i++) {
-    for (let j = 0; j <= i; j++) {
-      let sum = A[i][j];
-      for (let k = 0; k < j; k++) sum -= L[i][k] * L[j][k];
-      if (i === j) {
-        if (!(sum > 0) || !Number.isFinite(sum)) return null;
-        L[i][j] = Math.sqrt(sum);
-      } else {
-        const denom = L[j][j];
-        if (!Number.isFinite(denom) || denom === 0) return null;
-        L[i][j] = sum / denom;
-      }
-    }
-  }
-
-  // Solve L y = b
-  const y = Array(n).fill(0);
-  for (let i = 0; i < n; i++) {
-    let sum = b[i];
-    for (let k = 0; k < i; k++) sum -= L[i][k] * y[k];
-    const denom = L[i][i];
-    if (!Number.isFinite(denom) || denom === 0) return null;
-    y[i] = sum / denom;
-  }
-
-  // Solve L^T x = y
-  const x = Array(n).fill(0);
-  for (let i = n - 1; i >= 0; i--) {
-    let sum = y[i];
-    for (let k = i + 1; k < n; k++) sum -= L[k][i] * x[k];
-    const denom = L[i][i];
-    if (!Number.isFinite(denom) || denom === 0) return null;
-    x[i] = sum / denom;
-  }
-
-  return x;
-}
-
-function solveLinearSystemFallback(A, b) {
-  // Gaussian elimination with partial pivoting.
-  const n = b.length;
-  const M = A.map((row) => row.slice());
-  const x = b.slice();
-
-  for (let k = 0; k < n; k++) {
-    // pivot
-    let pivotRow = k;
-    let pivotVal = Math.abs(M[k][k]);
-    for (let i = k + 1; i < n; i++) {
-      const v = Math.abs(M[i][k]);
-      if (v > pivotVal) {
-        pivotVal = v;
-        pivotRow = i;
-      }
-    }
-    if (!Number.isFinite(pivotVal) || pivotVal === 0) return null;
-    if (pivotRow !== k) {
-      const tmp = M[k];
-      M[k] = M[pivotRow];
-      M[pivotRow] = tmp;
-      const t = x[k];
-      x[k] = x[pivotRow];
-      x[pivotRow] = t;
-    }
-
-    // eliminate
-    const pivot = M[k][k];
-    for (let i = k + 1; i < n; i++) {
-      const f = M[i][k] / pivot;
-      if (!Number.isFinite(f)) return null;
-      M[i][k] = 0;
-      for (let j = k + 1; j < n; j++) {
-        M[i][j] -= f * M[k][j];
-      }
-      x[i] -= f * x[k];
-    }
-  }
-
-  // back substitute
-  const out = Array(n).fill(0);
-  for (let i = n - 1; i >= 0; i--) {
-    let sum = x[i];
-    for (let j = i + 1; j < n; j++) sum -= M[i][j] * out[j];
-    const denom = M[i][i];
-    if (!Number.isFinite(denom) || denom === 0) return null;
-    out[i] = sum / denom;
-  }
-  return out;
-}
-
 function buildResidualVectorFromBreakdown(breakdown) {
   const terms = Array.isArray(breakdown?.terms) ? breakdown.terms : [];
   const residuals = [];
@@ -918,47 +828,47 @@ function updateActiveOpticalSystemOverrideFromBlocks(activeBlocks) {
   }
 }
 
+function clampJointValueForBlocks(blocks, baseId, rawValue) {
+  try {
+    const n = (typeof rawValue === 'number') ? rawValue : Number(rawValue);
+    if (!Number.isFinite(n)) return rawValue;
+
+    const entry = getVariableEntryFromBlocks(blocks, baseId);
+    const opt = (entry && typeof entry === 'object') ? entry.optimize : null;
+
+    // Respect explicit bounds if present.
+    const minV = (opt && Number.isFinite(Number(opt.min))) ? Number(opt.min) : null;
+    const maxV = (opt && Number.isFinite(Number(opt.max))) ? Number(opt.max) : null;
+    if (minV !== null || maxV !== null) {
+      const lo = (minV !== null) ? minV : -Infinity;
+      const hi = (maxV !== null) ? maxV : Infinity;
+      const clamped = Math.max(lo, Math.min(hi, n));
+      return Number.isFinite(clamped) ? clamped : rawValue;
+    }
+
+    // REMOVED: Default safety clamp for asphere coefficients
+    // User requested unrestricted optimization for aspherical coefficients (A4-A22)
+    // If explicit min/max bounds are set, they will be respected above
+    // If clampAbsMax is set in optimize options, users can still apply custom limits
+
+    return rawValue;
+  } catch (_) {
+    return rawValue;
+  }
+}
+
 function setJointDesignVariableValue({ blocksByConfigId, targetConfigIds, activeConfigId }, jointVariableId, newValue) {
   const { configId, baseId } = parseJointVariableId(jointVariableId);
   const activeId = String(activeConfigId ?? '').trim();
   const ids = Array.isArray(targetConfigIds) ? targetConfigIds.map(id => String(id)) : [];
 
-  const clampValueIfNeeded = (blocks, rawValue) => {
-    try {
-      const n = (typeof rawValue === 'number') ? rawValue : Number(rawValue);
-      if (!Number.isFinite(n)) return rawValue;
-
-      const entry = getVariableEntryFromBlocks(blocks, baseId);
-      const opt = (entry && typeof entry === 'object') ? entry.optimize : null;
-
-      // Respect explicit bounds if present.
-      const minV = (opt && Number.isFinite(Number(opt.min))) ? Number(opt.min) : null;
-      const maxV = (opt && Number.isFinite(Number(opt.max))) ? Number(opt.max) : null;
-      if (minV !== null || maxV !== null) {
-        const lo = (minV !== null) ? minV : -Infinity;
-        const hi = (maxV !== null) ? maxV : Infinity;
-        const clamped = Math.max(lo, Math.min(hi, n));
-        return Number.isFinite(clamped) ? clamped : rawValue;
-      }
-
-      // REMOVED: Default safety clamp for asphere coefficients
-      // User requested unrestricted optimization for aspherical coefficients (A4-A22)
-      // If explicit min/max bounds are set, they will be respected above
-      // If clampAbsMax is set in optimize options, users can still apply custom limits
-
-      return rawValue;
-    } catch (_) {
-      return rawValue;
-    }
-  };
-
   const applyTo = configId ? [String(configId)] : ids;
   let okAny = false;
   for (const cid of applyTo) {
     const blocks = blocksByConfigId ? blocksByConfigId[cid] : null;
     if (!Array.isArray(blocks)) continue;
     const cfgView = { blocks };
-    const v2 = clampValueIfNeeded(blocks, newValue);
+    const v2 = clampJointValueForBlocks(blocks, baseId, newValue);
     const ok = setDesignVariableValue(cfgView, baseId, v2);
     if (ok) okAny = true;
     if (cid === activeId) {
@@ -1146,6 +1056,165 @@ function computeAmountOrPenalty(op, rawCurrent, target, tol) {
   return { ok: true, current: s.current, amount, reason: amount > 0 ? 'violation' : 'ok' };
 }
 
+// d computeViolationAmount() / d current (0 where the requirement is satisfied).
+function computeViolationSlope(op, current, target, tol) {
+  const amount = computeViolationAmount(op, current, target, tol);
+  if (!(amount > 0)) return 0;
+  if (op === '<=') return 1;
+  if (op === '>=') return -1;
+  return (Number(current) >= toFiniteNumber(target, NaN)) ? 1 : -1;
+}
+
+function sameRowFieldValue(a, b) {
+  if (a === b) return true;
+  try {
+    return JSON.stringify(a) === JSON.stringify(b);
+  } catch (_) {
+    return false;
+  }
+}
+
+// Which optical-system row fields a design variable drives: set it to x + h, re-expand each config's blocks
+// and diff against baseRowsByCfg. Returns Map(configId -> [{ row, param, scale }]) with
+// scale = d(row field) / d(variable), or null when the variable also changes something
+// traceRaysBatchDerivatives() cannot differentiate (material, semidia, surfType switch, Object distance, ...).
+// The variable is restored to x before returning.
+function mapDesignVariableToRowFields(jointState, baseRowsByCfg, id, x, h) {
+  if (!(Number.isFinite(h) && h !== 0 && Number.isFinite(x))) return null;
+  const out = new Map();
+  try {
+    setJointDesignVariableValue(jointState, id, x + h);
+    for (const [cfgId, baseRows] of baseRowsByCfg) {
+      const blocks = jointState.blocksByConfigId ? jointState.blocksByConfigId[cfgId] : null;
+      const expanded = Array.isArray(blocks) ? expandBlocksToOpticalSystemRows(blocks) : null;
+      const rows = (expanded && Array.isArray(expanded.rows)) ? expanded.rows : null;
+      if (!rows || rows.length !== baseRows.length) return null;
+      const entries = [];
+      for (let i = 0; i < rows.length; i++) {
+        const a = baseRows[i] || {};
+        const b = rows[i] || {};
+        const fields = new Set([...Object.keys(a), ...Object.keys(b)]);
+        for (const field of fields) {
+          if (sameRowFieldValue(a[field], b[field])) continue;
+          if (i === 0 || !Object.prototype.hasOwnProperty.call(RT10_DERIV_PARAM, field)) return null;
+          const va = Number(a[field]);
+          const vb = Number(b[field]);
+          if (!Number.isFinite(va) || !Number.isFinite(vb)) return null;
+          // The kernel treats radius = 0 as a plane (zero derivative); INF <-> finite needs differences.
+          if (field === 'radius' && (va === 0 || vb === 0)) return null;
+          entries.push({ row: i, param: field, scale: (vb - va) / h });
+        }
+      }
+      out.set(cfgId, entries);
+    }
+    return out;
+  } catch (_) {
+    return null;
+  } finally {
+    setJointDesignVariableValue(jointState, id, x);
+  }
+}
+
+// Built-in LM analyticJacobian provider for SPOT_SIZE_* residuals.
+// Each residual is sqrtW * computeViolationAmount(spot value); the spot value is differentiated with
+// traceRaysBatchDerivatives() on the rays the editor traced at the base point (evalResidualsNow().spotProbes).
+// Those rays are frozen, while the editor aims every Jacobian-column spot diagram at the stop again, so only
+// fields that cannot move the aimed rays are differentiated: radius/conic/coef after the stop and thickness from
+// the stop on. Design variables reach the rows through mapDesignVariableToRowFields(); a variable that touches
+// anything else (a lens in front of the stop, material, ...) keeps its forward-difference column.
+// A column is returned only when every weighted residual can be differentiated (a column mixes all residuals),
+// so OPD/Zernike and other operands – and scenario items, whose rows the editor overrides – keep forward
+// differences for every column.
+function createRayDerivativeJacobian({ items, jointState, defaultConfigId }) {
+  return ({ ids, x, hs, residuals, spotProbes, spotProbeRows }) => {
+    if (!isTraceDerivativesWasmAvailable()) return null;
+    if (!Array.isArray(ids) || !Array.isArray(x) || !Array.isArray(hs) || !Array.isArray(residuals)) return null;
+    const m = residuals.length;
+    if (!Array.isArray(spotProbes) || !Array.isArray(spotProbeRows) || !Array.isArray(items) || items.length !== m) return null;
+
+    const active = [];
+    for (let i = 0; i < m; i++) {
+      const it = items[i];
+      const r = it?.req;
+      const w = Math.max(0, toFiniteNumber(r?.weight, 1)) * Math.max(0, toFiniteNumber(it?.scenarioWeight, 1));
+      if (!(w > 0)) continue;
+      if (it?.scenarioId || !isSpotSizeOperand(r?.operand)) return null;
+      const probe = spotProbes[i];
+      const rows = spotProbeRows[i];
+      if (!probe || !Array.isArray(rows)) return null;
+      const cfgId = String(it?.configId ?? '').trim() || String(defaultConfigId ?? '').trim();
+      active.push({ i, cfgId, probe, rows, req: r, sqrtW: Math.sqrt(w) });
+    }
+    if (active.length === 0) return null;
+
+    const baseRowsByCfg = new Map();
+    const stopByCfg = new Map();
+    for (const a of active) {
+      if (baseRowsByCfg.has(a.cfgId)) continue;
+      const blocks = jointState.blocksByConfigId ? jointState.blocksByConfigId[a.cfgId] : null;
+      const expanded = Array.isArray(blocks) ? expandBlocksToOpticalSystemRows(blocks) : null;
+      if (!expanded || !Array.isArray(expanded.rows)) return null;
+      const stop = findStopSurfaceIndex(expanded.rows);
+      if (!(stop > 0)) return null;
+      baseRowsByCfg.set(a.cfgId, expanded.rows);
+      stopByCfg.set(a.cfgId, stop);
+    }
+
+    const behindStop = (mp) => {
+      for (const [cfgId, entries] of mp) {
+        const stop = stopByCfg.get(cfgId);
+        for (const e of entries) {
+          if (e.param === 'thickness' ? e.row < stop : e.row <= stop) return false;
+        }
+      }
+      return true;
+    };
+    const maps = ids.map((id, j) => {
+      const mp = mapDesignVariableToRowFields(jointState, baseRowsByCfg, id, x[j], hs[j]);
+      return (mp && behindStop(mp)) ? mp : null;
+    });
+    const cols = maps.map(mp => (mp ? new Float64Array(m) : null));
+    if (cols.every(c => !c)) return null;
+
+    for (const a of active) {
+      const baseRows = baseRowsByCfg.get(a.cfgId);
+      // The probe rows must be the expanded rows (UI rows may have a different layout, e.g. pending CBs).
+      if (a.rows.length !== baseRows.length) return null;
+      const paramIndex = new Map();
+      const params = [];
+      for (const mp of maps) {
+        for (const e of (mp ? (mp.get(a.cfgId) || []) : [])) {
+          const k = `${e.row}:${e.param}`;
+          if (paramIndex.has(k)) continue;
+          if (Number(a.rows[e.row]?.[e.param]) !== Number(baseRows[e.row]?.[e.param])) return null;
+          paramIndex.set(k, params.length);
+          params.push({ surface: e.row, param: e.param });
+        }
+      }
+      if (params.length === 0) continue;
+
+      const d = evaluateSpotSizeProbeDerivativesUm(a.rows, a.probe, params);
+      if (!d) return null;
+      const evaluated = computeAmountOrPenalty(a.req?.op, d.value, a.req?.target, a.req?.tol);
+      if (!evaluated.ok) return null;
+      // The probe (WASM) must reproduce the residual the step is built around.
+      const expected = a.sqrtW * Math.max(0, evaluated.amount);
+      if (!(Math.abs(expected - residuals[a.i]) <= 1e-6 * Math.max(1, Math.abs(residuals[a.i])))) return null;
+      const slope = a.sqrtW * computeViolationSlope(a.req?.op, evaluated.current, a.req?.target, a.req?.tol);
+      if (slope === 0) continue;
+
+      for (let j = 0; j < maps.length; j++) {
+        const entries = maps[j] ? maps[j].get(a.cfgId) : null;
+        if (!entries) continue;
+        let g = 0;
+        for (const e of entries) g += e.scale * d.gradient[paramIndex.get(`${e.row}:${e.param}`)];
+        cols[j][a.i] = slope * g;
+      }
+    }
+    return cols;
+  };
+}
+
 function compareEval(a, b) {
   // Return true if a is strictly better than b.
   if (!b) return true;
@@ -2199,6 +2268,12 @@ export async function runOptimizationMVP(options = {}) {
 
   const lmLambda0 = Number.isFinite(Number(opts.lmLambda0)) ? Math.max(1e-12, Number(opts.lmLambda0)) : 1e-3;
   const lmLambdaUp = Number.isFinite(Number(opts.lmLambdaUp)) ? Math.max(1.1, Number(opts.lmLambdaUp)) : 10;
+  // Damped-solve retries per iteration when the linear solve fails (each retry multiplies lambda by lmLambdaUp
+  // and refactors the same J^T J; 0 = start a new iteration immediately as before).
+  const lmSolveRetries = Number.isFinite(Number(opts.lmSolveRetries)) ? Math.max(0, Math.floor(Number(opts.lmSolveRetries))) : 3;
+  // Damped re-solves per iteration after every trial step was rejected: lambda *= lmLambdaUp and the same
+  // J^T J / factorisation setup is solved again at x0 (one candidate evaluation each, no new Jacobian).
+  const lmRejectRetries = Number.isFinite(Number(opts.lmRejectRetries)) ? Math.max(0, Math.floor(Number(opts.lmRejectRetries))) : 2;
   const lmLambdaDown = Number.isFinite(Number(opts.lmLambdaDown)) ? Math.min(0.95, Math.max(1e-3, Number(opts.lmLambdaDown))) : 0.3;
   // Nielsen/Marquardt adaptive damping: use tau to scale initial lambda based on J^T*J
   const lmTau = Number.isFinite(Number(opts.lmTau)) ? Math.max(1e-6, Number(opts.lmTau)) : 1e-3;
@@ -2207,6 +2282,15 @@ export async function runOptimizationMVP(options = {}) {
   // A too-large absolute FD step will destroy Jacobians for coef vars.
   const fdMinStep = Number.isFinite(Number(opts.fdMinStep)) ? Math.max(1e-30, Number(opts.fdMinStep)) : 1e-18;
   const fdScaledStep = Number.isFinite(Number(opts.fdScaledStep)) ? Math.max(1e-9, Number(opts.fdScaledStep)) : 8e-3;
+  // Analytic Jacobian columns for LM. Called once per iteration as
+  //   analyticJacobian({ iter, ids, keys, x, hs, residuals, spotProbes, spotProbeRows })
+  //     -> Array<ArrayLike<number>|null> (one entry per variable)
+  // Columns that are null/short fall back to forward differences. Unset: the built-in provider
+  // (createRayDerivativeJacobian(), SPOT_SIZE_* residuals via traceRaysBatchDerivatives()) when the
+  // WASM derivative kernel is available; false: forward differences only.
+  const analyticJacobianOpt = (typeof opts.analyticJacobian === 'function')
+    ? opts.analyticJacobian
+    : (opts.analyticJacobian === false ? false : null);
 
   // Aspheric coefficient regularization (Tikhonov): penalizes large high-order terms
   // Helps prevent overfitting and improves manufacturability
@@ -2610,11 +2694,21 @@ export async function runOptimizationMVP(options = {}) {
       __prevOpticalSystemRowsOverride = undefined;
     }
 
+    /** @type {MeritWorkerPool|null} */
+    let meritPool = null;
+
     try {
 
     // Use a fixed-length residual vector for LM so the Jacobian dimension is stable.
     // Multi-config: residual items are pre-expanded by (configs × requirements × scenarios).
     const residualItemsForLM = residualItems;
+    const analyticJacobian = (typeof analyticJacobianOpt === 'function')
+      ? analyticJacobianOpt
+      : ((analyticJacobianOpt !== false && isTraceDerivativesWasmAvailable())
+        ? createRayDerivativeJacobian({ items: residualItemsForLM, jointState, defaultConfigId: activeConfigId })
+        : null);
+    // The built-in provider differentiates the spot rays of every SPOT_SIZE_* item at the base point.
+    const captureAllSpotProbes = !!analyticJacobian && analyticJacobian !== analyticJacobianOpt;
     const nonFiniteResidualPenalty = Number.isFinite(Number(opts.nonFiniteResidualPenalty))
       ? Math.max(1, Number(opts.nonFiniteResidualPenalty))
       : 1e4;
@@ -2626,9 +2720,16 @@ export async function runOptimizationMVP(options = {}) {
 
     // Residuals are built from Requirements violation amounts.
     // Hard+soft are both included as residuals (soft continues to improve after feasible).
-    const evalResidualsNow = () => {
+    // evalOpts.skipItems (Uint8Array, per residual item): items evaluated elsewhere (merit worker pool);
+    // they are left as 0 here and filled in by the caller.
+    const evalResidualsNow = (evalOpts = null) => {
       /** @type {number[]} */
       const residuals = [];
+      const skipItems = (evalOpts && evalOpts.skipItems) ? evalOpts.skipItems : null;
+      // Spot rays of worker SPOT_SIZE_* items at this point (see buildMeritPoolSnapshot()), or of every
+      // SPOT_SIZE_* item for the built-in analytic Jacobian (with the rows they were traced on).
+      const spotProbes = (meritPool || captureAllSpotProbes) ? new Array(residualItemsForLM.length).fill(null) : null;
+      const spotProbeRows = captureAllSpotProbes ? new Array(residualItemsForLM.length).fill(null) : null;
 
       // Also compute the linear composite score (same semantics as evalCompositeFromRequirements)
       // without re-evaluating operands.
@@ -2661,6 +2762,10 @@ export async function runOptimizationMVP(options = {}) {
         }
 
         for (let itemIndex = 0; itemIndex < itemsArr.length; itemIndex++) {
+          if (skipItems && skipItems[itemIndex]) {
+            residuals.push(0);
+            continue;
+          }
           const it = itemsArr[itemIndex];
           const r = it?.req;
           const cfgIdRaw = String(it?.configId ?? '').trim();
@@ -2715,8 +2820,13 @@ export async function runOptimizationMVP(options = {}) {
           target: r?.target,
           weight: r?.weight
         };
+        const captureSpotProbe = !!spotProbes && isSpotSizeOperand(r?.operand)
+          && (captureAllSpotProbes || meritPoolPlan.workerMask[itemIndex] === 1);
+        if (captureSpotProbe) opObj.__captureSpotProbe = true;
 
         const evaluated = computeAmountOrPenalty(r?.op, editor.calculateOperandValue(opObj), r?.target, r?.tol);
+        if (captureSpotProbe) spotProbes[itemIndex] = opObj.__spotProbe || null;
+        if (captureSpotProbe && spotProbeRows) spotProbeRows[itemIndex] = opObj.__spotProbeRows || null;
         const current = evaluated.current;
         let residualVal = 0;
         const amount = evaluated.amount;
@@ -2862,15 +2972,15 @@ export async function runOptimizationMVP(options = {}) {
           }
         }
       } catch (_) {}
-      return { cost, residuals, breakdown: null, composite };
+      return { cost, residuals, breakdown: null, composite, spotProbes, spotProbeRows };
     };
 
     const evalResidualsNowProfiled = __profile
-      ? () => {
+      ? (evalOpts = null) => {
         const t = nowMs();
         try {
           __profile.counts.evalResidualsNowCalls++;
-          return evalResidualsNow();
+          return evalResidualsNow(evalOpts);
         } finally {
           const dt = nowMs() - t;
           __profile.counts.evalResidualsNowMs += dt;
@@ -2879,6 +2989,192 @@ export async function runOptimizationMVP(options = {}) {
       }
       : evalResidualsNow;
 
+    // Merit worker pool: Jacobian columns × (config, scenario) groups for operands with a
+    // DOM-free implementation (optimization/merit-worker.js). Other operands stay on the
+    // main thread; with only worker operands, the main thread just does the LM algebra.
+    // ZERN_COEFF stays on the main thread while OPD Analysis' wavefrontMap is shown, because
+    // the editor then reads that (fixed) map instead of fitting the current system.
+    const meritPoolPlan = (() => {
+      const itemsArr = Array.isArray(residualItemsForLM) ? residualItemsForLM : [];
+      const workerMask = new Uint8Array(itemsArr.length);
+      const groupsByKey = new Map();
+      let workerCount = 0;
+      for (let itemIndex = 0; itemIndex < itemsArr.length; itemIndex++) {
+        const it = itemsArr[itemIndex];
+        const r = it?.req;
+        if (!r || !isMeritWorkerOperand(r.operand)) continue;
+        if (r.operand === ZERNIKE_OPERAND && typeof window !== 'undefined' && window.__lastWavefrontMap?.zernike) continue;
+        const cfgId = String(it?.configId ?? '').trim() || String(activeConfigId ?? '').trim();
+        if (!cfgId || !configsById[cfgId] || !Array.isArray(blocksByConfigId[cfgId])) continue;
+        const w = Math.max(0, toFiniteNumber(r.weight, 1)) * Math.max(0, toFiniteNumber(it?.scenarioWeight, 1));
+        if (!(w > 0) || !Number.isFinite(Math.sqrt(w))) continue;
+
+        const sid = it?.scenarioId ? String(it.scenarioId) : null;
+        const key = `${cfgId}\u0000${sid ?? ''}`;
+        if (!groupsByKey.has(key)) groupsByKey.set(key, { configId: cfgId, scenarioId: sid, items: [] });
+        groupsByKey.get(key).items.push(itemIndex);
+        workerMask[itemIndex] = 1;
+        workerCount++;
+      }
+      return {
+        workerMask,
+        workerCount,
+        groups: Array.from(groupsByKey.values()),
+        hasMainItems: workerCount < itemsArr.length
+      };
+    })();
+
+    const meritWorkersEnabled = (opts.meritWorkers === undefined) ? true : !!opts.meritWorkers;
+    if (meritWorkersEnabled && meritPoolPlan.workerCount > 0 && isMeritWorkerPoolAvailable()) {
+      const requested = Number.isFinite(Number(opts.meritWorkerCount))
+        ? Math.max(1, Math.floor(Number(opts.meritWorkerCount)))
+        : defaultMeritWorkerCount();
+      const pool = new MeritWorkerPool({ size: requested });
+      let started = false;
+      try {
+        started = await pool.start();
+      } catch (_) {
+        started = false;
+      }
+      if (started) {
+        meritPool = pool;
+        console.log('🧵 [OptimizerMVP] merit worker pool', {
+          workers: pool.size,
+          workerItems: meritPoolPlan.workerCount,
+          residualItems: residualItemsForLM.length,
+          groups: meritPoolPlan.groups.length
+        });
+      } else {
+        pool.terminate();
+      }
+    }
+
+    const disableMeritPool = (why) => {
+      if (!meritPool) return;
+      console.warn(`⚠️ [OptimizerMVP] merit worker pool disabled (${why}); evaluating serially.`);
+      try { meritPool.terminate(); } catch (_) {}
+      meritPool = null;
+    };
+
+    // Serialized system for the workers. Mirrors what merit-function-editor's
+    // getOpticalSystemDataByConfigId() reads for block-based configs.
+    // spotProbes: evalResidualsNow().spotProbes of the base point (rays for SPOT_SIZE_* items).
+    const buildMeritPoolSnapshot = (spotProbes = null) => {
+      const configs = {};
+      const cfgIds = new Set(meritPoolPlan.groups.map(g => g.configId));
+      const lsTableRows = (() => {
+        try {
+          const raw = (typeof localStorage !== 'undefined') ? localStorage.getItem('OpticalSystemTableData') : null;
+          const parsed = raw ? JSON.parse(raw) : null;
+          return Array.isArray(parsed) ? parsed : null;
+        } catch (_) {
+          return null;
+        }
+      })();
+      const hasValue = (v) => v !== undefined && v !== null && String(v).trim() !== '';
+
+      for (const cfgId of cfgIds) {
+        const cfg = configsById[cfgId];
+        const hasObjectSurface = Array.isArray(cfg?.blocks) && cfg.blocks.some(b => String(b?.blockType ?? '').trim() === 'ObjectSurface');
+        let objectThickness = null;
+        const persisted = cfg?.opticalSystem?.[0]?.thickness;
+        if (hasValue(persisted)) {
+          objectThickness = persisted;
+        } else if (systemConfig && String(systemConfig.activeConfigId) === cfgId && hasValue(lsTableRows?.[0]?.thickness)) {
+          objectThickness = lsTableRows[0].thickness;
+        }
+
+        let rowsOverride = null;
+        try {
+          const cached = (typeof window !== 'undefined' && window.__cooptOpticalSystemByConfigId)
+            ? window.__cooptOpticalSystemByConfigId[cfgId]
+            : null;
+          if (Array.isArray(cached) && cached.length > 0) rowsOverride = cached;
+        } catch (_) {}
+
+        let tables = { source: [], object: [] };
+        try {
+          if (editor && typeof editor.getConfigTablesByConfigId === 'function') {
+            tables = editor.getConfigTablesByConfigId(cfgId) || tables;
+          }
+        } catch (_) {}
+
+        configs[cfgId] = {
+          blocks: blocksByConfigId[cfgId],
+          scenarios: Array.isArray(cfg?.scenarios)
+            ? cfg.scenarios.filter(Boolean).map(sc => ({ id: sc.id, overrides: sc.overrides }))
+            : null,
+          activeScenarioId: (cfg?.activeScenarioId !== undefined && cfg?.activeScenarioId !== null) ? String(cfg.activeScenarioId) : null,
+          hasObjectSurface,
+          objectThickness,
+          rowsOverride,
+          source: Array.isArray(tables.source) ? tables.source : [],
+          object: Array.isArray(tables.object) ? tables.object : []
+        };
+      }
+
+      const operands = residualItemsForLM.map((it, itemIndex) => {
+        if (!meritPoolPlan.workerMask[itemIndex]) return null;
+        const r = it.req;
+        return {
+          operand: r.operand,
+          configId: String(it?.configId ?? '').trim() || String(activeConfigId ?? '').trim(),
+          param1: r.param1,
+          param2: r.param2,
+          param3: r.param3,
+          param4: r.param4,
+          spotProbe: spotProbes ? spotProbes[itemIndex] : null
+        };
+      });
+      return { configs, operands };
+    };
+
+    // Same shaping as the evalResidualsNow() loop, for a raw operand value computed by a worker.
+    const residualFromWorkerValue = (itemIndex, rawCurrent) => {
+      const it = residualItemsForLM[itemIndex];
+      const r = it?.req;
+      const w = Math.max(0, toFiniteNumber(r?.weight, 1)) * Math.max(0, toFiniteNumber(it?.scenarioWeight, 1));
+      const sqrtW = Math.sqrt(w);
+      const evaluated = computeAmountOrPenalty(r?.op, rawCurrent, r?.target, r?.tol);
+      if (evaluated.reason !== 'ok' && evaluated.reason !== 'violation') return sqrtW * nonFiniteResidualPenalty;
+      return sqrtW * Math.max(0, evaluated.amount);
+    };
+
+    // Dispatch base (unperturbed) + one task per FD column and group.
+    // Returns a promise of { base: Float64Array(m), cols: Map<j, Float64Array(m)> } in residual units.
+    const dispatchMeritPoolJacobian = (fdCols, x0, ids, hs, spotProbes = null) => {
+      meritPool.setSnapshot(buildMeritPoolSnapshot(spotProbes));
+      const m = residualItemsForLM.length;
+      const columns = [null, ...fdCols];
+      const tasks = [];
+      for (const j of columns) {
+        for (const g of meritPoolPlan.groups) {
+          let set = null;
+          if (j !== null) {
+            const { configId: varCfg, baseId } = parseJointVariableId(ids[j]);
+            if (!varCfg || String(varCfg) === g.configId) {
+              set = { baseId, value: clampJointValueForBlocks(blocksByConfigId[g.configId], baseId, x0[j] + hs[j]) };
+            }
+          }
+          tasks.push({ col: j, configId: g.configId, scenarioId: g.scenarioId, items: g.items, set });
+        }
+      }
+      return meritPool.run(tasks).then((results) => {
+        const base = new Float64Array(m);
+        const cols = new Map(fdCols.map(j => [j, new Float64Array(m)]));
+        for (let t = 0; t < tasks.length; t++) {
+          const task = tasks[t];
+          const out = (task.col === null) ? base : cols.get(task.col);
+          const values = results[t];
+          for (let k = 0; k < task.items.length; k++) {
+            const itemIndex = task.items[k];
+            out[itemIndex] = residualFromWorkerValue(itemIndex, values[k]);
+          }
+        }
+        return { base, cols };
+      });
+    };
+
     const snapshotX = () => {
       return vars.map(v => ({
         id: v.id,
@@ -3314,13 +3610,58 @@ export async function runOptimizationMVP(options = {}) {
       }
 
       /** @type {number[][]} */
-      const J = Array.from({ length: m }, () => Array(n).fill(0));
+      // Column-major (J[j * m + i]): one contiguous column per variable, as lm-linalg.js expects.
+      const J = new Float64Array(m * n);
+      // Numerical stability: clamp extremely large derivatives (likely numerical errors)
+      // This prevents singular or near-singular Jacobian matrices
+      const maxDerivMag = 1e12;
+
+      const hs = x0.map((xj, j) => finiteDifferenceStepForVar({ id: ids[j], key: keys[j], value: xj }));
+
+      let analyticCols = null;
+      if (analyticJacobian) {
+        try {
+          analyticCols = analyticJacobian({
+            iter, ids: ids.slice(), keys: keys.slice(), x: x0.slice(), hs: hs.slice(), residuals: r0.slice(),
+            spotProbes: base.spotProbes, spotProbeRows: base.spotProbeRows
+          });
+        } catch (_) {
+          analyticCols = null;
+        }
+        if (!Array.isArray(analyticCols)) analyticCols = null;
+      }
+      const fdCols = [];
+      for (let j = 0; j < n; j++) {
+        const col = analyticCols ? analyticCols[j] : null;
+        if (!(col && col.length >= m)) fdCols.push(j);
+      }
+
+      // Worker operands for every FD column are dispatched up front; the loop below then only
+      // evaluates the main-thread operands (none at all when every operand runs in a worker).
+      let poolJacobian = null;
+      if (meritPool && fdCols.length > 0 && m === residualItemsForLM.length) {
+        const tPool = nowMs();
+        poolJacobian = dispatchMeritPoolJacobian(fdCols, x0, ids, hs, base.spotProbes)
+          .catch((e) => ({ error: e }))
+          .finally(() => { if (__profile) __profAdd('meritWorkerJacobian', nowMs() - tPool); });
+      }
+      const poolOnly = !!poolJacobian && !meritPoolPlan.hasMainItems;
 
       for (let j = 0; j < n; j++) {
         if (shouldStop && shouldStop()) break;
 
+        const col = analyticCols ? analyticCols[j] : null;
+        if (col && col.length >= m) {
+          for (let i = 0; i < m; i++) {
+            const derivative = Number(col[i]);
+            J[j * m + i] = Number.isFinite(derivative) ? Math.max(-maxDerivMag, Math.min(maxDerivMag, derivative)) : 0;
+          }
+          continue;
+        }
+        if (poolOnly) continue;
+
         const xj = x0[j];
-        const h = finiteDifferenceStepForVar({ id: ids[j], key: keys[j], value: xj });
+        const h = hs[j];
         const xPert = x0.slice();
         xPert[j] = xj + h;
 
@@ -3330,22 +3671,19 @@ export async function runOptimizationMVP(options = {}) {
         }
         maybeSave('jacobian');
 
-        const br = evalResidualsNowProfiled();
+        const br = evalResidualsNowProfiled(poolJacobian ? { skipItems: meritPoolPlan.workerMask } : null);
         const r1 = br.residuals;
         const mm = Math.min(m, r1.length);
         for (let i = 0; i < mm; i++) {
           const derivative = (r1[i] - r0[i]) / h;
-          // Numerical stability: clamp extremely large derivatives (likely numerical errors)
-          // This prevents singular or near-singular Jacobian matrices
-          const maxDerivMag = 1e12;
           if (Number.isFinite(derivative)) {
-            J[i][j] = Math.max(-maxDerivMag, Math.min(maxDerivMag, derivative));
+            J[j * m + i] = Math.max(-maxDerivMag, Math.min(maxDerivMag, derivative));
           } else {
-            J[i][j] = 0; // Treat NaN/Inf as zero derivative
+            J[j * m + i] = 0; // Treat NaN/Inf as zero derivative
           }
         }
         for (let i = mm; i < m; i++) {
-          J[i][j] = 0;
+          J[j * m + i] = 0;
         }
 
         if (onProgress) {
@@ -3360,32 +3698,61 @@ export async function runOptimizationMVP(options = {}) {
       }
       maybeSave('jacobian');
 
-      if (shouldStop && shouldStop()) break;
-
-      // Compute normal equations: A = J^T J, g = J^T r
-      /** @type {number[][]} */
-      const A = Array.from({ length: n }, () => Array(n).fill(0));
-      const g = Array(n).fill(0);
-
-      for (let j = 0; j < n; j++) {
-        let gj = 0;
-        for (let i = 0; i < m; i++) {
-          gj += J[i][j] * r0[i];
+      if (poolJacobian) {
+        const res = await poolJacobian;
+        const mask = meritPoolPlan.workerMask;
+        let ok = !res.error;
+        if (!ok) {
+          disableMeritPool(String(res.error?.message || res.error));
+        } else {
+          // The worker base must match the main-thread residuals, otherwise (r1 - r0)/h would mix
+          // two evaluators. Any mismatch (e.g. a config the snapshot does not describe) → serial.
+          for (let i = 0; i < m; i++) {
+            if (!mask[i]) continue;
+            const a = res.base[i];
+            const b = r0[i];
+            if (!(Math.abs(a - b) <= 1e-9 * Math.max(1, Math.abs(a), Math.abs(b)))) {
+              ok = false;
+              disableMeritPool(`worker residual ${i} = ${a} differs from main thread ${b}`);
+              break;
+            }
+          }
         }
-        g[j] = gj;
-      }
 
-      for (let j = 0; j < n; j++) {
-        for (let k = 0; k <= j; k++) {
-          let s = 0;
+        for (const j of fdCols) {
+          if (shouldStop && shouldStop()) break;
+          const h = hs[j];
+          let r1w = null;
+          if (ok) {
+            r1w = res.cols.get(j);
+          } else {
+            // Fallback: evaluate this column on the main thread (worker items only are missing).
+            const xPert = x0.slice();
+            xPert[j] = x0[j] + h;
+            for (let k = 0; k < n; k++) {
+              setJointDesignVariableValue(jointState, ids[k], xPert[k]);
+            }
+            r1w = evalResidualsNowProfiled().residuals;
+          }
+          const r0w = ok ? res.base : r0;
           for (let i = 0; i < m; i++) {
-            s += J[i][j] * J[i][k];
+            if (!mask[i]) continue;
+            const derivative = (r1w[i] - r0w[i]) / h;
+            J[j * m + i] = Number.isFinite(derivative) ? Math.max(-maxDerivMag, Math.min(maxDerivMag, derivative)) : 0;
+          }
+        }
+        if (!ok) {
+          for (let k = 0; k < n; k++) {
+            setJointDesignVariableValue(jointState, ids[k], x0[k]);
           }
-          A[j][k] = s;
-          A[k][j] = s;
         }
       }
 
+      if (shouldStop && shouldStop()) break;
+
+      // Compute normal equations: A = J^T J, g = J^T r
+      const { A, g } = formNormalEquations(J, r0, m, n);
+
       // Nielsen adaptive initialization: lambda_0 = tau * max(diag(A))
       if (!lambdaInitialized) {
         let maxDiag = 0;
@@ -3421,15 +3788,9 @@ export async function runOptimizationMVP(options = {}) {
       }
 
       // Damping: A_damped = A + lambda * diag(A) + lambda * I
-      // This is the Marquardt modification (combines Levenberg and Marquardt approaches)
-      /** @type {number[][]} */
-      const Ad = A.map((row) => row.slice());
-      for (let i = 0; i < n; i++) {
-        const d = A[i][i];
-        const diag = (Number.isFinite(d) && d > 0) ? d : 1;
-        Ad[i][i] = d + lambda * diag + lambda;
-      }
-
+      // This is the Marquardt modification (combines Levenberg and Marquardt approaches).
+      // The solver applies it while factoring, so lambda retries below reuse A as is.
+      const dampedSolver = createDampedSolver(A);
       const b = g.map((v) => -v);
 
       if (onProgress) {
@@ -3437,8 +3798,13 @@ export async function runOptimizationMVP(options = {}) {
         await nextFrame();
       }
 
-      let dx = solveSymmetricPositiveDefinite(Ad, b);
-      if (!dx) dx = solveLinearSystemFallback(Ad, b);
+      // Linear solver failure: retry with more damping at the same x0 (J and A are unchanged,
+      // so only the factorization is repeated) before giving up on this iteration.
+      let dx = dampedSolver.solve(b, lambda);
+      for (let retry = 0; !dx && retry < lmSolveRetries && lambda * lmLambdaUp <= 1e10; retry++) {
+        lambda *= lmLambdaUp;
+        dx = dampedSolver.solve(b, lambda);
+      }
       if (!dx) {
         // Stability tuning: linear solver failed, increase damping
         lambda *= lmLambdaUp;
@@ -3458,29 +3824,25 @@ export async function runOptimizationMVP(options = {}) {
 
       // Trust region (scaled): clip dx so max |dx_i/scale_i| <= delta.
       // Stability tuning: prevents overly large steps in scaled coordinates
-      if (trustRegion) {
+      const clipToTrustRegion = (step) => {
+        if (!trustRegion) return;
         let maxAbs = 0;
         for (let i = 0; i < n; i++) {
           const si = scales[i] || 1;
-          const di = dx[i] / si;
+          const di = step[i] / si;
           const a = Math.abs(di);
           if (a > maxAbs) maxAbs = a;
         }
         const delta = trustRegionDeltaEff;
         if (Number.isFinite(maxAbs) && maxAbs > delta && maxAbs > 0) {
           const f = delta / maxAbs;
-          for (let i = 0; i < n; i++) dx[i] *= f;
+          for (let i = 0; i < n; i++) step[i] *= f;
         }
-      }
+      };
+      clipToTrustRegion(dx);
 
       // Numerical stability check: detect NaN or Inf in step
-      let stepValid = true;
-      for (let i = 0; i < n; i++) {
-        if (!Number.isFinite(dx[i])) {
-          stepValid = false;
-          break;
-        }
-      }
+      const stepValid = dx.every(Number.isFinite);
       if (!stepValid) {
         // Numerical instability detected, increase damping significantly
         lambda *= lmLambdaUp * lmLambdaUp;
@@ -3555,8 +3917,8 @@ export async function runOptimizationMVP(options = {}) {
         }
       };
 
-      for (const alpha of alphas) {
-        const dxStep = exploreThisIter ? makeRandomStep(alpha) : dx.map(v => alpha * v);
+      // Evaluate x0 + dxStep; on improvement record it as the accepted step, otherwise restore x0.
+      const tryCandidate = async (dxStep, alpha) => {
         // Candidate x
         const xCand = x0.map((v, i) => v + dxStep[i]);
         for (let k = 0; k < n; k++) {
@@ -3605,14 +3967,32 @@ export async function runOptimizationMVP(options = {}) {
           acceptedCost = cost1;
           acceptedAlpha = alpha;
           acceptedRho = rho;
-          break;
+          return true;
         }
 
-        // Restore before trying smaller alpha
+        // Restore before trying the next step
         for (let k = 0; k < n; k++) {
           setJointDesignVariableValue(jointState, ids[k], x0[k]);
         }
         maybeSave('restore');
+        return false;
+      };
+
+      for (const alpha of alphas) {
+        const dxStep = exploreThisIter ? makeRandomStep(alpha) : dx.map(v => alpha * v);
+        if (await tryCandidate(dxStep, alpha)) break;
+      }
+
+      // Every step was rejected: J, A and g are still valid at x0, so raise lambda and re-solve with the
+      // same dampedSolver (no Jacobian / normal-equation rebuild) before giving up on this iteration.
+      for (let retry = 0; !accepted && !exploreThisIter && retry < lmRejectRetries && lambda * lmLambdaUp <= 1e10; retry++) {
+        if (shouldStop && shouldStop()) break;
+        lambda *= lmLambdaUp;
+        const dxRetry = dampedSolver.solve(b, lambda);
+        if (!dxRetry) continue;
+        clipToTrustRegion(dxRetry);
+        if (!dxRetry.every(Number.isFinite)) break;
+        await tryCandidate(dxRetry, 1);
       }
 
       if (accepted && acceptedEval) {
@@ -3897,6 +4277,9 @@ export async function runOptimizationMVP(options = {}) {
       softViolations: finalEval ? finalEval.softViolations : []
     };
     } finally {
+      try {
+        if (meritPool) meritPool.terminate();
+      } catch (_) {}
       try {
         if (typeof globalThis !== 'undefined') {
           globalThis.__cooptOpticalSystemRowsOverride = __prevOpticalSystemRowsOverride;
@@ -0,0 +1,320 @@
+/**
+ * Tolerance model for Monte-Carlo tolerancing (DOM-free; shared by the main thread and merit-worker.js).
+ *
+ * Tolerance spec (one entry per toleranced parameter):
+ *   { id?, type, surface, lastSurface?, min, max, distribution? }
+ *   - type: 'radius' (mm) | 'thickness' (mm) | 'index' (Δn) | 'decenterX' | 'decenterY' (mm) | 'tiltX' | 'tiltY' (deg)
+ *   - surface: row index in opticalSystemRows. For decenter / tilt, [surface, lastSurface] is the element
+ *     (lastSurface defaults to surface = single-surface tilt/decenter).
+ *   - distribution: 'uniform' (default) or 'normal' ([min, max] = ±2σ around the centre, truncated).
+ *
+ * - Flat (INF) radii are left unchanged. Thickness on a Coord Trans row perturbs its gap (__cooptGapThickness).
+ * - Index tolerances set __cooptIndexDelta (getIndexDelta() in ray-paraxial.js), so dispersion is kept.
+ * - Decenter / tilt insert a Coord Trans pair around the element (parseCoordTransParams schema):
+ *   order 0 (+decenter, +tilt) before the first row, order 1 (-tilt, lateral correction) after the last row.
+ *   Thicknesses are untouched, so paraxial data does not change; the correction puts the surface after the
+ *   element back where it was (the residual is axial, (T + gap)(1 - cos θ), below 1e-6 mm for arc-minute tilts).
+ *   Specs on the same range share one pair; partly overlapping ranges are rejected (findOverlappingElements()).
+ * - Spot probes trace fixed object-space rays (aimed on the nominal system) through each perturbed system:
+ *   traceSpotWasm() when the WASM build has it, else traceRaysBatch() hit points in the image surface frame.
+ */
+
+import { calculateSurfaceOrigins, transformPointToLocal } from '../raytracing/core/ray-tracing.js';
+import { isSpotStreamWasmAvailable, traceSpotWasm, traceRaysBatch } from '../raytracing/core/ray-batch-trace.js';
+
+export const TOLERANCE_TYPES = Object.freeze(['radius', 'thickness', 'index', 'decenterX', 'decenterY', 'tiltX', 'tiltY']);
+
+// Operand name evaluated by evaluateSpotProbe() (RMS spot radius about the centroid, lens units)
+export const TOLERANCE_SPOT_OPERAND = 'TOL_SPOT_RMS';
+
+const ELEMENT_TYPES = new Set(['decenterX', 'decenterY', 'tiltX', 'tiltY']);
+
+function toFiniteOrNull(v) {
+  if (v === null || v === undefined) return null;
+  if (typeof v === 'number') return Number.isFinite(v) ? v : null;
+  const s = String(v).trim();
+  if (s === '' || s.toUpperCase() === 'INF' || s.toUpperCase() === 'INFINITY') return null;
+  const n = Number(s);
+  return Number.isFinite(n) ? n : null;
+}
+
+function isCoordTransRowLocal(row) {
+  const st = String(row?.surfType ?? '').trim().toLowerCase();
+  return st === 'coord trans' || st === 'coordinate break' || st === 'ct';
+}
+
+/**
+ * Seeded PRNG (mulberry32) so a Monte-Carlo run can be reproduced from its seed.
+ * @param {number} seed
+ * @returns {() => number} uniform in [0, 1)
+ */
+export function createToleranceRandom(seed = 1) {
+  let a = (Number(seed) >>> 0) || 0x9e3779b9;
+  return () => {
+    a = (a + 0x6d2b79f5) | 0;
+    let t = Math.imul(a ^ (a >>> 15), 1 | a);
+    t = (t + Math.imul(t ^ (t >>> 7), 61 | t)) ^ t;
+    return ((t ^ (t >>> 14)) >>> 0) / 4294967296;
+  };
+}
+
+/**
+ * Check and normalise a tolerance list against the rows it applies to.
+ * @returns {{tolerances: Array<Object>, issues: Array<string>}}
+ */
+export function normalizeTolerances(tolerances, opticalSystemRows) {
+  const list = Array.isArray(tolerances) ? tolerances : [];
+  const n = Array.isArray(opticalSystemRows) ? opticalSystemRows.length : 0;
+  const out = [];
+  const issues = [];
+  list.forEach((t, k) => {
+    const type = String(t?.type ?? '');
+    const surface = Math.floor(Number(t?.surface));
+    const lastSurface = ELEMENT_TYPES.has(type) && t?.lastSurface !== undefined && t?.lastSurface !== null
+      ? Math.floor(Number(t.lastSurface))
+      : surface;
+    const min = Number(t?.min);
+    const max = Number(t?.max);
+    const label = t?.id ?? `#${k}`;
+    if (!TOLERANCE_TYPES.includes(type)) {
+      issues.push(`${label}: unknown tolerance type "${type}"`);
+      return;
+    }
+    if (!Number.isInteger(surface) || surface < 1 || surface >= n || !Number.isInteger(lastSurface) || lastSurface < surface || lastSurface >= n) {
+      issues.push(`${label}: surface range [${t?.surface}, ${t?.lastSurface ?? t?.surface}] is outside rows 1..${n - 1}`);
+      return;
+    }
+    if (!Number.isFinite(min) || !Number.isFinite(max) || max < min) {
+      issues.push(`${label}: invalid range [${t?.min}, ${t?.max}]`);
+      return;
+    }
+    out.push({
+      id: String(t?.id ?? `${type}@${surface}${lastSurface !== surface ? `-${lastSurface}` : ''}`),
+      type,
+      surface,
+      lastSurface,
+      min,
+      max,
+      distribution: t?.distribution === 'normal' ? 'normal' : 'uniform'
+    });
+  });
+  issues.push(...findOverlappingElements(out));
+  return { tolerances: out, issues };
+}
+
+/**
+ * Decenter / tilt specs on the same [surface, lastSurface] share one Coord Trans pair (their values add);
+ * partly overlapping ranges would nest pairs whose corrections compound, so they are reported.
+ * @param {Array<Object>} tolerances - normalised specs
+ * @returns {Array<string>} one message per conflicting pair of ranges
+ */
+export function findOverlappingElements(tolerances) {
+  const ranges = new Map();
+  for (const t of Array.isArray(tolerances) ? tolerances : []) {
+    if (!t || !ELEMENT_TYPES.has(t.type)) continue;
+    const key = `${t.surface}:${t.lastSurface}`;
+    if (!ranges.has(key)) ranges.set(key, { first: t.surface, last: t.lastSurface, id: t.id ?? `${t.type}@${key}` });
+  }
+  const list = Array.from(ranges.values()).sort((a, b) => a.first - b.first || a.last - b.last);
+  const issues = [];
+  for (let i = 0; i < list.length; i++) {
+    for (let j = i + 1; j < list.length && list[j].first <= list[i].last; j++) {
+      issues.push(`${list[j].id}: element [${list[j].first}, ${list[j].last}] overlaps ${list[i].id} [${list[i].first}, ${list[i].last}] (use the same range to combine decenter / tilt)`);
+    }
+  }
+  return issues;
+}
+
+/**
+ * One random draw per tolerance.
+ * @param {Array<Object>} tolerances - normalizeTolerances().tolerances
+ * @param {() => number} random - createToleranceRandom()
+ * @returns {Float64Array}
+ */
+export function sampleToleranceValues(tolerances, random) {
+  const values = new Float64Array(tolerances.length);
+  for (let i = 0; i < tolerances.length; i++) {
+    const t = tolerances[i];
+    const mid = 0.5 * (t.min + t.max);
+    const half = 0.5 * (t.max - t.min);
+    if (t.distribution === 'normal') {
+      // ±half = ±2σ, truncated by rejection
+      let z;
+      do {
+        const u1 = Math.max(random(), 1e-300);
+        const u2 = random();
+        z = Math.sqrt(-2 * Math.log(u1)) * Math.cos(2 * Math.PI * u2);
+      } while (Math.abs(z) > 2);
+      values[i] = mid + 0.5 * half * z;
+    } else {
+      values[i] = t.min + (t.max - t.min) * random();
+    }
+  }
+  return values;
+}
+
+function createToleranceCoordTransRow(prev, { decenterX, decenterY, tiltX, tiltY, order }) {
+  const cb = {
+    'object type': '',
+    surfType: 'Coord Trans',
+    comment: 'Tolerance',
+    radius: 'INF',
+    decenterX,
+    decenterY,
+    decenterZ: 0,
+    tiltX,
+    tiltY,
+    tiltZ: 0,
+    order,
+    // Coord Trans field reuse (same as block-schema.js)
+    semidia: decenterX,
+    material: decenterY,
+    thickness: 0,
+    rindex: tiltX,
+    abbe: tiltY,
+    conic: 0,
+    coef1: order,
+    _blockType: 'CoordTrans',
+    _blockId: null,
+    _surfaceRole: 'ct',
+    __cooptTolerance: true
+  };
+  const semidia = prev?.__cooptActualSemidia ?? prev?.semidia;
+  if (semidia !== undefined && semidia !== null && String(semidia).trim() !== '') cb.__cooptActualSemidia = semidia;
+  return cb;
+}
+
+const dot3 = (a, b) => a.x * b.x + a.y * b.y + a.z * b.z;
+const column = (m, c) => ({ x: m[0][c], y: m[1][c], z: m[2][c] });
+
+/**
+ * Perturbed copy of the rows (the input is not modified).
+ * @param {Array<Object>} opticalSystemRows
+ * @param {Array<Object>} tolerances - normalizeTolerances().tolerances
+ * @param {ArrayLike<number>} values - one value per tolerance (sampleToleranceValues())
+ * @returns {Array<Object>}
+ */
+export function applyTolerancePerturbations(opticalSystemRows, tolerances, values) {
+  if (!Array.isArray(opticalSystemRows)) return [];
+  const rows = opticalSystemRows.map((r) => (r && typeof r === 'object' ? { ...r } : r));
+  const elements = new Map();
+
+  for (let i = 0; i < tolerances.length; i++) {
+    const t = tolerances[i];
+    const v = Number(values?.[i]);
+    if (!t || !Number.isFinite(v) || v === 0) continue;
+    const row = rows[t.surface];
+    if (!row) continue;
+    switch (t.type) {
+      case 'radius': {
+        const r = toFiniteOrNull(row.radius);
+        if (r !== null && r !== 0) row.radius = r + v;
+        break;
+      }
+      case 'thickness': {
+        if (isCoordTransRowLocal(row)) {
+          const g = toFiniteOrNull(row.__cooptGapThickness);
+          if (g !== null) row.__cooptGapThickness = g + v;
+        } else {
+          const th = toFiniteOrNull(row.thickness);
+          if (th !== null) row.thickness = th + v;
+        }
+        break;
+      }
+      case 'index':
+        row.__cooptIndexDelta = (Number(row.__cooptIndexDelta) || 0) + v;
+        break;
+      default: {
+        const key = `${t.surface}:${t.lastSurface}`;
+        let e = elements.get(key);
+        if (!e) elements.set(key, (e = { first: t.surface, last: t.lastSurface, decenterX: 0, decenterY: 0, tiltX: 0, tiltY: 0 }));
+        e[t.type] += v;
+      }
+    }
+  }
+
+  if (elements.size === 0) return rows;
+  const overlaps = findOverlappingElements(tolerances);
+  if (overlaps.length > 0) throw new Error(`tolerance: ${overlaps[0]}`);
+
+  // 後ろの要素から挿入する（前の要素の行番号と座標系は変わらない）
+  const ordered = Array.from(elements.values()).sort((a, b) => b.first - a.first);
+  const nominal = calculateSurfaceOrigins(rows);
+  let out = rows;
+  for (const e of ordered) {
+    const R0 = nominal[e.first]?.rotationMatrix;
+    const before = createToleranceCoordTransRow(out[e.first - 1], {
+      decenterX: e.decenterX, decenterY: e.decenterY, tiltX: e.tiltX, tiltY: e.tiltY, order: 0
+    });
+    const hasNext = e.last + 1 < out.length;
+    if (!hasNext || !R0) {
+      out = [...out.slice(0, e.first), before, ...out.slice(e.first)];
+      continue;
+    }
+    const after = createToleranceCoordTransRow(out[e.last], {
+      decenterX: 0, decenterY: 0, tiltX: -e.tiltX, tiltY: -e.tiltY, order: 1
+    });
+    const trial = [...out.slice(0, e.first), before, ...out.slice(e.first, e.last + 1), after, ...out.slice(e.last + 1)];
+    // after (order 1) の偏心は R0 の ex/ey 方向: 次の面が元の位置に戻るように横ずれを打ち消す
+    const afterIndex = e.last + 2;
+    const origins = calculateSurfaceOrigins(trial.slice(0, afterIndex + 1));
+    const o = origins[afterIndex]?.origin;
+    const q = nominal[e.last + 1]?.origin;
+    if (o && q) {
+      const d = { x: q.x - o.x, y: q.y - o.y, z: q.z - o.z };
+      const dx = dot3(d, column(R0, 0));
+      const dy = dot3(d, column(R0, 1));
+      after.decenterX = dx;
+      after.decenterY = dy;
+      after.semidia = dx;
+      after.material = dy;
+    }
+    out = trial;
+  }
+
+  for (let i = 0; i < out.length; i++) {
+    if (out[i] && typeof out[i] === 'object' && Object.prototype.hasOwnProperty.call(out[i], 'id')) out[i].id = i;
+  }
+  return out;
+}
+
+/**
+ * RMS spot radius about the centroid for a fixed ray set.
+ * @param {Array<Object>} opticalSystemRows - perturbed rows
+ * @param {{rays: Array<{startP:{x,y,z}, dir:{x,y,z}}>, wavelength:number, targetFromEnd:number, minHitFraction?:number}} probe
+ *   targetFromEnd: evaluation surface counted from the last row (inserted Coord Trans rows shift indices)
+ * @param {{packedSystem?: ArrayBuffer|null}} [options] packOpticalSystemBinary() of the same rows (traceSpotWasm)
+ * @returns {number} RMS radius, NaN when too few rays reach the surface
+ */
+export function evaluateSpotProbe(opticalSystemRows, probe, options = {}) {
+  if (!Array.isArray(opticalSystemRows) || !probe || !Array.isArray(probe.rays) || probe.rays.length === 0) return NaN;
+  const target = opticalSystemRows.length - 1 - Math.max(0, Math.floor(Number(probe.targetFromEnd) || 0));
+  if (target < 1) return NaN;
+  const wavelength = Number(probe.wavelength) > 0 ? Number(probe.wavelength) : 0.5875618;
+  const minHits = Math.max(1, Math.ceil((Number(probe.minHitFraction) || 0.5) * probe.rays.length));
+
+  if (isSpotStreamWasmAvailable()) {
+    const res = traceSpotWasm(opticalSystemRows, { starts: probe.rays }, {
+      targetSurfaceIndex: target,
+      wavelength,
+      packedSystem: options?.packedSystem || undefined
+    });
+    if (res) return res.hits >= minHits ? res.rms : NaN;
+  }
+
+  const rays = probe.rays.map((r) => ({ pos: r.startP, dir: r.dir, wavelength }));
+  const hits = traceRaysBatch(opticalSystemRows, rays, { maxSurfaceIndex: target, returnHitPointOnly: true });
+  const frame = calculateSurfaceOrigins(opticalSystemRows)[target];
+  if (!frame) return NaN;
+  let count = 0, sx = 0, sy = 0, sxx = 0, syy = 0;
+  for (const p of hits) {
+    if (!p || !Number.isFinite(p.x) || !Number.isFinite(p.y) || !Number.isFinite(p.z)) continue;
+    const l = transformPointToLocal(p, frame);
+    count++;
+    sx += l.x; sy += l.y;
+    sxx += l.x * l.x; syy += l.y * l.y;
+  }
+  if (count < minHits) return NaN;
+  const mx = sx / count, my = sy / count;
+  return Math.sqrt(Math.max(0, sxx / count - mx * mx + syy / count - my * my));
+}
@@ -0,0 +1,328 @@
+/**
+ * Monte-Carlo tolerancing (main-thread driver).
+ *
+ * Draws N perturbed systems from a tolerance list (optimization/tolerance-model.js), evaluates the
+ * criteria operands on each through the merit worker pool (one task per trial; the worker applies
+ * the perturbation to the nominal rows), and reports per-criterion statistics, yield and
+ * per-parameter sensitivities.
+ *
+ * - Criteria are merit operands evaluated by merit-worker.js (FL / BFL / IMD / FNO_* / TOT3_* / ...)
+ *   plus TOL_SPOT_RMS { field (1-based Object row), rayCount?, surface? (0-based, default = image) }.
+ *   Each criterion may carry min / max; a trial passes when every criterion is finite and in bounds.
+ * - Spot criteria trace fixed object-space rays aimed once on the nominal system, so a trial sees the
+ *   image blur of the perturbed system for the nominal pupil (no per-trial chief-ray / stop re-aiming).
+ * - Sensitivities: each tolerance alone at its min and max; RSS of the larger |Δ| per criterion.
+ * - Workers load their own ray-tracing WASM, so TOL_SPOT_RMS trials use traceSpotWasm() there too.
+ *   Without module workers (or with workers: 0) the same tasks run serially on the main thread.
+ *
+ * No UI is added; the entrypoint is exposed as window.ToleranceMonteCarlo.
+ */
+
+import { MeritWorkerPool, defaultMeritWorkerCount, isMeritWorkerPoolAvailable } from './merit-worker-pool.js';
+import { evaluateMeritWorkerTask, isMeritWorkerOperand } from './merit-worker.js';
+import {
+  TOLERANCE_SPOT_OPERAND,
+  createToleranceRandom,
+  normalizeTolerances,
+  sampleToleranceValues
+} from './tolerance-model.js';
+import { getSystemWavelengthFromOperandOrPrimary } from '../evaluation/operand-metrics.js';
+import { isSpotSizeOperand } from '../evaluation/operand-ray-metrics.js';
+
+const DEFAULT_TRIALS = 1000;
+const DEFAULT_SPOT_RAYS = 49;
+const CHUNK_TRIALS = 64;
+const PERCENTILES = [0.5, 0.9, 0.95, 0.99];
+
+let __toleranceStopRequested = false;
+
+function yieldToEventLoop() {
+  return new Promise((resolve) => setTimeout(resolve, 0));
+}
+
+function nowMs() {
+  return (typeof performance !== 'undefined' && typeof performance.now === 'function')
+    ? performance.now()
+    : Date.now();
+}
+
+function boundOrNull(v) {
+  if (v === null || v === undefined || String(v).trim() === '') return null;
+  const n = Number(v);
+  return Number.isFinite(n) ? n : null;
+}
+
+function criterionLabel(c, i) {
+  if (c.id) return String(c.id);
+  if (c.operand === TOLERANCE_SPOT_OPERAND) return `${c.operand}@F${c.field ?? 1}`;
+  return `${c.operand}#${i + 1}`;
+}
+
+async function buildSpotProbes(criteria, opticalSystemRows, sourceRows, objectRows) {
+  const spot = criteria.filter((c) => c.operand === TOLERANCE_SPOT_OPERAND);
+  if (spot.length === 0) return [];
+  // ray-renderer.js は THREE を読み込むので、Spot 基準があるときだけ読む
+  const { generateRayStartPointsForObject } = await import('../optical/ray-renderer.js');
+  const last = opticalSystemRows.length - 1;
+  const probes = [];
+  for (const c of spot) {
+    const objects = Array.isArray(objectRows) ? objectRows : [];
+    const fieldIdx0 = Math.max(0, Math.min(objects.length - 1, Math.floor(Number(c.field) || 1) - 1));
+    const obj = objects[fieldIdx0];
+    if (!obj) throw new Error(`${TOLERANCE_SPOT_OPERAND}: no Object row for field ${c.field ?? 1}`);
+    const surface = Number.isInteger(Number(c.surface)) ? Math.max(1, Math.min(last, Number(c.surface))) : last;
+    const wavelength = getSystemWavelengthFromOperandOrPrimary(c, sourceRows);
+    const starts = generateRayStartPointsForObject(obj, opticalSystemRows, Math.max(4, Math.floor(Number(c.rayCount) || DEFAULT_SPOT_RAYS)), null, {
+      targetSurfaceIndex: surface,
+      useChiefRayAnalysis: true,
+      chiefRaySolveMode: 'fast',
+      wavelengthUm: wavelength
+    });
+    const rays = (Array.isArray(starts) ? starts : [])
+      .filter((s) => s && s.startP && s.dir)
+      .map((s) => ({ startP: { x: s.startP.x, y: s.startP.y, z: s.startP.z }, dir: { x: s.dir.x, y: s.dir.y, z: s.dir.z } }));
+    if (rays.length === 0) throw new Error(`${TOLERANCE_SPOT_OPERAND}: no rays generated for field ${c.field ?? 1}`);
+    c.probe = probes.length;
+    probes.push({ rays, wavelength, targetFromEnd: last - surface });
+  }
+  return probes;
+}
+
+function summarize(values, count, stride, k) {
+  const finite = [];
+  for (let t = 0; t < count; t++) {
+    const v = values[t * stride + k];
+    if (Number.isFinite(v)) finite.push(v);
+  }
+  const n = finite.length;
+  if (n === 0) {
+    return { count: 0, failed: count, mean: NaN, std: NaN, min: NaN, max: NaN, percentiles: {} };
+  }
+  let sum = 0;
+  for (const v of finite) sum += v;
+  const mean = sum / n;
+  let ss = 0;
+  for (const v of finite) ss += (v - mean) * (v - mean);
+  finite.sort((a, b) => a - b);
+  const percentiles = {};
+  for (const p of PERCENTILES) {
+    const x = p * (n - 1);
+    const i0 = Math.floor(x);
+    const i1 = Math.min(n - 1, i0 + 1);
+    percentiles[`p${Math.round(p * 100)}`] = finite[i0] + (finite[i1] - finite[i0]) * (x - i0);
+  }
+  return {
+    count: n,
+    failed: count - n,
+    mean,
+    std: n > 1 ? Math.sqrt(ss / (n - 1)) : 0,
+    min: finite[0],
+    max: finite[n - 1],
+    percentiles
+  };
+}
+
+function passes(v, c) {
+  if (!Number.isFinite(v)) return false;
+  if (c.min !== null && v < c.min) return false;
+  if (c.max !== null && v > c.max) return false;
+  return true;
+}
+
+/**
+ * Run a Monte-Carlo tolerance analysis.
+ *
+ * @param {Object} params
+ * @param {Array<Object>} params.opticalSystemRows - nominal rows
+ * @param {Array<Object>} [params.sourceRows]
+ * @param {Array<Object>} [params.objectRows]
+ * @param {Array<Object>} params.tolerances - see tolerance-model.js
+ * @param {Array<Object>} params.criteria - merit operands { operand, param1.., min?, max?, id? }
+ * @param {number} [params.trials=1000]
+ * @param {number} [params.seed=1]
+ * @param {number} [params.workers] - 0 = serial on the main thread (default: defaultMeritWorkerCount())
+ * @param {MeritWorkerPool} [params.pool] - started pool to reuse (not terminated here)
+ * @param {boolean} [params.sensitivities=true]
+ * @param {(p:{done:number, total:number, passed:number}) => void} [params.onProgress]
+ * @returns {Promise<Object>} { trials, nominal, criteria[], yield, sensitivities[], samples, values, workers, elapsedMs, stopped }
+ */
+export async function runToleranceMonteCarlo(params = {}) {
+  const t0 = nowMs();
+  __toleranceStopRequested = false;
+  const rows = Array.isArray(params.opticalSystemRows) ? params.opticalSystemRows : [];
+  if (rows.length < 2) throw new Error('tolerance: optical system is empty');
+
+  const { tolerances, issues } = normalizeTolerances(params.tolerances, rows);
+  if (issues.length > 0) throw new Error(`tolerance: ${issues.join('; ')}`);
+  if (tolerances.length === 0) throw new Error('tolerance: no tolerances given');
+
+  const criteria = (Array.isArray(params.criteria) ? params.criteria : []).map((c, i) => ({
+    ...c,
+    operand: String(c?.operand ?? ''),
+    min: boundOrNull(c?.min),
+    max: boundOrNull(c?.max)
+  }));
+  if (criteria.length === 0) throw new Error('tolerance: no criteria given');
+  // SPOT_SIZE_* need the optimizer's base-point spot rays (spotProbe); tolerancing uses TOL_SPOT_RMS instead.
+  const unsupported = criteria.filter((c) => !isMeritWorkerOperand(c.operand) || isSpotSizeOperand(c.operand)).map((c) => c.operand);
+  if (unsupported.length > 0) throw new Error(`tolerance: operands not available for tolerancing: ${unsupported.join(', ')}`);
+  criteria.forEach((c, i) => { c.id = criterionLabel(c, i); });
+
+  const trials = Math.max(1, Math.floor(Number(params.trials) || DEFAULT_TRIALS));
+  const m = criteria.length;
+  const k = tolerances.length;
+  const probes = await buildSpotProbes(criteria, rows, params.sourceRows, params.objectRows);
+
+  const snapshot = {
+    configs: {
+      nominal: { rowsOverride: rows, source: params.sourceRows ?? null, object: params.objectRows ?? null }
+    },
+    operands: criteria.map(({ min, max, ...op }) => op),
+    tolerance: { tolerances, probes }
+  };
+  const items = criteria.map((_, i) => i);
+
+  // --- evaluator (worker pool or serial) ---
+  let pool = params.pool instanceof MeritWorkerPool ? params.pool : null;
+  let ownPool = false;
+  const requested = (params.workers === undefined || params.workers === null)
+    ? defaultMeritWorkerCount()
+    : Math.max(0, Math.floor(Number(params.workers) || 0));
+  if (!pool && requested > 0 && isMeritWorkerPoolAvailable()) {
+    const p = new MeritWorkerPool({ size: requested });
+    if (await p.start()) {
+      pool = p;
+      ownPool = true;
+    } else {
+      p.terminate();
+    }
+  }
+  if (pool) pool.setSnapshot(snapshot);
+
+  const evaluate = async (perturbs) => {
+    const tasks = perturbs.map((perturb) => ({ configId: 'nominal', scenarioId: null, items, set: null, perturb }));
+    if (pool) return pool.run(tasks);
+    const out = [];
+    for (const task of tasks) out.push(evaluateMeritWorkerTask(snapshot, task));
+    return out;
+  };
+
+  try {
+    const nominalValues = Array.from((await evaluate([null]))[0]);
+
+    // --- sensitivities: one tolerance at a time at min / max ---
+    const sensitivities = [];
+    if (params.sensitivities !== false) {
+      const perturbs = [];
+      for (let i = 0; i < k; i++) {
+        for (const end of [tolerances[i].min, tolerances[i].max]) {
+          const v = new Float64Array(k);
+          v[i] = end;
+          perturbs.push(v);
+        }
+      }
+      const res = await evaluate(perturbs);
+      for (let i = 0; i < k; i++) {
+        const lo = res[2 * i], hi = res[2 * i + 1];
+        sensitivities.push({
+          tolerance: tolerances[i].id,
+          type: tolerances[i].type,
+          surface: tolerances[i].surface,
+          min: tolerances[i].min,
+          max: tolerances[i].max,
+          deltaAtMin: criteria.map((_, c) => lo[c] - nominalValues[c]),
+          deltaAtMax: criteria.map((_, c) => hi[c] - nominalValues[c])
+        });
+      }
+    }
+    const rss = criteria.map((_, c) => Math.sqrt(sensitivities.reduce((s, e) => {
+      const d = Math.max(Math.abs(e.deltaAtMin[c]), Math.abs(e.deltaAtMax[c]));
+      return s + (Number.isFinite(d) ? d * d : 0);
+    }, 0)));
+
+    // --- Monte-Carlo trials ---
+    const random = createToleranceRandom(params.seed ?? 1);
+    const samples = new Float64Array(trials * k);
+    const values = new Float64Array(trials * m).fill(NaN);
+    let done = 0;
+    let passed = 0;
+    let stopped = false;
+    const chunk = Math.max(CHUNK_TRIALS, pool ? pool.size * 16 : 0);
+    while (done < trials) {
+      if (__toleranceStopRequested) {
+        stopped = true;
+        break;
+      }
+      const n = Math.min(chunk, trials - done);
+      const perturbs = [];
+      for (let t = 0; t < n; t++) {
+        const s = sampleToleranceValues(tolerances, random);
+        samples.set(s, (done + t) * k);
+        perturbs.push(s);
+      }
+      const res = await evaluate(perturbs);
+      for (let t = 0; t < n; t++) {
+        const row = res[t];
+        let ok = true;
+        for (let c = 0; c < m; c++) {
+          const v = Number(row?.[c]);
+          values[(done + t) * m + c] = v;
+          if (!passes(v, criteria[c])) ok = false;
+        }
+        if (ok) passed++;
+      }
+      done += n;
+      try { params.onProgress?.({ done, total: trials, passed }); } catch (_) {}
+      if (!pool) await yieldToEventLoop();
+    }
+
+    const stats = criteria.map((c, i) => {
+      let inBounds = 0;
+      for (let t = 0; t < done; t++) if (passes(values[t * m + i], c)) inBounds++;
+      return {
+        id: c.id,
+        operand: c.operand,
+        min: c.min,
+        max: c.max,
+        nominal: nominalValues[i],
+        rssDelta: rss[i],
+        passRate: done > 0 ? inBounds / done : NaN,
+        ...summarize(values, done, m, i)
+      };
+    });
+
+    return {
+      trials: done,
+      seed: params.seed ?? 1,
+      tolerances,
+      nominal: Object.fromEntries(criteria.map((c, i) => [c.id, nominalValues[i]])),
+      criteria: stats,
+      yield: done > 0 ? passed / done : NaN,
+      sensitivities,
+      samples: samples.subarray(0, done * k),
+      values: values.subarray(0, done * m),
+      workers: pool ? pool.size : 0,
+      elapsedMs: nowMs() - t0,
+      stopped
+    };
+  } finally {
+    if (ownPool) pool.terminate();
+  }
+}
+
+// Global entrypoint (console-driven)
+if (typeof window !== 'undefined') {
+  window.ToleranceMonteCarlo = {
+    /**
+     * Current tables as the nominal system:
+     *   ToleranceMonteCarlo.run({ tolerances: [...], criteria: [...], trials: 1000 })
+     */
+    run: (params = {}) => runToleranceMonteCarlo({
+      opticalSystemRows: typeof window.getOpticalSystemRows === 'function' ? window.getOpticalSystemRows() : [],
+      sourceRows: typeof window.getSourceRows === 'function' ? window.getSourceRows() : [],
+      objectRows: typeof window.getObjectRows === 'function' ? window.getObjectRows() : [],
+      ...params
+    }),
+    stop: () => { __toleranceStopRequested = true; }
+  };
+}
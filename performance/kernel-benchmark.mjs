@@ -0,0 +1,417 @@
+/**
+ * Native / WASM kernel benchmark helper (wasm/bench/kernel-bench.c)
+ *
+ * node performance/kernel-benchmark.mjs fixtures <out.txt>
+ *   サンプルレンズ（defaults/default-load.json, sample/*.json）を面テーブルにパックし、
+ *   JS 版 traceRay() と SimpleFFT による参照結果と一緒に書き出す（ベンチの精度チェック用）。
+ *   ほかに PSF と同じ瞳の MTF / スルーフォーカス / Strehl、ガラスカタログの屈折率
+ *   （getCorrectRefractiveIndex）、fitZernikeWeighted、lm-linalg.js の参照も含め、ベンチが計測する
+ *   全カーネルを JS 版と比べられるようにする。
+ *   乱数は使わないので、同じツリーからは常に同じファイルになる。
+ *
+ * node performance/kernel-benchmark.mjs compare <base.json> <new.json> [--tolerance 0.10]
+ *   kernel-bench の JSON 同士を比較し、スループットが tolerance 以上落ちた項目・
+ *   精度チェックの失敗があれば終了コード 1 を返す。
+ */
+
+import fs from 'fs';
+import path from 'path';
+import { fileURLToPath } from 'url';
+import { expandBlocksToOpticalSystemRows } from '../data/block-schema.js';
+import { traceRay, getCorrectRefractiveIndex } from '../raytracing/core/ray-tracing.js';
+import { packGlassTableForWasm, packOpticalSystemForWasm, RT10_LAYOUT } from '../raytracing/core/ray-batch-trace.js';
+import { SimpleFFT } from '../evaluation/psf/psf-calculator.js';
+import { fitZernikeWeighted } from '../evaluation/wavefront/zernike-fitting.js';
+import { createDampedSolver, formNormalEquations } from '../optimization/lm-linalg.js';
+
+const ROOT = path.resolve(path.dirname(fileURLToPath(import.meta.url)), '..');
+
+const BENCH_WAVELENGTH = 0.5875618;  // d 線（μm）
+const BENCH_FIELDS_DEG = [0, 3, 6];
+const REF_RAYS = 96;
+const PSF_REF_SIZE = 64;
+
+// kernel-bench.c の bench_make_ray と同じ式（光線 i: 視野 i % F, 瞳は Vogel 螺旋）
+function benchRay(i, count, pupilRadius) {
+  const F = BENCH_FIELDS_DEG.length;
+  const j = Math.floor(i / F);
+  const m = Math.max(1, Math.ceil(count / F));
+  const r = pupilRadius * Math.sqrt((j + 0.5) / m);
+  const phi = j * 2.399963229728653;
+  const a = BENCH_FIELDS_DEG[i % F] * Math.PI / 180;
+  return {
+    pos: { x: r * Math.cos(phi), y: r * Math.sin(phi), z: 0 },
+    dir: { x: 0, y: Math.sin(a), z: Math.cos(a) },
+    wavelength: BENCH_WAVELENGTH
+  };
+}
+
+function loadLenses() {
+  const lenses = [];
+  const defaults = JSON.parse(fs.readFileSync(path.join(ROOT, 'defaults/default-load.json'), 'utf8'));
+  lenses.push({ name: 'default-load', rows: defaults.opticalSystem });
+
+  for (const file of fs.readdirSync(path.join(ROOT, 'sample')).filter((f) => f.endsWith('.json')).sort()) {
+    const data = JSON.parse(fs.readFileSync(path.join(ROOT, 'sample', file), 'utf8'));
+    const blocks = Array.isArray(data.blocks) ? data.blocks : data.configurations?.configurations?.[0]?.blocks;
+    if (!Array.isArray(blocks)) continue;
+    const { rows } = expandBlocksToOpticalSystemRows(blocks);
+    // 物体面・像面だけの系はベンチにならない
+    if (rows.length > 2) lenses.push({ name: file.replace(/\.json$/, ''), rows });
+  }
+  return lenses;
+}
+
+// 入射ビーム半径の目安: 最も小さい有限な半径制限の 6 割（無ければ 5 mm）
+function pupilRadiusOf(packed) {
+  let minSemidia = Infinity;
+  for (let s = 0; s < packed.surfaceCount; s++) {
+    const sd = packed.surfaces[s * RT10_LAYOUT.STRIDE + RT10_LAYOUT.SEMIDIA];
+    if (Number.isFinite(sd) && sd > 0) minSemidia = Math.min(minSemidia, sd);
+  }
+  return Number.isFinite(minSemidia) ? 0.6 * minSemidia : 5.0;
+}
+
+function fmt(v) {
+  return Number.isFinite(v) ? String(v) : 'nan';
+}
+
+function writeLens(out, lens) {
+  const packed = packOpticalSystemForWasm(lens.rows, [BENCH_WAVELENGTH]);
+  const S = packed.surfaceCount;
+  const pupilRadius = pupilRadiusOf(packed);
+  out.push(`LENS ${lens.name} ${S} ${pupilRadius} ${REF_RAYS}`);
+  for (let s = 0; s < S; s++) {
+    out.push(Array.from(packed.surfaces.subarray(s * RT10_LAYOUT.STRIDE, (s + 1) * RT10_LAYOUT.STRIDE)).map(fmt).join(' '));
+  }
+  // 参照光線（traceRaysBatch と同じ rayPath 形式: 通過点数と最終点, null は 0 点）
+  for (let i = 0; i < REF_RAYS; i++) {
+    const ray = benchRay(i, REF_RAYS, pupilRadius);
+    const res = traceRay(lens.rows, ray, 1.0);
+    if (!Array.isArray(res) || res.length === 0) {
+      out.push('0 0 0 0');
+    } else {
+      const p = res[res.length - 1];
+      out.push(`${res.length} ${fmt(p.x)} ${fmt(p.y)} ${fmt(p.z)}`);
+    }
+  }
+}
+
+// PSF 参照用の瞳: 円形瞳 + デフォーカス・コマ・非点の OPD（μm, kernel-bench.c の bench_make_grid と同じ）
+function benchGrid(n) {
+  const opd = new Float64Array(n * n);
+  const mask = new Int32Array(n * n);
+  for (let i = 0; i < n; i++) {
+    const y = (i - (n - 1) / 2) / ((n - 1) / 2);
+    for (let j = 0; j < n; j++) {
+      const x = (j - (n - 1) / 2) / ((n - 1) / 2);
+      const r2 = x * x + y * y;
+      if (r2 > 1) continue;
+      mask[i * n + j] = 1;
+      opd[i * n + j] = 0.25 * (2 * r2 - 1) + 0.15 * (3 * r2 - 2) * y + 0.1 * (x * x - y * y);
+    }
+  }
+  return { opd, mask };
+}
+
+// JS の SimpleFFT による PSF 強度（FFTshift 済み）。psf_pipeline_grid と同じ符号（OPD は遅延 → 位相 -2π·OPD/λ）
+function jsPsf(opd, mask, n) {
+  const k = -2 * Math.PI / BENCH_WAVELENGTH;
+  const real = [];
+  const imag = [];
+  for (let i = 0; i < n; i++) {
+    real.push(new Array(n).fill(0));
+    imag.push(new Array(n).fill(0));
+    for (let j = 0; j < n; j++) {
+      if (!mask[i * n + j]) continue;
+      real[i][j] = Math.cos(k * opd[i * n + j]);
+      imag[i][j] = Math.sin(k * opd[i * n + j]);
+    }
+  }
+  const { real: fr, imag: fi } = SimpleFFT.fft2D(real, imag);
+  const half = n / 2;
+  const psf = new Float64Array(n * n);
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j < n; j++) {
+      const si = (i + half) % n;
+      const sj = (j + half) % n;
+      psf[i * n + j] = fr[si][sj] * fr[si][sj] + fi[si][sj] * fi[si][sj];
+    }
+  }
+  return psf;
+}
+
+// ρ²（格子中心 (n-1)/2 から, ρ = 1 はマスクの最大半径）: calculate_mtf_batch_wasm / focus stack の pupil_radius <= 0
+function benchRho2(mask, n) {
+  const c = (n - 1) / 2;
+  let r2max = 0;
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j < n; j++) {
+      if (mask[i * n + j]) r2max = Math.max(r2max, (i - c) * (i - c) + (j - c) * (j - c));
+    }
+  }
+  const inv = 1 / (r2max > 0 ? r2max : c * c);
+  const rho2 = new Float64Array(n * n);
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j < n; j++) rho2[i * n + j] = ((i - c) * (i - c) + (j - c) * (j - c)) * inv;
+  }
+  return rho2;
+}
+
+function defocused(opd, mask, rho2, w) {
+  const out = new Float64Array(opd.length);
+  for (let q = 0; q < opd.length; q++) out[q] = mask[q] ? opd[q] + w * rho2[q] : 0;
+  return out;
+}
+
+function maskSum(mask) {
+  let s = 0;
+  for (let q = 0; q < mask.length; q++) s += mask[q] ? 1 : 0;
+  return s;
+}
+
+function writePSF(out) {
+  const n = PSF_REF_SIZE;
+  const { opd, mask } = benchGrid(n);
+  const psf = jsPsf(opd, mask, n);
+  out.push(`PSF ${n} ${BENCH_WAVELENGTH}`);
+  out.push(Array.from(opd).map(fmt).join(' '));
+  out.push(Array.from(mask).join(' '));
+  out.push(Array.from(psf).map(fmt).join(' '));
+}
+
+// ガラスカタログ全体の屈折率（getCorrectRefractiveIndex）: rt10_resolve_indices の参照。範囲外の波長も含める
+const GLASS_REF_WAVELENGTHS = [0.365015, 0.4861327, 0.5875618, 0.6562725, 1.01398];
+
+function writeGlass(out) {
+  const { table, count, ids } = packGlassTableForWasm();
+  const names = Array.from(ids.keys());
+  out.push(`GLASS ${count} ${GLASS_REF_WAVELENGTHS.length} ${GLASS_REF_WAVELENGTHS.join(' ')}`);
+  out.push(Array.from(table).map(fmt).join(' '));
+  for (let g = 0; g < count; g++) {
+    out.push(GLASS_REF_WAVELENGTHS.map((wl) => fmt(getCorrectRefractiveIndex({ material: names[g] }, wl))).join(' '));
+  }
+}
+
+// MTF 参照: ui の SimpleFFT 経路と同じ定義（PSF → FFT → |OTF| / |OTF(0)|, 0 / 90° の整数 bin）
+const MTF_DEFOCUS = [-0.25, 0, 0.25];
+
+function writeMTF(out) {
+  const n = PSF_REF_SIZE;
+  const { opd, mask } = benchGrid(n);
+  const rho2 = benchRho2(mask, n);
+  const freqCount = n / 2 + 1;
+  out.push(`MTF ${MTF_DEFOCUS.length} ${freqCount} ${MTF_DEFOCUS.join(' ')}`);
+  for (const w of MTF_DEFOCUS) {
+    const psf = jsPsf(defocused(opd, mask, rho2, w), mask, n);
+    const real = [];
+    const imag = [];
+    for (let i = 0; i < n; i++) {
+      real.push(Array.from(psf.subarray(i * n, (i + 1) * n)));
+      imag.push(new Array(n).fill(0));
+    }
+    const otf = SimpleFFT.fft2D(real, imag);
+    const dc = Math.hypot(otf.real[0][0], otf.imag[0][0]);
+    const tan = [];
+    const sag = [];
+    for (let f = 0; f < freqCount; f++) {
+      tan.push(Math.hypot(otf.real[0][f], otf.imag[0][f]) / dc);
+      sag.push(Math.hypot(otf.real[f][0], otf.imag[f][0]) / dc);
+    }
+    out.push(tan.concat(sag).map(fmt).join(' '));
+  }
+}
+
+// EE80 半径（画素）: 強度重心まわりの 0.5 px 刻みの動径ヒストグラムの累積を線形補間（psf_focus_ee80 の定義）
+function ee80Radius(psf, n) {
+  const bin = 0.5;
+  const bins = Math.floor(n * 0.7072 / bin) + 2;
+  let sum = 0, sr = 0, sc = 0;
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j < n; j++) {
+      const v = psf[i * n + j];
+      sum += v; sr += v * i; sc += v * j;
+    }
+  }
+  const cr = sr / sum, cc = sc / sum;
+  const hist = new Float64Array(bins);
+  for (let i = 0; i < n; i++) {
+    for (let j = 0; j < n; j++) {
+      hist[Math.min(bins - 1, Math.floor(Math.hypot(i - cr, j - cc) / bin))] += psf[i * n + j];
+    }
+  }
+  const target = 0.8 * sum;
+  let acc = 0;
+  for (let b = 0; b < bins; b++) {
+    if (acc + hist[b] >= target) return (b + (hist[b] > 0 ? (target - acc) / hist[b] : 1)) * bin;
+    acc += hist[b];
+  }
+  return NaN;
+}
+
+// スルーフォーカス参照: W020 = 0.05 µm 刻み 41 点の peak / Strehl / EE80（calculate_psf_focus_stack_wasm, mode W020）
+const FOCUS_SLICES = 41;
+
+function writeFocus(out) {
+  const n = PSF_REF_SIZE;
+  const { opd, mask } = benchGrid(n);
+  const rho2 = benchRho2(mask, n);
+  const ideal = maskSum(mask) ** 2;
+  out.push(`FOCUS ${FOCUS_SLICES}`);
+  for (let s = 0; s < FOCUS_SLICES; s++) {
+    const w = 0.05 * (s - (FOCUS_SLICES - 1) / 2);
+    const psf = jsPsf(defocused(opd, mask, rho2, w), mask, n);
+    let peak = 0;
+    for (const v of psf) peak = Math.max(peak, v);
+    out.push(`${fmt(w)} ${fmt(peak)} ${fmt(peak / ideal)} ${fmt(ee80Radius(psf, n))}`);
+  }
+}
+
+// 瞳の DFT 強度 I(u, v) = |Σ a·exp(-2πi(u·j + v·i)/n)|²（整数 bin では SimpleFFT の PSF 画素と一致）
+function pupilIntensity(re, im, n, u, v) {
+  let sr = 0, si = 0;
+  for (let i = 0; i < n; i++) {
+    let br = 0, bi = 0;
+    for (let j = 0; j < n; j++) {
+      const q = i * n + j;
+      if (re[q] === 0 && im[q] === 0) continue;
+      const ph = -2 * Math.PI * (u * j + v * i) / n;
+      const c = Math.cos(ph), s = Math.sin(ph);
+      br += re[q] * c - im[q] * s;
+      bi += re[q] * s + im[q] * c;
+    }
+    sr += br;
+    si += bi;
+  }
+  return sr * sr + si * si;
+}
+
+// Strehl 参照: 基準点は FFT の原点画素、真のピークは最大画素からの格子探索（刻みを 1/10 ずつ縮める）
+function writeStrehl(out) {
+  const n = PSF_REF_SIZE;
+  const { opd, mask } = benchGrid(n);
+  const psf = jsPsf(opd, mask, n);
+  const ideal = maskSum(mask) ** 2;
+  const half = n / 2;
+  const k = -2 * Math.PI / BENCH_WAVELENGTH;
+  const re = new Float64Array(n * n);
+  const im = new Float64Array(n * n);
+  for (let q = 0; q < n * n; q++) {
+    if (!mask[q]) continue;
+    re[q] = Math.cos(k * opd[q]);
+    im[q] = Math.sin(k * opd[q]);
+  }
+  let best = 0;
+  for (let q = 1; q < n * n; q++) if (psf[q] > psf[best]) best = q;
+  let u = (best % n) - half, v = Math.floor(best / n) - half;
+  let peak = pupilIntensity(re, im, n, u, v);
+  for (let step = 0.1; step > 1e-6; step *= 0.1) {
+    const u0 = u, v0 = v;
+    for (let a = -10; a <= 10; a++) {
+      for (let b = -10; b <= 10; b++) {
+        const I = pupilIntensity(re, im, n, u0 + a * step, v0 + b * step);
+        if (I > peak) { peak = I; u = u0 + a * step; v = v0 + b * step; }
+      }
+    }
+  }
+  out.push(`STREHL ${fmt(psf[half * n + half] / ideal)} ${fmt(peak / ideal)} ${fmt(half + v)} ${fmt(half + u)} ${fmt(ideal)}`);
+}
+
+// Zernike 参照: Vogel 螺旋の点群（重み付き, 球面収差を追加）を JS の fitZernikeWeighted で 8 次まで
+const ZERNIKE_POINTS = 2000;
+const ZERNIKE_ORDER = 8;
+
+function writeZernike(out) {
+  const points = [];
+  for (let i = 0; i < ZERNIKE_POINTS; i++) {
+    const r = Math.sqrt((i + 0.5) / ZERNIKE_POINTS);
+    const phi = i * 2.399963229728653;
+    const x = r * Math.cos(phi), y = r * Math.sin(phi), r2 = r * r;
+    const opd = 0.25 * (2 * r2 - 1) + 0.15 * (3 * r2 - 2) * y + 0.1 * (x * x - y * y) + 0.05 * (6 * r2 * r2 - 6 * r2 + 1);
+    points.push({ x, y, opd, weight: 0.5 + 0.5 * (1 - r2) });
+  }
+  // 既定のオプション（removePiston のみ） = ZF_REMOVE_PISTON
+  const fit = fitZernikeWeighted(points, ZERNIKE_ORDER, { forceJS: true });
+  out.push(`ZERNIKE ${ZERNIKE_POINTS} ${ZERNIKE_ORDER} 4 ${fit.coefficients.length}`);
+  for (const key of ['x', 'y', 'opd', 'weight']) out.push(points.map((p) => fmt(p[key])).join(' '));
+  out.push(fit.coefficients.map(fmt).join(' '));
+  out.push(`${fmt(fit.rms)} ${fmt(fit.pv)}`);
+}
+
+// LM 参照: kernel-bench の最小形状（500 × 16, 同じ式）で formNormalEquations と createDampedSolver（JS 経路）
+const LM_M = 500;
+const LM_N = 16;
+const LM_LAMBDAS = [1e-3, 1e-2, 1e-1, 1];
+
+function writeLM(out) {
+  const J = new Float64Array(LM_M * LM_N);
+  for (let i = 0; i < J.length; i++) J[i] = Math.sin(0.37 * i + 0.011 * (i % 97));
+  const r = Float64Array.from({ length: LM_M }, (_, i) => Math.cos(0.13 * i));
+  const { A, g } = formNormalEquations(J, r, LM_M, LM_N);
+  const solver = createDampedSolver(A);
+  const b = g.map((v) => -v);
+  out.push(`LM ${LM_M} ${LM_N} ${LM_LAMBDAS.length} ${LM_LAMBDAS.join(' ')}`);
+  out.push(Array.from(J).map(fmt).join(' '));
+  out.push(Array.from(r).map(fmt).join(' '));
+  out.push(A.flat().map(fmt).join(' '));
+  out.push(g.map(fmt).join(' '));
+  for (const lambda of LM_LAMBDAS) out.push(solver.solve(b, lambda).map(fmt).join(' '));
+}
+
+function writeFixtures(file) {
+  const out = ['COOPT-BENCH 2', `FIELDS ${BENCH_FIELDS_DEG.length} ${BENCH_FIELDS_DEG.join(' ')}`];
+  const lenses = loadLenses();
+  for (const lens of lenses) writeLens(out, lens);
+  writePSF(out);
+  writeGlass(out);
+  writeMTF(out);
+  writeFocus(out);
+  writeStrehl(out);
+  writeZernike(out);
+  writeLM(out);
+  out.push('END');
+  fs.writeFileSync(file, out.join('\n') + '\n');
+  console.log(`wrote ${file}: ${lenses.length} lenses, PSF ${PSF_REF_SIZE}², ${packGlassTableForWasm().count} glasses`);
+}
+
+// --- compare ---
+
+function keyOf(r) {
+  return [r.name, r.lens ?? '', r.size ?? '', r.rays ?? ''].join('|');
+}
+
+function compare(baseFile, newFile, tolerance) {
+  const base = JSON.parse(fs.readFileSync(baseFile, 'utf8'));
+  const next = JSON.parse(fs.readFileSync(newFile, 'utf8'));
+  const baseMap = new Map(base.results.map((r) => [keyOf(r), r]));
+  let failed = false;
+
+  for (const r of next.results) {
+    const b = baseMap.get(keyOf(r));
+    if (!b || !(b.throughput > 0)) continue;
+    const ratio = r.throughput / b.throughput;
+    const flag = ratio < 1 - tolerance ? 'REGRESSION' : (ratio > 1 + tolerance ? 'faster' : '');
+    if (flag === 'REGRESSION') failed = true;
+    console.log(`${keyOf(r).padEnd(56)} ${b.throughput.toExponential(3)} -> ${r.throughput.toExponential(3)} ${r.unit} (x${ratio.toFixed(3)}) ${flag}`);
+  }
+  for (const a of next.accuracy || []) {
+    if (!a.pass) {
+      failed = true;
+      console.log(`accuracy FAIL: ${a.name} ${a.lens ?? ''} maxError=${a.maxError} mismatches=${a.mismatches ?? 0}`);
+    }
+  }
+  return failed ? 1 : 0;
+}
+
+const [cmd, a1, a2, ...rest] = process.argv.slice(2);
+if (cmd === 'fixtures' && a1) {
+  writeFixtures(a1);
+} else if (cmd === 'compare' && a1 && a2) {
+  const ti = rest.indexOf('--tolerance');
+  const tolerance = ti >= 0 ? Number(rest[ti + 1]) : 0.10;
+  process.exitCode = compare(a1, a2, Number.isFinite(tolerance) ? tolerance : 0.10);
+} else {
+  console.log('usage: node performance/kernel-benchmark.mjs fixtures <out.txt>');
+  console.log('       node performance/kernel-benchmark.mjs compare <base.json> <new.json> [--tolerance 0.10]');
+  process.exitCode = 2;
+}
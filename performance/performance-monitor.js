@@ -10,6 +10,7 @@ class PerformanceMonitor {
     constructor() {
         this.records = [];
         this.isEnabled = true;
+        this.wasmSamples = [];
     }
     
     /**
@@ -100,6 +101,7 @@ class PerformanceMonitor {
      */
     clear() {
         this.records = [];
+        this.wasmSamples = [];
     }
     
     /**
@@ -117,6 +119,136 @@ class PerformanceMonitor {
     setEnabled(enabled) {
         this.isEnabled = enabled;
     }
+
+    /**
+     * Snapshot the native WASM stage counters (see readRayTracingWasmStats / readPSFWasmStats)
+     * @param {Object} [modules] - { rayTracing, psf } Emscripten modules; rayTracing defaults to getWASMSystem().wasmModule
+     * @returns {Object|null} { timestamp, rayTracing, psf } or null when disabled
+     */
+    sampleWasmStats(modules = {}) {
+        if (!this.isEnabled) return null;
+        const sample = {
+            timestamp: performance.now(),
+            rayTracing: readRayTracingWasmStats(modules.rayTracing ?? __defaultRayTracingModule()),
+            psf: readPSFWasmStats(modules.psf ?? null)
+        };
+        this.wasmSamples.push(sample);
+        if (this.wasmSamples.length > WASM_STATS_MAX_SAMPLES) this.wasmSamples.shift();
+        return sample;
+    }
+
+    /**
+     * Get collected WASM counter snapshots
+     * @returns {Array} Array of samples (oldest first)
+     */
+    getWasmSamples() {
+        return [...this.wasmSamples];
+    }
+}
+
+// --- Native WASM counters (rt10_get_stats / psf_get_stats) ---
+// Layouts mirror RT10_STAT_* in wasm/raytracing/ray-tracing-wasm.c and PSF_STAT_* in wasm/psf-wasm.c.
+
+const WASM_STATS_MAX_SAMPLES = 100;
+
+export const RT10_STATS_LAYOUT = Object.freeze({
+    ENTRIES: Object.freeze(['traceSystem', 'traceSystemDerivs', 'traceSystemResume', 'traceBundle', 'traceBundleF32']),
+    ENTRY_FIELDS: 4,      // calls, rays, totalNs, lastNs
+    NEWTON_BINS: 16,      // iterations 0..14, last bin = 15 or more
+    FIELDS: 39
+});
+
+export const PSF_STATS_LAYOUT = Object.freeze({
+    ENTRIES: Object.freeze(['rays', 'grid', 'sessionRays', 'sessionGrid', 'batch', 'gridF32', 'mtf', 'focusStack']),
+    ENTRY_FIELDS: 3,      // calls, totalNs, lastNs
+    STAGES: Object.freeze(['init', 'alloc', 'interp', 'amp', 'fft', 'intensity', 'shift', 'total']),
+    FIELDS: 41
+});
+
+function __defaultRayTracingModule() {
+    try {
+        return globalThis.getWASMSystem?.()?.wasmModule ?? null;
+    } catch (_) {
+        return null;
+    }
+}
+
+function __readWasmCounters(module, getterName, fields) {
+    const getter = module?.[getterName];
+    if (typeof getter !== 'function' || !module.HEAPF64 || typeof module._malloc !== 'function') return null;
+    const ptr = module._malloc(fields * 8);
+    if (!ptr) return null;
+    try {
+        const n = Math.min(getter(ptr, fields) | 0, fields);
+        // malloc でメモリが伸びるとビューが差し替わるため、呼び出し後に取得する
+        return Array.from(module.HEAPF64.subarray(ptr >> 3, (ptr >> 3) + n));
+    } finally {
+        module._free(ptr);
+    }
+}
+
+/**
+ * Read the ray tracer counters (per-entry timing, Newton iteration histogram, miss counts)
+ * @param {Object} module - ray-tracing-wasm Emscripten module
+ * @returns {Object|null} null when the build has no _rt10_get_stats
+ */
+export function readRayTracingWasmStats(module) {
+    const L = RT10_STATS_LAYOUT;
+    const v = __readWasmCounters(module, '_rt10_get_stats', L.FIELDS);
+    if (!v || v.length < L.FIELDS) return null;
+    const entries = {};
+    L.ENTRIES.forEach((name, e) => {
+        const b = e * L.ENTRY_FIELDS;
+        entries[name] = { calls: v[b], rays: v[b + 1], totalNs: v[b + 2], lastNs: v[b + 3] };
+    });
+    const h = L.ENTRIES.length * L.ENTRY_FIELDS;
+    return {
+        entries,
+        newton: {
+            histogram: v.slice(h, h + L.NEWTON_BINS),
+            misses: v[h + L.NEWTON_BINS],
+            fallbackCalls: v[h + L.NEWTON_BINS + 1],
+            fallbackMisses: v[h + L.NEWTON_BINS + 2]
+        }
+    };
+}
+
+/**
+ * Read the PSF counters (per-entry timing, per-stage cumulative / last-call time, bytes allocated)
+ * @param {Object} module - psf-wasm Emscripten module
+ * @returns {Object|null} null when the build has no _psf_get_stats
+ */
+export function readPSFWasmStats(module) {
+    const L = PSF_STATS_LAYOUT;
+    const v = __readWasmCounters(module, '_psf_get_stats', L.FIELDS);
+    if (!v || v.length < L.FIELDS) return null;
+    const entries = {};
+    L.ENTRIES.forEach((name, e) => {
+        const b = e * L.ENTRY_FIELDS;
+        entries[name] = { calls: v[b], totalNs: v[b + 1], lastNs: v[b + 2] };
+    });
+    const s0 = L.ENTRIES.length * L.ENTRY_FIELDS;
+    const totalNs = {};
+    const lastNs = {};
+    L.STAGES.forEach((name, k) => {
+        totalNs[name] = v[s0 + k];
+        lastNs[name] = v[s0 + L.STAGES.length + k];
+    });
+    return { entries, stages: { totalNs, lastNs }, bytesAllocated: v[s0 + 2 * L.STAGES.length] };
+}
+
+/**
+ * Reset the native counters
+ * @param {Object} [modules] - { rayTracing, psf }
+ * @param {boolean} [options.newtonCounters] - also enable/disable the per-ray Newton counters (off by default in WASM)
+ */
+export function resetWasmStats(modules = {}, options = {}) {
+    const rt = modules.rayTracing ?? __defaultRayTracingModule();
+    if (typeof rt?._rt10_reset_stats === 'function') rt._rt10_reset_stats();
+    if (options.newtonCounters !== undefined && typeof rt?._rt10_stats_enable === 'function') {
+        rt._rt10_stats_enable(options.newtonCounters ? 1 : 0);
+    }
+    if (typeof modules.psf?._psf_reset_stats === 'function') modules.psf._psf_reset_stats();
 }
 
 // Global performance monitor instance
@@ -0,0 +1,224 @@
+/**
+ * First-order data cache (paraxial EFL / BFL / IMD / pupils)
+ *
+ * ray-paraxial.js の近軸計算は呼ぶたびに y-nu 追跡・瞳の探索・ガラス検索をやり直し、
+ * スポット図・Seidel・収差図・メリット評価がそれぞれ同じ光学系・同じ波長で何度も呼ぶ。
+ * 近軸量は光学系行と波長だけで決まるので、行の内容シグネチャ × 波長で結果を保持し、
+ * 光学系が変わったときだけ計算し直す。
+ *
+ * - シグネチャ = computeSurfaceOriginsSignature()（面原点・Coord Break と同じ入力）
+ *   + 行の全スカラー値（曲率・材料・屈折率・半径・面種など）の FNV-1a。行配列を作り直しても、
+ *   同じ配列を書き換えても内容が同じなら同じエントリを使う
+ * - 値は ray-paraxial.js の関数そのものの結果（定義は変えない）。キャッシュを壊さないよう複製を返す
+ * - getFirstOrderDataBatch() は構成 × 波長をまとめて引く（シグネチャは構成ごとに 1 回）
+ *
+ * y-nu 追跡自体は 1 系あたり数十面の漸化式なので WASM には移していない（JS↔WASM の受け渡しの方が重い）。
+ */
+
+import { computeSurfaceOriginsSignature } from './ray-tracing.js';
+import { calculateParaxialData, calculateFullSystemParaxialTrace, calculatePupilsByNewSpec } from './ray-paraxial.js';
+
+const DEFAULT_WAVELENGTH = 0.5875618;
+const MAX_CACHED_SYSTEMS = 32;
+
+// signature → { waves: Map<wavelength, { paraxial?, trace?, pupils? }> }（Map の挿入順 = LRU 順）
+const __systems = new Map();
+const __stats = { hits: 0, misses: 0 };
+
+// 列名・材料名などは同じ文字列が繰り返し出るので、文字列のハッシュは覚えておく
+const __stringHashes = new Map();
+const MAX_STRING_HASHES = 8192;
+const __f64 = new Float64Array(1);
+const __u32 = new Uint32Array(__f64.buffer);
+
+function __stringHash(s) {
+  let v = __stringHashes.get(s);
+  if (v !== undefined) return v;
+  let h = 0x811c9dc5;
+  for (let i = 0; i < s.length; i++) {
+    h ^= s.charCodeAt(i);
+    h = Math.imul(h, 16777619);
+  }
+  v = h | 0;
+  if (__stringHashes.size >= MAX_STRING_HASHES) __stringHashes.clear();
+  __stringHashes.set(s, v);
+  return v;
+}
+
+// 1 フィールド（キー + 値）の FNV-1a。行内はキーの順序に依らないよう加算で合わせる
+// （unpackOpticalSystemRows() で戻した行はキーの並びが元と違うことがある）
+function __fieldHash(keyHash, a, b) {
+  let h = Math.imul(0x811c9dc5 ^ keyHash, 16777619);
+  h = Math.imul(h ^ a, 16777619);
+  h = Math.imul(h ^ b, 16777619);
+  return h;
+}
+
+function __rowValuesHash(rows) {
+  let h = 0x811c9dc5;
+  const mixInt = (n) => {
+    h ^= (n | 0);
+    h = Math.imul(h, 16777619);
+  };
+  mixInt(rows.length);
+  for (const row of rows) {
+    if (!row || typeof row !== 'object') {
+      mixInt(-1);
+      continue;
+    }
+    let rowSum = 0;
+    for (const key of Object.keys(row)) {
+      const v = row[key];
+      const t = typeof v;
+      if (t === 'number') {
+        __f64[0] = v;
+        rowSum = (rowSum + __fieldHash(__stringHash(key), __u32[0], __u32[1])) | 0;
+      } else if (t === 'string') {
+        rowSum = (rowSum + __fieldHash(__stringHash(key), 0x73, __stringHash(v))) | 0;
+      } else if (t === 'boolean') {
+        rowSum = (rowSum + __fieldHash(__stringHash(key), v ? 3 : 2, 0)) | 0;
+      } else if (v === null) {
+        rowSum = (rowSum + __fieldHash(__stringHash(key), 1, 0)) | 0;
+      }
+    }
+    mixInt(rowSum);
+    mixInt(0x5f);
+  }
+  return h >>> 0;
+}
+
+/**
+ * 行の全スカラー値のハッシュ（u32, 行内のキー順には依らない）。packOpticalSystemBinary() がパック済み面テーブルと行の対応確認に使う
+ * @param {Array<Object>} opticalSystemRows
+ * @returns {number}
+ */
+export function computeRowsContentHash(opticalSystemRows) {
+  return __rowValuesHash(Array.isArray(opticalSystemRows) ? opticalSystemRows : []);
+}
+
+/**
+ * 近軸量のキャッシュキー（光学系行の内容から決まる）
+ * @param {Array<Object>} opticalSystemRows
+ * @returns {string}
+ */
+export function computeFirstOrderSignature(opticalSystemRows) {
+  const rows = Array.isArray(opticalSystemRows) ? opticalSystemRows : [];
+  return `${rows.length}:${computeSurfaceOriginsSignature(rows) >>> 0}:${__rowValuesHash(rows)}`;
+}
+
+function __clone(v) {
+  if (v === null || typeof v !== 'object') return v;
+  if (Array.isArray(v)) return v.map(__clone);
+  if (ArrayBuffer.isView(v)) return v.slice();
+  const out = {};
+  for (const k of Object.keys(v)) out[k] = __clone(v[k]);
+  return out;
+}
+
+function __waveEntry(signature, wavelength) {
+  let sys = __systems.get(signature);
+  if (sys) {
+    // LRU: 使ったものを末尾へ
+    __systems.delete(signature);
+  } else {
+    sys = { waves: new Map() };
+    while (__systems.size >= MAX_CACHED_SYSTEMS) __systems.delete(__systems.keys().next().value);
+  }
+  __systems.set(signature, sys);
+  let entry = sys.waves.get(wavelength);
+  if (!entry) {
+    entry = {};
+    sys.waves.set(wavelength, entry);
+  }
+  return entry;
+}
+
+function __normalizeWavelength(wavelength) {
+  const wl = Number(wavelength);
+  return (Number.isFinite(wl) && wl > 0) ? wl : DEFAULT_WAVELENGTH;
+}
+
+function __cached(opticalSystemRows, wavelength, field, compute, signature = null) {
+  if (!Array.isArray(opticalSystemRows) || opticalSystemRows.length === 0) return compute(opticalSystemRows, wavelength);
+  const wl = __normalizeWavelength(wavelength);
+  const entry = __waveEntry(signature ?? computeFirstOrderSignature(opticalSystemRows), wl);
+  if (Object.prototype.hasOwnProperty.call(entry, field)) {
+    __stats.hits++;
+  } else {
+    __stats.misses++;
+    let value = null;
+    try {
+      value = compute(opticalSystemRows, wl);
+    } catch (_) {
+      value = null;
+    }
+    entry[field] = value ?? null;
+  }
+  return __clone(entry[field]);
+}
+
+/**
+ * calculateParaxialData() のキャッシュ版（同じ戻り値）
+ */
+export function getParaxialData(opticalSystemRows, wavelength = DEFAULT_WAVELENGTH) {
+  return __cached(opticalSystemRows, wavelength, 'paraxial', calculateParaxialData);
+}
+
+/**
+ * calculateFullSystemParaxialTrace() のキャッシュ版（同じ戻り値）
+ */
+export function getFullSystemParaxialTrace(opticalSystemRows, wavelength = DEFAULT_WAVELENGTH) {
+  return __cached(opticalSystemRows, wavelength, 'trace', calculateFullSystemParaxialTrace);
+}
+
+/**
+ * calculatePupilsByNewSpec() のキャッシュ版（同じ戻り値）
+ */
+export function getPupilsByNewSpec(opticalSystemRows, wavelength = DEFAULT_WAVELENGTH) {
+  return __cached(opticalSystemRows, wavelength, 'pupils', calculatePupilsByNewSpec);
+}
+
+/** calculateFocalLength() と同じ値（キャッシュ経由） */
+export function getFocalLength(opticalSystemRows, wavelength = DEFAULT_WAVELENGTH) {
+  const trace = getFullSystemParaxialTrace(opticalSystemRows, wavelength);
+  return trace ? trace.focalLength : null;
+}
+
+/** calculateBackFocalLength() と同じ値（キャッシュ経由） */
+export function getBackFocalLength(opticalSystemRows, wavelength = DEFAULT_WAVELENGTH) {
+  const trace = getFullSystemParaxialTrace(opticalSystemRows, wavelength);
+  return trace ? trace.backFocalLength : null;
+}
+
+/**
+ * 構成 × 波長の近軸量をまとめて求める（未計算のものだけ計算する）
+ * @param {Array<Array<Object>>} systems 構成ごとの光学系行
+ * @param {Array<number>} wavelengths 波長（µm）
+ * @returns {Array<Array<{wavelength:number, paraxial:Object|null, trace:Object|null}>>} [構成][波長]
+ */
+export function getFirstOrderDataBatch(systems, wavelengths) {
+  const list = Array.isArray(systems) ? systems : [];
+  const wls = (Array.isArray(wavelengths) ? wavelengths : [wavelengths]).map(__normalizeWavelength);
+  return list.map((rows) => {
+    if (!Array.isArray(rows) || rows.length === 0) return wls.map((wavelength) => ({ wavelength, paraxial: null, trace: null }));
+    const signature = computeFirstOrderSignature(rows);
+    return wls.map((wavelength) => ({
+      wavelength,
+      paraxial: __cached(rows, wavelength, 'paraxial', calculateParaxialData, signature),
+      trace: __cached(rows, wavelength, 'trace', calculateFullSystemParaxialTrace, signature)
+    }));
+  });
+}
+
+export function clearFirstOrderCache() {
+  __systems.clear();
+  __stats.hits = 0;
+  __stats.misses = 0;
+}
+
+/**
+ * @returns {{hits:number, misses:number, systems:number}}
+ */
+export function getFirstOrderCacheStats() {
+  return { hits: __stats.hits, misses: __stats.misses, systems: __systems.size };
+}
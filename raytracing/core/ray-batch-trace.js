@@ -0,0 +1,1398 @@
+/**
+ * Batched whole-system ray tracing (WASM trace_system_rt10 front-end)
+ *
+ * traceRay() を光線ごとに呼ぶと、面ごとに JS↔WASM 境界を何度も跨ぐ
+ * （交点・サグ・法線）。ここでは光学系を一度だけ面テーブルへパックし、
+ * 光線バッチ全体を 1 回の WASM 呼び出しで追跡する。
+ *
+ * - 戻り値は traceRay() / traceRayHitPoint() と同じ形（rayPath / 交点 / null）。
+ * - _trace_bundle_rt10（SoA + SIMD128）があればそれを、無ければ _trace_system_rt10 を使う。
+ * - options.precision = 'f32' ではドラッグ中などのプレビュー向けに _trace_bundle_rt10_f32（4×f32 レーン）を使う。
+ *   実際に使われた精度は getLastBatchTracePrecision() で分かる。
+ * - WASM ビルドが古くどちらも無い場合は traceRay() にフォールバック。
+ * - 面テーブルのレイアウトは wasm/raytracing/ray-tracing-wasm.c の RT10_SURF_* と同期させること。
+ * - カタログガラスの屈折率は、対応ビルドではガラス ID（RT10_LAYOUT.GLASS）だけを書き、
+ *   WASM 内のガラステーブル（rt10_glass_load）から全波長分を評価する（getCorrectRefractiveIndex を呼ばない）。
+ * - traceSpotWasm() / traceSpotWasmAsync() はスポット図の光線をチャンク単位で追跡し、統計を WASM 内で集計する
+ *   （_trace_spot_rt10, 交点の全配列は作らない）。
+ * - packOpticalSystemBinary() は行と面テーブルを 1 つの ArrayBuffer（data/packed-optical-system.js）にまとめる。
+ *   各関数の options.packedSystem に渡すと、波長スロットが揃っていればその面テーブルを使う（行は内容ハッシュの照合だけ）。
+ */
+
+import {
+  traceRay,
+  traceRayHitPoint,
+  calculateSurfaceOrigins,
+  getCorrectRefractiveIndex,
+  isCoordTransRow,
+  getRayTracingWasmModule
+} from './ray-tracing.js';
+import { getIndexDelta } from './ray-paraxial.js';
+import { computeRowsContentHash } from './first-order-cache.js';
+import { miscellaneousDB, oharaGlassDB, schottGlassDB } from '../../data/glass.js';
+import { packOpticalSystemRows, readPackedOpticalSystem } from '../../data/packed-optical-system.js';
+
+export const RT10_LAYOUT = Object.freeze({
+  KIND: 0,
+  RADIUS: 1,
+  CONIC: 2,
+  COEF: 3,
+  MODE_ODD: 13,
+  SEMIDIA: 14,
+  AP_KIND: 15,
+  AP_A: 16,
+  AP_B: 17,
+  THICKNESS: 18,
+  ORIGIN: 19,
+  ROT: 22,
+  INDEX: 31,
+  GLASS: 39,
+  STRIDE: 40,
+  MAX_WAVELENGTHS: 8
+});
+
+export const RT10_KIND = Object.freeze({ REFRACT: 0, MIRROR: 1, COORD_BREAK: 2, OBJECT: 3 });
+export const RT10_AP = Object.freeze({ NONE: 0, CIRCLE: 1, RECT: 2 });
+export const RT10_STATUS = Object.freeze({ OK: 0, MISS: 1, BLOCKED: 2, TIR: 3, INVALID: 4 });
+
+// trace_system_rt10_derivs のパラメータ名 → 面テーブルのオフセット
+export const RT10_DERIV_PARAM = Object.freeze({
+  radius: 1, conic: 2, thickness: 18,
+  coef1: 3, coef2: 4, coef3: 5, coef4: 6, coef5: 7, coef6: 8, coef7: 9, coef8: 10, coef9: 11, coef10: 12
+});
+
+// ガラステーブル 1 行のレイアウト（ray-tracing-wasm.c の RT10_GLASS_* と同期）
+export const RT10_GLASS = Object.freeze({ FORMULA: 0, ND: 1, COEF: 2, STRIDE: 8, CONSTANT: 0, SELLMEIER: 1 });
+
+// SoA 光線バンドルの成分（wasm/raytracing/ray-tracing-wasm.c の RT10_BUNDLE_* と同期）
+export const RT10_BUNDLE = Object.freeze({ PX: 0, PY: 1, PZ: 2, DX: 3, DY: 4, DZ: 5, OPL: 6, ALIVE: 7, STATUS: 8, FIELDS: 9 });
+
+const RT10_TRACE_HIT_ONLY = 1;
+const RAY_IN_STRIDE = 6;
+const RAY_OUT_STRIDE = 7;
+
+function __wavelengthOf(ray) {
+  return ray?.wavelength || 0.55; // traceRay() と同じデフォルト
+}
+
+// traceRay() と同じ semidia 解釈（'Auto' / 空 / <=0 は制限なし）
+function __semidiaOf(row) {
+  const semiDiaValue = row.__cooptActualSemidia ?? row.semidia;
+  const semiDiaNum = Number(semiDiaValue);
+  return (semiDiaValue === 'Auto' || semiDiaValue === '' || !Number.isFinite(semiDiaNum) || semiDiaNum <= 0)
+    ? Infinity
+    : semiDiaNum;
+}
+
+function __rectApertureOf(row) {
+  const apertureShapeRaw = row._apertureShape ?? row.apertureShape ?? row.ApertureShape;
+  const shapeKey = String(apertureShapeRaw ?? '').trim().replace(/\s+/g, '').replace(/[_-]+/g, '').toLowerCase();
+  const isSquareShape = shapeKey === 'square' || shapeKey === 'sq';
+  const isRectShape = isSquareShape || shapeKey === 'rect' || shapeKey === 'rectangle' || shapeKey === 'rectangular';
+  if (!isRectShape) return null;
+
+  const wNum = Number(row._apertureWidth ?? row.apertureWidth ?? row.apertureX ?? row.apertureWidthMm);
+  const hNum = Number(row._apertureHeight ?? row.apertureHeight ?? row.apertureY ?? row.apertureHeightMm);
+  let halfW = NaN;
+  let halfH = NaN;
+  if (isSquareShape) {
+    const side = Number.isFinite(wNum) ? wNum : (Number.isFinite(hNum) ? hNum : NaN);
+    if (Number.isFinite(side) && side > 0) {
+      halfW = side / 2;
+      halfH = side / 2;
+    }
+  } else {
+    if (Number.isFinite(wNum) && wNum > 0) halfW = wNum / 2;
+    if (Number.isFinite(hNum) && hNum > 0) halfH = hNum / 2;
+  }
+  return (Number.isFinite(halfW) && Number.isFinite(halfH)) ? { halfW, halfH } : null;
+}
+
+// --- ガラステーブル（ray-paraxial.js の getGlassData と同じ検索順: misc → OHARA → SCHOTT, 先勝ち） ---
+let __glassTable = null;
+let __glassTableModule = null;
+
+/**
+ * 屈折率計算に使うガラスカタログを rt10_glass_load 用のテーブルへパックする（初回のみ構築, 以後は同じオブジェクト）。
+ * Sellmeier 係数の無いガラスは nd の定数（getRefractiveIndex と同じ扱い）。
+ * @returns {{table: Float64Array, count: number, ids: Map<string, number>}}
+ */
+export function packGlassTableForWasm() {
+  if (__glassTable) return __glassTable;
+  const G = RT10_GLASS;
+  const ids = new Map();
+  const rows = [];
+  for (const db of [miscellaneousDB, oharaGlassDB, schottGlassDB]) {
+    if (!Array.isArray(db)) continue;
+    for (const glass of db) {
+      if (!glass || typeof glass.name !== 'string' || ids.has(glass.name)) continue;
+      ids.set(glass.name, rows.length);
+      rows.push(glass);
+    }
+  }
+  const table = new Float64Array(rows.length * G.STRIDE);
+  for (let i = 0; i < rows.length; i++) {
+    const b = i * G.STRIDE;
+    const sm = rows[i].sellmeier;
+    table[b + G.ND] = Number(rows[i].nd);
+    if (sm) {
+      table[b + G.FORMULA] = G.SELLMEIER;
+      const coefs = [sm.A1, sm.A2, sm.A3, sm.B1, sm.B2, sm.B3];
+      for (let k = 0; k < 6; k++) table[b + G.COEF + k] = Number(coefs[k]);
+    }
+  }
+  __glassTable = { table, count: rows.length, ids };
+  return __glassTable;
+}
+
+// getRefractiveIndex がカタログを引く材質ならそのガラス ID、それ以外（空気・数値・手動屈折率）は -1
+function __glassIdOf(material) {
+  if (typeof material !== 'string' || material === '' || material === 'Air' || material === 'AIR' || material === 'empty') {
+    return -1;
+  }
+  const id = packGlassTableForWasm().ids.get(material);
+  return id === undefined ? -1 : id;
+}
+
+/**
+ * @returns {boolean} WASM 内のガラステーブルで屈折率スロットを埋められるか（rt10_resolve_indices）
+ */
+export function isNativeDispersionWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return !!(module && module.HEAPF64 && typeof module._malloc === 'function' &&
+    typeof module._rt10_glass_load === 'function' && typeof module._rt10_resolve_indices === 'function');
+}
+
+// ガラステーブルはモジュールごとに 1 回だけ読み込む
+function __ensureGlassTableLoaded(module) {
+  if (__glassTableModule === module) return true;
+  const { table, count } = packGlassTableForWasm();
+  const ptr = module._malloc(Math.max(1, table.length * 8));
+  if (!ptr) return false;
+  try {
+    module.HEAPF64.set(table, ptr >> 3);
+    if (module._rt10_glass_load(ptr, count) !== count) return false;
+  } finally {
+    module._free(ptr);
+  }
+  __glassTableModule = module;
+  return true;
+}
+
+// RT10_LAYOUT.GLASS が書かれた面の屈折率スロットを WASM で埋める（失敗時は false, テーブルはそのまま）
+function __resolveIndicesWasm(module, surfaces, surfaceCount, wls) {
+  if (!__ensureGlassTableLoaded(module)) return false;
+  const surfPtr = __scratchPtr(module, 'surfaces', surfaces.length * 8);
+  const wlPtr = __scratchPtr(module, 'glassWavelengths', RT10_LAYOUT.MAX_WAVELENGTHS * 8);
+  if (!surfPtr || !wlPtr) return false;
+  module.HEAPF64.set(surfaces, surfPtr >> 3);
+  module.HEAPF64.set(wls, wlPtr >> 3);
+  if (module._rt10_resolve_indices(surfPtr, surfaceCount, wlPtr, wls.length) < 0) return false;
+  surfaces.set(module.HEAPF64.subarray(surfPtr >> 3, (surfPtr >> 3) + surfaces.length));
+  return true;
+}
+
+/**
+ * 光学系を trace_system_rt10 用の面テーブルへパックする。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Array<number>} wavelengths 屈折率スロットに割り当てる波長（µm, 最大 RT10_LAYOUT.MAX_WAVELENGTHS）
+ * @param {Object} [options]
+ * @param {number|null} [options.maxSurfaceIndex] 評価面（traceRay の maxSurfaceIndex と同じ）
+ * @param {boolean} [options.nativeDispersion=true] 対応ビルドではカタログガラスの屈折率を WASM で評価する
+ *   （RT10_LAYOUT.GLASS にガラス ID + 1 を書く。値は getCorrectRefractiveIndex と同じ）
+ * @param {ArrayBuffer|ArrayBufferView} [options.packedSystem] 同じ行から作った packOpticalSystemBinary() の出力。
+ *   要求した波長がすべて同梱の面テーブルにあれば、行を走査せずにそれを使う（スロットが同順ならコピーもしない）。
+ *   ヘッダの内容ハッシュが opticalSystemRows と一致しなければ（パック後に行が変わった）例外を投げる
+ * @returns {{surfaces: Float64Array, surfaceCount: number, wavelengths: number[]}}
+ */
+export function packOpticalSystemForWasm(opticalSystemRows, wavelengths, options = {}) {
+  const L = RT10_LAYOUT;
+  const maxSurfaceIndex = options?.maxSurfaceIndex;
+  const rows = (maxSurfaceIndex !== null && maxSurfaceIndex !== undefined && maxSurfaceIndex >= 0)
+    ? opticalSystemRows.slice(0, maxSurfaceIndex + 1)
+    : opticalSystemRows;
+  const wls = (Array.isArray(wavelengths) ? wavelengths : [wavelengths]).slice(0, L.MAX_WAVELENGTHS);
+  const fromPacked = options?.packedSystem ? __rt10FromPacked(options.packedSystem, opticalSystemRows, rows.length, wls) : null;
+  if (fromPacked) return fromPacked;
+  const surfaceData = calculateSurfaceOrigins(rows);
+  const surfaces = new Float64Array(rows.length * L.STRIDE);
+  const module = (options?.nativeDispersion !== false && wls.length > 0 && isNativeDispersionWasmAvailable())
+    ? getRayTracingWasmModule()
+    : null;
+  // WASM で評価する面（解決に失敗したら JS で埋め直す）
+  const nativeRows = [];
+
+  // 面通過後の媒質の屈折率を全波長分書く
+  const writeIndex = (base, indexOf, material) => {
+    const id = module ? __glassIdOf(material) : -1;
+    if (id >= 0) {
+      surfaces[base + L.GLASS] = id + 1;
+      nativeRows.push({ base, indexOf });
+      return;
+    }
+    for (let w = 0; w < wls.length; w++) {
+      surfaces[base + L.INDEX + w] = indexOf(wls[w]);
+    }
+  };
+
+  // 原点・回転は全行に書く（CB/Object 行は追跡では使わないが、thickness 微分の移動方向 R(s)·ez に使う）
+  const writeFrame = (i, base) => {
+    const info = surfaceData[i];
+    const o = info?.origin || { x: 0, y: 0, z: 0 };
+    surfaces[base + L.ORIGIN] = o.x;
+    surfaces[base + L.ORIGIN + 1] = o.y;
+    surfaces[base + L.ORIGIN + 2] = o.z;
+    const m = info?.rotationMatrix;
+    for (let r = 0; r < 3; r++) {
+      for (let c = 0; c < 3; c++) {
+        surfaces[base + L.ROT + r * 3 + c] = m ? m[r][c] : (r === c ? 1 : 0);
+      }
+    }
+  };
+
+  for (let i = 0; i < rows.length; i++) {
+    const row = rows[i] || {};
+    const base = i * L.STRIDE;
+    writeFrame(i, base);
+
+    if (isCoordTransRow(row)) {
+      surfaces[base + L.KIND] = RT10_KIND.COORD_BREAK;
+      const gapMat = String(row.__cooptGapMaterial ?? '').trim();
+      if (gapMat !== '') {
+        const isAir = gapMat.replace(/\s+/g, '').toUpperCase() === 'AIR';
+        if (isAir) {
+          for (let w = 0; w < wls.length; w++) surfaces[base + L.INDEX + w] = 1.0;
+        } else {
+          writeIndex(base, (wl) => getCorrectRefractiveIndex({ material: gapMat }, wl), gapMat);
+        }
+      }
+      continue;
+    }
+
+    if (row['object type'] === 'Object') {
+      surfaces[base + L.KIND] = RT10_KIND.OBJECT;
+      surfaces[base + L.THICKNESS] = parseFloat(row.thickness) || 0;
+      continue;
+    }
+
+    const isMirror = (typeof row.material === 'string' && row.material === 'MIRROR');
+    surfaces[base + L.KIND] = isMirror ? RT10_KIND.MIRROR : RT10_KIND.REFRACT;
+
+    const isPlane = !isFinite(row.radius) || row.radius === 0;
+    const radius = isPlane ? 0 : Number(row.radius);
+    surfaces[base + L.RADIUS] = Number.isFinite(radius) ? radius : 0;
+    surfaces[base + L.CONIC] = Number(row.conic) || 0;
+    for (let k = 0; k < 10; k++) {
+      surfaces[base + L.COEF + k] = Number(row[`coef${k + 1}`]) || 0;
+    }
+    const surfType = String(row.surfType ?? row.type ?? '').trim().toLowerCase();
+    surfaces[base + L.MODE_ODD] = surfType.includes('odd') ? 1 : 0;
+
+    const semiDia = __semidiaOf(row);
+    surfaces[base + L.SEMIDIA] = Number.isFinite(semiDia) ? semiDia : 0;
+
+    // 開口（Image 面は判定しない。評価面は WASM 側で stop_surface としてスキップ）
+    const isImageSurface = row['object type'] === 'Image' || row.object === 'Image';
+    if (!isImageSurface) {
+      const rect = isPlane ? __rectApertureOf(row) : null;
+      if (rect) {
+        surfaces[base + L.AP_KIND] = RT10_AP.RECT;
+        surfaces[base + L.AP_A] = rect.halfW;
+        surfaces[base + L.AP_B] = rect.halfH;
+      } else {
+        let apertureLimit = Infinity;
+        if (row['object type'] === 'STO' || String(row.object).toUpperCase() === 'STO') {
+          const apertureDiameter = parseFloat(row.aperture || row.Aperture || 0);
+          if (apertureDiameter > 0) apertureLimit = apertureDiameter / 2;
+        }
+        apertureLimit = Math.min(apertureLimit, semiDia);
+        if (Number.isFinite(apertureLimit)) {
+          surfaces[base + L.AP_KIND] = RT10_AP.CIRCLE;
+          surfaces[base + L.AP_A] = apertureLimit;
+        }
+      }
+    }
+
+    surfaces[base + L.THICKNESS] = parseFloat(row.thickness) || 0;
+
+    if (!isMirror) {
+      // Δn（getIndexDelta）付きの面は WASM のガラステーブルを使わず JS で評価する
+      writeIndex(base, (wl) => getCorrectRefractiveIndex(row, wl), getIndexDelta(row) !== 0 ? null : row.material);
+    }
+  }
+
+  if (nativeRows.length > 0 && !__resolveIndicesWasm(module, surfaces, rows.length, wls)) {
+    for (const { base, indexOf } of nativeRows) {
+      surfaces[base + L.GLASS] = 0;
+      for (let w = 0; w < wls.length; w++) surfaces[base + L.INDEX + w] = indexOf(wls[w]);
+    }
+  }
+
+  return { surfaces, surfaceCount: rows.length, wavelengths: wls };
+}
+
+// packOpticalSystemBinary() の面テーブルから surfaceCount 面・wls の順の屈折率スロットを取り出す（無理なら null）
+function __rt10FromPacked(packedSystem, opticalSystemRows, surfaceCount, wls) {
+  const L = RT10_LAYOUT;
+  let packed = null;
+  try {
+    packed = readPackedOpticalSystem(packedSystem);
+  } catch (_) {
+    return null;
+  }
+  const rt10 = packed.rt10;
+  if (!rt10) return null;
+  // 古いパックを黙って使うと別の光学系を追跡してしまう
+  if (packed.signature === null || packed.signature !== computeRowsContentHash(opticalSystemRows)) {
+    throw new Error('packedSystem does not match opticalSystemRows (re-run packOpticalSystemBinary after editing the rows)');
+  }
+  if (rt10.stride !== L.STRIDE || rt10.surfaceCount < surfaceCount || surfaceCount === 0) return null;
+  const slots = wls.map((wl) => rt10.wavelengths.indexOf(wl));
+  if (slots.some((k) => k < 0)) return null;
+
+  const n = surfaceCount * L.STRIDE;
+  if (slots.every((k, w) => k === w)) {
+    return { surfaces: rt10.surfaces.subarray(0, n), surfaceCount, wavelengths: wls.slice() };
+  }
+  const surfaces = rt10.surfaces.slice(0, n);
+  for (let i = 0; i < surfaceCount; i++) {
+    const base = i * L.STRIDE + L.INDEX;
+    for (let w = 0; w < L.MAX_WAVELENGTHS; w++) {
+      surfaces[base + w] = (w < slots.length) ? rt10.surfaces[base + slots[w]] : 0;
+    }
+  }
+  return { surfaces, surfaceCount, wavelengths: wls.slice() };
+}
+
+/**
+ * 光学系を転送・保持用のパック形式（data/packed-optical-system.js）にする。
+ * 行（JSON と同じ値）に加えて wavelengths の RT10 面テーブルを同梱するので、ワーカーへ transferable として渡し、
+ * 受け側では options.packedSystem に渡すだけで行を走査せずに追跡できる（行は unpackOpticalSystemRows で復元）。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Array<number>} wavelengths 同梱する波長（µm, 最大 RT10_LAYOUT.MAX_WAVELENGTHS）
+ * @param {Object} [options]
+ * @param {boolean} [options.nativeDispersion=true] packOpticalSystemForWasm と同じ
+ * @returns {ArrayBuffer}
+ */
+export function packOpticalSystemBinary(opticalSystemRows, wavelengths, options = {}) {
+  const rows = Array.isArray(opticalSystemRows) ? opticalSystemRows : [];
+  const rt10 = rows.length > 0
+    ? packOpticalSystemForWasm(rows, wavelengths, { nativeDispersion: options?.nativeDispersion })
+    : null;
+  return packOpticalSystemRows(rows, { rt10, rt10Stride: RT10_LAYOUT.STRIDE, signature: computeRowsContentHash(rows) });
+}
+
+// --- grow-only WASM scratch buffers (光線バッチごとの malloc/free を避ける) ---
+const __scratch = { module: null, ptrs: {}, sizes: {} };
+
+function __scratchPtr(module, name, bytes) {
+  if (__scratch.module !== module) {
+    __scratch.module = module;
+    __scratch.ptrs = {};
+    __scratch.sizes = {};
+  }
+  if ((__scratch.sizes[name] || 0) >= bytes && __scratch.ptrs[name]) return __scratch.ptrs[name];
+  if (__scratch.ptrs[name]) module._free(__scratch.ptrs[name]);
+  const cap = Math.max(bytes, 1024);
+  const ptr = module._malloc(cap);
+  __scratch.ptrs[name] = ptr;
+  __scratch.sizes[name] = ptr ? cap : 0;
+  return ptr;
+}
+
+/**
+ * @returns {boolean} 一括追跡の WASM エントリポイントが使えるか
+ */
+export function isBatchTraceWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return !!(module && typeof module._trace_system_rt10 === 'function' && module.HEAPF64 && module.HEAP32 &&
+    typeof module._malloc === 'function');
+}
+
+/**
+ * @returns {boolean} 面パラメータ微分付きの一括追跡（trace_system_rt10_derivs）が使えるか
+ */
+export function isTraceDerivativesWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && typeof module._trace_system_rt10_derivs === 'function';
+}
+
+/**
+ * @returns {boolean} SoA バンドル版（SIMD128）の一括追跡が使えるか
+ */
+export function isBundleTraceWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() &&
+    typeof module._trace_bundle_rt10 === 'function' && typeof module._bundle_init_rt10 === 'function';
+}
+
+/**
+ * @returns {boolean} float32 プレビュー版（trace_bundle_rt10_f32）の一括追跡が使えるか
+ */
+export function isF32BundleTraceWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && !!module.HEAPF32 &&
+    typeof module._trace_bundle_rt10_f32 === 'function' && typeof module._bundle_init_rt10_f32 === 'function';
+}
+
+// 直前の traceRaysBatch() が結果を作った精度（'f64' | 'f32' | 'js'）
+let __lastPrecision = 'f64';
+
+/**
+ * @returns {'f64'|'f32'|'js'} 直前の traceRaysBatch() で使われた精度（'js' は traceRay() フォールバック）
+ */
+export function getLastBatchTracePrecision() {
+  return __lastPrecision;
+}
+
+// AoS 版（trace_system_rt10）: rays_in/out は光線ごとにインターリーブ
+function __allocAosViews(module, packed, maxGroup, hitOnly) {
+  const S = packed.surfaceCount;
+  const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+  const inPtr = __scratchPtr(module, 'raysIn', maxGroup * RAY_IN_STRIDE * 8);
+  const outPtr = __scratchPtr(module, 'raysOut', maxGroup * RAY_OUT_STRIDE * 8);
+  const statusPtr = __scratchPtr(module, 'status', maxGroup * 4);
+  const hitsPtr = hitOnly ? 0 : __scratchPtr(module, 'hits', maxGroup * S * 3 * 8);
+  if (!surfPtr || !inPtr || !outPtr || !statusPtr || (!hitOnly && !hitsPtr)) return null;
+  // malloc でメモリが伸びるとビューが差し替わるため、確保後に取得する
+  module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+
+  return {
+    run(idx, rays, slot, n0, stopSurface, flags) {
+      const count = idx.length;
+      const heap = module.HEAPF64;
+      const inBase = inPtr >> 3;
+      for (let k = 0; k < count; k++) {
+        const r = rays[idx[k]];
+        const b = inBase + k * RAY_IN_STRIDE;
+        heap[b] = Number(r.pos.x); heap[b + 1] = Number(r.pos.y); heap[b + 2] = Number(r.pos.z);
+        heap[b + 3] = Number(r.dir.x); heap[b + 4] = Number(r.dir.y); heap[b + 5] = Number(r.dir.z);
+      }
+      if (hitsPtr) heap.fill(NaN, hitsPtr >> 3, (hitsPtr >> 3) + count * S * 3);
+
+      module._trace_system_rt10(surfPtr, S, inPtr, count, slot, n0, stopSurface, flags, outPtr, statusPtr, hitsPtr);
+
+      const f64 = module.HEAPF64;
+      const i32 = module.HEAP32;
+      const outBase = outPtr >> 3;
+      const hitsBase = hitsPtr >> 3;
+      return {
+        status: (k) => i32[(statusPtr >> 2) + k],
+        opl: (k) => f64[outBase + k * RAY_OUT_STRIDE + 6],
+        pos: (k) => {
+          const ob = outBase + k * RAY_OUT_STRIDE;
+          return { x: f64[ob], y: f64[ob + 1], z: f64[ob + 2] };
+        },
+        hit: (k, s) => {
+          const hb = hitsBase + (k * S + s) * 3;
+          const x = f64[hb];
+          return Number.isNaN(x) ? null : { x, y: f64[hb + 1], z: f64[hb + 2] };
+        }
+      };
+    }
+  };
+}
+
+// SoA 版（trace_bundle_rt10）: 成分ごとに capacity 個ずつ並べる（capacity は偶数）
+function __allocBundleViews(module, packed, maxGroup, hitOnly) {
+  const S = packed.surfaceCount;
+  const cap = (maxGroup + 1) & ~1;
+  const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+  const bundlePtr = __scratchPtr(module, 'bundle', cap * RT10_BUNDLE.FIELDS * 8);
+  const hitsPtr = hitOnly ? 0 : __scratchPtr(module, 'bundleHits', cap * S * 3 * 8);
+  if (!surfPtr || !bundlePtr || (!hitOnly && !hitsPtr)) return null;
+  module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+
+  return {
+    run(idx, rays, slot, n0, stopSurface, flags) {
+      const count = idx.length;
+      const heap = module.HEAPF64;
+      const b = bundlePtr >> 3;
+      for (let k = 0; k < count; k++) {
+        const r = rays[idx[k]];
+        heap[b + RT10_BUNDLE.PX * cap + k] = Number(r.pos.x);
+        heap[b + RT10_BUNDLE.PY * cap + k] = Number(r.pos.y);
+        heap[b + RT10_BUNDLE.PZ * cap + k] = Number(r.pos.z);
+        heap[b + RT10_BUNDLE.DX * cap + k] = Number(r.dir.x);
+        heap[b + RT10_BUNDLE.DY * cap + k] = Number(r.dir.y);
+        heap[b + RT10_BUNDLE.DZ * cap + k] = Number(r.dir.z);
+      }
+      if (hitsPtr) heap.fill(NaN, hitsPtr >> 3, (hitsPtr >> 3) + cap * S * 3);
+
+      module._bundle_init_rt10(bundlePtr, cap, count);
+      module._trace_bundle_rt10(surfPtr, S, bundlePtr, cap, count, slot, n0, stopSurface, flags, hitsPtr);
+
+      const f64 = module.HEAPF64;
+      const hitsBase = hitsPtr >> 3;
+      return {
+        status: (k) => f64[b + RT10_BUNDLE.STATUS * cap + k] | 0,
+        opl: (k) => f64[b + RT10_BUNDLE.OPL * cap + k],
+        pos: (k) => ({
+          x: f64[b + RT10_BUNDLE.PX * cap + k],
+          y: f64[b + RT10_BUNDLE.PY * cap + k],
+          z: f64[b + RT10_BUNDLE.PZ * cap + k]
+        }),
+        hit: (k, s) => {
+          const hb = hitsBase + s * 3 * cap + k;
+          const x = f64[hb];
+          return Number.isNaN(x) ? null : { x, y: f64[hb + cap], z: f64[hb + 2 * cap] };
+        }
+      };
+    }
+  };
+}
+
+// float32 SoA 版（trace_bundle_rt10_f32）: 並びは f64 版と同じ、capacity は 4 の倍数。面テーブルは double のまま
+function __allocBundleF32Views(module, packed, maxGroup, hitOnly) {
+  const S = packed.surfaceCount;
+  const cap = (maxGroup + 3) & ~3;
+  const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+  const bundlePtr = __scratchPtr(module, 'bundleF32', cap * RT10_BUNDLE.FIELDS * 4);
+  const hitsPtr = hitOnly ? 0 : __scratchPtr(module, 'bundleHitsF32', cap * S * 3 * 4);
+  if (!surfPtr || !bundlePtr || (!hitOnly && !hitsPtr)) return null;
+  module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+
+  return {
+    run(idx, rays, slot, n0, stopSurface, flags) {
+      const count = idx.length;
+      const heap = module.HEAPF32;
+      const b = bundlePtr >> 2;
+      for (let k = 0; k < count; k++) {
+        const r = rays[idx[k]];
+        heap[b + RT10_BUNDLE.PX * cap + k] = Number(r.pos.x);
+        heap[b + RT10_BUNDLE.PY * cap + k] = Number(r.pos.y);
+        heap[b + RT10_BUNDLE.PZ * cap + k] = Number(r.pos.z);
+        heap[b + RT10_BUNDLE.DX * cap + k] = Number(r.dir.x);
+        heap[b + RT10_BUNDLE.DY * cap + k] = Number(r.dir.y);
+        heap[b + RT10_BUNDLE.DZ * cap + k] = Number(r.dir.z);
+      }
+      if (hitsPtr) heap.fill(NaN, hitsPtr >> 2, (hitsPtr >> 2) + cap * S * 3);
+
+      module._bundle_init_rt10_f32(bundlePtr, cap, count);
+      module._trace_bundle_rt10_f32(surfPtr, S, bundlePtr, cap, count, slot, n0, stopSurface, flags, hitsPtr);
+
+      const f32 = module.HEAPF32;
+      const hitsBase = hitsPtr >> 2;
+      return {
+        status: (k) => f32[b + RT10_BUNDLE.STATUS * cap + k] | 0,
+        opl: (k) => f32[b + RT10_BUNDLE.OPL * cap + k],
+        pos: (k) => ({
+          x: f32[b + RT10_BUNDLE.PX * cap + k],
+          y: f32[b + RT10_BUNDLE.PY * cap + k],
+          z: f32[b + RT10_BUNDLE.PZ * cap + k]
+        }),
+        hit: (k, s) => {
+          const hb = hitsBase + s * 3 * cap + k;
+          const x = f32[hb];
+          return Number.isNaN(x) ? null : { x, y: f32[hb + cap], z: f32[hb + 2 * cap] };
+        }
+      };
+    }
+  };
+}
+
+// --- 差分追跡キャッシュ（trace_system_rt10_resume, options.incremental） ---
+// 直前の 1 系統ぶんだけ保持する。光線・波長・評価面が同じで面テーブルの一部だけが変わった場合、
+// 最初に変わった行から再追跡する（それより前の面の入射状態は WASM 側の states に残っている）。
+const __incremental = { module: null, key: null, raysIn: null, surfaces: null, groups: [] };
+
+function __freeIncrementalGroups() {
+  const module = __incremental.module;
+  for (const g of __incremental.groups) {
+    if (!module) break;
+    for (const p of [g.inPtr, g.outPtr, g.statusPtr, g.hitsPtr, g.statesPtr]) {
+      if (p) module._free(p);
+    }
+  }
+  __incremental.groups = [];
+}
+
+/**
+ * 差分追跡キャッシュを破棄し、WASM 側のバッファを解放する。
+ */
+export function clearIncrementalTraceCache() {
+  __freeIncrementalGroups();
+  __incremental.module = null;
+  __incremental.key = null;
+  __incremental.raysIn = null;
+  __incremental.surfaces = null;
+}
+
+/**
+ * @returns {boolean} 差分追跡（trace_system_rt10_resume）が使えるか
+ */
+export function isIncrementalTraceWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && typeof module._trace_system_rt10_resume === 'function' &&
+    typeof module._rt10_state_stride === 'function';
+}
+
+// NaN 同士は等しいとみなす（パック済みテーブルの比較用）
+function __sameNumber(a, b) {
+  return a === b || (a !== a && b !== b);
+}
+
+function __firstDirtyRow(prev, next, stride) {
+  const rows = next.length / stride;
+  for (let r = 0; r < rows; r++) {
+    for (let k = r * stride, e = k + stride; k < e; k++) {
+      if (!__sameNumber(prev[k], next[k])) return r;
+    }
+  }
+  return rows;
+}
+
+function __incrementalViews(module, packed, groups, wls, rays, n0, stopSurface, flags) {
+  const S = packed.surfaceCount;
+  const hitOnly = (flags & RT10_TRACE_HIT_ONLY) !== 0;
+  const key = `${S}|${n0}|${stopSurface}|${flags}|${wls.join(',')}`;
+
+  const raysIn = new Float64Array(rays.length * (RAY_IN_STRIDE + 1));
+  for (let i = 0; i < rays.length; i++) {
+    const r = rays[i];
+    const b = i * (RAY_IN_STRIDE + 1);
+    raysIn[b] = Number(r.pos.x); raysIn[b + 1] = Number(r.pos.y); raysIn[b + 2] = Number(r.pos.z);
+    raysIn[b + 3] = Number(r.dir.x); raysIn[b + 4] = Number(r.dir.y); raysIn[b + 5] = Number(r.dir.z);
+    raysIn[b + 6] = __wavelengthOf(r);
+  }
+
+  const reuse = __incremental.module === module && __incremental.key === key &&
+    __incremental.raysIn && __incremental.raysIn.length === raysIn.length &&
+    __firstDirtyRow(__incremental.raysIn, raysIn, raysIn.length) > 0 &&
+    __incremental.groups.length === wls.length;
+
+  let start = 0;
+  if (reuse) {
+    start = __firstDirtyRow(__incremental.surfaces, packed.surfaces, RT10_LAYOUT.STRIDE);
+  } else {
+    __freeIncrementalGroups();
+    __incremental.module = module;
+    __incremental.key = null;
+    const stateStride = module._rt10_state_stride();
+    for (let slot = 0; slot < wls.length; slot++) {
+      const count = groups.get(wls[slot]).length;
+      const g = {
+        count,
+        inPtr: module._malloc(Math.max(1, count * RAY_IN_STRIDE * 8)),
+        outPtr: module._malloc(Math.max(1, count * RAY_OUT_STRIDE * 8)),
+        statusPtr: module._malloc(Math.max(1, count * 4)),
+        hitsPtr: hitOnly ? 0 : module._malloc(Math.max(1, count * S * 3 * 8)),
+        statesPtr: module._malloc(Math.max(1, count * S * stateStride * 8))
+      };
+      __incremental.groups.push(g);
+      if (!g.inPtr || !g.outPtr || !g.statusPtr || (!hitOnly && !g.hitsPtr) || !g.statesPtr) {
+        clearIncrementalTraceCache();
+        return null;
+      }
+    }
+    for (let slot = 0; slot < wls.length; slot++) {
+      const idx = groups.get(wls[slot]);
+      const g = __incremental.groups[slot];
+      const heap = module.HEAPF64;
+      const inBase = g.inPtr >> 3;
+      for (let k = 0; k < idx.length; k++) {
+        const b = idx[k] * (RAY_IN_STRIDE + 1);
+        heap.set(raysIn.subarray(b, b + RAY_IN_STRIDE), inBase + k * RAY_IN_STRIDE);
+      }
+    }
+  }
+
+  if (start < S) {
+    const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+    if (!surfPtr) return null;
+    module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+    for (let slot = 0; slot < wls.length; slot++) {
+      const g = __incremental.groups[slot];
+      if (g.hitsPtr) {
+        // start 以降の面だけ書き直される（それより前の交点は前回の値を使う）
+        const heap = module.HEAPF64;
+        const hb = g.hitsPtr >> 3;
+        for (let k = 0; k < g.count; k++) heap.fill(NaN, hb + (k * S + start) * 3, hb + (k + 1) * S * 3);
+      }
+      const rc = module._trace_system_rt10_resume(surfPtr, S, g.inPtr, g.count, slot, n0, stopSurface, flags,
+        start, g.statesPtr, g.outPtr, g.statusPtr, g.hitsPtr);
+      if (rc < 0) {
+        clearIncrementalTraceCache();
+        return null;
+      }
+    }
+  }
+
+  __incremental.key = key;
+  __incremental.raysIn = raysIn;
+  __incremental.surfaces = packed.surfaces;
+
+  const f64 = module.HEAPF64;
+  const i32 = module.HEAP32;
+  return __incremental.groups.map((g) => {
+    const outBase = g.outPtr >> 3;
+    const hitsBase = g.hitsPtr >> 3;
+    return {
+      status: (k) => i32[(g.statusPtr >> 2) + k],
+      opl: (k) => f64[outBase + k * RAY_OUT_STRIDE + 6],
+      pos: (k) => {
+        const ob = outBase + k * RAY_OUT_STRIDE;
+        return { x: f64[ob], y: f64[ob + 1], z: f64[ob + 2] };
+      },
+      hit: (k, si) => {
+        const hb = hitsBase + (k * S + si) * 3;
+        const x = f64[hb];
+        return Number.isNaN(x) ? null : { x, y: f64[hb + 1], z: f64[hb + 2] };
+      }
+    };
+  });
+}
+
+function __traceFallback(opticalSystemRows, rays, n0, maxSurfaceIndex, returnHitPointOnly) {
+  return rays.map((ray) => (returnHitPointOnly
+    ? traceRayHitPoint(opticalSystemRows, ray, n0, maxSurfaceIndex)
+    : traceRay(opticalSystemRows, ray, n0, null, maxSurfaceIndex)));
+}
+
+/**
+ * 光線バッチを一括追跡する。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Array<{pos:{x,y,z}, dir:{x,y,z}, wavelength?:number}>} rays 入力光線（グローバル座標）
+ * @param {Object} [options]
+ * @param {number} [options.n0=1.0] 入射側媒質の屈折率
+ * @param {number|null} [options.maxSurfaceIndex=null] 評価面（traceRay と同じ意味）
+ * @param {boolean} [options.returnHitPointOnly=false] traceRayHitPoint() 互換の戻り値にする
+ * @param {Float64Array} [options.opticalPathOut] 光線ごとの光路長（最終交点まで）。フォールバック時は NaN
+ * @param {boolean} [options.incremental=false] 差分追跡: 前回と同じ光線バッチなら、面テーブルが最初に
+ *   変わった面から再追跡する（結果は全追跡と同一）。波長数が RT10_LAYOUT.MAX_WAVELENGTHS 以下のときのみ。
+ * @param {'f64'|'f32'} [options.precision='f64'] 'f32' は float32 プレビュー版（位置・OPL とも約 1e-5 の丸め）。
+ *   ドラッグ中の光線図・スポット図向けで、操作終了後に 'f64' で追跡し直すこと。使えなければ 'f64' で追跡する
+ *   （incremental とは併用しない）。
+ * @param {ArrayBuffer|ArrayBufferView} [options.packedSystem] packOpticalSystemBinary() の出力（packOpticalSystemForWasm 参照）
+ * @returns {Array<Array<{x,y,z}>|{x,y,z}|null>} 光線ごとの traceRay() 互換結果
+ */
+export function traceRaysBatch(opticalSystemRows, rays, options = {}) {
+  const n0 = Number.isFinite(options?.n0) ? options.n0 : 1.0;
+  const maxSurfaceIndex = (options?.maxSurfaceIndex !== null && options?.maxSurfaceIndex !== undefined)
+    ? Number(options.maxSurfaceIndex)
+    : null;
+  const returnHitPointOnly = !!options?.returnHitPointOnly;
+  const oplOut = options?.opticalPathOut || null;
+
+  if (!Array.isArray(opticalSystemRows) || !Array.isArray(rays) || rays.length === 0) return [];
+  if (returnHitPointOnly && (maxSurfaceIndex === null || !Number.isFinite(maxSurfaceIndex) || maxSurfaceIndex < 0)) {
+    return rays.map(() => null);
+  }
+
+  const module = getRayTracingWasmModule();
+  const useF32 = options?.precision === 'f32' && isF32BundleTraceWasmAvailable();
+  const useBundle = isBundleTraceWasmAvailable();
+  if (!useBundle && !isBatchTraceWasmAvailable()) {
+    if (oplOut) oplOut.fill(NaN);
+    __lastPrecision = 'js';
+    return __traceFallback(opticalSystemRows, rays, n0, maxSurfaceIndex, returnHitPointOnly);
+  }
+  __lastPrecision = useF32 ? 'f32' : 'f64';
+
+  // 波長ごとにグループ化（屈折率スロットは最大 MAX_WAVELENGTHS 個ずつパック）
+  const groups = new Map();
+  for (let i = 0; i < rays.length; i++) {
+    const wl = __wavelengthOf(rays[i]);
+    let g = groups.get(wl);
+    if (!g) groups.set(wl, (g = []));
+    g.push(i);
+  }
+  const allWavelengths = Array.from(groups.keys());
+  const results = new Array(rays.length).fill(null);
+  const incremental = !useF32 && !!options?.incremental && allWavelengths.length <= RT10_LAYOUT.MAX_WAVELENGTHS &&
+    isIncrementalTraceWasmAvailable();
+
+  for (let w0 = 0; w0 < allWavelengths.length; w0 += RT10_LAYOUT.MAX_WAVELENGTHS) {
+    const wls = allWavelengths.slice(w0, w0 + RT10_LAYOUT.MAX_WAVELENGTHS);
+    const packed = packOpticalSystemForWasm(opticalSystemRows, wls, { maxSurfaceIndex, packedSystem: options?.packedSystem });
+    const S = packed.surfaceCount;
+    if (S === 0) continue;
+
+    const targetKind = packed.surfaces[(S - 1) * RT10_LAYOUT.STRIDE + RT10_LAYOUT.KIND];
+    const targetHasHit = (S === (maxSurfaceIndex ?? -1) + 1) &&
+      targetKind !== RT10_KIND.COORD_BREAK && targetKind !== RT10_KIND.OBJECT;
+
+    const stopSurface = (maxSurfaceIndex === null) ? -1 : maxSurfaceIndex;
+    const flags = returnHitPointOnly ? RT10_TRACE_HIT_ONLY : 0;
+    const slotViews = incremental
+      ? __incrementalViews(module, packed, groups, wls, rays, n0, stopSurface, flags)
+      : null;
+
+    const maxGroup = Math.max(...wls.map((wl) => groups.get(wl).length));
+    const views = slotViews ? null : useF32
+      ? __allocBundleF32Views(module, packed, maxGroup, returnHitPointOnly)
+      : useBundle
+        ? __allocBundleViews(module, packed, maxGroup, returnHitPointOnly)
+        : __allocAosViews(module, packed, maxGroup, returnHitPointOnly);
+    if (!views && !slotViews) {
+      if (oplOut) oplOut.fill(NaN);
+      __lastPrecision = 'js';
+      return __traceFallback(opticalSystemRows, rays, n0, maxSurfaceIndex, returnHitPointOnly);
+    }
+
+    for (let slot = 0; slot < wls.length; slot++) {
+      const idx = groups.get(wls[slot]);
+      const count = idx.length;
+      const view = slotViews ? slotViews[slot] : views.run(idx, rays, slot, n0, stopSurface, flags);
+
+      for (let k = 0; k < count; k++) {
+        const ri = idx[k];
+        const status = view.status(k);
+        if (oplOut) oplOut[ri] = (status === RT10_STATUS.BLOCKED || status === RT10_STATUS.INVALID) ? NaN : view.opl(k);
+
+        if (status === RT10_STATUS.BLOCKED || status === RT10_STATUS.INVALID) {
+          results[ri] = null;
+          continue;
+        }
+        if (returnHitPointOnly) {
+          // traceRayHitPoint(): 評価面に到達した場合のみ交点を返す
+          const reached = (status === RT10_STATUS.OK) && targetHasHit;
+          results[ri] = reached ? view.pos(k) : null;
+          continue;
+        }
+        const r = rays[ri];
+        const path = [{ x: Number(r.pos.x), y: Number(r.pos.y), z: Number(r.pos.z) }];
+        for (let si = 0; si < S; si++) {
+          const hit = view.hit(k, si);
+          if (hit) path.push(hit);
+        }
+        results[ri] = path;
+      }
+    }
+  }
+
+  return results;
+}
+
+/**
+ * ドラッグ中は float32 で即時に追跡し、操作が止まったら double で追跡し直すスケジューラ。
+ *
+ * preview() は traceRaysBatch(precision:'f32') の結果で onResult(paths, 'f32') を呼び、最後の preview() から
+ * idleMs 後に同じ入力を f64 で追跡して onResult(paths, 'f64') を呼ぶ。f32 版が無い（結果が 'f64' / 'js'）
+ * ときはその結果が確定値なので再追跡しない。flush() は保留中の f64 追跡をすぐ実行し（ドラッグ終了時）、
+ * cancel() は破棄する。
+ *
+ * @param {Object} [options]
+ * @param {number} [options.idleMs=150] 最後の操作から double 追跡までの待ち時間
+ * @returns {{preview: (rows: Array<Object>, rays: Array<Object>, onResult: Function, traceOptions?: Object) => void,
+ *   flush: () => void, cancel: () => void}}
+ */
+export function createPreviewRefineTracer(options = {}) {
+  const idleMs = Number.isFinite(options?.idleMs) ? options.idleMs : 150;
+  let timer = null;
+  let pending = null;
+
+  const cancel = () => {
+    if (timer) clearTimeout(timer);
+    timer = null;
+    pending = null;
+  };
+  const flush = () => {
+    const job = pending;
+    cancel();
+    if (!job) return;
+    const paths = traceRaysBatch(job.rows, job.rays, { ...job.traceOptions, precision: 'f64' });
+    job.onResult(paths, getLastBatchTracePrecision());
+  };
+
+  return {
+    preview(rows, rays, onResult, traceOptions = {}) {
+      cancel();
+      const paths = traceRaysBatch(rows, rays, { ...traceOptions, precision: 'f32' });
+      const precision = getLastBatchTracePrecision();
+      onResult(paths, precision);
+      if (precision !== 'f32') return;
+      pending = { rows, rays, onResult, traceOptions };
+      timer = setTimeout(flush, idleMs);
+    },
+    flush,
+    cancel
+  };
+}
+
+// trace_opd_grid_rt10 のパラメータ / 付加情報レイアウト（ray-tracing-wasm.c の RT10_OPD_* と同期）
+export const RT10_OPD = Object.freeze({
+  MODE: 0, SOURCE: 1, PUPIL_C: 4, PUPIL_U: 7, PUPIL_V: 10, LEAD: 13, REF_RADIUS: 14, PARAMS: 15,
+  SOURCE_COLLIMATED: 0, SOURCE_POINT: 1,
+  INFO_IMAGE: 0, INFO_RADIUS: 3, INFO_N_IMAGE: 4, INFO_CHIEF_OPL: 5, INFO_VALID: 6, INFO_FIELDS: 7
+});
+
+/**
+ * @returns {boolean} 瞳格子の OPD を WASM 内で求められるか（trace_opd_grid_rt10）
+ */
+export function isOPDGridWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && typeof module._trace_opd_grid_rt10 === 'function';
+}
+
+// trace_opd_grid_rt10 / trace_opd_points_rt10 のパラメータ（瞳の定義が不完全なら null）
+function __opdParams(pupil, options) {
+  const O = RT10_OPD;
+  const params = new Float64Array(O.PARAMS);
+  const point = pupil.source === 'point';
+  const src = point ? pupil.objectPoint : pupil.direction;
+  if (!src || !pupil.center || !pupil.uAxis || !pupil.vAxis) return null;
+  const put = (offset, v) => {
+    params[offset] = Number(v.x); params[offset + 1] = Number(v.y); params[offset + 2] = Number(v.z);
+  };
+  params[O.MODE] = point ? O.SOURCE_POINT : O.SOURCE_COLLIMATED;
+  put(O.SOURCE, src);
+  put(O.PUPIL_C, pupil.center);
+  put(O.PUPIL_U, pupil.uAxis);
+  put(O.PUPIL_V, pupil.vAxis);
+  params[O.LEAD] = Number(pupil.lead) || 0;
+  const refRadius = Number(options?.referenceRadius ?? 0);
+  params[O.REF_RADIUS] = Number.isNaN(refRadius) ? 0 : refRadius;
+  return params;
+}
+
+/**
+ * 入射瞳の格子から OPD 格子を求める（追跡 → 参照球で閉じる までを 1 回の WASM 呼び出しで行う）。
+ * 結果は calculate_psf_grid_wasm の grid_opd / pupil_mask と同じ行優先レイアウト（行 = v, 列 = u）。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル（maxSurfaceIndex の面 = 像面）
+ * @param {Object} pupil 瞳格子の定義（グローバル座標, レンズ単位）
+ * @param {'collimated'|'point'} [pupil.source='collimated'] 平行光（direction）/ 点光源（objectPoint）
+ * @param {{x,y,z}} [pupil.direction] 平行光の方向
+ * @param {{x,y,z}} [pupil.objectPoint] 点光源の位置
+ * @param {{x,y,z}} pupil.center 入射瞳の中心（主光線が通る点）
+ * @param {{x,y,z}} pupil.uAxis u = +1 の瞳ベクトル（半径込み）
+ * @param {{x,y,z}} pupil.vAxis v = +1 の瞳ベクトル
+ * @param {number} [pupil.lead=0] 平行光の始点を瞳中心から光線方向に戻す距離（第 1 面より手前に置く）
+ * @param {Object} [options]
+ * @param {number} [options.gridSize=64]
+ * @param {number} [options.wavelength=0.5875618] 波長（µm）
+ * @param {number} [options.n0=1.0]
+ * @param {number} [options.referenceRadius=0] 参照球半径（0 = 射出瞳から自動, Infinity = 平面参照）
+ * @param {number|null} [options.maxSurfaceIndex=null] 像面として扱う面
+ * @param {ArrayBuffer|ArrayBufferView} [options.packedSystem] packOpticalSystemBinary() の出力（packOpticalSystemForWasm 参照）
+ * @returns {Object|null} { opd（µm, 主光線 = 0）, mask, gridSize, wavelength, imagePoint, referenceRadius,
+ *   imageIndex, chiefOpticalPath, validCount, toGridData() }。WASM 非対応・主光線が届かない場合は null
+ */
+export function traceOPDGridWasm(opticalSystemRows, pupil, options = {}) {
+  if (!Array.isArray(opticalSystemRows) || !pupil || !isOPDGridWasmAvailable()) return null;
+  const module = getRayTracingWasmModule();
+  const O = RT10_OPD;
+  const gridSize = Math.floor(Number(options?.gridSize) || 64);
+  const wavelength = Number(options?.wavelength) > 0 ? Number(options.wavelength) : 0.5875618;
+  const n0 = Number.isFinite(options?.n0) ? options.n0 : 1.0;
+  const maxSurfaceIndex = (options?.maxSurfaceIndex !== null && options?.maxSurfaceIndex !== undefined)
+    ? Number(options.maxSurfaceIndex)
+    : null;
+  if (!(gridSize > 0)) return null;
+
+  const packed = packOpticalSystemForWasm(opticalSystemRows, [wavelength], { maxSurfaceIndex, packedSystem: options?.packedSystem });
+  const S = packed.surfaceCount;
+  if (S < 2) return null;
+  const params = __opdParams(pupil, options);
+  if (!params) return null;
+
+  const total = gridSize * gridSize;
+  const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+  const paramsPtr = __scratchPtr(module, 'opdParams', O.PARAMS * 8);
+  const infoPtr = __scratchPtr(module, 'opdInfo', O.INFO_FIELDS * 8);
+  const opdPtr = __scratchPtr(module, 'opdGrid', total * 8);
+  const maskPtr = __scratchPtr(module, 'opdMask', total * 4);
+  if (!surfPtr || !paramsPtr || !infoPtr || !opdPtr || !maskPtr) return null;
+  module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+  module.HEAPF64.set(params, paramsPtr >> 3);
+
+  const rc = module._trace_opd_grid_rt10(surfPtr, S, paramsPtr, gridSize, 0, n0, opdPtr, maskPtr, infoPtr);
+  if (rc < 0) return null;
+
+  const f64 = module.HEAPF64;
+  const opd = f64.slice(opdPtr >> 3, (opdPtr >> 3) + total);
+  const mask = module.HEAP32.slice(maskPtr >> 2, (maskPtr >> 2) + total);
+  const info = f64.slice(infoPtr >> 3, (infoPtr >> 3) + O.INFO_FIELDS);
+  return {
+    opd,
+    mask,
+    gridSize,
+    wavelength,
+    imagePoint: { x: info[O.INFO_IMAGE], y: info[O.INFO_IMAGE + 1], z: info[O.INFO_IMAGE + 2] },
+    referenceRadius: info[O.INFO_RADIUS],
+    imageIndex: info[O.INFO_N_IMAGE],
+    chiefOpticalPath: info[O.INFO_CHIEF_OPL],
+    validCount: rc,
+    // PSFWasmWrapper.calculatePSFWasm の opdData.gridData 形式（2D 配列）
+    toGridData() {
+      const rows = (flat) => Array.from({ length: gridSize }, (_, i) => Array.from(flat.subarray(i * gridSize, (i + 1) * gridSize)));
+      return { opd: rows(opd), pupilMask: rows(mask).map((r) => r.map(Boolean)), amplitude: null };
+    }
+  };
+}
+
+/**
+ * @returns {boolean} 任意の瞳座標の OPD を WASM 内で求められるか（trace_opd_points_rt10）
+ */
+export function isOPDPointsWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && typeof module._trace_opd_points_rt10 === 'function';
+}
+
+/**
+ * 任意の瞳座標 (u, v) の OPD を求める（traceOPDGridWasm と同じ瞳定義・参照球・単位）。
+ * evaluation/adaptive-pupil-sampling.js の適応サンプリングが、細分化のたびに新しい点だけを渡す。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Object} pupil traceOPDGridWasm と同じ
+ * @param {Float64Array|Array<number>} uv 瞳座標（u0, v0, u1, v1, ...。瞳外の点も追跡する）
+ * @param {Object} [options] traceOPDGridWasm と同じ（gridSize 以外）
+ * @returns {Object|null} { opd（µm, Float64Array）, valid（Int32Array, 0/1）, count, imagePoint, referenceRadius,
+ *   imageIndex, chiefOpticalPath, validCount }。WASM 非対応・主光線が届かない場合は null
+ */
+export function traceOPDPointsWasm(opticalSystemRows, pupil, uv, options = {}) {
+  if (!Array.isArray(opticalSystemRows) || !pupil || !uv || !isOPDPointsWasmAvailable()) return null;
+  const module = getRayTracingWasmModule();
+  const O = RT10_OPD;
+  const count = Math.floor(uv.length / 2);
+  const wavelength = Number(options?.wavelength) > 0 ? Number(options.wavelength) : 0.5875618;
+  const n0 = Number.isFinite(options?.n0) ? options.n0 : 1.0;
+  const maxSurfaceIndex = (options?.maxSurfaceIndex !== null && options?.maxSurfaceIndex !== undefined)
+    ? Number(options.maxSurfaceIndex)
+    : null;
+
+  const packed = packOpticalSystemForWasm(opticalSystemRows, [wavelength], { maxSurfaceIndex, packedSystem: options?.packedSystem });
+  const S = packed.surfaceCount;
+  if (S < 2) return null;
+  const params = __opdParams(pupil, options);
+  if (!params) return null;
+
+  const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+  const paramsPtr = __scratchPtr(module, 'opdParams', O.PARAMS * 8);
+  const infoPtr = __scratchPtr(module, 'opdInfo', O.INFO_FIELDS * 8);
+  const uvPtr = __scratchPtr(module, 'opdUV', Math.max(1, count * 2) * 8);
+  const opdPtr = __scratchPtr(module, 'opdGrid', Math.max(1, count) * 8);
+  const maskPtr = __scratchPtr(module, 'opdMask', Math.max(1, count) * 4);
+  if (!surfPtr || !paramsPtr || !infoPtr || !uvPtr || !opdPtr || !maskPtr) return null;
+  module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+  module.HEAPF64.set(params, paramsPtr >> 3);
+  module.HEAPF64.set(uv.length === count * 2 ? uv : Array.prototype.slice.call(uv, 0, count * 2), uvPtr >> 3);
+
+  const rc = module._trace_opd_points_rt10(surfPtr, S, paramsPtr, uvPtr, count, 0, n0, opdPtr, maskPtr, infoPtr);
+  if (rc < 0) return null;
+
+  const f64 = module.HEAPF64;
+  const info = f64.slice(infoPtr >> 3, (infoPtr >> 3) + O.INFO_FIELDS);
+  return {
+    opd: f64.slice(opdPtr >> 3, (opdPtr >> 3) + count),
+    valid: module.HEAP32.slice(maskPtr >> 2, (maskPtr >> 2) + count),
+    count,
+    wavelength,
+    imagePoint: { x: info[O.INFO_IMAGE], y: info[O.INFO_IMAGE + 1], z: info[O.INFO_IMAGE + 2] },
+    referenceRadius: info[O.INFO_RADIUS],
+    imageIndex: info[O.INFO_N_IMAGE],
+    chiefOpticalPath: info[O.INFO_CHIEF_OPL],
+    validCount: rc
+  };
+}
+
+// trace_spot_rt10 のパラメータ / state / 統計 / 点のレイアウト（ray-tracing-wasm.c の RT10_SPOT_* と同期）
+export const RT10_SPOT = Object.freeze({
+  PATTERN: 0, RAY_COUNT: 1, RINGS: 2, HALF_EXTENT: 3, ORIGIN: 4, START_U: 7, START_V: 10, DIR: 13, AIM: 16,
+  TARGET: 17, TARGET_U: 20, TARGET_V: 23, CHUNK: 26, MAX_POINTS: 27, PARAMS: 28,
+  PATTERN_ANNULAR: 0, PATTERN_GRID: 1,
+  ACC_POINTS: 14, STATE: 15,
+  STAT_HITS: 0, STAT_RAYS: 1, STAT_CENTROID_X: 2, STAT_CENTROID_Y: 3, STAT_RMS_X: 4, STAT_RMS_Y: 5, STAT_RMS: 6,
+  STAT_CHIEF_X: 7, STAT_CHIEF_Y: 8, STAT_RMS_CHIEF: 9, STAT_GEO_CHIEF: 10, STAT_FAIL: 11, STAT_POINTS: 15, STATS: 16,
+  POINT_LOCAL: 0, POINT_GLOBAL: 3, POINT_RAY: 6, POINT_FIELDS: 7
+});
+
+/**
+ * @returns {boolean} スポット統計のストリーミング追跡（trace_spot_rt10）が使えるか
+ */
+export function isSpotStreamWasmAvailable() {
+  const module = getRayTracingWasmModule();
+  return isBatchTraceWasmAvailable() && typeof module._trace_spot_rt10 === 'function';
+}
+
+// traceSpotWasm / traceSpotWasmAsync の共通準備（面テーブル・パラメータ・明示光線）
+function __spotSetup(opticalSystemRows, sampling, options) {
+  if (!Array.isArray(opticalSystemRows) || !sampling || !isSpotStreamWasmAvailable()) return null;
+  const P = RT10_SPOT;
+  const target = Number(options?.targetSurfaceIndex);
+  if (!Number.isInteger(target) || target < 0) return null;
+  const wavelength = Number(options?.wavelength) > 0 ? Number(options.wavelength) : 0.5875618;
+  const n0 = Number.isFinite(options?.n0) ? options.n0 : 1.0;
+
+  const packed = packOpticalSystemForWasm(opticalSystemRows, [wavelength], { maxSurfaceIndex: target, packedSystem: options?.packedSystem });
+  const S = packed.surfaceCount;
+  if (S !== target + 1) return null;
+  const kind = packed.surfaces[target * RT10_LAYOUT.STRIDE + RT10_LAYOUT.KIND];
+  if (kind === RT10_KIND.COORD_BREAK || kind === RT10_KIND.OBJECT) return null;
+
+  const params = new Float64Array(P.PARAMS);
+  const put = (offset, v) => {
+    params[offset] = Number(v?.x) || 0; params[offset + 1] = Number(v?.y) || 0; params[offset + 2] = Number(v?.z) || 0;
+  };
+  let rays = null;
+  let indexMap = null;
+  let count;
+  if (Array.isArray(sampling.starts)) {
+    // generateRayStartPointsForSpot() の結果をそのまま追跡（startP/dir の無い要素は JS 版と同様に飛ばす）
+    const starts = sampling.starts;
+    rays = new Float64Array(starts.length * RAY_IN_STRIDE);
+    indexMap = new Int32Array(starts.length);
+    count = 0;
+    for (let i = 0; i < starts.length; i++) {
+      const p = starts[i]?.startP ?? starts[i]?.pos;
+      const d = starts[i]?.dir;
+      if (!p || !d) continue;
+      const o = count * RAY_IN_STRIDE;
+      rays[o] = p.x; rays[o + 1] = p.y; rays[o + 2] = p.z;
+      rays[o + 3] = d.x; rays[o + 4] = d.y; rays[o + 5] = d.z;
+      indexMap[count++] = i;
+    }
+  } else {
+    count = Math.floor(Number(sampling.rayCount) || 0);
+    params[P.PATTERN] = sampling.pattern === 'grid' ? P.PATTERN_GRID : P.PATTERN_ANNULAR;
+    params[P.RINGS] = Math.max(1, Math.floor(Number(sampling.ringCount) || 3));
+    params[P.HALF_EXTENT] = Number(sampling.halfExtent) || 0;
+    put(P.ORIGIN, sampling.origin);
+    put(P.START_U, sampling.uAxis);
+    put(P.START_V, sampling.vAxis);
+    put(P.DIR, sampling.direction);
+    if (sampling.aim && sampling.aim.center) {
+      params[P.AIM] = 1;
+      put(P.TARGET, sampling.aim.center);
+      put(P.TARGET_U, sampling.aim.uAxis);
+      put(P.TARGET_V, sampling.aim.vAxis);
+    }
+  }
+  if (!(count > 0)) return null;
+  const maxPoints = Math.max(0, Math.floor(Number(options?.maxPoints) || 0));
+  params[P.RAY_COUNT] = count;
+  params[P.CHUNK] = Math.floor(Number(options?.chunkSize) || 0);
+  params[P.MAX_POINTS] = maxPoints;
+
+  return {
+    module: getRayTracingWasmModule(),
+    packed, S, target, params, rays, indexMap, count, maxPoints, n0,
+    state: new Float64Array(P.STATE),
+    stats: new Float64Array(P.STATS),
+    points: maxPoints > 0 ? [] : null
+  };
+}
+
+// 光線 [begin, end) を追跡して state を進める（呼び出しごとに面テーブルを書き直すので、間に他の追跡が入ってもよい）
+function __spotStep(ctx, begin, end) {
+  const P = RT10_SPOT;
+  const module = ctx.module;
+  const surfPtr = __scratchPtr(module, 'surfaces', ctx.packed.surfaces.length * 8);
+  const paramsPtr = __scratchPtr(module, 'spotParams', P.PARAMS * 8);
+  const statePtr = __scratchPtr(module, 'spotState', P.STATE * 8);
+  const statsPtr = __scratchPtr(module, 'spotStats', P.STATS * 8);
+  const pointsPtr = ctx.maxPoints > 0 ? __scratchPtr(module, 'spotPoints', ctx.maxPoints * P.POINT_FIELDS * 8) : 0;
+  const raysPtr = ctx.rays ? __scratchPtr(module, 'spotRays', (end - begin) * RAY_IN_STRIDE * 8) : 0;
+  if (!surfPtr || !paramsPtr || !statePtr || !statsPtr || (ctx.maxPoints > 0 && !pointsPtr) || (ctx.rays && !raysPtr)) return -1;
+
+  module.HEAPF64.set(ctx.packed.surfaces, surfPtr >> 3);
+  module.HEAPF64.set(ctx.params, paramsPtr >> 3);
+  module.HEAPF64.set(ctx.state, statePtr >> 3);
+  if (ctx.rays) module.HEAPF64.set(ctx.rays.subarray(begin * RAY_IN_STRIDE, end * RAY_IN_STRIDE), raysPtr >> 3);
+
+  const pointsBefore = begin === 0 ? 0 : ctx.state[P.ACC_POINTS];
+  const rc = module._trace_spot_rt10(surfPtr, ctx.S, ctx.target, paramsPtr, raysPtr, begin, end, 0, ctx.n0,
+    statePtr, pointsPtr, statsPtr);
+  if (rc < 0) return rc;
+
+  const f64 = module.HEAPF64;
+  ctx.state.set(f64.subarray(statePtr >> 3, (statePtr >> 3) + P.STATE));
+  ctx.stats.set(f64.subarray(statsPtr >> 3, (statsPtr >> 3) + P.STATS));
+  if (ctx.points) {
+    if (begin === 0) ctx.points.length = 0;
+    const pointsAfter = ctx.state[P.ACC_POINTS];
+    for (let k = pointsBefore; k < pointsAfter; k++) {
+      const o = (pointsPtr >> 3) + k * P.POINT_FIELDS;
+      const ray = f64[o + P.POINT_RAY];
+      ctx.points.push({
+        x: f64[o + P.POINT_LOCAL], y: f64[o + P.POINT_LOCAL + 1], z: f64[o + P.POINT_LOCAL + 2],
+        globalX: f64[o + P.POINT_GLOBAL], globalY: f64[o + P.POINT_GLOBAL + 1], globalZ: f64[o + P.POINT_GLOBAL + 2],
+        rayIndex: ctx.indexMap ? ctx.indexMap[ray] : ray
+      });
+    }
+  }
+  return rc;
+}
+
+function __spotResult(ctx) {
+  const P = RT10_SPOT;
+  const s = ctx.stats;
+  const hits = s[P.STAT_HITS];
+  const chiefOk = Number.isFinite(s[P.STAT_CHIEF_X]);
+  return {
+    hits,
+    rays: s[P.STAT_RAYS],
+    centroid: hits > 0 ? { x: s[P.STAT_CENTROID_X], y: s[P.STAT_CENTROID_Y] } : null,
+    rmsX: s[P.STAT_RMS_X],
+    rmsY: s[P.STAT_RMS_Y],
+    rms: s[P.STAT_RMS],
+    chief: chiefOk ? { x: s[P.STAT_CHIEF_X], y: s[P.STAT_CHIEF_Y] } : null,
+    rmsChief: s[P.STAT_RMS_CHIEF],
+    geoChief: s[P.STAT_GEO_CHIEF],
+    failures: {
+      miss: s[P.STAT_FAIL], blocked: s[P.STAT_FAIL + 1], tir: s[P.STAT_FAIL + 2], invalid: s[P.STAT_FAIL + 3]
+    },
+    points: ctx.points
+  };
+}
+
+/**
+ * スポット図の光線を WASM 内で生成・追跡し、評価面での統計を on-line（Welford）で集計する。
+ * 全光線の交点配列は作らない。最適化には統計だけ、描画には maxPoints で間引いた点も返す。
+ *
+ * サンプリングは次のどちらか:
+ * - { starts }: generateRayStartPointsForSpot() の結果（JS 版スポット図と同じ光線, 光線 0 = 主光線）
+ * - { pattern, rayCount, ringCount, halfExtent, origin, uAxis, vAxis, direction, aim? }:
+ *   ray-renderer.js の輪帯 / 中心格子の規則で WASM 内で生成（始点 = origin + ou·uAxis + ov·vAxis）。
+ *   aim = { center, uAxis, vAxis } なら方向は絞り面上の対応点を狙う（点光源は uAxis = vAxis = 0 の始点で使う）。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Object} sampling 上記のサンプリング指定
+ * @param {Object} options
+ * @param {number} options.targetSurfaceIndex 評価面（Object / Coord Break は不可）
+ * @param {number} [options.wavelength=0.5875618] 波長（µm）
+ * @param {number} [options.n0=1.0]
+ * @param {number} [options.maxPoints=0] 返す点の最大数（0 = 統計のみ）。光線インデックスを等間隔に間引く
+ * @param {number} [options.chunkSize=1024] WASM 内で 1 回に追跡する光線数
+ * @returns {Object|null} { hits, rays, centroid, rmsX, rmsY, rms（重心基準）, chief, rmsChief, geoChief（主光線基準）,
+ *   failures, points }（長さはレンズ単位）。WASM 非対応・評価面が不正なら null
+ */
+export function traceSpotWasm(opticalSystemRows, sampling, options = {}) {
+  const ctx = __spotSetup(opticalSystemRows, sampling, options);
+  if (!ctx) return null;
+  return __spotStep(ctx, 0, ctx.count) < 0 ? null : __spotResult(ctx);
+}
+
+/**
+ * traceSpotWasm の非同期版。options.yieldEvery 本ごとに WASM を呼び、間で UI に制御を返す。
+ * options.onProgress({ done, total, result }) には途中までの統計が渡る（最終結果と同じ形）。
+ *
+ * @returns {Promise<Object|null>} traceSpotWasm と同じ
+ */
+export async function traceSpotWasmAsync(opticalSystemRows, sampling, options = {}) {
+  const ctx = __spotSetup(opticalSystemRows, sampling, options);
+  if (!ctx) return null;
+  const step = Math.max(1, Math.floor(Number(options?.yieldEvery) || 4096));
+  const onProgress = typeof options?.onProgress === 'function' ? options.onProgress : null;
+  for (let begin = 0; begin < ctx.count; begin += step) {
+    const end = Math.min(ctx.count, begin + step);
+    if (__spotStep(ctx, begin, end) < 0) return null;
+    if (end < ctx.count) {
+      try { onProgress?.({ done: end, total: ctx.count, result: __spotResult(ctx) }); } catch (_) {}
+      await new Promise((resolve) => setTimeout(resolve, 0));
+    }
+  }
+  return __spotResult(ctx);
+}
+
+/**
+ * 光線バッチを追跡し、面パラメータに対する最終位置・方向・光路長の解析微分を返す。
+ *
+ * LM の Jacobian を前進差分（パラメータ数 + 1 回の追跡）で組む代わりに使う。
+ * 入力光線は固定（光線エイミングのやり直しは含まない）。WASM が古い場合は null を返すので、
+ * 呼び出し側は差分にフォールバックすること。
+ *
+ * @param {Array<Object>} opticalSystemRows 光学系テーブル
+ * @param {Array<{pos:{x,y,z}, dir:{x,y,z}, wavelength?:number}>} rays 入力光線（グローバル座標）
+ * @param {Array<{surface:number, param:string}>} params 微分するパラメータ（param は RT10_DERIV_PARAM のキー）
+ * @param {Object} [options]
+ * @param {number} [options.n0=1.0] 入射側媒質の屈折率
+ * @param {number|null} [options.maxSurfaceIndex=null] 評価面（traceRay と同じ意味）
+ * @param {ArrayBuffer|ArrayBufferView} [options.packedSystem] packOpticalSystemBinary() の出力（packOpticalSystemForWasm 参照）
+ * @returns {{status: Int32Array, rays: Float64Array, derivatives: Float64Array, paramCount: number}|null}
+ *   rays: 光線ごとに [px, py, pz, dx, dy, dz, opl]、derivatives: 光線 × パラメータごとに同じ 7 成分の微分
+ *   （STATUS_OK 以外の光線は 0）
+ */
+export function traceRaysBatchDerivatives(opticalSystemRows, rays, params, options = {}) {
+  if (!Array.isArray(opticalSystemRows) || !Array.isArray(rays) || !Array.isArray(params)) return null;
+  if (!isTraceDerivativesWasmAvailable()) return null;
+  const module = getRayTracingWasmModule();
+  const maxParams = typeof module._rt10_deriv_max_params === 'function' ? module._rt10_deriv_max_params() : 64;
+  const P = params.length;
+  if (P === 0 || P > maxParams) return null;
+
+  const n0 = Number.isFinite(options?.n0) ? options.n0 : 1.0;
+  const maxSurfaceIndex = (options?.maxSurfaceIndex !== null && options?.maxSurfaceIndex !== undefined)
+    ? Number(options.maxSurfaceIndex)
+    : null;
+
+  const codes = new Int32Array(P * 2);
+  for (let j = 0; j < P; j++) {
+    const code = RT10_DERIV_PARAM[String(params[j]?.param ?? '').trim()];
+    const surface = Number(params[j]?.surface);
+    if (code === undefined || !Number.isInteger(surface) || surface < 0) return null;
+    codes[j * 2] = surface;
+    codes[j * 2 + 1] = code;
+  }
+
+  const N = rays.length;
+  const status = new Int32Array(N).fill(RT10_STATUS.INVALID);
+  const raysOut = new Float64Array(N * RAY_OUT_STRIDE);
+  const derivatives = new Float64Array(N * P * RAY_OUT_STRIDE);
+  if (N === 0) return { status, rays: raysOut, derivatives, paramCount: P };
+
+  const groups = new Map();
+  for (let i = 0; i < N; i++) {
+    const wl = __wavelengthOf(rays[i]);
+    let g = groups.get(wl);
+    if (!g) groups.set(wl, (g = []));
+    g.push(i);
+  }
+  const allWavelengths = Array.from(groups.keys());
+
+  for (let w0 = 0; w0 < allWavelengths.length; w0 += RT10_LAYOUT.MAX_WAVELENGTHS) {
+    const wls = allWavelengths.slice(w0, w0 + RT10_LAYOUT.MAX_WAVELENGTHS);
+    const packed = packOpticalSystemForWasm(opticalSystemRows, wls, { maxSurfaceIndex, packedSystem: options?.packedSystem });
+    const S = packed.surfaceCount;
+    for (let j = 0; j < P; j++) {
+      if (codes[j * 2] >= S) return null;
+    }
+
+    const maxGroup = Math.max(...wls.map((wl) => groups.get(wl).length));
+    const surfPtr = __scratchPtr(module, 'surfaces', packed.surfaces.length * 8);
+    const inPtr = __scratchPtr(module, 'raysIn', maxGroup * RAY_IN_STRIDE * 8);
+    const outPtr = __scratchPtr(module, 'raysOut', maxGroup * RAY_OUT_STRIDE * 8);
+    const statusPtr = __scratchPtr(module, 'status', maxGroup * 4);
+    const paramsPtr = __scratchPtr(module, 'derivParams', P * 2 * 4);
+    const derivPtr = __scratchPtr(module, 'derivs', maxGroup * P * RAY_OUT_STRIDE * 8);
+    if (!surfPtr || !inPtr || !outPtr || !statusPtr || !paramsPtr || !derivPtr) return null;
+    module.HEAPF64.set(packed.surfaces, surfPtr >> 3);
+    module.HEAP32.set(codes, paramsPtr >> 2);
+
+    for (let slot = 0; slot < wls.length; slot++) {
+      const idx = groups.get(wls[slot]);
+      const count = idx.length;
+      const inBase = inPtr >> 3;
+      let heap = module.HEAPF64;
+      for (let k = 0; k < count; k++) {
+        const r = rays[idx[k]];
+        const b = inBase + k * RAY_IN_STRIDE;
+        heap[b] = Number(r.pos.x); heap[b + 1] = Number(r.pos.y); heap[b + 2] = Number(r.pos.z);
+        heap[b + 3] = Number(r.dir.x); heap[b + 4] = Number(r.dir.y); heap[b + 5] = Number(r.dir.z);
+      }
+
+      const rc = module._trace_system_rt10_derivs(surfPtr, S, inPtr, count, slot, n0,
+        (maxSurfaceIndex === null) ? -1 : maxSurfaceIndex, 0,
+        paramsPtr, P, outPtr, statusPtr, 0, derivPtr);
+      if (rc < 0) return null;
+
+      heap = module.HEAPF64;
+      const i32 = module.HEAP32;
+      const outBase = outPtr >> 3;
+      const dBase = derivPtr >> 3;
+      const per = P * RAY_OUT_STRIDE;
+      for (let k = 0; k < count; k++) {
+        const ri = idx[k];
+        status[ri] = i32[(statusPtr >> 2) + k];
+        raysOut.set(heap.subarray(outBase + k * RAY_OUT_STRIDE, outBase + (k + 1) * RAY_OUT_STRIDE), ri * RAY_OUT_STRIDE);
+        derivatives.set(heap.subarray(dBase + k * per, dBase + (k + 1) * per), ri * per);
+      }
+    }
+  }
+
+  return { status, rays: raysOut, derivatives, paramCount: P };
+}
@@ -1311,9 +1311,25 @@ export function traceParaxialRayFromStopInternal(opticalSystemRows, stopIndex, w
 }
 
 /**
- * 屈折率を取得
+ * 公差解析などで面に付ける屈折率のずれ Δn（__cooptIndexDelta, 全波長に一律に加える）
+ * @param {Object} surface - 面データ
+ * @returns {number}
+ */
+export function getIndexDelta(surface) {
+  const v = surface ? Number(surface.__cooptIndexDelta) : 0;
+  return Number.isFinite(v) ? v : 0;
+}
+
+/**
+ * 屈折率を取得（__cooptIndexDelta があれば加える）
  */
 export function getRefractiveIndex(surface, wavelength = 0.5875618) {
+  const n = __getNominalRefractiveIndex(surface, wavelength);
+  const dn = getIndexDelta(surface);
+  return dn !== 0 ? n + dn : n;
+}
+
+function __getNominalRefractiveIndex(surface, wavelength) {
   if (!surface) return 1.0;
   
   // ガラスカタログから屈折率を取得（Materialが設定されている場合を優先）
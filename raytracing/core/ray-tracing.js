@@ -14,7 +14,7 @@ const getRefractiveIndex = rayParaxial.getRefractiveIndex;
 
 // --- WASM fast-path cache (avoid per-call getWASMSystem() overhead) ---
 let __wasmSystemCached = null;
-let __wasmSystemLastCheckAt = 0;
+let __wasmSystemLastCheckAt = -Infinity; // first lookup is never throttled (e.g. a worker that set getWASMSystem before its first trace)
 const __WASM_SYSTEM_RECHECK_MS = 1000;
 
 let __wasmSagRt10Fn = null;
@@ -86,6 +86,11 @@ function __getWasmModuleCached() {
   return __getWasmSystemCached()?.wasmModule ?? null;
 }
 
+// ray-batch-trace.js などの一括追跡フロントエンド向け（同じキャッシュを共有）
+export function getRayTracingWasmModule() {
+  return __getWasmModuleCached();
+}
+
 function __getWasmSagRt10Fn() {
   if (__wasmSagRt10Fn) return __wasmSagRt10Fn;
   try {
@@ -1090,6 +1095,10 @@ function __rtIsCoordTransRow(row) {
   return fields.some(isCb);
 }
 
+export function isCoordTransRow(row) {
+  return __rtIsCoordTransRow(row);
+}
+
 // --- 座標変換1.5.md仕様: 各面の原点O(s)と回転行列R(s)の算出 ---
 export function calculateSurfaceOrigins(opticalSystemRows) {
   const surfaceData = [];
@@ -1370,7 +1379,7 @@ function parseCoordTransParams(surface, previousSurface = null) {
  * @param {number} wavelength - 波長 (μm)
  * @returns {number} 屈折率
  */
-function getCorrectRefractiveIndex(surface, wavelength = 0.5875618) {
+export function getCorrectRefractiveIndex(surface, wavelength = 0.5875618) {
   if (RT_PROF.enabled) {
     RT_PROF.stats.refractiveIndexCalls++;
     var __t0 = now();
@@ -1394,7 +1403,7 @@ function __getCorrectRefractiveIndex_impl(surface, wavelength = 0.5875618) {
       const wlKey = Math.round(Number(wavelength) * 1e9) | 0;
       const matKey = String(surface.material ?? '');
       const manualKey = String(surface.rindex ?? surface['Ref Index'] ?? surface.refIndex ?? surface['ref index'] ?? '');
-      const key = `${wlKey}|${matKey}|${manualKey}`;
+      const key = `${wlKey}|${matKey}|${manualKey}|${surface.__cooptIndexDelta ?? ''}`;
       if (cache.has(key)) return cache.get(key);
 
       // Compute using the original logic, then store.
@@ -1517,6 +1526,11 @@ function __computeSurfaceOriginsSignature(opticalSystemRows) {
   return h | 0;
 }
 
+// 面原点キャッシュと同じ内容シグネチャ（first-order-cache.js が近軸量のキーに使う）
+export function computeSurfaceOriginsSignature(opticalSystemRows) {
+  return __computeSurfaceOriginsSignature(opticalSystemRows);
+}
+
 function __getCachedSurfaceData(opticalSystemRows, maxSurfaceIndex, effectiveSystemRows) {
   try {
     const cacheKey = (maxSurfaceIndex !== null && maxSurfaceIndex !== undefined) ? Number(maxSurfaceIndex) : -1;
@@ -3,6 +3,7 @@ set -euo pipefail
 
 # Ray Tracing WebAssembly Build Script
 # ray-tracing-wasm.c -> ray-tracing-wasm-v3.js / ray-tracing-wasm-v3.wasm
+#                      (+ ray-tracing-wasm-v3-mt.js / .wasm, pthreads build)
 
 ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
 cd "$ROOT_DIR"
@@ -20,6 +21,7 @@ echo "✅ [WASM] emcc found: $(emcc --version | head -n1)"
 
 SRC="wasm/raytracing/ray-tracing-wasm.c"
 OUT_JS="wasm/raytracing/ray-tracing-wasm-v3.js"
+OUT_MT_JS="wasm/raytracing/ray-tracing-wasm-v3-mt.js"
 
 if [ ! -f "$SRC" ]; then
   echo "❌ [Error] Missing source: $SRC"
@@ -33,18 +35,63 @@ mkdir -p "$(dirname "$OUT_JS")"
 # Notes:
 # - MODULARIZE + EXPORT_NAME=RayTracingWASM matches existing loader expectations
 # - We explicitly export the new entrypoint _aspheric_sag_rt10 (ray-tracing.js coefficient convention)
+# - _trace_system_rt10 traces a whole ray batch through a packed surface table (raytracing/core/ray-batch-trace.js);
+#   HEAPF64/HEAP32 are exported so the JS side can fill/read the batch buffers in place
+# - _trace_system_rt10_derivs is the same trace plus forward-mode derivatives w.r.t. selected surface parameters
+# - _trace_system_rt10_resume records per-surface ray states and re-traces from the first changed surface
+# - -msimd128 enables the f64x2 SoA bundle kernels (trace_bundle_rt10 etc.); without it they fall back to
+#   the 2-lane scalar emulation in the same source
+# - _trace_bundle_rt10_f32 is the float32 preview variant (f32x4 lanes, float bundle via HEAPF32) used while
+#   dragging/editing; the JS side re-runs the f64 trace once interaction stops
+# - _rt10_get_stats / _rt10_reset_stats / _rt10_stats_enable expose per-entry timing and Newton counters
+#   (read by performance/performance-monitor.js; per-ray counters are off unless enabled)
+# - _rt10_glass_load / _rt10_resolve_indices keep a Sellmeier table in the module and fill the surface table's
+#   per-wavelength index slots natively (RT10_SURF_GLASS = glass ID + 1)
+# - _trace_opd_grid_rt10 traces an entrance-pupil grid and closes the OPL on the reference sphere, returning
+#   grid_opd / pupil_mask in the layout calculate_psf_grid_wasm (psf-wasm.c) consumes;
+#   _trace_opd_points_rt10 does the same for an explicit (u, v) list (adaptive pupil sampling)
+# - _trace_spot_rt10 generates spot-diagram pupil samples natively, traces them in fixed-size chunks and keeps
+#   Welford centroid / RMS / chief-referenced GEO accumulators (optionally a decimated point set for plotting)
 # - ALLOW_MEMORY_GROWTH avoids OOM for larger workloads
+EXPORTED_FUNCTIONS="['_aspheric_sag','_aspheric_sag10','_aspheric_sag_rt10','_intersect_aspheric_rt10','_batch_aspheric_sag','_batch_aspheric_sag10','_vector_dot','_vector_cross','_vector_normalize','_ray_sphere_intersect','_batch_vector_normalize','_trace_system_rt10','_trace_system_rt10_derivs','_rt10_deriv_max_params','_trace_system_rt10_resume','_rt10_state_stride','_rt10_surface_stride','_rt10_max_wavelengths','_rt10_bundle_fields','_bundle_init_rt10','_bundle_sphere_intersect','_bundle_intersect_aspheric_rt10','_bundle_surface_normal_rt10','_bundle_refract','_trace_bundle_rt10','_bundle_init_rt10_f32','_trace_bundle_rt10_f32','_rt10_f32_lanes','_rt10_get_stats','_rt10_reset_stats','_rt10_stats_enable','_rt10_set_thread_count','_rt10_get_thread_count','_rt10_glass_stride','_rt10_glass_load','_rt10_glass_loaded_count','_rt10_glass_index','_rt10_resolve_indices','_trace_opd_grid_rt10','_trace_opd_points_rt10','_rt10_opd_params','_rt10_opd_info_fields','_trace_spot_rt10','_rt10_spot_params','_rt10_spot_state_fields','_rt10_spot_stats_fields','_rt10_spot_point_fields','_malloc','_free']"
+
 emcc "$SRC" \
   -O3 \
+  -msimd128 \
   -o "$OUT_JS" \
   -s MODULARIZE=1 \
   -s EXPORT_NAME='RayTracingWASM' \
   -s ALLOW_MEMORY_GROWTH=1 \
-  -s EXPORTED_FUNCTIONS="['_aspheric_sag','_aspheric_sag10','_aspheric_sag_rt10','_intersect_aspheric_rt10','_batch_aspheric_sag','_batch_aspheric_sag10','_vector_dot','_vector_cross','_vector_normalize','_ray_sphere_intersect','_batch_vector_normalize','_malloc','_free']" \
-  -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap']"
+  -s EXPORTED_FUNCTIONS="$EXPORTED_FUNCTIONS" \
+  -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap','HEAPF64','HEAPF32','HEAP32']"
+
+# Multi-threaded variant (WASM pthreads + SharedArrayBuffer):
+# - force-wasm-system.js loads it only when the page is cross-origin isolated
+#   (COOP: same-origin / COEP: require-corp); otherwise the single-threaded build above is used
+# - trace_system_rt10 / trace_bundle_rt10 split ray chunks over a fixed worker pool (wasm/wasm-thread-pool.h)
+# - workers are pre-spawned (PTHREAD_POOL_SIZE) because pthread_create from the main thread
+#   does not start a worker until the event loop runs
+# - set RT_WASM_SKIP_MT=1 to build only the single-threaded module
+if [ "${RT_WASM_SKIP_MT:-0}" != "1" ]; then
+  echo "🔄 [WASM] Compiling $SRC -> $OUT_MT_JS (pthreads)"
+  emcc "$SRC" \
+    -O3 \
+    -msimd128 \
+    -pthread \
+    -o "$OUT_MT_JS" \
+    -s MODULARIZE=1 \
+    -s EXPORT_NAME='RayTracingWASMMT' \
+    -s ALLOW_MEMORY_GROWTH=1 \
+    -s PTHREAD_POOL_SIZE='Math.min(navigator.hardwareConcurrency||4,15)' \
+    -s EXPORTED_FUNCTIONS="$EXPORTED_FUNCTIONS" \
+    -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap','HEAPF64','HEAPF32','HEAP32']"
+fi
 
 echo "✅ [WASM] Build complete"
 
+# Record which optional builds (-mt) now exist so the loader does not fetch missing ones
+bash "$ROOT_DIR/scripts/write-wasm-build-manifest.sh"
+
 if [ -f "wasm/raytracing/ray-tracing-wasm-v3.wasm" ]; then
   echo "✅ [WASM] Output: wasm/raytracing/ray-tracing-wasm-v3.js + wasm/raytracing/ray-tracing-wasm-v3.wasm"
   ls -la wasm/raytracing/ray-tracing-wasm-v3.js wasm/raytracing/ray-tracing-wasm-v3.wasm
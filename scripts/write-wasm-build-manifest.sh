@@ -0,0 +1,28 @@
+#!/bin/bash
+set -euo pipefail
+
+# Writes wasm/wasm-build-manifest.js: which optional WASM artefacts are installed next to the
+# single-threaded modules. psf-wasm-wrapper.js / force-wasm-system.js only fetch the pthreads
+# builds listed as true, so pages without them never request a missing -mt.js.
+# Run by scripts/build-ray-tracing-wasm.sh and `make install` (wasm/).
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+cd "$ROOT_DIR"
+
+has() {
+  if [ -f "$1.js" ] && [ -f "$1.wasm" ]; then echo true; else echo false; fi
+}
+
+PSF_MT="$(has wasm/psf/psf-wasm-mt)"
+RT_MT="$(has wasm/raytracing/ray-tracing-wasm-v3-mt)"
+
+cat > wasm/wasm-build-manifest.js <<JS
+// Generated by scripts/write-wasm-build-manifest.sh (do not edit).
+// Optional WASM artefacts installed with this build; loaders skip the ones marked false.
+globalThis.__COOPT_WASM_BUILD_MANIFEST = Object.freeze({
+  psfThreads: ${PSF_MT}, // wasm/psf/psf-wasm-mt.js
+  rayTracingThreads: ${RT_MT} // wasm/raytracing/ray-tracing-wasm-v3-mt.js
+});
+JS
+
+echo "📝 [WASM] wasm/wasm-build-manifest.js: psfThreads=${PSF_MT}, rayTracingThreads=${RT_MT}"
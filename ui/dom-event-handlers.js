@@ -4,7 +4,7 @@
  */
 
 import { getOpticalSystemRows, getObjectRows, getSourceRows, outputParaxialDataToDebug, displayCoordinateTransformMatrix } from '../utils/data-utils.js';
-import { showSpotDiagram, showTransverseAberrationDiagram, showLongitudinalAberrationDiagram, showAstigmatismDiagram, createFieldSettingFromObject } from '../analysis/optical-analysis.js';
+import { showSpotDiagram, showTransverseAberrationDiagram, showLongitudinalAberrationDiagram, showAstigmatismDiagram, createFieldSettingFromObject, previewSpotDiagram } from '../analysis/optical-analysis.js';
 import { updateSurfaceNumberSelect } from './ui-updates.js';
 import { generateSurfaceOptions } from '../evaluation/spot-diagram.js';
 import { saveTableData as saveSourceTableData } from '../data/table-source.js';
@@ -20,8 +20,11 @@ import { traceRay, traceRayHitPoint } from '../raytracing/core/ray-tracing.js';
 import { findInfiniteSystemChiefRayOrigin, findApertureBoundaryRays } from '../raytracing/generation/gen-ray-cross-infinite.js';
 import { generateZMXText, downloadZMX } from '../import-export/zemax-export.js';
 import { parseZMXArrayBufferToOpticalSystemRows } from '../import-export/zemax-import.js';
-import { buildShareUrlFromCompressedString, decodeAllDataFromCompressedString, encodeAllDataToCompressedString, getCompressedStringFromLocationHash, getCompressedStringFromLocation } from '../utils/url-share.js';
+import { buildShareUrlFromCompressedString, buildShareUrlFromPackedString, decodeAllDataFromCompressedString, decodeAllDataFromPackedString, encodeAllDataToCompressedString, encodeAllDataToPackedString, getCompressedStringFromLocationHash, getCompressedStringFromLocation, getPackedStringFromLocation, isPackedShareSupported } from '../utils/url-share.js';
 import { listDesignVariablesFromBlocks } from '../optimization/design-variables.js';
+import { createPreviewRefineTracer } from '../raytracing/core/ray-batch-trace.js';
+import { sampleOPDRayDataAdaptive } from '../evaluation/adaptive-pupil-sampling.js';
+import { getDrawnRayStarts, clearDrawnRays, drawRayWithSegmentColors } from '../optical/ray-renderer.js';
 
 /**
  * ============================================================================
@@ -255,9 +258,11 @@ function valueToSlider(value, min, max, useLog) {
  * @param {string} blockType - Block type
  * @param {string|number} currentValue - Current parameter value
  * @param {Function} commitCallback - Callback(newValue) to commit changes
+ * @param {Function|null} [previewCallback] - Callback(value, dragEnd) while the slider is dragged
+ *   (dragEnd=true right before commitCallback on release)
  * @returns {HTMLElement} Container element with input, slider, and controls
  */
-function createParameterSlider(key, blockType, currentValue, commitCallback) {
+function createParameterSlider(key, blockType, currentValue, commitCallback, previewCallback = null) {
     const container = document.createElement('div');
     container.className = 'param-input-with-slider';
     // Use a fixed-column grid to keep slider start aligned across rows
@@ -445,6 +450,7 @@ function createParameterSlider(key, blockType, currentValue, commitCallback) {
         const paramVal = sliderToValue(sliderVal, min, max, useLog);
         const precision = getDisplayPrecision(paramVal, max - min);
         textInput.value = paramVal.toFixed(precision);
+        if (previewCallback) previewCallback(textInput.value, false);
     });
     
     // Handle slider change (drag end - commit value)
@@ -455,6 +461,7 @@ function createParameterSlider(key, blockType, currentValue, commitCallback) {
         const precision = getDisplayPrecision(paramVal, max - min);
         const newValue = paramVal.toFixed(precision);
         textInput.value = newValue;
+        if (previewCallback) previewCallback(newValue, true);
         commitCallback(newValue);
     });
     
@@ -1489,20 +1496,22 @@ function setupShareUrlButton() {
     shareBtn.addEventListener('click', async () => {
         if (document.activeElement) document.activeElement.blur();
 
-        let compressed;
-        try {
-            const allData = buildAllDataForExport();
-            compressed = encodeAllDataToCompressedString(allData);
-        } catch (e) {
-            console.warn('❌ [Share] Failed to encode:', e);
-            alert(e?.message || 'Failed to generate share URL');
-            return;
-        }
-
         const base = `${location.origin}${location.pathname}`;
         let url;
         try {
-            url = buildShareUrlFromCompressedString(compressed, base);
+            const allData = buildAllDataForExport();
+            // パック形式（packed_data）を優先し、使えなければ従来の LZString（compressed_data）
+            let packed = null;
+            if (isPackedShareSupported()) {
+                try {
+                    packed = await encodeAllDataToPackedString(allData);
+                } catch (e) {
+                    console.warn('⚠️ [Share] Packed encoding failed, using LZString:', e);
+                }
+            }
+            url = packed
+                ? buildShareUrlFromPackedString(packed, base)
+                : buildShareUrlFromCompressedString(encodeAllDataToCompressedString(allData), base);
         } catch (e) {
             console.warn('❌ [Share] Failed to build URL:', e);
             alert(e?.message || 'Failed to generate share URL');
@@ -2106,8 +2115,9 @@ async function __loadAllDataObjectIntoApp(allData, { filename }) {
 }
 
 export async function loadFromCompressedDataHashIfPresent() {
-    const compressed = getCompressedStringFromLocation();
-    if (!compressed) return { ok: false, reason: 'no_hash' };
+    const packed = getPackedStringFromLocation();
+    const compressed = packed ? '' : getCompressedStringFromLocation();
+    if (!packed && !compressed) return { ok: false, reason: 'no_hash' };
 
     const confirmed = confirm(
         'リンクから設計を読み込みます。現在の設計は上書きされます。続行しますか？\n\n' +
@@ -2117,7 +2127,9 @@ export async function loadFromCompressedDataHashIfPresent() {
 
     let allData;
     try {
-        allData = decodeAllDataFromCompressedString(compressed);
+        allData = packed
+            ? await decodeAllDataFromPackedString(packed)
+            : decodeAllDataFromCompressedString(compressed);
     } catch (e) {
         console.warn('❌ [URL Load] Decode failed:', e);
         alert(e?.message || 'Failed to load design from URL');
@@ -4978,6 +4990,9 @@ function setupDebugPSFCalculationButton() {
     }
 }
 
+// 適応瞳サンプリング時の波面マップ（基準光線・piston/tilt 用）の格子
+const PSF_ADAPTIVE_WAVEFRONT_GRID = 32;
+
 /**
  * PSF計算処理の共通関数
  * @param {boolean} debugMode - デバッグモードかどうか
@@ -5014,6 +5029,7 @@ async function handlePSFCalculation(debugMode = false) {
     const samplingSelect = document.getElementById('psf-sampling-select'); // PSF UIのサンプリングサイズ
     const zeroPadSelect = document.getElementById('psf-zeropad-select'); // PSF UIのゼロパディング設定
     const zernikeSamplingSelect = document.getElementById('psf-zernike-sampling-select'); // Zernikeフィット用サンプリングサイズ
+    const pupilSamplingSelect = document.getElementById('psf-pupil-sampling-select'); // 瞳サンプリング（grid / adaptive）
     
     // デバッグモードの場合は設定を上書き
     let wavelength, psfSamplingSize, zernikeFitSamplingSize, zeroPadTo;
@@ -5055,7 +5071,10 @@ async function handlePSFCalculation(debugMode = false) {
         console.log(`📊 [NORMAL] 通常モード: wavelength=${wavelength}μm (source), psfSampling=${psfSamplingSize}×${psfSamplingSize}, fitGrid=${zernikeFitSamplingSize}×${zernikeFitSamplingSize}`);
     }
     
-    console.log(`🔬 PSFパラメータ: wavelength=${wavelength}, psfSampling=${psfSamplingSize}, fitGrid=${zernikeFitSamplingSize}, debugMode=${debugMode}`);
+    // 適応瞳サンプリング（デバッグモードは固定格子のまま）
+    const useAdaptivePupil = !debugMode && String(pupilSamplingSelect?.value || 'grid') === 'adaptive';
+
+    console.log(`🔬 PSFパラメータ: wavelength=${wavelength}, psfSampling=${psfSamplingSize}, fitGrid=${zernikeFitSamplingSize}, pupilSampling=${useAdaptivePupil ? 'adaptive' : 'grid'}, debugMode=${debugMode}`);
     
     const getActiveConfigLabel = () => {
         try {
@@ -5204,22 +5223,50 @@ async function handlePSFCalculation(debugMode = false) {
             // NOTE: Infinite-field pupil sampling mode is controlled by the global Force setting
             // (Auto / Force stop / Force entrance) via eva-wavefront.js.
             
-            const wavefrontMap = await analyzer.generateWavefrontMap(fieldSetting, zernikeFitSamplingSize, 'circular', {
-                recordRays: true,  // 光線データを記録
-                progressEvery: 0,
-                zernikeMaxNoll: 36,
-                renderFromZernike: false,  // 生OPDデータを使用
-                // Use raw OPD with geometric tilt, let PSF calculator remove it
-                cancelToken
-            });
+            const generatePSFWavefrontMap = async (gridSize) => {
+                const map = await analyzer.generateWavefrontMap(fieldSetting, gridSize, 'circular', {
+                    recordRays: true,  // 光線データを記録
+                    progressEvery: 0,
+                    zernikeMaxNoll: 36,
+                    renderFromZernike: false,  // 生OPDデータを使用
+                    // Use raw OPD with geometric tilt, let PSF calculator remove it
+                    cancelToken
+                });
 
-            throwIfCancelled(cancelToken);
+                throwIfCancelled(cancelToken);
 
-            if (wavefrontMap?.error) {
-                const err = new Error(wavefrontMap.error?.message || 'Wavefront generation failed');
-                err.code = 'WAVEFRONT_UNAVAILABLE';
-                err.wavefrontError = wavefrontMap.error;
-                throw err;
+                if (map?.error) {
+                    const err = new Error(map.error?.message || 'Wavefront generation failed');
+                    err.code = 'WAVEFRONT_UNAVAILABLE';
+                    err.wavefrontError = map.error;
+                    throw err;
+                }
+                return map;
+            };
+
+            // 適応瞳サンプリングでは、波面マップは基準光線と piston/tilt の Zernike 係数にしか使わないので粗い格子で作る
+            const wavefrontGridSize = useAdaptivePupil
+                ? Math.min(zernikeFitSamplingSize, PSF_ADAPTIVE_WAVEFRONT_GRID)
+                : zernikeFitSamplingSize;
+            let wavefrontMap = await generatePSFWavefrontMap(wavefrontGridSize);
+
+            // 適応瞳サンプリング: OPD grid と同じ光線数までで、OPD の曲がりとケラレの縁だけを細かく追跡する。
+            // 有効点が少なすぎる・失敗したときは OPD grid の固定格子に戻す。
+            let adaptiveSampled = null;
+            if (useAdaptivePupil) {
+                try {
+                    adaptiveSampled = await sampleOPDRayDataAdaptive(opdCalculator, fieldSetting, {
+                        gridSize: zernikeFitSamplingSize,
+                        tolerance: wl * 0.01, // λ/100 (µm)
+                        beforeRound: () => throwIfCancelled(cancelToken)
+                    });
+                } catch (e) {
+                    if (e?.code === 'CANCELLED') throw e;
+                    console.warn('⚠️ [PSF] Adaptive pupil sampling failed, using the OPD grid:', e);
+                }
+                if (!adaptiveSampled && wavefrontGridSize !== zernikeFitSamplingSize) {
+                    wavefrontMap = await generatePSFWavefrontMap(zernikeFitSamplingSize);
+                }
             }
 
             // PSF入力点は、ray path 依存の wavefrontMap.rayData ではなく、
@@ -5257,8 +5304,10 @@ async function handlePSFCalculation(debugMode = false) {
                 return rays;
             };
 
-            let rayData = buildRayDataFromWavefront();
-            let rayDataSource = 'pupilCoordinates/opds';
+            let rayData = adaptiveSampled ? adaptiveSampled.rayData : buildRayDataFromWavefront();
+            let rayDataSource = adaptiveSampled
+                ? `adaptive(rays=${adaptiveSampled.sampling.rayCount}, equivalentGrid=${adaptiveSampled.sampling.equivalentGridSize})`
+                : 'pupilCoordinates/opds';
             if (!Array.isArray(rayData) || rayData.length === 0) {
                 // Fallback: use recorded rayData when legacy maps are missing coordinate arrays.
                 const rawRays = wavefrontMap?.rayData || [];
@@ -5366,6 +5415,8 @@ async function handlePSFCalculation(debugMode = false) {
                 focalLength: (Number.isFinite(focalLengthMm) && focalLengthMm > 0) ? focalLengthMm : 100.0,
                 zeroPadTo: (typeof zeroPadTo !== 'undefined') ? zeroPadTo : 0,
                 forceImplementation: performanceMode === 'auto' ? null : performanceMode,
+                // 適応サンプリングの散布点は点間を線形補間する（WASM の interpolate_opd_grid）
+                ...(adaptiveSampled ? { opdInterpolation: 'barycentric' } : {}),
                 // If piston+tilt were already removed via Zernike fit, avoid removing again in PSF.
                 removeTilt: !removePistonTiltByZernikeFit
             }), cancelToken);
@@ -7433,6 +7484,71 @@ async function showMTFDiagram({ wavelengthMicrons, objectIndex, maxFrequencyLpmm
             ? (wlLocal * focalLengthMm / pupilDiameterMm)
             : 1.0;
 
+        // MTF vs spatial frequency (lp/mm): bin k of an N-point OTF is k / (N · pixelSize).
+        const frequencyAxisFor = (N) => {
+            const dfCyclesPerMicron = 1.0 / (N * pixelSizeMicronsForMTF);
+            const dfLpmm = dfCyclesPerMicron * 1000.0;
+            const nyquistLpmm = 0.5 / pixelSizeMicronsForMTF * 1000.0;
+            const maxPlotLpmm = (maxLpmm > 0) ? Math.min(maxLpmm, nyquistLpmm) : nyquistLpmm;
+            maxPlotLpmmGlobal = Math.max(maxPlotLpmmGlobal, maxPlotLpmm);
+            const maxBin = Math.floor(N / 2);
+            const kMax = Math.max(0, Math.min(maxBin, Math.floor(maxPlotLpmm / (dfLpmm || 1e-9))));
+            return { dfLpmm, kMax };
+        };
+
+        const pushTraces = (tan, sag) => {
+            const color = getColorForWavelength(wlLocal);
+            traces.push({
+                x: tan.freq,
+                y: tan.mtfVals,
+                type: 'scatter',
+                mode: 'lines',
+                name: `M (${titleNmLocal}nm)`,
+                showlegend: true,
+                line: { color, width: 2, dash: 'solid' }
+            });
+            traces.push({
+                x: sag.freq,
+                y: sag.mtfVals,
+                type: 'scatter',
+                mode: 'lines',
+                name: `S (${titleNmLocal}nm)`,
+                showlegend: true,
+                line: { color, width: 2, dash: 'dot' }
+            });
+        };
+
+        // WASM build with calculate_mtf_batch_wasm: pupil -> PSF -> OTF slices in one native call
+        // (same definition as the SimpleFFT path below; falls back to it on older builds or errors).
+        // wasmCalculator は非同期初期化なので、未完了のまま判定すると初回MTFが常に SimpleFFT へ落ちる。
+        const wasmCalculator = (typeof psfCalculator?.ensureWasmCalculator === 'function')
+            ? await psfCalculator.ensureWasmCalculator()
+            : psfCalculator?.wasmCalculator;
+        if (wasmCalculator?.isMTFAvailable?.()) {
+            try {
+                reportProgress(localBase + localSpan * 0.75, `λ=${titleNmLocal} nm: Computing MTF (WASM)...`);
+                const { dfLpmm, kMax } = frequencyAxisFor(s);
+                const frequencies = Array.from({ length: kMax + 1 }, (_, k) => k);
+                const axisAngle = (axis) => (axis === 'x' ? 0 : Math.PI / 2);
+                const res = await wasmCalculator.calculateMTFWasm([opdData.gridData], {
+                    wavelength: wlLocal,
+                    frequencies,
+                    angles: [axisAngle(tanAxis), axisAngle(sagAxis)],
+                    // OPD grid is already piston+tilt removed by opdDisplayMode.
+                    removeTilt: false
+                });
+                const toCurve = (vals) => {
+                    const mtfVals = Array.from(vals, (v) => (Number.isFinite(v) ? v : null));
+                    if (mtfVals.length > 0) mtfVals[0] = 1.0;
+                    return { freq: frequencies.map((k) => k * dfLpmm), mtfVals };
+                };
+                pushTraces(toCurve(res.mtf[0][0][0]), toCurve(res.mtf[0][0][1]));
+                return;
+            } catch (error) {
+                console.warn('⚠️ [MTF] WASM MTF failed, falling back to SimpleFFT:', error);
+            }
+        }
+
         reportProgress(localBase + localSpan * 0.75, `λ=${titleNmLocal} nm: Calculating PSF...`);
         const psfResult = await psfCalculator.calculatePSF(opdData, {
             samplingSize: s,
@@ -7447,7 +7563,6 @@ async function showMTFDiagram({ wavelengthMicrons, objectIndex, maxFrequencyLpmm
         reportProgress(localBase + localSpan * 0.85, `λ=${titleNmLocal} nm: Computing OTF/MTF...`);
 
         const psf2D = psfResult?.psfData || psfResult?.psf || psfResult?.intensity || null;
-        const pixelSizeMicrons = safeNumber(pixelSizeMicronsForMTF, safeNumber(psfResult?.options?.pixelSize, 1.0));
         if (!psf2D || !Array.isArray(psf2D) || !Array.isArray(psf2D[0])) {
             throw new Error('PSF data missing for MTF');
         }
@@ -7466,14 +7581,7 @@ async function showMTFDiagram({ wavelengthMicrons, objectIndex, maxFrequencyLpmm
             throw new Error('Invalid OTF DC component');
         }
 
-        const dfCyclesPerMicron = 1.0 / (N * pixelSizeMicrons);
-        const dfLpmm = dfCyclesPerMicron * 1000.0;
-        const nyquistLpmm = 0.5 / pixelSizeMicrons * 1000.0;
-        const maxPlotLpmm = (maxLpmm > 0) ? Math.min(maxLpmm, nyquistLpmm) : nyquistLpmm;
-        maxPlotLpmmGlobal = Math.max(maxPlotLpmmGlobal, maxPlotLpmm);
-
-        const maxBin = Math.floor(N / 2);
-        const kMax = Math.max(0, Math.min(maxBin, Math.floor(maxPlotLpmm / (dfLpmm || 1e-9))));
+        const { dfLpmm, kMax } = frequencyAxisFor(N);
 
         const sample1DAxis = (axis) => {
             const freq = [];
@@ -7497,28 +7605,7 @@ async function showMTFDiagram({ wavelengthMicrons, objectIndex, maxFrequencyLpmm
             return { freq, mtfVals };
         };
 
-        const tan = sample1DAxis(tanAxis);
-        const sag = sample1DAxis(sagAxis);
-
-        const color = getColorForWavelength(wlLocal);
-        traces.push({
-            x: tan.freq,
-            y: tan.mtfVals,
-            type: 'scatter',
-            mode: 'lines',
-            name: `M (${titleNmLocal}nm)`,
-            showlegend: true,
-            line: { color, width: 2, dash: 'solid' }
-        });
-        traces.push({
-            x: sag.freq,
-            y: sag.mtfVals,
-            type: 'scatter',
-            mode: 'lines',
-            name: `S (${titleNmLocal}nm)`,
-            showlegend: true,
-            line: { color, width: 2, dash: 'dot' }
-        });
+        pushTraces(sample1DAxis(tanAxis), sample1DAxis(sagAxis));
     };
 
     const totalWl = uniqueWavelengths.length;
@@ -9334,6 +9421,76 @@ async function __blocks_updateAutoValues() {
     }
 }
 
+// パラメータのドラッグ中のプレビュー: 確定前の値で光線図・スポット図を f32 で描き、操作が止まったら f64 で描き直す。
+// 光線はドラッグ開始時に描かれていたものを同じ開始点・方向で追跡し直すだけ（エイミングや面の再描画は確定時）。
+const __blocks_layoutPreviewTracer = createPreviewRefineTracer();
+const __blocks_spotPreviewTracer = createPreviewRefineTracer();
+let __blocks_layoutPreviewRays = null;
+
+function __blocks_buildPreviewRows(blockId, key, rawValue) {
+    const systemConfig = (typeof loadSystemConfigurations === 'function') ? loadSystemConfigurations() : null;
+    const activeCfg = Array.isArray(systemConfig?.configurations)
+        ? systemConfig.configurations.find(c => c && c.id === systemConfig.activeConfigId)
+        : null;
+    if (!activeCfg || !Array.isArray(activeCfg.blocks)) return null;
+
+    // 保存済みの設定は変えない（Undo も積まない）
+    const blocks = JSON.parse(JSON.stringify(activeCfg.blocks));
+    const b = blocks.find(x => x && String(x.blockId ?? '') === String(blockId));
+    if (!b) return null;
+    if (!b.parameters || typeof b.parameters !== 'object') b.parameters = {};
+    b.parameters[String(key)] = __blocks_coerceParamValue(String(b.blockType ?? ''), String(key ?? ''), rawValue);
+
+    const exp = expandBlocksToOpticalSystemRows(blocks);
+    const rows = exp && Array.isArray(exp.rows) ? exp.rows : null;
+    return (rows && rows.length >= 2) ? rows : null;
+}
+
+function __blocks_getLayoutPreviewTarget() {
+    const popup = window.popup3DWindow;
+    if (popup && !popup.closed && popup.scene) {
+        return { scene: popup.scene, renderer: popup.renderer, camera: popup.camera };
+    }
+    return window.scene ? { scene: window.scene, renderer: window.renderer, camera: window.camera } : null;
+}
+
+function __blocks_previewParamValue(blockId, key, rawValue, dragEnd) {
+    if (dragEnd) {
+        // 離した値（直前の input と同じ）の f64 の結果を出してから確定する。
+        // 確定後の再描画が無い表示（メイン画面の光線図・スポット図）もこれで確定値になる
+        __blocks_layoutPreviewTracer.flush();
+        __blocks_spotPreviewTracer.flush();
+        __blocks_layoutPreviewRays = null;
+        return;
+    }
+    try {
+        const rows = __blocks_buildPreviewRows(blockId, key, rawValue);
+        if (rows) {
+            const target = __blocks_getLayoutPreviewTarget();
+            if (target && !__blocks_layoutPreviewRays) __blocks_layoutPreviewRays = getDrawnRayStarts(target.scene);
+            const starts = __blocks_layoutPreviewRays || [];
+            if (target && starts.length > 0) {
+                const wavelength = (typeof window.getPrimaryWavelength === 'function')
+                    ? (Number(window.getPrimaryWavelength()) || 0.5876)
+                    : 0.5876;
+                const rays = starts.map(r => ({ pos: r.pos, dir: r.dir, wavelength }));
+                __blocks_layoutPreviewTracer.preview(rows, rays, (paths) => {
+                    clearDrawnRays(target.scene);
+                    paths.forEach((path, i) => {
+                        if (Array.isArray(path) && path.length >= 2) {
+                            drawRayWithSegmentColors(path, starts[i].objectId, starts[i].rayNumber, target.scene);
+                        }
+                    });
+                    if (target.renderer && target.camera) target.renderer.render(target.scene, target.camera);
+                });
+            }
+            previewSpotDiagram(rows, __blocks_spotPreviewTracer);
+        }
+    } catch (e) {
+        console.warn('⚠️ Parameter preview failed:', e);
+    }
+}
+
 function __blocks_setBlockParamValue(blockId, key, rawValue) {
     console.log(`[Undo] __blocks_setBlockParamValue called: blockId=${blockId}, key=${key}, rawValue=${rawValue}`);
     console.log(`[Undo] window.SetBlockParameterCommand exists:`, !!window.SetBlockParameterCommand);
@@ -10601,7 +10758,8 @@ function renderBlockInspector(summary, groups, blockById = null, blocksInOrder =
                             (newValue) => {
                                 console.log(`[Undo] Slider commit for ${it.key || it.role}:`, newValue);
                                 commitValue(newValue);
-                            }
+                            },
+                            isApertureItem ? null : (value, dragEnd) => __blocks_previewParamValue(blockId, it.key, value, dragEnd)
                         );
                         valueEl = sliderContainer;
                     } else {
@@ -4,13 +4,31 @@
  */
 
 import { OPERAND_DEFINITIONS, InspectorManager } from './merit-function-inspector.js';
-import { calculateFullSystemParaxialTrace, calculateParaxialData, findStopSurfaceIndex } from '../../raytracing/core/ray-paraxial.js';
+import { calculateFullSystemParaxialTrace, findStopSurfaceIndex } from '../../raytracing/core/ray-paraxial.js';
 import { traceRay, traceRayHitPoint, calculateSurfaceOrigins, transformPointToLocal } from '../../raytracing/core/ray-tracing.js';
 import { getOpticalSystemRows, getObjectRows, getSourceRows } from '../../utils/data-utils.js';
-import { calculateSeidelCoefficients } from '../../evaluation/aberrations/seidel-coefficients.js';
-import { calculateAfocalSeidelCoefficientsIntegrated } from '../../evaluation/aberrations/seidel-coefficients-afocal.js';
+import {
+    computePrimarySystemMetrics,
+    computeSeidelTotal,
+    computeSeidelTotalSingleMode,
+    computeTotalSystemLengthMm,
+    computeObjectDistanceMm,
+    getPrimaryWavelengthFromSourceRows,
+    getSystemWavelengthFromOperandOrPrimary,
+    getWavelengthFromSourceRows,
+    safeFiniteNumberOrZero
+} from '../../evaluation/operand-metrics.js';
+import {
+    ZERNIKE_LIVE_MAX_NOLL,
+    computeSpotSizeStatsUm,
+    computeZernikeFitLive,
+    createSpotSizeProbe,
+    parseSpotSizeMetric,
+    resolveZernikeOperandInputs,
+    spotSizeValueFromStats,
+    zernikeCoefficientFromFit
+} from '../../evaluation/operand-ray-metrics.js';
 import { generateSpotDiagram, generateSurfaceOptions } from '../../evaluation/spot-diagram.js';
-import { createOPDCalculator, WavefrontAberrationAnalyzer } from '../../evaluation/wavefront/wavefront.js';
 import { expandBlocksToOpticalSystemRows } from '../../data/block-schema.js';
 import { generateRayStartPointsForObject, setRayEmissionPattern, getRayEmissionPattern } from '../../optical/ray-renderer.js';
 import { calculateLongitudinalAberration } from '../../evaluation/aberrations/longitudinal-aberration.js';
@@ -28,14 +46,6 @@ function cloneJson(v) {
     }
 }
 
-function parseZernikeUnit(raw) {
-    const s = String(raw ?? '').trim().toLowerCase();
-    if (!s) return 'waves';
-    if (s === 'waves' || s === 'wave' || s === 'w' || s === 'lambda' || s === 'λ') return 'waves';
-    if (s === 'um' || s === 'µm' || s === 'micron' || s === 'microns') return 'um';
-    return 'waves';
-}
-
 function readCoeff(container, noll) {
     if (!container) return null;
     const k = String(noll);
@@ -58,53 +68,6 @@ function toFiniteNumber(v, fallback = 0) {
     return Number.isFinite(n) ? n : fallback;
 }
 
-function isInfiniteSystemFromRows(opticalSystemRows) {
-    const t = opticalSystemRows?.[0]?.thickness;
-    return t === 'INF' || t === 'Infinity' || t === Infinity;
-}
-
-function toFieldSettingFromObjectRow(objRow, index0, isInfiniteSystem) {
-    const pos = String(objRow?.position ?? objRow?.Position ?? objRow?.type ?? '').toLowerCase();
-    const xVal = toFiniteNumber(objRow?.xHeightAngle, 0);
-    const yVal = toFiniteNumber(objRow?.yHeightAngle, 0);
-
-    const isAngleMode = pos === 'angle' || pos === 'field angle' || pos === 'angles';
-    const isHeightMode = pos === 'rectangle' || pos === 'height' || pos === 'point';
-
-    let fieldAngle = { x: 0, y: 0 };
-    let xHeight = 0;
-    let yHeight = 0;
-    let type = objRow?.position ?? objRow?.type ?? '';
-
-    if (isAngleMode) {
-        fieldAngle = { x: xVal, y: yVal };
-        type = 'Angle';
-    } else if (isHeightMode) {
-        xHeight = xVal;
-        yHeight = yVal;
-        type = 'Rectangle';
-    } else {
-        // Fallback: infer from system type.
-        if (isInfiniteSystem) {
-            fieldAngle = { x: xVal, y: yVal };
-            type = 'Angle';
-        } else {
-            xHeight = xVal;
-            yHeight = yVal;
-            type = 'Rectangle';
-        }
-    }
-
-    return {
-        id: objRow?.id || index0 + 1,
-        type,
-        fieldAngle,
-        xHeight,
-        yHeight,
-        objectIndex: index0
-    };
-}
-
 function sampleUnitDiskPoints({ rings = 4, spokes = 12 } = {}) {
     const pts = [{ x: 0, y: 0 }];
     const rr = Math.max(1, Math.floor(rings));
@@ -121,106 +84,6 @@ function sampleUnitDiskPoints({ rings = 4, spokes = 12 } = {}) {
     return pts;
 }
 
-function computeZernikeFitLive({ opticalSystemData, wavelengthUm, fieldSetting, zernikeMaxNoll = 15, samplingSize = 32 }) {
-    if (!Array.isArray(opticalSystemData) || opticalSystemData.length === 0) return null;
-    if (!Number.isFinite(wavelengthUm) || wavelengthUm <= 0) return null;
-    if (!fieldSetting || typeof fieldSetting !== 'object') return null;
-    const opdCalculator = createOPDCalculator(opticalSystemData, wavelengthUm);
-    const analyzer = new WavefrontAberrationAnalyzer(opdCalculator);
-
-    try {
-        opdCalculator.setReferenceRay(fieldSetting);
-    } catch (_) {
-        // If reference ray setup fails, return null.
-        return null;
-    }
-
-    // **CRITICAL: Use SAME sampling method as OPD Analysis**
-    // OPD uses rectangular grid (gridSize × gridSize) with circular mask
-    // This ensures IDENTICAL Zernike coefficients between OPD display and Requirements
-    const gridSize = samplingSize;
-    const pupilRange = 1.0; // Same as OPD Analysis
-    
-    const pupilCoordinates = [];
-    const opds = [];
-    
-    // Generate rectangular grid with circular mask (same as eva-wavefront.js line 5984)
-    for (let i = 0; i < gridSize; i++) {
-        for (let j = 0; j < gridSize; j++) {
-            const pupilX = (i / (gridSize - 1)) * 2 * pupilRange - pupilRange;
-            const pupilY = (j / (gridSize - 1)) * 2 * pupilRange - pupilRange;
-            
-            // Check if point is within circular pupil range
-            const pupilRadius = Math.sqrt(pupilX * pupilX + pupilY * pupilY);
-            if (pupilRadius <= pupilRange) {
-                let opd = NaN;
-                try {
-                    // Use reference-sphere OPD (same as OPD Analysis)
-                    opd = opdCalculator.calculateOPDReferenceSphere(pupilX, pupilY, fieldSetting, false, { fastMarginalRay: true });
-                } catch (_) {
-                    opd = NaN;
-                }
-                if (Number.isFinite(opd)) {
-                    pupilCoordinates.push({ x: pupilX, y: pupilY, r: pupilRadius });
-                    opds.push(opd);
-                }
-            }
-        }
-    }
-
-    if (pupilCoordinates.length < 6) {
-        try {
-            if (typeof window !== 'undefined') {
-                window.__cooptLastZernikeLiveDebug = {
-                    ok: false,
-                    reason: 'insufficient-valid-opd-samples',
-                    wavelengthUm,
-                    zernikeMaxNoll,
-                    fieldSetting,
-                    validCount: pupilCoordinates.length
-                };
-            }
-        } catch (_) {}
-        return null;
-    }
-
-    const wavefrontMap = {
-        pupilCoordinates,
-        opds
-    };
-
-    try {
-        const fit = analyzer.fitZernikePolynomials(wavefrontMap, zernikeMaxNoll);
-        try {
-            if (typeof window !== 'undefined') {
-                window.__cooptLastZernikeLiveDebug = {
-                    ok: true,
-                    wavelengthUm,
-                    zernikeMaxNoll,
-                    fieldSetting,
-                    validSamples: sampled.pupilCoordinates.length,
-                    maxNoll: fit?.maxNoll ?? null
-                };
-            }
-        } catch (_) {}
-        return fit;
-    } catch (_) {
-        try {
-            if (typeof window !== 'undefined') {
-                window.__cooptLastZernikeLiveDebug = {
-                    ok: false,
-                    reason: 'fit-failed',
-                    wavelengthUm,
-                    zernikeMaxNoll,
-                    fieldSetting,
-                    validSamples: sampled.pupilCoordinates.length
-                };
-            }
-        } catch (_) {}
-        return null;
-    }
-}
-
 function fieldSettingCacheKey(fieldSetting) {
     if (!fieldSetting || typeof fieldSetting !== 'object') return 'field:invalid';
     const type = String(fieldSetting.type ?? '').trim();
@@ -832,48 +695,17 @@ class MeritFunctionEditor {
                 return this.calculateLongitudinalAberrationRmsUm(operand, opticalSystemData);
             case 'ZERN_COEFF': {
                 const FAIL = 1e9;
-                
-                // New parameter order: λ idx, Object idx, Unit, Sampling, n (Noll)
+
+                // Parameter order: λ idx, Object idx, Unit, Sampling, n (Noll)
                 const { source: sourceRows, object: objectRows } = this.getConfigTablesByConfigId(operand?.configId);
-                
-                // param1: λ idx (1-based, blank=Primary)
-                const wavelength = this.getSystemWavelengthFromOperandOrPrimary({ param1: operand?.param1 }, sourceRows);
-                
-                // param2: Object idx (1-based, default 1)
-                const fieldIdx1 = Number.isFinite(Number(operand?.param2)) ? Math.max(1, Math.floor(Number(operand.param2))) : 1;
-                const objRow = Array.isArray(objectRows) ? objectRows[Math.max(0, Math.min(objectRows.length - 1, fieldIdx1 - 1))] : null;
-                const isInf = isInfiniteSystemFromRows(opticalSystemData);
-                const fieldSetting = toFieldSettingFromObjectRow(objRow || {}, fieldIdx1 - 1, isInf);
-                
-                // param3: Unit (waves or um)
-                const unit = parseZernikeUnit(operand?.param3);
-                
-                // param4: Sampling (grid size, default 32)
-                const samplingSize = Number.isFinite(Number(operand?.param4)) && Number(operand.param4) > 0 
-                    ? Math.floor(Number(operand.param4)) 
-                    : 32;
-                
-                // param5: n (Noll) - coefficient index
-                const param5Value = operand?.param5;
-                const nollRaw = param5Value !== undefined && param5Value !== null && String(param5Value).trim() !== '' 
-                    ? Number(param5Value) 
-                    : 0;  // Default to 0 (RMS) if not specified
-                
-                if (!Number.isFinite(nollRaw)) return FAIL;
-                const noll = Math.floor(nollRaw);
-                if (noll < 0) return FAIL;
+                const inputs = resolveZernikeOperandInputs(operand, opticalSystemData, sourceRows, objectRows);
+                if (!inputs) return FAIL;
+                const { wavelength, fieldSetting, unit, samplingSize, noll } = inputs;
 
                 // CRITICAL: Use EXACT SAME wavefrontMap as OPD Analysis if available
                 // This ensures 100% identical Zernike coefficients
-                const useExistingOPDMap = (typeof window !== 'undefined' && window.__lastWavefrontMap?.zernike);
-                
-                let zernike = null;
-                let coeffWaves = null;
-                let coeffUm = null;
-                
-                if (useExistingOPDMap) {
-                    // Use the SAME wavefrontMap that OPD Analysis calculated
-                    const existingMap = window.__lastWavefrontMap;
+                const existingMap = (typeof window !== 'undefined') ? window.__lastWavefrontMap : null;
+                if (existingMap?.zernike) {
                     console.log('[ZERN_COEFF] Using existing OPD wavefrontMap:');
                     console.log('[ZERN_COEFF]   - pupilCoordinates count:', existingMap?.pupilCoordinates?.length);
                     console.log('[ZERN_COEFF]   - raw.opds count:', existingMap?.raw?.opds?.length);
@@ -886,95 +718,27 @@ class MeritFunctionEditor {
                             console.log(`[ZERN_COEFF]     OSA ${i}:`, coeffs[i]);
                         }
                     }
-                    
-                    zernike = existingMap.zernike;
-                    coeffWaves = zernike?.coefficientsWaves || null;
-                    coeffUm = zernike?.coefficientsMicrons || null;
-                } else {
-                    // Fallback: compute our own Zernike fit
-                    const cfgKey = operand?.configId ? String(operand.configId) : 'active';
-                    const maxNollRequested = 37;
-                    const cacheKey = `zernike-opd:${cfgKey}:wl=${wavelength}:max=${maxNollRequested}:grid=${samplingSize}:${fieldSettingCacheKey(fieldSetting)}`;
-                    zernike = (() => {
-                        const cached = this._runtimeCache ? this._runtimeCache.get(cacheKey) : null;
-                        if (cached) return cached;
-                        const fit = computeZernikeFitLive({ opticalSystemData, wavelengthUm: wavelength, fieldSetting, zernikeMaxNoll: maxNollRequested, samplingSize });
-                        if (fit && this._runtimeCache) this._runtimeCache.set(cacheKey, fit);
-                        return fit;
-                    })();
-                    if (!zernike) return FAIL;
-                    
-                    coeffWaves = zernike?.coefficientsWaves || null;
-                    coeffUm = zernike?.coefficientsMicrons || null;
+                    return zernikeCoefficientFromFit(existingMap.zernike, noll, unit, wavelength, FAIL);
                 }
-                
-                if (!zernike) return FAIL;
-
-                const readCoeff = (container, osaIndex) => {
-                    if (!container || typeof container !== 'object') return null;
-                    const v = container[osaIndex];
-                    return (v !== undefined && v !== null && Number.isFinite(Number(v))) ? Number(v) : null;
-                };
-
-                const nollToOSA = (nollIndex) => {
-                    if (nollIndex === 0) return -1;
-                    const jj = Math.floor(Number(nollIndex));
-                    if (!Number.isFinite(jj) || jj < 1) return -1;
-                    
-                    // Noll → (n,m) conversion (from eva-wavefront.js nollToNM_deprecated)
-                    let n = 0;
-                    while (((n + 1) * (n + 2)) / 2 < jj) n++;
-                    const j0 = (n * (n + 1)) / 2 + 1;
-                    const k = jj - j0; // 0..n
-                    const m = -n + 2 * k;
-                    
-                    // (n,m) → OSA index
-                    const osaIndex = (n * (n + 2) + m) / 2;
-                    return Math.floor(osaIndex);
-                };
 
-                const maxNoll = Number(zernike?.maxNoll);
-                const termMax = Number.isFinite(maxNoll) ? Math.max(1, Math.floor(maxNoll)) : null;
-
-                const getCoeffInUnit = (nollIndex) => {
-                    const osaIndex = nollToOSA(nollIndex);
-                    if (osaIndex < 0) return null;
-                    
-                    if (unit === 'um') {
-                        const direct = readCoeff(coeffUm, osaIndex);
-                        if (direct !== null) return direct;
-                        const w = readCoeff(coeffWaves, osaIndex);
-                        if (w === null) return null;
-                        if (!(Number.isFinite(wavelength) && wavelength > 0)) return null;
-                        return w * wavelength;
-                    }
-                    return readCoeff(coeffWaves, osaIndex);
-                };
-
-                if (noll === 0) {
-                    let sumSq = 0;
-                    if (termMax !== null) {
-                        for (let j = 4; j <= termMax; j++) {
-                            const c = getCoeffInUnit(j);
-                            if (c === null) continue;
-                            sumSq += c * c;
+                // Fallback: compute our own Zernike fit (same as the merit worker, evaluation/operand-ray-metrics.js)
+                const cfgKey = operand?.configId ? String(operand.configId) : 'active';
+                const cacheKey = `zernike-opd:${cfgKey}:wl=${wavelength}:max=${ZERNIKE_LIVE_MAX_NOLL}:grid=${samplingSize}:${fieldSettingCacheKey(fieldSetting)}`;
+                let zernike = this._runtimeCache ? this._runtimeCache.get(cacheKey) : null;
+                if (!zernike) {
+                    zernike = computeZernikeFitLive({
+                        opticalSystemData,
+                        wavelengthUm: wavelength,
+                        fieldSetting,
+                        zernikeMaxNoll: ZERNIKE_LIVE_MAX_NOLL,
+                        samplingSize,
+                        onDebug: (info) => {
+                            if (typeof window !== 'undefined') window.__cooptLastZernikeLiveDebug = info;
                         }
-                        return Number.isFinite(sumSq) ? Math.sqrt(sumSq) : FAIL;
-                    }
-                    const container = (unit === 'um' && coeffUm) ? coeffUm : coeffWaves;
-                    if (!container || typeof container !== 'object') return FAIL;
-                    for (const [k, v] of Object.entries(container)) {
-                        const j = Number(k);
-                        if (!Number.isFinite(j) || j < 4) continue;
-                        const c = getCoeffInUnit(Math.floor(j));
-                        if (c === null) continue;
-                        sumSq += c * c;
-                    }
-                    return Number.isFinite(sumSq) ? Math.sqrt(sumSq) : FAIL;
+                    });
+                    if (zernike && this._runtimeCache) this._runtimeCache.set(cacheKey, zernike);
                 }
-
-                const c = getCoeffInUnit(noll);
-                return (c === null) ? FAIL : c;
+                return zernikeCoefficientFromFit(zernike, noll, unit, wavelength, FAIL);
             }
             default:
                 return 0;
@@ -1514,26 +1278,7 @@ class MeritFunctionEditor {
                 return 1e9;
             }
 
-            const metricRaw = (operand?.param3 === undefined || operand?.param3 === null) ? '' : String(operand.param3);
-            const metricNorm0 = metricRaw.trim().toLowerCase();
-            const metricNorm = metricNorm0.replace(/[^a-z0-9]/g, '');
-            const metric = (!metricNorm0 || metricNorm === '')
-                ? 'rms'
-                : (
-                    metricNorm === 'rms' ||
-                    metricNorm === 'rmstotal' ||
-                    metricNorm === 'rmsxy' ||
-                    metricNorm === 'r'
-                )
-                    ? 'rms'
-                    : (
-                        metricNorm === 'diameter' ||
-                        metricNorm === 'dia' ||
-                        metricNorm === 'diam' ||
-                        metricNorm === 'd'
-                    )
-                        ? 'diameter'
-                        : metricNorm0;
+            const metric = parseSpotSizeMetric(operand?.param3);
 
             const raysRaw = Number(operand?.param4);
             const rayCountFromOperand = Number.isFinite(raysRaw) ? Math.max(1, Math.min(5000, Math.floor(raysRaw))) : null;
@@ -2376,61 +2121,12 @@ class MeritFunctionEditor {
                     return 1e9;
                 }
 
-                let chiefPt = spotPoints.find(p => p && p.isChiefRay) || null;
-                const chiefFound = !!chiefPt;
-                if (!chiefPt) {
-                    // Spot Diagram fallback behavior: centroid-closest.
-                    const cx = spotPoints.reduce((sum, p) => sum + Number(p?.x || 0), 0) / spotPoints.length;
-                    const cy = spotPoints.reduce((sum, p) => sum + Number(p?.y || 0), 0) / spotPoints.length;
-                    let bestIdx = 0;
-                    let bestDist = Infinity;
-                    for (let i = 0; i < spotPoints.length; i++) {
-                        const p = spotPoints[i];
-                        const x = Number(p?.x);
-                        const y = Number(p?.y);
-                        if (!Number.isFinite(x) || !Number.isFinite(y)) continue;
-                        const d = Math.hypot(x - cx, y - cy);
-                        if (d < bestDist) {
-                            bestDist = d;
-                            bestIdx = i;
-                        }
-                    }
-                    chiefPt = spotPoints[bestIdx] || spotPoints[0];
-                }
-
-                const chiefX = Number(chiefPt?.x);
-                const chiefY = Number(chiefPt?.y);
-                if (!Number.isFinite(chiefX) || !Number.isFinite(chiefY)) {
-                    stampSpotDebug({ ok: false, reason: 'invalid-chief-point', hits: spotPoints.length });
+                const stats = computeSpotSizeStatsUm(spotPoints);
+                if (!stats.ok) {
+                    stampSpotDebug({ ok: false, reason: stats.reason, hits: stats.n });
                     return 1e9;
                 }
 
-                let maxRUm = 0;
-                let sumX2 = 0;
-                let sumY2 = 0;
-                let n = 0;
-                for (const p of spotPoints) {
-                    const x = Number(p?.x);
-                    const y = Number(p?.y);
-                    if (!Number.isFinite(x) || !Number.isFinite(y)) continue;
-                    const dxUm = (x - chiefX) * 1000;
-                    const dyUm = (y - chiefY) * 1000;
-                    const rUm = Math.hypot(dxUm, dyUm);
-                    if (rUm > maxRUm) maxRUm = rUm;
-                    sumX2 += dxUm * dxUm;
-                    sumY2 += dyUm * dyUm;
-                    n++;
-                }
-
-                if (n <= 0) {
-                    stampSpotDebug({ ok: false, reason: 'no-finite-spot-points', hits: 0 });
-                    return 1e9;
-                }
-                const rmsX = Math.sqrt(sumX2 / n);
-                const rmsY = Math.sqrt(sumY2 / n);
-                const rmsTotal = Math.sqrt(rmsX * rmsX + rmsY * rmsY);
-                const diameter = 2 * maxRUm;
-
                 // Debug signature for SD vs Requirements comparison.
                 try {
                     const sample = spotPoints.slice(0, 8).map(p => ({
@@ -2440,23 +2136,30 @@ class MeritFunctionEditor {
                     }));
                     stampSpotDebug({
                         spotDiagMetrics: {
-                            chiefSelection: chiefFound ? 'flagged-chief' : 'centroid-closest',
-                            chiefXmm: chiefX,
-                            chiefYmm: chiefY,
-                            n,
-                            rmsXUm: rmsX,
-                            rmsYUm: rmsY,
-                            rmsTotalUm: rmsTotal,
-                            diameterUm: diameter,
-                            maxRUm,
+                            chiefSelection: stats.chiefFound ? 'flagged-chief' : 'centroid-closest',
+                            chiefXmm: stats.chiefXmm,
+                            chiefYmm: stats.chiefYmm,
+                            n: stats.n,
+                            rmsXUm: stats.rmsXUm,
+                            rmsYUm: stats.rmsYUm,
+                            rmsTotalUm: stats.rmsTotalUm,
+                            diameterUm: stats.diameterUm,
+                            maxRUm: stats.maxRUm,
                         },
                         spotDiagPointSample: sample
                     });
                 } catch (_) {}
 
-                const valueUm = (metric === 'diameter') ? diameter : rmsTotal;
+                // The optimizer's merit workers re-trace these rays for the Jacobian columns
+                // (and the analytic LM Jacobian differentiates them on the rows they were traced on).
+                if (operand && typeof operand === 'object' && operand.__captureSpotProbe) {
+                    operand.__spotProbe = createSpotSizeProbe(spotPoints, targetSurfaceIdx2, metric);
+                    operand.__spotProbeRows = spotOpticalRows;
+                }
+
+                const valueUm = spotSizeValueFromStats(stats, metric);
                 try { stampSpotDebug({ spotDiagStage: 'success' }); } catch (_) {}
-                stampSpotDebug({ ok: true, reason: 'ok', hits: n, resultUm: valueUm, lastRayTraceFailure: getLastRayTraceFailureForThisEval() });
+                stampSpotDebug({ ok: true, reason: 'ok', hits: stats.n, resultUm: valueUm, lastRayTraceFailure: getLastRayTraceFailureForThisEval() });
                 return valueUm;
             }
 
@@ -3399,72 +3102,27 @@ class MeritFunctionEditor {
     }
 
     getWavelengthFromSourceRows(sourceRows, sourceIndex1Based) {
-        const idx = Number.isFinite(Number(sourceIndex1Based)) ? Math.floor(Number(sourceIndex1Based)) : 1;
-        const index0 = Math.max(0, idx - 1);
-        const row = Array.isArray(sourceRows) ? sourceRows[index0] : null;
-        const wl = row ? Number(row.wavelength) : NaN;
-        return (Number.isFinite(wl) && wl > 0) ? wl : 0.5875618;
+        return getWavelengthFromSourceRows(sourceRows, sourceIndex1Based);
     }
 
     getPrimaryWavelengthFromSourceRows(sourceRows) {
-        if (!Array.isArray(sourceRows) || sourceRows.length === 0) return 0.5875618;
-        const primaryRow = sourceRows.find(r => r && r.primary && String(r.primary).toLowerCase().includes('primary'));
-        const wl = primaryRow ? Number(primaryRow.wavelength) : NaN;
-        if (Number.isFinite(wl) && wl > 0) return wl;
-        // フォールバック: 1行目
-        const wl0 = Number(sourceRows[0]?.wavelength);
-        return (Number.isFinite(wl0) && wl0 > 0) ? wl0 : 0.5875618;
+        return getPrimaryWavelengthFromSourceRows(sourceRows);
     }
 
     getSystemWavelengthFromOperandOrPrimary(operand, sourceRows) {
-        const raw = (operand && operand.param1 !== undefined && operand.param1 !== null) ? String(operand.param1).trim() : '';
-        if (raw === '') return this.getPrimaryWavelengthFromSourceRows(sourceRows);
-
-        const n = Number(raw);
-        if (!Number.isFinite(n) || n <= 0) return this.getPrimaryWavelengthFromSourceRows(sourceRows);
-
-        // Backward compatible behavior: most operands historically used "λ idx" (Source row number).
-        // In practice, users often type the wavelength value itself (e.g. 0.4861, 0.5876, 0.6563).
-        // If we treat 0.4861 as an index, Math.floor() -> 0, and we incorrectly fall back to Primary.
-        // Heuristic:
-        // - n < 1 : almost certainly wavelength in µm
-        // - non-integer with '.' or 'e' : treat as wavelength in µm
-        const s = raw.toLowerCase();
-        const isNonIntegerLiteral = (s.includes('.') || s.includes('e')) && Math.abs(n - Math.round(n)) > 1e-12;
-        const looksLikeWavelengthUm = (n < 1) || isNonIntegerLiteral;
-        if (looksLikeWavelengthUm) return n;
-
-        const idx1 = Math.floor(n);
-        if (idx1 > 0) return this.getWavelengthFromSourceRows(sourceRows, idx1);
-        return this.getPrimaryWavelengthFromSourceRows(sourceRows);
+        return getSystemWavelengthFromOperandOrPrimary(operand, sourceRows);
     }
 
     safeFiniteNumberOrZero(v) {
-        const n = Number(v);
-        return Number.isFinite(n) ? n : 0;
+        return safeFiniteNumberOrZero(v);
     }
 
     computeTotalSystemLengthMm(opticalSystemData) {
-        if (!Array.isArray(opticalSystemData) || opticalSystemData.length === 0) return 0;
-        let total = 0;
-        for (const row of opticalSystemData) {
-            const tRaw = row ? row.thickness : undefined;
-            if (tRaw === undefined || tRaw === null) continue;
-            const s = String(tRaw).trim().toUpperCase();
-            if (s === 'INF' || s === 'INFINITY') continue;
-            const t = Number(tRaw);
-            if (Number.isFinite(t)) total += t;
-        }
-        return total;
+        return computeTotalSystemLengthMm(opticalSystemData);
     }
 
     computeObjectDistanceMm(opticalSystemData) {
-        const tRaw = opticalSystemData?.[0]?.thickness;
-        if (tRaw === undefined || tRaw === null) return 0;
-        const s = String(tRaw).trim().toUpperCase();
-        if (s === 'INF' || s === 'INFINITY') return 0;
-        const t = Number(tRaw);
-        return Number.isFinite(t) ? t : 0;
+        return computeObjectDistanceMm(opticalSystemData);
     }
 
     getPrimarySystemMetricsCached(operand, opticalSystemData) {
@@ -3476,99 +3134,8 @@ class MeritFunctionEditor {
         const cached = this._runtimeCache ? this._runtimeCache.get(cacheKey) : null;
         if (cached) return cached;
 
-        const paraxial = calculateParaxialData(opticalSystemData, wavelength);
-
-        const fl = this.safeFiniteNumberOrZero(paraxial?.focalLength);
-        const bfl = this.safeFiniteNumberOrZero(paraxial?.backFocalLength);
-        const imd = this.safeFiniteNumberOrZero(paraxial?.imageDistance);
-        const finalAlpha = Number(paraxial?.finalAlpha);
-
-        // EFL (System Data): EFL = 1 / alpha(final) with h[1]=1
-        const eflTrace = calculateFullSystemParaxialTrace(opticalSystemData, wavelength);
-        const efl = (eflTrace && Number.isFinite(eflTrace.finalAlpha) && Math.abs(eflTrace.finalAlpha) > 1e-12)
-            ? (1.0 / eflTrace.finalAlpha)
-            : 0;
-
-        const totalLength = this.computeTotalSystemLengthMm(opticalSystemData);
-        const objd = this.computeObjectDistanceMm(opticalSystemData);
-
-        const exitPupilDetails = paraxial?.exitPupilDetails;
-        const newSpecPupils = paraxial?.newSpecPupils;
-        const exitPupil = newSpecPupils?.exitPupil;
-        const entrancePupil = newSpecPupils?.entrancePupil;
-
-        // Prefer new method details if available
-        const expd = this.safeFiniteNumberOrZero(exitPupilDetails?.diameter ?? exitPupil?.diameter ?? paraxial?.exitPupilDiameter);
-        const exPosOrigin = this.safeFiniteNumberOrZero(exitPupilDetails?.position ?? exitPupil?.position);
-        const exppFromImage = (Number.isFinite(exPosOrigin) && Number.isFinite(imd)) ? (exPosOrigin - imd) : 0;
-
-        // βexp: prefer explicit betaExp, else magnification
-        const betaExpRaw = (typeof exitPupil?.betaExp === 'number') ? exitPupil.betaExp
-            : (typeof exitPupilDetails?.betaExp === 'number') ? exitPupilDetails.betaExp
-            : (typeof exitPupilDetails?.magnification === 'number') ? exitPupilDetails.magnification
-            : (typeof exitPupil?.magnification === 'number') ? exitPupil.magnification
-            : NaN;
-        const betaExp = this.safeFiniteNumberOrZero(betaExpRaw);
-
-        const enpd = this.safeFiniteNumberOrZero(entrancePupil?.diameter ?? paraxial?.entrancePupilDiameter);
-        const enpp = this.safeFiniteNumberOrZero(entrancePupil?.position);
-        const enpm = this.safeFiniteNumberOrZero(entrancePupil?.magnification);
-
-        // Paraxial magnification (finite object): beta = alpha[1]/alpha[final], alpha[1] = -1/objd (h[1]=1, n=1)
-        let pmag = 0;
-        if (objd > 0 && Number.isFinite(finalAlpha) && Math.abs(finalAlpha) > 1e-12) {
-            const initialAlpha = -1.0 / objd;
-            pmag = initialAlpha / finalAlpha;
-        }
-
-        // Working F#: (-ExP + id) / ExPD (using origin position)
-        let fnoWrk = 0;
-        if (Number.isFinite(exPosOrigin) && Number.isFinite(imd) && expd > 0) {
-            fnoWrk = (-exPosOrigin + imd) / expd;
-        }
-
-        // Object Space F# = abs(F#work / beta) if beta != 0
-        let fnoObj = 0;
-        if (Math.abs(pmag) > 1e-12 && Number.isFinite(fnoWrk)) {
-            fnoObj = Math.abs(fnoWrk / pmag);
-        }
-
-        // Image Space F# = f' / EnPD (System Data uses FL)
-        let fnoImg = 0;
-        if (fl > 0 && enpd > 0) {
-            fnoImg = fl / enpd;
-        }
-
-        // NAimg = 1/(2*F#work), NAobj = abs(NAimg * beta)
-        let naImg = 0;
-        let naObj = 0;
-        if (Number.isFinite(fnoWrk) && Math.abs(fnoWrk) > 1e-12) {
-            naImg = 1.0 / (2.0 * fnoWrk);
-            if (Number.isFinite(pmag)) {
-                naObj = Math.abs(naImg * pmag);
-            }
-        }
-
-        const metrics = {
-            FL: this.safeFiniteNumberOrZero(fl),
-            EFL: this.safeFiniteNumberOrZero(efl),
-            BFL: this.safeFiniteNumberOrZero(bfl),
-            IMD: this.safeFiniteNumberOrZero(imd),
-            OBJD: this.safeFiniteNumberOrZero(objd),
-            TSL: this.safeFiniteNumberOrZero(totalLength),
-            BEXP: this.safeFiniteNumberOrZero(betaExp),
-            EXPD: this.safeFiniteNumberOrZero(expd),
-            EXPP: this.safeFiniteNumberOrZero(exppFromImage),
-            ENPD: this.safeFiniteNumberOrZero(enpd),
-            ENPP: this.safeFiniteNumberOrZero(enpp),
-            ENPM: this.safeFiniteNumberOrZero(enpm),
-            PMAG: this.safeFiniteNumberOrZero(pmag),
-            FNO_OBJ: this.safeFiniteNumberOrZero(fnoObj),
-            FNO_IMG: this.safeFiniteNumberOrZero(fnoImg),
-            FNO_WRK: this.safeFiniteNumberOrZero(fnoWrk),
-            NA_OBJ: this.safeFiniteNumberOrZero(naObj),
-            NA_IMG: this.safeFiniteNumberOrZero(naImg),
-        };
+        // 計算本体は evaluation/operand-metrics.js（メリットワーカーと共通）
+        const metrics = computePrimarySystemMetrics(opticalSystemData, wavelength);
 
         if (this._runtimeCache) this._runtimeCache.set(cacheKey, metrics);
         return metrics;
@@ -3590,128 +3157,11 @@ class MeritFunctionEditor {
         if (!opticalSystemData || opticalSystemData.length < 2) return 0;
 
         const { source: sourceRows, object: objectRows } = this.getConfigTablesByConfigId(operand.configId);
-        
-        // Parse Mode parameter: accept single value (0 or 1) or comma-separated list (e.g., "0,1")
-        const modeRaw = (operand?.param2 !== undefined && operand?.param2 !== null) ? String(operand.param2).trim() : '';
-        const modeList = (() => {
-            if (modeRaw === '') return [0];
-            if (modeRaw.includes(',')) {
-                // Parse comma-separated list
-                return modeRaw.split(',')
-                    .map(s => parseInt(s.trim(), 10))
-                    .filter(n => n === 0 || n === 1);
-            }
-            const single = parseInt(modeRaw, 10);
-            return (single === 0 || single === 1) ? [single] : [0];
-        })();
-        
-        // If list contains multiple modes, compute RMS over all modes
-        if (modeList.length > 1) {
-            let sumSq = 0;
-            for (const mode of modeList) {
-                const isAfocal = mode === 1;
-                const value = this._calculateSeidelTotalSingleMode(
-                    operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal
-                );
-                sumSq += value * value;
-            }
-            return Math.sqrt(sumSq);
-        }
-        
-        // Single mode: use existing logic
-        const mode = modeList[0] || 0;
-        const isAfocal = mode === 1;
-        return this._calculateSeidelTotalSingleMode(
-            operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal
-        );
+        return computeSeidelTotal(operand, opticalSystemData, totalKey, sourceRows, objectRows, this._runtimeCache);
     }
-    
-    _calculateSeidelTotalSingleMode(operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal) {
-        // S1 (Context3): 0 => total, else surface
-        const s1Num = Number.isFinite(Number(operand?.param3)) ? Math.floor(Number(operand.param3)) : 0;
-        const s1 = (Number.isFinite(s1Num) && s1Num > 0) ? s1Num : 0;
-
-        // Reference Focal Length (Context4)
-        // - blank => Auto
-        // - 0 => Auto
-        // Imaging: Auto means use calculated FL (ignore textbox)
-        // Afocal: Auto means default unit scale (see afocal module)
-        const refFLRaw = (operand && operand.param4 !== undefined && operand.param4 !== null) ? String(operand.param4).trim() : '';
-        const refFLNum = (refFLRaw === '') ? 0 : Number(refFLRaw);
-        const referenceFocalLengthAfocal = (Number.isFinite(refFLNum) && refFLNum !== 0) ? refFLNum : undefined;
-        const referenceFocalLengthOverrideImaging = (Number.isFinite(refFLNum) && refFLNum !== 0) ? refFLNum : 0;
-
-        const primaryWavelength = this.getPrimaryWavelengthFromSourceRows(sourceRows);
-        
-        // param1 (λ): blank/empty => use Primary wavelength, else use specified wavelength index
-        const param1Raw = (operand && operand.param1 !== undefined && operand.param1 !== null) ? String(operand.param1).trim() : '';
-        const selectedWavelength = (param1Raw === '') 
-            ? primaryWavelength 
-            : this.getSystemWavelengthFromOperandOrPrimary(operand, sourceRows);
-
-        // LCA/TCA は System Data の波長設定を使用（operand param1 では指定しない）
-        const baseWavelength = (totalKey === 'LCA' || totalKey === 'TCA') ? primaryWavelength : selectedWavelength;
-
-        // キャッシュキー（同一run内）
-        const cfgKey = operand.configId ? String(operand.configId) : 'active';
-        const cacheKey = `seidel:${cfgKey}:mode=${isAfocal ? 'afocal' : 'imaging'}:wl=${baseWavelength}:s1=${s1}:refFL=${(isAfocal ? (referenceFocalLengthAfocal ?? 'auto') : (referenceFocalLengthOverrideImaging === 0 ? 'auto' : referenceFocalLengthOverrideImaging))}:key=${totalKey}`;
-        if (this._runtimeCache && this._runtimeCache.has(cacheKey)) {
-            return this._runtimeCache.get(cacheKey);
-        }
-
-        try {
-            let seidel;
-
-            if (isAfocal) {
-                // Stop index (0-based). fallback to 1 like existing afocal handler.
-                let stopIndex = opticalSystemData.findIndex(row => row && (row['object type'] === 'Stop' || row.object === 'Stop'));
-                if (stopIndex === -1) {
-                    const fallback = findStopSurfaceIndex ? findStopSurfaceIndex(opticalSystemData) : -1;
-                    stopIndex = (fallback >= 0) ? fallback : 1;
-                }
-
-                seidel = calculateAfocalSeidelCoefficientsIntegrated(
-                    opticalSystemData,
-                    baseWavelength,
-                    stopIndex,
-                    objectRows,
-                    referenceFocalLengthAfocal
-                );
-            } else {
-                // Imaging: match System Data (no chromaticOverrides)
-                seidel = calculateSeidelCoefficients(
-                    opticalSystemData,
-                    baseWavelength,
-                    objectRows,
-                    { referenceFocalLengthOverride: referenceFocalLengthOverrideImaging }
-                );
-            }
 
-            let v = NaN;
-            if (s1 === 0) {
-                v = seidel?.totals ? Number(seidel.totals[totalKey]) : NaN;
-            } else {
-                const coeffs = seidel?.surfaceCoefficients;
-                const c = Array.isArray(coeffs)
-                    ? (
-                        // Prefer matching by Surf id shown in System Data (row.id)
-                        coeffs.find(sc => sc && Number(opticalSystemData?.[Number(sc.surfaceIndex)]?.id) === Number(s1))
-                        // Fallback: treat S1 as surfaceIndex (array index)
-                        || coeffs.find(sc => sc && Number(sc.surfaceIndex) === Number(s1))
-                      )
-                    : null;
-                v = c ? Number(c[totalKey]) : NaN;
-            }
-
-            const value = Number.isFinite(v) ? v : 0;
-
-            if (this._runtimeCache) this._runtimeCache.set(cacheKey, value);
-            return value;
-        } catch (e) {
-            console.warn('⚠️ Seidel total evaluation failed:', e);
-            if (this._runtimeCache) this._runtimeCache.set(cacheKey, 0);
-            return 0;
-        }
+    _calculateSeidelTotalSingleMode(operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal) {
+        return computeSeidelTotalSingleMode(operand, opticalSystemData, totalKey, sourceRows, objectRows, isAfocal, this._runtimeCache);
     }
     /**
      * ConfigIdに対応する光学系データを取得
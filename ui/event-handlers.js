@@ -7,6 +7,7 @@ import { setRayEmissionPattern, setRayColorMode } from '../optical/ray-renderer.
 import { calculateSurfaceOrigins } from '../raytracing/core/ray-tracing.js';
 import { calculateOpticalSystemOffset } from '../utils/math.js';
 import { drawLensCrossSectionWithSurfaceOrigins, harmonizeSceneGeometry } from '../optical/surface.js';
+import { invalidateAnalysisCache } from '../evaluation/analysis-cache.js';
 
 const __COOPT_FORCE_INFINITE_PUPIL_MODE_KEY = 'coopt.forceInfinitePupilMode';
 
@@ -39,6 +40,9 @@ function __cooptSetForceInfinitePupilMode(mode) {
         if (m) localStorage.setItem(__COOPT_FORCE_INFINITE_PUPIL_MODE_KEY, m);
         else localStorage.removeItem(__COOPT_FORCE_INFINITE_PUPIL_MODE_KEY);
     } catch (_) {}
+
+    // キャッシュ済みの OPD マップ・主光線は旧モードで求めたもの
+    invalidateAnalysisCache('force-infinite-pupil-mode');
 }
 
 function __cooptInitForceInfinitePupilModeFromStorage() {
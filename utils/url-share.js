@@ -1,7 +1,12 @@
 // URL share helpers (no server): embed compressed design JSON into location.hash
 // Requires global LZString (loaded via classic <script>)
+// - packed_data: packAllData() (data/packed-optical-system.js) + deflate-raw (CompressionStream) + base64url.
+//   Shorter than compressed_data; used when the browser has CompressionStream, LZString otherwise.
+
+import { packAllData, unpackAllData } from '../data/packed-optical-system.js';
 
 export const COMPRESSED_DATA_HASH_KEY = 'compressed_data';
+export const PACKED_DATA_HASH_KEY = 'packed_data';
 
 function __requireLZString() {
     const lz = (typeof window !== 'undefined' ? window.LZString : undefined);
@@ -65,6 +70,58 @@ export function buildShareUrlFromCompressedString(compressed, baseUrl) {
     return `${base}#!${COMPRESSED_DATA_HASH_KEY}=${compressed}`;
 }
 
+export function isPackedShareSupported() {
+    return typeof CompressionStream === 'function' && typeof DecompressionStream === 'function' &&
+        typeof Response === 'function' && typeof btoa === 'function' && typeof atob === 'function';
+}
+
+async function __pipeBytes(bytes, stream) {
+    const out = new Response(new Blob([bytes]).stream().pipeThrough(stream));
+    return new Uint8Array(await out.arrayBuffer());
+}
+
+function __bytesToBase64Url(bytes) {
+    let bin = '';
+    const CHUNK = 0x8000;
+    for (let i = 0; i < bytes.length; i += CHUNK) {
+        bin += String.fromCharCode.apply(null, bytes.subarray(i, i + CHUNK));
+    }
+    return btoa(bin).replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+}
+
+function __base64UrlToBytes(s) {
+    const b64 = s.replace(/-/g, '+').replace(/_/g, '/');
+    const bin = atob(b64 + '='.repeat((4 - (b64.length % 4)) % 4));
+    const out = new Uint8Array(bin.length);
+    for (let i = 0; i < bin.length; i++) out[i] = bin.charCodeAt(i);
+    return out;
+}
+
+export async function encodeAllDataToPackedString(allData) {
+    if (!isPackedShareSupported()) throw new Error('CompressionStream is not available');
+    const deflated = await __pipeBytes(packAllData(allData ?? null), new CompressionStream('deflate-raw'));
+    return __bytesToBase64Url(deflated);
+}
+
+export async function decodeAllDataFromPackedString(packed) {
+    if (!isPackedShareSupported()) throw new Error('DecompressionStream is not available');
+    const s = String(packed ?? '');
+    if (!s) throw new Error('Missing packed data');
+    let bytes;
+    try {
+        bytes = await __pipeBytes(__base64UrlToBytes(s), new DecompressionStream('deflate-raw'));
+    } catch (_) {
+        throw new Error('Failed to decompress');
+    }
+    return unpackAllData(bytes);
+}
+
+export function buildShareUrlFromPackedString(packed, baseUrl) {
+    const base = String(baseUrl ?? '').trim();
+    if (!base) throw new Error('Missing baseUrl');
+    return `${base}#!${PACKED_DATA_HASH_KEY}=${packed}`;
+}
+
 export function getCompressedStringFromLocationHash(hashOrSearch) {
     const params = parseHashbangParams(hashOrSearch);
     return params[COMPRESSED_DATA_HASH_KEY] ?? '';
@@ -83,3 +140,8 @@ export function getCompressedStringFromLocation() {
     }
     return compressed;
 }
+
+export function getPackedStringFromLocation() {
+    const hash = typeof window !== 'undefined' ? window.location.hash : '';
+    return parseHashbangParams(hash)[PACKED_DATA_HASH_KEY] ?? '';
+}
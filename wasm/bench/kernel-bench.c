@@ -0,0 +1,1144 @@
+/**
+ * C カーネルの再現可能なベンチマーク（ネイティブ / emcc + node 共通）
+ *
+ * ビルド・実行は wasm/Makefile の bench / bench-node ターゲットを使う:
+ *   make bench        # ホストの cc でビルド → bench/results-native.json
+ *   make bench-node   # emcc -msimd128 + node → bench/results-wasm.json
+ *
+ * 入力はフィクスチャ（node performance/kernel-benchmark.mjs fixtures が生成）:
+ *   - サンプルレンズの面テーブル（packOpticalSystemForWasm）と JS traceRay() の参照光線
+ *   - 64² 格子 PSF の OPD / 瞳マスクと JS SimpleFFT の参照強度・MTF・スルーフォーカス指標・Strehl
+ *   - ガラスカタログのテーブル（packGlassTableForWasm）と getCorrectRefractiveIndex の屈折率
+ *   - Zernike フィットの点群と fitZernikeWeighted の係数、LM の J / r と lm-linalg.js の解
+ * 光線・OPD は決まった式で生成し乱数は使わない。計測値以外の出力は毎回同一。
+ *
+ * 計測項目（throughput の単位は unit）:
+ *   trace_system_rt10 / trace_bundle_rt10 / trace_bundle_rt10_f32: レンズ × 1k/10k/100k 光線（rays/s）
+ *   trace_spot_rt10: レンズ × 1k/10k/100k 光線の輪帯スポット統計（光線生成 + 像面まで + Welford, rays/s）
+ *   intersect_aspheric_rt10: 偶数次非球面 1 面（rays/s）
+ *   fft_2d / interpolate_opd_grid / calculate_psf_grid_wasm / calculate_psf_grid_f32_wasm /
+ *   calculate_psf_wasm: 格子 64..1024（pixels/s, PSF は psfs_per_s と ns_per_pixel も出力）
+ *   calculate_mtf_batch_wasm: 格子 64..1024, 1 視野 × デフォーカス 3 点の M/S スライス（pixels/s）
+ *   calculate_psf_focus_stack_wasm: 格子 64..1024, 41 スライスの指標のみ（pixels/s）
+ *   calculate_strehl_pupil_wasm(_refine): 格子 64..1024（pixels/s）
+ *   zernike_fit_wasm: 10k/100k 点, 8 次（points/s）
+ *   rt10_resolve_indices: ガラスカタログ全体 × 5 波長（indices/s）
+ *   lm_normal_equations_wasm / lm_damped_solve_wasm: 500×16 .. 4000×64（madds/s, solves/s）
+ * 精度チェック（accuracy）: 計測する全カーネルを JS 版と比較する。
+ *   光線追跡（system / bundle / bundle_f32）は参照光線の通過点数・最終点、PSF はピーク正規化強度、
+ *   MTF は |OTF| / |OTF(0)|、スルーフォーカスは peak・Strehl・EE80、Strehl は基準点とピーク（位置も）、
+ *   屈折率・Zernike 係数・正規方程式・減衰付き解は値そのもの。
+ *
+ * 使い方: kernel-bench <fixtures.txt> [--quick] [--threads N] [--target-ms T]
+ *   --quick は格子 256・光線 10k までに絞る。スレッド数の既定は 1（pthreads 版でも再現性優先）。
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// psf-wasm.c / ray-tracing-wasm.c のエクスポート（ヘッダは無いのでここで宣言する）
+typedef struct {
+    double real;
+    double imag;
+} Complex;
+
+double get_time_ms();
+void fft_2d(Complex* data, int width, int height, int inverse);
+void interpolate_opd_grid(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
+                          double* grid_opd, int* pupil_mask, int grid_size,
+                          double min_x, double max_x, double min_y, double max_y,
+                          int interp_mode);
+double* calculate_psf_wasm(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
+                           int grid_size, double wavelength,
+                           double min_x, double max_x, double min_y, double max_y,
+                           int interp_mode);
+double* calculate_psf_grid_wasm(double* grid_opd, double* amplitude, int* pupil_mask,
+                                int grid_size, double wavelength,
+                                int out_size, double pad_factor, double center_row, double center_col);
+double* calculate_psf_grid_f32_wasm(const float* grid_opd, const float* amplitude, const int* pupil_mask,
+                                    int grid_size, double wavelength);
+void free_psf_result(double* psf);
+int calculate_mtf_batch_wasm(const double* opd_stack, const double* amp_stack, const int* mask_stack,
+                             int grid_size, int field_count, double wavelength,
+                             const double* defocus, int defocus_count, double pupil_radius,
+                             const double* angles, int angle_count, const double* freqs, int freq_count,
+                             double* out);
+int calculate_psf_focus_stack_wasm(const double* grid_opd, const double* amplitude, const int* pupil_mask,
+                                   int grid_size, double wavelength, const double* focus, int count,
+                                   int mode, double na, double pupil_radius,
+                                   double* stack_out, double* metrics_out);
+int calculate_strehl_pupil_wasm(const double* grid_opd, const double* amplitude, const int* pupil_mask,
+                                int grid_size, double wavelength, int refine, double* out);
+int psf_set_thread_count(int threads);
+int zernike_fit_wasm(const double* x, const double* y, const double* opd, const double* weight, int count,
+                     int max_order, double epsilon, int flags, double* coeffs_out, double* stats_out);
+int lm_normal_equations_wasm(const double* jac, const double* r, int m, int n, double* ata, double* atr);
+int lm_damped_solve_wasm(const double* ata, const double* b, int n, double lambda, double* work, double* x);
+
+double intersect_aspheric_rt10(double ox, double oy, double oz, double dx, double dy, double dz,
+                               double semidia, double radius, double conic,
+                               double coef1, double coef2, double coef3, double coef4, double coef5,
+                               double coef6, double coef7, double coef8, double coef9, double coef10,
+                               int modeOdd, int maxIter, double tol);
+int trace_system_rt10(const double* surfaces, int surface_count, const double* rays_in, int ray_count,
+                      int wavelength_slot, double n0, int stop_surface, int flags,
+                      double* rays_out, int* status_out, double* hits_out);
+int bundle_init_rt10(double* bundle, int capacity, int count);
+int trace_bundle_rt10(const double* surfaces, int surface_count, double* bundle, int capacity, int count,
+                      int wavelength_slot, double n0, int stop_surface, int flags, double* hits_out);
+int bundle_init_rt10_f32(float* bundle, int capacity, int count);
+int trace_bundle_rt10_f32(const double* surfaces, int surface_count, float* bundle, int capacity, int count,
+                          int wavelength_slot, double n0, int stop_surface, int flags, float* hits_out);
+int trace_spot_rt10(const double* surfaces, int surface_count, int target_surface,
+                    const double* params, const double* rays_in, int begin, int end,
+                    int wavelength_slot, double n0,
+                    double* state, double* points_out, double* stats_out);
+int rt10_glass_load(const double* table, int glass_count);
+int rt10_resolve_indices(double* surfaces, int surface_count, const double* wavelengths, int wavelength_count);
+int rt10_set_thread_count(int threads);
+
+#define BENCH_SURF_STRIDE   40   // RT10_SURF_STRIDE
+#define BENCH_SURF_INDEX    31   // RT10_SURF_INDEX（波長スロットごとの屈折率）
+#define BENCH_SURF_GLASS    39   // RT10_SURF_GLASS（ガラス ID + 1）
+#define BENCH_GLASS_STRIDE  8    // RT10_GLASS_STRIDE
+#define BENCH_MAX_WL        8    // RT10_MAX_WAVELENGTHS
+#define BENCH_BUNDLE_FIELDS 9    // RT10_BUNDLE_FIELDS
+#define BENCH_BUNDLE_STATUS 8    // RT10_BUNDLE_STATUS
+#define BENCH_MAX_LENSES    16
+#define BENCH_MAX_FIELDS    8
+#define BENCH_MAX_DEFOCUS   8
+#define BENCH_MAX_FREQS     513
+#define BENCH_MAX_LAMBDAS   8
+#define BENCH_GOLDEN_ANGLE  2.399963229728653
+
+// 精度チェックの許容値
+#define BENCH_TRACE_TOL     1e-6   // 参照光線の最終点 [mm]
+#define BENCH_TRACE_F32_TOL 1e-3   // 同（float32 プレビュー版, 1 µm）
+#define BENCH_PSF_TOL       1e-9   // ピーク正規化 PSF の最大差
+#define BENCH_MTF_TOL       1e-9   // MTF（|OTF| / |OTF(0)|）の最大差
+#define BENCH_FOCUS_TOL     1e-9   // スルーフォーカスの peak（相対）・Strehl・EE80 [px]
+#define BENCH_STREHL_TOL    1e-9   // 基準点・ピーク Strehl
+#define BENCH_STREHL_POS_TOL 1e-4  // ピーク位置 [px]（参照は 1e-6 bin 刻みの格子探索）
+#define BENCH_GLASS_TOL     1e-12  // 屈折率
+#define BENCH_ZERNIKE_TOL   1e-9   // Zernike 係数・残差 rms / pv [µm]
+#define BENCH_LM_TOL        1e-9   // 正規方程式・減衰付き解（max(1, |参照|) に対する相対差）
+
+typedef struct {
+    char name[96];
+    int surface_count;
+    double pupil_radius;
+    double* surfaces;
+    int ref_count;
+    int* ref_points;      // JS rayPath の点数（0 = null）
+    double* ref_final;    // 最終点 x,y,z
+} bench_lens;
+
+typedef struct {
+    int field_count;
+    double fields_deg[BENCH_MAX_FIELDS];
+    int lens_count;
+    bench_lens lenses[BENCH_MAX_LENSES];
+    int psf_size;
+    double psf_wavelength;
+    double* psf_opd;
+    int* psf_mask;
+    double* psf_ref;
+    // ガラス: テーブル [glass][BENCH_GLASS_STRIDE] と屈折率 [glass][wl]
+    int glass_count;
+    int glass_wl_count;
+    double glass_wl[BENCH_MAX_WL];
+    double* glass_table;
+    double* glass_ref;
+    // MTF（PSF の瞳）: [defocus][tan, sag][freq]
+    int mtf_defocus_count;
+    int mtf_freq_count;
+    double mtf_defocus[BENCH_MAX_DEFOCUS];
+    double* mtf_ref;
+    // スルーフォーカス（PSF の瞳, W020）: [slice][focus, peak, strehl, ee80]
+    int focus_count;
+    double* focus_ref;
+    // Strehl（PSF の瞳）: 基準点, ピーク, ピーク row / col, (ΣA)²
+    int has_strehl;
+    double strehl_ref[5];
+    // Zernike: 点群と係数, 残差 rms / pv
+    int zern_count;
+    int zern_order;
+    int zern_flags;
+    int zern_terms;
+    double* zern_points;  // x, y, opd, weight（各 zern_count）
+    double* zern_ref;
+    double zern_stats[2];
+    // LM: J（列優先）, r, A, g, 各 λ の解
+    int lm_m;
+    int lm_n;
+    int lm_lambda_count;
+    double lm_lambdas[BENCH_MAX_LAMBDAS];
+    double* lm_jac;
+    double* lm_r;
+    double* lm_ata;
+    double* lm_atr;
+    double* lm_x;
+} bench_fixtures;
+
+typedef struct {
+    int quick;
+    int threads;
+    double target_ms;
+    int first;        // JSON の区切り
+} bench_ctx;
+
+// --- フィクスチャ読み込み ---
+
+static int read_token(FILE* f, char* buf, size_t cap) {
+    return fscanf(f, "%95s", buf) == 1 && cap > 0;
+}
+
+static int read_doubles(FILE* f, double* out, int n) {
+    char tok[96];
+    for (int i = 0; i < n; i++) {
+        if (!read_token(f, tok, sizeof(tok))) return -1;
+        out[i] = strtod(tok, NULL);  // "nan" も受け付ける
+    }
+    return 0;
+}
+
+static int load_fixtures(const char* path, bench_fixtures* fx) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    memset(fx, 0, sizeof(*fx));
+    char tok[96];
+    int rc = -1;
+    if (!read_token(f, tok, sizeof(tok)) || strcmp(tok, "COOPT-BENCH") != 0) goto done;
+    // 版 2 から全カーネルの参照を含む（古いフィクスチャは作り直す）
+    if (!read_token(f, tok, sizeof(tok)) || atoi(tok) < 2) goto done;
+
+    while (read_token(f, tok, sizeof(tok))) {
+        if (strcmp(tok, "END") == 0) { rc = 0; break; }
+        if (strcmp(tok, "FIELDS") == 0) {
+            if (fscanf(f, "%d", &fx->field_count) != 1 || fx->field_count <= 0 || fx->field_count > BENCH_MAX_FIELDS) goto done;
+            if (read_doubles(f, fx->fields_deg, fx->field_count) != 0) goto done;
+        } else if (strcmp(tok, "LENS") == 0) {
+            if (fx->lens_count >= BENCH_MAX_LENSES) goto done;
+            bench_lens* L = &fx->lenses[fx->lens_count];
+            if (fscanf(f, "%95s %d %lf %d", L->name, &L->surface_count, &L->pupil_radius, &L->ref_count) != 4) goto done;
+            if (L->surface_count <= 0 || L->ref_count < 0) goto done;
+            L->surfaces = (double*)malloc(sizeof(double) * (size_t)L->surface_count * BENCH_SURF_STRIDE);
+            L->ref_points = (int*)malloc(sizeof(int) * (size_t)(L->ref_count + 1));
+            L->ref_final = (double*)malloc(sizeof(double) * 3 * (size_t)(L->ref_count + 1));
+            if (!L->surfaces || !L->ref_points || !L->ref_final) goto done;
+            if (read_doubles(f, L->surfaces, L->surface_count * BENCH_SURF_STRIDE) != 0) goto done;
+            for (int i = 0; i < L->ref_count; i++) {
+                if (fscanf(f, "%d", &L->ref_points[i]) != 1) goto done;
+                if (read_doubles(f, L->ref_final + 3 * i, 3) != 0) goto done;
+            }
+            fx->lens_count++;
+        } else if (strcmp(tok, "PSF") == 0) {
+            if (fscanf(f, "%d %lf", &fx->psf_size, &fx->psf_wavelength) != 2 || fx->psf_size <= 0) goto done;
+            const int n2 = fx->psf_size * fx->psf_size;
+            fx->psf_opd = (double*)malloc(sizeof(double) * n2);
+            fx->psf_mask = (int*)malloc(sizeof(int) * n2);
+            fx->psf_ref = (double*)malloc(sizeof(double) * n2);
+            if (!fx->psf_opd || !fx->psf_mask || !fx->psf_ref) goto done;
+            if (read_doubles(f, fx->psf_opd, n2) != 0) goto done;
+            for (int i = 0; i < n2; i++) {
+                if (fscanf(f, "%d", &fx->psf_mask[i]) != 1) goto done;
+            }
+            if (read_doubles(f, fx->psf_ref, n2) != 0) goto done;
+        } else if (strcmp(tok, "GLASS") == 0) {
+            if (fscanf(f, "%d %d", &fx->glass_count, &fx->glass_wl_count) != 2 || fx->glass_count <= 0 ||
+                fx->glass_wl_count <= 0 || fx->glass_wl_count > BENCH_MAX_WL) goto done;
+            if (read_doubles(f, fx->glass_wl, fx->glass_wl_count) != 0) goto done;
+            fx->glass_table = (double*)malloc(sizeof(double) * (size_t)fx->glass_count * BENCH_GLASS_STRIDE);
+            fx->glass_ref = (double*)malloc(sizeof(double) * (size_t)fx->glass_count * fx->glass_wl_count);
+            if (!fx->glass_table || !fx->glass_ref) goto done;
+            if (read_doubles(f, fx->glass_table, fx->glass_count * BENCH_GLASS_STRIDE) != 0) goto done;
+            if (read_doubles(f, fx->glass_ref, fx->glass_count * fx->glass_wl_count) != 0) goto done;
+        } else if (strcmp(tok, "MTF") == 0) {
+            if (fscanf(f, "%d %d", &fx->mtf_defocus_count, &fx->mtf_freq_count) != 2 ||
+                fx->mtf_defocus_count <= 0 || fx->mtf_defocus_count > BENCH_MAX_DEFOCUS ||
+                fx->mtf_freq_count <= 0 || fx->mtf_freq_count > BENCH_MAX_FREQS) goto done;
+            if (read_doubles(f, fx->mtf_defocus, fx->mtf_defocus_count) != 0) goto done;
+            const int total = fx->mtf_defocus_count * 2 * fx->mtf_freq_count;
+            fx->mtf_ref = (double*)malloc(sizeof(double) * total);
+            if (!fx->mtf_ref || read_doubles(f, fx->mtf_ref, total) != 0) goto done;
+        } else if (strcmp(tok, "FOCUS") == 0) {
+            if (fscanf(f, "%d", &fx->focus_count) != 1 || fx->focus_count <= 0) goto done;
+            fx->focus_ref = (double*)malloc(sizeof(double) * 4 * (size_t)fx->focus_count);
+            if (!fx->focus_ref || read_doubles(f, fx->focus_ref, 4 * fx->focus_count) != 0) goto done;
+        } else if (strcmp(tok, "STREHL") == 0) {
+            if (read_doubles(f, fx->strehl_ref, 5) != 0) goto done;
+            fx->has_strehl = 1;
+        } else if (strcmp(tok, "ZERNIKE") == 0) {
+            if (fscanf(f, "%d %d %d %d", &fx->zern_count, &fx->zern_order, &fx->zern_flags, &fx->zern_terms) != 4 ||
+                fx->zern_count <= 0 || fx->zern_order < 0 ||
+                fx->zern_terms != (fx->zern_order + 1) * (fx->zern_order + 2) / 2) goto done;
+            fx->zern_points = (double*)malloc(sizeof(double) * 4 * (size_t)fx->zern_count);
+            fx->zern_ref = (double*)malloc(sizeof(double) * (size_t)fx->zern_terms);
+            if (!fx->zern_points || !fx->zern_ref) goto done;
+            if (read_doubles(f, fx->zern_points, 4 * fx->zern_count) != 0) goto done;
+            if (read_doubles(f, fx->zern_ref, fx->zern_terms) != 0) goto done;
+            if (read_doubles(f, fx->zern_stats, 2) != 0) goto done;
+        } else if (strcmp(tok, "LM") == 0) {
+            if (fscanf(f, "%d %d %d", &fx->lm_m, &fx->lm_n, &fx->lm_lambda_count) != 3 || fx->lm_m <= 0 ||
+                fx->lm_n <= 0 || fx->lm_lambda_count <= 0 || fx->lm_lambda_count > BENCH_MAX_LAMBDAS) goto done;
+            if (read_doubles(f, fx->lm_lambdas, fx->lm_lambda_count) != 0) goto done;
+            const int m = fx->lm_m, n = fx->lm_n;
+            fx->lm_jac = (double*)malloc(sizeof(double) * (size_t)m * n);
+            fx->lm_r = (double*)malloc(sizeof(double) * m);
+            fx->lm_ata = (double*)malloc(sizeof(double) * (size_t)n * n);
+            fx->lm_atr = (double*)malloc(sizeof(double) * n);
+            fx->lm_x = (double*)malloc(sizeof(double) * (size_t)fx->lm_lambda_count * n);
+            if (!fx->lm_jac || !fx->lm_r || !fx->lm_ata || !fx->lm_atr || !fx->lm_x) goto done;
+            if (read_doubles(f, fx->lm_jac, m * n) != 0 || read_doubles(f, fx->lm_r, m) != 0 ||
+                read_doubles(f, fx->lm_ata, n * n) != 0 || read_doubles(f, fx->lm_atr, n) != 0 ||
+                read_doubles(f, fx->lm_x, fx->lm_lambda_count * n) != 0) goto done;
+        } else {
+            goto done;
+        }
+    }
+done:
+    fclose(f);
+    // 参照のそろっていないフィクスチャは使わない（PSF の瞳を MTF / スルーフォーカス / Strehl でも使う）
+    const int complete = fx->psf_size > 0 && fx->glass_count > 0 && fx->mtf_defocus_count > 0 &&
+                         fx->focus_count > 0 && fx->has_strehl && fx->zern_count > 0 && fx->lm_m > 0;
+    return (rc == 0 && fx->field_count > 0 && complete) ? 0 : -1;
+}
+
+// --- 決まった入力の生成 ---
+
+// performance/kernel-benchmark.mjs の benchRay と同じ式
+static void bench_make_ray(const bench_fixtures* fx, int i, int count, double pupil_radius, double* ray) {
+    const int F = fx->field_count;
+    const int j = i / F;
+    const int m = (count + F - 1) / F > 0 ? (count + F - 1) / F : 1;
+    const double r = pupil_radius * sqrt((j + 0.5) / m);
+    const double phi = j * BENCH_GOLDEN_ANGLE;
+    const double a = fx->fields_deg[i % F] * M_PI / 180.0;
+    ray[0] = r * cos(phi);
+    ray[1] = r * sin(phi);
+    ray[2] = 0.0;
+    ray[3] = 0.0;
+    ray[4] = sin(a);
+    ray[5] = cos(a);
+}
+
+// 格子 PSF 用: 円形瞳（正規化座標）の OPD（フィクスチャの参照と同じ収差）
+static double bench_opd(double x, double y) {
+    const double r2 = x * x + y * y;
+    return 0.25 * (2 * r2 - 1) + 0.15 * (3 * r2 - 2) * y + 0.1 * (x * x - y * y);
+}
+
+static void bench_make_grid(int n, double* opd, double* amp, int* mask) {
+    for (int i = 0; i < n; i++) {
+        const double y = (i - (n - 1) / 2.0) / ((n - 1) / 2.0);
+        for (int j = 0; j < n; j++) {
+            const double x = (j - (n - 1) / 2.0) / ((n - 1) / 2.0);
+            const int in = (x * x + y * y) <= 1.0;
+            opd[i * n + j] = in ? bench_opd(x, y) : 0.0;
+            amp[i * n + j] = in ? 1.0 : 0.0;
+            mask[i * n + j] = in;
+        }
+    }
+}
+
+// --- 計時 ---
+
+typedef struct {
+    double best_ms;
+    double median_ms;
+    int reps;
+} bench_time;
+
+static int cmp_double(const void* a, const void* b) {
+    const double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+typedef void (*bench_fn)(void* arg);
+
+// 1 回の予備実行のあと、合計が target_ms 以上になるまで（3..200 回）繰り返す
+static bench_time bench_run(const bench_ctx* ctx, bench_fn fn, void* arg) {
+    enum { MAX_REPS = 200 };
+    double samples[MAX_REPS];
+    double t0 = get_time_ms();
+    fn(arg);
+    const double first = get_time_ms() - t0;
+    int reps = first > 0.0 ? (int)ceil(ctx->target_ms / first) : MAX_REPS;
+    if (reps < 3) reps = 3;
+    if (reps > MAX_REPS) reps = MAX_REPS;
+    for (int r = 0; r < reps; r++) {
+        t0 = get_time_ms();
+        fn(arg);
+        samples[r] = get_time_ms() - t0;
+    }
+    qsort(samples, reps, sizeof(double), cmp_double);
+    bench_time t = { samples[0], samples[reps / 2], reps };
+    return t;
+}
+
+static void emit_result(bench_ctx* ctx, const char* name, const char* lens, int size, int rays,
+                        const bench_time* t, double work_units, const char* unit, double pixels) {
+    printf("%s\n    {\"name\": \"%s\"", ctx->first ? "" : ",", name);
+    ctx->first = 0;
+    if (lens) printf(", \"lens\": \"%s\"", lens);
+    if (size > 0) printf(", \"size\": %d", size);
+    if (rays > 0) printf(", \"rays\": %d", rays);
+    printf(", \"best_ms\": %.6f, \"median_ms\": %.6f, \"reps\": %d", t->best_ms, t->median_ms, t->reps);
+    printf(", \"throughput\": %.6e, \"unit\": \"%s\"", t->best_ms > 0.0 ? work_units / (t->best_ms * 1e-3) : 0.0, unit);
+    if (pixels > 0.0) {
+        printf(", \"psfs_per_s\": %.6e, \"ns_per_pixel\": %.6f",
+               t->best_ms > 0.0 ? 1e3 / t->best_ms : 0.0, t->best_ms * 1e6 / pixels);
+    }
+    printf("}");
+}
+
+// --- 光線追跡 ---
+
+typedef struct {
+    const bench_lens* lens;
+    int count;
+    int capacity;
+    const double* rays;
+    double* rays_out;
+    int* status;
+    double* bundle;
+    float* bundle_f32;
+} trace_arg;
+
+static void run_trace_system(void* p) {
+    trace_arg* a = (trace_arg*)p;
+    trace_system_rt10(a->lens->surfaces, a->lens->surface_count, a->rays, a->count, 0, 1.0, -1, 0,
+                      a->rays_out, a->status, NULL);
+}
+
+static void run_trace_bundle(void* p) {
+    trace_arg* a = (trace_arg*)p;
+    const int cap = a->capacity;
+    for (int i = 0; i < a->count; i++) {
+        for (int c = 0; c < 6; c++) a->bundle[c * cap + i] = a->rays[i * 6 + c];
+    }
+    bundle_init_rt10(a->bundle, cap, a->count);
+    trace_bundle_rt10(a->lens->surfaces, a->lens->surface_count, a->bundle, cap, a->count, 0, 1.0, -1, 0, NULL);
+}
+
+static void run_trace_bundle_f32(void* p) {
+    trace_arg* a = (trace_arg*)p;
+    const int cap = a->capacity;
+    for (int i = 0; i < a->count; i++) {
+        for (int c = 0; c < 6; c++) a->bundle_f32[c * cap + i] = (float)a->rays[i * 6 + c];
+    }
+    bundle_init_rt10_f32(a->bundle_f32, cap, a->count);
+    trace_bundle_rt10_f32(a->lens->surfaces, a->lens->surface_count, a->bundle_f32, cap, a->count, 0, 1.0, -1, 0, NULL);
+}
+
+static void bench_traces(bench_ctx* ctx, const bench_fixtures* fx) {
+    static const int counts[] = { 1000, 10000, 100000 };
+    const int n_counts = ctx->quick ? 2 : 3;
+    const int max_count = counts[n_counts - 1];
+    const int cap = (max_count + 3) & ~3;
+    double* rays = (double*)malloc(sizeof(double) * 6 * (size_t)max_count);
+    double* rays_out = (double*)malloc(sizeof(double) * 7 * (size_t)max_count);
+    int* status = (int*)malloc(sizeof(int) * (size_t)max_count);
+    double* bundle = (double*)malloc(sizeof(double) * BENCH_BUNDLE_FIELDS * (size_t)cap);
+    float* bundle_f32 = (float*)malloc(sizeof(float) * BENCH_BUNDLE_FIELDS * (size_t)cap);
+    if (!rays || !rays_out || !status || !bundle || !bundle_f32) goto done;
+
+    for (int l = 0; l < fx->lens_count; l++) {
+        const bench_lens* L = &fx->lenses[l];
+        for (int c = 0; c < n_counts; c++) {
+            const int count = counts[c];
+            for (int i = 0; i < count; i++) bench_make_ray(fx, i, count, L->pupil_radius, rays + 6 * i);
+            trace_arg a = { L, count, (count + 3) & ~3, rays, rays_out, status, bundle, bundle_f32 };
+            bench_time t = bench_run(ctx, run_trace_system, &a);
+            emit_result(ctx, "trace_system_rt10", L->name, 0, count, &t, count, "rays/s", 0.0);
+            t = bench_run(ctx, run_trace_bundle, &a);
+            emit_result(ctx, "trace_bundle_rt10", L->name, 0, count, &t, count, "rays/s", 0.0);
+            t = bench_run(ctx, run_trace_bundle_f32, &a);
+            emit_result(ctx, "trace_bundle_rt10_f32", L->name, 0, count, &t, count, "rays/s", 0.0);
+        }
+    }
+done:
+    free(rays); free(rays_out); free(status); free(bundle); free(bundle_f32);
+}
+
+// ray-tracing-wasm.c の RT10_SPOT_*（統計のみ・10 輪帯・光軸上の平行光）
+#define BENCH_SPOT_PARAMS 28
+#define BENCH_SPOT_STATE  15
+#define BENCH_SPOT_STATS  16
+
+typedef struct {
+    const bench_lens* lens;
+    double params[BENCH_SPOT_PARAMS];
+    double state[BENCH_SPOT_STATE];
+    double stats[BENCH_SPOT_STATS];
+    int count;
+} spot_arg;
+
+static void run_trace_spot(void* p) {
+    spot_arg* a = (spot_arg*)p;
+    trace_spot_rt10(a->lens->surfaces, a->lens->surface_count, a->lens->surface_count - 1, a->params, NULL,
+                    0, a->count, 0, 1.0, a->state, NULL, a->stats);
+}
+
+static void bench_spot(bench_ctx* ctx, const bench_fixtures* fx) {
+    static const int counts[] = { 1000, 10000, 100000 };
+    const int n_counts = ctx->quick ? 2 : 3;
+    for (int l = 0; l < fx->lens_count; l++) {
+        const bench_lens* L = &fx->lenses[l];
+        for (int c = 0; c < n_counts; c++) {
+            spot_arg a;
+            memset(&a, 0, sizeof(a));
+            a.lens = L;
+            a.count = counts[c];
+            a.params[1] = counts[c];      // RAY_COUNT
+            a.params[2] = 10;             // RINGS
+            a.params[3] = L->pupil_radius; // HALF_EXTENT
+            a.params[7] = 1.0;            // START_U = x
+            a.params[11] = 1.0;           // START_V = y
+            a.params[15] = 1.0;           // DIR = z
+            bench_time t = bench_run(ctx, run_trace_spot, &a);
+            emit_result(ctx, "trace_spot_rt10", L->name, 0, counts[c], &t, counts[c], "rays/s", 0.0);
+        }
+    }
+}
+
+typedef struct {
+    int count;
+    const double* rays;
+    double sink;
+} intersect_arg;
+
+static void run_intersect(void* p) {
+    intersect_arg* a = (intersect_arg*)p;
+    double acc = 0.0;
+    for (int i = 0; i < a->count; i++) {
+        const double* r = a->rays + 6 * i;
+        // R = 40 mm, K = -0.8, 4/6/8 次の偶数次非球面（交点は主に Newton で求まる）
+        const double t = intersect_aspheric_rt10(r[0], r[1], -2.0, r[3], r[4], r[5], 15.0, 40.0, -0.8,
+                                                 0.0, 2e-5, 0.0, -3e-8, 0.0, 5e-11, 0.0, 0.0, 0.0, 0.0,
+                                                 0, 20, 1e-9);
+        acc += t;
+    }
+    a->sink = acc;
+}
+
+static void bench_intersect(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int count = ctx->quick ? 10000 : 100000;
+    double* rays = (double*)malloc(sizeof(double) * 6 * (size_t)count);
+    if (!rays) return;
+    for (int i = 0; i < count; i++) bench_make_ray(fx, i, count, 12.0, rays + 6 * i);
+    intersect_arg a = { count, rays, 0.0 };
+    bench_time t = bench_run(ctx, run_intersect, &a);
+    emit_result(ctx, "intersect_aspheric_rt10", NULL, 0, count, &t, count, "rays/s", 0.0);
+    free(rays);
+}
+
+// --- PSF パイプライン ---
+
+typedef struct {
+    int n;
+    double* opd;
+    double* amp;
+    int* mask;
+    float* opd_f32;
+    float* amp_f32;
+    Complex* data;
+    double* ray_x;
+    double* ray_y;
+    double* ray_opd;
+    int ray_count;
+} psf_arg;
+
+static void run_fft(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    const int n2 = a->n * a->n;
+    for (int i = 0; i < n2; i++) {
+        a->data[i].real = a->amp[i];
+        a->data[i].imag = 0.0;
+    }
+    fft_2d(a->data, a->n, a->n, 0);
+}
+
+static void run_interp(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    interpolate_opd_grid(a->ray_x, a->ray_y, a->ray_opd, a->ray_count, a->opd, a->mask, a->n,
+                         -1.0, 1.0, -1.0, 1.0, 1);
+}
+
+static void run_psf_grid(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    free_psf_result(calculate_psf_grid_wasm(a->opd, a->amp, a->mask, a->n, 0.5875618, 0, 0.0, 0.0, 0.0));
+}
+
+static void run_psf_grid_f32(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    free_psf_result(calculate_psf_grid_f32_wasm(a->opd_f32, a->amp_f32, a->mask, a->n, 0.5875618));
+}
+
+static void run_psf_rays(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    free_psf_result(calculate_psf_wasm(a->ray_x, a->ray_y, a->ray_opd, a->ray_count, a->n, 0.5875618,
+                                       -1.0, 1.0, -1.0, 1.0, 1));
+}
+
+#define BENCH_MTF_DEFOCUS 3
+
+static void run_mtf(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    static const double defocus[BENCH_MTF_DEFOCUS] = { -0.25, 0.0, 0.25 };
+    static const double angles[2] = { 0.0, 1.5707963267948966 };
+    double freqs[513];
+    double out[BENCH_MTF_DEFOCUS * 2 * 513];
+    const int freq_count = a->n / 2 + 1;
+    for (int f = 0; f < freq_count; f++) freqs[f] = f;
+    calculate_mtf_batch_wasm(a->opd, a->amp, a->mask, a->n, 1, 0.5875618, defocus, BENCH_MTF_DEFOCUS, 0.0,
+                             angles, 2, freqs, freq_count, out);
+}
+
+#define BENCH_FOCUS_SLICES 41
+
+static void run_focus_stack(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    double focus[BENCH_FOCUS_SLICES];
+    double metrics[BENCH_FOCUS_SLICES * 3];
+    for (int s = 0; s < BENCH_FOCUS_SLICES; s++) focus[s] = 0.05 * (s - BENCH_FOCUS_SLICES / 2);
+    calculate_psf_focus_stack_wasm(a->opd, a->amp, a->mask, a->n, 0.5875618, focus, BENCH_FOCUS_SLICES,
+                                   0, 0.0, 0.0, NULL, metrics);
+}
+
+static void run_strehl_pupil(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    double out[5];
+    calculate_strehl_pupil_wasm(a->opd, a->amp, a->mask, a->n, 0.5875618, 0, out);
+}
+
+static void run_strehl_pupil_refine(void* p) {
+    psf_arg* a = (psf_arg*)p;
+    double out[5];
+    calculate_strehl_pupil_wasm(a->opd, a->amp, a->mask, a->n, 0.5875618, 1, out);
+}
+
+static void bench_psf(bench_ctx* ctx) {
+    const int max_n = ctx->quick ? 256 : 1024;
+    const int ray_count = ctx->quick ? 10000 : 100000;
+    psf_arg a;
+    memset(&a, 0, sizeof(a));
+    const size_t n2max = (size_t)max_n * max_n;
+    a.opd = (double*)malloc(sizeof(double) * n2max);
+    a.amp = (double*)malloc(sizeof(double) * n2max);
+    a.mask = (int*)malloc(sizeof(int) * n2max);
+    a.opd_f32 = (float*)malloc(sizeof(float) * n2max);
+    a.amp_f32 = (float*)malloc(sizeof(float) * n2max);
+    a.data = (Complex*)malloc(sizeof(Complex) * n2max);
+    a.ray_x = (double*)malloc(sizeof(double) * ray_count);
+    a.ray_y = (double*)malloc(sizeof(double) * ray_count);
+    a.ray_opd = (double*)malloc(sizeof(double) * ray_count);
+    if (!a.opd || !a.amp || !a.mask || !a.opd_f32 || !a.amp_f32 || !a.data || !a.ray_x || !a.ray_y || !a.ray_opd) goto done;
+
+    // 瞳内の光線（Vogel 螺旋, 正規化座標）
+    a.ray_count = ray_count;
+    for (int i = 0; i < ray_count; i++) {
+        const double r = sqrt((i + 0.5) / ray_count);
+        const double phi = i * BENCH_GOLDEN_ANGLE;
+        a.ray_x[i] = r * cos(phi);
+        a.ray_y[i] = r * sin(phi);
+        a.ray_opd[i] = bench_opd(a.ray_x[i], a.ray_y[i]);
+    }
+
+    for (int n = 64; n <= max_n; n *= 2) {
+        const double pixels = (double)n * n;
+        a.n = n;
+        bench_make_grid(n, a.opd, a.amp, a.mask);
+        for (int i = 0; i < n * n; i++) {
+            a.opd_f32[i] = (float)a.opd[i];
+            a.amp_f32[i] = (float)a.amp[i];
+        }
+        bench_time t = bench_run(ctx, run_fft, &a);
+        emit_result(ctx, "fft_2d", NULL, n, 0, &t, pixels, "pixels/s", 0.0);
+        t = bench_run(ctx, run_psf_grid, &a);
+        emit_result(ctx, "calculate_psf_grid_wasm", NULL, n, 0, &t, pixels, "pixels/s", pixels);
+        t = bench_run(ctx, run_psf_grid_f32, &a);
+        emit_result(ctx, "calculate_psf_grid_f32_wasm", NULL, n, 0, &t, pixels, "pixels/s", pixels);
+        t = bench_run(ctx, run_psf_rays, &a);
+        emit_result(ctx, "calculate_psf_wasm", NULL, n, ray_count, &t, pixels, "pixels/s", pixels);
+        t = bench_run(ctx, run_mtf, &a);
+        emit_result(ctx, "calculate_mtf_batch_wasm", NULL, n, 0, &t, pixels * BENCH_MTF_DEFOCUS, "pixels/s", 0.0);
+        t = bench_run(ctx, run_focus_stack, &a);
+        emit_result(ctx, "calculate_psf_focus_stack_wasm", NULL, n, 0, &t, pixels * BENCH_FOCUS_SLICES, "pixels/s", 0.0);
+        t = bench_run(ctx, run_strehl_pupil, &a);
+        emit_result(ctx, "calculate_strehl_pupil_wasm", NULL, n, 0, &t, pixels, "pixels/s", 0.0);
+        t = bench_run(ctx, run_strehl_pupil_refine, &a);
+        emit_result(ctx, "calculate_strehl_pupil_wasm_refine", NULL, n, 0, &t, pixels, "pixels/s", 0.0);
+        t = bench_run(ctx, run_interp, &a);
+        emit_result(ctx, "interpolate_opd_grid", NULL, n, ray_count, &t, pixels, "pixels/s", 0.0);
+        // 補間で opd / mask を上書きしたので次のサイズで作り直す
+    }
+done:
+    free(a.opd); free(a.amp); free(a.mask); free(a.opd_f32); free(a.amp_f32); free(a.data);
+    free(a.ray_x); free(a.ray_y); free(a.ray_opd);
+}
+
+// --- LM 線形代数 ---
+
+typedef struct {
+    int m;
+    int n;
+    double* jac;
+    double* r;
+    double* ata;
+    double* atr;
+    double* b;
+    double* work;
+    double* x;
+} lm_arg;
+
+static void run_lm_normal(void* p) {
+    lm_arg* a = (lm_arg*)p;
+    lm_normal_equations_wasm(a->jac, a->r, a->m, a->n, a->ata, a->atr);
+}
+
+// λ を 4 回変えて解き直す（最適化で解が得られないときの再試行と同じ使い方）
+static void run_lm_solve(void* p) {
+    lm_arg* a = (lm_arg*)p;
+    double lambda = 1e-3;
+    for (int k = 0; k < 4; k++, lambda *= 10.0) lm_damped_solve_wasm(a->ata, a->b, a->n, lambda, a->work, a->x);
+}
+
+static void bench_lm(bench_ctx* ctx) {
+    static const int shapes[][2] = { { 500, 16 }, { 2000, 32 }, { 4000, 64 } };
+    const int count = ctx->quick ? 2 : 3;
+    for (int s = 0; s < count; s++) {
+        lm_arg a;
+        a.m = shapes[s][0];
+        a.n = shapes[s][1];
+        const size_t mn = (size_t)a.m * a.n, nn = (size_t)a.n * a.n;
+        a.jac = (double*)malloc(sizeof(double) * mn);
+        a.r = (double*)malloc(sizeof(double) * a.m);
+        a.ata = (double*)malloc(sizeof(double) * nn);
+        a.atr = (double*)malloc(sizeof(double) * a.n);
+        a.b = (double*)malloc(sizeof(double) * a.n);
+        a.work = (double*)malloc(sizeof(double) * (nn + a.n));
+        a.x = (double*)malloc(sizeof(double) * a.n);
+        if (a.jac && a.r && a.ata && a.atr && a.b && a.work && a.x) {
+            // 決定的な擬似乱数（列ごとに周波数を変えて A を正定値にする）
+            for (size_t i = 0; i < mn; i++) a.jac[i] = sin(0.37 * (double)i + 0.011 * (double)(i % 97));
+            for (int i = 0; i < a.m; i++) a.r[i] = cos(0.13 * i);
+            // size = 変数の数 n, rays = 残差の数 m
+            bench_time t = bench_run(ctx, run_lm_normal, &a);
+            emit_result(ctx, "lm_normal_equations_wasm", NULL, a.n, a.m, &t, (double)mn * (a.n + 1) * 0.5, "madds/s", 0.0);
+            for (int i = 0; i < a.n; i++) a.b[i] = -a.atr[i];
+            t = bench_run(ctx, run_lm_solve, &a);
+            emit_result(ctx, "lm_damped_solve_wasm", NULL, a.n, 0, &t, 4.0, "solves/s", 0.0);
+        }
+        free(a.jac); free(a.r); free(a.ata); free(a.atr); free(a.b); free(a.work); free(a.x);
+    }
+}
+
+// --- Zernike フィット ---
+
+#define BENCH_ZERNIKE_ORDER 8
+#define BENCH_ZF_REMOVE_PISTON 4   // ZF_REMOVE_PISTON（fitZernikeWeighted の既定）
+
+typedef struct {
+    int count;
+    double* x;
+    double* y;
+    double* opd;
+    double* weight;
+    double coeffs[(BENCH_ZERNIKE_ORDER + 1) * (BENCH_ZERNIKE_ORDER + 2) / 2];
+    double stats[3];
+} zernike_arg;
+
+static void run_zernike(void* p) {
+    zernike_arg* a = (zernike_arg*)p;
+    zernike_fit_wasm(a->x, a->y, a->opd, a->weight, a->count, BENCH_ZERNIKE_ORDER, 0.0, BENCH_ZF_REMOVE_PISTON,
+                     a->coeffs, a->stats);
+}
+
+static void bench_zernike(bench_ctx* ctx) {
+    static const int counts[] = { 10000, 100000 };
+    const int n_counts = ctx->quick ? 1 : 2;
+    for (int c = 0; c < n_counts; c++) {
+        zernike_arg a;
+        a.count = counts[c];
+        a.x = (double*)malloc(sizeof(double) * 4 * (size_t)a.count);
+        if (!a.x) return;
+        a.y = a.x + a.count;
+        a.opd = a.y + a.count;
+        a.weight = a.opd + a.count;
+        // フィクスチャの Zernike 参照と同じ点群（Vogel 螺旋, 球面収差付きの OPD, 周辺で下がる重み）
+        for (int i = 0; i < a.count; i++) {
+            const double r = sqrt((i + 0.5) / a.count);
+            const double phi = i * BENCH_GOLDEN_ANGLE;
+            const double r2 = r * r;
+            a.x[i] = r * cos(phi);
+            a.y[i] = r * sin(phi);
+            a.opd[i] = bench_opd(a.x[i], a.y[i]) + 0.05 * (6 * r2 * r2 - 6 * r2 + 1);
+            a.weight[i] = 0.5 + 0.5 * (1 - r2);
+        }
+        // size = 最大次数, rays = 点数
+        bench_time t = bench_run(ctx, run_zernike, &a);
+        emit_result(ctx, "zernike_fit_wasm", NULL, BENCH_ZERNIKE_ORDER, a.count, &t, a.count, "points/s", 0.0);
+        free(a.x);
+    }
+}
+
+// --- ガラステーブルの屈折率 ---
+
+typedef struct {
+    const bench_fixtures* fx;
+    double* surfaces;
+} glass_arg;
+
+static void run_resolve_indices(void* p) {
+    glass_arg* a = (glass_arg*)p;
+    rt10_resolve_indices(a->surfaces, a->fx->glass_count, a->fx->glass_wl, a->fx->glass_wl_count);
+}
+
+// カタログの全ガラスを 1 面ずつ並べた面テーブル（屈折率スロットは rt10_resolve_indices が埋める）
+static double* bench_glass_surfaces(const bench_fixtures* fx) {
+    if (rt10_glass_load(fx->glass_table, fx->glass_count) != fx->glass_count) return NULL;
+    double* surfaces = (double*)calloc((size_t)fx->glass_count * BENCH_SURF_STRIDE, sizeof(double));
+    if (!surfaces) return NULL;
+    for (int g = 0; g < fx->glass_count; g++) surfaces[(size_t)g * BENCH_SURF_STRIDE + BENCH_SURF_GLASS] = g + 1;
+    return surfaces;
+}
+
+static void bench_glass(bench_ctx* ctx, const bench_fixtures* fx) {
+    glass_arg a = { fx, bench_glass_surfaces(fx) };
+    if (!a.surfaces) return;
+    bench_time t = bench_run(ctx, run_resolve_indices, &a);
+    emit_result(ctx, "rt10_resolve_indices", NULL, fx->glass_count, 0, &t,
+                (double)fx->glass_count * fx->glass_wl_count, "indices/s", 0.0);
+    free(a.surfaces);
+}
+
+// --- 精度チェック（JS 参照との比較） ---
+
+static void emit_accuracy(bench_ctx* ctx, const char* name, const char* lens, double max_error,
+                          int mismatches, double tol) {
+    const int pass = mismatches == 0 && max_error <= tol;
+    printf("%s\n    {\"name\": \"%s\"", ctx->first ? "" : ",", name);
+    ctx->first = 0;
+    if (lens) printf(", \"lens\": \"%s\"", lens);
+    printf(", \"maxError\": %.3e, \"mismatches\": %d, \"tolerance\": %.1e, \"pass\": %s}",
+           max_error, mismatches, tol, pass ? "true" : "false");
+}
+
+static void update_error(double* max_err, double e) {
+    if (e > *max_err || isnan(e)) *max_err = isnan(e) ? INFINITY : e;
+}
+
+enum { BENCH_TRACE_SYSTEM, BENCH_TRACE_BUNDLE, BENCH_TRACE_BUNDLE_F32 };
+
+// 参照光線を 1 つの経路で追跡し、traceRaysBatch と同じ変換
+// （BLOCKED / INVALID は null、それ以外は始点 + 交点列）で JS の通過点数・最終点と比べる
+static int check_trace_lens(bench_ctx* ctx, const bench_fixtures* fx, const bench_lens* L, int kind) {
+    static const char* names[] = { "trace_system_rt10_vs_js", "trace_bundle_rt10_vs_js", "trace_bundle_rt10_f32_vs_js" };
+    const int n = L->ref_count, S = L->surface_count;
+    const int cap = (n + 3) & ~3;
+    const size_t hit_count = 3 * (size_t)cap * S;
+    double* rays = (double*)malloc(sizeof(double) * 6 * (size_t)cap);
+    double* out = (double*)malloc(sizeof(double) * 7 * (size_t)cap);
+    int* status = (int*)malloc(sizeof(int) * (size_t)cap);
+    double* bundle = (double*)malloc(sizeof(double) * BENCH_BUNDLE_FIELDS * (size_t)cap);
+    float* bundle_f32 = (float*)malloc(sizeof(float) * BENCH_BUNDLE_FIELDS * (size_t)cap);
+    double* hits = (double*)malloc(sizeof(double) * hit_count);
+    float* hits_f32 = (float*)malloc(sizeof(float) * hit_count);
+    int failed = 1;
+    if (!rays || !out || !status || !bundle || !bundle_f32 || !hits || !hits_f32) goto done;
+    for (int i = 0; i < n; i++) bench_make_ray(fx, i, n, L->pupil_radius, rays + 6 * i);
+    for (size_t k = 0; k < hit_count; k++) {
+        hits[k] = NAN;
+        hits_f32[k] = NAN;
+    }
+    if (kind == BENCH_TRACE_SYSTEM) {
+        trace_system_rt10(L->surfaces, S, rays, n, 0, 1.0, -1, 0, out, status, hits);
+    } else if (kind == BENCH_TRACE_BUNDLE) {
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < 6; c++) bundle[c * cap + i] = rays[i * 6 + c];
+        }
+        bundle_init_rt10(bundle, cap, n);
+        trace_bundle_rt10(L->surfaces, S, bundle, cap, n, 0, 1.0, -1, 0, hits);
+        for (int i = 0; i < n; i++) status[i] = (int)bundle[BENCH_BUNDLE_STATUS * cap + i];
+    } else {
+        for (int i = 0; i < n; i++) {
+            for (int c = 0; c < 6; c++) bundle_f32[c * cap + i] = (float)rays[i * 6 + c];
+        }
+        bundle_init_rt10_f32(bundle_f32, cap, n);
+        trace_bundle_rt10_f32(L->surfaces, S, bundle_f32, cap, n, 0, 1.0, -1, 0, hits_f32);
+        for (int i = 0; i < n; i++) status[i] = (int)bundle_f32[BENCH_BUNDLE_STATUS * cap + i];
+    }
+
+    double max_err = 0.0;
+    int mismatches = 0;
+    for (int i = 0; i < n; i++) {
+        int points = 0;
+        double last[3] = { rays[6 * i], rays[6 * i + 1], rays[6 * i + 2] };
+        if (status[i] != 2 && status[i] != 4) {
+            points = 1;
+            for (int s = 0; s < S; s++) {
+                double h[3];
+                for (int c = 0; c < 3; c++) {
+                    // trace_system_rt10 は光線ごと（AoS）、バンドル版は成分ごと（SoA）
+                    h[c] = kind == BENCH_TRACE_SYSTEM ? hits[((size_t)i * S + s) * 3 + c]
+                         : kind == BENCH_TRACE_BUNDLE ? hits[((size_t)s * 3 + c) * cap + i]
+                         : (double)hits_f32[((size_t)s * 3 + c) * cap + i];
+                }
+                if (isnan(h[0])) continue;
+                points++;
+                last[0] = h[0]; last[1] = h[1]; last[2] = h[2];
+            }
+        }
+        if (points != L->ref_points[i]) { mismatches++; continue; }
+        if (points == 0) continue;
+        for (int c = 0; c < 3; c++) update_error(&max_err, fabs(last[c] - L->ref_final[3 * i + c]));
+    }
+    const double tol = kind == BENCH_TRACE_BUNDLE_F32 ? BENCH_TRACE_F32_TOL : BENCH_TRACE_TOL;
+    emit_accuracy(ctx, names[kind], L->name, max_err, mismatches, tol);
+    failed = !(mismatches == 0 && max_err <= tol);
+done:
+    free(rays); free(out); free(status); free(bundle); free(bundle_f32); free(hits); free(hits_f32);
+    return failed;
+}
+
+static int check_traces(bench_ctx* ctx, const bench_fixtures* fx) {
+    int failed = 0;
+    for (int kind = BENCH_TRACE_SYSTEM; kind <= BENCH_TRACE_BUNDLE_F32; kind++) {
+        for (int l = 0; l < fx->lens_count; l++) failed |= check_trace_lens(ctx, fx, &fx->lenses[l], kind);
+    }
+    return failed;
+}
+
+static int check_psf(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int n = fx->psf_size, n2 = n * n;
+    double* amp = (double*)malloc(sizeof(double) * n2);
+    if (!amp) return 1;
+    for (int i = 0; i < n2; i++) amp[i] = fx->psf_mask[i] ? 1.0 : 0.0;
+    double* psf = calculate_psf_grid_wasm(fx->psf_opd, amp, fx->psf_mask, n, fx->psf_wavelength, 0, 0.0, 0.0, 0.0);
+    free(amp);
+    if (!psf) return 1;
+    double pa = 0.0, pb = 0.0, max_err = 0.0;
+    for (int i = 0; i < n2; i++) {
+        if (psf[i] > pa) pa = psf[i];
+        if (fx->psf_ref[i] > pb) pb = fx->psf_ref[i];
+    }
+    for (int i = 0; i < n2; i++) {
+        const double e = fabs(psf[i] / pa - fx->psf_ref[i] / pb);
+        if (e > max_err || isnan(e)) max_err = isnan(e) ? INFINITY : e;
+    }
+    free_psf_result(psf);
+    emit_accuracy(ctx, "calculate_psf_grid_wasm_vs_js", NULL, max_err, 0, BENCH_PSF_TOL);
+    return !(max_err <= BENCH_PSF_TOL);
+}
+
+// MTF / スルーフォーカス / Strehl の参照は PSF と同じ瞳（振幅はマスク）
+static double* bench_psf_amplitude(const bench_fixtures* fx) {
+    const int n2 = fx->psf_size * fx->psf_size;
+    double* amp = (double*)malloc(sizeof(double) * n2);
+    if (amp) {
+        for (int i = 0; i < n2; i++) amp[i] = fx->psf_mask[i] ? 1.0 : 0.0;
+    }
+    return amp;
+}
+
+static int check_mtf(bench_ctx* ctx, const bench_fixtures* fx) {
+    static const double angles[2] = { 0.0, 1.5707963267948966 };
+    const int D = fx->mtf_defocus_count, F = fx->mtf_freq_count;
+    double freqs[BENCH_MAX_FREQS];
+    for (int f = 0; f < F; f++) freqs[f] = f;
+    double* amp = bench_psf_amplitude(fx);
+    double* out = (double*)malloc(sizeof(double) * D * 2 * F);
+    int rc = -1;
+    if (amp && out) {
+        rc = calculate_mtf_batch_wasm(fx->psf_opd, amp, fx->psf_mask, fx->psf_size, 1, fx->psf_wavelength,
+                                      fx->mtf_defocus, D, 0.0, angles, 2, freqs, F, out);
+    }
+    double max_err = rc == 0 ? 0.0 : INFINITY;
+    for (int i = 0; rc == 0 && i < D * 2 * F; i++) update_error(&max_err, fabs(out[i] - fx->mtf_ref[i]));
+    free(amp); free(out);
+    emit_accuracy(ctx, "calculate_mtf_batch_wasm_vs_js", NULL, max_err, 0, BENCH_MTF_TOL);
+    return !(max_err <= BENCH_MTF_TOL);
+}
+
+static int check_focus_stack(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int count = fx->focus_count;
+    double* amp = bench_psf_amplitude(fx);
+    double* focus = (double*)malloc(sizeof(double) * count);
+    double* metrics = (double*)malloc(sizeof(double) * 3 * count);
+    int rc = -1;
+    if (amp && focus && metrics) {
+        for (int s = 0; s < count; s++) focus[s] = fx->focus_ref[4 * s];
+        rc = calculate_psf_focus_stack_wasm(fx->psf_opd, amp, fx->psf_mask, fx->psf_size, fx->psf_wavelength,
+                                            focus, count, 0, 0.0, 0.0, NULL, metrics);
+    }
+    // peak は相対差、Strehl と EE80（画素）は差
+    double max_err = rc == 0 ? 0.0 : INFINITY;
+    for (int s = 0; rc == 0 && s < count; s++) {
+        const double* ref = fx->focus_ref + 4 * s;
+        const double* m = metrics + 3 * s;
+        update_error(&max_err, fabs(m[0] - ref[1]) / ref[1]);
+        update_error(&max_err, fabs(m[1] - ref[2]));
+        update_error(&max_err, fabs(m[2] - ref[3]));
+    }
+    free(amp); free(focus); free(metrics);
+    emit_accuracy(ctx, "calculate_psf_focus_stack_wasm_vs_js", NULL, max_err, 0, BENCH_FOCUS_TOL);
+    return !(max_err <= BENCH_FOCUS_TOL);
+}
+
+static int check_strehl(bench_ctx* ctx, const bench_fixtures* fx) {
+    const double* ref = fx->strehl_ref;
+    double* amp = bench_psf_amplitude(fx);
+    double out[5], out_refine[5];
+    int rc = -1, rc_refine = -1;
+    if (amp) {
+        rc = calculate_strehl_pupil_wasm(fx->psf_opd, amp, fx->psf_mask, fx->psf_size, fx->psf_wavelength, 0, out);
+        rc_refine = calculate_strehl_pupil_wasm(fx->psf_opd, amp, fx->psf_mask, fx->psf_size, fx->psf_wavelength,
+                                                1, out_refine);
+    }
+    free(amp);
+
+    // refine = 0: ピーク欄も基準点の値
+    double max_err = rc >= 0 ? 0.0 : INFINITY;
+    if (rc >= 0) {
+        update_error(&max_err, fabs(out[0] - ref[0]));
+        update_error(&max_err, fabs(out[1] - ref[0]));
+        update_error(&max_err, fabs(out[4] - ref[4]) / ref[4]);
+    }
+    emit_accuracy(ctx, "calculate_strehl_pupil_wasm_vs_js", NULL, max_err, 0, BENCH_STREHL_TOL);
+    int failed = !(max_err <= BENCH_STREHL_TOL);
+
+    // refine = 1: 真のピーク（位置の許容値を超えたら mismatch）
+    double peak_err = rc_refine >= 0 ? 0.0 : INFINITY;
+    int mismatches = 0;
+    if (rc_refine >= 0) {
+        update_error(&peak_err, fabs(out_refine[1] - ref[1]));
+        for (int c = 2; c < 4; c++) mismatches += !(fabs(out_refine[c] - ref[c]) <= BENCH_STREHL_POS_TOL);
+    }
+    emit_accuracy(ctx, "calculate_strehl_pupil_wasm_refine_vs_js", NULL, peak_err, mismatches, BENCH_STREHL_TOL);
+    failed |= !(mismatches == 0 && peak_err <= BENCH_STREHL_TOL);
+    return failed;
+}
+
+static int check_glass(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int G = fx->glass_count, W = fx->glass_wl_count;
+    double* surfaces = bench_glass_surfaces(fx);
+    const int rc = surfaces ? rt10_resolve_indices(surfaces, G, fx->glass_wl, W) : -1;
+    double max_err = rc >= 0 ? 0.0 : INFINITY;
+    for (int g = 0; rc >= 0 && g < G; g++) {
+        const double* S = surfaces + (size_t)g * BENCH_SURF_STRIDE;
+        for (int w = 0; w < W; w++) update_error(&max_err, fabs(S[BENCH_SURF_INDEX + w] - fx->glass_ref[g * W + w]));
+    }
+    free(surfaces);
+    emit_accuracy(ctx, "rt10_resolve_indices_vs_js", NULL, max_err, 0, BENCH_GLASS_TOL);
+    return !(max_err <= BENCH_GLASS_TOL);
+}
+
+static int check_zernike(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int count = fx->zern_count;
+    const double* p = fx->zern_points;
+    double* coeffs = (double*)malloc(sizeof(double) * fx->zern_terms);
+    double stats[3];
+    const int rc = coeffs ? zernike_fit_wasm(p, p + count, p + 2 * count, p + 3 * count, count, fx->zern_order,
+                                             0.0, fx->zern_flags, coeffs, stats) : -1;
+    double max_err = rc == 0 ? 0.0 : INFINITY;
+    if (rc == 0) {
+        for (int j = 0; j < fx->zern_terms; j++) update_error(&max_err, fabs(coeffs[j] - fx->zern_ref[j]));
+        update_error(&max_err, fabs(stats[0] - fx->zern_stats[0]));
+        update_error(&max_err, fabs(stats[1] - fx->zern_stats[1]));
+    }
+    free(coeffs);
+    emit_accuracy(ctx, "zernike_fit_wasm_vs_js", NULL, max_err, 0, BENCH_ZERNIKE_TOL);
+    return !(max_err <= BENCH_ZERNIKE_TOL);
+}
+
+static double lm_error(double value, double ref) {
+    return fabs(value - ref) / fmax(1.0, fabs(ref));
+}
+
+static int check_lm(bench_ctx* ctx, const bench_fixtures* fx) {
+    const int m = fx->lm_m, n = fx->lm_n;
+    double* ata = (double*)malloc(sizeof(double) * (size_t)n * n);
+    double* atr = (double*)malloc(sizeof(double) * n);
+    double* b = (double*)malloc(sizeof(double) * n);
+    double* work = (double*)malloc(sizeof(double) * ((size_t)n * n + n));
+    double* x = (double*)malloc(sizeof(double) * n);
+    int failed = 1;
+    if (ata && atr && b && work && x) {
+        const int rc = lm_normal_equations_wasm(fx->lm_jac, fx->lm_r, m, n, ata, atr);
+        double max_err = rc == 0 ? 0.0 : INFINITY;
+        for (int i = 0; rc == 0 && i < n * n; i++) update_error(&max_err, lm_error(ata[i], fx->lm_ata[i]));
+        for (int i = 0; rc == 0 && i < n; i++) update_error(&max_err, lm_error(atr[i], fx->lm_atr[i]));
+        emit_accuracy(ctx, "lm_normal_equations_wasm_vs_js", NULL, max_err, 0, BENCH_LM_TOL);
+        failed = !(max_err <= BENCH_LM_TOL);
+
+        // 参照と同じ A・右辺 -g で λ ごとに解く
+        max_err = 0.0;
+        for (int i = 0; i < n; i++) b[i] = -fx->lm_atr[i];
+        for (int k = 0; k < fx->lm_lambda_count; k++) {
+            if (lm_damped_solve_wasm(fx->lm_ata, b, n, fx->lm_lambdas[k], work, x) != 0) {
+                max_err = INFINITY;
+                break;
+            }
+            for (int i = 0; i < n; i++) update_error(&max_err, lm_error(x[i], fx->lm_x[k * n + i]));
+        }
+        emit_accuracy(ctx, "lm_damped_solve_wasm_vs_js", NULL, max_err, 0, BENCH_LM_TOL);
+        failed |= !(max_err <= BENCH_LM_TOL);
+    }
+    free(ata); free(atr); free(b); free(work); free(x);
+    return failed;
+}
+
+int main(int argc, char** argv) {
+    bench_ctx ctx = { 0, 1, 200.0, 1 };
+    const char* fixtures_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) ctx.quick = 1;
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) ctx.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--target-ms") == 0 && i + 1 < argc) ctx.target_ms = atof(argv[++i]);
+        else fixtures_path = argv[i];
+    }
+    static bench_fixtures fx;
+    if (!fixtures_path || load_fixtures(fixtures_path, &fx) != 0) {
+        fprintf(stderr, "usage: kernel-bench <fixtures.txt> [--quick] [--threads N] [--target-ms T]\n");
+        fprintf(stderr, "  (fixtures: node performance/kernel-benchmark.mjs fixtures <out.txt>)\n");
+        return 2;
+    }
+    const int threads = rt10_set_thread_count(ctx.threads);
+    psf_set_thread_count(ctx.threads);
+
+#ifdef __EMSCRIPTEN__
+    const char* host = "wasm";
+#else
+    const char* host = "native";
+#endif
+#ifdef __wasm_simd128__
+    const int simd = 1;
+#else
+    const int simd = 0;
+#endif
+    printf("{\n  \"suite\": \"coopt-kernels\",\n  \"version\": 1,\n  \"host\": \"%s\",\n  \"simd128\": %s,\n"
+           "  \"threads\": %d,\n  \"quick\": %s,\n  \"results\": [",
+           host, simd ? "true" : "false", threads, ctx.quick ? "true" : "false");
+    bench_traces(&ctx, &fx);
+    bench_spot(&ctx, &fx);
+    bench_intersect(&ctx, &fx);
+    bench_psf(&ctx);
+    bench_lm(&ctx);
+    bench_zernike(&ctx);
+    bench_glass(&ctx, &fx);
+    printf("\n  ],\n  \"accuracy\": [");
+    ctx.first = 1;
+    int failed = check_traces(&ctx, &fx);
+    failed |= check_psf(&ctx, &fx);
+    failed |= check_mtf(&ctx, &fx);
+    failed |= check_focus_stack(&ctx, &fx);
+    failed |= check_strehl(&ctx, &fx);
+    failed |= check_glass(&ctx, &fx);
+    failed |= check_zernike(&ctx, &fx);
+    failed |= check_lm(&ctx, &fx);
+    printf("\n  ]\n}\n");
+    return failed ? 1 : 0;
+}
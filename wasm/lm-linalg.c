@@ -0,0 +1,173 @@
+/**
+ * Levenberg-Marquardt Linear Algebra WebAssembly Kernel
+ * optimization/optimizer-mvp.js の正規方程式と減衰付き Cholesky（optimization/lm-linalg.js から呼ぶ）
+ *
+ * 主要機能:
+ * - Jacobian は列優先（J[j * m + i]）の Float64Array。列が連続なので JᵀJ の各要素は連続ベクトルの内積
+ * - 行を LM_ROW_BLOCK 行ずつに区切り（列 2 本 + r が L1 に載る長さ）、2 列同時の f64x2 内積で
+ *   JᵀJ の下三角と Jᵀr を 1 回の走査で蓄積する
+ * - 出力行 j ごとにスレッドへ分配し、ブロック順に足し合わせる（スレッド数によらず同じ結果）
+ * - 減衰 A + λ·diag(A) + λ·I は分解時にその場で加えるので、λ を変えて解き直しても A は作り直さない
+ *
+ * psf-wasm.c と同じモジュールにリンクされ、スレッドプールは psf_parallel_for 経由で共用する。
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+// psf-wasm.c（同じプールを使うための入口）
+void psf_parallel_for(int begin, int end, int min_chunk, void (*fn)(int, int, void*), void* ctx);
+
+#define LM_ROW_BLOCK 512
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+typedef v128_t lmv2;
+static inline lmv2 lmv_zero(void) { return wasm_f64x2_splat(0.0); }
+static inline lmv2 lmv_load(const double* p) { return wasm_v128_load(p); }
+static inline lmv2 lmv_madd(lmv2 acc, lmv2 a, lmv2 b) { return wasm_f64x2_add(acc, wasm_f64x2_mul(a, b)); }
+static inline double lmv_hsum(lmv2 a) { return wasm_f64x2_extract_lane(a, 0) + wasm_f64x2_extract_lane(a, 1); }
+#else
+typedef struct { double v[2]; } lmv2;
+static inline lmv2 lmv_zero(void) { lmv2 r = { { 0.0, 0.0 } }; return r; }
+static inline lmv2 lmv_load(const double* p) { lmv2 r = { { p[0], p[1] } }; return r; }
+static inline lmv2 lmv_madd(lmv2 acc, lmv2 a, lmv2 b) {
+    acc.v[0] += a.v[0] * b.v[0];
+    acc.v[1] += a.v[1] * b.v[1];
+    return acc;
+}
+static inline double lmv_hsum(lmv2 a) { return a.v[0] + a.v[1]; }
+#endif
+
+// Σ a[i]·b[i]
+static inline double lm_dot(const double* a, const double* b, int len) {
+    lmv2 acc = lmv_zero();
+    int i = 0;
+    for (; i + 1 < len; i += 2) acc = lmv_madd(acc, lmv_load(a + i), lmv_load(b + i));
+    double s = lmv_hsum(acc);
+    for (; i < len; i++) s += a[i] * b[i];
+    return s;
+}
+
+// Σ a[i]·b0[i], Σ a[i]·b1[i]（a の読み込みを 2 列で共用）
+static inline void lm_dot2(const double* a, const double* b0, const double* b1, int len, double* s0, double* s1) {
+    lmv2 acc0 = lmv_zero(), acc1 = lmv_zero();
+    int i = 0;
+    for (; i + 1 < len; i += 2) {
+        const lmv2 va = lmv_load(a + i);
+        acc0 = lmv_madd(acc0, va, lmv_load(b0 + i));
+        acc1 = lmv_madd(acc1, va, lmv_load(b1 + i));
+    }
+    double t0 = lmv_hsum(acc0), t1 = lmv_hsum(acc1);
+    for (; i < len; i++) {
+        t0 += a[i] * b0[i];
+        t1 += a[i] * b1[i];
+    }
+    *s0 = t0;
+    *s1 = t1;
+}
+
+typedef struct {
+    const double* jac;
+    const double* r;
+    int m;
+    int n;
+    double* ata;
+    double* atr;
+} lm_gram_task;
+
+// 出力行 j ∈ [begin, end) の ata[j][0..j] と atr[j]
+static void lm_gram_rows(int begin, int end, void* ctx) {
+    lm_gram_task* t = (lm_gram_task*)ctx;
+    const int m = t->m, n = t->n;
+    for (int j = begin; j < end; j++) {
+        double* row = t->ata + (size_t)j * n;
+        for (int k = 0; k <= j; k++) row[k] = 0.0;
+        if (t->atr) t->atr[j] = 0.0;
+    }
+    for (int i0 = 0; i0 < m; i0 += LM_ROW_BLOCK) {
+        const int len = (i0 + LM_ROW_BLOCK < m) ? LM_ROW_BLOCK : m - i0;
+        for (int j = begin; j < end; j++) {
+            const double* cj = t->jac + (size_t)j * m + i0;
+            double* row = t->ata + (size_t)j * n;
+            int k = 0;
+            for (; k + 1 <= j; k += 2) {
+                double s0, s1;
+                lm_dot2(cj, t->jac + (size_t)k * m + i0, t->jac + (size_t)(k + 1) * m + i0, len, &s0, &s1);
+                row[k] += s0;
+                row[k + 1] += s1;
+            }
+            if (k == j) row[k] += lm_dot(cj, cj, len);
+            if (t->atr) t->atr[j] += lm_dot(cj, t->r + i0, len);
+        }
+    }
+}
+
+/**
+ * 正規方程式 A = JᵀJ, g = Jᵀr
+ * @param jac Jacobian（列優先, m × n）
+ * @param r 残差（m, NULL なら g は計算しない）
+ * @param ata 出力 A（n × n, 行優先, 対称に両側を埋める）
+ * @param atr 出力 g（n, NULL 可）
+ * @return 0: 成功 / -1: 失敗
+ */
+int lm_normal_equations_wasm(const double* jac, const double* r, int m, int n, double* ata, double* atr) {
+    if (!jac || !ata || m < 0 || n <= 0) return -1;
+    lm_gram_task t = { jac, r, m, n, ata, r ? atr : NULL };
+    // 行 j の仕事量は j に比例するので小さめの塊で配る
+    psf_parallel_for(0, n, (n >= 32) ? 4 : n, lm_gram_rows, &t);
+    for (int j = 0; j < n; j++) {
+        for (int k = 0; k < j; k++) ata[(size_t)k * n + j] = ata[(size_t)j * n + k];
+    }
+    return 0;
+}
+
+/**
+ * (A + λ·diag(A) + λ·I) x = b を Cholesky で解く（A は変更しない）
+ * - diag(A) の要素が正でない（または有限でない）ときは 1 を使う（optimizer-mvp.js と同じ）
+ * - 非正のピボットは失敗（JS 側は Gauss 消去にフォールバックする）
+ * @param ata A（n × n, 行優先）
+ * @param b 右辺（n）
+ * @param lambda 減衰係数
+ * @param work 作業領域（n × n + n, 呼び出し側で確保して λ を変えても使い回す）
+ * @param x 出力解（n）
+ * @return 0: 成功 / -1: 失敗
+ */
+int lm_damped_solve_wasm(const double* ata, const double* b, int n, double lambda, double* work, double* x) {
+    if (!ata || !b || !work || !x || n <= 0) return -1;
+    double* L = work;                   // 下三角（行優先）
+    double* y = work + (size_t)n * n;
+
+    for (int i = 0; i < n; i++) {
+        double* Li = L + (size_t)i * n;
+        const double* Ai = ata + (size_t)i * n;
+        for (int j = 0; j < i; j++) {
+            const double* Lj = L + (size_t)j * n;
+            Li[j] = (Ai[j] - lm_dot(Li, Lj, j)) / Lj[j];
+        }
+        const double d = Ai[i];
+        const double diag = (d > 0.0 && d < INFINITY) ? d : 1.0;
+        const double piv = d + lambda * diag + lambda - lm_dot(Li, Li, i);
+        if (!(piv > 0.0) || !(piv < INFINITY)) return -1;
+        Li[i] = sqrt(piv);
+    }
+
+    // L y = b
+    for (int i = 0; i < n; i++) {
+        const double* Li = L + (size_t)i * n;
+        y[i] = (b[i] - lm_dot(Li, y, i)) / Li[i];
+    }
+    // Lᵀ x = y（列方向の参照になるので y から引いていく形にする）
+    for (int i = n - 1; i >= 0; i--) {
+        const double* Li = L + (size_t)i * n;
+        const double xi = y[i] / Li[i];
+        x[i] = xi;
+        for (int k = 0; k < i; k++) y[k] -= Li[k] * xi;
+    }
+    return 0;
+}
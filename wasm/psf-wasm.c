@@ -19,6 +19,9 @@
 #include <emscripten.h>
 #endif
 
+// -pthread ビルド（psf-wasm-mt.js）でのみワーカーを使う。通常ビルドでは逐次実行。
+#include "wasm-thread-pool.h"
+
 // 高精度時間測定（WebAssembly用）
 double get_time_ms() {
 #ifdef __EMSCRIPTEN__
@@ -37,6 +40,10 @@ double get_time_ms() {
 
 #define LARGE_NUMBER 1e10  // INFINITYの代わり
 
+// OPD格子補間モード（calculate_psf_wasm の interp_mode）
+#define PSF_INTERP_NEAREST      0  // 最近傍（従来互換）
+#define PSF_INTERP_BARYCENTRIC  1  // 局所 Delaunay 三角形上の重心座標（線形）補間
+
 // 複素数構造体（メモリアライメント最適化）
 typedef struct {
     double real;
@@ -65,14 +72,11 @@ void calculate_complex_amplitude(double* opd, double* amplitude, int* pupil_mask
                                 Complex* output, int size, double wavelength);
 void interpolate_opd_grid(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
                          double* grid_opd, int* pupil_mask, int grid_size,
-                         double min_x, double max_x, double min_y, double max_y);
+                         double min_x, double max_x, double min_y, double max_y,
+                         int interp_mode);
 void fft_shift(double* data, int size);
 double calculate_strehl_ratio(double* psf, int size);
 void calculate_encircled_energy(double* psf, int size, double* radii, double* energies, int radii_count);
-void init_fast_trig_tables(int max_size);
-void init_twiddle_table(int max_size);
-static double fast_sin(double x);
-static double fast_cos(double x);
 
 /**
  * FFTシフト（DC成分を中央に移動）
@@ -97,15 +101,6 @@ void fft_shift(double* data, int size) {
     }
 }
 
-// 三角関数テーブル（事前計算）
-static Complex* twiddle_table = NULL;
-static int twiddle_table_size = 0;
-
-// 高速sin/cosテーブル用
-static double* sin_table = NULL;
-static double* cos_table = NULL;
-static int trig_table_size = 0;
-
 // FFT用の一時バッファを再利用（malloc/freeオーバーヘッド削減）
 static Complex* fft_temp_buffer = NULL;
 static size_t fft_temp_capacity = 0; // 要素数（Complex単位）
@@ -124,192 +119,365 @@ static inline void ensure_fft_temp_buffer(size_t need_elements) {
     }
 }
 
-/**
- * 高速三角関数テーブルの初期化
+/*
+ * =============================================================================
+ * 位相 → 複素振幅の sincos（範囲縮約 + 多項式, 2 レーン同時）
+ * =============================================================================
+ *
+ * x = n·π/2 + r（|r| <= π/4）に縮約し、r の多項式で sin/cos を求めて象限で入れ替える。
+ * - PSF_TRIG_EXACT    : libm の sin/cos（参照用）
+ * - PSF_TRIG_ACCURATE : fdlibm __kernel_sin/__kernel_cos と同じ次数（誤差 ~1e-16, 既定）
+ * - PSF_TRIG_FAST     : sin 7 次 / cos 8 次（誤差 ~3e-7 ≒ λ/2e7 の位相誤差）
+ * 旧実装の N²×4 要素テーブル（1024² で 64MB 超, 最近傍参照の量子化誤差あり）は廃止。
+ * 象限判定も浮動小数で行うため、SIMD 版と非 SIMD 版は同じ値を返す。
  */
-void init_fast_trig_tables(int max_size) {
-    if (sin_table) {
-        free(sin_table);
-        free(cos_table);
-    }
-    
-    trig_table_size = max_size * 4; // オーバーサンプリング
-    sin_table = (double*)malloc(trig_table_size * sizeof(double));
-    cos_table = (double*)malloc(trig_table_size * sizeof(double));
-    
-    for (int i = 0; i < trig_table_size; i++) {
-        double angle = 2.0 * M_PI * i / trig_table_size;
-        sin_table[i] = sin(angle);
-        cos_table[i] = cos(angle);
-    }
-}
+#define PSF_TRIG_EXACT     0
+#define PSF_TRIG_ACCURATE  1
+#define PSF_TRIG_FAST      2
+
+// |x| がこれを超えると Cody-Waite 縮約の精度が落ちるので libm に任せる（n < 2^20）
+#define PSF_SINCOS_REDUCE_MAX 1.0e6
+
+static int psf_trig_tier = PSF_TRIG_ACCURATE;
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+typedef v128_t psv2;
+static inline psv2 psv_make(double l0, double l1) { return wasm_f64x2_make(l0, l1); }
+static inline psv2 psv_splat(double a) { return wasm_f64x2_splat(a); }
+static inline psv2 psv_add(psv2 a, psv2 b) { return wasm_f64x2_add(a, b); }
+static inline psv2 psv_sub(psv2 a, psv2 b) { return wasm_f64x2_sub(a, b); }
+static inline psv2 psv_mul(psv2 a, psv2 b) { return wasm_f64x2_mul(a, b); }
+static inline psv2 psv_neg(psv2 a) { return wasm_f64x2_neg(a); }
+static inline psv2 psv_nearest(psv2 a) { return wasm_f64x2_nearest(a); }
+static inline psv2 psv_floor(psv2 a) { return wasm_f64x2_floor(a); }
+static inline psv2 psv_eq(psv2 a, psv2 b) { return wasm_f64x2_eq(a, b); }
+static inline psv2 psv_ge(psv2 a, psv2 b) { return wasm_f64x2_ge(a, b); }
+static inline psv2 psv_or(psv2 a, psv2 b) { return wasm_v128_or(a, b); }
+static inline psv2 psv_select(psv2 m, psv2 a, psv2 b) { return wasm_v128_bitselect(a, b, m); } // m ? a : b
+static inline double psv_lane(psv2 a, int lane) { return lane ? wasm_f64x2_extract_lane(a, 1) : wasm_f64x2_extract_lane(a, 0); }
+#else
+// 比較結果は 0.0 / 1.0 で表す
+typedef struct { double v[2]; } psv2;
+static inline psv2 psv_make(double l0, double l1) { psv2 r; r.v[0] = l0; r.v[1] = l1; return r; }
+static inline psv2 psv_splat(double a) { return psv_make(a, a); }
+static inline psv2 psv_add(psv2 a, psv2 b) { return psv_make(a.v[0] + b.v[0], a.v[1] + b.v[1]); }
+static inline psv2 psv_sub(psv2 a, psv2 b) { return psv_make(a.v[0] - b.v[0], a.v[1] - b.v[1]); }
+static inline psv2 psv_mul(psv2 a, psv2 b) { return psv_make(a.v[0] * b.v[0], a.v[1] * b.v[1]); }
+static inline psv2 psv_neg(psv2 a) { return psv_make(-a.v[0], -a.v[1]); }
+static inline psv2 psv_nearest(psv2 a) { return psv_make(nearbyint(a.v[0]), nearbyint(a.v[1])); }
+static inline psv2 psv_floor(psv2 a) { return psv_make(floor(a.v[0]), floor(a.v[1])); }
+static inline psv2 psv_eq(psv2 a, psv2 b) { return psv_make(a.v[0] == b.v[0], a.v[1] == b.v[1]); }
+static inline psv2 psv_ge(psv2 a, psv2 b) { return psv_make(a.v[0] >= b.v[0], a.v[1] >= b.v[1]); }
+static inline psv2 psv_or(psv2 a, psv2 b) { return psv_make(a.v[0] != 0.0 || b.v[0] != 0.0, a.v[1] != 0.0 || b.v[1] != 0.0); }
+static inline psv2 psv_select(psv2 m, psv2 a, psv2 b) { return psv_make(m.v[0] != 0.0 ? a.v[0] : b.v[0], m.v[1] != 0.0 ? a.v[1] : b.v[1]); }
+static inline double psv_lane(psv2 a, int lane) { return a.v[lane]; }
+#endif
 
 /**
- * 高速sin関数（テーブル参照）
+ * 2 レーンの sincos（|x| <= PSF_SINCOS_REDUCE_MAX を前提）
  */
-static inline double fast_sin(double x) {
-    if (!sin_table) return sin(x);
+static inline void psf_sincos2(psv2 x, int fast, psv2* s_out, psv2* c_out) {
+    // π/2 の 3 分割（fdlibm pio2_1/pio2_2/pio2_3: 上位 33 bit ずつ → n·pio2_k は厳密）
+    const double PIO2_1 = 1.57079632673412561417e+00;
+    const double PIO2_2 = 6.07710050630396597660e-11;
+    const double PIO2_3 = 2.02226624871116645580e-21;
+    const double INV_PIO2 = 6.36619772367581382433e-01;
 
-    // 角度を正規化（O(1)での範囲縮約）
-    // NOTE: while で 2π を足し引きすると |x| が大きいケースで計算が破綻する。
-    if (!isfinite(x)) return 0.0;
-    x = fmod(x, 2.0 * M_PI);
-    if (x < 0) x += 2.0 * M_PI;
-    
-    int index = (int)((x / (2.0 * M_PI)) * trig_table_size);
-    if (index >= trig_table_size) index = trig_table_size - 1;
-    
-    return sin_table[index];
+    const psv2 n = psv_nearest(psv_mul(x, psv_splat(INV_PIO2)));
+    psv2 r = psv_sub(x, psv_mul(n, psv_splat(PIO2_1)));
+    r = psv_sub(r, psv_mul(n, psv_splat(PIO2_2)));
+    r = psv_sub(r, psv_mul(n, psv_splat(PIO2_3)));
+    const psv2 z = psv_mul(r, r);
+
+    psv2 ps, pc;
+    if (fast) {
+        // Taylor（|r| <= π/4 で sin 誤差 3.1e-7, cos 誤差 2.5e-8）
+        ps = psv_splat(-1.0 / 5040.0);
+        ps = psv_add(psv_splat(1.0 / 120.0), psv_mul(z, ps));
+        ps = psv_add(psv_splat(-1.0 / 6.0), psv_mul(z, ps));
+        pc = psv_splat(1.0 / 40320.0);
+        pc = psv_add(psv_splat(-1.0 / 720.0), psv_mul(z, pc));
+        pc = psv_add(psv_splat(1.0 / 24.0), psv_mul(z, pc));
+    } else {
+        // fdlibm k_sin.c / k_cos.c の minimax 係数
+        ps = psv_splat(1.58969099521155010221e-10);
+        ps = psv_add(psv_splat(-2.50507602534068634195e-08), psv_mul(z, ps));
+        ps = psv_add(psv_splat(2.75573137070700676789e-06), psv_mul(z, ps));
+        ps = psv_add(psv_splat(-1.98412698298579493134e-04), psv_mul(z, ps));
+        ps = psv_add(psv_splat(8.33333333332248946124e-03), psv_mul(z, ps));
+        ps = psv_add(psv_splat(-1.66666666666666324348e-01), psv_mul(z, ps));
+        pc = psv_splat(-1.13596475577881948265e-11);
+        pc = psv_add(psv_splat(2.08757232129817482790e-09), psv_mul(z, pc));
+        pc = psv_add(psv_splat(-2.75573143513906633035e-07), psv_mul(z, pc));
+        pc = psv_add(psv_splat(2.48015872894767294178e-05), psv_mul(z, pc));
+        pc = psv_add(psv_splat(-1.38888888888741095749e-03), psv_mul(z, pc));
+        pc = psv_add(psv_splat(4.16666666666666019037e-02), psv_mul(z, pc));
+    }
+    // sin r = r + r·z·ps,  cos r = 1 - z/2 + z²·pc
+    const psv2 sr = psv_add(r, psv_mul(psv_mul(r, z), ps));
+    const psv2 cr = psv_add(psv_sub(psv_splat(1.0), psv_mul(z, psv_splat(0.5))), psv_mul(psv_mul(z, z), pc));
+
+    // 象限 q = n mod 4（浮動小数で厳密）
+    const psv2 q = psv_sub(n, psv_mul(psv_splat(4.0), psv_floor(psv_mul(n, psv_splat(0.25)))));
+    const psv2 odd = psv_or(psv_eq(q, psv_splat(1.0)), psv_eq(q, psv_splat(3.0)));
+    const psv2 qs = psv_select(odd, cr, sr);
+    const psv2 qc = psv_select(odd, sr, cr);
+    *s_out = psv_select(psv_ge(q, psv_splat(2.0)), psv_neg(qs), qs);
+    *c_out = psv_select(psv_or(psv_eq(q, psv_splat(1.0)), psv_eq(q, psv_splat(2.0))), psv_neg(qc), qc);
+}
+
+// 範囲外・非有限の位相（旧 fast_sin/fast_cos と同じく非有限は sin 0 / cos 1）
+static inline void psf_sincos_slow(double x, double* s, double* c) {
+    if (!isfinite(x)) { *s = 0.0; *c = 1.0; return; }
+    *s = sin(x);
+    *c = cos(x);
 }
 
 /**
- * 高速cos関数（テーブル参照）
+ * 位相精度の段階を設定する（PSF_TRIG_*）。範囲外は PSF_TRIG_ACCURATE。
+ * @return 設定後の段階
  */
-static inline double fast_cos(double x) {
-    if (!cos_table) return cos(x);
+int psf_set_trig_accuracy(int tier) {
+    psf_trig_tier = (tier == PSF_TRIG_EXACT || tier == PSF_TRIG_FAST) ? tier : PSF_TRIG_ACCURATE;
+    return psf_trig_tier;
+}
 
-    // 角度を正規化（O(1)での範囲縮約）
-    // NOTE: while で 2π を足し引きすると |x| が大きいケースで計算が破綻する。
-    if (!isfinite(x)) return 1.0;
-    x = fmod(x, 2.0 * M_PI);
-    if (x < 0) x += 2.0 * M_PI;
-    
-    int index = (int)((x / (2.0 * M_PI)) * trig_table_size);
-    if (index >= trig_table_size) index = trig_table_size - 1;
-    
-    return cos_table[index];
+int psf_get_trig_accuracy() {
+    return psf_trig_tier;
 }
 
+/*
+ * 瞳の総和（Strehl 用）: amp_sum = ΣA, field = Σ A·exp(iφ)（= 主光線方向の PSF 振幅, FFT の DC 成分）
+ * Strehl（基準点）= |field|² / amp_sum²。複素振幅を作るのと同じパスで集計する。
+ */
+typedef struct {
+    double amp_sum;
+    double re;
+    double im;
+} psf_pupil_sums;
+
 /**
- * 三角関数テーブルの初期化
+ * out[i] = mask[i] ? amp[i]·exp(i·k·opd[i]) : 0（amp == NULL なら振幅 1）
+ * @param sums NULL でなければ瞳の総和を書き込む
  */
-void init_twiddle_table(int max_size) {
-    if (twiddle_table) {
-        free(twiddle_table);
+static void psf_phase_to_complex(const double* opd, const double* amp, const int* mask,
+                                 double k, Complex* out, int n, psf_pupil_sums* sums) {
+    const int tier = psf_trig_tier;
+    const int fast = (tier == PSF_TRIG_FAST);
+    double amp_sum = 0.0, sum_re = 0.0, sum_im = 0.0;
+    int i = 0;
+    if (tier != PSF_TRIG_EXACT) {
+        for (; i + 1 < n; i += 2) {
+            if (!mask[i] && !mask[i + 1]) {
+                out[i].real = out[i].imag = 0.0;
+                out[i + 1].real = out[i + 1].imag = 0.0;
+                continue;
+            }
+            const double x0 = mask[i] ? k * opd[i] : 0.0;
+            const double x1 = mask[i + 1] ? k * opd[i + 1] : 0.0;
+            psv2 sv, cv;
+            psf_sincos2(psv_make(x0, x1), fast, &sv, &cv);
+            double s0 = psv_lane(sv, 0), c0 = psv_lane(cv, 0);
+            double s1 = psv_lane(sv, 1), c1 = psv_lane(cv, 1);
+            // NaN は比較が偽になるので範囲外扱い
+            if (!(fabs(x0) <= PSF_SINCOS_REDUCE_MAX)) psf_sincos_slow(x0, &s0, &c0);
+            if (!(fabs(x1) <= PSF_SINCOS_REDUCE_MAX)) psf_sincos_slow(x1, &s1, &c1);
+            const double a0 = mask[i] ? (amp ? amp[i] : 1.0) : 0.0;
+            const double a1 = mask[i + 1] ? (amp ? amp[i + 1] : 1.0) : 0.0;
+            out[i].real = a0 * c0;
+            out[i].imag = a0 * s0;
+            out[i + 1].real = a1 * c1;
+            out[i + 1].imag = a1 * s1;
+            amp_sum += a0 + a1;
+            sum_re += out[i].real + out[i + 1].real;
+            sum_im += out[i].imag + out[i + 1].imag;
+        }
     }
-    
-    twiddle_table_size = max_size;
-    twiddle_table = (Complex*)malloc(max_size * sizeof(Complex));
-    
-    for (int i = 0; i < max_size; i++) {
-        double angle = -2.0 * M_PI * i / max_size;
-        twiddle_table[i].real = fast_cos(angle);
-        twiddle_table[i].imag = fast_sin(angle);
+    for (; i < n; i++) {
+        if (!mask[i]) { out[i].real = out[i].imag = 0.0; continue; }
+        const double x = k * opd[i];
+        const double a = amp ? amp[i] : 1.0;
+        double sx, cx;
+        if (tier != PSF_TRIG_EXACT && fabs(x) <= PSF_SINCOS_REDUCE_MAX) {
+            psv2 sv, cv;
+            psf_sincos2(psv_splat(x), fast, &sv, &cv);
+            sx = psv_lane(sv, 0);
+            cx = psv_lane(cv, 0);
+        } else {
+            psf_sincos_slow(x, &sx, &cx);
+        }
+        out[i].real = a * cx;
+        out[i].imag = a * sx;
+        amp_sum += a;
+        sum_re += out[i].real;
+        sum_im += out[i].imag;
     }
+    if (sums) {
+        sums->amp_sum = amp_sum;
+        sums->re = sum_re;
+        sums->im = sum_im;
+    }
+}
+
+/*
+ * =============================================================================
+ * FFT プラン（サイズごとにビット反転表・正確な回転因子を事前計算して再利用）
+ * =============================================================================
+ *
+ * - 回転因子は libm の cos/sin で求める（多項式 sincos の丸め誤差も持ち込まない）
+ * - バタフライは radix-2²（2 段の radix-2 を 1 パスに融合した radix-4 型）。log2(n) が奇数なら
+ *   最初に radix-2 を 1 段だけ行う。
+ * - プランはサイズごとにキャッシュし、calculate_psf_wasm / calculate_psf_grid_wasm の
+ *   繰り返し呼び出し（最適化ループ内で同一サイズ）では構築コストがかからない。
+ * - 実行は読み取り専用なので、同じプランを複数スレッドから同時に使ってよい。
+ */
+typedef struct psf_fft_plan {
+    int n;
+    int log2n;
+    int swap_count;
+    int* swaps;          // ビット反転の交換ペア（i < j のみ, 2*swap_count 要素）
+    Complex* twiddle;    // W_n^k = exp(-2πik/n), k = 0..n/2-1
+    struct psf_fft_plan* half;  // 実数入力用（n/2 点の複素プラン）
+    Complex* real_twiddle;      // 実数入力の分離用 exp(-2πik/n), k = 0..n/2-1（= twiddle と同じ値を共有）
+} psf_fft_plan;
+
+static int psf_fft_log2(int n) {
+    if (n <= 0 || (n & (n - 1)) != 0) return -1;
+    int l = 0;
+    while ((1 << l) < n) l++;
+    return l;
 }
 
+void psf_fft_plan_destroy(psf_fft_plan* plan);
+
 /**
- * 分割統治FFT（大サイズ用最適化）
- * @param data 複素数配列
- * @param n サイズ（2の冪乗）
- * @param inverse 0:順変換, 1:逆変換
+ * FFT プラン作成
+ * @param size 点数（2 の冪）
+ * @return プラン（size 不正・メモリ不足時は NULL）
  */
-void fft_1d_divide_conquer(Complex* data, int n, int inverse) {
-    if (n <= 1) return;
-    
-    // 小さなサイズは従来のFFTを使用
-    if (n <= 64) {
-        fft_1d_iterative(data, n, inverse);
-        return;
-    }
-    
-    // 分割統治アプローチ
-    const int half = n / 2;
-    Complex* even = (Complex*)malloc(half * sizeof(Complex));
-    Complex* odd = (Complex*)malloc(half * sizeof(Complex));
-    
-    if (!even || !odd) {
-        if (even) free(even);
-        if (odd) free(odd);
-        return;
-    }
-    
-    // 偶数・奇数に分割
-    for (int i = 0; i < half; i++) {
-        even[i] = data[2 * i];
-        odd[i] = data[2 * i + 1];
+psf_fft_plan* psf_fft_plan_create(int size) {
+    const int log2n = psf_fft_log2(size);
+    if (log2n < 0) return NULL;
+
+    psf_fft_plan* plan = (psf_fft_plan*)calloc(1, sizeof(psf_fft_plan));
+    if (!plan) return NULL;
+    plan->n = size;
+    plan->log2n = log2n;
+
+    const int half = size / 2 > 0 ? size / 2 : 1;
+    plan->twiddle = (Complex*)malloc((size_t)half * sizeof(Complex));
+    plan->swaps = (int*)malloc((size_t)size * sizeof(int));
+    if (!plan->twiddle || !plan->swaps) {
+        psf_fft_plan_destroy(plan);
+        return NULL;
     }
-    
-    // 再帰的にFFT
-    fft_1d_divide_conquer(even, half, inverse);
-    fft_1d_divide_conquer(odd, half, inverse);
-    
-    // 結合
+
     for (int k = 0; k < half; k++) {
-        double angle = (inverse ? 2.0 : -2.0) * M_PI * k / n;
-        Complex w = {fast_cos(angle), fast_sin(angle)};
-        
-        Complex t = {
-            w.real * odd[k].real - w.imag * odd[k].imag,
-            w.real * odd[k].imag + w.imag * odd[k].real
-        };
-        
-        data[k] = (Complex){even[k].real + t.real, even[k].imag + t.imag};
-        data[k + half] = (Complex){even[k].real - t.real, even[k].imag - t.imag};
+        const double angle = -2.0 * M_PI * (double)k / (double)size;
+        plan->twiddle[k].real = cos(angle);
+        plan->twiddle[k].imag = sin(angle);
     }
-    
-    free(even);
-    free(odd);
+    plan->real_twiddle = plan->twiddle;
+
+    int count = 0;
+    for (int i = 0; i < size; i++) {
+        int j = 0;
+        for (int b = 0; b < log2n; b++) {
+            if (i & (1 << b)) j |= 1 << (log2n - 1 - b);
+        }
+        if (i < j) {
+            plan->swaps[2 * count] = i;
+            plan->swaps[2 * count + 1] = j;
+            count++;
+        }
+    }
+    plan->swap_count = count;
+    return plan;
+}
+
+void psf_fft_plan_destroy(psf_fft_plan* plan) {
+    if (!plan) return;
+    if (plan->half) psf_fft_plan_destroy(plan->half);
+    free(plan->swaps);
+    free(plan->twiddle);
+    free(plan);
 }
 
 /**
- * 反復版FFT（小サイズ用）
+ * 複素 FFT 実行（インプレース）
+ * @param inverse 0:順変換, 1:逆変換（1/n 正規化あり）
  */
-void fft_1d_iterative(Complex* data, int n, int inverse) {
-    // 必要に応じてテーブル初期化
-    if (!twiddle_table || twiddle_table_size < n) {
-        init_twiddle_table(n);
+void psf_fft_plan_execute(const psf_fft_plan* plan, Complex* data, int inverse) {
+    const int n = plan->n;
+    if (n <= 1) return;
+
+    for (int s = 0; s < plan->swap_count; s++) {
+        const int i = plan->swaps[2 * s];
+        const int j = plan->swaps[2 * s + 1];
+        Complex temp = data[i];
+        data[i] = data[j];
+        data[j] = temp;
     }
-    
-    // ビット反転（最適化版）
-    int j = 0;
-    for (int i = 1; i < n; i++) {
-        int bit = n >> 1;
-        while (j & bit) {
-            j ^= bit;
-            bit >>= 1;
-        }
-        j ^= bit;
-        
-        if (i < j) {
-            // SIMDフレンドリーなスワップ
-            Complex temp = data[i];
-            data[i] = data[j];
-            data[j] = temp;
+
+    const Complex* tw = plan->twiddle;
+    const double sgn = inverse ? -1.0 : 1.0;  // 逆変換は共役回転因子
+    int m = 1;  // 次に処理する段の半長
+
+    // log2(n) が奇数: radix-2 を 1 段（回転因子は 1）
+    if (plan->log2n & 1) {
+        for (int i = 0; i < n; i += 2) {
+            Complex a = data[i], b = data[i + 1];
+            data[i].real = a.real + b.real;
+            data[i].imag = a.imag + b.imag;
+            data[i + 1].real = a.real - b.real;
+            data[i + 1].imag = a.imag - b.imag;
         }
+        m = 2;
     }
-    
-    // FFT計算（テーブル参照版）
-    for (int len = 2; len <= n; len <<= 1) {
-        int step = n / len;
-        
-        for (int i = 0; i < n; i += len) {
-            for (int j = 0; j < len / 2; j++) {
-                // テーブル参照
-                int twiddle_idx = j * step;
-                if (inverse) twiddle_idx = n - twiddle_idx;
-                if (twiddle_idx >= n) twiddle_idx -= n;
-                
-                Complex w = twiddle_table[twiddle_idx];
-                
-                Complex u = data[i + j];
-                Complex v = {
-                    data[i + j + len / 2].real * w.real - data[i + j + len / 2].imag * w.imag,
-                    data[i + j + len / 2].real * w.imag + data[i + j + len / 2].imag * w.real
-                };
-                
-                // バタフライ演算（SIMDフレンドリー）
-                data[i + j].real = u.real + v.real;
-                data[i + j].imag = u.imag + v.imag;
-                data[i + j + len / 2].real = u.real - v.real;
-                data[i + j + len / 2].imag = u.imag - v.imag;
+
+    // radix-2²: 半長 m の段と 2m の段を融合（4m 点ごとのバタフライ）
+    for (; m < n; m <<= 2) {
+        const int len = m * 4;
+        const int step2 = n / len;       // W_{4m}^k = tw[k * step2]
+        const int step1 = step2 * 2;     // W_{2m}^k = tw[k * step1]
+        for (int base = 0; base < n; base += len) {
+            Complex* x0 = data + base;
+            Complex* x1 = x0 + m;
+            Complex* x2 = x1 + m;
+            Complex* x3 = x2 + m;
+            for (int k = 0; k < m; k++) {
+                const double w1r = tw[k * step1].real, w1i = sgn * tw[k * step1].imag;
+                const double w2r = tw[k * step2].real, w2i = sgn * tw[k * step2].imag;
+
+                // 段 1（半長 m）: (x0,x1) と (x2,x3)
+                const double t1r = x1[k].real * w1r - x1[k].imag * w1i;
+                const double t1i = x1[k].real * w1i + x1[k].imag * w1r;
+                const double t3r = x3[k].real * w1r - x3[k].imag * w1i;
+                const double t3i = x3[k].real * w1i + x3[k].imag * w1r;
+                const double a0r = x0[k].real + t1r, a0i = x0[k].imag + t1i;
+                const double a1r = x0[k].real - t1r, a1i = x0[k].imag - t1i;
+                const double b0r = x2[k].real + t3r, b0i = x2[k].imag + t3i;
+                const double b1r = x2[k].real - t3r, b1i = x2[k].imag - t3i;
+
+                // 段 2（半長 2m）: W_{4m}^{k+m} = W_{4m}^k · (∓i)
+                const double c0r = b0r * w2r - b0i * w2i;
+                const double c0i = b0r * w2i + b0i * w2r;
+                const double d0r = b1r * w2r - b1i * w2i;
+                const double d0i = b1r * w2i + b1i * w2r;
+                const double c1r = sgn * d0i;    // (-i)·d（順）/ (+i)·d（逆）
+                const double c1i = -sgn * d0r;
+
+                x0[k].real = a0r + c0r; x0[k].imag = a0i + c0i;
+                x2[k].real = a0r - c0r; x2[k].imag = a0i - c0i;
+                x1[k].real = a1r + c1r; x1[k].imag = a1i + c1i;
+                x3[k].real = a1r - c1r; x3[k].imag = a1i - c1i;
             }
         }
     }
-    
-    // 逆変換の場合は正規化
+
     if (inverse) {
-        double inv_n = 1.0 / n;
+        const double inv_n = 1.0 / n;
         for (int i = 0; i < n; i++) {
             data[i].real *= inv_n;
             data[i].imag *= inv_n;
@@ -318,70 +486,112 @@ void fft_1d_iterative(Complex* data, int n, int inverse) {
 }
 
 /**
- * 最適化された1D FFT（基本版に戻す）
+ * 実数入力の順 FFT（n/2 点の複素 FFT + 分離）
+ * @param in 実数入力（n 要素）
+ * @param out 出力スペクトル（n/2 + 1 要素, 残りはエルミート対称）
+ * @param scratch 作業領域（n/2 要素の Complex）
+ * @return 0: 成功 / -1: n < 2 またはメモリ不足
  */
-void fft_1d(Complex* data, int n, int inverse) {
-    if (n <= 1) return;
-    
-    // 必要に応じてテーブル初期化
-    if (!twiddle_table || twiddle_table_size < n) {
-        init_twiddle_table(n);
+int psf_fft_plan_execute_real(psf_fft_plan* plan, const double* in, Complex* out, Complex* scratch) {
+    const int n = plan->n;
+    if (n < 2) return -1;
+    const int h = n / 2;
+    if (!plan->half) {
+        plan->half = psf_fft_plan_create(h);
+        if (!plan->half) return -1;
     }
-    
-    // ビット反転（最適化版）
-    int j = 0;
-    for (int i = 1; i < n; i++) {
-        int bit = n >> 1;
-        while (j & bit) {
-            j ^= bit;
-            bit >>= 1;
-        }
-        j ^= bit;
-        
-        if (i < j) {
-            // SIMDフレンドリーなスワップ
-            Complex temp = data[i];
-            data[i] = data[j];
-            data[j] = temp;
-        }
+
+    // 偶数/奇数サンプルを実部/虚部に詰めて n/2 点 FFT
+    for (int k = 0; k < h; k++) {
+        scratch[k].real = in[2 * k];
+        scratch[k].imag = in[2 * k + 1];
     }
-    
-    // FFT計算（テーブル参照版）
-    for (int len = 2; len <= n; len <<= 1) {
-        int step = n / len;
-        
-        for (int i = 0; i < n; i += len) {
-            for (int j = 0; j < len / 2; j++) {
-                // テーブル参照
-                int twiddle_idx = j * step;
-                if (inverse) twiddle_idx = n - twiddle_idx;
-                if (twiddle_idx >= n) twiddle_idx -= n;
-                
-                Complex w = twiddle_table[twiddle_idx];
-                
-                Complex u = data[i + j];
-                Complex v = {
-                    data[i + j + len / 2].real * w.real - data[i + j + len / 2].imag * w.imag,
-                    data[i + j + len / 2].real * w.imag + data[i + j + len / 2].imag * w.real
-                };
-                
-                // バタフライ演算（SIMDフレンドリー）
-                data[i + j].real = u.real + v.real;
-                data[i + j].imag = u.imag + v.imag;
-                data[i + j + len / 2].real = u.real - v.real;
-                data[i + j + len / 2].imag = u.imag - v.imag;
-            }
+    psf_fft_plan_execute(plan->half, scratch, 0);
+
+    // X[k] = E[k] + W_n^k O[k],  E = (Z[k] + conj(Z[h-k]))/2,  O = (Z[k] - conj(Z[h-k]))/(2i)
+    out[0].real = scratch[0].real + scratch[0].imag;
+    out[0].imag = 0.0;
+    out[h].real = scratch[0].real - scratch[0].imag;
+    out[h].imag = 0.0;
+    for (int k = 1; k < h; k++) {
+        const Complex z = scratch[k];
+        const Complex zc = { scratch[h - k].real, -scratch[h - k].imag };
+        const double er = 0.5 * (z.real + zc.real), ei = 0.5 * (z.imag + zc.imag);
+        const double or_ = 0.5 * (z.imag - zc.imag), oi = -0.5 * (z.real - zc.real);
+        const Complex w = plan->real_twiddle[k];
+        out[k].real = er + (w.real * or_ - w.imag * oi);
+        out[k].imag = ei + (w.real * oi + w.imag * or_);
+    }
+    return 0;
+}
+
+// サイズ別プランキャッシュ（呼び出しスレッドでのみ更新する）
+#define PSF_FFT_PLAN_CACHE_SIZE 8
+static psf_fft_plan* fft_plan_cache[PSF_FFT_PLAN_CACHE_SIZE];
+static int fft_plan_cache_next = 0;
+
+/**
+ * キャッシュ済みプランの取得（なければ作成。満杯時は古いものから置換）
+ */
+static psf_fft_plan* psf_fft_plan_get(int n) {
+    static int last_slot = -1;  // 直近に返したプラン（fft_2d の行/列プランを同時に保持するため置換対象外）
+    for (int i = 0; i < PSF_FFT_PLAN_CACHE_SIZE; i++) {
+        if (fft_plan_cache[i] && fft_plan_cache[i]->n == n) {
+            last_slot = i;
+            return fft_plan_cache[i];
         }
     }
-    
-    // 逆変換の場合は正規化
-    if (inverse) {
-        double inv_n = 1.0 / n;
-        for (int i = 0; i < n; i++) {
-            data[i].real *= inv_n;
-            data[i].imag *= inv_n;
+    psf_fft_plan* plan = psf_fft_plan_create(n);
+    if (!plan) return NULL;
+    int slot = -1;
+    for (int i = 0; i < PSF_FFT_PLAN_CACHE_SIZE; i++) {
+        if (!fft_plan_cache[i]) { slot = i; break; }
+    }
+    if (slot < 0) {
+        if (fft_plan_cache_next == last_slot) {
+            fft_plan_cache_next = (fft_plan_cache_next + 1) % PSF_FFT_PLAN_CACHE_SIZE;
         }
+        slot = fft_plan_cache_next;
+        fft_plan_cache_next = (fft_plan_cache_next + 1) % PSF_FFT_PLAN_CACHE_SIZE;
+        psf_fft_plan_destroy(fft_plan_cache[slot]);
     }
+    fft_plan_cache[slot] = plan;
+    last_slot = slot;
+    return plan;
+}
+
+static void psf_fft_plan_cache_clear(void) {
+    for (int i = 0; i < PSF_FFT_PLAN_CACHE_SIZE; i++) {
+        psf_fft_plan_destroy(fft_plan_cache[i]);
+        fft_plan_cache[i] = NULL;
+    }
+    fft_plan_cache_next = 0;
+}
+
+/**
+ * 分割統治FFT（旧API互換: プラン版に委譲）
+ * @param data 複素数配列
+ * @param n サイズ（2の冪乗）
+ * @param inverse 0:順変換, 1:逆変換
+ */
+void fft_1d_divide_conquer(Complex* data, int n, int inverse) {
+    fft_1d(data, n, inverse);
+}
+
+/**
+ * 反復版FFT（旧API互換: プラン版に委譲）
+ */
+void fft_1d_iterative(Complex* data, int n, int inverse) {
+    fft_1d(data, n, inverse);
+}
+
+/**
+ * 1D FFT（キャッシュ済みプランで実行）
+ */
+void fft_1d(Complex* data, int n, int inverse) {
+    if (n <= 1) return;
+    const psf_fft_plan* plan = psf_fft_plan_get(n);
+    if (plan) psf_fft_plan_execute(plan, data, inverse);
 }
 
 /**
@@ -418,6 +628,52 @@ void transpose_complex_inplace(Complex* data, int size) {
     }
 }
 
+/**
+ * fft_2d の行パス／転置パスの並列タスク（pthreads 無効時は逐次）
+ */
+typedef struct {
+    Complex* base;
+    const psf_fft_plan* plan;
+    int inverse;
+} fft_rows_task;
+
+static void fft_rows_range(int begin, int end, void* ctx) {
+    const fft_rows_task* t = (const fft_rows_task*)ctx;
+    const int n = t->plan->n;
+    for (int i = begin; i < end; i++) {
+        psf_fft_plan_execute(t->plan, t->base + (size_t)i * n, t->inverse);
+    }
+}
+
+typedef struct {
+    Complex* src;
+    Complex* dst;
+    int width;
+    int height;
+} transpose_task;
+
+// 転置を src の行ブロック単位で分割（dst の書き込み列が重ならない）
+static void transpose_rows_range(int begin, int end, void* ctx) {
+    const transpose_task* t = (const transpose_task*)ctx;
+    const int BLOCK_SIZE = (t->width >= 256 && t->height >= 256) ? 64 : 32;
+    for (int i = begin; i < end; i += BLOCK_SIZE) {
+        int max_i = (i + BLOCK_SIZE < end) ? i + BLOCK_SIZE : end;
+        for (int j = 0; j < t->width; j += BLOCK_SIZE) {
+            int max_j = (j + BLOCK_SIZE < t->width) ? j + BLOCK_SIZE : t->width;
+            for (int ii = i; ii < max_i; ii++) {
+                for (int jj = j; jj < max_j; jj++) {
+                    t->dst[(size_t)jj * t->height + ii] = t->src[(size_t)ii * t->width + jj];
+                }
+            }
+        }
+    }
+}
+
+static void transpose_complex_parallel(Complex* src, Complex* dst, int width, int height) {
+    transpose_task t = { src, dst, width, height };
+    coopt_parallel_for(0, height, 64, transpose_rows_range, &t);
+}
+
 /**
  * 基本2D FFT（正方形専用、安定版）
  * @param data 複素数配列（width × height）
@@ -432,21 +688,24 @@ void fft_2d(Complex* data, int width, int height, int inverse) {
     ensure_fft_temp_buffer((size_t)W * (size_t)H);
     if (!fft_temp_buffer) return;
 
-    // 行方向FFT（長さ W）
-    for (int i = 0; i < H; i++) {
-        fft_1d(data + i * W, W, inverse);
-    }
+    // プランはキャッシュ更新を伴うため並列パスの前に（呼び出しスレッドで）取得する
+    const psf_fft_plan* plan_w = psf_fft_plan_get(W);
+    const psf_fft_plan* plan_h = psf_fft_plan_get(H);
+    if (!plan_w || !plan_h) return;
+
+    // 行方向FFT（長さ W）: 行ごとに独立なのでスレッド分割
+    fft_rows_task rows = { data, plan_w, inverse };
+    coopt_parallel_for(0, H, 8, fft_rows_range, &rows);
 
     // 転置 data[H][W] -> temp[W][H]
-    transpose_complex(data, fft_temp_buffer, W, H);
+    transpose_complex_parallel(data, fft_temp_buffer, W, H);
 
     // 列方向FFT（転置後は行方向、長さ H）
-    for (int i = 0; i < W; i++) {
-        fft_1d(fft_temp_buffer + i * H, H, inverse);
-    }
+    fft_rows_task cols = { fft_temp_buffer, plan_h, inverse };
+    coopt_parallel_for(0, W, 8, fft_rows_range, &cols);
 
     // 逆転置 temp[W][H] -> data[H][W]
-    transpose_complex(fft_temp_buffer, data, H, W);
+    transpose_complex_parallel(fft_temp_buffer, data, H, W);
 }
 
 /**
@@ -461,100 +720,377 @@ void fft_2d(Complex* data, int width, int height, int inverse) {
 void calculate_complex_amplitude(double* opd, double* amplitude, int* pupil_mask, 
                                 Complex* output, int size, double wavelength) {
     const double k = 2.0 * M_PI / wavelength;
-    const int total_size = size * size;
-    
-    // 高速三角関数テーブルを初期化（必要に応じて）
-    if (!sin_table || trig_table_size < total_size) {
-        init_fast_trig_tables(total_size);
+    psf_phase_to_complex(opd, amplitude, pupil_mask, k, output, size * size, NULL);
+}
+
+/*
+ * 光線位置の一様バケット索引（interpolate_opd_grid 1 回ごとに構築, 読み取り専用で全スレッド共有）
+ * counting sort で items をセル順に並べ、cell_start[c]..cell_start[c+1] がセル c の光線。
+ */
+typedef struct {
+    int nx, ny;
+    double x0, y0;
+    double cw, ch;          // セル幅
+    double inv_cw, inv_ch;
+    int* cell_start;        // nx*ny + 1
+    int* items;             // ray_count
+} opd_ray_index;
+
+static void opd_ray_index_free(opd_ray_index* idx) {
+    free(idx->cell_start);
+    free(idx->items);
+    idx->cell_start = NULL;
+    idx->items = NULL;
+}
+
+static inline int opd_ray_index_cell(const opd_ray_index* idx, double x, double y, int* cx, int* cy) {
+    int ix = (int)floor((x - idx->x0) * idx->inv_cw);
+    int iy = (int)floor((y - idx->y0) * idx->inv_ch);
+    if (ix < 0) ix = 0;
+    if (ix >= idx->nx) ix = idx->nx - 1;
+    if (iy < 0) iy = 0;
+    if (iy >= idx->ny) iy = idx->ny - 1;
+    *cx = ix;
+    *cy = iy;
+    return iy * idx->nx + ix;
+}
+
+/**
+ * 索引の構築（セルあたり平均 2 光線程度）
+ * @return 0: 成功 / -1: メモリ不足（呼び出し側は総当たりにフォールバック）
+ */
+static int opd_ray_index_build(opd_ray_index* idx, const double* ray_x, const double* ray_y, int ray_count) {
+    memset(idx, 0, sizeof(*idx));
+    if (ray_count <= 0) return -1;
+
+    double min_x = ray_x[0], max_x = ray_x[0], min_y = ray_y[0], max_y = ray_y[0];
+    for (int k = 1; k < ray_count; k++) {
+        if (ray_x[k] < min_x) min_x = ray_x[k];
+        if (ray_x[k] > max_x) max_x = ray_x[k];
+        if (ray_y[k] < min_y) min_y = ray_y[k];
+        if (ray_y[k] > max_y) max_y = ray_y[k];
     }
-    
-    // 分岐予測を避けるため、マスクされた要素を先に処理
-    // 1. 全要素をゼロ初期化
-    memset(output, 0, total_size * sizeof(Complex));
-    
-    // 2. 有効な要素のみを処理（分岐なし）
-    for (int i = 0; i < total_size; i++) {
-        if (pupil_mask[i]) {
-            double phase = k * opd[i];
-            double amp = amplitude[i];
-            
-            // 高速三角関数を使用
-            output[i].real = amp * fast_cos(phase);
-            output[i].imag = amp * fast_sin(phase);
+
+    int side = (int)ceil(sqrt(ray_count * 0.5));
+    if (side < 1) side = 1;
+    if (side > 1024) side = 1024;
+    idx->nx = side;
+    idx->ny = side;
+    idx->x0 = min_x;
+    idx->y0 = min_y;
+    idx->cw = (max_x > min_x) ? (max_x - min_x) / side : 1.0;
+    idx->ch = (max_y > min_y) ? (max_y - min_y) / side : 1.0;
+    idx->inv_cw = 1.0 / idx->cw;
+    idx->inv_ch = 1.0 / idx->ch;
+
+    const int cells = idx->nx * idx->ny;
+    idx->cell_start = (int*)calloc((size_t)cells + 1, sizeof(int));
+    idx->items = (int*)malloc((size_t)ray_count * sizeof(int));
+    int* cell_of = (int*)malloc((size_t)ray_count * sizeof(int));
+    if (!idx->cell_start || !idx->items || !cell_of) {
+        free(cell_of);
+        opd_ray_index_free(idx);
+        return -1;
+    }
+
+    int cx, cy;
+    for (int k = 0; k < ray_count; k++) {
+        cell_of[k] = opd_ray_index_cell(idx, ray_x[k], ray_y[k], &cx, &cy);
+        idx->cell_start[cell_of[k] + 1]++;
+    }
+    for (int c = 0; c < cells; c++) {
+        idx->cell_start[c + 1] += idx->cell_start[c];
+    }
+    // 安定な配置（セル内は光線番号の昇順 → 同距離時の選択が総当たり版と一致）
+    int* fill = (int*)malloc((size_t)cells * sizeof(int));
+    if (!fill) {
+        free(cell_of);
+        opd_ray_index_free(idx);
+        return -1;
+    }
+    memcpy(fill, idx->cell_start, (size_t)cells * sizeof(int));
+    for (int k = 0; k < ray_count; k++) {
+        idx->items[fill[cell_of[k]]++] = k;
+    }
+    free(fill);
+    free(cell_of);
+    return 0;
+}
+
+// 探索済み正方形 [cx-r, cx+r]×[cy-r, cy+r] の外側（未探索セルが残る辺のみ）までの最短距離。
+// 全セル探索済みなら LARGE_NUMBER。
+static inline double opd_ray_index_ring_clearance(const opd_ray_index* idx, double x, double y,
+                                                  int cx, int cy, int r) {
+    double d = LARGE_NUMBER;
+    double t;
+    if (cx - r > 0) {
+        t = x - (idx->x0 + (cx - r) * idx->cw);
+        if (t < d) d = t;
+    }
+    if (cx + r < idx->nx - 1) {
+        t = (idx->x0 + (cx + r + 1) * idx->cw) - x;
+        if (t < d) d = t;
+    }
+    if (cy - r > 0) {
+        t = y - (idx->y0 + (cy - r) * idx->ch);
+        if (t < d) d = t;
+    }
+    if (cy + r < idx->ny - 1) {
+        t = (idx->y0 + (cy + r + 1) * idx->ch) - y;
+        if (t < d) d = t;
+    }
+    return d;
+}
+
+#define OPD_KNN_FIRST 8   // 重心座標補間の候補数（含む三角形がなければ OPD_KNN_MAX まで拡張）
+#define OPD_KNN_MAX 16
+
+/**
+ * k 近傍探索（距離昇順, 同距離は光線番号昇順）
+ * @return 見つかった数（<= k）
+ */
+static int opd_ray_index_knn(const opd_ray_index* idx, const double* ray_x, const double* ray_y,
+                             int ray_count, double x, double y, int k,
+                             int* out_id, double* out_d2) {
+    int cx, cy;
+    opd_ray_index_cell(idx, x, y, &cx, &cy);
+    if (k > ray_count) k = ray_count;
+    int found = 0;
+    const int r_max = (idx->nx > idx->ny ? idx->nx : idx->ny);
+
+    for (int r = 0; r <= r_max; r++) {
+        const int y_lo = cy - r, y_hi = cy + r;
+        const int x_lo = cx - r, x_hi = cx + r;
+        for (int gy = y_lo; gy <= y_hi; gy++) {
+            if (gy < 0 || gy >= idx->ny) continue;
+            // リングの外周セルのみ（内側は探索済み）
+            const int step = (gy == y_lo || gy == y_hi) ? 1 : (x_hi - x_lo);
+            for (int gx = x_lo; gx <= x_hi; gx += (step > 0 ? step : 1)) {
+                if (gx < 0 || gx >= idx->nx) continue;
+                const int c = gy * idx->nx + gx;
+                for (int p = idx->cell_start[c]; p < idx->cell_start[c + 1]; p++) {
+                    const int id = idx->items[p];
+                    const double dx = ray_x[id] - x;
+                    const double dy = ray_y[id] - y;
+                    const double d2 = dx * dx + dy * dy;
+                    if (found == k && (d2 > out_d2[k - 1] || (d2 == out_d2[k - 1] && id > out_id[k - 1]))) {
+                        continue;
+                    }
+                    int pos = (found < k) ? found++ : k - 1;
+                    while (pos > 0 && (out_d2[pos - 1] > d2 || (out_d2[pos - 1] == d2 && out_id[pos - 1] > id))) {
+                        out_d2[pos] = out_d2[pos - 1];
+                        out_id[pos] = out_id[pos - 1];
+                        pos--;
+                    }
+                    out_d2[pos] = d2;
+                    out_id[pos] = id;
+                }
+            }
         }
+        const double clear = opd_ray_index_ring_clearance(idx, x, y, cx, cy, r);
+        if (clear >= LARGE_NUMBER) break;
+        if (found == k && clear > 0.0 && out_d2[k - 1] <= clear * clear) break;
     }
+    return found;
 }
 
 /**
- * 最適化されたOPD格子補間
- * @param ray_x 光線X座標
- * @param ray_y 光線Y座標
- * @param ray_opd 光線OPD
- * @param ray_count 光線数
- * @param grid_opd 出力格子OPD
- * @param pupil_mask 瞳マスク
- * @param grid_size 格子サイズ
- * @param min_x,max_x,min_y,max_y 座標範囲
+ * k 近傍から点を含む三角形を選び重心座標で補間する（局所 Delaunay 近似）。
+ * 外接円が他の近傍点を含まない三角形を優先し、その中で辺長二乗和が最小のものを使う。
+ * @return 1: 補間成功 / 0: 含む三角形なし（開口外周など → 呼び出し側で最近傍）
  */
-void interpolate_opd_grid(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
-                         double* grid_opd, int* pupil_mask, int grid_size,
-                         double min_x, double max_x, double min_y, double max_y) {
+static int opd_barycentric_from_knn(const double* ray_x, const double* ray_y, const double* ray_opd,
+                                    const int* ids, int n, double x, double y, double* out) {
+    double best_score = LARGE_NUMBER;
+    int best_delaunay = 0;
+    int found = 0;
+    double best_value = 0.0;
+    const double eps = -1e-12;
+
+    for (int a = 0; a < n - 2; a++) {
+        for (int b = a + 1; b < n - 1; b++) {
+            for (int c = b + 1; c < n; c++) {
+                const double ax = ray_x[ids[a]], ay = ray_y[ids[a]];
+                const double bx = ray_x[ids[b]], by = ray_y[ids[b]];
+                const double qx = ray_x[ids[c]], qy = ray_y[ids[c]];
+                const double det = (bx - ax) * (qy - ay) - (qx - ax) * (by - ay);
+                const double e2 = (bx - ax) * (bx - ax) + (by - ay) * (by - ay)
+                                + (qx - bx) * (qx - bx) + (qy - by) * (qy - by)
+                                + (ax - qx) * (ax - qx) + (ay - qy) * (ay - qy);
+                if (fabs(det) <= 1e-12 * e2) continue;  // 退化（共線）
+                const double inv = 1.0 / det;
+                const double wb = ((x - ax) * (qy - ay) - (qx - ax) * (y - ay)) * inv;
+                const double wc = ((bx - ax) * (y - ay) - (x - ax) * (by - ay)) * inv;
+                const double wa = 1.0 - wb - wc;
+                if (wa < eps || wb < eps || wc < eps) continue;
+
+                // 外接円の空円判定（近傍点のみ）
+                const double d = 2.0 * det;
+                const double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by, q2 = qx * qx + qy * qy;
+                const double ux = (a2 * (by - qy) + b2 * (qy - ay) + q2 * (ay - by)) / d;
+                const double uy = (a2 * (qx - bx) + b2 * (ax - qx) + q2 * (bx - ax)) / d;
+                const double rr = (ax - ux) * (ax - ux) + (ay - uy) * (ay - uy);
+                int delaunay = 1;
+                for (int m = 0; m < n && delaunay; m++) {
+                    if (m == a || m == b || m == c) continue;
+                    const double mx = ray_x[ids[m]] - ux, my = ray_y[ids[m]] - uy;
+                    if (mx * mx + my * my < rr * (1.0 - 1e-9)) delaunay = 0;
+                }
+
+                if (!found || (delaunay > best_delaunay) || (delaunay == best_delaunay && e2 < best_score)) {
+                    found = 1;
+                    best_delaunay = delaunay;
+                    best_score = e2;
+                    best_value = wa * ray_opd[ids[a]] + wb * ray_opd[ids[b]] + wc * ray_opd[ids[c]];
+                }
+            }
+        }
+    }
+    if (found) *out = best_value;
+    return found;
+}
+
+typedef struct {
+    const double* ray_x;
+    const double* ray_y;
+    const double* ray_opd;
+    int ray_count;
+    double* grid_opd;
+    int* pupil_mask;
+    int grid_size;
+    double min_x, min_y, x_range, y_range;
+    double inv_grid_size_minus_1;
+    double max_radius_sq;
+    const opd_ray_index* index;  // NULL: 総当たり最近傍
+    int interp_mode;
+} interp_task;
+
+// 総当たり最近傍（索引が構築できない場合のフォールバック）
+static double interpolate_opd_nearest_scan(const interp_task* t, double grid_x, double grid_y) {
+    // 高速最近傍補間（早期終了付き）
+    double min_dist_sq = LARGE_NUMBER;
+    double interpolated_opd = 0.0;
     
-    const double inv_grid_size_minus_1 = 1.0 / (grid_size - 1);
-    const double x_range = max_x - min_x;
-    const double y_range = max_y - min_y;
-    const double max_radius = fmax(fabs(max_x), fabs(max_y));
-    const double max_radius_sq = max_radius * max_radius;
+    // 十分近い点が見つかったら早期終了
+    const double early_exit_threshold = 1e-8;
     
-    // 空間分割による高速化（簡易版）
-    for (int i = 0; i < grid_size; i++) {
-        double grid_x = min_x + x_range * i * inv_grid_size_minus_1;
+    for (int k = 0; k < t->ray_count; k++) {
+        double dx = t->ray_x[k] - grid_x;
+        double dy = t->ray_y[k] - grid_y;
+        double dist_sq = dx * dx + dy * dy;
+        
+        if (dist_sq < min_dist_sq) {
+            min_dist_sq = dist_sq;
+            interpolated_opd = t->ray_opd[k];
+            
+            // 十分近い場合は早期終了
+            if (dist_sq < early_exit_threshold) {
+                break;
+            }
+        }
+    }
+    return interpolated_opd;
+}
+
+// 格子行 [begin, end) の補間（行ごとに出力が独立）
+static void interpolate_opd_rows(int begin, int end, void* ctx) {
+    const interp_task* t = (const interp_task*)ctx;
+    const int grid_size = t->grid_size;
+    const int k = (t->interp_mode == PSF_INTERP_BARYCENTRIC) ? OPD_KNN_FIRST : 1;
+    int ids[OPD_KNN_MAX];
+    double d2[OPD_KNN_MAX];
+
+    for (int i = begin; i < end; i++) {
+        double grid_x = t->min_x + t->x_range * i * t->inv_grid_size_minus_1;
         
         for (int j = 0; j < grid_size; j++) {
-            double grid_y = min_y + y_range * j * inv_grid_size_minus_1;
+            double grid_y = t->min_y + t->y_range * j * t->inv_grid_size_minus_1;
             
             // 円形瞳の範囲内かチェック（平方根計算を避ける）
             double radius_sq = grid_x * grid_x + grid_y * grid_y;
             
             int index = i * grid_size + j;
             
-            if (radius_sq <= max_radius_sq) {
-                pupil_mask[index] = 1;
-                
-                // 高速最近傍補間（早期終了付き）
-                double min_dist_sq = LARGE_NUMBER;
-                double interpolated_opd = 0.0;
-                
-                // 十分近い点が見つかったら早期終了
-                const double early_exit_threshold = 1e-8;
-                
-                for (int k = 0; k < ray_count; k++) {
-                    double dx = ray_x[k] - grid_x;
-                    double dy = ray_y[k] - grid_y;
-                    double dist_sq = dx * dx + dy * dy;
-                    
-                    if (dist_sq < min_dist_sq) {
-                        min_dist_sq = dist_sq;
-                        interpolated_opd = ray_opd[k];
-                        
-                        // 十分近い場合は早期終了
-                        if (dist_sq < early_exit_threshold) {
-                            break;
+            if (radius_sq <= t->max_radius_sq) {
+                t->pupil_mask[index] = 1;
+
+                if (!t->index) {
+                    t->grid_opd[index] = interpolate_opd_nearest_scan(t, grid_x, grid_y);
+                    continue;
+                }
+
+                const int n = opd_ray_index_knn(t->index, t->ray_x, t->ray_y, t->ray_count,
+                                                grid_x, grid_y, k, ids, d2);
+                double value = (n > 0) ? t->ray_opd[ids[0]] : 0.0;
+                if (k > 1 && n >= 3 && d2[0] > 1e-16 &&
+                    !opd_barycentric_from_knn(t->ray_x, t->ray_y, t->ray_opd, ids, n, grid_x, grid_y, &value)) {
+                    int n2 = n;
+                    if (n == k) {
+                        n2 = opd_ray_index_knn(t->index, t->ray_x, t->ray_y, t->ray_count,
+                                               grid_x, grid_y, OPD_KNN_MAX, ids, d2);
+                    }
+                    if (!opd_barycentric_from_knn(t->ray_x, t->ray_y, t->ray_opd, ids, n2, grid_x, grid_y, &value)) {
+                        // 近傍に囲む三角形がない（光線の疎な領域・外周）: 逆距離加重で連続性を保つ
+                        double wsum = 0.0, vsum = 0.0;
+                        for (int q = 0; q < n2; q++) {
+                            const double w = 1.0 / d2[q];
+                            wsum += w;
+                            vsum += w * t->ray_opd[ids[q]];
                         }
+                        value = vsum / wsum;
                     }
                 }
-                
-                grid_opd[index] = interpolated_opd;
+                t->grid_opd[index] = value;
             } else {
-                pupil_mask[index] = 0;
-                grid_opd[index] = 0.0;
+                t->pupil_mask[index] = 0;
+                t->grid_opd[index] = 0.0;
             }
         }
     }
 }
 
 /**
- * Strehl比計算
+ * 最適化されたOPD格子補間
+ * @param ray_x 光線X座標
+ * @param ray_y 光線Y座標
+ * @param ray_opd 光線OPD
+ * @param ray_count 光線数
+ * @param grid_opd 出力格子OPD
+ * @param pupil_mask 瞳マスク
+ * @param grid_size 格子サイズ
+ * @param min_x,max_x,min_y,max_y 座標範囲
+ * @param interp_mode PSF_INTERP_NEAREST / PSF_INTERP_BARYCENTRIC
+ */
+void interpolate_opd_grid(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
+                         double* grid_opd, int* pupil_mask, int grid_size,
+                         double min_x, double max_x, double min_y, double max_y,
+                         int interp_mode) {
+    
+    const double max_radius = fmax(fabs(max_x), fabs(max_y));
+
+    // 光線の空間索引（O(grid² × rays) の総当たりを回避）
+    opd_ray_index ray_index;
+    const int have_index = (opd_ray_index_build(&ray_index, ray_x, ray_y, ray_count) == 0);
+
+    interp_task t = {
+        ray_x, ray_y, ray_opd, ray_count,
+        grid_opd, pupil_mask, grid_size,
+        min_x, min_y, max_x - min_x, max_y - min_y,
+        1.0 / (grid_size - 1),
+        max_radius * max_radius,
+        have_index ? &ray_index : NULL,
+        interp_mode
+    };
+
+    // 格子行ごとにスレッド分割（-pthread ビルド時）
+    coopt_parallel_for(0, grid_size, 4, interpolate_opd_rows, &t);
+
+    if (have_index) opd_ray_index_free(&ray_index);
+}
+
+/**
+ * Strehl比計算（旧 API: 呼び出し側で回折限界ピーク = 1 に正規化済みの PSF の中心画素）
+ * 正規化していない PSF には calculate_strehl_pupil_wasm / psf_last_strehl を使うこと。
  * @param psf PSF強度分布
  * @param size サイズ
  * @return Strehl比
@@ -570,44 +1106,1320 @@ double calculate_strehl_ratio(double* psf, int size) {
     return peak_value / theoretical_peak;
 }
 
-/**
- * エンサークルドエネルギー計算
- * @param psf PSF強度分布
+/*
+ * =============================================================================
+ * エネルギー分布（EE / ensquared / LSF を 1 パスのヒストグラムで）
+ * =============================================================================
+ *
+ * 半径をソートし、画素ごとに d² を二分探索で「d <= r となる最小の半径」のビンへ加算、
+ * 最後に累積和を取る。sqrt なし・半径数に依存しない O(N² log R)。
+ * 同じパスで Chebyshev 距離 max(|dx|,|dy|) を ensquared 用のビンへ入れる。
+ */
+#define PSF_CENTER_GRID      0   // 従来どおり (size/2, size/2)
+#define PSF_CENTER_CENTROID  1   // 強度重心（サブピクセル）
+#define PSF_CENTER_GIVEN     2   // center_row / center_col を使用
+
+// key[order[k]] 昇順の order を作る（半径数は小さいので挿入ソート）
+static void psf_sort_order(const double* key, int* order, int count) {
+    for (int k = 0; k < count; k++) {
+        int j = k;
+        while (j > 0 && key[order[j - 1]] > key[k]) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = k;
+    }
+}
+
+// sorted[0..count) 昇順で v <= sorted[idx] となる最小の idx（なければ count）
+static inline int psf_lower_bound(const double* sorted, int count, double v) {
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        const int mid = (lo + hi) >> 1;
+        if (sorted[mid] < v) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * EE / ensquared energy / LSF を 1 回の走査で計算する
+ * @param psf PSF強度分布（size × size, 行優先）
+ * @param radii 半径（画素単位, 任意順）。ensquared では正方形の半幅として使う
+ * @param center_mode PSF_CENTER_*
+ * @param ee_out 出力 EE（radii_count, 全エネルギーで正規化, NULL 可）
+ * @param es_out 出力 ensquared energy（radii_count, NULL 可）
+ * @param lsf_x_out 列和（size, x 方向の線像分布, 正規化, NULL 可）
+ * @param lsf_y_out 行和（size, y 方向の線像分布, 正規化, NULL 可）
+ * @param center_out 使用した中心 [row, col]（NULL 可）
+ * @return 0: 成功 / -1: 失敗
+ */
+int psf_energy_profile(const double* psf, int size, const double* radii, int radii_count,
+                       int center_mode, double center_row, double center_col,
+                       double* ee_out, double* es_out, double* lsf_x_out, double* lsf_y_out,
+                       double* center_out) {
+    if (!psf || size <= 0 || radii_count < 0 || (radii_count > 0 && !radii)) return -1;
+
+    // 1 パス目: 行和・列和（LSF と重心を兼ねる, sqrt なし）
+    double* row_sum = (double*)calloc((size_t)size * 2, sizeof(double));
+    int* order = (int*)malloc((size_t)(radii_count > 0 ? radii_count : 1) * sizeof(int));
+    double* sorted = (double*)malloc((size_t)(radii_count > 0 ? radii_count : 1) * 4 * sizeof(double));
+    if (!row_sum || !order || !sorted) {
+        free(row_sum); free(order); free(sorted);
+        return -1;
+    }
+    double* col_sum = row_sum + size;
+    double total = 0.0;
+    for (int i = 0; i < size; i++) {
+        const double* row = psf + (size_t)i * size;
+        double acc = 0.0;
+        for (int j = 0; j < size; j++) {
+            acc += row[j];
+            col_sum[j] += row[j];
+        }
+        row_sum[i] = acc;
+        total += acc;
+    }
+
+    double cr = size / 2, cc = size / 2;
+    if (center_mode == PSF_CENTER_GIVEN) {
+        cr = center_row;
+        cc = center_col;
+    } else if (center_mode == PSF_CENTER_CENTROID && total > 0.0) {
+        double mr = 0.0, mc = 0.0;
+        for (int i = 0; i < size; i++) {
+            mr += i * row_sum[i];
+            mc += i * col_sum[i];
+        }
+        cr = mr / total;
+        cc = mc / total;
+    }
+
+    // 2 パス目: 半径ビン（d² を r² と比較）と正方形ビン（max(|dx|,|dy|) を r と比較）
+    double* r2 = sorted;                      // 昇順の r²
+    double* rs = sorted + radii_count;        // 昇順の r
+    double* ee_bin = sorted + 2 * radii_count;
+    double* es_bin = sorted + 3 * radii_count;
+    if (radii_count > 0) {
+        psf_sort_order(radii, order, radii_count);
+        for (int k = 0; k < radii_count; k++) {
+            const double r = radii[order[k]];
+            rs[k] = r;
+            r2[k] = (r >= 0.0) ? r * r : -1.0;  // 負の半径は空
+            ee_bin[k] = 0.0;
+            es_bin[k] = 0.0;
+        }
+        for (int i = 0; i < size; i++) {
+            const double* row = psf + (size_t)i * size;
+            const double dx = i - cr;
+            const double dx2 = dx * dx;
+            const double adx = fabs(dx);
+            for (int j = 0; j < size; j++) {
+                const double v = row[j];
+                if (v == 0.0) continue;
+                const double dy = j - cc;
+                const int ke = psf_lower_bound(r2, radii_count, dx2 + dy * dy);
+                if (ke < radii_count) ee_bin[ke] += v;
+                const double cheb = adx > fabs(dy) ? adx : fabs(dy);
+                const int ks = psf_lower_bound(rs, radii_count, cheb);
+                if (ks < radii_count) es_bin[ks] += v;
+            }
+        }
+        const double inv = (total != 0.0) ? 1.0 / total : 0.0;
+        double ce = 0.0, cs = 0.0;
+        for (int k = 0; k < radii_count; k++) {
+            ce += ee_bin[k];
+            cs += es_bin[k];
+            if (ee_out) ee_out[order[k]] = ce * inv;
+            if (es_out) es_out[order[k]] = cs * inv;
+        }
+    }
+
+    const double inv = (total != 0.0) ? 1.0 / total : 0.0;
+    for (int k = 0; k < size; k++) {
+        if (lsf_x_out) lsf_x_out[k] = col_sum[k] * inv;
+        if (lsf_y_out) lsf_y_out[k] = row_sum[k] * inv;
+    }
+    if (center_out) {
+        center_out[0] = cr;
+        center_out[1] = cc;
+    }
+
+    free(row_sum);
+    free(order);
+    free(sorted);
+    return 0;
+}
+
+/**
+ * エンサークルドエネルギー計算（中心 size/2, dist <= radius を含む）
+ * @param psf PSF強度分布
  * @param size サイズ
  * @param radii 半径配列
  * @param energies 出力エネルギー配列
  * @param radii_count 半径数
  */
 void calculate_encircled_energy(double* psf, int size, double* radii, double* energies, int radii_count) {
-    int center = size / 2;
-    
-    // 全エネルギー計算
-    double total_energy = 0.0;
-    for (int i = 0; i < size * size; i++) {
-        total_energy += psf[i];
+    if (psf_energy_profile(psf, size, radii, radii_count, PSF_CENTER_GRID, 0.0, 0.0,
+                           energies, NULL, NULL, NULL, NULL) != 0) {
+        for (int r = 0; r < radii_count; r++) energies[r] = 0.0;
     }
-    
-    // 各半径でのエンサークルドエネルギー計算
-    for (int r = 0; r < radii_count; r++) {
-        double radius = radii[r];
-        double encircled = 0.0;
-        
-        for (int i = 0; i < size; i++) {
-            for (int j = 0; j < size; j++) {
-                double dx = i - center;
-                double dy = j - center;
-                double dist = sqrt(dx * dx + dy * dy);
-                
-                if (dist <= radius) {
-                    encircled += psf[i * size + j];
+}
+
+/*
+ * =============================================================================
+ * 出力窓指定の PSF（ゼロ詰め FFT 相当のサンプリングを窓内だけ評価）
+ * =============================================================================
+ *
+ * ゼロ詰めサイズ P = grid_size × pad_factor の FFT（FFTshift 後）のうち、中心
+ * (center_row, center_col)（P 点 FFT の画素単位, 0 = 主光線/DC）まわりの out_size² 画素だけを求める。
+ * - 行列フーリエ変換（MFT）: E = Wr · A · Wcᵀ（分離形, O(M·Nr·Nc + M²·Nr)）。
+ *   pad_factor・中心は非整数でもよい（任意の画素ピッチ）。
+ * - pad_factor が整数で P が 2 の冪、かつ MFT より安い場合はゼロ詰め FFT → 切り出し。
+ * 瞳マスクの外側の行・列は事前に詰めて計算から除く。
+ */
+#define PSF_WINDOW_MAX_FFT 2048   // ゼロ詰め FFT 経路の最大 P（P² Complex を確保するため）
+
+typedef struct {
+    const Complex* a;      // 詰めた瞳複素振幅（nr × nc）
+    const Complex* wc;     // 列カーネル（m × nc）
+    const Complex* wr;     // 行カーネル（m × nr）
+    Complex* tmp;          // tmp[j][q] = Σ_p a[q][p]·wc[j][p]（m × nr）
+    double* out;           // 出力強度（m × m）
+    int nr, nc, m;
+} psf_mft_task;
+
+static inline Complex psf_mft_dot(const Complex* x, const Complex* y, int n) {
+    double re = 0.0, im = 0.0;
+    for (int k = 0; k < n; k++) {
+        re += x[k].real * y[k].real - x[k].imag * y[k].imag;
+        im += x[k].real * y[k].imag + x[k].imag * y[k].real;
+    }
+    Complex r = { re, im };
+    return r;
+}
+
+// パス 1: 列方向の変換（出力列 j ごとに独立）
+static void psf_mft_pass1(int begin, int end, void* ctx) {
+    const psf_mft_task* t = (const psf_mft_task*)ctx;
+    for (int j = begin; j < end; j++) {
+        const Complex* w = t->wc + (size_t)j * t->nc;
+        Complex* dst = t->tmp + (size_t)j * t->nr;
+        for (int q = 0; q < t->nr; q++) {
+            dst[q] = psf_mft_dot(t->a + (size_t)q * t->nc, w, t->nc);
+        }
+    }
+}
+
+// パス 2: 行方向の変換 + 強度（出力行 i ごとに独立）
+static void psf_mft_pass2(int begin, int end, void* ctx) {
+    const psf_mft_task* t = (const psf_mft_task*)ctx;
+    for (int i = begin; i < end; i++) {
+        const Complex* w = t->wr + (size_t)i * t->nr;
+        double* row = t->out + (size_t)i * t->m;
+        for (int j = 0; j < t->m; j++) {
+            const Complex e = psf_mft_dot(w, t->tmp + (size_t)j * t->nr, t->nr);
+            row[j] = e.real * e.real + e.imag * e.imag;
+        }
+    }
+}
+
+// exp(-2πi·f·idx/P) の行列（周波数 f = center + (i - m/2)）
+static void psf_mft_kernel(Complex* w, int m, const int* idx, int count, double center, double P) {
+    for (int i = 0; i < m; i++) {
+        const double f = center + (double)(i - m / 2);
+        for (int q = 0; q < count; q++) {
+            double x = f * (double)idx[q];
+            x -= P * floor(x / P);  // 位相を [0, P) に縮約して精度を保つ
+            const double angle = -2.0 * M_PI * x / P;
+            w[(size_t)i * count + q].real = cos(angle);
+            w[(size_t)i * count + q].imag = sin(angle);
+        }
+    }
+}
+
+/**
+ * 瞳複素振幅（n × n）から出力窓の PSF 強度（m × m）を計算
+ * @param out 出力強度（m × m, 呼び出し側で確保）
+ * @param allow_fft 0 なら常に MFT（グローバルな FFT 作業域・プランキャッシュに触れないので並列タスクから呼べる）
+ * @return 0: 成功 / -1: 引数不正・メモリ不足
+ */
+static int psf_window_into(const Complex* amp, int n, int m, double pad_factor,
+                           double center_row, double center_col, int allow_fft, double* out) {
+    if (m <= 0 || n <= 0 || !(pad_factor > 0.0) || !out) return -1;
+    const double P = (double)n * pad_factor;
+
+    memset(out, 0, (size_t)m * (size_t)m * sizeof(double));
+    int* rows = (int*)malloc((size_t)n * sizeof(int));
+    int* cols = (int*)malloc((size_t)n * sizeof(int));
+    if (!rows || !cols) {
+        free(rows); free(cols);
+        return -1;
+    }
+
+    // 非ゼロの行・列を抽出
+    int nr = 0, nc = 0;
+    for (int r = 0; r < n; r++) {
+        for (int c = 0; c < n; c++) {
+            const Complex z = amp[(size_t)r * n + c];
+            if (z.real != 0.0 || z.imag != 0.0) { rows[nr++] = r; break; }
+        }
+    }
+    for (int c = 0; c < n; c++) {
+        for (int r = 0; r < n; r++) {
+            const Complex z = amp[(size_t)r * n + c];
+            if (z.real != 0.0 || z.imag != 0.0) { cols[nc++] = c; break; }
+        }
+    }
+    if (nr == 0 || nc == 0) {
+        free(rows); free(cols);
+        return 0;
+    }
+
+    // 経路選択: 整数 pad・整数中心・2 の冪 P ならゼロ詰め FFT とコスト比較
+    const double pad_int = floor(pad_factor + 0.5);
+    const int Pi = (int)((double)n * pad_int);
+    const int fft_ok = allow_fft && fabs(pad_factor - pad_int) < 1e-9 && pad_int >= 1.0 &&
+                       fabs(center_row - floor(center_row + 0.5)) < 1e-9 &&
+                       fabs(center_col - floor(center_col + 0.5)) < 1e-9 &&
+                       Pi <= PSF_WINDOW_MAX_FFT && (Pi & (Pi - 1)) == 0;
+    const double mft_cost = (double)m * nr * nc + (double)m * m * nr;
+    const double fft_cost = fft_ok ? (double)Pi * Pi * log2((double)Pi) : 0.0;
+
+    if (fft_ok && fft_cost < mft_cost) {
+        Complex* padded = (Complex*)calloc((size_t)Pi * (size_t)Pi, sizeof(Complex));
+        if (padded) {
+            for (int r = 0; r < n; r++) {
+                memcpy(padded + (size_t)r * Pi, amp + (size_t)r * n, (size_t)n * sizeof(Complex));
+            }
+            fft_2d(padded, Pi, Pi, 0);
+            const int cr = (int)floor(center_row + 0.5);
+            const int cc = (int)floor(center_col + 0.5);
+            for (int i = 0; i < m; i++) {
+                int fr = (cr + i - m / 2) % Pi;
+                if (fr < 0) fr += Pi;
+                for (int j = 0; j < m; j++) {
+                    int fc = (cc + j - m / 2) % Pi;
+                    if (fc < 0) fc += Pi;
+                    const Complex z = padded[(size_t)fr * Pi + fc];
+                    out[(size_t)i * m + j] = z.real * z.real + z.imag * z.imag;
                 }
             }
+            free(padded);
+            free(rows); free(cols);
+            return 0;
+        }
+        // 確保失敗時は MFT へ
+    }
+
+    Complex* a = (Complex*)malloc((size_t)nr * nc * sizeof(Complex));
+    Complex* wc = (Complex*)malloc((size_t)m * nc * sizeof(Complex));
+    Complex* wr = (Complex*)malloc((size_t)m * nr * sizeof(Complex));
+    Complex* tmp = (Complex*)malloc((size_t)m * nr * sizeof(Complex));
+    if (!a || !wc || !wr || !tmp) {
+        free(a); free(wc); free(wr); free(tmp);
+        free(rows); free(cols);
+        return -1;
+    }
+    for (int q = 0; q < nr; q++) {
+        for (int p = 0; p < nc; p++) {
+            a[(size_t)q * nc + p] = amp[(size_t)rows[q] * n + cols[p]];
+        }
+    }
+    psf_mft_kernel(wc, m, cols, nc, center_col, P);
+    psf_mft_kernel(wr, m, rows, nr, center_row, P);
+
+    psf_mft_task t = { a, wc, wr, tmp, out, nr, nc, m };
+    coopt_parallel_for(0, m, 4, psf_mft_pass1, &t);
+    coopt_parallel_for(0, m, 4, psf_mft_pass2, &t);
+
+    free(a); free(wc); free(wr); free(tmp);
+    free(rows); free(cols);
+    return 0;
+}
+
+/*
+ * PSF 計算パイプライン本体（バッファは呼び出し側が所有）
+ * calculate_psf_wasm / calculate_psf_grid_wasm（毎回確保）と psf_session_*（事前確保）で共用する。
+ */
+typedef struct {
+    double init;
+    double alloc;
+    double interp;
+    double amp;
+    double fft;
+    double intensity;
+    double shift;
+    double total;
+} psf_stage_times;
+
+/*
+ * 計測カウンタ（psf_get_stats で読み出し, psf_reset_stats で 0 に戻す）
+ * 入口ごとの呼び出し回数 / 累積 ns / 直近 ns、段階別（psf_stage_times）の累積 ns / 直近 ns、
+ * 確保バイト数の累計。更新は呼び出しスレッドのみ（ワーカーは触らない）。
+ * レイアウトは PSF_STAT_*（performance/performance-monitor.js の PSF_STATS_LAYOUT と同期させること）。
+ * 従来の console.log による段階時間の出力は -DPSF_WASM_TIMING_LOG でビルドしたときだけ行う。
+ */
+#define PSF_STAT_ENTRY_RAYS          0   // calculate_psf_wasm
+#define PSF_STAT_ENTRY_GRID          1   // calculate_psf_grid_wasm
+#define PSF_STAT_ENTRY_SESSION_RAYS  2   // psf_session_compute_rays
+#define PSF_STAT_ENTRY_SESSION_GRID  3   // psf_session_compute_grid
+#define PSF_STAT_ENTRY_BATCH         4   // calculate_psf_batch_wasm
+#define PSF_STAT_ENTRY_GRID_F32      5   // calculate_psf_grid_f32_wasm
+#define PSF_STAT_ENTRY_MTF           6   // calculate_mtf_batch_wasm
+#define PSF_STAT_ENTRY_FOCUS         7   // calculate_psf_focus_stack_wasm
+#define PSF_STAT_ENTRIES             8
+#define PSF_STAT_ENTRY_FIELDS        3   // calls, total_ns, last_ns
+#define PSF_STAT_STAGES              8   // init, alloc, interp, amp, fft, intensity, shift, total
+#define PSF_STAT_STAGE_TOTAL         (PSF_STAT_ENTRIES * PSF_STAT_ENTRY_FIELDS)
+#define PSF_STAT_STAGE_LAST          (PSF_STAT_STAGE_TOTAL + PSF_STAT_STAGES)
+#define PSF_STAT_BYTES_ALLOCATED     (PSF_STAT_STAGE_LAST + PSF_STAT_STAGES)
+#define PSF_STAT_FIELDS              (PSF_STAT_BYTES_ALLOCATED + 1)
+
+static double psf_stats[PSF_STAT_FIELDS];
+
+static void psf_stats_record(int entry, const psf_stage_times* tm, size_t bytes) {
+    const double stage_ms[PSF_STAT_STAGES] = {
+        tm->init, tm->alloc, tm->interp, tm->amp, tm->fft, tm->intensity, tm->shift, tm->total
+    };
+    double* e = psf_stats + entry * PSF_STAT_ENTRY_FIELDS;
+    e[0] += 1.0;
+    e[1] += tm->total * 1e6;
+    e[2] = tm->total * 1e6;
+    for (int k = 0; k < PSF_STAT_STAGES; k++) {
+        psf_stats[PSF_STAT_STAGE_TOTAL + k] += stage_ms[k] * 1e6;
+        psf_stats[PSF_STAT_STAGE_LAST + k] = stage_ms[k] * 1e6;
+    }
+    psf_stats[PSF_STAT_BYTES_ALLOCATED] += (double)bytes;
+}
+
+/*
+ * =============================================================================
+ * Strehl 比（瞳から直接, 回折限界瞳で正規化）
+ * =============================================================================
+ *
+ * 同じ瞳（マスク・振幅）で位相 0 の PSF のピークは (ΣA)²（DC 成分）なので、
+ *   基準点 Strehl = |Σ A·exp(iφ)|² / (ΣA)²
+ * は FFT なしで、複素振幅を作るパスの総和（psf_pupil_sums）から求まる。
+ * PSF がチルト等で主光線位置からずれる場合は、真のピーク位置 (u, v) で
+ *   I(u, v) = |Σ a·exp(-2πi(u x + v y)/n)|²
+ * を最大化する（Newton 法, 1 反復は行・列因子に分離した O(n²) の 1 パス）。
+ *
+ * 出力 [PSF_STREHL_FIELDS]:
+ *   0: 基準点 Strehl（u = v = 0）
+ *   1: ピーク Strehl（refine 時は真のピーク、格子 PSF 経路では最大画素）
+ *   2, 3: ピーク位置 row, col（FFTshift 後の PSF 画素座標, 非整数）
+ *   4: 回折限界ピーク (ΣA)²（同じ格子の PSF をこの値で割ると Strehl 規格化になる）
+ */
+#define PSF_STREHL_FIELDS       5
+#define PSF_STREHL_MAX_NEWTON   20
+
+static double psf_strehl_last[PSF_STREHL_FIELDS] = { NAN, NAN, NAN, NAN, NAN };
+
+static void psf_strehl_store(const psf_pupil_sums* sums, double peak, double peak_row, double peak_col,
+                             double* out) {
+    const double ideal = sums->amp_sum * sums->amp_sum;
+    out[0] = ideal > 0.0 ? (sums->re * sums->re + sums->im * sums->im) / ideal : 0.0;
+    out[1] = ideal > 0.0 ? peak / ideal : 0.0;
+    out[2] = peak_row;
+    out[3] = peak_col;
+    out[4] = ideal;
+}
+
+// 3 点放物線の頂点オフセット（-0.5..0.5）
+static inline double psf_parabola_offset(double l, double c, double r) {
+    const double d = l - 2.0 * c + r;
+    if (!(d < 0.0)) return 0.0;
+    const double t = 0.5 * (l - r) / d;
+    return t < -0.5 ? -0.5 : (t > 0.5 ? 0.5 : t);
+}
+
+// 格子 PSF（FFTshift 済み）の最大画素と放物線補間した位置を記録する
+static void psf_strehl_record_grid(const psf_pupil_sums* sums, const double* psf, int rows, int cols,
+                                   double row_origin, double col_origin) {
+    size_t best = 0;
+    const size_t total = (size_t)rows * cols;
+    for (size_t i = 1; i < total; i++) {
+        if (psf[i] > psf[best]) best = i;
+    }
+    const int r = (int)(best / cols), c = (int)(best % cols);
+    const double pr = (r > 0 && r + 1 < rows)
+        ? psf_parabola_offset(psf[best - cols], psf[best], psf[best + cols]) : 0.0;
+    const double pc = (c > 0 && c + 1 < cols)
+        ? psf_parabola_offset(psf[best - 1], psf[best], psf[best + 1]) : 0.0;
+    psf_strehl_store(sums, total ? psf[best] : 0.0, row_origin + r + pr, col_origin + c + pc, psf_strehl_last);
+}
+
+/*
+ * I(u, v) とその勾配・ヘッセ行列（u = 列方向, v = 行方向の周波数 bin, 座標は格子中心基準）
+ * F = Σ a·e,  F_u = g Σ a x' e,  F_uu = g² Σ a x'² e（g = -2πi/n）など 6 個のモーメントを 1 パスで集計する。
+ */
+typedef struct {
+    double I;
+    double gu, gv;
+    double huu, huv, hvv;
+} psf_peak_eval;
+
+static psf_peak_eval psf_strehl_eval(const Complex* a, int n, double u, double v, Complex* row_f, Complex* col_f) {
+    const double c = 0.5 * (n - 1);
+    const double w = -2.0 * M_PI / n;
+    for (int j = 0; j < n; j++) {
+        const double ph = w * u * (j - c);
+        col_f[j].real = cos(ph);
+        col_f[j].imag = sin(ph);
+        const double pv = w * v * (j - c);
+        row_f[j].real = cos(pv);
+        row_f[j].imag = sin(pv);
+    }
+    // S[p][q] = Σ a x'^p y'^q e（p + q <= 2）
+    double s00r = 0, s00i = 0, s10r = 0, s10i = 0, s01r = 0, s01i = 0;
+    double s20r = 0, s20i = 0, s11r = 0, s11i = 0, s02r = 0, s02i = 0;
+    for (int i = 0; i < n; i++) {
+        const Complex* row = a + (size_t)i * n;
+        double r0r = 0, r0i = 0, r1r = 0, r1i = 0, r2r = 0, r2i = 0;
+        for (int j = 0; j < n; j++) {
+            if (row[j].real == 0.0 && row[j].imag == 0.0) continue;
+            const double er = row[j].real * col_f[j].real - row[j].imag * col_f[j].imag;
+            const double ei = row[j].real * col_f[j].imag + row[j].imag * col_f[j].real;
+            const double x = j - c;
+            r0r += er; r0i += ei;
+            r1r += x * er; r1i += x * ei;
+            r2r += x * x * er; r2i += x * x * ei;
+        }
+        const double y = i - c;
+        const double fr = row_f[i].real, fi = row_f[i].imag;
+        const double t0r = r0r * fr - r0i * fi, t0i = r0r * fi + r0i * fr;
+        const double t1r = r1r * fr - r1i * fi, t1i = r1r * fi + r1i * fr;
+        const double t2r = r2r * fr - r2i * fi, t2i = r2r * fi + r2i * fr;
+        s00r += t0r; s00i += t0i;
+        s01r += y * t0r; s01i += y * t0i;
+        s02r += y * y * t0r; s02i += y * y * t0i;
+        s10r += t1r; s10i += t1i;
+        s11r += y * t1r; s11i += y * t1i;
+        s20r += t2r; s20i += t2i;
+    }
+    // F_u = g·S10 = -i·(2π/n)·S10, F_uu = g²·S20 = -(2π/n)²·S20
+    const double k = 2.0 * M_PI / n;
+    const double fur = k * s10i, fui = -k * s10r;
+    const double fvr = k * s01i, fvi = -k * s01r;
+    const double k2 = k * k;
+    const double fuur = -k2 * s20r, fuui = -k2 * s20i;
+    const double fvvr = -k2 * s02r, fvvi = -k2 * s02i;
+    const double fuvr = -k2 * s11r, fuvi = -k2 * s11i;
+    psf_peak_eval e;
+    e.I = s00r * s00r + s00i * s00i;
+    // Re(conj(X)·Y)
+    #define PSF_RE_CONJ(xr, xi, yr, yi) ((xr) * (yr) + (xi) * (yi))
+    e.gu = 2.0 * PSF_RE_CONJ(s00r, s00i, fur, fui);
+    e.gv = 2.0 * PSF_RE_CONJ(s00r, s00i, fvr, fvi);
+    e.huu = 2.0 * (PSF_RE_CONJ(fur, fui, fur, fui) + PSF_RE_CONJ(s00r, s00i, fuur, fuui));
+    e.hvv = 2.0 * (PSF_RE_CONJ(fvr, fvi, fvr, fvi) + PSF_RE_CONJ(s00r, s00i, fvvr, fvvi));
+    e.huv = 2.0 * (PSF_RE_CONJ(fur, fui, fvr, fvi) + PSF_RE_CONJ(s00r, s00i, fuvr, fuvi));
+    #undef PSF_RE_CONJ
+    return e;
+}
+
+/**
+ * 瞳格子から Strehl 比を計算（FFT なし）
+ * @param grid_opd OPD（grid_size², 波長と同じ単位, NULL なら位相 0）
+ * @param amplitude 振幅（NULL なら 1）
+ * @param pupil_mask 瞳マスク
+ * @param grid_size 一辺
+ * @param wavelength 波長
+ * @param refine 0: 基準点のみ（ピーク欄も基準点の値） / 1: 真のピークを Newton 法で探索
+ * @param out 出力 [PSF_STREHL_FIELDS]
+ * @return Newton 反復回数（refine = 0 なら 0）/ -1: 失敗
+ */
+int calculate_strehl_pupil_wasm(const double* grid_opd, const double* amplitude, const int* pupil_mask,
+                                int grid_size, double wavelength, int refine, double* out) {
+    if (!pupil_mask || !out || grid_size <= 0 || !(wavelength > 0.0)) return -1;
+    const int n = grid_size;
+    const size_t total = (size_t)n * n;
+    const double k = -2.0 * M_PI / wavelength;  // psf_pipeline_grid と同じ符号
+    const double half = (double)(n / 2);       // FFTshift 後の原点画素
+    psf_pupil_sums sums = { 0.0, 0.0, 0.0 };
+
+    if (!refine) {
+        // 複素振幅を保持しない 1 パス（psf_phase_to_complex をスタック上のブロックごとに使い, sincos の精度段階を共有）
+        enum { BLOCK = 256 };
+        Complex scratch[BLOCK];
+        for (size_t i = 0; i < total; i += BLOCK) {
+            const int m = (int)(total - i < BLOCK ? total - i : BLOCK);
+            psf_pupil_sums part;
+            if (grid_opd) {
+                psf_phase_to_complex(grid_opd + i, amplitude ? amplitude + i : NULL, pupil_mask + i, k,
+                                     scratch, m, &part);
+            } else {
+                part.amp_sum = 0.0;
+                for (int j = 0; j < m; j++) {
+                    if (pupil_mask[i + j]) part.amp_sum += amplitude ? amplitude[i + j] : 1.0;
+                }
+                part.re = part.amp_sum;
+                part.im = 0.0;
+            }
+            sums.amp_sum += part.amp_sum;
+            sums.re += part.re;
+            sums.im += part.im;
+        }
+        psf_strehl_store(&sums, sums.re * sums.re + sums.im * sums.im, half, half, out);
+        return 0;
+    }
+
+    Complex* a = (Complex*)malloc(total * sizeof(Complex) + 2 * (size_t)n * sizeof(Complex));
+    if (!a) return -1;
+    Complex* row_f = a + total;
+    Complex* col_f = row_f + n;
+    if (grid_opd) {
+        psf_phase_to_complex(grid_opd, amplitude, pupil_mask, k, a, (int)total, &sums);
+    } else {
+        for (size_t i = 0; i < total; i++) {
+            a[i].real = pupil_mask[i] ? (amplitude ? amplitude[i] : 1.0) : 0.0;
+            a[i].imag = 0.0;
+            sums.amp_sum += a[i].real;
+        }
+        sums.re = sums.amp_sum;
+    }
+
+    // 初期値: 位相の重み付き平面フィット（チルト → ピーク位置 u = n·∂φ/∂x / 2π）と原点のうち強い方
+    const double c = 0.5 * (n - 1);
+    double sw = 0, sx = 0, sy = 0, sxx = 0, syy = 0, sxy = 0, sp = 0, sxp = 0, syp = 0;
+    if (grid_opd) {
+        for (int i = 0; i < n; i++) {
+            for (int j = 0; j < n; j++) {
+                const size_t q = (size_t)i * n + j;
+                if (!pupil_mask[q]) continue;
+                const double wgt = amplitude ? amplitude[q] : 1.0;
+                const double x = j - c, y = i - c, p = k * grid_opd[q];
+                sw += wgt; sx += wgt * x; sy += wgt * y;
+                sxx += wgt * x * x; syy += wgt * y * y; sxy += wgt * x * y;
+                sp += wgt * p; sxp += wgt * x * p; syp += wgt * y * p;
+            }
+        }
+    }
+    double u = 0.0, v = 0.0;
+    if (sw > 0.0) {
+        // 中心化した正規方程式 [Cxx Cxy; Cxy Cyy][ax; ay] = [Cxp; Cyp]
+        const double mx = sx / sw, my = sy / sw, mp = sp / sw;
+        const double cxx = sxx / sw - mx * mx, cyy = syy / sw - my * my, cxy = sxy / sw - mx * my;
+        const double cxp = sxp / sw - mx * mp, cyp = syp / sw - my * mp;
+        const double det = cxx * cyy - cxy * cxy;
+        if (det > 0.0) {
+            u = n * ((cyy * cxp - cxy * cyp) / det) / (2.0 * M_PI);
+            v = n * ((cxx * cyp - cxy * cxp) / det) / (2.0 * M_PI);
+        }
+    }
+    psf_peak_eval e = psf_strehl_eval(a, n, u, v, row_f, col_f);
+    const double I0 = sums.re * sums.re + sums.im * sums.im;
+    if (e.I < I0) {
+        u = v = 0.0;
+        e = psf_strehl_eval(a, n, u, v, row_f, col_f);
+    }
+
+    int iter = 0;
+    for (; iter < PSF_STREHL_MAX_NEWTON; iter++) {
+        // Newton（ヘッセ行列が負定値のとき）, それ以外は勾配方向。1 ステップは 0.5 bin まで
+        double du, dv;
+        const double det = e.huu * e.hvv - e.huv * e.huv;
+        if (e.huu < 0.0 && det > 0.0) {
+            du = -(e.hvv * e.gu - e.huv * e.gv) / det;
+            dv = -(e.huu * e.gv - e.huv * e.gu) / det;
+        } else {
+            const double g = sqrt(e.gu * e.gu + e.gv * e.gv);
+            if (!(g > 0.0)) break;
+            du = 0.25 * e.gu / g;
+            dv = 0.25 * e.gv / g;
+        }
+        const double len = sqrt(du * du + dv * dv);
+        if (len > 0.5) {
+            du *= 0.5 / len;
+            dv *= 0.5 / len;
+        }
+        psf_peak_eval next = psf_strehl_eval(a, n, u + du, v + dv, row_f, col_f);
+        for (int h = 0; h < 8 && next.I < e.I; h++) {
+            du *= 0.5;
+            dv *= 0.5;
+            next = psf_strehl_eval(a, n, u + du, v + dv, row_f, col_f);
+        }
+        if (next.I < e.I) break;
+        u += du;
+        v += dv;
+        e = next;
+        if (du * du + dv * dv < 1e-14) {
+            iter++;
+            break;
+        }
+    }
+    free(a);
+    psf_strehl_store(&sums, e.I, half + v, half + u, out);
+    return iter;
+}
+
+/**
+ * 直近の格子 / 光線 PSF（calculate_psf_grid_wasm, calculate_psf_wasm, psf_session_compute_*）で
+ * 複素振幅と同じパスで求めた Strehl を out に書き出す（capacity 個まで, 未計算なら NaN）
+ * ピーク欄は最大画素（出力窓モードでは窓内, 位置は窓の画素座標）。
+ * @return PSF_STREHL_FIELDS
+ */
+int psf_last_strehl(double* out, int capacity) {
+    if (out) {
+        const int m = capacity < PSF_STREHL_FIELDS ? capacity : PSF_STREHL_FIELDS;
+        for (int i = 0; i < m; i++) out[i] = psf_strehl_last[i];
+    }
+    return PSF_STREHL_FIELDS;
+}
+
+// 複素振幅 → FFT → 強度 → FFTshift（全面モード）
+static void psf_pipeline_fft_intensity(Complex* complex_amp, int grid_size, double* psf_out, psf_stage_times* tm) {
+    const int total_size = grid_size * grid_size;
+
+    // 2D FFT
+    double fft_start = get_time_ms();
+    fft_2d(complex_amp, grid_size, grid_size, 0);
+    tm->fft = get_time_ms() - fft_start;
+
+    // 強度計算（ベクトル化可能）
+    double intensity_start = get_time_ms();
+    for (int i = 0; i < total_size; i++) {
+        psf_out[i] = complex_amp[i].real * complex_amp[i].real + 
+                     complex_amp[i].imag * complex_amp[i].imag;
+    }
+    tm->intensity = get_time_ms() - intensity_start;
+
+    // FFTshift
+    double shift_start = get_time_ms();
+    fft_shift(psf_out, grid_size);
+    tm->shift = get_time_ms() - shift_start;
+}
+
+/**
+ * 光線入力の PSF（補間 → 複素振幅 → FFT → 強度）
+ * grid_opd / amplitude / pupil_mask / complex_amp / psf_out は grid_size² 要素
+ */
+static void psf_pipeline_rays(const double* ray_x, const double* ray_y, const double* ray_opd, int ray_count,
+                              int grid_size, double wavelength,
+                              double min_x, double max_x, double min_y, double max_y, int interp_mode,
+                              double* grid_opd, double* amplitude, int* pupil_mask,
+                              Complex* complex_amp, double* psf_out, psf_stage_times* tm) {
+    const int total_size = grid_size * grid_size;
+
+    // 振幅を均一に設定（ベクトル化可能）
+    for (int i = 0; i < total_size; i++) {
+        amplitude[i] = 1.0;
+    }
+
+    // 1. OPD格子補間
+    double interp_start = get_time_ms();
+    interpolate_opd_grid((double*)ray_x, (double*)ray_y, (double*)ray_opd, ray_count,
+                        grid_opd, pupil_mask, grid_size,
+                        min_x, max_x, min_y, max_y, interp_mode);
+    tm->interp = get_time_ms() - interp_start;
+
+    // 2. 複素振幅計算（calculate_complex_amplitude と同じ符号, Strehl 用の総和も同じパスで）
+    double amp_start = get_time_ms();
+    psf_pupil_sums sums;
+    psf_phase_to_complex(grid_opd, amplitude, pupil_mask, 2.0 * M_PI / wavelength,
+                         complex_amp, total_size, &sums);
+    tm->amp = get_time_ms() - amp_start;
+
+    // 3-5. FFT / 強度 / FFTshift
+    psf_pipeline_fft_intensity(complex_amp, grid_size, psf_out, tm);
+    psf_strehl_record_grid(&sums, psf_out, grid_size, grid_size, 0.0, 0.0);
+}
+
+/**
+ * 格子入力の PSF（複素振幅 → FFT または出力窓）
+ * @param psf_out 出力（out_size > 0 なら out_size², それ以外は grid_size²）
+ * @return 0: 成功 / -1: 失敗
+ */
+static int psf_pipeline_grid(const double* grid_opd, const double* amplitude, const int* pupil_mask,
+                             int grid_size, double wavelength,
+                             int out_size, double pad_factor, double center_row, double center_col,
+                             Complex* complex_amp, double* psf_out, psf_stage_times* tm) {
+    const int total_size = grid_size * grid_size;
+
+    // 1. 複素振幅計算（格子入力をそのまま使用）
+    // OPDは光路差（遅延）なので、位相は負の符号（JS実装に合わせる）
+    double amp_start = get_time_ms();
+    const double k = -2.0 * M_PI / wavelength;
+    psf_pupil_sums sums = { 0.0, 0.0, 0.0 };
+    if (pupil_mask && grid_opd) {
+        psf_phase_to_complex(grid_opd, amplitude, pupil_mask, k, complex_amp, total_size, &sums);
+    } else if (pupil_mask) {
+        // OPD なし: 位相 0
+        for (int i = 0; i < total_size; i++) {
+            complex_amp[i].real = pupil_mask[i] ? (amplitude ? amplitude[i] : 1.0) : 0.0;
+            complex_amp[i].imag = 0.0;
+            sums.amp_sum += complex_amp[i].real;
+        }
+        sums.re = sums.amp_sum;
+    } else {
+        memset(complex_amp, 0, total_size * sizeof(Complex));
+    }
+    tm->amp = get_time_ms() - amp_start;
+
+    // 出力窓モード: 窓内だけを MFT（またはゼロ詰め FFT）で評価
+    if (out_size > 0) {
+        double fft_start = get_time_ms();
+        const int rc = psf_window_into(complex_amp, grid_size, out_size,
+                                       pad_factor > 0.0 ? pad_factor : 1.0,
+                                       center_row, center_col, 1, psf_out);
+        tm->fft = get_time_ms() - fft_start;
+        if (rc == 0) psf_strehl_record_grid(&sums, psf_out, out_size, out_size, 0.0, 0.0);
+        return rc;
+    }
+
+    // 2-4. FFT / 強度 / FFTshift
+    psf_pipeline_fft_intensity(complex_amp, grid_size, psf_out, tm);
+    psf_strehl_record_grid(&sums, psf_out, grid_size, grid_size, 0.0, 0.0);
+    return 0;
+}
+
+/*
+ * =============================================================================
+ * 多視野 × 多波長のバッチ PSF（共通の像面ピッチ, 多色積算）
+ * =============================================================================
+ *
+ * 入力スタックは [field][wavelength][grid_size²]。波長 λ の窓は pad_λ = pad_factor · λ / ref_wavelength
+ * で評価するので、全波長が ref_wavelength・pad_factor の画素ピッチにそろう（非整数 pad は MFT）。
+ * 各単色 PSF は全エネルギー（P² Σ|a|², Parseval）で 1 に正規化する。
+ * - PSF_BATCH_STACK         : 出力 [field][wavelength][out_size²]（単色, 正規化のみ）
+ * - PSF_BATCH_POLYCHROMATIC : 出力 [field][out_size²] = Σ w_λ PSF_λ / Σ w_λ
+ * 項目（視野 × 波長）単位でスレッド並列化する。項目は常に MFT で評価するため、
+ * 結果はスレッド数によらず同一。
+ */
+#define PSF_BATCH_STACK          0
+#define PSF_BATCH_POLYCHROMATIC  1
+
+typedef struct {
+    const double* opd_stack;
+    const double* amp_stack;
+    const int* mask_stack;
+    const double* wavelengths;
+    int grid_size;
+    int wavelength_count;
+    int out_size;
+    double pad_factor;
+    double ref_wavelength;
+    double* item_out;   // [item][out_size²]
+    int failed;
+} psf_batch_task;
+
+static void psf_batch_items(int begin, int end, void* ctx) {
+    psf_batch_task* t = (psf_batch_task*)ctx;
+    const size_t total = (size_t)t->grid_size * (size_t)t->grid_size;
+    const size_t out_total = (size_t)t->out_size * (size_t)t->out_size;
+    Complex* amp = (Complex*)malloc(total * sizeof(Complex));
+    if (!amp) {
+        t->failed = 1;
+        return;
+    }
+    for (int item = begin; item < end; item++) {
+        const double lambda = t->wavelengths[item % t->wavelength_count];
+        const double* opd = t->opd_stack + (size_t)item * total;
+        const double* a = t->amp_stack ? t->amp_stack + (size_t)item * total : NULL;
+        const int* mask = t->mask_stack + (size_t)item * total;
+        double* out = t->item_out + (size_t)item * out_total;
+
+        psf_phase_to_complex(opd, a, mask, -2.0 * M_PI / lambda, amp, (int)total, NULL);
+        double energy = 0.0;
+        for (size_t i = 0; i < total; i++) energy += amp[i].real * amp[i].real + amp[i].imag * amp[i].imag;
+
+        const double pad = t->pad_factor * lambda / t->ref_wavelength;
+        if (psf_window_into(amp, t->grid_size, t->out_size, pad, 0.0, 0.0, 0, out) != 0) {
+            t->failed = 1;
+            continue;
+        }
+        const double P = (double)t->grid_size * pad;
+        const double norm = (energy > 0.0) ? 1.0 / (P * P * energy) : 0.0;
+        for (size_t i = 0; i < out_total; i++) out[i] *= norm;
+    }
+    free(amp);
+}
+
+/**
+ * バッチ PSF（格子入力, 出力窓モード）
+ * @param opd_stack OPD [field][wavelength][grid_size²]（波長と同じ単位）
+ * @param amp_stack 振幅（同形状, NULL なら 1）
+ * @param mask_stack 瞳マスク（同形状）
+ * @param wavelengths 波長（wavelength_count）
+ * @param weights スペクトル重み（wavelength_count, NULL なら均等。PSF_BATCH_POLYCHROMATIC のみ使用）
+ * @param ref_wavelength 画素ピッチの基準波長（<= 0 なら wavelengths[0]）
+ * @param out_size 出力窓の一辺
+ * @param pad_factor 基準波長でのゼロ詰め倍率
+ * @param mode PSF_BATCH_*
+ * @param out 出力（呼び出し側で確保。STACK: fields·wavelengths·out_size², POLYCHROMATIC: fields·out_size²）
+ * @return 0: 成功 / -1: 失敗
+ */
+int calculate_psf_batch_wasm(const double* opd_stack, const double* amp_stack, const int* mask_stack,
+                             int grid_size, int field_count, int wavelength_count,
+                             const double* wavelengths, const double* weights, double ref_wavelength,
+                             int out_size, double pad_factor, int mode, double* out) {
+    if (!opd_stack || !mask_stack || !wavelengths || !out || grid_size < 2 ||
+        field_count <= 0 || wavelength_count <= 0 || out_size <= 0 || !(pad_factor > 0.0)) {
+        return -1;
+    }
+    for (int w = 0; w < wavelength_count; w++) {
+        if (!(wavelengths[w] > 0.0)) return -1;
+    }
+    if (!(ref_wavelength > 0.0)) ref_wavelength = wavelengths[0];
+
+    const double start_time = get_time_ms();
+    const int items = field_count * wavelength_count;
+    const size_t out_total = (size_t)out_size * (size_t)out_size;
+    double* item_out = out;
+    if (mode == PSF_BATCH_POLYCHROMATIC) {
+        item_out = (double*)malloc((size_t)items * out_total * sizeof(double));
+        if (!item_out) return -1;
+    }
+
+    psf_batch_task t = {
+        opd_stack, amp_stack, mask_stack, wavelengths,
+        grid_size, wavelength_count, out_size, pad_factor, ref_wavelength,
+        item_out, 0
+    };
+    coopt_parallel_for(0, items, 1, psf_batch_items, &t);
+
+    if (mode == PSF_BATCH_POLYCHROMATIC) {
+        double wsum = 0.0;
+        for (int w = 0; w < wavelength_count; w++) wsum += weights ? weights[w] : 1.0;
+        const double inv = (wsum != 0.0) ? 1.0 / wsum : 0.0;
+        for (int f = 0; f < field_count; f++) {
+            double* dst = out + (size_t)f * out_total;
+            memset(dst, 0, out_total * sizeof(double));
+            for (int w = 0; w < wavelength_count; w++) {
+                const double weight = (weights ? weights[w] : 1.0) * inv;
+                const double* src = item_out + ((size_t)f * wavelength_count + w) * out_total;
+                for (size_t i = 0; i < out_total; i++) dst[i] += weight * src[i];
+            }
+        }
+        free(item_out);
+    }
+    psf_stage_times tm = {0};
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_BATCH, &tm,
+                     mode == PSF_BATCH_POLYCHROMATIC ? (size_t)items * out_total * sizeof(double) : 0);
+    return t.failed ? -1 : 0;
+}
+
+/*
+ * =============================================================================
+ * 回折 MTF（瞳格子 → PSF → OTF, 視野 × デフォーカスのバッチ）
+ * =============================================================================
+ *
+ * 入力は calculate_psf_grid_wasm と同じ格子（OPD / 振幅 / 瞳マスク, grid_size² の行優先）。
+ * 項目（視野 × デフォーカス）ごとに PSF = |FFT(瞳)|² を求め、OTF = FFT(PSF) を DC で正規化する
+ * （JS の showMTFDiagram と同じ定義。FFTshift は OTF の絶対値に影響しないので省く）。
+ * - PSF は実数なので、2 項目の PSF を実部・虚部に詰めて 1 回の FFT で両方の OTF を得る:
+ *   Z = F_a + i·F_b,  F_a[k] = (Z[k] + conj(Z[-k]))/2,  F_b[k] = (Z[k] - conj(Z[-k]))/(2i)
+ * - FFT はすべて fft_2d（サイズ別プランキャッシュと作業バッファを共有, 行パスはスレッド並列）。
+ *   項目は逐次に処理し、項目間で作業バッファを使い回す。
+ * - デフォーカスは位相計算の直前に OPD へ W020·ρ² を加える（ρ = 格子中心 (n-1)/2 からの距離 / pupil_radius）。
+ * - スライスは方位角 angles[a]（rad, 0 = +x 列方向, π/2 = +y 行方向）上の周波数 freqs[f]
+ *   （OTF の bin 単位 = 1 / (grid_size · 像面画素ピッチ), 0..grid_size/2）。非整数位置は複素 OTF の双線形補間。
+ */
+typedef struct {
+    double re;
+    double im;
+} mtf_complex;
+
+// 詰めた変換 Z から項目 a（which = 0）/ b（which = 1）の OTF[row][col] を取り出す
+static inline mtf_complex mtf_unpack(const Complex* Z, int n, int row, int col, int which) {
+    const Complex z = Z[(size_t)row * n + col];
+    const Complex w = Z[(size_t)((n - row) & (n - 1)) * n + ((n - col) & (n - 1))];  // Z[-k]
+    mtf_complex r;
+    if (which == 0) {
+        r.re = 0.5 * (z.real + w.real);
+        r.im = 0.5 * (z.imag - w.imag);
+    } else {
+        r.re = 0.5 * (z.imag + w.imag);
+        r.im = -0.5 * (z.real - w.real);
+    }
+    return r;
+}
+
+static void mtf_sample_slices(const Complex* Z, int n, int which,
+                              const double* angles, int angle_count, const double* freqs, int freq_count,
+                              double* out) {
+    const double dc = which == 0 ? Z[0].real : Z[0].imag;
+    const double inv_dc = (dc > 0.0) ? 1.0 / dc : 0.0;
+    for (int a = 0; a < angle_count; a++) {
+        const double ca = cos(angles[a]), sa = sin(angles[a]);
+        double* dst = out + (size_t)a * freq_count;
+        for (int f = 0; f < freq_count; f++) {
+            const double u = freqs[f] * ca;   // 列（x）
+            const double v = freqs[f] * sa;   // 行（y）
+            const double fu = floor(u), fv = floor(v);
+            const double tu = u - fu, tv = v - fv;
+            const int c0 = ((int)fu) & (n - 1), r0 = ((int)fv) & (n - 1);
+            const int c1 = (c0 + 1) & (n - 1), r1 = (r0 + 1) & (n - 1);
+            const mtf_complex p00 = mtf_unpack(Z, n, r0, c0, which);
+            const mtf_complex p01 = mtf_unpack(Z, n, r0, c1, which);
+            const mtf_complex p10 = mtf_unpack(Z, n, r1, c0, which);
+            const mtf_complex p11 = mtf_unpack(Z, n, r1, c1, which);
+            const double w00 = (1.0 - tu) * (1.0 - tv), w01 = tu * (1.0 - tv);
+            const double w10 = (1.0 - tu) * tv, w11 = tu * tv;
+            const double re = w00 * p00.re + w01 * p01.re + w10 * p10.re + w11 * p11.re;
+            const double im = w00 * p00.im + w01 * p01.im + w10 * p10.im + w11 * p11.im;
+            dst[f] = sqrt(re * re + im * im) * inv_dc;
+        }
+    }
+}
+
+// 瞳（+ デフォーカス）→ PSF 強度（FFTshift なし）
+static void mtf_item_psf(const double* opd, const double* amp, const int* mask, const double* rho2,
+                         double defocus, double k, int n, double* opd_work, Complex* work, double* psf,
+                         psf_stage_times* tm) {
+    const size_t total = (size_t)n * n;
+    double t0 = get_time_ms();
+    const double* src = opd;
+    if (defocus != 0.0) {
+        for (size_t i = 0; i < total; i++) opd_work[i] = opd[i] + defocus * rho2[i];
+        src = opd_work;
+    }
+    psf_phase_to_complex(src, amp, mask, k, work, (int)total, NULL);
+    tm->amp += get_time_ms() - t0;
+
+    t0 = get_time_ms();
+    fft_2d(work, n, n, 0);
+    tm->fft += get_time_ms() - t0;
+
+    t0 = get_time_ms();
+    for (size_t i = 0; i < total; i++) psf[i] = work[i].real * work[i].real + work[i].imag * work[i].imag;
+    tm->intensity += get_time_ms() - t0;
+}
+
+/**
+ * バッチ MTF（格子入力）
+ * @param opd_stack OPD [field][grid_size²]（波長と同じ単位）
+ * @param amp_stack 振幅（同形状, NULL なら 1）
+ * @param mask_stack 瞳マスク（同形状）
+ * @param grid_size 一辺（2 の冪）
+ * @param field_count 視野数
+ * @param wavelength 波長
+ * @param defocus デフォーカス W020（OPD 単位, defocus_count 個）。NULL / defocus_count <= 0 なら 0 のみ
+ * @param pupil_radius ρ = 1 の半径（画素）。<= 0 なら各視野のマスクの最大半径
+ * @param angles スライスの方位角（rad, angle_count 個）
+ * @param freqs 周波数（OTF の bin 単位, freq_count 個）
+ * @param out 出力 [field][defocus][angle][freq_count]（呼び出し側で確保）= |OTF| / |OTF(0)|
+ * @return 0: 成功 / -1: 失敗
+ */
+int calculate_mtf_batch_wasm(const double* opd_stack, const double* amp_stack, const int* mask_stack,
+                             int grid_size, int field_count, double wavelength,
+                             const double* defocus, int defocus_count, double pupil_radius,
+                             const double* angles, int angle_count, const double* freqs, int freq_count,
+                             double* out) {
+    if (!opd_stack || !mask_stack || !angles || !freqs || !out || psf_fft_log2(grid_size) < 1 ||
+        field_count <= 0 || angle_count <= 0 || freq_count <= 0 || !(wavelength > 0.0)) {
+        return -1;
+    }
+    static const double no_defocus = 0.0;
+    if (!defocus || defocus_count <= 0) {
+        defocus = &no_defocus;
+        defocus_count = 1;
+    }
+
+    const double start_time = get_time_ms();
+    psf_stage_times tm = {0};
+    const int n = grid_size;
+    const size_t total = (size_t)n * n;
+    const size_t bytes = total * (4 * sizeof(double) + sizeof(Complex));
+    double* rho2 = (double*)malloc(total * sizeof(double));
+    double* opd_work = (double*)malloc(total * sizeof(double));
+    double* psf_a = (double*)malloc(total * sizeof(double));
+    double* psf_b = (double*)malloc(total * sizeof(double));
+    Complex* work = (Complex*)malloc(total * sizeof(Complex));
+    int rc = 0;
+    if (!rho2 || !opd_work || !psf_a || !psf_b || !work) {
+        rc = -1;
+        goto done;
+    }
+    tm.alloc = get_time_ms() - start_time;
+
+    const double k = -2.0 * M_PI / wavelength;  // psf_pipeline_grid と同じ符号
+    const double c = 0.5 * (n - 1);
+    const int items = field_count * defocus_count;
+    const size_t slice_count = (size_t)angle_count * freq_count;
+    int prepared_field = -1;
+
+    // 2 項目ずつ（最後が奇数なら片側 0）
+    for (int item = 0; item < items; item += 2) {
+        double* psf[2] = { psf_a, psf_b };
+        const int pair = (item + 1 < items) ? 2 : 1;
+        for (int p = 0; p < pair; p++) {
+            const int it = item + p;
+            const int field = it / defocus_count;
+            const double* opd = opd_stack + (size_t)field * total;
+            const double* amp = amp_stack ? amp_stack + (size_t)field * total : NULL;
+            const int* mask = mask_stack + (size_t)field * total;
+            if (field != prepared_field) {
+                // ρ² は視野ごと（半径の自動決定がマスクに依存するため）
+                double r = pupil_radius;
+                if (!(r > 0.0)) {
+                    double r2max = 0.0;
+                    for (int i = 0; i < n; i++) {
+                        for (int j = 0; j < n; j++) {
+                            if (!mask[(size_t)i * n + j]) continue;
+                            const double d2 = (i - c) * (i - c) + (j - c) * (j - c);
+                            if (d2 > r2max) r2max = d2;
+                        }
+                    }
+                    r = r2max > 0.0 ? sqrt(r2max) : c;
+                }
+                const double inv_r2 = 1.0 / (r * r);
+                for (int i = 0; i < n; i++) {
+                    for (int j = 0; j < n; j++) {
+                        rho2[(size_t)i * n + j] = ((i - c) * (i - c) + (j - c) * (j - c)) * inv_r2;
+                    }
+                }
+                prepared_field = field;
+            }
+            mtf_item_psf(opd, amp, mask, rho2, defocus[it % defocus_count], k, n, opd_work, work, psf[p], &tm);
+        }
+
+        // Z = PSF_a + i·PSF_b → OTF
+        double t0 = get_time_ms();
+        for (size_t i = 0; i < total; i++) {
+            work[i].real = psf_a[i];
+            work[i].imag = (pair == 2) ? psf_b[i] : 0.0;
+        }
+        fft_2d(work, n, n, 0);
+        tm.fft += get_time_ms() - t0;
+
+        t0 = get_time_ms();
+        for (int p = 0; p < pair; p++) {
+            mtf_sample_slices(work, n, p, angles, angle_count, freqs, freq_count,
+                              out + (size_t)(item + p) * slice_count);
+        }
+        tm.shift += get_time_ms() - t0;  // スライス抽出は shift 段に計上
+    }
+
+done:
+    free(rho2);
+    free(opd_work);
+    free(psf_a);
+    free(psf_b);
+    free(work);
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_MTF, &tm, rc == 0 ? bytes : 0);
+    return rc;
+}
+
+/*
+ * =============================================================================
+ * スルーフォーカス PSF スタック（瞳の準備を共有）
+ * =============================================================================
+ *
+ * 1 つの瞳格子（calculate_psf_grid_wasm と同じ入力）に対し、デフォーカス量の列ごとに PSF を求める。
+ * - 基準の複素振幅 a0 = A·exp(ik·OPD) は最初に 1 回だけ計算する。
+ * - デフォーカス位相 exp(ik·W·ρ²) は ρ² = x² + y² で分離できるので、行・列の因子（各 n 個の sincos）の積で作り、
+ *   画素ごとの処理は複素数の掛け算 2 回だけ。1 スライスの費用はほぼ FFT 1 回分。
+ * - 量の解釈（mode）:
+ *   PSF_FOCUS_W020      OPD += W·ρ²（W は OPD 単位）
+ *   PSF_FOCUS_Z4        OPD += c·√3(2ρ² - 1)（正規化デフォーカス項 = Noll Z4 / OSA j=4, 定数項は強度に寄与しない）
+ *   PSF_FOCUS_DISTANCE  像面の軸方向移動 Δz（OPD 単位）, 近軸 W020 = Δz·NA²/2（na = 像側 NA）
+ * - ρ = 格子中心 (n-1)/2 からの距離 / pupil_radius（画素, <= 0 ならマスクの最大半径）
+ * - 出力（いずれも NULL 可）:
+ *   stack_out   [count][n²]  FFTshift 済み強度（calculate_psf_grid_wasm と同じスケール）
+ *   metrics_out [count][PSF_FOCUS_METRICS] = peak, Strehl（peak / (ΣA)²）, EE80 半径（画素, 強度重心から）
+ */
+#define PSF_FOCUS_W020      0
+#define PSF_FOCUS_Z4        1
+#define PSF_FOCUS_DISTANCE  2
+#define PSF_FOCUS_METRICS   3
+
+typedef struct {
+    const Complex* base;
+    const Complex* row_phase;
+    const Complex* col_phase;
+    Complex* out;
+    int n;
+} psf_focus_task;
+
+static void psf_focus_phase_rows(int begin, int end, void* ctx) {
+    const psf_focus_task* t = (const psf_focus_task*)ctx;
+    const int n = t->n;
+    for (int i = begin; i < end; i++) {
+        const Complex r = t->row_phase[i];
+        const Complex* a = t->base + (size_t)i * n;
+        Complex* o = t->out + (size_t)i * n;
+        for (int j = 0; j < n; j++) {
+            // (a · r) · col
+            const double ar = a[j].real * r.real - a[j].imag * r.imag;
+            const double ai = a[j].real * r.imag + a[j].imag * r.real;
+            const Complex c = t->col_phase[j];
+            o[j].real = ar * c.real - ai * c.imag;
+            o[j].imag = ar * c.imag + ai * c.real;
         }
-        
-        energies[r] = encircled / total_energy;
     }
 }
 
+// EE80 半径（画素）: 強度重心まわりの動径ヒストグラム（0.5 px 刻み）の累積を線形補間
+#define PSF_FOCUS_EE_BIN 0.5
+
+static double psf_focus_ee80(const double* psf, int n, double* hist, int bins) {
+    double sum = 0.0, sr = 0.0, sc = 0.0;
+    for (int i = 0; i < n; i++) {
+        const double* row = psf + (size_t)i * n;
+        double rs = 0.0, cs = 0.0;
+        for (int j = 0; j < n; j++) {
+            rs += row[j];
+            cs += row[j] * j;
+        }
+        sum += rs;
+        sr += rs * i;
+        sc += cs;
+    }
+    if (!(sum > 0.0)) return NAN;
+    const double cr = sr / sum, cc = sc / sum;
+    const double inv_bin = 1.0 / PSF_FOCUS_EE_BIN;
+    memset(hist, 0, (size_t)bins * sizeof(double));
+    for (int i = 0; i < n; i++) {
+        const double dy2 = (i - cr) * (i - cr);
+        const double* row = psf + (size_t)i * n;
+        for (int j = 0; j < n; j++) {
+            int b = (int)(sqrt(dy2 + (j - cc) * (j - cc)) * inv_bin);
+            if (b >= bins) b = bins - 1;
+            hist[b] += row[j];
+        }
+    }
+    // ビン b は半径 (b+1)·bin までの寄与として累積
+    const double target = 0.8 * sum;
+    double acc = 0.0;
+    for (int b = 0; b < bins; b++) {
+        const double next = acc + hist[b];
+        if (next >= target) {
+            const double f = hist[b] > 0.0 ? (target - acc) / hist[b] : 1.0;
+            return (b + f) * PSF_FOCUS_EE_BIN;
+        }
+        acc = next;
+    }
+    return NAN;
+}
+
+/**
+ * スルーフォーカス PSF スタック（格子入力）
+ * @param grid_opd OPD（grid_size², 波長と同じ単位）
+ * @param amplitude 振幅（NULL なら 1）
+ * @param pupil_mask 瞳マスク
+ * @param grid_size 一辺（2 の冪）
+ * @param wavelength 波長
+ * @param focus デフォーカス量（count 個, 解釈は mode）
+ * @param count スライス数
+ * @param mode PSF_FOCUS_*
+ * @param na 像側 NA（PSF_FOCUS_DISTANCE のみ）
+ * @param pupil_radius ρ = 1 の半径（画素, <= 0 ならマスクの最大半径）
+ * @param stack_out 強度スタック [count][grid_size²]（NULL 可）
+ * @param metrics_out 指標 [count][PSF_FOCUS_METRICS]（NULL 可）
+ * @return 0: 成功 / -1: 失敗
+ */
+int calculate_psf_focus_stack_wasm(const double* grid_opd, const double* amplitude, const int* pupil_mask,
+                                   int grid_size, double wavelength, const double* focus, int count,
+                                   int mode, double na, double pupil_radius,
+                                   double* stack_out, double* metrics_out) {
+    if (!pupil_mask || !focus || count <= 0 || psf_fft_log2(grid_size) < 1 || !(wavelength > 0.0) ||
+        mode < PSF_FOCUS_W020 || mode > PSF_FOCUS_DISTANCE || (mode == PSF_FOCUS_DISTANCE && !(na > 0.0))) {
+        return -1;
+    }
+    if (!stack_out && !metrics_out) return 0;
+
+    const double start_time = get_time_ms();
+    psf_stage_times tm = {0};
+    const int n = grid_size;
+    const size_t total = (size_t)n * n;
+    const int bins = (int)(n * 0.7072 / PSF_FOCUS_EE_BIN) + 2;  // 対角の半分まで
+    Complex* base = (Complex*)malloc(total * sizeof(Complex));
+    Complex* work = (Complex*)malloc(total * sizeof(Complex));
+    Complex* phase = (Complex*)malloc(2 * (size_t)n * sizeof(Complex));
+    double* slice = stack_out ? NULL : (double*)malloc(total * sizeof(double));
+    double* hist = (double*)malloc((size_t)bins * sizeof(double));
+    const size_t bytes = total * (2 * sizeof(Complex) + (stack_out ? 0 : sizeof(double))) +
+                         2 * (size_t)n * sizeof(Complex) + (size_t)bins * sizeof(double);
+    int rc = 0;
+    if (!base || !work || !phase || (!stack_out && !slice) || !hist) {
+        rc = -1;
+        goto done;
+    }
+    tm.alloc = get_time_ms() - start_time;
+
+    // 共有する瞳の準備: 基準の複素振幅, ρ の尺度, Strehl の基準 (ΣA)²
+    double t0 = get_time_ms();
+    const double k = -2.0 * M_PI / wavelength;  // psf_pipeline_grid と同じ符号
+    if (grid_opd) {
+        psf_phase_to_complex(grid_opd, amplitude, pupil_mask, k, base, (int)total, NULL);
+    } else {
+        for (size_t i = 0; i < total; i++) {
+            base[i].real = pupil_mask[i] ? (amplitude ? amplitude[i] : 1.0) : 0.0;
+            base[i].imag = 0.0;
+        }
+    }
+    const double c = 0.5 * (n - 1);
+    double amp_sum = 0.0, r2max = 0.0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            const size_t q = (size_t)i * n + j;
+            if (!pupil_mask[q]) continue;
+            amp_sum += amplitude ? amplitude[q] : 1.0;
+            const double d2 = (i - c) * (i - c) + (j - c) * (j - c);
+            if (d2 > r2max) r2max = d2;
+        }
+    }
+    const double r = (pupil_radius > 0.0) ? pupil_radius : (r2max > 0.0 ? sqrt(r2max) : c);
+    const double inv_r2 = 1.0 / (r * r);
+    const double ideal_peak = amp_sum * amp_sum;
+    tm.amp = get_time_ms() - t0;
+
+    Complex* row_phase = phase;
+    Complex* col_phase = phase + n;
+    for (int s = 0; s < count; s++) {
+        // ρ² の係数（OPD 単位）
+        double w = focus[s];
+        if (mode == PSF_FOCUS_Z4) w *= 2.0 * sqrt(3.0);
+        else if (mode == PSF_FOCUS_DISTANCE) w *= 0.5 * na * na;
+
+        t0 = get_time_ms();
+        const double kw = k * w * inv_r2;
+        for (int i = 0; i < n; i++) {
+            // 行・列とも同じ (i - c)²（正方格子）
+            const double ph = kw * (i - c) * (i - c);
+            row_phase[i].real = cos(ph);
+            row_phase[i].imag = sin(ph);
+            col_phase[i] = row_phase[i];
+        }
+        psf_focus_task task = { base, row_phase, col_phase, work, n };
+        coopt_parallel_for(0, n, 16, psf_focus_phase_rows, &task);
+        tm.amp += get_time_ms() - t0;
+
+        double* psf = stack_out ? stack_out + (size_t)s * total : slice;
+        psf_stage_times st = {0};
+        psf_pipeline_fft_intensity(work, n, psf, &st);
+        tm.fft += st.fft;
+        tm.intensity += st.intensity;
+        tm.shift += st.shift;
+
+        if (metrics_out) {
+            t0 = get_time_ms();
+            double peak = 0.0;
+            for (size_t i = 0; i < total; i++) {
+                if (psf[i] > peak) peak = psf[i];
+            }
+            double* m = metrics_out + (size_t)s * PSF_FOCUS_METRICS;
+            m[0] = peak;
+            m[1] = ideal_peak > 0.0 ? peak / ideal_peak : 0.0;
+            m[2] = psf_focus_ee80(psf, n, hist, bins);
+            tm.interp += get_time_ms() - t0;  // 指標は interp 段に計上（格子入力では補間段がないため）
+        }
+    }
+
+done:
+    free(base);
+    free(work);
+    free(phase);
+    free(slice);
+    free(hist);
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_FOCUS, &tm, rc == 0 ? bytes : 0);
+    return rc;
+}
+
 // WebAssembly エクスポート関数
 
 /**
@@ -619,21 +2431,17 @@ void calculate_encircled_energy(double* psf, int size, double* radii, double* en
  * @param grid_size 格子サイズ
  * @param wavelength 波長
  * @param min_x,max_x,min_y,max_y 座標範囲
+ * @param interp_mode OPD格子補間（0: 最近傍, 1: 重心座標補間）。旧ラッパーからの省略時は 0。
  * @return PSF強度配列のポインタ
  */
 double* calculate_psf_wasm(double* ray_x, double* ray_y, double* ray_opd, int ray_count,
                           int grid_size, double wavelength,
-                          double min_x, double max_x, double min_y, double max_y) {
+                          double min_x, double max_x, double min_y, double max_y,
+                          int interp_mode) {
     
     const int total_size = grid_size * grid_size;
     double start_time = get_time_ms();
-    
-    // 高速テーブルの事前初期化
-    double init_start = get_time_ms();
-    if (!sin_table || trig_table_size < total_size) {
-        init_fast_trig_tables(total_size);
-    }
-    double init_time = get_time_ms() - init_start;
+    psf_stage_times tm = {0};
     
     // メモリ確保
     double alloc_start = get_time_ms();
@@ -651,48 +2459,18 @@ double* calculate_psf_wasm(double* ray_x, double* ray_y, double* ray_opd, int ra
         if (psf_intensity) free(psf_intensity);
         return NULL;
     }
+    tm.alloc = get_time_ms() - alloc_start;
     
-    // 振幅を均一に設定（ベクトル化可能）
-    for (int i = 0; i < total_size; i++) {
-        amplitude[i] = 1.0;
-    }
-    double alloc_time = get_time_ms() - alloc_start;
-    
-    // 1. OPD格子補間
-    double interp_start = get_time_ms();
-    interpolate_opd_grid(ray_x, ray_y, ray_opd, ray_count,
-                        grid_opd, pupil_mask, grid_size,
-                        min_x, max_x, min_y, max_y);
-    double interp_time = get_time_ms() - interp_start;
-    
-    // 2. 複素振幅計算
-    double amp_start = get_time_ms();
-    calculate_complex_amplitude(grid_opd, amplitude, pupil_mask,
-                               complex_amp, grid_size, wavelength);
-    double amp_time = get_time_ms() - amp_start;
-    
-    // 3. 2D FFT
-    double fft_start = get_time_ms();
-    fft_2d(complex_amp, grid_size, grid_size, 0);
-    double fft_time = get_time_ms() - fft_start;
-    
-    // 4. 強度計算（ベクトル化可能）
-    double intensity_start = get_time_ms();
-    for (int i = 0; i < total_size; i++) {
-        psf_intensity[i] = complex_amp[i].real * complex_amp[i].real + 
-                          complex_amp[i].imag * complex_amp[i].imag;
-    }
-    double intensity_time = get_time_ms() - intensity_start;
-    
-    // 5. FFTshift
-    double shift_start = get_time_ms();
-    fft_shift(psf_intensity, grid_size);
-    double shift_time = get_time_ms() - shift_start;
+    psf_pipeline_rays(ray_x, ray_y, ray_opd, ray_count, grid_size, wavelength,
+                      min_x, max_x, min_y, max_y, interp_mode,
+                      grid_opd, amplitude, pupil_mask, complex_amp, psf_intensity, &tm);
     
-    double total_time = get_time_ms() - start_time;
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_RAYS, &tm,
+                     (size_t)total_size * (2 * sizeof(double) + sizeof(int) + sizeof(Complex) + sizeof(double)));
     
-    // タイミング情報をログ出力（デバッグ用）
-#ifdef __EMSCRIPTEN__
+    // タイミング情報をログ出力（デバッグ用, -DPSF_WASM_TIMING_LOG）
+#if defined(__EMSCRIPTEN__) && defined(PSF_WASM_TIMING_LOG)
     // Emscriptenの場合はJavaScript側にログを送信
     EM_ASM({
         console.log('📊 [WASM-C] Internal timing for ' + $0 + 'x' + $0 + ':', {
@@ -705,7 +2483,7 @@ double* calculate_psf_wasm(double* ray_x, double* ray_y, double* ray_opd, int ra
             'FFT Shift': $7.toFixed(2) + 'ms',
             'Total WASM-C': $8.toFixed(2) + 'ms'
         });
-    }, grid_size, init_time, alloc_time, interp_time, amp_time, fft_time, intensity_time, shift_time, total_time);
+    }, grid_size, tm.init, tm.alloc, tm.interp, tm.amp, tm.fft, tm.intensity, tm.shift, tm.total);
 #endif
     
     // クリーンアップ
@@ -727,68 +2505,44 @@ double* calculate_psf_wasm(double* ray_x, double* ray_y, double* ray_opd, int ra
  * @param pupil_mask 瞳マスク（0/1, row-major, length = grid_size*grid_size）
  * @param grid_size 格子サイズ
  * @param wavelength 波長
- * @return PSF強度配列のポインタ（caller must free via free_psf_result）
+ * @param out_size 出力窓サイズ（<= 0: 従来どおり grid_size² の全面 FFT。旧ラッパーからの省略時もこちら）
+ * @param pad_factor 出力窓モードのゼロ詰め倍率（P = grid_size × pad_factor 相当の画素ピッチ, 非整数可）
+ * @param center_row,center_col 出力窓中心（P 点 FFT の FFTshift 前周波数画素, 0 = DC）
+ * @return PSF強度配列のポインタ（grid_size² または out_size², caller must free via free_psf_result）
  */
 double* calculate_psf_grid_wasm(double* grid_opd, double* amplitude, int* pupil_mask,
-                               int grid_size, double wavelength) {
+                               int grid_size, double wavelength,
+                               int out_size, double pad_factor, double center_row, double center_col) {
     const int total_size = grid_size * grid_size;
+    const int out_total = (out_size > 0) ? out_size * out_size : total_size;
     double start_time = get_time_ms();
-
-    // 高速テーブルの事前初期化
-    double init_start = get_time_ms();
-    if (!sin_table || trig_table_size < total_size) {
-        init_fast_trig_tables(total_size);
-    }
-    double init_time = get_time_ms() - init_start;
+    psf_stage_times tm = {0};
 
     // メモリ確保
     double alloc_start = get_time_ms();
     Complex* complex_amp = (Complex*)calloc(total_size, sizeof(Complex));
-    double* psf_intensity = (double*)malloc(total_size * sizeof(double));
+    double* psf_intensity = (double*)malloc(out_total * sizeof(double));
     if (!complex_amp || !psf_intensity) {
         if (complex_amp) free(complex_amp);
         if (psf_intensity) free(psf_intensity);
         return NULL;
     }
-    double alloc_time = get_time_ms() - alloc_start;
+    tm.alloc = get_time_ms() - alloc_start;
 
-    // 1. 複素振幅計算（格子入力をそのまま使用）
-    // OPDは光路差（遅延）なので、位相は負の符号（JS実装に合わせる）
-    double amp_start = get_time_ms();
-    const double k = -2.0 * M_PI / wavelength;
-    memset(complex_amp, 0, total_size * sizeof(Complex));
-    for (int i = 0; i < total_size; i++) {
-        if (pupil_mask && pupil_mask[i]) {
-            const double opd = grid_opd ? grid_opd[i] : 0.0;
-            const double a = amplitude ? amplitude[i] : 1.0;
-            const double phase = k * opd;
-            complex_amp[i].real = a * fast_cos(phase);
-            complex_amp[i].imag = a * fast_sin(phase);
-        }
-    }
-    double amp_time = get_time_ms() - amp_start;
-
-    // 2. 2D FFT
-    double fft_start = get_time_ms();
-    fft_2d(complex_amp, grid_size, grid_size, 0);
-    double fft_time = get_time_ms() - fft_start;
-
-    // 3. 強度計算
-    double intensity_start = get_time_ms();
-    for (int i = 0; i < total_size; i++) {
-        psf_intensity[i] = complex_amp[i].real * complex_amp[i].real +
-                           complex_amp[i].imag * complex_amp[i].imag;
+    if (psf_pipeline_grid(grid_opd, amplitude, pupil_mask, grid_size, wavelength,
+                          out_size, pad_factor, center_row, center_col,
+                          complex_amp, psf_intensity, &tm) != 0) {
+        free(complex_amp);
+        free(psf_intensity);
+        return NULL;
     }
-    double intensity_time = get_time_ms() - intensity_start;
-
-    // 4. FFTshift
-    double shift_start = get_time_ms();
-    fft_shift(psf_intensity, grid_size);
-    double shift_time = get_time_ms() - shift_start;
-
-    double total_time = get_time_ms() - start_time;
+    free(complex_amp);
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_GRID, &tm,
+                     (size_t)total_size * sizeof(Complex) + (size_t)out_total * sizeof(double));
+    if (out_size > 0) return psf_intensity;
 
-#ifdef __EMSCRIPTEN__
+#if defined(__EMSCRIPTEN__) && defined(PSF_WASM_TIMING_LOG)
     EM_ASM({
         console.log('📊 [WASM-C] Internal timing for grid ' + $0 + 'x' + $0 + ':', {
             'Initialization': $1.toFixed(2) + 'ms',
@@ -800,13 +2554,517 @@ double* calculate_psf_grid_wasm(double* grid_opd, double* amplitude, int* pupil_
             'FFT Shift': $6.toFixed(2) + 'ms',
             'Total WASM-C': $7.toFixed(2) + 'ms'
         });
-    }, grid_size, init_time, alloc_time, amp_time, fft_time, intensity_time, shift_time, total_time);
+    }, grid_size, tm.init, tm.alloc, tm.amp, tm.fft, tm.intensity, tm.shift, tm.total);
 #endif
 
-    free(complex_amp);
     return psf_intensity;
 }
 
+/*
+ * =============================================================================
+ * float32 プレビュー版 PSF（格子入力・全面 FFT, 4×f32）
+ * =============================================================================
+ *
+ * ドラッグ編集中の下書き表示向け。入力 OPD / 振幅は float、内部の複素振幅・FFT も float で、
+ * 作業バッファは実部・虚部を別配列（SoA）に持つ（1 画素 16 → 8 バイト, 転置バッファ込みで半分）。
+ * - バタフライは double 版と同じ radix-2²。回転因子は段ごとに連続配置し、4 点ずつ f32x4 で処理する。
+ * - 逆転置は行わず、強度計算と FFTshift を転置読み出しの 1 パスにまとめる。
+ * - 出力は calculate_psf_grid_wasm と同じ double 配列（free_psf_result で解放）なので、JS 側の
+ *   EE / Strehl 評価はそのまま使える。相対誤差は 1e-6 程度（float の FFT 丸め）。
+ */
+#if defined(__wasm_simd128__)
+typedef v128_t psf4;
+static inline psf4 psf4_load(const float* p) { return wasm_v128_load(p); }
+static inline void psf4_store(float* p, psf4 a) { wasm_v128_store(p, a); }
+static inline psf4 psf4_add(psf4 a, psf4 b) { return wasm_f32x4_add(a, b); }
+static inline psf4 psf4_sub(psf4 a, psf4 b) { return wasm_f32x4_sub(a, b); }
+static inline psf4 psf4_mul(psf4 a, psf4 b) { return wasm_f32x4_mul(a, b); }
+#else
+typedef struct { float v[4]; } psf4;
+static inline psf4 psf4_load(const float* p) { psf4 r; for (int l = 0; l < 4; l++) r.v[l] = p[l]; return r; }
+static inline void psf4_store(float* p, psf4 a) { for (int l = 0; l < 4; l++) p[l] = a.v[l]; }
+static inline psf4 psf4_add(psf4 a, psf4 b) { psf4 r; for (int l = 0; l < 4; l++) r.v[l] = a.v[l] + b.v[l]; return r; }
+static inline psf4 psf4_sub(psf4 a, psf4 b) { psf4 r; for (int l = 0; l < 4; l++) r.v[l] = a.v[l] - b.v[l]; return r; }
+static inline psf4 psf4_mul(psf4 a, psf4 b) { psf4 r; for (int l = 0; l < 4; l++) r.v[l] = a.v[l] * b.v[l]; return r; }
+#endif
+
+typedef struct {
+    int n;
+    int log2n;
+    psf_fft_plan* base;  // ビット反転表（double の回転因子は作成時のみ使用）
+    float* tw;           // 段ごとに [W_2m^k 実部 m][虚部 m][W_4m^k 実部 m][虚部 m]
+} psf_fft_plan_f32;
+
+#define PSF_FFT_PLAN_F32_CACHE_SIZE 4
+static psf_fft_plan_f32* fft_plan_f32_cache[PSF_FFT_PLAN_F32_CACHE_SIZE];
+static int fft_plan_f32_cache_next = 0;
+
+static void psf_fft_plan_f32_destroy(psf_fft_plan_f32* plan) {
+    if (!plan) return;
+    psf_fft_plan_destroy(plan->base);
+    free(plan->tw);
+    free(plan);
+}
+
+static psf_fft_plan_f32* psf_fft_plan_f32_create(int n) {
+    psf_fft_plan* base = psf_fft_plan_create(n);
+    if (!base) return NULL;
+    psf_fft_plan_f32* plan = (psf_fft_plan_f32*)calloc(1, sizeof(psf_fft_plan_f32));
+    if (!plan) { psf_fft_plan_destroy(base); return NULL; }
+    plan->n = n;
+    plan->log2n = base->log2n;
+    plan->base = base;
+
+    size_t total = 0;
+    for (int m = (base->log2n & 1) ? 2 : 1; m < n; m <<= 2) total += 4 * (size_t)m;
+    plan->tw = (float*)malloc((total > 0 ? total : 1) * sizeof(float));
+    if (!plan->tw) { psf_fft_plan_f32_destroy(plan); return NULL; }
+    float* w = plan->tw;
+    for (int m = (base->log2n & 1) ? 2 : 1; m < n; m <<= 2) {
+        const int step2 = n / (m * 4);
+        const int step1 = step2 * 2;
+        for (int k = 0; k < m; k++) {
+            w[k] = (float)base->twiddle[k * step1].real;
+            w[m + k] = (float)base->twiddle[k * step1].imag;
+            w[2 * m + k] = (float)base->twiddle[k * step2].real;
+            w[3 * m + k] = (float)base->twiddle[k * step2].imag;
+        }
+        w += 4 * m;
+    }
+    return plan;
+}
+
+// 呼び出しスレッドでのみ更新する（psf_fft_plan_get と同じ規則）
+static psf_fft_plan_f32* psf_fft_plan_f32_get(int n) {
+    for (int i = 0; i < PSF_FFT_PLAN_F32_CACHE_SIZE; i++) {
+        if (fft_plan_f32_cache[i] && fft_plan_f32_cache[i]->n == n) return fft_plan_f32_cache[i];
+    }
+    psf_fft_plan_f32* plan = psf_fft_plan_f32_create(n);
+    if (!plan) return NULL;
+    const int slot = fft_plan_f32_cache_next;
+    fft_plan_f32_cache_next = (fft_plan_f32_cache_next + 1) % PSF_FFT_PLAN_F32_CACHE_SIZE;
+    psf_fft_plan_f32_destroy(fft_plan_f32_cache[slot]);
+    fft_plan_f32_cache[slot] = plan;
+    return plan;
+}
+
+static void psf_fft_plan_f32_cache_clear(void) {
+    for (int i = 0; i < PSF_FFT_PLAN_F32_CACHE_SIZE; i++) {
+        psf_fft_plan_f32_destroy(fft_plan_f32_cache[i]);
+        fft_plan_f32_cache[i] = NULL;
+    }
+    fft_plan_f32_cache_next = 0;
+}
+
+/**
+ * float 複素 FFT（順変換のみ, インプレース, 実部 re・虚部 im の別配列）
+ */
+static void psf_fft_f32_execute(const psf_fft_plan_f32* plan, float* re, float* im) {
+    const int n = plan->n;
+    if (n <= 1) return;
+
+    const int* swaps = plan->base->swaps;
+    for (int s = 0; s < plan->base->swap_count; s++) {
+        const int i = swaps[2 * s];
+        const int j = swaps[2 * s + 1];
+        float t = re[i]; re[i] = re[j]; re[j] = t;
+        t = im[i]; im[i] = im[j]; im[j] = t;
+    }
+
+    int m = 1;
+    if (plan->log2n & 1) {
+        for (int i = 0; i < n; i += 2) {
+            const float ar = re[i], ai = im[i], br = re[i + 1], bi = im[i + 1];
+            re[i] = ar + br; im[i] = ai + bi;
+            re[i + 1] = ar - br; im[i + 1] = ai - bi;
+        }
+        m = 2;
+    }
+
+    const float* w = plan->tw;
+    for (; m < n; w += 4 * m, m <<= 2) {
+        const int len = m * 4;
+        const float* w1r = w;
+        const float* w1i = w + m;
+        const float* w2r = w + 2 * m;
+        const float* w2i = w + 3 * m;
+        for (int base = 0; base < n; base += len) {
+            float* r0 = re + base; float* r1 = r0 + m; float* r2 = r1 + m; float* r3 = r2 + m;
+            float* i0 = im + base; float* i1 = i0 + m; float* i2 = i1 + m; float* i3 = i2 + m;
+            int k = 0;
+            for (; k + 4 <= m; k += 4) {
+                const psf4 a1r = psf4_load(w1r + k), a1i = psf4_load(w1i + k);
+                const psf4 a2r = psf4_load(w2r + k), a2i = psf4_load(w2i + k);
+                const psf4 x0r = psf4_load(r0 + k), x0i = psf4_load(i0 + k);
+                const psf4 x1r = psf4_load(r1 + k), x1i = psf4_load(i1 + k);
+                const psf4 x2r = psf4_load(r2 + k), x2i = psf4_load(i2 + k);
+                const psf4 x3r = psf4_load(r3 + k), x3i = psf4_load(i3 + k);
+                const psf4 t1r = psf4_sub(psf4_mul(x1r, a1r), psf4_mul(x1i, a1i));
+                const psf4 t1i = psf4_add(psf4_mul(x1r, a1i), psf4_mul(x1i, a1r));
+                const psf4 t3r = psf4_sub(psf4_mul(x3r, a1r), psf4_mul(x3i, a1i));
+                const psf4 t3i = psf4_add(psf4_mul(x3r, a1i), psf4_mul(x3i, a1r));
+                const psf4 p0r = psf4_add(x0r, t1r), p0i = psf4_add(x0i, t1i);
+                const psf4 p1r = psf4_sub(x0r, t1r), p1i = psf4_sub(x0i, t1i);
+                const psf4 q0r = psf4_add(x2r, t3r), q0i = psf4_add(x2i, t3i);
+                const psf4 q1r = psf4_sub(x2r, t3r), q1i = psf4_sub(x2i, t3i);
+                const psf4 c0r = psf4_sub(psf4_mul(q0r, a2r), psf4_mul(q0i, a2i));
+                const psf4 c0i = psf4_add(psf4_mul(q0r, a2i), psf4_mul(q0i, a2r));
+                // (-i)·(q1·W_4m^k)
+                const psf4 c1r = psf4_add(psf4_mul(q1r, a2i), psf4_mul(q1i, a2r));
+                const psf4 c1i = psf4_sub(psf4_mul(q1i, a2i), psf4_mul(q1r, a2r));
+                psf4_store(r0 + k, psf4_add(p0r, c0r)); psf4_store(i0 + k, psf4_add(p0i, c0i));
+                psf4_store(r2 + k, psf4_sub(p0r, c0r)); psf4_store(i2 + k, psf4_sub(p0i, c0i));
+                psf4_store(r1 + k, psf4_add(p1r, c1r)); psf4_store(i1 + k, psf4_add(p1i, c1i));
+                psf4_store(r3 + k, psf4_sub(p1r, c1r)); psf4_store(i3 + k, psf4_sub(p1i, c1i));
+            }
+            for (; k < m; k++) {
+                const float t1r = r1[k] * w1r[k] - i1[k] * w1i[k];
+                const float t1i = r1[k] * w1i[k] + i1[k] * w1r[k];
+                const float t3r = r3[k] * w1r[k] - i3[k] * w1i[k];
+                const float t3i = r3[k] * w1i[k] + i3[k] * w1r[k];
+                const float p0r = r0[k] + t1r, p0i = i0[k] + t1i;
+                const float p1r = r0[k] - t1r, p1i = i0[k] - t1i;
+                const float q0r = r2[k] + t3r, q0i = i2[k] + t3i;
+                const float q1r = r2[k] - t3r, q1i = i2[k] - t3i;
+                const float c0r = q0r * w2r[k] - q0i * w2i[k];
+                const float c0i = q0r * w2i[k] + q0i * w2r[k];
+                const float c1r = q1r * w2i[k] + q1i * w2r[k];
+                const float c1i = q1i * w2i[k] - q1r * w2r[k];
+                r0[k] = p0r + c0r; i0[k] = p0i + c0i;
+                r2[k] = p0r - c0r; i2[k] = p0i - c0i;
+                r1[k] = p1r + c1r; i1[k] = p1i + c1i;
+                r3[k] = p1r - c1r; i3[k] = p1i - c1i;
+            }
+        }
+    }
+}
+
+typedef struct {
+    const psf_fft_plan_f32* plan;
+    float* re;
+    float* im;
+    // 転置（src → dst, 正方 n×n）
+    float* dre;
+    float* dim;
+    // 位相 → 複素振幅
+    const float* opd;
+    const float* amp;
+    const int* mask;
+    double k;
+    // 強度 + FFTshift
+    double* out;
+} psf_f32_task;
+
+static void psf_f32_phase_rows(int begin, int end, void* ctx) {
+    const psf_f32_task* t = (const psf_f32_task*)ctx;
+    const int n = t->plan->n;
+    const double halfpi = 0.5 * M_PI;
+    for (size_t i = (size_t)begin * n; i < (size_t)end * n; i++) {
+        if (!t->mask || !t->mask[i]) { t->re[i] = 0.0f; t->im[i] = 0.0f; continue; }
+        const float a = t->amp ? t->amp[i] : 1.0f;
+        if (!t->opd) { t->re[i] = a; t->im[i] = 0.0f; continue; }
+        // 縮約は double（位相は数百 rad になり得る）、多項式は float（|r| <= π/4 で誤差 ~3e-7）
+        const double x = t->k * (double)t->opd[i];
+        const double q = nearbyint(x / halfpi);
+        const float r = (float)(x - q * halfpi);
+        const float r2 = r * r;
+        const float s = r + r * r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f)));
+        const float c = 1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f))));
+        float sx, cx;
+        switch (((long long)q) & 3) {
+            case 0: sx = s; cx = c; break;
+            case 1: sx = c; cx = -s; break;
+            case 2: sx = -s; cx = -c; break;
+            default: sx = -c; cx = s; break;
+        }
+        t->re[i] = a * cx;
+        t->im[i] = a * sx;
+    }
+}
+
+static void psf_f32_fft_rows(int begin, int end, void* ctx) {
+    const psf_f32_task* t = (const psf_f32_task*)ctx;
+    const int n = t->plan->n;
+    for (int i = begin; i < end; i++) {
+        psf_fft_f32_execute(t->plan, t->re + (size_t)i * n, t->im + (size_t)i * n);
+    }
+}
+
+// src の行ブロック単位で転置（dst の書き込み列が重ならない）
+static void psf_f32_transpose_rows(int begin, int end, void* ctx) {
+    const psf_f32_task* t = (const psf_f32_task*)ctx;
+    const int n = t->plan->n;
+    const int B = 32;
+    for (int i = begin; i < end; i += B) {
+        const int ie = (i + B < end) ? i + B : end;
+        for (int j = 0; j < n; j += B) {
+            const int je = (j + B < n) ? j + B : n;
+            for (int ii = i; ii < ie; ii++) {
+                for (int jj = j; jj < je; jj++) {
+                    t->dre[(size_t)jj * n + ii] = t->re[(size_t)ii * n + jj];
+                    t->dim[(size_t)jj * n + ii] = t->im[(size_t)ii * n + jj];
+                }
+            }
+        }
+    }
+}
+
+// out[a][b] = |F[(a+h)%n][(b+h)%n]|²、F[u][v] は転置後の配列 (re, im)[v][u]
+static void psf_f32_intensity_rows(int begin, int end, void* ctx) {
+    const psf_f32_task* t = (const psf_f32_task*)ctx;
+    const int n = t->plan->n;
+    const int h = n / 2;
+    const int B = 16;
+    for (int a0 = begin; a0 < end; a0 += B) {
+        const int a1 = (a0 + B < end) ? a0 + B : end;
+        for (int b = 0; b < n; b++) {
+            const size_t row = (size_t)((b + h) % n) * n;
+            for (int a = a0; a < a1; a++) {
+                const size_t src = row + (size_t)((a + h) % n);
+                const double r = t->re[src], im = t->im[src];
+                t->out[(size_t)a * n + b] = r * r + im * im;
+            }
+        }
+    }
+}
+
+// 作業領域（呼び出しごとの malloc を避ける, 4 × n² float）
+static float* psf_f32_work = NULL;
+static size_t psf_f32_work_capacity = 0;
+
+/**
+ * float32 プレビュー版の格子入力 PSF（calculate_psf_grid_wasm の全面モードと同じ出力）
+ * @param grid_opd OPD（grid_size² の float, NULL なら位相 0）
+ * @param amplitude 振幅（float, NULL なら 1）
+ * @param pupil_mask 瞳マスク（int, NULL なら全面 0）
+ * @param grid_size 一辺（2 の冪）
+ * @param wavelength 波長（OPD と同じ単位）
+ * @return PSF 強度（grid_size² の double, FFTshift 済み, free_psf_result で解放）。失敗時 NULL
+ */
+double* calculate_psf_grid_f32_wasm(const float* grid_opd, const float* amplitude, const int* pupil_mask,
+                                    int grid_size, double wavelength) {
+    if (grid_size <= 0 || !(wavelength > 0.0)) return NULL;
+    const double start_time = get_time_ms();
+    psf_stage_times tm = {0};
+    const psf_fft_plan_f32* plan = psf_fft_plan_f32_get(grid_size);
+    if (!plan) return NULL;
+    const size_t total = (size_t)grid_size * (size_t)grid_size;
+    size_t bytes = total * sizeof(double);
+    if (psf_f32_work_capacity < 4 * total) {
+        bytes += 4 * total * sizeof(float);
+        free(psf_f32_work);
+        psf_f32_work = (float*)malloc(4 * total * sizeof(float));
+        psf_f32_work_capacity = psf_f32_work ? 4 * total : 0;
+        if (!psf_f32_work) return NULL;
+    }
+    double* out = (double*)malloc(total * sizeof(double));
+    if (!out) return NULL;
+    // プレビュー版は Strehl を集計しない（psf_last_strehl に前回の値を残さない）
+    for (int i = 0; i < PSF_STREHL_FIELDS; i++) psf_strehl_last[i] = NAN;
+
+    psf_f32_task t;
+    t.plan = plan;
+    t.re = psf_f32_work;
+    t.im = psf_f32_work + total;
+    t.dre = psf_f32_work + 2 * total;
+    t.dim = psf_f32_work + 3 * total;
+    t.opd = grid_opd;
+    t.amp = amplitude;
+    t.mask = pupil_mask;
+    t.k = -2.0 * M_PI / wavelength;  // psf_pipeline_grid と同じ符号
+    t.out = out;
+    tm.init = get_time_ms() - start_time;
+
+    double stage_start = get_time_ms();
+    coopt_parallel_for(0, grid_size, 8, psf_f32_phase_rows, &t);
+    tm.amp = get_time_ms() - stage_start;
+
+    stage_start = get_time_ms();
+    coopt_parallel_for(0, grid_size, 8, psf_f32_fft_rows, &t);
+    coopt_parallel_for(0, grid_size, 64, psf_f32_transpose_rows, &t);
+
+    // 列方向（転置後の行）
+    psf_f32_task cols = t;
+    cols.re = t.dre;
+    cols.im = t.dim;
+    coopt_parallel_for(0, grid_size, 8, psf_f32_fft_rows, &cols);
+    tm.fft = get_time_ms() - stage_start;
+
+    // 強度と FFTshift は 1 パス（intensity に計上）
+    stage_start = get_time_ms();
+    coopt_parallel_for(0, grid_size, 16, psf_f32_intensity_rows, &cols);
+    tm.intensity = get_time_ms() - stage_start;
+    tm.total = get_time_ms() - start_time;
+    psf_stats_record(PSF_STAT_ENTRY_GRID_F32, &tm, bytes);
+    return out;
+}
+
+/*
+ * =============================================================================
+ * PSF セッション（事前確保ワークスペース）
+ * =============================================================================
+ *
+ * 視野スイープや最適化ループで同じ grid_size の PSF を繰り返し計算する用途。
+ * - 入力（光線 / 格子）・作業・出力バッファをセッションが保持し、呼び出しごとの malloc/free をなくす。
+ * - JS は psf_session_*_ptr() のオフセットに HEAPF64 / HEAP32 で直接書き込み、
+ *   psf_session_output_ptr() から結果を読む（free_psf_result は不要・不可）。
+ * - 光線数・出力窓が容量を超えた場合のみ再確保する（ポインタが変わるので JS は取り直すこと）。
+ */
+#define PSF_SESSION_ALIGN 16
+
+typedef struct psf_session psf_session;
+int psf_session_reserve_rays(psf_session* s, int ray_count);
+
+struct psf_session {
+    int grid_size;
+    int ray_capacity;
+    int output_capacity;   // psf の要素数
+    int output_size;       // 直近の出力の一辺（grid_size または out_size）
+    double* ray_x;
+    double* ray_y;
+    double* ray_opd;
+    double* grid_opd;
+    double* amplitude;
+    int* pupil_mask;
+    Complex* complex_amp;
+    double* psf;
+    psf_stage_times last_times;
+};
+
+static void* psf_session_alloc(size_t bytes) {
+    // aligned_alloc はサイズがアラインメントの倍数である必要がある
+    const size_t rounded = (bytes + PSF_SESSION_ALIGN - 1) / PSF_SESSION_ALIGN * PSF_SESSION_ALIGN;
+    void* p = aligned_alloc(PSF_SESSION_ALIGN, rounded > 0 ? rounded : PSF_SESSION_ALIGN);
+    if (p) memset(p, 0, rounded);
+    return p;
+}
+
+static int psf_session_grow(double** buf, int* capacity, int need) {
+    if (need <= *capacity && *buf) return 0;
+    double* next = (double*)psf_session_alloc((size_t)need * sizeof(double));
+    if (!next) return -1;
+    free(*buf);
+    *buf = next;
+    *capacity = need;
+    return 0;
+}
+
+void psf_session_destroy(psf_session* session) {
+    if (!session) return;
+    free(session->ray_x);
+    free(session->ray_y);
+    free(session->ray_opd);
+    free(session->grid_opd);
+    free(session->amplitude);
+    free(session->pupil_mask);
+    free(session->complex_amp);
+    free(session->psf);
+    free(session);
+}
+
+/**
+ * セッション作成
+ * @param grid_size 瞳格子サイズ（2 の冪）
+ * @param ray_capacity 光線入力の初期容量（0 可, psf_session_reserve_rays で拡張）
+ * @return セッション（失敗時 NULL）
+ */
+psf_session* psf_session_create(int grid_size, int ray_capacity) {
+    if (grid_size < 2 || (grid_size & (grid_size - 1)) != 0) return NULL;
+    psf_session* s = (psf_session*)calloc(1, sizeof(psf_session));
+    if (!s) return NULL;
+    const size_t total = (size_t)grid_size * (size_t)grid_size;
+    s->grid_size = grid_size;
+    s->output_size = grid_size;
+    s->grid_opd = (double*)psf_session_alloc(total * sizeof(double));
+    s->amplitude = (double*)psf_session_alloc(total * sizeof(double));
+    s->pupil_mask = (int*)psf_session_alloc(total * sizeof(int));
+    s->complex_amp = (Complex*)psf_session_alloc(total * sizeof(Complex));
+    int cap = 0;
+    if (!s->grid_opd || !s->amplitude || !s->pupil_mask || !s->complex_amp ||
+        psf_session_grow(&s->psf, &cap, (int)total) != 0) {
+        psf_session_destroy(s);
+        return NULL;
+    }
+    s->output_capacity = cap;
+    if (ray_capacity > 0 && psf_session_reserve_rays(s, ray_capacity) != 0) {
+        psf_session_destroy(s);
+        return NULL;
+    }
+    // 事前にプランを用意（初回呼び出しの遅延をなくす）
+    psf_fft_plan_get(grid_size);
+    return s;
+}
+
+/**
+ * 光線入力バッファの容量確保（既存の内容は保持しない）
+ * @return 0: 成功 / -1: メモリ不足
+ */
+int psf_session_reserve_rays(psf_session* s, int ray_count) {
+    if (!s || ray_count < 0) return -1;
+    if (ray_count <= s->ray_capacity && s->ray_x) return 0;
+    int cx = s->ray_capacity, cy = s->ray_capacity, co = s->ray_capacity;
+    if (psf_session_grow(&s->ray_x, &cx, ray_count) != 0 ||
+        psf_session_grow(&s->ray_y, &cy, ray_count) != 0 ||
+        psf_session_grow(&s->ray_opd, &co, ray_count) != 0) {
+        return -1;
+    }
+    s->ray_capacity = ray_count;
+    return 0;
+}
+
+double* psf_session_ray_x_ptr(psf_session* s) { return s ? s->ray_x : NULL; }
+double* psf_session_ray_y_ptr(psf_session* s) { return s ? s->ray_y : NULL; }
+double* psf_session_ray_opd_ptr(psf_session* s) { return s ? s->ray_opd : NULL; }
+double* psf_session_grid_opd_ptr(psf_session* s) { return s ? s->grid_opd : NULL; }
+double* psf_session_amplitude_ptr(psf_session* s) { return s ? s->amplitude : NULL; }
+int* psf_session_pupil_mask_ptr(psf_session* s) { return s ? s->pupil_mask : NULL; }
+double* psf_session_output_ptr(psf_session* s) { return s ? s->psf : NULL; }
+int psf_session_output_size(psf_session* s) { return s ? s->output_size : 0; }
+int psf_session_grid_size(psf_session* s) { return s ? s->grid_size : 0; }
+
+/**
+ * 光線入力（psf_session_ray_*_ptr に書き込み済み）から PSF を計算し、セッション出力に書く
+ * @return 0: 成功 / -1: 失敗
+ */
+int psf_session_compute_rays(psf_session* s, int ray_count, double wavelength,
+                             double min_x, double max_x, double min_y, double max_y,
+                             int interp_mode) {
+    if (!s || ray_count <= 0 || ray_count > s->ray_capacity) return -1;
+    double start_time = get_time_ms();
+    psf_stage_times tm = {0};
+    psf_pipeline_rays(s->ray_x, s->ray_y, s->ray_opd, ray_count, s->grid_size, wavelength,
+                      min_x, max_x, min_y, max_y, interp_mode,
+                      s->grid_opd, s->amplitude, s->pupil_mask, s->complex_amp, s->psf, &tm);
+    tm.total = get_time_ms() - start_time;
+    s->last_times = tm;
+    psf_stats_record(PSF_STAT_ENTRY_SESSION_RAYS, &tm, 0);
+    s->output_size = s->grid_size;
+    return 0;
+}
+
+/**
+ * 格子入力（psf_session_grid_opd_ptr / amplitude_ptr / pupil_mask_ptr に書き込み済み）から PSF を計算
+ * out_size > 0 なら出力窓モード（calculate_psf_grid_wasm と同じ引数の意味）。
+ * 出力窓が容量を超える場合は出力バッファを再確保する（psf_session_output_ptr を取り直すこと）。
+ * @return 0: 成功 / -1: 失敗
+ */
+int psf_session_compute_grid(psf_session* s, double wavelength,
+                             int out_size, double pad_factor, double center_row, double center_col) {
+    if (!s) return -1;
+    const int side = (out_size > 0) ? out_size : s->grid_size;
+    if (psf_session_grow(&s->psf, &s->output_capacity, side * side) != 0) return -1;
+    double start_time = get_time_ms();
+    psf_stage_times tm = {0};
+    const int rc = psf_pipeline_grid(s->grid_opd, s->amplitude, s->pupil_mask, s->grid_size, wavelength,
+                                     out_size, pad_factor, center_row, center_col,
+                                     s->complex_amp, s->psf, &tm);
+    tm.total = get_time_ms() - start_time;
+    s->last_times = tm;
+    psf_stats_record(PSF_STAT_ENTRY_SESSION_GRID, &tm, 0);
+    if (rc == 0) s->output_size = side;
+    return rc;
+}
+
 /**
  * Strehl比計算関数（JavaScript から呼び出し）
  */
@@ -821,6 +3079,63 @@ void calculate_encircled_energy_wasm(double* psf, int size, double* radii, doubl
     calculate_encircled_energy(psf, size, radii, energies, radii_count);
 }
 
+/**
+ * ビルドが対応する機能のビットマスク（旧ビルドには存在しない → JS 側は関数の有無で判定）
+ */
+#define PSF_CAP_INTERP_MODES  1   // calculate_psf_wasm の interp_mode
+#define PSF_CAP_WINDOW        2   // calculate_psf_grid_wasm の出力窓モード
+#define PSF_CAP_SESSION       4   // psf_session_*（事前確保ワークスペース）
+#define PSF_CAP_TRIG_TIERS    8   // psf_set_trig_accuracy（位相 sincos の精度段階）
+#define PSF_CAP_ENERGY       16   // psf_energy_profile（EE / ensquared / LSF）
+#define PSF_CAP_BATCH        32   // calculate_psf_batch_wasm（多視野 × 多波長）
+#define PSF_CAP_F32          64   // calculate_psf_grid_f32_wasm（float32 プレビュー）
+#define PSF_CAP_STATS       128   // psf_get_stats / psf_reset_stats
+#define PSF_CAP_MTF         256   // calculate_mtf_batch_wasm（視野 × デフォーカスの MTF スライス）
+#define PSF_CAP_FOCUS_STACK 512   // calculate_psf_focus_stack_wasm（スルーフォーカス PSF / 指標）
+#define PSF_CAP_STREHL     1024   // calculate_strehl_pupil_wasm / psf_last_strehl（瞳から直接の Strehl）
+
+int psf_wasm_capabilities() {
+    return PSF_CAP_INTERP_MODES | PSF_CAP_WINDOW | PSF_CAP_SESSION | PSF_CAP_TRIG_TIERS | PSF_CAP_ENERGY |
+           PSF_CAP_BATCH | PSF_CAP_F32 | PSF_CAP_STATS | PSF_CAP_MTF |
+           PSF_CAP_FOCUS_STACK | PSF_CAP_STREHL;
+}
+
+/**
+ * 計測カウンタ（PSF_STAT_*）を out に書き出す（capacity 個まで）
+ * @return カウンタ総数（PSF_STAT_FIELDS）
+ */
+int psf_get_stats(double* out, int capacity) {
+    if (out) {
+        const int n = capacity < PSF_STAT_FIELDS ? capacity : PSF_STAT_FIELDS;
+        for (int i = 0; i < n; i++) out[i] = psf_stats[i];
+    }
+    return PSF_STAT_FIELDS;
+}
+
+void psf_reset_stats() {
+    memset(psf_stats, 0, sizeof(psf_stats));
+}
+
+/**
+ * PSF計算のスレッド数設定（呼び出しスレッドを含む総数, <= 0 で論理コア数）
+ * 単一スレッド版では常に 1 を返す。
+ */
+int psf_set_thread_count(int threads) {
+    return coopt_pool_init(threads);
+}
+
+int psf_get_thread_count() {
+    return coopt_pool_thread_count();
+}
+
+/**
+ * 同じモジュール内の他の翻訳単位（zernike-fit.c）から共有プールを使うための入口
+ * （wasm-thread-pool.h のプールは翻訳単位ごとの static なので、直接 include すると別プールになる）
+ */
+void psf_parallel_for(int begin, int end, int min_chunk, void (*fn)(int, int, void*), void* ctx) {
+    coopt_parallel_for(begin, end, min_chunk, fn, ctx);
+}
+
 /**
  * PSF結果メモリ解放関数
  */
@@ -834,21 +3149,8 @@ void free_psf_result(double* psf) {
  * WebAssemblyモジュールクリーンアップ
  */
 void cleanup_wasm_module() {
-    if (twiddle_table) {
-        free(twiddle_table);
-        twiddle_table = NULL;
-        twiddle_table_size = 0;
-    }
-    
-    if (sin_table) {
-        free(sin_table);
-        sin_table = NULL;
-    }
-    
-    if (cos_table) {
-        free(cos_table);
-        cos_table = NULL;
-    trig_table_size = 0;
+    psf_fft_plan_cache_clear();
+    psf_fft_plan_f32_cache_clear();
+    free(psf_f32_work); psf_f32_work = NULL; psf_f32_work_capacity = 0;
     if (fft_temp_buffer) { free(fft_temp_buffer); fft_temp_buffer = NULL; fft_temp_capacity = 0; }
-    }
 }
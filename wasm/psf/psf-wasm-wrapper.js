@@ -11,6 +11,9 @@
  * 作成日: 2025/08/08
  */
 
+import { setZernikeWasmModule } from '../../evaluation/wavefront/zernike-fitting.js';
+import { setLmLinalgWasmModule } from '../../optimization/lm-linalg.js';
+
 /**
  * WASM版PSF計算クラス
  */
@@ -28,6 +31,67 @@ function getGlobalPsfWasmSingletonState() {
     return g[key];
 }
 
+/**
+ * pthreads 版（psf-wasm-mt.js）を使えるか
+ * SharedArrayBuffer は cross-origin isolated（COOP/COEP ヘッダ）なページでのみ有効。
+ * wasm/wasm-build-manifest.js に psfThreads: true が無ければ（-mt 版を入れていなければ）読みに行かない。
+ */
+function canUsePsfWasmThreads() {
+    try {
+        if (typeof globalThis === 'undefined') return false;
+        if (globalThis.__COOPT_DISABLE_WASM_THREADS) return false;
+        if (globalThis.__COOPT_WASM_BUILD_MANIFEST?.psfThreads !== true) return false;
+        if (typeof SharedArrayBuffer === 'undefined') return false;
+        return globalThis.crossOriginIsolated === true;
+    } catch (_) {
+        return false;
+    }
+}
+
+/**
+ * pthreads 版のファクトリ（PSFWasmMT）を psf-wasm.js と同じ場所から読み込む。失敗時は null。
+ */
+async function loadPsfWasmMTFactory() {
+    if (typeof PSFWasmMT === 'function') return PSFWasmMT;
+    if (typeof document === 'undefined') return null;
+    const scripts = Array.from(document.getElementsByTagName('script'));
+    const tag = scripts.find(s => /psf-wasm\.js(\?|$)/.test(s?.src || ''));
+    if (!tag?.src) return null;
+    const src = tag.src.replace('psf-wasm.js', 'psf-wasm-mt.js');
+    const ok = await new Promise(resolve => {
+        const el = document.createElement('script');
+        el.src = src;
+        el.async = true;
+        el.onload = () => resolve(true);
+        el.onerror = () => resolve(false);
+        document.head.appendChild(el);
+    });
+    return (ok && typeof PSFWasmMT === 'function') ? PSFWasmMT : null;
+}
+
+/**
+ * PSF WASM モジュール生成（cross-origin isolated なら pthreads 版 → 失敗時は単一スレッド版）
+ */
+async function createPsfWasmModule() {
+    if (canUsePsfWasmThreads()) {
+        try {
+            const factoryMT = await loadPsfWasmMTFactory();
+            if (factoryMT) {
+                const mod = await factoryMT();
+                if (mod) {
+                    if (typeof mod._psf_set_thread_count === 'function') {
+                        mod.__psfThreadCount = mod._psf_set_thread_count(0);
+                    }
+                    return mod;
+                }
+            }
+        } catch (e) {
+            console.warn('⚠️ [WASM] PSF pthreads build unavailable, using single-threaded build:', e?.message || e);
+        }
+    }
+    return PSFWasm();
+}
+
 export class PSFCalculatorWasm {
     constructor() {
         this.wasmModule = null;
@@ -43,6 +107,7 @@ export class PSFCalculatorWasm {
         this.calculateStrehl = null;
         this.calculateEncircledEnergy = null;
         this.freePSFResult = null;
+        this._session = null; // { ptr, gridSize }（psf_session_create）
         
         // パフォーマンス統計
         this.performanceStats = {
@@ -99,7 +164,7 @@ export class PSFCalculatorWasm {
             
             // WASMモジュールを初期化
             if (!singleton.modulePromise) {
-                singleton.modulePromise = PSFWasm();
+                singleton.modulePromise = createPsfWasmModule();
             }
             this.wasmModule = await singleton.modulePromise;
             singleton.module = this.wasmModule;
@@ -145,13 +210,15 @@ export class PSFCalculatorWasm {
             // 関数をラップ
             // console.log('🔍 [WASM] Wrapping functions...');
             try {
+                // 末尾の interp_mode は新しいビルドのみ（旧ビルドでは余分な引数として無視される）
                 this.calculatePSF = this.wasmModule.cwrap('calculate_psf_wasm', 'number', 
-                    ['number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number']);
+                    ['number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number']);
 
                 // Optional: grid入力版（古いwasmビルドでは存在しない）
                 try {
+                    // 末尾 4 引数（出力窓モード）は新しいビルドのみ。省略時は従来の全面 FFT。
                     this.calculatePSFGrid = this.wasmModule.cwrap('calculate_psf_grid_wasm', 'number',
-                        ['number', 'number', 'number', 'number', 'number']);
+                        ['number', 'number', 'number', 'number', 'number', 'number', 'number', 'number', 'number']);
                 } catch {
                     this.calculatePSFGrid = null;
                 }
@@ -180,6 +247,10 @@ export class PSFCalculatorWasm {
             }
 
             this.isReady = true;
+            // 同じモジュールに Zernike フィットカーネル（zernike-fit.c）があれば登録
+            setZernikeWasmModule(this.wasmModule);
+            // 最適化（LM）の正規方程式 / 減衰付き Cholesky（lm-linalg.c）も同様
+            setLmLinalgWasmModule(this.wasmModule);
             // console.log('✅ [WASM] PSF WebAssembly module ready');
             
         } catch (error) {
@@ -331,6 +402,30 @@ export class PSFCalculatorWasm {
         }
     }
 
+    /**
+     * Float32 配列をWASMメモリにコピー（float32 プレビュー版 PSF 用）
+     * @param {Array|Float64Array|Float32Array} data コピーするデータ（float に丸める）
+     * @returns {number} WASMメモリポインタ
+     */
+    copyFloat32ArrayToWasm(data) {
+        if (!this.wasmModule || !this.isReady) {
+            throw new Error('WASM module not ready');
+        }
+        try { this.ensureHeapViews(); } catch (_) {}
+
+        const byteLength = data.length * 4; // Float32 = 4 bytes
+        const ptr = this.wasmModule._malloc(byteLength);
+        if (!ptr) {
+            throw new Error(`Failed to allocate ${byteLength} bytes in WASM memory`);
+        }
+        if (!this.wasmModule.HEAPF32) {
+            this.wasmModule._free(ptr);
+            throw new Error('WASM memory access not available');
+        }
+        this.wasmModule.HEAPF32.set(data, ptr / 4);
+        return ptr;
+    }
+
     /**
      * WASMメモリから配列データをコピー（最適化版）
      * @param {number} ptr WASMメモリポインタ
@@ -519,6 +614,26 @@ export class PSFCalculatorWasm {
         }
     }
 
+    /**
+     * 直近の格子 / 光線 PSF と同じパスで集計した Strehl（psf_last_strehl, 機能ビット 1024）
+     * @returns {Object|null} { onAxis, peak, peakRow, peakCol, idealPeak }（未対応ビルド・未計算なら null）
+     */
+    _readLastStrehl() {
+        const mod = this.wasmModule;
+        if (!(this.getWasmCapabilities() & 1024) || typeof mod?._psf_last_strehl !== 'function') return null;
+        const FIELDS = 5;  // PSF_STREHL_FIELDS
+        const ptr = mod._malloc(FIELDS * 8);
+        if (!ptr) return null;
+        try {
+            mod._psf_last_strehl(ptr, FIELDS);
+            const v = this.copyArrayFromWasm(ptr, FIELDS);
+            if (!Number.isFinite(v[1])) return null;
+            return { onAxis: v[0], peak: v[1], peakRow: v[2], peakCol: v[3], idealPeak: v[4] };
+        } finally {
+            mod._free(ptr);
+        }
+    }
+
     /**
      * メインPSF計算関数（WASM版）
      * @param {Object} opdData OPD計算結果
@@ -574,6 +689,7 @@ export class PSFCalculatorWasm {
 
             // 詳細計測開始
             const breakdown = {};
+            this._applyPhaseAccuracy(options.phaseAccuracy);
 
             // gridData が与えられている場合は「補間なし」でWASM FFTを回す
             if (opdData && opdData.gridData) {
@@ -594,19 +710,40 @@ export class PSFCalculatorWasm {
                 const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
                 breakdown.dataPreparationTime = performance.now() - prepStartTime;
 
+                // options.precision === 'f32': ドラッグ中などの下書き用（float32 FFT, 相対誤差 ~1e-6）。
+                // 対応ビルド（機能ビット 64）でのみ使い、操作終了後は既定の double で計算し直すこと。
+                const useF32 = options.precision === 'f32' && this.isF32PSFAvailable();
+
                 // 2. メモリ転送
                 const memoryStartTime = performance.now();
-                const ptrGridOPD = this.copyArrayToWasm(opdFlat);
-                const ptrAmp = this.copyArrayToWasm(ampFlat);
-                const ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+                const session = useF32 ? null : this._acquireSession(samplingSize);
+                let ptrGridOPD = 0, ptrAmp = 0, ptrMask = 0;
+                if (session) {
+                    this._writeSessionGrid(session, opdFlat, ampFlat, maskFlat);
+                } else if (useF32) {
+                    ptrGridOPD = this.copyFloat32ArrayToWasm(opdFlat);
+                    ptrAmp = this.copyFloat32ArrayToWasm(ampFlat);
+                    ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+                } else {
+                    ptrGridOPD = this.copyArrayToWasm(opdFlat);
+                    ptrAmp = this.copyArrayToWasm(ampFlat);
+                    ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+                }
                 breakdown.memoryTransferTime = performance.now() - memoryStartTime;
 
                 // 3. WASM計算
                 const computationStartTime = performance.now();
-                const resultPtr = this.calculatePSFGrid(
-                    ptrGridOPD, ptrAmp, ptrMask,
-                    samplingSize, effectiveWavelength
-                );
+                const resultPtr = session
+                    ? this._computeSessionGrid(session, effectiveWavelength, 0, 0, 0, 0)
+                    : useF32
+                        ? this.wasmModule._calculate_psf_grid_f32_wasm(
+                            ptrGridOPD, ptrAmp, ptrMask,
+                            samplingSize, effectiveWavelength
+                        )
+                        : this.calculatePSFGrid(
+                            ptrGridOPD, ptrAmp, ptrMask,
+                            samplingSize, effectiveWavelength
+                        );
                 if (resultPtr === 0) {
                     throw new Error('WASM PSF calculation failed');
                 }
@@ -616,25 +753,26 @@ export class PSFCalculatorWasm {
                 const conversionStartTime = performance.now();
                 const psfIntensity = this.copyArrayFromWasm(resultPtr, samplingSize * samplingSize);
 
-                const strehlRatio = this._computeStrehlFromGridData(gridData, effectiveWavelength);
+                // Strehl: 回折限界瞳 (ΣA)² で正規化した最大画素（旧ビルド・f32 は Maréchal 近似）
+                const strehl = useF32 ? null : this._readLastStrehl();
+                const strehlRatio = strehl
+                    ? Math.max(0, Math.min(1, strehl.peak))
+                    : this._computeStrehlFromGridData(gridData, effectiveWavelength);
 
                 // エンサークルドエネルギー計算
                 const radii = new Float64Array([1, 2, 3, 4, 5, 10, 15, 20]);
-                const energies = new Float64Array(radii.length);
-                const ptrRadii = this.copyArrayToWasm(radii);
-                const ptrEnergies = this.copyArrayToWasm(energies);
-                this.calculateEncircledEnergy(resultPtr, samplingSize, ptrRadii, ptrEnergies, radii.length);
-                const encircledEnergy = this.copyArrayFromWasm(ptrEnergies, radii.length);
+                const energy = this._energyProfileFromPtr(resultPtr, samplingSize, radii);
+                const encircledEnergy = energy.encircled;
 
                 breakdown.dataConversionTime = performance.now() - conversionStartTime;
 
                 // メモリ解放（以降はJS側データのみを扱う）
-                this.wasmModule._free(ptrGridOPD);
-                this.wasmModule._free(ptrAmp);
-                this.wasmModule._free(ptrMask);
-                this.wasmModule._free(ptrRadii);
-                this.wasmModule._free(ptrEnergies);
-                this.freePSFResult(resultPtr);
+                if (!session) {
+                    this.wasmModule._free(ptrGridOPD);
+                    this.wasmModule._free(ptrAmp);
+                    this.wasmModule._free(ptrMask);
+                    this.freePSFResult(resultPtr);
+                }
 
                 const endTime = performance.now();
                 const executionTime = endTime - startTime;
@@ -656,11 +794,21 @@ export class PSFCalculatorWasm {
                 return {
                     psf: psf2D,
                     strehlRatio,
+                    strehlOnAxis: strehl ? strehl.onAxis : null,
+                    peakPosition: strehl ? { row: strehl.peakRow, col: strehl.peakCol } : null,
                     fwhm: { x: fwhmX, y: fwhmY },
                     encircledEnergy: {
                         radii: Array.from(radii),
                         values: Array.from(encircledEnergy)
                     },
+                    ensquaredEnergy: energy.ensquared ? {
+                        halfWidths: Array.from(radii),
+                        values: Array.from(energy.ensquared)
+                    } : null,
+                    lineSpread: energy.lineSpreadX ? {
+                        x: Array.from(energy.lineSpreadX),
+                        y: Array.from(energy.lineSpreadY)
+                    } : null,
                     wavelength: effectiveWavelength,
                     calculationTime: executionTime,
                     metadata: {
@@ -672,7 +820,8 @@ export class PSFCalculatorWasm {
                         wavelength: effectiveWavelength,
                         rayCount: 0,
                         executionTime,
-                        method: 'wasm-grid'
+                        method: 'wasm-grid',
+                        precision: useF32 ? 'f32' : 'f64'
                     }
                 };
             }
@@ -688,30 +837,57 @@ export class PSFCalculatorWasm {
             const prepStartTime = performance.now();
             const pupilCoords = validRays.map(ray => ({ x: ray.pupilX, y: ray.pupilY }));
             const bounds = this.calculateBounds(pupilCoords);
-
-            const rayX = new Float64Array(validRays.map(ray => ray.pupilX));
-            const rayY = new Float64Array(validRays.map(ray => ray.pupilY));
-            const rayOPD = new Float64Array(validRays.map(ray => ray.opd));
+            const rayCount = validRays.length;
             breakdown.dataPreparationTime = performance.now() - prepStartTime;
             
             // console.log(`🕒 [WASM] Data preparation: ${breakdown.dataPreparationTime.toFixed(2)}ms`);
 
             // 2. メモリ転送（計測）
+            // セッション対応ビルドでは事前確保バッファへ HEAPF64 で直接書き込む（malloc・中間配列なし）
             const memoryStartTime = performance.now();
-            const ptrX = this.copyArrayToWasm(rayX);
-            const ptrY = this.copyArrayToWasm(rayY);
-            const ptrOPD = this.copyArrayToWasm(rayOPD);
+            const session = this._acquireSession(samplingSize, rayCount);
+            let ptrX = 0, ptrY = 0, ptrOPD = 0;
+            if (session) {
+                const mod = this.wasmModule;
+                const heap = this._heapF64();
+                const ix = mod._psf_session_ray_x_ptr(session) >> 3;
+                const iy = mod._psf_session_ray_y_ptr(session) >> 3;
+                const io = mod._psf_session_ray_opd_ptr(session) >> 3;
+                for (let i = 0; i < rayCount; i++) {
+                    const ray = validRays[i];
+                    heap[ix + i] = ray.pupilX;
+                    heap[iy + i] = ray.pupilY;
+                    heap[io + i] = ray.opd;
+                }
+            } else {
+                ptrX = this.copyArrayToWasm(new Float64Array(validRays.map(ray => ray.pupilX)));
+                ptrY = this.copyArrayToWasm(new Float64Array(validRays.map(ray => ray.pupilY)));
+                ptrOPD = this.copyArrayToWasm(new Float64Array(validRays.map(ray => ray.opd)));
+            }
             breakdown.memoryTransferTime = performance.now() - memoryStartTime;
             
             // console.log(`🕒 [WASM] Memory transfer: ${breakdown.memoryTransferTime.toFixed(2)}ms`);
 
             // 3. WASM計算（計測）
             const computationStartTime = performance.now();
-            const resultPtr = this.calculatePSF(
-                ptrX, ptrY, ptrOPD, validRays.length,
-                samplingSize, effectiveWavelength,
-                bounds.minX, bounds.maxX, bounds.minY, bounds.maxY
-            );
+            // OPD格子補間: 'nearest'（既定）/ 'barycentric'（三角形上の線形補間, OPDマップが滑らか）
+            const interpMode = (options.opdInterpolation === 'barycentric') ? 1 : 0;
+            let resultPtr = 0;
+            if (session) {
+                const rc = this.wasmModule._psf_session_compute_rays(
+                    session, rayCount, effectiveWavelength,
+                    bounds.minX, bounds.maxX, bounds.minY, bounds.maxY,
+                    interpMode
+                );
+                resultPtr = (rc === 0) ? this.wasmModule._psf_session_output_ptr(session) : 0;
+            } else {
+                resultPtr = this.calculatePSF(
+                    ptrX, ptrY, ptrOPD, rayCount,
+                    samplingSize, effectiveWavelength,
+                    bounds.minX, bounds.maxX, bounds.minY, bounds.maxY,
+                    interpMode
+                );
+            }
 
             if (resultPtr === 0) {
                 throw new Error('WASM PSF calculation failed');
@@ -728,8 +904,10 @@ export class PSFCalculatorWasm {
 
             // Strehl比計算
             // NOTE: PSF強度をピーク正規化するとStrehlが常に1になり得るため、
-            // OPDのRMS（ピストン+チルト除去）からMaréchal近似で評価する。
-            const strehlRatio = (() => {
+            // 対応ビルドでは回折限界瞳 (ΣA)² で正規化した最大画素（psf_last_strehl）を使い、
+            // 旧ビルドでは OPDのRMS（ピストン+チルト除去）からMaréchal近似で評価する。
+            const lastStrehl = this._readLastStrehl();
+            const strehlRatio = lastStrehl ? Math.max(0, Math.min(1, lastStrehl.peak)) : (() => {
                 try {
                     const n = validRays.length;
                     if (!n) return 0;
@@ -811,24 +989,20 @@ export class PSFCalculatorWasm {
 
             // エンサークルドエネルギー計算
             const radii = new Float64Array([1, 2, 3, 4, 5, 10, 15, 20]);
-            const energies = new Float64Array(radii.length);
-            const ptrRadii = this.copyArrayToWasm(radii);
-            const ptrEnergies = this.copyArrayToWasm(energies);
-            
-            this.calculateEncircledEnergy(resultPtr, samplingSize, ptrRadii, ptrEnergies, radii.length);
-            const encircledEnergy = this.copyArrayFromWasm(ptrEnergies, radii.length);
+            const energy = this._energyProfileFromPtr(resultPtr, samplingSize, radii);
+            const encircledEnergy = energy.encircled;
             
             breakdown.dataConversionTime = performance.now() - conversionStartTime;
             
             // console.log(`🕒 [WASM] Data conversion: ${breakdown.dataConversionTime.toFixed(2)}ms`);
 
             // メモリ解放（以降はJS側データのみを扱う）
-            this.wasmModule._free(ptrX);
-            this.wasmModule._free(ptrY);
-            this.wasmModule._free(ptrOPD);
-            this.wasmModule._free(ptrRadii);
-            this.wasmModule._free(ptrEnergies);
-            this.freePSFResult(resultPtr);
+            if (!session) {
+                this.wasmModule._free(ptrX);
+                this.wasmModule._free(ptrY);
+                this.wasmModule._free(ptrOPD);
+                this.freePSFResult(resultPtr);
+            }
 
             const endTime = performance.now();
             const executionTime = endTime - startTime;
@@ -960,6 +1134,14 @@ export class PSFCalculatorWasm {
                     radii: Array.from(radii),
                     values: Array.from(encircledEnergy)
                 },
+                ensquaredEnergy: energy.ensquared ? {
+                    halfWidths: Array.from(radii),
+                    values: Array.from(energy.ensquared)
+                } : null,
+                lineSpread: energy.lineSpreadX ? {
+                    x: Array.from(energy.lineSpreadX),
+                    y: Array.from(energy.lineSpreadY)
+                } : null,
                 wavelength: effectiveWavelength,
                 calculationTime: executionTime, // 追加: ベンチマークで使用
                 metadata: {
@@ -987,6 +1169,648 @@ export class PSFCalculatorWasm {
         }
     }
 
+    /**
+     * 機能ビット（psf_wasm_capabilities）。旧ビルドでは 0。
+     * 1: calculate_psf_wasm の interp_mode / 2: calculate_psf_grid_wasm の出力窓モード
+     * 4: psf_session_* / 8: psf_set_trig_accuracy / 16: psf_energy_profile / 32: calculate_psf_batch_wasm
+     * 64: calculate_psf_grid_f32_wasm（float32 プレビュー版） / 128: psf_get_stats（performance-monitor.js の readPSFWasmStats）
+     * 256: calculate_mtf_batch_wasm（視野 × デフォーカスの MTF スライス） / 512: calculate_psf_focus_stack_wasm
+     * 1024: calculate_strehl_pupil_wasm / psf_last_strehl（回折限界瞳で正規化した Strehl）
+     */
+    getWasmCapabilities() {
+        const fn = this.wasmModule?._psf_wasm_capabilities;
+        return (typeof fn === 'function') ? (fn() | 0) : 0;
+    }
+
+    /**
+     * @returns {boolean} calculatePSFWasm の options.precision = 'f32'（格子入力のみ）が使えるか
+     */
+    isF32PSFAvailable() {
+        return !!(this.isReady && this.wasmModule?.HEAPF32 &&
+            typeof this.wasmModule._calculate_psf_grid_f32_wasm === 'function' &&
+            (this.getWasmCapabilities() & 64));
+    }
+
+    /**
+     * @returns {boolean} calculateMTFWasm（calculate_mtf_batch_wasm）が使えるか
+     */
+    isMTFAvailable() {
+        return !!(this.isReady && typeof this.wasmModule?._calculate_mtf_batch_wasm === 'function' &&
+            (this.getWasmCapabilities() & 256));
+    }
+
+    /**
+     * @returns {boolean} calculatePSFFocusStackWasm（calculate_psf_focus_stack_wasm）が使えるか
+     */
+    isFocusStackAvailable() {
+        return !!(this.isReady && typeof this.wasmModule?._calculate_psf_focus_stack_wasm === 'function' &&
+            (this.getWasmCapabilities() & 512));
+    }
+
+    /**
+     * @returns {boolean} computeStrehlFromPupil（calculate_strehl_pupil_wasm）が使えるか
+     */
+    isPupilStrehlAvailable() {
+        return !!(this.isReady && typeof this.wasmModule?._calculate_strehl_pupil_wasm === 'function' &&
+            (this.getWasmCapabilities() & 1024));
+    }
+
+    /**
+     * 瞳から直接 Strehl 比を求める（FFT なし。最適化のメリット関数など繰り返し評価向け, 同期）
+     * onAxis = |Σ A·e^{iφ}|² / (ΣA)²。refine: true なら真の PSF ピークをサブ画素で探索した値を peak に返す。
+     *
+     * @param {Object} gridData calculatePSFWasm と同形式
+     * @param {Object} options { wavelength, refine（既定 false）, removeTilt（既定 true） }
+     * @returns {Object} { onAxis, peak, peakRow, peakCol, idealPeak, iterations }
+     *   peakRow/peakCol は samplingSize 点 FFT（FFTshift 後）の画素座標。idealPeak は同じ格子の回折限界ピーク。
+     */
+    computeStrehlFromPupil(gridData, options = {}) {
+        if (!this.isPupilStrehlAvailable()) {
+            throw new Error('WASM build does not support pupil Strehl');
+        }
+        const mod = this.wasmModule;
+        const samplingSize = gridData?.opd?.length;
+        const wavelength = Number(options.wavelength);
+        if (!Number.isFinite(samplingSize) || !(wavelength > 0)) {
+            throw new Error('gridData and options.wavelength are required');
+        }
+        const removeTilt = (options.removeTilt !== undefined) ? !!options.removeTilt : true;
+        const FIELDS = 5;  // PSF_STREHL_FIELDS
+        const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
+        let ptrOPD = 0, ptrAmp = 0, ptrMask = 0, ptrOut = 0;
+        try {
+            ptrOPD = this.copyArrayToWasm(opdFlat);
+            ptrAmp = this.copyArrayToWasm(ampFlat);
+            ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+            ptrOut = mod._malloc(FIELDS * 8);
+            if (!ptrOut) {
+                throw new Error('WASM malloc failed');
+            }
+            const iterations = mod._calculate_strehl_pupil_wasm(
+                ptrOPD, ptrAmp, ptrMask, samplingSize, wavelength, options.refine ? 1 : 0, ptrOut
+            );
+            if (iterations < 0) {
+                throw new Error('WASM pupil Strehl calculation failed');
+            }
+            const v = this.copyArrayFromWasm(ptrOut, FIELDS);
+            return { onAxis: v[0], peak: v[1], peakRow: v[2], peakCol: v[3], idealPeak: v[4], iterations };
+        } finally {
+            if (ptrOPD) mod._free(ptrOPD);
+            if (ptrAmp) mod._free(ptrAmp);
+            if (ptrMask) mod._free(ptrMask);
+            if (ptrOut) mod._free(ptrOut);
+        }
+    }
+
+    /**
+     * 出力窓指定の PSF（格子入力）
+     * ゼロ詰めサイズ P = samplingSize × padFactor の PSF のうち、中心まわり windowSize² 画素だけを計算する。
+     * 例: 256² 瞳・padFactor 4・windowSize 64 → 1024² FFT 相当のピッチで 64² だけ評価。
+     *
+     * @param {Object} gridData { opd, amplitude, pupilMask, xCoords, yCoords }（calculatePSFWasm の gridData と同形式）
+     * @param {Object} options { windowSize, padFactor, centerRow, centerCol, wavelength, removeTilt }
+     *   centerRow/centerCol は P 点 FFT の画素単位（0 = 主光線）。非整数可。
+     * @returns {Promise<Object>} { psf: number[][], windowSize, padFactor, center, calculationTime }
+     */
+    async calculatePSFWindowWasm(gridData, options = {}) {
+        if (!this.isReady) {
+            await this.initializeWasm();
+        }
+        if (!this.isReady || typeof this.calculatePSFGrid !== 'function') {
+            throw new Error('WASM module not ready');
+        }
+        if (!(this.getWasmCapabilities() & 2)) {
+            throw new Error('WASM build does not support PSF window mode');
+        }
+
+        const samplingSize = gridData?.opd?.length;
+        const windowSize = Math.floor(Number(options.windowSize) || 64);
+        const padFactor = Number(options.padFactor) > 0 ? Number(options.padFactor) : 1;
+        const centerRow = Number(options.centerRow) || 0;
+        const centerCol = Number(options.centerCol) || 0;
+        const wavelength = Number(options.wavelength) > 0 ? Number(options.wavelength) : 0.5876;
+        if (!Number.isFinite(samplingSize) || samplingSize < 2 || windowSize < 1) {
+            throw new Error('Invalid gridData or windowSize');
+        }
+
+        const startTime = performance.now();
+        this._applyPhaseAccuracy(options.phaseAccuracy);
+        const removeTilt = (options.removeTilt !== undefined) ? !!options.removeTilt : true;
+        const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
+        const session = this._acquireSession(samplingSize);
+        let ptrGridOPD = 0, ptrAmp = 0, ptrMask = 0;
+        if (session) {
+            this._writeSessionGrid(session, opdFlat, ampFlat, maskFlat);
+        } else {
+            ptrGridOPD = this.copyArrayToWasm(opdFlat);
+            ptrAmp = this.copyArrayToWasm(ampFlat);
+            ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+        }
+        let resultPtr = 0;
+        try {
+            resultPtr = session
+                ? this._computeSessionGrid(session, wavelength, windowSize, padFactor, centerRow, centerCol)
+                : this.calculatePSFGrid(
+                    ptrGridOPD, ptrAmp, ptrMask, samplingSize, wavelength,
+                    windowSize, padFactor, centerRow, centerCol
+                );
+            if (resultPtr === 0) {
+                throw new Error('WASM PSF window calculation failed');
+            }
+            const flat = this.copyArrayFromWasm(resultPtr, windowSize * windowSize);
+            const psf = new Array(windowSize);
+            for (let i = 0; i < windowSize; i++) {
+                psf[i] = Array.from(flat.subarray(i * windowSize, (i + 1) * windowSize));
+            }
+            const calculationTime = performance.now() - startTime;
+            this.performanceStats.wasmCalls++;
+            this.performanceStats.totalWasmTime += calculationTime;
+            return { psf, windowSize, padFactor, center: { row: centerRow, col: centerCol }, wavelength, calculationTime };
+        } finally {
+            if (!session) {
+                this.wasmModule._free(ptrGridOPD);
+                this.wasmModule._free(ptrAmp);
+                this.wasmModule._free(ptrMask);
+                if (resultPtr) this.freePSFResult(resultPtr);
+            }
+        }
+    }
+
+    /**
+     * 事前確保セッション（psf_session_*）を取得する。samplingSize ごとに 1 つを使い回し、
+     * 呼び出しごとの malloc/free と中間コピーを省く。旧ビルドでは 0（従来の malloc 経路）。
+     * 返り値の出力ポインタはセッション所有のため freePSFResult してはならない。
+     * @param {number} gridSize 瞳格子サイズ
+     * @param {number} rayCount 光線入力の必要容量（格子入力では 0）
+     * @returns {number} セッションポインタ（0 = 非対応 / 失敗）
+     */
+    _acquireSession(gridSize, rayCount = 0) {
+        const mod = this.wasmModule;
+        if (!mod || typeof mod._psf_session_create !== 'function') return 0;
+        if (this._session && this._session.gridSize !== gridSize) {
+            mod._psf_session_destroy(this._session.ptr);
+            this._session = null;
+        }
+        if (!this._session) {
+            const ptr = mod._psf_session_create(gridSize, rayCount);
+            if (!ptr) return 0;
+            this._session = { ptr, gridSize };
+        } else if (rayCount > 0 && mod._psf_session_reserve_rays(this._session.ptr, rayCount) !== 0) {
+            return 0;
+        }
+        return this._session.ptr;
+    }
+
+    /**
+     * 位相 sincos の精度段階（psf_set_trig_accuracy）。旧ビルドでは何もしない。
+     * @param {string} [accuracy] 'accurate'（既定, ~1e-16）/ 'fast'（~3e-7）/ 'exact'（libm）
+     */
+    _applyPhaseAccuracy(accuracy) {
+        const fn = this.wasmModule?._psf_set_trig_accuracy;
+        if (typeof fn !== 'function') return;
+        const tier = (accuracy === 'exact') ? 0 : (accuracy === 'fast') ? 2 : 1;
+        fn(tier);
+    }
+
+    /**
+     * PSF（WASM メモリ上）の EE / ensquared / LSF を 1 回の走査で求める（psf_energy_profile）。
+     * 旧ビルドでは calculate_encircled_energy_wasm で EE のみ。
+     * @param {number} psfPtr PSF 強度（size² 要素の double）
+     * @param {number} size 一辺
+     * @param {Float64Array} radii 半径（画素単位, ensquared では半幅）
+     * @param {string|Object} [center] 'grid'（既定, size/2）/ 'centroid' / { row, col }
+     * @returns {Object} { encircled, ensquared?, lineSpreadX?, lineSpreadY?, center? }
+     */
+    _energyProfileFromPtr(psfPtr, size, radii, center = 'grid') {
+        const mod = this.wasmModule;
+        const n = radii.length;
+        const hasProfile = typeof mod._psf_energy_profile === 'function';
+        // radii と全出力を 1 回の malloc にまとめる
+        const count = hasProfile ? (3 * n + 2 * size + 2) : (2 * n);
+        const base = mod._malloc(count * 8);
+        if (!base) throw new Error('WASM malloc failed');
+        try {
+            const i0 = base >> 3;
+            this._heapF64().set(radii, i0);
+            if (!hasProfile) {
+                this.calculateEncircledEnergy(psfPtr, size, base, base + n * 8, n);
+                return { encircled: this._heapF64().slice(i0 + n, i0 + 2 * n) };
+            }
+            let mode = 0, row = 0, col = 0;
+            if (center === 'centroid') {
+                mode = 1;
+            } else if (center && typeof center === 'object') {
+                mode = 2;
+                row = Number(center.row) || 0;
+                col = Number(center.col) || 0;
+            }
+            const pEE = base + n * 8;
+            const pES = pEE + n * 8;
+            const pLX = pES + n * 8;
+            const pLY = pLX + size * 8;
+            const pC = pLY + size * 8;
+            const rc = mod._psf_energy_profile(psfPtr, size, base, n, mode, row, col, pEE, pES, pLX, pLY, pC);
+            if (rc !== 0) throw new Error('WASM energy profile failed');
+            // 内部 malloc でメモリが拡張されている可能性があるので取り直す
+            const heap = this._heapF64();
+            return {
+                encircled: heap.slice(pEE >> 3, (pEE >> 3) + n),
+                ensquared: heap.slice(pES >> 3, (pES >> 3) + n),
+                lineSpreadX: heap.slice(pLX >> 3, (pLX >> 3) + size),
+                lineSpreadY: heap.slice(pLY >> 3, (pLY >> 3) + size),
+                center: { row: heap[pC >> 3], col: heap[(pC >> 3) + 1] }
+            };
+        } finally {
+            mod._free(base);
+        }
+    }
+
+    /**
+     * 現在の HEAPF64（メモリ拡張でバッファが差し替わるため、確保を伴う呼び出しの後に取り直す）
+     */
+    _heapF64() {
+        this.ensureHeapViews();
+        return this.wasmModule.HEAPF64;
+    }
+
+    _writeSessionGrid(session, opdFlat, ampFlat, maskFlat) {
+        const mod = this.wasmModule;
+        const heap = this._heapF64();
+        const heap32 = (mod.HEAP32 && mod.HEAP32.buffer === heap.buffer) ? mod.HEAP32 : new Int32Array(heap.buffer);
+        heap.set(opdFlat, mod._psf_session_grid_opd_ptr(session) >> 3);
+        heap.set(ampFlat, mod._psf_session_amplitude_ptr(session) >> 3);
+        heap32.set(maskFlat, mod._psf_session_pupil_mask_ptr(session) >> 2);
+    }
+
+    _computeSessionGrid(session, wavelength, outSize, padFactor, centerRow, centerCol) {
+        const mod = this.wasmModule;
+        const rc = mod._psf_session_compute_grid(session, wavelength, outSize, padFactor, centerRow, centerCol);
+        return (rc === 0) ? mod._psf_session_output_ptr(session) : 0;
+    }
+
+    /**
+     * 多視野 × 多波長のバッチ PSF（calculate_psf_batch_wasm）
+     * 全波長を referenceWavelength・padFactor の像面ピッチにそろえて出力窓を評価し、
+     * 単色 PSF は全エネルギーで 1 に正規化する。
+     *
+     * @param {Array<Array<Object>>} gridStack gridStack[field][wavelength] = gridData（calculatePSFWasm と同形式, 同一 samplingSize）
+     * @param {Object} options { wavelengths, weights, referenceWavelength, windowSize, padFactor, mode, removeTilt }
+     *   mode: 'polychromatic'（既定, 視野ごとの重み付き和）/ 'stack'（単色 PSF をすべて返す）
+     * @returns {Promise<Object>} { psf: polychromatic ? psf[field] : psf[field][wavelength]（2D 配列）, ... }
+     */
+    async calculatePolychromaticPSFWasm(gridStack, options = {}) {
+        if (!this.isReady) {
+            await this.initializeWasm();
+        }
+        if (!this.isReady) {
+            throw new Error('WASM module not ready');
+        }
+        const mod = this.wasmModule;
+        if (typeof mod._calculate_psf_batch_wasm !== 'function') {
+            throw new Error('WASM build does not support batch PSF');
+        }
+
+        const wavelengths = (options.wavelengths || []).map(Number);
+        const fieldCount = Array.isArray(gridStack) ? gridStack.length : 0;
+        const wavelengthCount = wavelengths.length;
+        if (fieldCount === 0 || wavelengthCount === 0 || gridStack.some(f => !Array.isArray(f) || f.length !== wavelengthCount)) {
+            throw new Error('gridStack must be [field][wavelength] matching options.wavelengths');
+        }
+        const weights = (options.weights && options.weights.length === wavelengthCount)
+            ? options.weights.map(Number)
+            : new Array(wavelengthCount).fill(1);
+        const samplingSize = gridStack[0][0]?.opd?.length;
+        const windowSize = Math.floor(Number(options.windowSize) || 64);
+        const padFactor = Number(options.padFactor) > 0 ? Number(options.padFactor) : 1;
+        const referenceWavelength = Number(options.referenceWavelength) > 0 ? Number(options.referenceWavelength) : wavelengths[0];
+        const polychromatic = options.mode !== 'stack';
+        const removeTilt = (options.removeTilt !== undefined) ? !!options.removeTilt : true;
+
+        const startTime = performance.now();
+        const items = fieldCount * wavelengthCount;
+        const total = samplingSize * samplingSize;
+        const outTotal = windowSize * windowSize;
+        const outCount = (polychromatic ? fieldCount : items) * outTotal;
+
+        // 入力スタックは項目ごとに HEAP へ直接書き込む（連結した中間配列を作らない）
+        const ptrOPD = mod._malloc(items * total * 8);
+        const ptrAmp = mod._malloc(items * total * 8);
+        const ptrMask = mod._malloc(items * total * 4);
+        const ptrWl = mod._malloc(wavelengthCount * 16);
+        const ptrOut = mod._malloc(outCount * 8);
+        try {
+            if (!ptrOPD || !ptrAmp || !ptrMask || !ptrWl || !ptrOut) {
+                throw new Error('WASM malloc failed');
+            }
+            for (let f = 0; f < fieldCount; f++) {
+                for (let w = 0; w < wavelengthCount; w++) {
+                    const gridData = gridStack[f][w];
+                    if (gridData?.opd?.length !== samplingSize) {
+                        throw new Error(`gridStack[${f}][${w}] size mismatch`);
+                    }
+                    const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
+                    const heap = this._heapF64();
+                    const heap32 = (mod.HEAP32 && mod.HEAP32.buffer === heap.buffer) ? mod.HEAP32 : new Int32Array(heap.buffer);
+                    const item = f * wavelengthCount + w;
+                    heap.set(opdFlat, (ptrOPD >> 3) + item * total);
+                    heap.set(ampFlat, (ptrAmp >> 3) + item * total);
+                    heap32.set(maskFlat, (ptrMask >> 2) + item * total);
+                }
+            }
+            const heap = this._heapF64();
+            heap.set(wavelengths, ptrWl >> 3);
+            heap.set(weights, (ptrWl >> 3) + wavelengthCount);
+
+            const rc = mod._calculate_psf_batch_wasm(
+                ptrOPD, ptrAmp, ptrMask, samplingSize, fieldCount, wavelengthCount,
+                ptrWl, ptrWl + wavelengthCount * 8, referenceWavelength,
+                windowSize, padFactor, polychromatic ? 1 : 0, ptrOut
+            );
+            if (rc !== 0) {
+                throw new Error('WASM batch PSF calculation failed');
+            }
+
+            const flat = this.copyArrayFromWasm(ptrOut, outCount);
+            const to2D = (offset) => {
+                const psf = new Array(windowSize);
+                for (let i = 0; i < windowSize; i++) {
+                    psf[i] = Array.from(flat.subarray(offset + i * windowSize, offset + (i + 1) * windowSize));
+                }
+                return psf;
+            };
+            const psf = [];
+            for (let f = 0; f < fieldCount; f++) {
+                if (polychromatic) {
+                    psf.push(to2D(f * outTotal));
+                } else {
+                    const perWl = [];
+                    for (let w = 0; w < wavelengthCount; w++) perWl.push(to2D((f * wavelengthCount + w) * outTotal));
+                    psf.push(perWl);
+                }
+            }
+
+            const calculationTime = performance.now() - startTime;
+            this.performanceStats.wasmCalls++;
+            this.performanceStats.totalWasmTime += calculationTime;
+            return {
+                psf,
+                mode: polychromatic ? 'polychromatic' : 'stack',
+                wavelengths,
+                weights,
+                referenceWavelength,
+                windowSize,
+                padFactor,
+                calculationTime
+            };
+        } finally {
+            if (ptrOPD) mod._free(ptrOPD);
+            if (ptrAmp) mod._free(ptrAmp);
+            if (ptrMask) mod._free(ptrMask);
+            if (ptrWl) mod._free(ptrWl);
+            if (ptrOut) mod._free(ptrOut);
+        }
+    }
+
+    /**
+     * 回折 MTF のバッチ計算（calculate_mtf_batch_wasm）
+     * 視野ごとの瞳格子から PSF → OTF を求め、指定方位のスライスを返す（JS の PSF → SimpleFFT と同じ定義）。
+     * 視野 × デフォーカスの全項目を 1 回のネイティブ呼び出しで計算する（スルーフォーカス MTF 向け）。
+     *
+     * @param {Array<Object>} gridStack gridStack[field] = gridData（calculatePSFWasm と同形式, 同一 samplingSize）
+     * @param {Object} options
+     *   wavelength: 波長（OPD と同じ単位, μm）
+     *   frequencies: 周波数（OTF の bin 単位 = 1 / (samplingSize · 像面画素ピッチ), 非整数可）
+     *   angles: スライス方位（rad, 0 = +x, π/2 = +y。既定 [0, π/2]）
+     *   defocus: デフォーカス W020（OPD 単位, 既定 [0]）
+     *   pupilRadius: ρ = 1 の半径（画素, 既定はマスクの最大半径）
+     *   removeTilt: calculatePSFWasm と同じ（既定 true）
+     * @returns {Promise<Object>} { mtf: mtf[field][defocus][angle] = Float64Array(frequencies.length), ... }
+     */
+    async calculateMTFWasm(gridStack, options = {}) {
+        if (!this.isReady) {
+            await this.initializeWasm();
+        }
+        if (!this.isMTFAvailable()) {
+            throw new Error('WASM build does not support batch MTF');
+        }
+        const mod = this.wasmModule;
+        const fieldCount = Array.isArray(gridStack) ? gridStack.length : 0;
+        const samplingSize = gridStack?.[0]?.opd?.length;
+        if (fieldCount === 0 || !Number.isFinite(samplingSize)) {
+            throw new Error('gridStack must be a non-empty array of gridData');
+        }
+        const wavelength = Number(options.wavelength);
+        if (!(wavelength > 0)) {
+            throw new Error('options.wavelength is required');
+        }
+        const frequencies = Array.from(options.frequencies || [], Number);
+        const angles = Array.from(options.angles || [0, Math.PI / 2], Number);
+        const defocus = Array.from(options.defocus || [0], Number);
+        if (frequencies.length === 0 || angles.length === 0 || defocus.length === 0) {
+            throw new Error('frequencies / angles / defocus must not be empty');
+        }
+        const pupilRadius = Number(options.pupilRadius) > 0 ? Number(options.pupilRadius) : 0;
+        const removeTilt = (options.removeTilt !== undefined) ? !!options.removeTilt : true;
+
+        const startTime = performance.now();
+        const total = samplingSize * samplingSize;
+        const sliceCount = angles.length * frequencies.length;
+        const outCount = fieldCount * defocus.length * sliceCount;
+        const paramCount = defocus.length + angles.length + frequencies.length;
+
+        const ptrOPD = mod._malloc(fieldCount * total * 8);
+        const ptrAmp = mod._malloc(fieldCount * total * 8);
+        const ptrMask = mod._malloc(fieldCount * total * 4);
+        const ptrParams = mod._malloc(paramCount * 8);
+        const ptrOut = mod._malloc(outCount * 8);
+        try {
+            if (!ptrOPD || !ptrAmp || !ptrMask || !ptrParams || !ptrOut) {
+                throw new Error('WASM malloc failed');
+            }
+            for (let f = 0; f < fieldCount; f++) {
+                const gridData = gridStack[f];
+                if (gridData?.opd?.length !== samplingSize) {
+                    throw new Error(`gridStack[${f}] size mismatch`);
+                }
+                const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
+                const heap = this._heapF64();
+                const heap32 = (mod.HEAP32 && mod.HEAP32.buffer === heap.buffer) ? mod.HEAP32 : new Int32Array(heap.buffer);
+                heap.set(opdFlat, (ptrOPD >> 3) + f * total);
+                heap.set(ampFlat, (ptrAmp >> 3) + f * total);
+                heap32.set(maskFlat, (ptrMask >> 2) + f * total);
+            }
+            const heap = this._heapF64();
+            const pDefocus = ptrParams;
+            const pAngles = pDefocus + defocus.length * 8;
+            const pFreqs = pAngles + angles.length * 8;
+            heap.set(defocus, pDefocus >> 3);
+            heap.set(angles, pAngles >> 3);
+            heap.set(frequencies, pFreqs >> 3);
+
+            const rc = mod._calculate_mtf_batch_wasm(
+                ptrOPD, ptrAmp, ptrMask, samplingSize, fieldCount, wavelength,
+                pDefocus, defocus.length, pupilRadius,
+                pAngles, angles.length, pFreqs, frequencies.length, ptrOut
+            );
+            if (rc !== 0) {
+                throw new Error('WASM batch MTF calculation failed');
+            }
+
+            const flat = this.copyArrayFromWasm(ptrOut, outCount);
+            const mtf = [];
+            for (let f = 0; f < fieldCount; f++) {
+                const perDefocus = [];
+                for (let d = 0; d < defocus.length; d++) {
+                    const perAngle = [];
+                    for (let a = 0; a < angles.length; a++) {
+                        const offset = ((f * defocus.length + d) * angles.length + a) * frequencies.length;
+                        perAngle.push(Float64Array.from(flat.subarray(offset, offset + frequencies.length)));
+                    }
+                    perDefocus.push(perAngle);
+                }
+                mtf.push(perDefocus);
+            }
+
+            const calculationTime = performance.now() - startTime;
+            this.performanceStats.wasmCalls++;
+            this.performanceStats.totalWasmTime += calculationTime;
+            return { mtf, frequencies, angles, defocus, samplingSize, wavelength, calculationTime };
+        } finally {
+            if (ptrOPD) mod._free(ptrOPD);
+            if (ptrAmp) mod._free(ptrAmp);
+            if (ptrMask) mod._free(ptrMask);
+            if (ptrParams) mod._free(ptrParams);
+            if (ptrOut) mod._free(ptrOut);
+        }
+    }
+
+    /**
+     * スルーフォーカス PSF（calculate_psf_focus_stack_wasm）
+     * 瞳の準備（複素振幅・マスク・作業バッファ）を全スライスで共有し、デフォーカス位相はカーネル内で掛ける。
+     *
+     * @param {Object} gridData calculatePSFWasm と同形式
+     * @param {Object} options
+     *   wavelength: 波長（μm）
+     *   focus: デフォーカス量の配列（解釈は mode）
+     *   mode: 'w020'（既定, OPD += W·ρ²）/ 'z4'（OSA/ANSI 正規化 Z4 係数）/ 'distance'（像面移動 Δz, 要 na）
+     *   na: 像側 NA（mode = 'distance'）。focus と同じ単位（μm）の Δz から近軸 W020 = Δz·NA²/2
+     *   pupilRadius: ρ = 1 の半径（画素, 既定はマスクの最大半径）
+     *   output: 'metrics'（既定）/ 'stack' / 'both'
+     *   removeTilt: calculatePSFWasm と同じ（既定 true）
+     * @returns {Promise<Object>} { metrics: [{ focus, peak, strehl, ee80 }] | null, stack: Float64Array[] | null, ... }
+     *   stack は FFTshift 済み強度（samplingSize² の行優先, calculatePSFWasm と同じスケール）, ee80 は画素単位の半径
+     */
+    async calculatePSFFocusStackWasm(gridData, options = {}) {
+        if (!this.isReady) {
+            await this.initializeWasm();
+        }
+        if (!this.isFocusStackAvailable()) {
+            throw new Error('WASM build does not support focus stacks');
+        }
+        const mod = this.wasmModule;
+        const samplingSize = gridData?.opd?.length;
+        const focus = Array.from(options.focus || [], Number);
+        const wavelength = Number(options.wavelength);
+        if (!Number.isFinite(samplingSize) || focus.length === 0 || !(wavelength > 0)) {
+            throw new Error('gridData, options.focus and options.wavelength are required');
+        }
+        const modeIndex = { w020: 0, z4: 1, distance: 2 }[options.mode || 'w020'];
+        if (modeIndex === undefined) {
+            throw new Error(`Unknown focus mode: ${options.mode}`);
+        }
+        const na = Number(options.na) || 0;
+        const pupilRadius = Number(options.pupilRadius) > 0 ? Number(options.pupilRadius) : 0;
+        const output = options.output || 'metrics';
+        const wantStack = output === 'stack' || output === 'both';
+        const wantMetrics = output !== 'stack';
+        const removeTilt = (options.removeTilt !== undefined) ? !!options.removeTilt : true;
+
+        const startTime = performance.now();
+        const count = focus.length;
+        const total = samplingSize * samplingSize;
+        const METRICS = 3;  // PSF_FOCUS_METRICS
+        const { opdFlat, ampFlat, maskFlat } = this._detrendAndFlattenGridData(gridData, removeTilt);
+        let ptrOPD = 0, ptrAmp = 0, ptrMask = 0, ptrFocus = 0, ptrStack = 0, ptrMetrics = 0;
+        try {
+            ptrOPD = this.copyArrayToWasm(opdFlat);
+            ptrAmp = this.copyArrayToWasm(ampFlat);
+            ptrMask = this.copyInt32ArrayToWasm(maskFlat);
+            ptrFocus = this.copyArrayToWasm(Float64Array.from(focus));
+            if (wantStack) ptrStack = mod._malloc(count * total * 8);
+            if (wantMetrics) ptrMetrics = mod._malloc(count * METRICS * 8);
+            if ((wantStack && !ptrStack) || (wantMetrics && !ptrMetrics)) {
+                throw new Error('WASM malloc failed');
+            }
+            const rc = mod._calculate_psf_focus_stack_wasm(
+                ptrOPD, ptrAmp, ptrMask, samplingSize, wavelength, ptrFocus, count,
+                modeIndex, na, pupilRadius, ptrStack, ptrMetrics
+            );
+            if (rc !== 0) {
+                throw new Error('WASM focus stack calculation failed');
+            }
+
+            let metrics = null;
+            if (wantMetrics) {
+                const m = this.copyArrayFromWasm(ptrMetrics, count * METRICS);
+                metrics = focus.map((f, s) => ({
+                    focus: f,
+                    peak: m[s * METRICS],
+                    strehl: m[s * METRICS + 1],
+                    ee80: Number.isFinite(m[s * METRICS + 2]) ? m[s * METRICS + 2] : null
+                }));
+            }
+            let stack = null;
+            if (wantStack) {
+                const flat = this.copyArrayFromWasm(ptrStack, count * total);
+                stack = focus.map((_, s) => Float64Array.from(flat.subarray(s * total, (s + 1) * total)));
+            }
+
+            const calculationTime = performance.now() - startTime;
+            this.performanceStats.wasmCalls++;
+            this.performanceStats.totalWasmTime += calculationTime;
+            return { metrics, stack, focus, mode: options.mode || 'w020', samplingSize, wavelength, calculationTime };
+        } finally {
+            if (ptrOPD) mod._free(ptrOPD);
+            if (ptrAmp) mod._free(ptrAmp);
+            if (ptrMask) mod._free(ptrMask);
+            if (ptrFocus) mod._free(ptrFocus);
+            if (ptrStack) mod._free(ptrStack);
+            if (ptrMetrics) mod._free(ptrMetrics);
+        }
+    }
+
+    /**
+     * 既存 PSF の EE / ensquared / LSF（スライダー操作ごとの再評価向け, 半径数に依存しない 1 パス）
+     * @param {number[][]|Float64Array} psf PSF 強度（2D 配列または size² の行優先配列）
+     * @param {Object} options { radii（画素単位）, center: 'grid' | 'centroid' | { row, col } }
+     * @returns {Promise<Object>} { radii, encircled, ensquared, lineSpreadX, lineSpreadY, center }
+     */
+    async calculateEnergyProfileWasm(psf, options = {}) {
+        if (!this.isReady) {
+            await this.initializeWasm();
+        }
+        if (!this.isReady) {
+            throw new Error('WASM module not ready');
+        }
+        const size = Array.isArray(psf) ? psf.length : Math.round(Math.sqrt(psf?.length || 0));
+        if (!(size > 0)) {
+            throw new Error('Invalid PSF');
+        }
+        let flat = psf;
+        if (Array.isArray(psf)) {
+            flat = new Float64Array(size * size);
+            for (let i = 0; i < size; i++) flat.set(psf[i], i * size);
+        }
+        const radii = new Float64Array(options.radii || Array.from({ length: Math.floor(size / 2) }, (_, k) => k + 1));
+        const ptrPSF = this.copyArrayToWasm(flat);
+        try {
+            const energy = this._energyProfileFromPtr(ptrPSF, size, radii, options.center || 'grid');
+            return { radii: Array.from(radii), ...energy };
+        } finally {
+            this.wasmModule._free(ptrPSF);
+        }
+    }
+
     /**
      * 座標範囲計算
      * @param {Array} coords 座標配列
@@ -1116,8 +1940,11 @@ export class PSFCalculatorWasm {
      * リソースクリーンアップ
      */
     cleanup() {
-        // WASMモジュールのクリーンアップは通常不要
-        // 必要に応じてカスタムクリーンアップを追加
+        // WASMモジュールのクリーンアップは通常不要（セッションのみ解放）
+        if (this._session && this.wasmModule?._psf_session_destroy) {
+            this.wasmModule._psf_session_destroy(this._session.ptr);
+        }
+        this._session = null;
     }
 }
 
@@ -9,6 +9,47 @@ class ForceWASMSystem {
         this.isWASMReady = false;
         this.initializationPromise = null;
         this.performanceData = new Map();
+        this.wasmThreads = false;
+        this.wasmThreadCount = 1;
+    }
+
+    /**
+     * pthreads 版（ray-tracing-wasm-v3-mt.js）を使えるか
+     * SharedArrayBuffer は cross-origin isolated（COOP/COEP ヘッダ）なページでのみ有効。
+     * wasm/wasm-build-manifest.js に rayTracingThreads: true が無ければ（-mt 版を入れていなければ）読みに行かない。
+     */
+    _canUseWasmThreads() {
+        try {
+            if (typeof globalThis === 'undefined') return false;
+            if (globalThis.__COOPT_DISABLE_WASM_THREADS) return false;
+            if (globalThis.__COOPT_WASM_BUILD_MANIFEST?.rayTracingThreads !== true) return false;
+            if (typeof SharedArrayBuffer === 'undefined') return false;
+            return globalThis.crossOriginIsolated === true;
+        } catch (_) {
+            return false;
+        }
+    }
+
+    /**
+     * pthreads 版のファクトリ（RayTracingWASMMT）を読み込む。単一スレッド版の script タグと同じ
+     * ディレクトリ・キャッシュバスト引数で -mt.js を動的に追加する。失敗時は null。
+     */
+    async _loadThreadedFactory() {
+        if (typeof RayTracingWASMMT === 'function') return RayTracingWASMMT;
+        if (typeof document === 'undefined') return null;
+        const scripts = Array.from(document.getElementsByTagName('script'));
+        const tag = scripts.find(s => (s?.src || '').includes('ray-tracing-wasm-v3.js'));
+        if (!tag?.src) return null;
+        const src = tag.src.replace('ray-tracing-wasm-v3.js', 'ray-tracing-wasm-v3-mt.js');
+        const ok = await new Promise(resolve => {
+            const el = document.createElement('script');
+            el.src = src;
+            el.async = true;
+            el.onload = () => resolve(true);
+            el.onerror = () => resolve(false);
+            document.head.appendChild(el);
+        });
+        return (ok && typeof RayTracingWASMMT === 'function') ? RayTracingWASMMT : null;
     }
 
     _getRayTracingWasmCacheBustParam() {
@@ -71,13 +112,34 @@ class ForceWASMSystem {
                     return out;
                 }
             };
-            this.wasmModule = await RayTracingWASM(initOptions);
+            // cross-origin isolated なページでは pthreads 版を優先し、読み込み・初期化に失敗したら単一スレッド版へ
+            this.wasmModule = null;
+            this.wasmThreads = false;
+            if (this._canUseWasmThreads()) {
+                try {
+                    const factoryMT = await this._loadThreadedFactory();
+                    if (factoryMT) {
+                        this.wasmModule = await factoryMT(initOptions);
+                        this.wasmThreads = !!this.wasmModule;
+                    }
+                } catch (e) {
+                    console.warn('⚠️  WASM pthreads版の初期化に失敗 - 単一スレッド版を使用:', e?.message || e);
+                    this.wasmModule = null;
+                }
+            }
+            if (!this.wasmModule) {
+                this.wasmModule = await RayTracingWASM(initOptions);
+            }
+            // ワーカープールは事前生成済み（PTHREAD_POOL_SIZE）なのでここで確定させる
+            this.wasmThreadCount = (this.wasmThreads && typeof this.wasmModule?._rt10_set_thread_count === 'function')
+                ? this.wasmModule._rt10_set_thread_count(0)
+                : 1;
             
             if (!this.wasmModule) {
                 throw new Error('WASM V3モジュールの初期化に失敗');
             }
             
-            console.log('✅ WASM V3モジュール初期化成功');
+            console.log(`✅ WASM V3モジュール初期化成功${this.wasmThreads ? ' (pthreads)' : ''}`);
             
             // メモリ管理機能の確認
             if (typeof this.wasmModule._malloc === 'function' && typeof this.wasmModule._free === 'function') {
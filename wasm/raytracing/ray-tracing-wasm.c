@@ -4,12 +4,114 @@
  * 
  * コンパイル方法:
  * emcc ray-tracing-wasm.c -o ray-tracing-wasm-v3.js \
- *   -s EXPORTED_FUNCTIONS="['_aspheric_sag','_aspheric_sag10','_aspheric_sag_rt10','_batch_aspheric_sag','_batch_aspheric_sag10','_vector_dot','_vector_cross','_vector_normalize','_ray_sphere_intersect','_batch_vector_normalize','_malloc','_free']" \
- *   -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap']" -O3
+ *   -s EXPORTED_FUNCTIONS="['_aspheric_sag','_aspheric_sag10','_aspheric_sag_rt10','_batch_aspheric_sag','_batch_aspheric_sag10','_vector_dot','_vector_cross','_vector_normalize','_ray_sphere_intersect','_batch_vector_normalize','_intersect_aspheric_rt10','_trace_system_rt10','_trace_system_rt10_derivs','_rt10_deriv_max_params','_trace_system_rt10_resume','_rt10_state_stride','_rt10_surface_stride','_rt10_max_wavelengths','_rt10_bundle_fields','_bundle_init_rt10','_bundle_sphere_intersect','_bundle_intersect_aspheric_rt10','_bundle_surface_normal_rt10','_bundle_refract','_trace_bundle_rt10','_bundle_init_rt10_f32','_trace_bundle_rt10_f32','_rt10_f32_lanes','_rt10_get_stats','_rt10_reset_stats','_rt10_stats_enable','_rt10_set_thread_count','_rt10_get_thread_count','_rt10_glass_stride','_rt10_glass_load','_rt10_glass_loaded_count','_rt10_glass_index','_rt10_resolve_indices','_trace_opd_grid_rt10','_trace_opd_points_rt10','_rt10_opd_params','_rt10_opd_info_fields','_trace_spot_rt10','_rt10_spot_params','_rt10_spot_state_fields','_rt10_spot_stats_fields','_rt10_spot_point_fields','_malloc','_free']" \
+ *   -s EXPORTED_RUNTIME_METHODS="['ccall','cwrap','HEAPF64','HEAPF32','HEAP32']" -O3 -msimd128
+ * pthreads 版（ray-tracing-wasm-v3-mt.js）は上記に -pthread -s EXPORT_NAME=RayTracingWASMMT を追加
+ * （scripts/build-ray-tracing-wasm.sh 参照）
  */
 
 #include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#ifdef __EMSCRIPTEN__
 #include <emscripten.h>
+#else
+// ネイティブビルド（wasm/bench のホスト版ベンチ・検証用）
+#define EMSCRIPTEN_KEEPALIVE
+#endif
+
+// -pthread ビルド（ray-tracing-wasm-v3-mt.js）でのみ光線チャンクをワーカーに分配する
+#include "../wasm-thread-pool.h"
+
+/*
+ * 計測カウンタ（rt10_get_stats で読み出し, rt10_reset_stats で 0 に戻す）
+ *
+ * - 一括追跡の入口ごとに 呼び出し回数 / 光線数 / 累積 ns / 直近 ns を常に数える（1 呼び出し 2 回の時計読み）。
+ * - Newton の反復回数ヒストグラムと未収束数は光線ごとのカウンタなので、rt10_stats_enable(1) のときだけ数える。
+ *   ワーカーから同時に加算されるため relaxed atomic を使う（単一スレッド版では通常の加算になる）。
+ * レイアウトは RT10_STAT_*（performance/performance-monitor.js の RT10_STATS_LAYOUT と同期させること）。
+ */
+#define RT10_STAT_ENTRY_SYSTEM      0   // trace_system_rt10
+#define RT10_STAT_ENTRY_DERIVS      1   // trace_system_rt10_derivs
+#define RT10_STAT_ENTRY_RESUME      2   // trace_system_rt10_resume
+#define RT10_STAT_ENTRY_BUNDLE      3   // trace_bundle_rt10
+#define RT10_STAT_ENTRY_BUNDLE_F32  4   // trace_bundle_rt10_f32
+#define RT10_STAT_ENTRIES           5
+#define RT10_STAT_ENTRY_FIELDS      4   // calls, rays, total_ns, last_ns
+#define RT10_STAT_NEWTON_BINS       16  // 収束までの反復回数 0..14, 15 = 15 回以上
+#define RT10_STAT_NEWTON_HIST       (RT10_STAT_ENTRIES * RT10_STAT_ENTRY_FIELDS)
+#define RT10_STAT_NEWTON_MISS       (RT10_STAT_NEWTON_HIST + RT10_STAT_NEWTON_BINS) // 全初期値で未収束（スカラー版）
+#define RT10_STAT_FALLBACK_CALLS    (RT10_STAT_NEWTON_MISS + 1)  // JS 互換フォールバック探索の回数
+#define RT10_STAT_FALLBACK_MISS     (RT10_STAT_NEWTON_MISS + 2)  // フォールバックでも交点なし
+#define RT10_STAT_FIELDS            (RT10_STAT_NEWTON_MISS + 3)
+
+static unsigned long long rt10_stats[RT10_STAT_FIELDS];
+static int rt10_stats_on = 0;
+
+static inline double __rt10_now_ms(void) {
+#ifdef __EMSCRIPTEN__
+    return emscripten_get_now();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+static inline void __rt10_stat_add(int field, unsigned long long v) {
+    __atomic_fetch_add(&rt10_stats[field], v, __ATOMIC_RELAXED);
+}
+
+static inline void __rt10_stat_newton(int iterations, int lanes) {
+    if (!rt10_stats_on || lanes <= 0) return;
+    const int bin = iterations < RT10_STAT_NEWTON_BINS - 1 ? iterations : RT10_STAT_NEWTON_BINS - 1;
+    __rt10_stat_add(RT10_STAT_NEWTON_HIST + bin, (unsigned long long)lanes);
+}
+
+static inline void __rt10_stat_count(int field) {
+    if (rt10_stats_on) __rt10_stat_add(field, 1ull);
+}
+
+// 入口の実行時間を記録する（呼び出しスレッドのみ）
+static void __rt10_stat_entry(int entry, int rays, double start_ms) {
+    double ns = (__rt10_now_ms() - start_ms) * 1e6;
+    if (!(ns > 0.0)) ns = 0.0;
+    unsigned long long* e = rt10_stats + entry * RT10_STAT_ENTRY_FIELDS;
+    e[0] += 1ull;
+    e[1] += (unsigned long long)(rays > 0 ? rays : 0);
+    e[2] += (unsigned long long)ns;
+    e[3] = (unsigned long long)ns;
+}
+
+/**
+ * 計測カウンタを out に double で書き出す（capacity 個まで）
+ * @return カウンタ総数（RT10_STAT_FIELDS）
+ */
+EMSCRIPTEN_KEEPALIVE
+int rt10_get_stats(double* out, int capacity) {
+    if (out) {
+        const int n = capacity < RT10_STAT_FIELDS ? capacity : RT10_STAT_FIELDS;
+        for (int i = 0; i < n; i++) out[i] = (double)__atomic_load_n(&rt10_stats[i], __ATOMIC_RELAXED);
+    }
+    return RT10_STAT_FIELDS;
+}
+
+EMSCRIPTEN_KEEPALIVE
+void rt10_reset_stats(void) {
+    for (int i = 0; i < RT10_STAT_FIELDS; i++) __atomic_store_n(&rt10_stats[i], 0ull, __ATOMIC_RELAXED);
+}
+
+/**
+ * 光線ごとのカウンタ（Newton ヒストグラム等）の有効化（既定は無効）
+ * @return 変更前の設定
+ */
+EMSCRIPTEN_KEEPALIVE
+int rt10_stats_enable(int on) {
+    const int prev = rt10_stats_on;
+    rt10_stats_on = on ? 1 : 0;
+    return prev;
+}
 
 static inline double __rt10_asphere_poly(double r, double r2,
                                         double coef1, double coef2, double coef3, double coef4, double coef5,
@@ -310,24 +412,70 @@ double aspheric_sag_rt10(double r, double radius, double conic,
     return isfinite(out) ? out : 0.0;
 }
 
+/*
+ * 面形状の分類（交点計算の振り分け用）
+ * 球面・コーニックは閉形式の二次曲面解、多項式非球面は二次曲面解を初期値にした Newton。
+ */
+#define RT10_SHAPE_PLANE        0
+#define RT10_SHAPE_SPHERE       1
+#define RT10_SHAPE_CONIC        2
+#define RT10_SHAPE_ASPHERE      3   // even 多項式
+#define RT10_SHAPE_ODD_ASPHERE  4
+
+static inline int __rt10_shape_of(double radius, double conic, const double* coefs, int modeOdd) {
+    if (!isfinite(radius) || radius == 0.0) return RT10_SHAPE_PLANE;
+    for (int i = 0; i < 10; i++) {
+        if (coefs[i] != 0.0) return modeOdd ? RT10_SHAPE_ODD_ASPHERE : RT10_SHAPE_ASPHERE;
+    }
+    return (conic != 0.0) ? RT10_SHAPE_CONIC : RT10_SHAPE_SPHERE;
+}
+
 /**
- * ray-tracing.js互換: 非球面サーフェスとの交点探索（Newton法）
+ * ベース二次曲面（頂点 z=0, 曲率 c = 1/R, K = 1 + conic）との交点（閉形式）
  *
- * - ローカル座標系で面は z=0 に配置されている前提。
- * - 返り値は ray parameter t（pt = ray.pos + ray.dir * t）。失敗は -1。
+ * c(x² + y² + K z²) - 2z = 0 に光線を代入すると A t² + 2B t + C = 0。
+ * 桁落ちを避けるため q = -(B + sgn(B)·sqrt(B² - AC)) として t = C/q, q/A を求め、
+ * sag 関数の枝（頂点側: K c z <= 1）に乗る正の小さい方を返す。
+ * @return t（解なし・semidia 外は -1）
  */
-EMSCRIPTEN_KEEPALIVE
-double intersect_aspheric_rt10(
-    double ox, double oy, double oz,
-    double dx, double dy, double dz,
-    double semidia,
-    double radius, double conic,
-    double coef1, double coef2, double coef3, double coef4, double coef5,
-    double coef6, double coef7, double coef8, double coef9, double coef10,
-    int modeOdd,
-    int maxIter,
-    double tol
-) {
+static double __rt10_intersect_quadric(double ox, double oy, double oz,
+                                       double dx, double dy, double dz,
+                                       double semidia, double radius, double conic) {
+    const double c = 1.0 / radius;
+    const double K = 1.0 + conic;
+    const double A = c * (dx * dx + dy * dy + K * dz * dz);
+    const double B = c * (ox * dx + oy * dy + K * oz * dz) - dz;
+    const double C = c * (ox * ox + oy * oy + K * oz * oz) - 2.0 * oz;
+    const double D = B * B - A * C;
+    if (!(D >= 0.0)) return -1.0;
+    const double sD = sqrt(D);
+    const double q = -(B + (B < 0.0 ? -sD : sD));
+    const double roots[2] = { C / q, q / A };
+
+    double best = -1.0;
+    for (int i = 0; i < 2; i++) {
+        const double t = roots[i];
+        if (!(t > 0.0) || !isfinite(t)) continue;
+        if (best > 0.0 && t >= best) continue;
+        const double x = ox + dx * t, y = oy + dy * t, z = oz + dz * t;
+        if (K * c * z > 1.0 + 1e-9) continue;  // 反対側の枝（球の奥側・双曲面のもう一方）
+        if (isfinite(semidia) && semidia > 0.0 && sqrt(x * x + y * y) > semidia) continue;
+        best = t;
+    }
+    return best;
+}
+
+/**
+ * 交点探索の本体（intersect_aspheric_rt10 / trace_system_rt10 共通）
+ * 係数は coefs[10] 配列で受け取り、スカラー引数のマーシャリングを避ける。
+ * shape は __rt10_shape_of の結果（面ごとに 1 回だけ分類して渡す）。
+ */
+static double __rt10_intersect_shaped(int shape,
+                                      double ox, double oy, double oz,
+                                      double dx, double dy, double dz,
+                                      double semidia, double radius, double conic,
+                                      const double* coefs, int modeOdd,
+                                      int maxIter, double tol) {
     if (!isfinite(dx) || !isfinite(dy) || !isfinite(dz)) return -1.0;
     if (!isfinite(ox) || !isfinite(oy) || !isfinite(oz)) return -1.0;
     if (!(maxIter > 0)) maxIter = 20;
@@ -340,9 +488,20 @@ double intersect_aspheric_rt10(
     const double EPS_R = 1e-14;
     const double EPS_DFDT = 1e-14;
 
-    double guesses[10];
+    if (shape == RT10_SHAPE_SPHERE || shape == RT10_SHAPE_CONIC) {
+        return __rt10_intersect_quadric(ox, oy, oz, dx, dy, dz, semidia, radius, conic);
+    }
+
+    double guesses[11];
     int gCount = 0;
 
+    // 0) Base quadric root (exact when the polynomial term is small near the hit)
+    if (shape == RT10_SHAPE_ASPHERE || shape == RT10_SHAPE_ODD_ASPHERE) {
+        double tq = __rt10_intersect_quadric(ox, oy, oz, dx, dy, dz, INFINITY, radius, conic);
+        if (tq > EPS_T) guesses[gCount++] = tq;
+    }
+    const int g0 = gCount;
+
     // 1) Sphere approximation candidates (both roots, nearest first)
     if (isfinite(radius) && radius != 0.0) {
         double cz = radius;
@@ -359,9 +518,9 @@ double intersect_aspheric_rt10(
                 if (t1 > EPS_T) guesses[gCount++] = t1;
                 if (t2 > EPS_T) guesses[gCount++] = t2;
                 // sort two items if needed
-                if (gCount >= 2) {
-                    if (guesses[0] > guesses[1]) {
-                        double tmp = guesses[0]; guesses[0] = guesses[1]; guesses[1] = tmp;
+                if (gCount - g0 >= 2) {
+                    if (guesses[g0] > guesses[g0 + 1]) {
+                        double tmp = guesses[g0]; guesses[g0] = guesses[g0 + 1]; guesses[g0 + 1] = tmp;
                     }
                 }
             }
@@ -412,14 +571,15 @@ double intersect_aspheric_rt10(
             double r = sqrt(r2);
 
             double sag = aspheric_sag_rt10(r, radius, conic,
-                                           coef1, coef2, coef3, coef4, coef5,
-                                           coef6, coef7, coef8, coef9, coef10,
+                                           coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                           coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
                                            modeOdd);
             double F = z - sag;
             if (fabs(F) < tol) {
                 if (isfinite(semidia) && semidia > 0.0) {
                     if (r > semidia) break; // try next initial guess
                 }
+                __rt10_stat_newton(i, 1);
                 return (t > 0.0) ? t : -1.0;
             }
 
@@ -441,8 +601,8 @@ double intersect_aspheric_rt10(
             }
 
             double dzdr_poly = __rt10_asphere_dzdr(r, r2,
-                                                   coef1, coef2, coef3, coef4, coef5,
-                                                   coef6, coef7, coef8, coef9, coef10,
+                                                   coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                                   coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
                                                    modeOdd);
             double dzdr = dzdr_base + dzdr_poly;
 
@@ -460,5 +620,3007 @@ double intersect_aspheric_rt10(
         }
     }
 
+    __rt10_stat_count(RT10_STAT_NEWTON_MISS);
     return -1.0;
 }
+
+static double __rt10_intersect(double ox, double oy, double oz,
+                               double dx, double dy, double dz,
+                               double semidia, double radius, double conic,
+                               const double* coefs, int modeOdd,
+                               int maxIter, double tol) {
+    return __rt10_intersect_shaped(__rt10_shape_of(radius, conic, coefs, modeOdd),
+                                   ox, oy, oz, dx, dy, dz, semidia, radius, conic,
+                                   coefs, modeOdd, maxIter, tol);
+}
+
+/**
+ * ray-tracing.js互換: 非球面サーフェスとの交点探索（Newton法）
+ *
+ * - ローカル座標系で面は z=0 に配置されている前提。
+ * - 返り値は ray parameter t（pt = ray.pos + ray.dir * t）。失敗は -1。
+ */
+EMSCRIPTEN_KEEPALIVE
+double intersect_aspheric_rt10(
+    double ox, double oy, double oz,
+    double dx, double dy, double dz,
+    double semidia,
+    double radius, double conic,
+    double coef1, double coef2, double coef3, double coef4, double coef5,
+    double coef6, double coef7, double coef8, double coef9, double coef10,
+    int modeOdd,
+    int maxIter,
+    double tol
+) {
+    const double coefs[10] = {coef1, coef2, coef3, coef4, coef5, coef6, coef7, coef8, coef9, coef10};
+    return __rt10_intersect(ox, oy, oz, dx, dy, dz, semidia, radius, conic, coefs, modeOdd, maxIter, tol);
+}
+
+/*
+ * =============================================================================
+ * システム一括光線追跡（trace_system_rt10）
+ * =============================================================================
+ *
+ * JS側で面テーブルを一度だけパックし、光線バッチ全体を1回の呼び出しで
+ * 交点 → 法線 → 屈折/反射 → 次面への座標変換 まで WASM 内で処理する。
+ * 処理内容は ray-tracing.js の __traceRay_impl と一致させること。
+ *
+ * 面テーブル: 1面あたり RT10_SURF_STRIDE 個の double（下記オフセット）。
+ * レイアウトは raytracing/core/ray-batch-trace.js の RT10_LAYOUT と同期させる。
+ */
+#define RT10_MAX_WAVELENGTHS 8
+
+#define RT10_SURF_KIND       0   // RT10_KIND_*
+#define RT10_SURF_RADIUS     1   // 0 / 非有限 = 平面
+#define RT10_SURF_CONIC      2
+#define RT10_SURF_COEF       3   // coef1..coef10 (3..12)
+#define RT10_SURF_MODE_ODD   13  // 0: even, 1: odd
+#define RT10_SURF_SEMIDIA    14  // 交点探索の初期値ヒント（<=0 / 非有限 = なし）
+#define RT10_SURF_AP_KIND    15  // RT10_AP_*
+#define RT10_SURF_AP_A       16  // 円形: 半径制限 / 矩形: 半幅
+#define RT10_SURF_AP_B       17  // 矩形: 半高さ
+#define RT10_SURF_THICKNESS  18
+#define RT10_SURF_ORIGIN     19  // O(s) x,y,z (19..21)
+#define RT10_SURF_ROT        22  // R(s) 3x3 row-major, ローカル→グローバル (22..30)
+#define RT10_SURF_INDEX      31  // 面通過後の屈折率（波長スロット別, 31..38）
+#define RT10_SURF_GLASS      39  // 面通過後の媒質のガラス ID + 1（0 = INDEX をそのまま使う, rt10_resolve_indices 用）
+#define RT10_SURF_STRIDE     40
+
+#define RT10_KIND_REFRACT    0
+#define RT10_KIND_MIRROR     1
+#define RT10_KIND_COORD_BREAK 2  // 座標変換のみ（INDEX>0 なら媒質を更新）
+#define RT10_KIND_OBJECT     3   // 交点計算なし、thickness 分だけ前進
+
+#define RT10_AP_NONE         0
+#define RT10_AP_CIRCLE       1
+#define RT10_AP_RECT         2
+
+// 入力光線: px,py,pz,dx,dy,dz / 出力光線: px,py,pz,dx,dy,dz,opl
+#define RT10_RAY_IN_STRIDE   6
+#define RT10_RAY_OUT_STRIDE  7
+
+// trace_system_rt10 flags
+#define RT10_TRACE_HIT_ONLY  1   // stop_surface の交点で停止（屈折・前進なし）
+
+// 光線ステータス（ray-tracing.js の戻り値との対応）
+#define RT10_STATUS_OK       0   // 全面を通過（rayPath）
+#define RT10_STATUS_MISS     1   // 交点なし → JS の break（途中までの rayPath）
+#define RT10_STATUS_BLOCKED  2   // 開口で遮断 → JS の return null
+#define RT10_STATUS_TIR      3   // 全反射 → JS の break
+#define RT10_STATUS_INVALID  4   // 入力不正
+
+EMSCRIPTEN_KEEPALIVE int rt10_surface_stride(void) { return RT10_SURF_STRIDE; }
+EMSCRIPTEN_KEEPALIVE int rt10_max_wavelengths(void) { return RT10_MAX_WAVELENGTHS; }
+
+/*
+ * ガラステーブル（分散式の係数, ガラス ID = 行番号）
+ *
+ * JS 側（ray-batch-trace.js の packGlassTableForWasm）がカタログを 1 度だけパックして
+ * rt10_glass_load で渡す。以後は面テーブルの RT10_SURF_GLASS に ID + 1 を書いておけば、
+ * rt10_resolve_indices がバッチの全波長の屈折率スロットを埋める（光線ごとの JS 呼び出しなし）。
+ * 式と範囲チェックは data/glass.js の calculateRefractiveIndex と同じ（同じ演算順で同じ値になる）。
+ */
+#define RT10_GLASS_FORMULA   0   // RT10_GLASS_*
+#define RT10_GLASS_ND        1   // 定数（RT10_GLASS_CONSTANT）の屈折率
+#define RT10_GLASS_COEF      2   // Sellmeier A1, A2, A3, B1, B2, B3 (2..7)
+#define RT10_GLASS_STRIDE    8
+
+#define RT10_GLASS_CONSTANT  0   // 係数なし → nd（ray-paraxial.js の getRefractiveIndex と同じ）
+#define RT10_GLASS_SELLMEIER 1   // n² = 1 + Σ A_i λ² / (λ² - B_i)
+
+static double* rt10_glass_table = NULL;
+static int rt10_glass_count = 0;
+
+EMSCRIPTEN_KEEPALIVE int rt10_glass_stride(void) { return RT10_GLASS_STRIDE; }
+
+/**
+ * ガラステーブルを読み込む（モジュール内にコピーするので呼び出し後は解放してよい）
+ * @param table glass_count × RT10_GLASS_STRIDE
+ * @return 読み込んだガラス数 / -1: 失敗（以前のテーブルは破棄される）
+ */
+EMSCRIPTEN_KEEPALIVE
+int rt10_glass_load(const double* table, int glass_count) {
+    free(rt10_glass_table);
+    rt10_glass_table = NULL;
+    rt10_glass_count = 0;
+    if (!table || glass_count <= 0) return glass_count == 0 ? 0 : -1;
+    const size_t n = (size_t)glass_count * RT10_GLASS_STRIDE;
+    rt10_glass_table = (double*)malloc(n * sizeof(double));
+    if (!rt10_glass_table) return -1;
+    for (size_t i = 0; i < n; i++) rt10_glass_table[i] = table[i];
+    rt10_glass_count = glass_count;
+    return glass_count;
+}
+
+EMSCRIPTEN_KEEPALIVE int rt10_glass_loaded_count(void) { return rt10_glass_count; }
+
+static double __rt10_glass_eval(const double* G, double wavelength) {
+    if ((int)G[RT10_GLASS_FORMULA] != RT10_GLASS_SELLMEIER) return G[RT10_GLASS_ND];
+    if (!(wavelength > 0.0)) return 1.0;
+    const double* A = G + RT10_GLASS_COEF;
+    const double l2 = wavelength * wavelength;
+    const double n2 = 1 +
+        (A[0] * l2) / (l2 - A[3]) +
+        (A[1] * l2) / (l2 - A[4]) +
+        (A[2] * l2) / (l2 - A[5]);
+    const double n = sqrt(n2);
+    // calculateRefractiveIndex と同じ範囲チェック（NaN も 1.0）
+    if (!isfinite(n) || n < 1.0 || n > 3.0) return 1.0;
+    return n;
+}
+
+/**
+ * @param glass_id ガラス ID（0 始まり）
+ * @return 屈折率 / 範囲外の ID は NaN
+ */
+EMSCRIPTEN_KEEPALIVE
+double rt10_glass_index(int glass_id, double wavelength) {
+    if (glass_id < 0 || glass_id >= rt10_glass_count) return NAN;
+    return __rt10_glass_eval(rt10_glass_table + (size_t)glass_id * RT10_GLASS_STRIDE, wavelength);
+}
+
+/**
+ * 面テーブルの屈折率スロットをガラステーブルから埋める（RT10_SURF_GLASS > 0 の面のみ, その場で書き換え）
+ * @param wavelengths スロット 0..wavelength_count-1 の波長（µm）
+ * @return 書き換えた面の数 / -1: 不正な引数または未読み込みのガラス ID（テーブルは途中まで書き換わる）
+ */
+EMSCRIPTEN_KEEPALIVE
+int rt10_resolve_indices(double* surfaces, int surface_count, const double* wavelengths, int wavelength_count) {
+    if (!surfaces || surface_count < 0 || !wavelengths ||
+        wavelength_count <= 0 || wavelength_count > RT10_MAX_WAVELENGTHS) return -1;
+    int resolved = 0;
+    for (int s = 0; s < surface_count; s++) {
+        double* S = surfaces + (size_t)s * RT10_SURF_STRIDE;
+        const int id = (int)S[RT10_SURF_GLASS] - 1;
+        if (id < 0) continue;
+        if (id >= rt10_glass_count) return -1;
+        const double* G = rt10_glass_table + (size_t)id * RT10_GLASS_STRIDE;
+        for (int w = 0; w < wavelength_count; w++) {
+            S[RT10_SURF_INDEX + w] = __rt10_glass_eval(G, wavelengths[w]);
+        }
+        resolved++;
+    }
+    return resolved;
+}
+
+// 呼び出しごとに面形状を分類してスタックに置く上限（超えた面数では面ごとに分類）
+#define RT10_SHAPE_CACHE     256
+
+static inline int __rt10_surface_shape(const double* S) {
+    return __rt10_shape_of(S[RT10_SURF_RADIUS], S[RT10_SURF_CONIC], S + RT10_SURF_COEF,
+                           (int)S[RT10_SURF_MODE_ODD]);
+}
+
+/**
+ * 面テーブル全体を 1 回だけ分類する（光線ごとの係数走査を避ける）
+ * @param buf RT10_SHAPE_CACHE 要素の作業領域
+ * @return buf（surface_count が上限を超える場合は NULL）
+ */
+static const unsigned char* __rt10_classify_surfaces(const double* surfaces, int surface_count, unsigned char* buf) {
+    if (surface_count > RT10_SHAPE_CACHE) return NULL;
+    for (int s = 0; s < surface_count; s++) {
+        buf[s] = (unsigned char)__rt10_surface_shape(surfaces + (size_t)s * RT10_SURF_STRIDE);
+    }
+    return buf;
+}
+
+/**
+ * 面のサグ導関数 dz/dr（ベース二次曲面 + 多項式）
+ */
+static inline double __rt10_sag_dzdr(double r, double radius, double conic, const double* coefs, int modeOdd) {
+    if (!isfinite(radius) || radius == 0.0 || r < 1e-10) return 0.0;
+    double r2 = r * r;
+    double R = radius;
+    double dzdr = 0.0;
+    double term = (1.0 + conic) * r2 / (R * R);
+    if (term < 1.0) {
+        double sqrtTerm = sqrt(1.0 - term);
+        double denom = R * (1.0 + sqrtTerm);
+        double dDenom = -R * (1.0 + conic) * r / (R * R * sqrtTerm);
+        dzdr = (2.0 * r * denom - r2 * dDenom) / (denom * denom);
+    }
+    dzdr += __rt10_asphere_dzdr(r, r2,
+                                coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
+                                modeOdd);
+    return dzdr;
+}
+
+/**
+ * ray-tracing.js __intersectAsphericSurface_impl の JS Newton を移植したフォールバック。
+ *
+ * thickness 前進後の光線は次面を既に越えていることがあるため、負の t も許容する。
+ * 初期値の並び・ステップ制限・収束判定は JS 版と同一にしておくこと（同じ根を選ぶため）。
+ * @return ray parameter t（失敗は NAN）
+ */
+static double __rt10_intersect_fallback(double ox, double oy, double oz,
+                                        double dx, double dy, double dz,
+                                        double semidia, double radius, double conic,
+                                        const double* coefs, int modeOdd,
+                                        int maxIter, double tol) {
+    double guesses[16];
+    int gCount = 0;
+    __rt10_stat_count(RT10_STAT_FALLBACK_CALLS);
+
+    if (isfinite(radius) && radius != 0.0) {
+        double cz = radius;
+        double A = dx*dx + dy*dy + dz*dz;
+        double B = 2.0 * (ox*dx + oy*dy + (oz - cz)*dz);
+        double C = ox*ox + oy*oy + (oz - cz)*(oz - cz) - radius*radius;
+        double D = B*B - 4.0*A*C;
+        if (D >= 0.0) {
+            double sD = sqrt(D);
+            double t1 = (-B - sD) / (2.0*A);
+            double t2 = (-B + sD) / (2.0*A);
+            if (t1 > 1e-10) guesses[gCount++] = t1;
+            if (t2 > 1e-10) guesses[gCount++] = t2;
+        }
+    }
+    if (fabs(dz) > 1e-10) {
+        double tp = -oz / dz;
+        if (tp > 1e-10) guesses[gCount++] = tp;
+    }
+    if (semidia > 0.0) {
+        double curR = sqrt(ox*ox + oy*oy);
+        double dirR = sqrt(dx*dx + dy*dy);
+        if (dirR > 1e-10) {
+            const double factors[2] = {0.8, 1.0};
+            for (int f = 0; f < 2; f++) {
+                double targetR = semidia * factors[f];
+                if (targetR > curR) {
+                    double ts = (targetR - curR) / dirR;
+                    if (ts > 1e-10 && isfinite(ts)) guesses[gCount++] = ts;
+                }
+            }
+        }
+    }
+    {
+        const double ladder[6] = {1e-6, 0.001, 0.01, 0.1, 1.0, 10.0};
+        int nLadder = (gCount == 0) ? 6 : 5;
+        for (int k = 0; k < nLadder; k++) guesses[gCount++] = ladder[k];
+    }
+
+    // 重複除去とソート（挿入ソート, 要素数は高々 12）
+    for (int a = 1; a < gCount; a++) {
+        double v = guesses[a];
+        int b = a - 1;
+        while (b >= 0 && guesses[b] > v) { guesses[b + 1] = guesses[b]; b--; }
+        guesses[b + 1] = v;
+    }
+    int uCount = 0;
+    for (int a = 0; a < gCount; a++) {
+        if (uCount == 0 || guesses[a] != guesses[uCount - 1]) guesses[uCount++] = guesses[a];
+    }
+
+    for (int gi = 0; gi < uCount; gi++) {
+        double t = guesses[gi];
+        int haveValid = 0;
+        double validT = 0.0;
+        double lastValidF = INFINITY;
+
+        for (int i = 0; i < maxIter; i++) {
+            double x = ox + dx * t, y = oy + dy * t, z = oz + dz * t;
+            double r2 = x*x + y*y;
+            double r = sqrt(r2);
+            double sag = aspheric_sag_rt10(r, radius, conic,
+                                           coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                           coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
+                                           modeOdd);
+            double F = z - sag;
+            if (r <= semidia && fabs(F) < fabs(lastValidF)) {
+                haveValid = 1;
+                validT = t;
+                lastValidF = F;
+            }
+            if (fabs(F) < tol) return t;
+
+            double dzdr = 0.0;
+            if (r > 1e-10 && isfinite(radius) && radius != 0.0) {
+                double R = radius;
+                double term = (1.0 + conic) * r2 / (R * R);
+                if (term < 1.0) {
+                    double sqrtTerm = sqrt(1.0 - term);
+                    double denom = R * (1.0 + sqrtTerm);
+                    double sqrtDer = (1.0 + conic) * r / (R * R * sqrtTerm);
+                    dzdr = (2.0 * r * denom - r2 * R * sqrtDer) / (denom * denom);
+                } else {
+                    dzdr = 1.0 / R;
+                }
+                if (modeOdd) {
+                    // JS 版と同じく odd は coef1..coef5 (r^3..r^11) のみ
+                    dzdr += 3.0*coefs[0]*pow(r, 2) + 5.0*coefs[1]*pow(r, 4) + 7.0*coefs[2]*pow(r, 6) +
+                            9.0*coefs[3]*pow(r, 8) + 11.0*coefs[4]*pow(r, 10);
+                } else {
+                    dzdr += __rt10_asphere_dzdr(r, r2,
+                                                coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                                coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
+                                                0);
+                }
+            }
+            double dFdt = dz - dzdr * (x * dx + y * dy) / (r > 1e-10 ? r : 1e-10);
+            if (fabs(dFdt) < 1e-12) break;
+
+            double deltaT = F / dFdt;
+            double newT = t - deltaT;
+            double maxDelta = fabs(t) * 0.5 + 1.0;
+            if (fabs(deltaT) > maxDelta) newT = t - (deltaT > 0.0 ? 1.0 : -1.0) * maxDelta;
+            t = newT;
+            if (t < -10000.0 || t > 10000.0) break;
+        }
+
+        // 最大反復到達時の受容判定（JS 版と同じ）
+        if (isfinite(t)) {
+            double x = ox + dx * t, y = oy + dy * t, z = oz + dz * t;
+            double r = sqrt(x*x + y*y);
+            double sag = aspheric_sag_rt10(r, radius, conic,
+                                           coefs[0], coefs[1], coefs[2], coefs[3], coefs[4],
+                                           coefs[5], coefs[6], coefs[7], coefs[8], coefs[9],
+                                           modeOdd);
+            if (fabs(z - sag) < tol * 10.0 && r <= semidia * 1.1) return t;
+        }
+        if (haveValid && fabs(lastValidF) < tol * 50.0) return validT;
+    }
+    __rt10_stat_count(RT10_STAT_FALLBACK_MISS);
+    return NAN;
+}
+
+/*
+ * 面パラメータに対する前進モード微分（trace_system_rt10_derivs）
+ *
+ * パラメータは (面インデックス, 面テーブルのオフセット) の組で指定する。
+ * 対応するオフセットは RT10_SURF_RADIUS / RT10_SURF_CONIC / RT10_SURF_COEF+i / RT10_SURF_THICKNESS。
+ * thickness(s) は calculateSurfaceOrigins と同じく後続面の原点を R(s)·ez 方向へ平行移動させる。
+ */
+#define RT10_DERIV_MAX_PARAMS 64
+#define RT10_SAG_PARAMS       12  // radius, conic, coef1..coef10（オフセット - RT10_SURF_RADIUS）
+
+typedef struct {
+    int count;
+    const int* surface;
+    const int* code;
+    double axis[RT10_DERIV_MAX_PARAMS * 3];  // thickness パラメータの原点移動方向（グローバル）
+} rt10_deriv_spec;
+
+static inline int __rt10_deriv_code_ok(int code) {
+    return code == RT10_SURF_RADIUS || code == RT10_SURF_CONIC || code == RT10_SURF_THICKNESS ||
+           (code >= RT10_SURF_COEF && code < RT10_SURF_COEF + 10);
+}
+
+/**
+ * 交点での面の局所展開（接ベクトル計算用）
+ *
+ * u = (dz/dr) / r とすると ∇F = (-u·x, -u·y, 1)（F = z - sag）となり、r → 0 でも有限。
+ * ベース二次曲面は c = 1/R, K = 1 + conic, q = sqrt(1 - K c² r²) として
+ *   u = c / q,  ∂sag/∂c = r² / (q (1 + q)),  ∂sag/∂K = c³ r⁴ / (2 q (1 + q)²)
+ */
+typedef struct {
+    double u;
+    double du_dr;
+    double dsag[RT10_SAG_PARAMS];
+    double du[RT10_SAG_PARAMS];
+} rt10_sag_jet;
+
+static void __rt10_sag_jet(double r, double radius, double conic, const double* coefs, int modeOdd,
+                           rt10_sag_jet* J) {
+    for (int i = 0; i < RT10_SAG_PARAMS; i++) { J->dsag[i] = 0.0; J->du[i] = 0.0; }
+    J->u = 0.0;
+    J->du_dr = 0.0;
+
+    const double r2 = r * r;
+    const double c = 1.0 / radius;
+    const double K = 1.0 + conic;
+    const double arg = 1.0 - K * c * c * r2;
+    if (arg > 0.0) {
+        const double q = sqrt(arg);
+        const double q3 = q * q * q;
+        J->u = c / q;
+        J->du_dr = K * c * c * c * r / q3;
+        // radius: ∂/∂R = -c² ∂/∂c
+        J->dsag[0] = -c * c * r2 / (q * (1.0 + q));
+        J->du[0] = -c * c / q3;
+        J->dsag[1] = c * c * c * r2 * r2 / (2.0 * q * (1.0 + q) * (1.0 + q));
+        J->du[1] = c * c * c * r2 / (2.0 * q3);
+    }
+
+    // 多項式: sag += a·r^p, u += a·p·r^(p-2)（even: p = 4..22, odd: p = 3..21）
+    double rp = modeOdd ? r2 * r : r2 * r2;
+    double rp2 = modeOdd ? r : r2;          // r^(p-2)
+    double rp3 = modeOdd ? 1.0 : r;         // r^(p-3)
+    for (int i = 0; i < 10; i++) {
+        const double p = (double)(modeOdd ? 2 * i + 3 : 2 * i + 4);
+        const double a = coefs[i];
+        J->dsag[2 + i] = rp;
+        J->du[2 + i] = p * rp2;
+        if (a != 0.0) {
+            J->u += a * p * rp2;
+            J->du_dr += a * p * (p - 2.0) * rp3;
+        }
+        rp *= r2; rp2 *= r2; rp3 *= r2;
+    }
+}
+
+/*
+ * 面ごとの入射状態（trace_system_rt10_resume の差分再追跡用）
+ * states[s] は面 s の処理開始時点の光線状態。面 s より前で終了した光線は
+ * 終了時の ray_out（位置・方向・光路長）と RT10_STATE_STATUS に終了ステータスを持つ。
+ */
+#define RT10_STATE_PX      0   // 位置・方向・光路長（ray_out と同じ並び, 0..6）
+#define RT10_STATE_N       7   // 現在の媒質の屈折率
+#define RT10_STATE_LAST    8   // OPL の基準点（直前の物理的な点, 8..10）
+#define RT10_STATE_STATUS  11  // RT10_STATUS_OK = 追跡中
+#define RT10_STATE_STRIDE  12
+
+EMSCRIPTEN_KEEPALIVE int rt10_state_stride(void) { return RT10_STATE_STRIDE; }
+
+/**
+ * 1光線分のシステム追跡
+ *
+ * states != NULL のとき、面 start_surface 以降の各面の入射状態を states
+ * （surface_count × RT10_STATE_STRIDE）へ記録する。start_surface > 0 なら追跡は
+ * states[start_surface] から再開し、それより前の面は処理しない（前回の値をそのまま使う）。
+ *
+ * dv != NULL のとき、dv の各パラメータについて最終位置・方向・光路長の微分を
+ * dout（dv->count × RT10_RAY_OUT_STRIDE）へ書き出す。交点は陰関数定理で微分するため
+ * Newton の収束誤差やステップ幅に依存しない。STATUS_OK 以外の光線は 0 埋め。
+ * @return RT10_STATUS_*
+ */
+static int __rt10_trace_one(const double* surfaces, int surface_count,
+                            const double* ray_in, int wavelength_slot, double n0,
+                            int stop_surface, int flags,
+                            double* ray_out, double* hits,
+                            const rt10_deriv_spec* dv, double* dout,
+                            int start_surface, double* states,
+                            const unsigned char* shapes) {
+    double px = ray_in[0], py = ray_in[1], pz = ray_in[2];
+    double dx = ray_in[3], dy = ray_in[4], dz = ray_in[5];
+    double n = n0;
+    double opl = 0.0;
+    // OPL は直前の物理的な点（始点 or 前面の交点）から計測する
+    double lx = px, ly = py, lz = pz;
+    int status = RT10_STATUS_OK;
+    int s_end = -1;        // 最後に処理した面（終了光線の状態記録用）
+    int s_begin = 0;
+
+    // 接ベクトル: dout[j] = d(px,py,pz,dx,dy,dz,opl)/dθ_j、dl = d(lx,ly,lz)/dθ_j、dgn = 面法線（グローバル）
+    const int P = dv ? dv->count : 0;
+    double dl[RT10_DERIV_MAX_PARAMS * 3];
+    double dgn[RT10_DERIV_MAX_PARAMS * 3];
+    for (int j = 0; j < P; j++) {
+        double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+        for (int k = 0; k < RT10_RAY_OUT_STRIDE; k++) T[k] = 0.0;
+        dl[j * 3] = dl[j * 3 + 1] = dl[j * 3 + 2] = 0.0;
+    }
+
+    if (states && start_surface > 0) {
+        const double* st = states + (size_t)start_surface * RT10_STATE_STRIDE;
+        px = st[0]; py = st[1]; pz = st[2];
+        dx = st[3]; dy = st[4]; dz = st[5];
+        opl = st[6];
+        if ((int)st[RT10_STATE_STATUS] != RT10_STATUS_OK) {
+            // 再開面より前で終了済み: 記録済みの終了状態をそのまま返す
+            ray_out[0] = px; ray_out[1] = py; ray_out[2] = pz;
+            ray_out[3] = dx; ray_out[4] = dy; ray_out[5] = dz;
+            ray_out[6] = opl;
+            return (int)st[RT10_STATE_STATUS];
+        }
+        n = st[RT10_STATE_N];
+        lx = st[RT10_STATE_LAST]; ly = st[RT10_STATE_LAST + 1]; lz = st[RT10_STATE_LAST + 2];
+        s_begin = start_surface;
+        s_end = start_surface - 1;
+    } else {
+        double dl0 = sqrt(dx * dx + dy * dy + dz * dz);
+        if (!(dl0 > 0.0) || !isfinite(dl0) || !isfinite(px) || !isfinite(py) || !isfinite(pz)) {
+            status = RT10_STATUS_INVALID;
+            goto done;
+        }
+        dx /= dl0; dy /= dl0; dz /= dl0;
+    }
+
+    int last = surface_count - 1;
+    if (stop_surface >= 0 && stop_surface < last) last = stop_surface;
+
+    for (int s = s_begin; s <= last; s++) {
+        const double* S = surfaces + (size_t)s * RT10_SURF_STRIDE;
+        const int kind = (int)S[RT10_SURF_KIND];
+        s_end = s;
+
+        if (states) {
+            double* st = states + (size_t)s * RT10_STATE_STRIDE;
+            st[0] = px; st[1] = py; st[2] = pz;
+            st[3] = dx; st[4] = dy; st[5] = dz;
+            st[6] = opl;
+            st[RT10_STATE_N] = n;
+            st[RT10_STATE_LAST] = lx; st[RT10_STATE_LAST + 1] = ly; st[RT10_STATE_LAST + 2] = lz;
+            st[RT10_STATE_STATUS] = RT10_STATUS_OK;
+        }
+
+        if (kind == RT10_KIND_COORD_BREAK) {
+            double nn = S[RT10_SURF_INDEX + wavelength_slot];
+            if (nn > 0.0) n = nn;
+            continue;
+        }
+        if (kind == RT10_KIND_OBJECT) {
+            double th = S[RT10_SURF_THICKNESS];
+            for (int j = 0; j < P; j++) {
+                double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+                const double seed = (dv->surface[j] == s && dv->code[j] == RT10_SURF_THICKNESS) ? 1.0 : 0.0;
+                T[0] += T[3] * th + dx * seed;
+                T[1] += T[4] * th + dy * seed;
+                T[2] += T[5] * th + dz * seed;
+                T[6] += n * seed;
+                dl[j * 3] = T[0]; dl[j * 3 + 1] = T[1]; dl[j * 3 + 2] = T[2];
+            }
+            if (th != 0.0) {
+                px += dx * th; py += dy * th; pz += dz * th;
+                opl += n * th;
+                lx = px; ly = py; lz = pz;
+            }
+            continue;
+        }
+
+        const double* O = S + RT10_SURF_ORIGIN;
+        const double* M = S + RT10_SURF_ROT;
+
+        // グローバル → ローカル（R(s)^T を適用）
+        double rx = px - O[0], ry = py - O[1], rz = pz - O[2];
+        double lpx = M[0] * rx + M[3] * ry + M[6] * rz;
+        double lpy = M[1] * rx + M[4] * ry + M[7] * rz;
+        double lpz = M[2] * rx + M[5] * ry + M[8] * rz;
+        double ldx = M[0] * dx + M[3] * dy + M[6] * dz;
+        double ldy = M[1] * dx + M[4] * dy + M[7] * dz;
+        double ldz = M[2] * dx + M[5] * dy + M[8] * dz;
+
+        const double radius = S[RT10_SURF_RADIUS];
+        const int shape = shapes ? (int)shapes[s] : __rt10_surface_shape(S);
+        const int isPlane = shape == RT10_SHAPE_PLANE;
+        double hx, hy, hz, nx, ny, nz;
+        double tHit;
+        double flip = 1.0;
+
+        if (isPlane) {
+            // 平面（z=0）
+            const double epsilon = 1e-9;
+            if (fabs(ldz) < epsilon) { status = RT10_STATUS_MISS; break; }
+            double t = -lpz / ldz;
+            if (fabs(t) < epsilon) t = (ldz > 0.0 ? 1.0 : -1.0) * epsilon;
+            tHit = t;
+            hx = lpx + ldx * t; hy = lpy + ldy * t; hz = lpz + ldz * t;
+            nx = 0.0; ny = 0.0; nz = (ldz > 0.0) ? -1.0 : 1.0;
+        } else {
+            const double conic = S[RT10_SURF_CONIC];
+            const double* coefs = S + RT10_SURF_COEF;
+            const int modeOdd = (int)S[RT10_SURF_MODE_ODD];
+            double semidia = S[RT10_SURF_SEMIDIA];
+            if (!(semidia > 0.0)) semidia = INFINITY;
+
+            double t = __rt10_intersect_shaped(shape, lpx, lpy, lpz, ldx, ldy, ldz, semidia, radius, conic,
+                                               coefs, modeOdd, 20, 1e-7);
+            if (!(t > 0.0) || !isfinite(t)) {
+                // ray-tracing.js と同じく、JS版 Newton（負の t も許容）で再探索
+                t = __rt10_intersect_fallback(lpx, lpy, lpz, ldx, ldy, ldz, semidia, radius, conic, coefs, modeOdd, 20, 1e-7);
+            }
+            if (!isfinite(t)) { status = RT10_STATUS_MISS; break; }
+            tHit = t;
+
+            hx = lpx + ldx * t; hy = lpy + ldy * t; hz = lpz + ldz * t;
+
+            double r = sqrt(hx * hx + hy * hy);
+            if (r < 1e-10) {
+                nx = 0.0; ny = 0.0; nz = 1.0;
+            } else {
+                double dzdr = __rt10_sag_dzdr(r, radius, conic, coefs, modeOdd);
+                nx = -dzdr * (hx / r);
+                ny = -dzdr * (hy / r);
+                nz = 1.0;
+                double nl = sqrt(nx * nx + ny * ny + nz * nz);
+                nx /= nl; ny /= nl; nz /= nl;
+            }
+            if (ldx * nx + ldy * ny + ldz * nz > 0.0) { nx = -nx; ny = -ny; nz = -nz; flip = -1.0; }
+        }
+
+        // 開口判定（評価面ではスキップ。像面はJS側で RT10_AP_NONE にパック済み）
+        const int apKind = (int)S[RT10_SURF_AP_KIND];
+        if (s != stop_surface && apKind != RT10_AP_NONE) {
+            const double a = S[RT10_SURF_AP_A];
+            const double b = S[RT10_SURF_AP_B];
+            if (apKind == RT10_AP_RECT) {
+                if (fabs(hx) > a || fabs(hy) > b) { status = RT10_STATUS_BLOCKED; break; }
+            } else if (sqrt(hx * hx + hy * hy) > a) {
+                status = RT10_STATUS_BLOCKED; break;
+            }
+        }
+
+        // ローカル → グローバル
+        double gx = M[0] * hx + M[1] * hy + M[2] * hz + O[0];
+        double gy = M[3] * hx + M[4] * hy + M[5] * hz + O[1];
+        double gz = M[6] * hx + M[7] * hy + M[8] * hz + O[2];
+
+        if (P > 0) {
+            // 交点・光路長・法線の接ベクトル。F(h) = hz - sag(r) = 0 を陰関数微分する:
+            //   dt = (∂sag/∂θ·dθ - ∇F·(dlp + t·dld)) / (∇F·ld)
+            rt10_sag_jet jet;
+            jet.u = 0.0; jet.du_dr = 0.0;
+            double mx = 0.0, my = 0.0, mlen = 1.0, mdotld = ldz;
+            const double hr = sqrt(hx * hx + hy * hy);
+            if (!isPlane) {
+                __rt10_sag_jet(hr, radius, S[RT10_SURF_CONIC], S + RT10_SURF_COEF, (int)S[RT10_SURF_MODE_ODD], &jet);
+                mx = -jet.u * hx;
+                my = -jet.u * hy;
+                mlen = sqrt(mx * mx + my * my + 1.0);
+                mdotld = mx * ldx + my * ldy + ldz;
+            }
+            const double gdx = gx - lx, gdy = gy - ly, gdz = gz - lz;
+
+            for (int j = 0; j < P; j++) {
+                double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+                const int code = dv->code[j];
+                const int own = (dv->surface[j] == s);
+                double ox = 0.0, oy = 0.0, oz = 0.0;
+                if (code == RT10_SURF_THICKNESS && s > dv->surface[j]) {
+                    ox = dv->axis[j * 3]; oy = dv->axis[j * 3 + 1]; oz = dv->axis[j * 3 + 2];
+                }
+                const double qx = T[0] - ox, qy = T[1] - oy, qz = T[2] - oz;
+                const double dlpx = M[0] * qx + M[3] * qy + M[6] * qz;
+                const double dlpy = M[1] * qx + M[4] * qy + M[7] * qz;
+                const double dlpz = M[2] * qx + M[5] * qy + M[8] * qz;
+                const double dldx = M[0] * T[3] + M[3] * T[4] + M[6] * T[5];
+                const double dldy = M[1] * T[3] + M[4] * T[4] + M[7] * T[5];
+                const double dldz = M[2] * T[3] + M[5] * T[4] + M[8] * T[5];
+
+                const double ax = dlpx + tHit * dldx, ay = dlpy + tHit * dldy, az = dlpz + tHit * dldz;
+                double dsag = 0.0, duth = 0.0;
+                if (!isPlane && own && code != RT10_SURF_THICKNESS) {
+                    dsag = jet.dsag[code - RT10_SURF_RADIUS];
+                    duth = jet.du[code - RT10_SURF_RADIUS];
+                }
+                const double dt = (dsag - (mx * ax + my * ay + az)) / mdotld;
+                const double dhx = ax + ldx * dt, dhy = ay + ldy * dt, dhz = az + ldz * dt;
+
+                const double dgx = M[0] * dhx + M[1] * dhy + M[2] * dhz + ox;
+                const double dgy = M[3] * dhx + M[4] * dhy + M[5] * dhz + oy;
+                const double dgz = M[6] * dhx + M[7] * dhy + M[8] * dhz + oz;
+                double* L = dl + j * 3;
+                T[6] += n * ((dgx - L[0]) * dx + (dgy - L[1]) * dy + (dgz - L[2]) * dz +
+                             gdx * T[3] + gdy * T[4] + gdz * T[5]);
+                L[0] = T[0] = dgx; L[1] = T[1] = dgy; L[2] = T[2] = dgz;
+
+                double dnx = 0.0, dny = 0.0, dnz = 0.0;
+                if (!isPlane) {
+                    const double dr = (hr > 1e-12) ? (hx * dhx + hy * dhy) / hr : 0.0;
+                    const double du = jet.du_dr * dr + duth;
+                    const double dmx = -(du * hx + jet.u * dhx);
+                    const double dmy = -(du * hy + jet.u * dhy);
+                    const double ux = mx / mlen, uy = my / mlen, uz = 1.0 / mlen;
+                    const double proj = ux * dmx + uy * dmy;
+                    dnx = flip * (dmx - ux * proj) / mlen;
+                    dny = flip * (dmy - uy * proj) / mlen;
+                    dnz = flip * (-uz * proj) / mlen;
+                }
+                double* G = dgn + j * 3;
+                G[0] = M[0] * dnx + M[1] * dny + M[2] * dnz;
+                G[1] = M[3] * dnx + M[4] * dny + M[5] * dnz;
+                G[2] = M[6] * dnx + M[7] * dny + M[8] * dnz;
+            }
+        }
+
+        // 直前の点からの符号付き距離（虚光路を含む）
+        opl += n * ((gx - lx) * dx + (gy - ly) * dy + (gz - lz) * dz);
+        lx = gx; ly = gy; lz = gz;
+
+        if (hits) {
+            double* H = hits + (size_t)s * 3;
+            H[0] = gx; H[1] = gy; H[2] = gz;
+        }
+        px = gx; py = gy; pz = gz;
+
+        if ((flags & RT10_TRACE_HIT_ONLY) && s == stop_surface) break;
+
+        double gnx = M[0] * nx + M[1] * ny + M[2] * nz;
+        double gny = M[3] * nx + M[4] * ny + M[5] * nz;
+        double gnz = M[6] * nx + M[7] * ny + M[8] * nz;
+
+        if (kind == RT10_KIND_MIRROR) {
+            // 表面からの入射のみ反射（裏面は透過）
+            if (ldx * nx + ldy * ny + ldz * nz < 0.0) {
+                double ix = dx, iy = dy, iz = dz;
+                double dn = dx * gnx + dy * gny + dz * gnz;
+                double d2 = 2.0 * dn;
+                dx -= d2 * gnx; dy -= d2 * gny; dz -= d2 * gnz;
+                double l = sqrt(dx * dx + dy * dy + dz * dz);
+                dx /= l; dy /= l; dz /= l;
+                for (int j = 0; j < P; j++) {
+                    double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+                    const double* G = dgn + j * 3;
+                    const double ddn = T[3] * gnx + T[4] * gny + T[5] * gnz + ix * G[0] + iy * G[1] + iz * G[2];
+                    double vx = T[3] - 2.0 * (ddn * gnx + dn * G[0]);
+                    double vy = T[4] - 2.0 * (ddn * gny + dn * G[1]);
+                    double vz = T[5] - 2.0 * (ddn * gnz + dn * G[2]);
+                    const double proj = dx * vx + dy * vy + dz * vz;
+                    T[3] = (vx - dx * proj) / l; T[4] = (vy - dy * proj) / l; T[5] = (vz - dz * proj) / l;
+                }
+            }
+        } else {
+            double n2 = S[RT10_SURF_INDEX + wavelength_slot];
+            if (!(n2 > 0.0)) n2 = 1.0;
+            double cosI = -(gnx * dx + gny * dy + gnz * dz);
+            double eta = n / n2;
+            double k = 1.0 - eta * eta * (1.0 - cosI * cosI);
+            if (k < 0.0) { status = RT10_STATUS_TIR; break; }
+            double sk = sqrt(k);
+            double c2 = eta * cosI - sk;
+            double ix = dx, iy = dy, iz = dz;
+            dx = eta * dx + c2 * gnx;
+            dy = eta * dy + c2 * gny;
+            dz = eta * dz + c2 * gnz;
+            double l = sqrt(dx * dx + dy * dy + dz * dz);
+            dx /= l; dy /= l; dz /= l;
+            n = n2;
+            for (int j = 0; j < P; j++) {
+                double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+                const double* G = dgn + j * 3;
+                const double dcos = -(G[0] * ix + G[1] * iy + G[2] * iz + gnx * T[3] + gny * T[4] + gnz * T[5]);
+                const double dc2 = eta * dcos - (sk > 0.0 ? eta * eta * cosI * dcos / sk : 0.0);
+                double vx = eta * T[3] + dc2 * gnx + c2 * G[0];
+                double vy = eta * T[4] + dc2 * gny + c2 * G[1];
+                double vz = eta * T[5] + dc2 * gnz + c2 * G[2];
+                const double proj = dx * vx + dy * vy + dz * vz;
+                T[3] = (vx - dx * proj) / l; T[4] = (vy - dy * proj) / l; T[5] = (vz - dz * proj) / l;
+            }
+        }
+
+        double th = S[RT10_SURF_THICKNESS];
+        for (int j = 0; j < P; j++) {
+            double* T = dout + (size_t)j * RT10_RAY_OUT_STRIDE;
+            const double seed = (dv->surface[j] == s && dv->code[j] == RT10_SURF_THICKNESS) ? 1.0 : 0.0;
+            T[0] += T[3] * th + dx * seed;
+            T[1] += T[4] * th + dy * seed;
+            T[2] += T[5] * th + dz * seed;
+        }
+        if (th != 0.0) {
+            px += dx * th; py += dy * th; pz += dz * th;
+        }
+    }
+
+done:
+    ray_out[0] = px; ray_out[1] = py; ray_out[2] = pz;
+    ray_out[3] = dx; ray_out[4] = dy; ray_out[5] = dz;
+    ray_out[6] = opl;
+    if (status != RT10_STATUS_OK) {
+        for (int j = 0; j < P * RT10_RAY_OUT_STRIDE; j++) dout[j] = 0.0;
+        if (states) {
+            for (int s = s_end + 1; s < surface_count; s++) {
+                double* st = states + (size_t)s * RT10_STATE_STRIDE;
+                for (int k = 0; k < RT10_RAY_OUT_STRIDE; k++) st[k] = ray_out[k];
+                st[RT10_STATE_STATUS] = (double)status;
+            }
+        }
+    }
+    return status;
+}
+
+// 並列化の最小チャンク（光線数）。小バッチはスレッド起床コストの方が大きい。
+#define RT10_PARALLEL_MIN_RAYS 64
+
+typedef struct {
+    const double* surfaces;
+    int surface_count;
+    const double* rays_in;
+    int wavelength_slot;
+    double n0;
+    int stop_surface;
+    int flags;
+    double* rays_out;
+    int* status_out;
+    double* hits_out;
+    const rt10_deriv_spec* derivs;  // trace_system_rt10_derivs のみ
+    double* derivs_out;
+    int start_surface;              // trace_system_rt10_resume のみ
+    double* states;
+    const unsigned char* shapes;    // 面形状（__rt10_classify_surfaces, NULL = 面ごとに分類）
+} rt10_system_task;
+
+static void __rt10_trace_range(int begin, int end, void* ctx) {
+    const rt10_system_task* t = (const rt10_system_task*)ctx;
+    for (int i = begin; i < end; i++) {
+        double* hits = t->hits_out ? t->hits_out + (size_t)i * (size_t)t->surface_count * 3 : NULL;
+        double* deriv = t->derivs ? t->derivs_out + (size_t)i * (size_t)t->derivs->count * RT10_RAY_OUT_STRIDE : NULL;
+        double* states = t->states ? t->states + (size_t)i * (size_t)t->surface_count * RT10_STATE_STRIDE : NULL;
+        t->status_out[i] = __rt10_trace_one(t->surfaces, t->surface_count,
+                                            t->rays_in + (size_t)i * RT10_RAY_IN_STRIDE,
+                                            t->wavelength_slot, t->n0, t->stop_surface, t->flags,
+                                            t->rays_out + (size_t)i * RT10_RAY_OUT_STRIDE, hits,
+                                            t->derivs, deriv, t->start_surface, states, t->shapes);
+    }
+}
+
+/**
+ * システム一括光線追跡
+ *
+ * @param surfaces 面テーブル（surface_count × RT10_SURF_STRIDE）
+ * @param surface_count 面数
+ * @param rays_in 入力光線（ray_count × RT10_RAY_IN_STRIDE, グローバル座標）
+ * @param ray_count 光線数
+ * @param wavelength_slot 屈折率テーブルの波長スロット（0..RT10_MAX_WAVELENGTHS-1）
+ * @param n0 入射側媒質の屈折率
+ * @param stop_surface 評価面インデックス（-1 = 全面。評価面では開口判定しない）
+ * @param flags RT10_TRACE_*
+ * @param rays_out 出力光線（ray_count × RT10_RAY_OUT_STRIDE）: 最終位置・方向・光路長
+ * @param status_out 光線ごとのステータス（RT10_STATUS_*）
+ * @param hits_out 各面のグローバル交点（ray_count × surface_count × 3, NULL可）。
+ *                 未到達・交点を持たない面は呼び出し前の値のまま。
+ * @return RT10_STATUS_OK で終了した光線数（引数不正時は -1）
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_system_rt10(const double* surfaces, int surface_count,
+                      const double* rays_in, int ray_count,
+                      int wavelength_slot, double n0,
+                      int stop_surface, int flags,
+                      double* rays_out, int* status_out, double* hits_out) {
+    if (!surfaces || !rays_in || !rays_out || !status_out) return -1;
+    if (surface_count <= 0 || ray_count < 0) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    if (!(n0 > 0.0)) n0 = 1.0;
+
+    const double stat_start = __rt10_now_ms();
+    unsigned char shape_buf[RT10_SHAPE_CACHE];
+    rt10_system_task t = {
+        surfaces, surface_count, rays_in, wavelength_slot, n0, stop_surface, flags,
+        rays_out, status_out, hits_out, NULL, NULL, 0, NULL,
+        __rt10_classify_surfaces(surfaces, surface_count, shape_buf)
+    };
+    coopt_parallel_for(0, ray_count, RT10_PARALLEL_MIN_RAYS, __rt10_trace_range, &t);
+
+    int okCount = 0;
+    for (int i = 0; i < ray_count; i++) {
+        if (status_out[i] == RT10_STATUS_OK) okCount++;
+    }
+    __rt10_stat_entry(RT10_STAT_ENTRY_SYSTEM, ray_count, stat_start);
+    return okCount;
+}
+
+/**
+ * trace_system_rt10 + 面パラメータに対する解析微分（前進モード）
+ *
+ * LM の Jacobian を前進差分で組む代わりに、1 回の追跡で全パラメータの微分を得る。
+ * 入力光線はパラメータに依存しないものとして扱う（光線エイミングの再計算は含まない）。
+ *
+ * @param params (面インデックス, 面テーブルのオフセット) の組 × param_count（int 配列）。
+ *               オフセットは RT10_SURF_RADIUS / RT10_SURF_CONIC / RT10_SURF_COEF..+9 / RT10_SURF_THICKNESS。
+ *               平面（radius = 0）の radius 微分は 0。
+ * @param param_count パラメータ数（1..RT10_DERIV_MAX_PARAMS）
+ * @param derivs_out ray_count × param_count × RT10_RAY_OUT_STRIDE:
+ *                   d(位置, 方向, 光路長)/dθ。STATUS_OK 以外の光線は 0。
+ * その他の引数・戻り値は trace_system_rt10 と同じ。
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_system_rt10_derivs(const double* surfaces, int surface_count,
+                             const double* rays_in, int ray_count,
+                             int wavelength_slot, double n0,
+                             int stop_surface, int flags,
+                             const int* params, int param_count,
+                             double* rays_out, int* status_out, double* hits_out,
+                             double* derivs_out) {
+    if (!surfaces || !rays_in || !rays_out || !status_out || !params || !derivs_out) return -1;
+    if (surface_count <= 0 || ray_count < 0) return -1;
+    if (param_count <= 0 || param_count > RT10_DERIV_MAX_PARAMS) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    if (!(n0 > 0.0)) n0 = 1.0;
+
+    int surf_idx[RT10_DERIV_MAX_PARAMS];
+    int codes[RT10_DERIV_MAX_PARAMS];
+    rt10_deriv_spec spec;
+    spec.count = param_count;
+    spec.surface = surf_idx;
+    spec.code = codes;
+    for (int j = 0; j < param_count; j++) {
+        const int si = params[j * 2];
+        const int code = params[j * 2 + 1];
+        if (si < 0 || si >= surface_count || !__rt10_deriv_code_ok(code)) return -1;
+        surf_idx[j] = si;
+        codes[j] = code;
+        // 後続面は R(s)·ez（回転行列の第 3 列）方向へ移動する
+        const double* M = surfaces + (size_t)si * RT10_SURF_STRIDE + RT10_SURF_ROT;
+        spec.axis[j * 3] = M[2];
+        spec.axis[j * 3 + 1] = M[5];
+        spec.axis[j * 3 + 2] = M[8];
+    }
+
+    const double stat_start = __rt10_now_ms();
+    unsigned char shape_buf[RT10_SHAPE_CACHE];
+    rt10_system_task t = {
+        surfaces, surface_count, rays_in, wavelength_slot, n0, stop_surface, flags,
+        rays_out, status_out, hits_out, &spec, derivs_out, 0, NULL,
+        __rt10_classify_surfaces(surfaces, surface_count, shape_buf)
+    };
+    coopt_parallel_for(0, ray_count, RT10_PARALLEL_MIN_RAYS, __rt10_trace_range, &t);
+
+    int okCount = 0;
+    for (int i = 0; i < ray_count; i++) {
+        if (status_out[i] == RT10_STATUS_OK) okCount++;
+    }
+    __rt10_stat_entry(RT10_STAT_ENTRY_DERIVS, ray_count, stat_start);
+    return okCount;
+}
+
+EMSCRIPTEN_KEEPALIVE int rt10_deriv_max_params(void) { return RT10_DERIV_MAX_PARAMS; }
+
+/**
+ * 面ごとの入射状態を記録しながら追跡し、変更のあった面から再追跡する（差分追跡）
+ *
+ * 最適化の Jacobian 列やスライダー操作では 1 面だけが変わることが多い。面 k より前の
+ * 面テーブル行が前回と同一なら、面 k の入射状態も同一なので states から再開できる。
+ * 結果は start_surface = 0 の全追跡とビット単位で一致する。
+ *
+ * @param start_surface 再開する面（0 = 全追跡して states を記録）。前回と異なる最初の行を渡す。
+ * @param states 光線ごとの面入射状態（ray_count × surface_count × RT10_STATE_STRIDE）。
+ *               start_surface > 0 では前回の呼び出し（同じ光線・同じ surface_count）の内容が必要。
+ * @param hits_out trace_system_rt10 と同じ。書き込むのは start_surface 以降の面のみ。
+ * その他の引数・戻り値は trace_system_rt10 と同じ。
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_system_rt10_resume(const double* surfaces, int surface_count,
+                             const double* rays_in, int ray_count,
+                             int wavelength_slot, double n0,
+                             int stop_surface, int flags,
+                             int start_surface, double* states,
+                             double* rays_out, int* status_out, double* hits_out) {
+    if (!surfaces || !rays_in || !rays_out || !status_out || !states) return -1;
+    if (surface_count <= 0 || ray_count < 0) return -1;
+    if (start_surface < 0 || start_surface >= surface_count) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    if (!(n0 > 0.0)) n0 = 1.0;
+    // 評価面より後ろの状態は記録されないので、評価面から再開する
+    if (stop_surface >= 0 && start_surface > stop_surface) start_surface = stop_surface;
+
+    const double stat_start = __rt10_now_ms();
+    unsigned char shape_buf[RT10_SHAPE_CACHE];
+    rt10_system_task t = {
+        surfaces, surface_count, rays_in, wavelength_slot, n0, stop_surface, flags,
+        rays_out, status_out, hits_out, NULL, NULL, start_surface, states,
+        __rt10_classify_surfaces(surfaces, surface_count, shape_buf)
+    };
+    coopt_parallel_for(0, ray_count, RT10_PARALLEL_MIN_RAYS, __rt10_trace_range, &t);
+
+    int okCount = 0;
+    for (int i = 0; i < ray_count; i++) {
+        if (status_out[i] == RT10_STATUS_OK) okCount++;
+    }
+    __rt10_stat_entry(RT10_STAT_ENTRY_RESUME, ray_count, stat_start);
+    return okCount;
+}
+
+/*
+ * =============================================================================
+ * 瞳格子 → OPD 格子（参照球で閉じる, trace_opd_grid_rt10）
+ * =============================================================================
+ *
+ * 入射瞳上の grid_size² 格子点を通る光線を生成して像面（最終面）まで追跡し、
+ * 主光線の像点 P を中心・半径 R の参照球までの光路長で閉じた OPD を、
+ * psf-wasm.c の calculate_psf_grid_wasm がそのまま受け取る grid_opd / pupil_mask 形式で返す。
+ *
+ *   OPD(u, v) = [OPL(X) + n'·t] - [OPL_chief - n'·R]   （µm, 遅延が正）
+ *   t: 像空間の光線 X + t·D と参照球 |Q - P| = R の瞳側の交点
+ *
+ * 格子座標は行 i → v, 列 j → u（u, v = (k - c) / c, c = (grid_size - 1) / 2, u² + v² <= 1 が瞳内）。
+ * 遮断・全反射・参照球と交わらない光線は pupil_mask = 0, OPD = 0。
+ */
+#define RT10_OPD_MODE        0   // RT10_OPD_SOURCE_*
+#define RT10_OPD_SOURCE      1   // 平行光: 方向 d / 点光源: 物点 O（1..3）
+#define RT10_OPD_PUPIL_C     4   // 入射瞳の中心（グローバル, 主光線が通る点, 4..6）
+#define RT10_OPD_PUPIL_U     7   // u = +1 の瞳ベクトル（半径込み, 7..9）
+#define RT10_OPD_PUPIL_V     10  // v = +1 の瞳ベクトル（10..12）
+#define RT10_OPD_LEAD        13  // 平行光: 光線の始点を瞳中心の手前 lead（d ⟂ 平面上, 等位相）に置く
+#define RT10_OPD_REF_RADIUS  14  // > 0: 参照球半径 / <= 0: 射出瞳から自動 / 非有限: 平面参照
+#define RT10_OPD_PARAMS      15
+
+#define RT10_OPD_SOURCE_COLLIMATED 0
+#define RT10_OPD_SOURCE_POINT      1
+
+// info_out
+#define RT10_OPD_INFO_IMAGE      0   // 主光線の像点 P（0..2）
+#define RT10_OPD_INFO_RADIUS     3   // 使った参照球半径（平面参照は Infinity）
+#define RT10_OPD_INFO_N_IMAGE    4   // 像空間の屈折率
+#define RT10_OPD_INFO_CHIEF_OPL  5   // 主光線の像点までの光路長
+#define RT10_OPD_INFO_VALID      6   // pupil_mask = 1 の格子点数
+#define RT10_OPD_INFO_FIELDS     7
+
+#define RT10_OPD_UM_PER_MM   1000.0
+#define RT10_OPD_MAX_RADIUS  1e6     // これより大きい自動半径は平面参照（wavefront.js の MAX_RADIUS と同じ）
+#define RT10_OPD_PROBE       1e-4    // 射出瞳を求めるプローブ光線の傾き（rad）/ 物点の相対移動量
+
+EMSCRIPTEN_KEEPALIVE int rt10_opd_params(void) { return RT10_OPD_PARAMS; }
+EMSCRIPTEN_KEEPALIVE int rt10_opd_info_fields(void) { return RT10_OPD_INFO_FIELDS; }
+
+// 瞳座標 (u, v) を通る入力光線（RT10_RAY_IN_STRIDE）
+static void __rt10_opd_make_ray(const double* p, const double* d, double u, double v, double* ray) {
+    const double* C = p + RT10_OPD_PUPIL_C;
+    const double* U = p + RT10_OPD_PUPIL_U;
+    const double* V = p + RT10_OPD_PUPIL_V;
+    const double qx = C[0] + u * U[0] + v * V[0];
+    const double qy = C[1] + u * U[1] + v * V[1];
+    const double qz = C[2] + u * U[2] + v * V[2];
+    if ((int)p[RT10_OPD_MODE] == RT10_OPD_SOURCE_POINT) {
+        const double* O = p + RT10_OPD_SOURCE;
+        double dx = qx - O[0], dy = qy - O[1], dz = qz - O[2];
+        const double l = sqrt(dx * dx + dy * dy + dz * dz);
+        ray[0] = O[0]; ray[1] = O[1]; ray[2] = O[2];
+        ray[3] = dx / l; ray[4] = dy / l; ray[5] = dz / l;
+    } else {
+        // 始点を d に垂直な平面（C - lead·d を通る）へ戻す → 全光線が同位相から出発
+        const double s = (qx - C[0]) * d[0] + (qy - C[1]) * d[1] + (qz - C[2]) * d[2] + p[RT10_OPD_LEAD];
+        ray[0] = qx - d[0] * s; ray[1] = qy - d[1] * s; ray[2] = qz - d[2] * s;
+        ray[3] = d[0]; ray[4] = d[1]; ray[5] = d[2];
+    }
+}
+
+// 最終面に入射する媒質（__rt10_trace_one と同じ規則で面 0..last-1 をたどる）
+static double __rt10_image_index(const double* surfaces, int last, int wavelength_slot, double n0) {
+    double n = n0;
+    for (int s = 0; s < last; s++) {
+        const double* S = surfaces + (size_t)s * RT10_SURF_STRIDE;
+        const int kind = (int)S[RT10_SURF_KIND];
+        const double nn = S[RT10_SURF_INDEX + wavelength_slot];
+        if (kind == RT10_KIND_COORD_BREAK) {
+            if (nn > 0.0) n = nn;
+        } else if (kind == RT10_KIND_REFRACT) {
+            n = nn > 0.0 ? nn : 1.0;
+        }
+    }
+    return n;
+}
+
+// 瞳座標 uv[2k], uv[2k+1] の OPD（trace_opd_grid_rt10 / trace_opd_points_rt10 の共通部分）
+// opd_out[k] / ok_out[k] に結果（無効な点は 0 / 0）。戻り値は有効な点数 / -1 / -2
+static int __rt10_opd_trace(const double* surfaces, int surface_count, const double* params,
+                            const double* uv, int count, int wavelength_slot, double n0,
+                            double* opd_out, int* ok_out, double* info_out) {
+    const int last = surface_count - 1;
+
+    double d[3] = { 0.0, 0.0, 1.0 };
+    if ((int)params[RT10_OPD_MODE] != RT10_OPD_SOURCE_POINT) {
+        const double* D = params + RT10_OPD_SOURCE;
+        const double l = sqrt(D[0] * D[0] + D[1] * D[1] + D[2] * D[2]);
+        if (!(l > 0.0) || !isfinite(l)) return -1;
+        d[0] = D[0] / l; d[1] = D[1] / l; d[2] = D[2] / l;
+    }
+
+    // 光線: [0] 主光線, [1] 射出瞳プローブ, [2..] 瞳の点
+    const size_t ray_count = (size_t)count + 2;
+    double* rays_in = (double*)malloc(ray_count * (RT10_RAY_IN_STRIDE + RT10_RAY_OUT_STRIDE) * sizeof(double));
+    int* status = (int*)malloc(ray_count * sizeof(int));
+    if (!rays_in || !status) {
+        free(rays_in);
+        free(status);
+        return -1;
+    }
+    double* rays_out = rays_in + ray_count * RT10_RAY_IN_STRIDE;
+
+    __rt10_opd_make_ray(params, d, 0.0, 0.0, rays_in);
+    {
+        // プローブ: 入射瞳中心を通り、主光線から少し傾けた光線（像空間で主光線と交わる点 = 射出瞳）
+        double pp[RT10_OPD_PARAMS];
+        for (int k = 0; k < RT10_OPD_PARAMS; k++) pp[k] = params[k];
+        const double* U = params + RT10_OPD_PUPIL_U;
+        const double ul = sqrt(U[0] * U[0] + U[1] * U[1] + U[2] * U[2]);
+        double pd[3] = { d[0], d[1], d[2] };
+        if (ul > 0.0) {
+            if ((int)params[RT10_OPD_MODE] == RT10_OPD_SOURCE_POINT) {
+                const double* C = params + RT10_OPD_PUPIL_C;
+                const double* O = params + RT10_OPD_SOURCE;
+                const double dist = sqrt((C[0] - O[0]) * (C[0] - O[0]) + (C[1] - O[1]) * (C[1] - O[1]) +
+                                         (C[2] - O[2]) * (C[2] - O[2]));
+                for (int k = 0; k < 3; k++) pp[RT10_OPD_SOURCE + k] += RT10_OPD_PROBE * dist * U[k] / ul;
+            } else {
+                for (int k = 0; k < 3; k++) pd[k] += RT10_OPD_PROBE * U[k] / ul;
+                const double l = sqrt(pd[0] * pd[0] + pd[1] * pd[1] + pd[2] * pd[2]);
+                for (int k = 0; k < 3; k++) pd[k] /= l;
+            }
+        }
+        __rt10_opd_make_ray(pp, pd, 0.0, 0.0, rays_in + RT10_RAY_IN_STRIDE);
+    }
+    for (int k = 0; k < count; k++) {
+        __rt10_opd_make_ray(params, d, uv[2 * k], uv[2 * k + 1], rays_in + (size_t)(k + 2) * RT10_RAY_IN_STRIDE);
+        opd_out[k] = 0.0;
+        ok_out[k] = 0;
+    }
+
+    // 像面の交点で止める（位置 = 像点, 方向・光路長 = 像空間に入った状態）
+    const int rc = trace_system_rt10(surfaces, surface_count, rays_in, (int)ray_count, wavelength_slot, n0,
+                                     last, RT10_TRACE_HIT_ONLY, rays_out, status, NULL);
+    if (rc < 0 || status[0] != RT10_STATUS_OK) {
+        free(rays_in);
+        free(status);
+        return rc < 0 ? -1 : -2;
+    }
+
+    const double nimg = __rt10_image_index(surfaces, last, wavelength_slot, n0);
+    const double* chief = rays_out;
+    const double P[3] = { chief[0], chief[1], chief[2] };
+    const double Dc[3] = { chief[3], chief[4], chief[5] };
+
+    // 参照球半径: 指定値 / 主光線とプローブの像空間直線の最接近点（射出瞳）までの距離 / 平面
+    double R = params[RT10_OPD_REF_RADIUS];
+    if (isfinite(R) && !(R > 0.0)) {
+        R = INFINITY;
+        const double* pr = rays_out + RT10_RAY_OUT_STRIDE;
+        if (status[1] == RT10_STATUS_OK) {
+            const double w[3] = { P[0] - pr[0], P[1] - pr[1], P[2] - pr[2] };
+            const double b = Dc[0] * pr[3] + Dc[1] * pr[4] + Dc[2] * pr[5];
+            const double dd = Dc[0] * w[0] + Dc[1] * w[1] + Dc[2] * w[2];
+            const double e = pr[3] * w[0] + pr[4] * w[1] + pr[5] * w[2];
+            const double den = 1.0 - b * b;
+            if (den > 1e-18) {
+                // 主光線上の最接近点 P + s·Dc（s < 0 なら像点より手前）
+                const double s = (b * e - dd) / den;
+                const double rr = fabs(s);
+                if (rr > 0.0 && rr <= RT10_OPD_MAX_RADIUS) R = rr;
+            }
+        }
+    }
+    const int plane = !isfinite(R);
+    const double chief_ref = chief[6] - (plane ? 0.0 : nimg * R);
+
+    int valid = 0;
+    for (int k = 0; k < count; k++) {
+        const size_t q = (size_t)k + 2;
+        if (status[q] != RT10_STATUS_OK) continue;
+        const double* X = rays_out + q * RT10_RAY_OUT_STRIDE;
+        const double f[3] = { X[0] - P[0], X[1] - P[1], X[2] - P[2] };
+        double t;
+        if (plane) {
+            // 主光線に垂直で P を通る平面
+            const double den = X[3] * Dc[0] + X[4] * Dc[1] + X[5] * Dc[2];
+            if (!(fabs(den) > 1e-12)) continue;
+            t = -(f[0] * Dc[0] + f[1] * Dc[1] + f[2] * Dc[2]) / den;
+        } else {
+            const double b = f[0] * X[3] + f[1] * X[4] + f[2] * X[5];
+            const double cc = f[0] * f[0] + f[1] * f[1] + f[2] * f[2] - R * R;
+            const double disc = b * b - cc;
+            if (!(disc >= 0.0)) continue;
+            t = -b - sqrt(disc);  // 瞳側（t ≈ -R）の交点
+        }
+        const double opd = (X[6] + nimg * t - chief_ref) * RT10_OPD_UM_PER_MM;
+        if (!isfinite(opd)) continue;
+        opd_out[k] = opd;
+        ok_out[k] = 1;
+        valid++;
+    }
+
+    if (info_out) {
+        info_out[RT10_OPD_INFO_IMAGE] = P[0];
+        info_out[RT10_OPD_INFO_IMAGE + 1] = P[1];
+        info_out[RT10_OPD_INFO_IMAGE + 2] = P[2];
+        info_out[RT10_OPD_INFO_RADIUS] = R;
+        info_out[RT10_OPD_INFO_N_IMAGE] = nimg;
+        info_out[RT10_OPD_INFO_CHIEF_OPL] = chief[6];
+        info_out[RT10_OPD_INFO_VALID] = (double)valid;
+    }
+    free(rays_in);
+    free(status);
+    return valid;
+}
+
+/**
+ * 瞳格子の OPD（参照球で閉じる）
+ *
+ * @param surfaces 面テーブル（最終面 = 像面, trace_system_rt10 と同じ）
+ * @param params RT10_OPD_PARAMS 個（RT10_OPD_* のオフセット）
+ * @param grid_size 格子の一辺
+ * @param wavelength_slot 屈折率スロット
+ * @param n0 入射側媒質の屈折率
+ * @param grid_opd 出力 OPD（grid_size², µm, 主光線 = 0）
+ * @param pupil_mask 出力マスク（grid_size², 0/1）
+ * @param info_out RT10_OPD_INFO_FIELDS 個（NULL 可）
+ * @return 有効な格子点数 / -1: 引数不正・メモリ不足 / -2: 主光線が像面に届かない
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_opd_grid_rt10(const double* surfaces, int surface_count, const double* params,
+                        int grid_size, int wavelength_slot, double n0,
+                        double* grid_opd, int* pupil_mask, double* info_out) {
+    if (!surfaces || !params || !grid_opd || !pupil_mask) return -1;
+    if (surface_count < 2 || grid_size <= 0) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    const int n = grid_size;
+    const size_t total = (size_t)n * n;
+    for (size_t q = 0; q < total; q++) {
+        grid_opd[q] = 0.0;
+        pupil_mask[q] = 0;
+    }
+
+    // 瞳内の格子点だけを (u, v) の列にして追跡し、index で格子位置へ戻す
+    size_t inside = 0;
+    const double c = 0.5 * (n - 1);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            const double u = c > 0.0 ? (j - c) / c : 0.0, v = c > 0.0 ? (i - c) / c : 0.0;
+            if (u * u + v * v <= 1.0) inside++;
+        }
+    }
+    double* uv = (double*)malloc(inside * 3 * sizeof(double));
+    int* index = (int*)malloc(inside * 2 * sizeof(int));
+    if (!uv || !index) {
+        free(uv);
+        free(index);
+        return -1;
+    }
+    double* opd = uv + inside * 2;
+    int* ok = index + inside;
+    size_t r = 0;
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            const double u = c > 0.0 ? (j - c) / c : 0.0, v = c > 0.0 ? (i - c) / c : 0.0;
+            if (u * u + v * v > 1.0) continue;
+            uv[2 * r] = u;
+            uv[2 * r + 1] = v;
+            index[r] = i * n + j;
+            r++;
+        }
+    }
+
+    const int valid = __rt10_opd_trace(surfaces, surface_count, params, uv, (int)inside, wavelength_slot, n0,
+                                       opd, ok, info_out);
+    if (valid >= 0) {
+        for (size_t k = 0; k < inside; k++) {
+            if (!ok[k]) continue;
+            grid_opd[index[k]] = opd[k];
+            pupil_mask[index[k]] = 1;
+        }
+    }
+    free(uv);
+    free(index);
+    return valid;
+}
+
+/**
+ * 任意の瞳座標の OPD（trace_opd_grid_rt10 と同じ参照球・同じ値, 適応サンプリング用）
+ *
+ * 格子の代わりに (u, v) の列を受け取る。瞳外（u² + v² > 1）の点も追跡する（判定は呼び出し側）。
+ *
+ * @param uv 瞳座標（count × 2, u, v の順）
+ * @param count 点数
+ * @param opd_out 出力 OPD（count, µm, 主光線 = 0, 無効な点は 0）
+ * @param valid_out 出力（count, 0/1）
+ * @param info_out RT10_OPD_INFO_FIELDS 個（NULL 可）
+ * @return 有効な点数 / -1: 引数不正・メモリ不足 / -2: 主光線が像面に届かない
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_opd_points_rt10(const double* surfaces, int surface_count, const double* params,
+                          const double* uv, int count, int wavelength_slot, double n0,
+                          double* opd_out, int* valid_out, double* info_out) {
+    if (!surfaces || !params || !uv || !opd_out || !valid_out) return -1;
+    if (surface_count < 2 || count < 0) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    return __rt10_opd_trace(surfaces, surface_count, params, uv, count, wavelength_slot, n0,
+                            opd_out, valid_out, info_out);
+}
+
+/*
+ * =============================================================================
+ * スポット統計のストリーミング追跡（trace_spot_rt10）
+ * =============================================================================
+ *
+ * 瞳サンプリング（optical/ray-renderer.js の generateAnnularOffsets / generateCenteredGridOffsets と
+ * 同じ規則）から光線を固定サイズのチャンクごとに生成・追跡し、評価面ローカル座標の交点を
+ * Welford 更新で集計する。全点の配列は作らない（points_out を渡したときだけ間引いた点を残す）。
+ *
+ *   始点  = ORIGIN + ou·START_U + ov·START_V     （点光源は START_U = START_V = 0）
+ *   方向  = DIR（平行）/ normalize(TARGET + ou·TARGET_U + ov·TARGET_V - 始点)（AIM = 1, 絞り面を狙う）
+ *   (ou, ov) = 瞳オフセット（HALF_EXTENT 込み, レンズ単位）
+ *
+ * rays_in を渡すと瞳パターンの代わりにその光線（[begin, end) 分, RT10_RAY_IN_STRIDE）を使う
+ * （JS 側の generateRayStartPointsForSpot の結果そのもの。絞り面への原点解などを含めて一致させたい場合）。
+ *
+ * 光線 0 を主光線とし、RMS_CHIEF / GEO_CHIEF は主光線の交点基準（merit-function-editor.js の
+ * SPOT_SIZE_* と同じ定義）、RMS_X / RMS_Y / RMS は重心基準。begin = 0 の呼び出しで state を初期化するので、
+ * [0, n) を 1 回で追跡しても、[0, k), [k, n) ... と分けて呼んで途中経過を表示しても結果は同じ。
+ */
+#define RT10_SPOT_PATTERN      0   // RT10_SPOT_PATTERN_*（rays_in を渡した場合は無視）
+#define RT10_SPOT_RAY_COUNT    1   // 全光線数（間引きの間隔もこれで決まる）
+#define RT10_SPOT_RINGS        2   // 輪帯数（ANNULAR, < 1 は 1）
+#define RT10_SPOT_HALF_EXTENT  3   // 瞳オフセットの最大半径 / 格子の半幅
+#define RT10_SPOT_ORIGIN       4   // 始点の中心（グローバル, 4..6）
+#define RT10_SPOT_START_U      7   // オフセット u 方向（単位ベクトル, 7..9）
+#define RT10_SPOT_START_V      10  // オフセット v 方向（10..12）
+#define RT10_SPOT_DIR          13  // 平行光の方向（13..15）
+#define RT10_SPOT_AIM          16  // 0: DIR で平行 / 1: TARGET 平面の対応点を狙う
+#define RT10_SPOT_TARGET       17  // 狙う平面の中心（17..19）
+#define RT10_SPOT_TARGET_U     20  // 20..22
+#define RT10_SPOT_TARGET_V     23  // 23..25
+#define RT10_SPOT_CHUNK        26  // 1 回の追跡に渡す光線数（<= 0 で RT10_SPOT_DEFAULT_CHUNK）
+#define RT10_SPOT_MAX_POINTS   27  // points_out に残す最大点数（0 = 統計のみ）
+#define RT10_SPOT_PARAMS       28
+
+#define RT10_SPOT_PATTERN_ANNULAR 0
+#define RT10_SPOT_PATTERN_GRID    1
+
+// state（呼び出し間で引き継ぐ累積値）
+#define RT10_SPOT_ACC_N          0
+#define RT10_SPOT_ACC_MEAN_X     1
+#define RT10_SPOT_ACC_MEAN_Y     2
+#define RT10_SPOT_ACC_M2_X       3
+#define RT10_SPOT_ACC_M2_Y       4
+#define RT10_SPOT_ACC_CHIEF_X    5
+#define RT10_SPOT_ACC_CHIEF_Y    6
+#define RT10_SPOT_ACC_CHIEF_OK   7   // 1: 主光線が評価面に届いた
+#define RT10_SPOT_ACC_GEO2       8   // 主光線基準の最大距離²
+#define RT10_SPOT_ACC_RAYS       9   // 追跡した光線数
+#define RT10_SPOT_ACC_FAIL       10  // RT10_STATUS_MISS..INVALID 別の失敗数（10..13）
+#define RT10_SPOT_ACC_POINTS     14  // points_out に書いた点数
+#define RT10_SPOT_STATE          15
+
+// stats_out
+#define RT10_SPOT_STAT_HITS       0
+#define RT10_SPOT_STAT_RAYS       1
+#define RT10_SPOT_STAT_CENTROID_X 2
+#define RT10_SPOT_STAT_CENTROID_Y 3
+#define RT10_SPOT_STAT_RMS_X      4   // 重心基準
+#define RT10_SPOT_STAT_RMS_Y      5
+#define RT10_SPOT_STAT_RMS        6
+#define RT10_SPOT_STAT_CHIEF_X    7   // 主光線の交点（届かなければ NaN）
+#define RT10_SPOT_STAT_CHIEF_Y    8
+#define RT10_SPOT_STAT_RMS_CHIEF  9   // 主光線基準
+#define RT10_SPOT_STAT_GEO_CHIEF  10  // 主光線基準の最大半径
+#define RT10_SPOT_STAT_FAIL       11  // 失敗数（11..14, RT10_SPOT_ACC_FAIL と同じ並び）
+#define RT10_SPOT_STAT_POINTS     15
+#define RT10_SPOT_STATS           16
+
+// points_out（1 点あたり）
+#define RT10_SPOT_POINT_LOCAL    0   // 評価面ローカルの交点（0..2）
+#define RT10_SPOT_POINT_GLOBAL   3   // グローバルの交点（3..5）
+#define RT10_SPOT_POINT_RAY      6   // 光線インデックス
+#define RT10_SPOT_POINT_FIELDS   7
+
+#define RT10_SPOT_DEFAULT_CHUNK  1024
+#define RT10_SPOT_TWO_PI         6.283185307179586   // 2 * Math.PI（JS と同じ double）
+
+EMSCRIPTEN_KEEPALIVE int rt10_spot_params(void) { return RT10_SPOT_PARAMS; }
+EMSCRIPTEN_KEEPALIVE int rt10_spot_state_fields(void) { return RT10_SPOT_STATE; }
+EMSCRIPTEN_KEEPALIVE int rt10_spot_stats_fields(void) { return RT10_SPOT_STATS; }
+EMSCRIPTEN_KEEPALIVE int rt10_spot_point_fields(void) { return RT10_SPOT_POINT_FIELDS; }
+
+/*
+ * generateAnnularOffsets: 中心 1 点 + 輪帯 k（半径 h·(k+1)/rings）に max(4, ⌊残り / 残り輪帯数⌋) 本。
+ * 輪帯の先頭インデックスが決まれば、光線 i のオフセットは輪帯表から直接求まる。
+ */
+typedef struct {
+    int first;      // 輪帯の先頭の光線インデックス
+    int angles;     // 角度分割数（最後の輪帯は途中で打ち切られることがある）
+    double radius;
+    double start;   // 偶数輪帯 0, 奇数輪帯 半ステップ
+} rt10_spot_ring;
+
+static int __rt10_spot_rings(int ray_count, int ring_count, double half, rt10_spot_ring* rings) {
+    const int n = ring_count < ray_count ? ring_count : ray_count;
+    const double step = n > 0 ? half / n : half;
+    int left = ray_count - 1;
+    int first = 1;
+    int used = 0;
+    for (int k = 0; k < n && left > 0; k++) {
+        const int per = left / (n - k);
+        const int angles = per > 4 ? per : 4;
+        const double angle_step = RT10_SPOT_TWO_PI / angles;
+        rings[used].first = first;
+        rings[used].angles = angles;
+        rings[used].radius = step * (k + 1);
+        rings[used].start = (k % 2 == 0) ? 0 : angle_step / 2;
+        used++;
+        const int emit = angles < left ? angles : left;
+        first += emit;
+        left -= emit;
+    }
+    return used;
+}
+
+static void __rt10_spot_annular(const rt10_spot_ring* rings, int ring_used, int i, double* ou, double* ov) {
+    if (i == 0 || ring_used == 0) {
+        *ou = 0.0;
+        *ov = 0.0;
+        return;
+    }
+    int k = ring_used - 1;
+    while (k > 0 && rings[k].first > i) k--;
+    const rt10_spot_ring* R = rings + k;
+    const double angle = R->start + (i - R->first) * (RT10_SPOT_TWO_PI / R->angles);
+    *ou = R->radius * cos(angle);
+    *ov = R->radius * sin(angle);
+}
+
+/*
+ * generateCenteredGridOffsets: 奇数 g × g 格子を中心からの層 L（チェビシェフ距離）順に並べ、
+ * 層内は (|u|, |v|, u, v) の昇順。層 L の 8L 点を閉じた式で列挙する（a = |u|, b = |v|, 格子単位）:
+ *   a = 0:        (0, -L) (0, L)
+ *   a = 1..L-1:   (-a, -L) (-a, L) (a, -L) (a, L)
+ *   a = L, b = 0: (-L, 0) (L, 0)
+ *   a = L, b > 0: (-L, -b) (-L, b) (L, -b) (L, b)
+ * 最後の層が一部しか入らない場合は JS と同様に対称な組（|u|, |v| が同じ 2 点 / 4 点）単位で詰める。
+ * JS は組を要素数 → 文字列キーの localeCompare で並べるが、ここでは要素数 → a → b の数値順に並べる
+ * （層を埋めきらない光線数では選ばれる組が JS と異なることがある。一致が必要なら rays_in を使う）。
+ */
+static void __rt10_spot_grid_layer(int L, int p, int* iu, int* iv) {
+    if (L == 0) {
+        *iu = 0;
+        *iv = 0;
+        return;
+    }
+    if (p < 2) {
+        *iu = 0;
+        *iv = p == 0 ? -L : L;
+        return;
+    }
+    p -= 2;
+    if (p < 4 * (L - 1)) {
+        const int a = 1 + p / 4, q = p % 4;
+        *iu = q < 2 ? -a : a;
+        *iv = (q % 2 == 0) ? -L : L;
+        return;
+    }
+    p -= 4 * (L - 1);
+    if (p < 2) {
+        *iu = p == 0 ? -L : L;
+        *iv = 0;
+        return;
+    }
+    p -= 2;
+    const int b = 1 + p / 4, q = p % 4;
+    *iu = q < 2 ? -L : L;
+    *iv = (q % 2 == 0) ? -b : b;
+}
+
+// 一部だけ入る層 L の p 番目（need 点のうち）: 2 点組 (0, L), (L, 0) → 4 点組 a = 1..L-1 (b = L), b = 1..L (a = L)
+static void __rt10_spot_grid_partial(int L, int need, int p, int* iu, int* iv) {
+    // 2 点組から入る分だけ取る（need が奇数なら 1 点余る → 4 点組の選び方で端数が出ないよう JS 同様に捨てる）
+    const int pairs = need >= 4 ? 2 : need / 2;
+    if (p < pairs * 2) {
+        const int g = p / 2, s = p % 2;
+        *iu = g == 0 ? 0 : (s == 0 ? -L : L);
+        *iv = g == 0 ? (s == 0 ? -L : L) : 0;
+        return;
+    }
+    p -= pairs * 2;
+    const int g = p / 4, q = p % 4;
+    int a, b;
+    if (g < L - 1) {
+        a = 1 + g;
+        b = L;
+    } else {
+        a = L;
+        b = 1 + (g - (L - 1));
+    }
+    // (a, b) の 4 点を (u, v) の昇順で
+    *iu = q < 2 ? -a : a;
+    *iv = (q % 2 == 0) ? -b : b;
+}
+
+typedef struct {
+    int pattern;
+    int count;       // 生成できる光線数
+    double half;
+    // ANNULAR
+    rt10_spot_ring* rings;
+    int ring_used;
+    // GRID
+    int grid;        // 一辺 g
+    double spacing;
+    int full_layers; // 完全に入る層の数
+    int partial;     // 最後の層に入る点数
+} rt10_spot_pattern;
+
+static void __rt10_spot_offset(const rt10_spot_pattern* P, int i, double* ou, double* ov) {
+    if (P->pattern == RT10_SPOT_PATTERN_ANNULAR) {
+        __rt10_spot_annular(P->rings, P->ring_used, i, ou, ov);
+        return;
+    }
+    if (P->grid <= 1) {
+        *ou = 0.0;
+        *ov = 0.0;
+        return;
+    }
+    int iu, iv;
+    // 層 L までの点数 (2L+1)²
+    int L = 0;
+    while ((2 * L + 1) * (2 * L + 1) <= i) L++;
+    const int p = i - (2 * L - 1) * (2 * L - 1) * (L > 0);
+    if (L < P->full_layers) __rt10_spot_grid_layer(L, p, &iu, &iv);
+    else __rt10_spot_grid_partial(L, P->partial, p, &iu, &iv);
+    *ou = iu * P->spacing;
+    *ov = iv * P->spacing;
+}
+
+static void __rt10_spot_make_ray(const double* p, const rt10_spot_pattern* P, int i, double* ray) {
+    double ou, ov;
+    __rt10_spot_offset(P, i, &ou, &ov);
+    const double* O = p + RT10_SPOT_ORIGIN;
+    const double* U = p + RT10_SPOT_START_U;
+    const double* V = p + RT10_SPOT_START_V;
+    ray[0] = O[0] + ou * U[0] + ov * V[0];
+    ray[1] = O[1] + ou * U[1] + ov * V[1];
+    ray[2] = O[2] + ou * U[2] + ov * V[2];
+    if ((int)p[RT10_SPOT_AIM] == 1) {
+        const double* T = p + RT10_SPOT_TARGET;
+        const double* TU = p + RT10_SPOT_TARGET_U;
+        const double* TV = p + RT10_SPOT_TARGET_V;
+        const double dx = T[0] + ou * TU[0] + ov * TV[0] - ray[0];
+        const double dy = T[1] + ou * TU[1] + ov * TV[1] - ray[1];
+        const double dz = T[2] + ou * TU[2] + ov * TV[2] - ray[2];
+        double l = sqrt(dx * dx + dy * dy + dz * dz);
+        if (!(l > 0.0)) l = 1.0;
+        ray[3] = dx / l; ray[4] = dy / l; ray[5] = dz / l;
+    } else {
+        ray[3] = p[RT10_SPOT_DIR]; ray[4] = p[RT10_SPOT_DIR + 1]; ray[5] = p[RT10_SPOT_DIR + 2];
+    }
+}
+
+static void __rt10_spot_stats(const double* st, double* out) {
+    const double n = st[RT10_SPOT_ACC_N];
+    const double vx = n > 0 ? st[RT10_SPOT_ACC_M2_X] / n : NAN;
+    const double vy = n > 0 ? st[RT10_SPOT_ACC_M2_Y] / n : NAN;
+    const int chief = st[RT10_SPOT_ACC_CHIEF_OK] > 0;
+    out[RT10_SPOT_STAT_HITS] = n;
+    out[RT10_SPOT_STAT_RAYS] = st[RT10_SPOT_ACC_RAYS];
+    out[RT10_SPOT_STAT_CENTROID_X] = n > 0 ? st[RT10_SPOT_ACC_MEAN_X] : NAN;
+    out[RT10_SPOT_STAT_CENTROID_Y] = n > 0 ? st[RT10_SPOT_ACC_MEAN_Y] : NAN;
+    out[RT10_SPOT_STAT_RMS_X] = sqrt(vx);
+    out[RT10_SPOT_STAT_RMS_Y] = sqrt(vy);
+    out[RT10_SPOT_STAT_RMS] = sqrt(vx + vy);
+    out[RT10_SPOT_STAT_CHIEF_X] = chief ? st[RT10_SPOT_ACC_CHIEF_X] : NAN;
+    out[RT10_SPOT_STAT_CHIEF_Y] = chief ? st[RT10_SPOT_ACC_CHIEF_Y] : NAN;
+    if (chief && n > 0) {
+        // Σ|p - c|² / n = 分散 + |重心 - c|²
+        const double ex = st[RT10_SPOT_ACC_MEAN_X] - st[RT10_SPOT_ACC_CHIEF_X];
+        const double ey = st[RT10_SPOT_ACC_MEAN_Y] - st[RT10_SPOT_ACC_CHIEF_Y];
+        out[RT10_SPOT_STAT_RMS_CHIEF] = sqrt(vx + vy + ex * ex + ey * ey);
+        out[RT10_SPOT_STAT_GEO_CHIEF] = sqrt(st[RT10_SPOT_ACC_GEO2]);
+    } else {
+        out[RT10_SPOT_STAT_RMS_CHIEF] = NAN;
+        out[RT10_SPOT_STAT_GEO_CHIEF] = NAN;
+    }
+    for (int k = 0; k < 4; k++) out[RT10_SPOT_STAT_FAIL + k] = st[RT10_SPOT_ACC_FAIL + k];
+    out[RT10_SPOT_STAT_POINTS] = st[RT10_SPOT_ACC_POINTS];
+}
+
+/**
+ * スポット統計（チャンク追跡 + Welford 集計）
+ *
+ * @param surfaces 面テーブル（trace_system_rt10 と同じ）
+ * @param target_surface 評価面（交点で止める。ローカル座標はこの面の ORIGIN / ROT 基準）
+ * @param params RT10_SPOT_PARAMS 個（RT10_SPOT_* のオフセット）
+ * @param rays_in NULL: params の瞳パターンから生成 / 非 NULL: 光線 begin..end-1（(end - begin) × RT10_RAY_IN_STRIDE）
+ * @param begin, end 今回追跡する光線インデックスの範囲（begin = 0 で state を初期化）
+ * @param state RT10_SPOT_STATE 個（呼び出し間で保持する）
+ * @param points_out MAX_POINTS × RT10_SPOT_POINT_FIELDS（NULL 可）。光線インデックスが
+ *                   ⌈RAY_COUNT / MAX_POINTS⌉ の倍数の点を、評価面に届いたものだけ追記する（主光線は必ず含む）
+ * @param stats_out RT10_SPOT_STATS 個（NULL 可）。ここまでの累積値から求めた統計
+ * @return 今回の呼び出しで評価面に届いた光線数 / -1: 引数不正・メモリ不足
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_spot_rt10(const double* surfaces, int surface_count, int target_surface,
+                    const double* params, const double* rays_in, int begin, int end,
+                    int wavelength_slot, double n0,
+                    double* state, double* points_out, double* stats_out) {
+    if (!surfaces || !params || !state) return -1;
+    if (surface_count <= 0 || target_surface < 0 || target_surface >= surface_count) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    const int ray_count = (int)params[RT10_SPOT_RAY_COUNT];
+    if (ray_count <= 0 || begin < 0 || end < begin || end > ray_count) return -1;
+
+    rt10_spot_pattern P;
+    P.pattern = (int)params[RT10_SPOT_PATTERN];
+    P.count = ray_count;
+    P.half = params[RT10_SPOT_HALF_EXTENT];
+    P.rings = NULL;
+    P.ring_used = 0;
+    P.grid = 1;
+    P.spacing = 0.0;
+    P.full_layers = 0;
+    P.partial = 0;
+    if (!rays_in) {
+        if (P.pattern == RT10_SPOT_PATTERN_ANNULAR) {
+            int rc = (int)params[RT10_SPOT_RINGS];
+            if (rc < 1) rc = 1;
+            const int n = rc < ray_count ? rc : ray_count;
+            P.rings = (rt10_spot_ring*)malloc((size_t)(n > 0 ? n : 1) * sizeof(rt10_spot_ring));
+            if (!P.rings) return -1;
+            P.ring_used = __rt10_spot_rings(ray_count, rc, P.half, P.rings);
+        } else if (P.pattern == RT10_SPOT_PATTERN_GRID) {
+            int g = (int)ceil(sqrt((double)ray_count));
+            if (g < 1) g = 1;
+            if (g % 2 == 0) g += 1;
+            P.grid = g;
+            P.spacing = g > 1 ? (2 * P.half) / (g - 1) : 0.0;
+            // 完全に入る層: (2L+1)² <= ray_count, 残りは次の層に
+            int L = 0;
+            while ((2 * L + 3) * (2 * L + 3) <= ray_count) L++;
+            P.full_layers = L + 1;
+            P.partial = ray_count - (2 * L + 1) * (2 * L + 1);
+            // 対称な組で詰められる点数（2 点組 ×2, 4 点組 × (2L + 1)）に丸め、残りは生成しない
+            {
+                const int NL = L + 1;
+                const int pairs = P.partial >= 4 ? 2 : P.partial / 2;
+                const int quads = (P.partial - pairs * 2) / 4;
+                const int max_quads = 2 * NL - 1;
+                P.partial = pairs * 2 + 4 * (quads < max_quads ? quads : max_quads);
+            }
+            P.count = (2 * L + 1) * (2 * L + 1) + P.partial;
+        } else {
+            return -1;
+        }
+    }
+
+    if (begin == 0) {
+        for (int k = 0; k < RT10_SPOT_STATE; k++) state[k] = 0.0;
+        state[RT10_SPOT_ACC_CHIEF_X] = NAN;
+        state[RT10_SPOT_ACC_CHIEF_Y] = NAN;
+    }
+    const int gen_end = end < P.count ? end : P.count;
+
+    int chunk = (int)params[RT10_SPOT_CHUNK];
+    if (chunk <= 0) chunk = RT10_SPOT_DEFAULT_CHUNK;
+    const int span = gen_end > begin ? gen_end - begin : 0;
+    if (chunk > span) chunk = span > 0 ? span : 1;
+    double* in = (double*)malloc((size_t)chunk * (RT10_RAY_IN_STRIDE + RT10_RAY_OUT_STRIDE) * sizeof(double));
+    int* status = (int*)malloc((size_t)chunk * sizeof(int));
+    if (!in || !status) {
+        free(in);
+        free(status);
+        free(P.rings);
+        return -1;
+    }
+    double* out = in + (size_t)chunk * RT10_RAY_IN_STRIDE;
+
+    const double* T = surfaces + (size_t)target_surface * RT10_SURF_STRIDE;
+    const double* TO = T + RT10_SURF_ORIGIN;
+    const double* M = T + RT10_SURF_ROT;
+    const int max_points = points_out ? (int)params[RT10_SPOT_MAX_POINTS] : 0;
+    const int decimate = max_points > 0 ? (ray_count + max_points - 1) / max_points : 0;
+
+    int hits = 0;
+    for (int b = begin; b < gen_end; b += chunk) {
+        const int m = (gen_end - b) < chunk ? (gen_end - b) : chunk;
+        const double* src = in;
+        if (rays_in) {
+            src = rays_in + (size_t)(b - begin) * RT10_RAY_IN_STRIDE;
+        } else {
+            for (int k = 0; k < m; k++) __rt10_spot_make_ray(params, &P, b + k, in + (size_t)k * RT10_RAY_IN_STRIDE);
+        }
+        const int rc = trace_system_rt10(surfaces, surface_count, src, m, wavelength_slot, n0,
+                                         target_surface, RT10_TRACE_HIT_ONLY, out, status, NULL);
+        if (rc < 0) {
+            hits = -1;
+            break;
+        }
+        state[RT10_SPOT_ACC_RAYS] += m;
+
+        for (int k = 0; k < m; k++) {
+            const int i = b + k;
+            const int s = status[k];
+            if (s != RT10_STATUS_OK) {
+                if (s >= RT10_STATUS_MISS && s <= RT10_STATUS_INVALID) state[RT10_SPOT_ACC_FAIL + s - RT10_STATUS_MISS] += 1.0;
+                continue;
+            }
+            const double* X = out + (size_t)k * RT10_RAY_OUT_STRIDE;
+            // グローバル → 評価面ローカル（transformPointToLocal と同じ R(s)^T）
+            const double rx = X[0] - TO[0], ry = X[1] - TO[1], rz = X[2] - TO[2];
+            const double lx = M[0] * rx + M[3] * ry + M[6] * rz;
+            const double ly = M[1] * rx + M[4] * ry + M[7] * rz;
+            if (!isfinite(lx) || !isfinite(ly)) {
+                state[RT10_SPOT_ACC_FAIL + RT10_STATUS_INVALID - RT10_STATUS_MISS] += 1.0;
+                continue;
+            }
+            if (i == 0) {
+                state[RT10_SPOT_ACC_CHIEF_X] = lx;
+                state[RT10_SPOT_ACC_CHIEF_Y] = ly;
+                state[RT10_SPOT_ACC_CHIEF_OK] = 1.0;
+            }
+
+            // Welford
+            const double n = state[RT10_SPOT_ACC_N] + 1.0;
+            const double dx = lx - state[RT10_SPOT_ACC_MEAN_X];
+            const double dy = ly - state[RT10_SPOT_ACC_MEAN_Y];
+            state[RT10_SPOT_ACC_N] = n;
+            state[RT10_SPOT_ACC_MEAN_X] += dx / n;
+            state[RT10_SPOT_ACC_MEAN_Y] += dy / n;
+            state[RT10_SPOT_ACC_M2_X] += dx * (lx - state[RT10_SPOT_ACC_MEAN_X]);
+            state[RT10_SPOT_ACC_M2_Y] += dy * (ly - state[RT10_SPOT_ACC_MEAN_Y]);
+            if (state[RT10_SPOT_ACC_CHIEF_OK] > 0) {
+                const double cx = lx - state[RT10_SPOT_ACC_CHIEF_X];
+                const double cy = ly - state[RT10_SPOT_ACC_CHIEF_Y];
+                const double r2 = cx * cx + cy * cy;
+                if (r2 > state[RT10_SPOT_ACC_GEO2]) state[RT10_SPOT_ACC_GEO2] = r2;
+            }
+            hits++;
+
+            if (decimate > 0 && i % decimate == 0 && (int)state[RT10_SPOT_ACC_POINTS] < max_points) {
+                double* q = points_out + (size_t)state[RT10_SPOT_ACC_POINTS] * RT10_SPOT_POINT_FIELDS;
+                q[RT10_SPOT_POINT_LOCAL] = lx;
+                q[RT10_SPOT_POINT_LOCAL + 1] = ly;
+                q[RT10_SPOT_POINT_LOCAL + 2] = M[2] * rx + M[5] * ry + M[8] * rz;
+                q[RT10_SPOT_POINT_GLOBAL] = X[0];
+                q[RT10_SPOT_POINT_GLOBAL + 1] = X[1];
+                q[RT10_SPOT_POINT_GLOBAL + 2] = X[2];
+                q[RT10_SPOT_POINT_RAY] = i;
+                state[RT10_SPOT_ACC_POINTS] += 1.0;
+            }
+        }
+    }
+
+    free(in);
+    free(status);
+    free(P.rings);
+    if (stats_out) __rt10_spot_stats(state, stats_out);
+    return hits;
+}
+
+/**
+ * 光線追跡のスレッド数設定（呼び出しスレッドを含む総数, <= 0 で論理コア数）
+ * 単一スレッド版では常に 1 を返す。
+ */
+EMSCRIPTEN_KEEPALIVE
+int rt10_set_thread_count(int threads) {
+    return coopt_pool_init(threads);
+}
+
+EMSCRIPTEN_KEEPALIVE
+int rt10_get_thread_count(void) {
+    return coopt_pool_thread_count();
+}
+
+/*
+ * =============================================================================
+ * SoA 光線バンドル + SIMD128 カーネル
+ * =============================================================================
+ *
+ * 光線バンドルは 1 本のバッファに各成分を別配列として並べる（Structure of Arrays）:
+ *   base + f * capacity  (f = RT10_BUNDLE_*)
+ * capacity は偶数であること（2 レーン単位で処理。余りレーンはマスクで無効化）。
+ *
+ * -msimd128 でビルドすると f64x2 の 2 レーンで処理する。SIMD 無しのビルド
+ * （ネイティブ検証など）では同じコードを 2 要素構造体でエミュレートする。
+ * 4×f32 レーンの精度切替は float32 プレビュー版（trace_bundle_rt10_f32）で扱う。
+ */
+#define RT10_BUNDLE_PX       0
+#define RT10_BUNDLE_PY       1
+#define RT10_BUNDLE_PZ       2
+#define RT10_BUNDLE_DX       3
+#define RT10_BUNDLE_DY       4
+#define RT10_BUNDLE_DZ       5
+#define RT10_BUNDLE_OPL      6
+#define RT10_BUNDLE_ALIVE    7   // 1.0: 追跡中 / 0.0: 終了（ケラレ・交点なし・全反射）
+#define RT10_BUNDLE_STATUS   8   // RT10_STATUS_*（double で格納）
+#define RT10_BUNDLE_FIELDS   9
+
+EMSCRIPTEN_KEEPALIVE int rt10_bundle_fields(void) { return RT10_BUNDLE_FIELDS; }
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+typedef v128_t rtv2;
+typedef v128_t rtm2;
+static inline rtv2 rtv_load(const double* p) { return wasm_v128_load(p); }
+static inline void rtv_store(double* p, rtv2 a) { wasm_v128_store(p, a); }
+static inline rtv2 rtv_splat(double a) { return wasm_f64x2_splat(a); }
+static inline rtv2 rtv_add(rtv2 a, rtv2 b) { return wasm_f64x2_add(a, b); }
+static inline rtv2 rtv_sub(rtv2 a, rtv2 b) { return wasm_f64x2_sub(a, b); }
+static inline rtv2 rtv_mul(rtv2 a, rtv2 b) { return wasm_f64x2_mul(a, b); }
+static inline rtv2 rtv_div(rtv2 a, rtv2 b) { return wasm_f64x2_div(a, b); }
+static inline rtv2 rtv_sqrt(rtv2 a) { return wasm_f64x2_sqrt(a); }
+static inline rtv2 rtv_abs(rtv2 a) { return wasm_f64x2_abs(a); }
+static inline rtv2 rtv_neg(rtv2 a) { return wasm_f64x2_neg(a); }
+static inline rtm2 rtv_lt(rtv2 a, rtv2 b) { return wasm_f64x2_lt(a, b); }
+static inline rtm2 rtv_gt(rtv2 a, rtv2 b) { return wasm_f64x2_gt(a, b); }
+static inline rtm2 rtv_le(rtv2 a, rtv2 b) { return wasm_f64x2_le(a, b); }
+static inline rtm2 rtv_ne(rtv2 a, rtv2 b) { return wasm_f64x2_ne(a, b); }
+static inline rtm2 rtm_and(rtm2 a, rtm2 b) { return wasm_v128_and(a, b); }
+static inline rtm2 rtm_or(rtm2 a, rtm2 b) { return wasm_v128_or(a, b); }
+static inline rtm2 rtm_andnot(rtm2 a, rtm2 b) { return wasm_v128_andnot(a, b); } // a & ~b
+static inline int rtm_any(rtm2 m) { return wasm_v128_any_true(m); }
+static inline int rtm_lane(rtm2 m, int lane) { return lane ? (wasm_i64x2_extract_lane(m, 1) != 0) : (wasm_i64x2_extract_lane(m, 0) != 0); }
+static inline rtm2 rtm_make(int l0, int l1) { return wasm_i64x2_make(l0 ? -1 : 0, l1 ? -1 : 0); }
+static inline rtv2 rtv_select(rtm2 m, rtv2 a, rtv2 b) { return wasm_v128_bitselect(a, b, m); } // m ? a : b
+static inline double rtv_lane(rtv2 a, int lane) { return lane ? wasm_f64x2_extract_lane(a, 1) : wasm_f64x2_extract_lane(a, 0); }
+static inline rtv2 rtv_make(double l0, double l1) { return wasm_f64x2_make(l0, l1); }
+#else
+typedef struct { double v[2]; } rtv2;
+typedef struct { int m[2]; } rtm2;
+static inline rtv2 rtv_make(double l0, double l1) { rtv2 r; r.v[0] = l0; r.v[1] = l1; return r; }
+static inline rtm2 rtm_make(int l0, int l1) { rtm2 r; r.m[0] = l0 != 0; r.m[1] = l1 != 0; return r; }
+static inline rtv2 rtv_load(const double* p) { return rtv_make(p[0], p[1]); }
+static inline void rtv_store(double* p, rtv2 a) { p[0] = a.v[0]; p[1] = a.v[1]; }
+static inline rtv2 rtv_splat(double a) { return rtv_make(a, a); }
+static inline rtv2 rtv_add(rtv2 a, rtv2 b) { return rtv_make(a.v[0] + b.v[0], a.v[1] + b.v[1]); }
+static inline rtv2 rtv_sub(rtv2 a, rtv2 b) { return rtv_make(a.v[0] - b.v[0], a.v[1] - b.v[1]); }
+static inline rtv2 rtv_mul(rtv2 a, rtv2 b) { return rtv_make(a.v[0] * b.v[0], a.v[1] * b.v[1]); }
+static inline rtv2 rtv_div(rtv2 a, rtv2 b) { return rtv_make(a.v[0] / b.v[0], a.v[1] / b.v[1]); }
+static inline rtv2 rtv_sqrt(rtv2 a) { return rtv_make(sqrt(a.v[0]), sqrt(a.v[1])); }
+static inline rtv2 rtv_abs(rtv2 a) { return rtv_make(fabs(a.v[0]), fabs(a.v[1])); }
+static inline rtv2 rtv_neg(rtv2 a) { return rtv_make(-a.v[0], -a.v[1]); }
+static inline rtm2 rtv_lt(rtv2 a, rtv2 b) { return rtm_make(a.v[0] < b.v[0], a.v[1] < b.v[1]); }
+static inline rtm2 rtv_gt(rtv2 a, rtv2 b) { return rtm_make(a.v[0] > b.v[0], a.v[1] > b.v[1]); }
+static inline rtm2 rtv_le(rtv2 a, rtv2 b) { return rtm_make(a.v[0] <= b.v[0], a.v[1] <= b.v[1]); }
+static inline rtm2 rtv_ne(rtv2 a, rtv2 b) { return rtm_make(a.v[0] != b.v[0], a.v[1] != b.v[1]); }
+static inline rtm2 rtm_and(rtm2 a, rtm2 b) { return rtm_make(a.m[0] && b.m[0], a.m[1] && b.m[1]); }
+static inline rtm2 rtm_or(rtm2 a, rtm2 b) { return rtm_make(a.m[0] || b.m[0], a.m[1] || b.m[1]); }
+static inline rtm2 rtm_andnot(rtm2 a, rtm2 b) { return rtm_make(a.m[0] && !b.m[0], a.m[1] && !b.m[1]); }
+static inline int rtm_any(rtm2 m) { return m.m[0] || m.m[1]; }
+static inline int rtm_lane(rtm2 m, int lane) { return m.m[lane]; }
+static inline rtv2 rtv_select(rtm2 m, rtv2 a, rtv2 b) { return rtv_make(m.m[0] ? a.v[0] : b.v[0], m.m[1] ? a.v[1] : b.v[1]); }
+static inline double rtv_lane(rtv2 a, int lane) { return a.v[lane]; }
+#endif
+
+static inline rtm2 rtv_isfinite(rtv2 a) {
+    // NaN/Inf 判定: |a| < +Inf（NaN は比較が偽）
+    return rtv_lt(rtv_abs(a), rtv_splat(INFINITY));
+}
+
+// 2 レーン分の光線状態（レジスタ上で保持）
+typedef struct {
+    rtv2 px, py, pz, dx, dy, dz, opl;
+    rtm2 alive;
+    rtv2 status;
+} rtv2_rays;
+
+static inline void __rtv_kill(rtv2_rays* R, rtm2 m, double status) {
+    m = rtm_and(m, R->alive);
+    R->status = rtv_select(m, rtv_splat(status), R->status);
+    R->alive = rtm_andnot(R->alive, m);
+}
+
+/** 2 レーンのサグ（ベース二次曲面 + 多項式, Horner 法） */
+static inline rtv2 __rtv_sag(rtv2 r, rtv2 r2, double radius, double conic, const double* c, int modeOdd) {
+    const rtv2 r2oR2 = rtv_div(r2, rtv_splat(radius * radius));
+    const rtv2 q = rtv_sub(rtv_splat(1.0), rtv_mul(rtv_splat(1.0 + conic), r2oR2));
+    const rtm2 ok = rtm_and(rtv_isfinite(q), rtv_le(rtv_splat(0.0), q));
+    const rtv2 base = rtv_div(r2, rtv_mul(rtv_splat(radius), rtv_add(rtv_splat(1.0), rtv_sqrt(rtv_select(ok, q, rtv_splat(0.0))))));
+    rtv2 p = rtv_splat(c[9]);
+    for (int i = 8; i >= 0; i--) p = rtv_add(rtv_splat(c[i]), rtv_mul(p, r2));
+    const rtv2 lead = modeOdd ? rtv_mul(r2, r) : rtv_mul(r2, r2);
+    const rtv2 out = rtv_add(base, rtv_mul(lead, p));
+    // aspheric_sag_rt10 と同じく、定義域外・非有限は 0
+    return rtv_select(rtm_and(ok, rtv_isfinite(out)), out, rtv_splat(0.0));
+}
+
+/** 2 レーンの dz/dr（ベース: c·r / sqrt(1-(1+k)c²r²)） */
+static inline rtv2 __rtv_dzdr(rtv2 r, rtv2 r2, double radius, double conic, const double* c, int modeOdd) {
+    const double cv = 1.0 / radius;
+    const rtv2 q = rtv_sub(rtv_splat(1.0), rtv_mul(rtv_splat((1.0 + conic) * cv * cv), r2));
+    const rtm2 ok = rtv_lt(rtv_splat(0.0), q);
+    const rtv2 base = rtv_select(ok, rtv_div(rtv_mul(rtv_splat(cv), r), rtv_sqrt(rtv_select(ok, q, rtv_splat(1.0)))), rtv_splat(cv));
+    // even: d/dr Σ c_i r^(2i+2) = r^3 Σ (2i+2) c_i r^(2i-2) / odd: r^2 Σ (2i+1) c_i r^(2i-2)
+    const double k0 = modeOdd ? 3.0 : 4.0;
+    rtv2 p = rtv_splat((k0 + 18.0) * c[9]);
+    for (int i = 8; i >= 0; i--) p = rtv_add(rtv_splat((k0 + 2.0 * i) * c[i]), rtv_mul(p, r2));
+    const rtv2 lead = modeOdd ? r2 : rtv_mul(r2, r);
+    return rtv_add(base, rtv_mul(lead, p));
+}
+
+/**
+ * 2 レーンのベース二次曲面交点（__rt10_intersect_quadric と同じ式・同じ根の選択）
+ * @param ok 有効な根を持つレーン
+ */
+static inline rtv2 __rtv_intersect_quadric(rtv2 ox, rtv2 oy, rtv2 oz, rtv2 dx, rtv2 dy, rtv2 dz,
+                                           double semidia, double radius, double conic, rtm2* ok) {
+    const rtv2 c = rtv_splat(1.0 / radius);
+    const rtv2 K = rtv_splat(1.0 + conic);
+    const rtv2 zero = rtv_splat(0.0);
+    const rtv2 A = rtv_mul(c, rtv_add(rtv_add(rtv_mul(dx, dx), rtv_mul(dy, dy)), rtv_mul(K, rtv_mul(dz, dz))));
+    const rtv2 B = rtv_sub(rtv_mul(c, rtv_add(rtv_add(rtv_mul(ox, dx), rtv_mul(oy, dy)), rtv_mul(K, rtv_mul(oz, dz)))), dz);
+    const rtv2 C = rtv_sub(rtv_mul(c, rtv_add(rtv_add(rtv_mul(ox, ox), rtv_mul(oy, oy)), rtv_mul(K, rtv_mul(oz, oz)))),
+                           rtv_mul(rtv_splat(2.0), oz));
+    const rtv2 D = rtv_sub(rtv_mul(B, B), rtv_mul(A, C));
+    const rtm2 hasRoot = rtv_le(zero, D);
+    const rtv2 sD = rtv_sqrt(rtv_select(hasRoot, D, zero));
+    const rtv2 q = rtv_neg(rtv_add(B, rtv_select(rtv_lt(B, zero), rtv_neg(sD), sD)));
+    const rtv2 roots[2] = { rtv_div(C, q), rtv_div(q, A) };
+    const rtv2 zmax = rtv_splat(1.0 + 1e-9);
+    const rtv2 Kc = rtv_mul(K, c);
+
+    rtm2 valid[2];
+    for (int i = 0; i < 2; i++) {
+        const rtv2 t = roots[i];
+        const rtv2 x = rtv_add(ox, rtv_mul(dx, t));
+        const rtv2 y = rtv_add(oy, rtv_mul(dy, t));
+        const rtv2 z = rtv_add(oz, rtv_mul(dz, t));
+        rtm2 v = rtm_and(hasRoot, rtm_and(rtv_isfinite(t), rtv_gt(t, zero)));
+        v = rtm_and(v, rtv_le(rtv_mul(Kc, z), zmax));
+        if (isfinite(semidia)) {
+            v = rtm_and(v, rtv_le(rtv_sqrt(rtv_add(rtv_mul(x, x), rtv_mul(y, y))), rtv_splat(semidia)));
+        }
+        valid[i] = v;
+    }
+    const rtm2 both = rtm_and(valid[0], valid[1]);
+    const rtv2 tmin = rtv_select(rtv_lt(roots[1], roots[0]), roots[1], roots[0]);
+    *ok = rtm_or(valid[0], valid[1]);
+    return rtv_select(both, tmin, rtv_select(valid[0], roots[0], roots[1]));
+}
+
+/**
+ * 2 レーンの曲面交点（ローカル座標）。
+ * 球面・コーニック（shape = RT10_SHAPE_SPHERE / CONIC）は閉形式で解く。
+ * 多項式非球面は SIMD Newton（初期値はベース二次曲面の解 → 近い側の球面解 → 平面解）で解き、
+ * 収束しなかったレーンだけスカラー版（__rt10_intersect_shaped → __rt10_intersect_fallback）で再探索する。
+ * @return t（交点なしのレーンは NaN）
+ */
+static inline rtv2 __rtv_intersect_curved(rtv2 ox, rtv2 oy, rtv2 oz, rtv2 dx, rtv2 dy, rtv2 dz,
+                                          rtm2 active, const double* S, int shape, int maxIter, double tol) {
+    const double radius = S[RT10_SURF_RADIUS];
+    const double conic = S[RT10_SURF_CONIC];
+    const double* coefs = S + RT10_SURF_COEF;
+    const int modeOdd = (int)S[RT10_SURF_MODE_ODD];
+    double semidia = S[RT10_SURF_SEMIDIA];
+    if (!(semidia > 0.0)) semidia = INFINITY;
+    const rtv2 zero = rtv_splat(0.0);
+
+    rtm2 done = rtm_make(0, 0);
+    rtv2 t;
+    if (shape == RT10_SHAPE_SPHERE || shape == RT10_SHAPE_CONIC) {
+        rtm2 ok;
+        t = __rtv_intersect_quadric(ox, oy, oz, dx, dy, dz, semidia, radius, conic, &ok);
+        done = rtm_and(active, ok);
+    } else {
+        // 初期値: ベース二次曲面の解、なければ球面近似（中心 z=R）の正の小さい方の解、なければ平面 z=0
+        rtm2 qOk;
+        const rtv2 tq = __rtv_intersect_quadric(ox, oy, oz, dx, dy, dz, INFINITY, radius, conic, &qOk);
+        const rtv2 A = rtv_add(rtv_add(rtv_mul(dx, dx), rtv_mul(dy, dy)), rtv_mul(dz, dz));
+        const rtv2 ozc = rtv_sub(oz, rtv_splat(radius));
+        const rtv2 B = rtv_mul(rtv_splat(2.0), rtv_add(rtv_add(rtv_mul(ox, dx), rtv_mul(oy, dy)), rtv_mul(ozc, dz)));
+        const rtv2 C = rtv_sub(rtv_add(rtv_add(rtv_mul(ox, ox), rtv_mul(oy, oy)), rtv_mul(ozc, ozc)), rtv_splat(radius * radius));
+        const rtv2 D = rtv_sub(rtv_mul(B, B), rtv_mul(rtv_mul(rtv_splat(4.0), A), C));
+        const rtm2 hasRoot = rtv_le(zero, D);
+        const rtv2 sD = rtv_sqrt(rtv_select(hasRoot, D, zero));
+        const rtv2 inv2A = rtv_div(rtv_splat(0.5), A);
+        const rtv2 t1 = rtv_mul(rtv_sub(rtv_neg(B), sD), inv2A);
+        const rtv2 t2 = rtv_mul(rtv_sub(sD, B), inv2A);
+        const rtv2 eps = rtv_splat(1e-10);
+        const rtv2 tPlane = rtv_div(rtv_neg(oz), dz);
+        t = rtv_select(rtm_and(hasRoot, rtv_gt(t1, eps)), t1,
+            rtv_select(rtm_and(hasRoot, rtv_gt(t2, eps)), t2, tPlane));
+        t = rtv_select(rtm_and(qOk, rtv_gt(tq, eps)), tq, t);
+        rtm2 run = rtm_and(active, rtm_and(rtv_isfinite(t), rtv_gt(t, eps)));
+
+        for (int it = 0; it < maxIter && rtm_any(run); it++) {
+            const rtv2 x = rtv_add(ox, rtv_mul(dx, t));
+            const rtv2 y = rtv_add(oy, rtv_mul(dy, t));
+            const rtv2 z = rtv_add(oz, rtv_mul(dz, t));
+            const rtv2 r2 = rtv_add(rtv_mul(x, x), rtv_mul(y, y));
+            const rtv2 r = rtv_sqrt(r2);
+            const rtv2 F = rtv_sub(z, __rtv_sag(r, r2, radius, conic, coefs, modeOdd));
+            const rtm2 conv = rtm_and(run, rtv_lt(rtv_abs(F), rtv_splat(tol)));
+            if (rt10_stats_on) __rt10_stat_newton(it, rtm_lane(conv, 0) + rtm_lane(conv, 1));
+            done = rtm_or(done, conv);
+            run = rtm_andnot(run, conv);
+            if (!rtm_any(run)) break;
+
+            const rtm2 rOk = rtv_gt(r, rtv_splat(1e-14));
+            const rtv2 drdt = rtv_select(rOk, rtv_div(rtv_add(rtv_mul(x, dx), rtv_mul(y, dy)), rtv_select(rOk, r, rtv_splat(1.0))), zero);
+            const rtv2 dzdr = rtv_select(rOk, __rtv_dzdr(r, r2, radius, conic, coefs, modeOdd), zero);
+            const rtv2 dFdt = rtv_sub(dz, rtv_mul(dzdr, drdt));
+            const rtm2 stepOk = rtm_and(rtv_isfinite(dFdt), rtv_gt(rtv_abs(dFdt), rtv_splat(1e-14)));
+            run = rtm_and(run, stepOk);
+            t = rtv_select(run, rtv_sub(t, rtv_div(F, rtv_select(stepOk, dFdt, rtv_splat(1.0)))), t);
+            run = rtm_and(run, rtm_and(rtv_isfinite(t), rtv_gt(t, zero)));
+        }
+
+        // semidia 外の解はスカラー版の初期値探索に回す（JS 版と同じ根を選ぶため）
+        if (isfinite(semidia)) {
+            const rtv2 x = rtv_add(ox, rtv_mul(dx, t));
+            const rtv2 y = rtv_add(oy, rtv_mul(dy, t));
+            const rtv2 r = rtv_sqrt(rtv_add(rtv_mul(x, x), rtv_mul(y, y)));
+            done = rtm_and(done, rtv_le(r, rtv_splat(semidia)));
+        }
+    }
+
+    double tl[2];
+    for (int lane = 0; lane < 2; lane++) {
+        tl[lane] = rtv_lane(t, lane);
+        if (!rtm_lane(active, lane)) { tl[lane] = NAN; continue; }
+        if (rtm_lane(done, lane)) continue;
+        const double lox = rtv_lane(ox, lane), loy = rtv_lane(oy, lane), loz = rtv_lane(oz, lane);
+        const double ldx = rtv_lane(dx, lane), ldy = rtv_lane(dy, lane), ldz = rtv_lane(dz, lane);
+        double ts = __rt10_intersect_shaped(shape, lox, loy, loz, ldx, ldy, ldz, semidia, radius, conic,
+                                            coefs, modeOdd, maxIter, tol);
+        if (!(ts > 0.0) || !isfinite(ts)) {
+            ts = __rt10_intersect_fallback(lox, loy, loz, ldx, ldy, ldz, semidia, radius, conic, coefs, modeOdd, maxIter, tol);
+        }
+        tl[lane] = ts;
+    }
+    return rtv_make(tl[0], tl[1]);
+}
+
+/** 2 レーンの局所法線（光線に対向する向き） */
+static inline void __rtv_normal(rtv2 hx, rtv2 hy, rtv2 dx, rtv2 dy, rtv2 dz, const double* S,
+                                rtv2* nx, rtv2* ny, rtv2* nz) {
+    const double radius = S[RT10_SURF_RADIUS];
+    if (!isfinite(radius) || radius == 0.0) {
+        *nx = rtv_splat(0.0);
+        *ny = rtv_splat(0.0);
+        *nz = rtv_select(rtv_gt(dz, rtv_splat(0.0)), rtv_splat(-1.0), rtv_splat(1.0));
+        return;
+    }
+    const rtv2 r2 = rtv_add(rtv_mul(hx, hx), rtv_mul(hy, hy));
+    const rtv2 r = rtv_sqrt(r2);
+    const rtm2 onAxis = rtv_lt(r, rtv_splat(1e-10));
+    const rtv2 dzdr = __rtv_dzdr(r, r2, radius, S[RT10_SURF_CONIC], S + RT10_SURF_COEF, (int)S[RT10_SURF_MODE_ODD]);
+    const rtv2 g = rtv_select(onAxis, rtv_splat(0.0), rtv_div(rtv_neg(dzdr), rtv_select(onAxis, rtv_splat(1.0), r)));
+    rtv2 ax = rtv_mul(g, hx), ay = rtv_mul(g, hy), az = rtv_splat(1.0);
+    const rtv2 inv = rtv_div(rtv_splat(1.0), rtv_sqrt(rtv_add(rtv_add(rtv_mul(ax, ax), rtv_mul(ay, ay)), rtv_splat(1.0))));
+    ax = rtv_mul(ax, inv); ay = rtv_mul(ay, inv); az = inv;
+    const rtm2 flip = rtv_gt(rtv_add(rtv_add(rtv_mul(dx, ax), rtv_mul(dy, ay)), rtv_mul(dz, az)), rtv_splat(0.0));
+    *nx = rtv_select(flip, rtv_neg(ax), ax);
+    *ny = rtv_select(flip, rtv_neg(ay), ay);
+    *nz = rtv_select(flip, rtv_neg(az), az);
+}
+
+/**
+ * 2 レーンの屈折（Snell, ベクトル形）。全反射レーンは tir に立てて方向は変更しない。
+ */
+static inline void __rtv_refract(rtv2* dx, rtv2* dy, rtv2* dz, rtv2 nx, rtv2 ny, rtv2 nz,
+                                 double n1, double n2, rtm2 active, rtm2* tir) {
+    const double eta = n1 / n2;
+    const rtv2 cosI = rtv_neg(rtv_add(rtv_add(rtv_mul(nx, *dx), rtv_mul(ny, *dy)), rtv_mul(nz, *dz)));
+    const rtv2 k = rtv_sub(rtv_splat(1.0), rtv_mul(rtv_splat(eta * eta), rtv_sub(rtv_splat(1.0), rtv_mul(cosI, cosI))));
+    const rtm2 bad = rtv_lt(k, rtv_splat(0.0));
+    *tir = rtm_and(active, bad);
+    const rtm2 go = rtm_andnot(active, bad);
+    const rtv2 c2 = rtv_sub(rtv_mul(rtv_splat(eta), cosI), rtv_sqrt(rtv_select(bad, rtv_splat(0.0), k)));
+    rtv2 ox = rtv_add(rtv_mul(rtv_splat(eta), *dx), rtv_mul(c2, nx));
+    rtv2 oy = rtv_add(rtv_mul(rtv_splat(eta), *dy), rtv_mul(c2, ny));
+    rtv2 oz = rtv_add(rtv_mul(rtv_splat(eta), *dz), rtv_mul(c2, nz));
+    const rtv2 inv = rtv_div(rtv_splat(1.0), rtv_sqrt(rtv_add(rtv_add(rtv_mul(ox, ox), rtv_mul(oy, oy)), rtv_mul(oz, oz))));
+    *dx = rtv_select(go, rtv_mul(ox, inv), *dx);
+    *dy = rtv_select(go, rtv_mul(oy, inv), *dy);
+    *dz = rtv_select(go, rtv_mul(oz, inv), *dz);
+}
+
+static inline void __rtv_reflect(rtv2* dx, rtv2* dy, rtv2* dz, rtv2 nx, rtv2 ny, rtv2 nz, rtm2 active) {
+    const rtv2 d2 = rtv_mul(rtv_splat(2.0), rtv_add(rtv_add(rtv_mul(*dx, nx), rtv_mul(*dy, ny)), rtv_mul(*dz, nz)));
+    rtv2 ox = rtv_sub(*dx, rtv_mul(d2, nx));
+    rtv2 oy = rtv_sub(*dy, rtv_mul(d2, ny));
+    rtv2 oz = rtv_sub(*dz, rtv_mul(d2, nz));
+    const rtv2 inv = rtv_div(rtv_splat(1.0), rtv_sqrt(rtv_add(rtv_add(rtv_mul(ox, ox), rtv_mul(oy, oy)), rtv_mul(oz, oz))));
+    *dx = rtv_select(active, rtv_mul(ox, inv), *dx);
+    *dy = rtv_select(active, rtv_mul(oy, inv), *dy);
+    *dz = rtv_select(active, rtv_mul(oz, inv), *dz);
+}
+
+static inline rtm2 __rtv_tail_mask(int i, int count) {
+    return rtm_make(i < count, i + 1 < count);
+}
+
+static inline void __rtv_load_rays(const double* b, int cap, int i, int count, rtv2_rays* R) {
+    R->px = rtv_load(b + RT10_BUNDLE_PX * cap + i);
+    R->py = rtv_load(b + RT10_BUNDLE_PY * cap + i);
+    R->pz = rtv_load(b + RT10_BUNDLE_PZ * cap + i);
+    R->dx = rtv_load(b + RT10_BUNDLE_DX * cap + i);
+    R->dy = rtv_load(b + RT10_BUNDLE_DY * cap + i);
+    R->dz = rtv_load(b + RT10_BUNDLE_DZ * cap + i);
+    R->opl = rtv_load(b + RT10_BUNDLE_OPL * cap + i);
+    R->status = rtv_load(b + RT10_BUNDLE_STATUS * cap + i);
+    R->alive = rtm_and(__rtv_tail_mask(i, count), rtv_ne(rtv_load(b + RT10_BUNDLE_ALIVE * cap + i), rtv_splat(0.0)));
+}
+
+static inline void __rtv_store_rays(double* b, int cap, int i, int count, const rtv2_rays* R) {
+    rtv_store(b + RT10_BUNDLE_PX * cap + i, R->px);
+    rtv_store(b + RT10_BUNDLE_PY * cap + i, R->py);
+    rtv_store(b + RT10_BUNDLE_PZ * cap + i, R->pz);
+    rtv_store(b + RT10_BUNDLE_DX * cap + i, R->dx);
+    rtv_store(b + RT10_BUNDLE_DY * cap + i, R->dy);
+    rtv_store(b + RT10_BUNDLE_DZ * cap + i, R->dz);
+    rtv_store(b + RT10_BUNDLE_OPL * cap + i, R->opl);
+    // 余りレーン（i+1 == count）は元の値を保持
+    const rtm2 tail = __rtv_tail_mask(i, count);
+    const rtv2 aliveOld = rtv_load(b + RT10_BUNDLE_ALIVE * cap + i);
+    rtv_store(b + RT10_BUNDLE_ALIVE * cap + i, rtv_select(tail, rtv_select(R->alive, rtv_splat(1.0), rtv_splat(0.0)), aliveOld));
+    rtv_store(b + RT10_BUNDLE_STATUS * cap + i, R->status);
+}
+
+/**
+ * 1 面分の処理（2 レーン）: ローカル変換 → 交点 → 開口 → グローバル交点記録 → 屈折/反射 → thickness 前進
+ * 処理内容は __rt10_trace_one と同一。
+ */
+static inline void __rtv_trace_surface(const double* S, int s, int shape, int stop_surface, int flags,
+                                       int wavelength_slot, double* n, double* pending, rtv2_rays* R,
+                                       double* hits_out, int cap, int i) {
+    const int kind = (int)S[RT10_SURF_KIND];
+    if (kind == RT10_KIND_COORD_BREAK) {
+        double nn = S[RT10_SURF_INDEX + wavelength_slot];
+        if (nn > 0.0) *n = nn;
+        return;
+    }
+    if (kind == RT10_KIND_OBJECT) {
+        const double th = S[RT10_SURF_THICKNESS];
+        if (th != 0.0) {
+            const rtv2 vth = rtv_splat(th);
+            R->px = rtv_select(R->alive, rtv_add(R->px, rtv_mul(R->dx, vth)), R->px);
+            R->py = rtv_select(R->alive, rtv_add(R->py, rtv_mul(R->dy, vth)), R->py);
+            R->pz = rtv_select(R->alive, rtv_add(R->pz, rtv_mul(R->dz, vth)), R->pz);
+            R->opl = rtv_select(R->alive, rtv_add(R->opl, rtv_splat(*n * th)), R->opl);
+        }
+        return;
+    }
+    if (!rtm_any(R->alive)) return;
+
+    const double* O = S + RT10_SURF_ORIGIN;
+    const double* M = S + RT10_SURF_ROT;
+    const rtv2 m0 = rtv_splat(M[0]), m1 = rtv_splat(M[1]), m2 = rtv_splat(M[2]);
+    const rtv2 m3 = rtv_splat(M[3]), m4 = rtv_splat(M[4]), m5 = rtv_splat(M[5]);
+    const rtv2 m6 = rtv_splat(M[6]), m7 = rtv_splat(M[7]), m8 = rtv_splat(M[8]);
+
+    // グローバル → ローカル（R^T）
+    const rtv2 rx = rtv_sub(R->px, rtv_splat(O[0]));
+    const rtv2 ry = rtv_sub(R->py, rtv_splat(O[1]));
+    const rtv2 rz = rtv_sub(R->pz, rtv_splat(O[2]));
+    const rtv2 lpx = rtv_add(rtv_add(rtv_mul(m0, rx), rtv_mul(m3, ry)), rtv_mul(m6, rz));
+    const rtv2 lpy = rtv_add(rtv_add(rtv_mul(m1, rx), rtv_mul(m4, ry)), rtv_mul(m7, rz));
+    const rtv2 lpz = rtv_add(rtv_add(rtv_mul(m2, rx), rtv_mul(m5, ry)), rtv_mul(m8, rz));
+    rtv2 ldx = rtv_add(rtv_add(rtv_mul(m0, R->dx), rtv_mul(m3, R->dy)), rtv_mul(m6, R->dz));
+    rtv2 ldy = rtv_add(rtv_add(rtv_mul(m1, R->dx), rtv_mul(m4, R->dy)), rtv_mul(m7, R->dz));
+    rtv2 ldz = rtv_add(rtv_add(rtv_mul(m2, R->dx), rtv_mul(m5, R->dy)), rtv_mul(m8, R->dz));
+
+    rtv2 t;
+    if (shape == RT10_SHAPE_PLANE) {
+        const rtv2 eps = rtv_splat(1e-9);
+        __rtv_kill(R, rtv_lt(rtv_abs(ldz), eps), RT10_STATUS_MISS);
+        t = rtv_div(rtv_neg(lpz), rtv_select(R->alive, ldz, rtv_splat(1.0)));
+        const rtv2 tiny = rtv_select(rtv_gt(ldz, rtv_splat(0.0)), eps, rtv_neg(eps));
+        t = rtv_select(rtv_lt(rtv_abs(t), eps), tiny, t);
+    } else {
+        t = __rtv_intersect_curved(lpx, lpy, lpz, ldx, ldy, ldz, R->alive, S, shape, 20, 1e-7);
+        __rtv_kill(R, rtm_andnot(rtm_make(1, 1), rtv_isfinite(t)), RT10_STATUS_MISS);
+    }
+    if (!rtm_any(R->alive)) return;
+    t = rtv_select(R->alive, t, rtv_splat(0.0));
+
+    const rtv2 hx = rtv_add(lpx, rtv_mul(ldx, t));
+    const rtv2 hy = rtv_add(lpy, rtv_mul(ldy, t));
+    const rtv2 hz = rtv_add(lpz, rtv_mul(ldz, t));
+
+    const int apKind = (int)S[RT10_SURF_AP_KIND];
+    if (s != stop_surface && apKind != RT10_AP_NONE) {
+        const rtv2 a = rtv_splat(S[RT10_SURF_AP_A]);
+        rtm2 out;
+        if (apKind == RT10_AP_RECT) {
+            out = rtm_or(rtv_gt(rtv_abs(hx), a), rtv_gt(rtv_abs(hy), rtv_splat(S[RT10_SURF_AP_B])));
+        } else {
+            out = rtv_gt(rtv_sqrt(rtv_add(rtv_mul(hx, hx), rtv_mul(hy, hy))), a);
+        }
+        __rtv_kill(R, out, RT10_STATUS_BLOCKED);
+        if (!rtm_any(R->alive)) return;
+    }
+
+    // ローカル → グローバル
+    const rtv2 gx = rtv_add(rtv_add(rtv_add(rtv_mul(m0, hx), rtv_mul(m1, hy)), rtv_mul(m2, hz)), rtv_splat(O[0]));
+    const rtv2 gy = rtv_add(rtv_add(rtv_add(rtv_mul(m3, hx), rtv_mul(m4, hy)), rtv_mul(m5, hz)), rtv_splat(O[1]));
+    const rtv2 gz = rtv_add(rtv_add(rtv_add(rtv_mul(m6, hx), rtv_mul(m7, hy)), rtv_mul(m8, hz)), rtv_splat(O[2]));
+    const rtm2 live = R->alive;
+    R->px = rtv_select(live, gx, R->px);
+    R->py = rtv_select(live, gy, R->py);
+    R->pz = rtv_select(live, gz, R->pz);
+    // 直前の交点からの光路長 = n·(thickness + t)（方向は単位ベクトル）。
+    // thickness 分は次面に到達した時点で加算する（trace_system_rt10 と同じく最終交点までを計測）
+    R->opl = rtv_select(live, rtv_add(R->opl, rtv_mul(rtv_splat(*n), rtv_add(t, rtv_splat(*pending)))), R->opl);
+    *pending = 0.0;
+
+    if (hits_out) {
+        double* H = hits_out + (size_t)s * 3 * (size_t)cap;
+        for (int lane = 0; lane < 2; lane++) {
+            if (!rtm_lane(live, lane)) continue;
+            H[i + lane] = rtv_lane(gx, lane);
+            H[cap + i + lane] = rtv_lane(gy, lane);
+            H[2 * cap + i + lane] = rtv_lane(gz, lane);
+        }
+    }
+
+    if ((flags & RT10_TRACE_HIT_ONLY) && s == stop_surface) return;
+
+    // 屈折・反射は局所座標で行い、方向だけグローバルへ戻す（回転は直交なので等価）
+    rtv2 nx, ny, nz;
+    __rtv_normal(hx, hy, ldx, ldy, ldz, S, &nx, &ny, &nz);
+    if (kind == RT10_KIND_MIRROR) {
+        const rtm2 front = rtm_and(live, rtv_lt(rtv_add(rtv_add(rtv_mul(ldx, nx), rtv_mul(ldy, ny)), rtv_mul(ldz, nz)), rtv_splat(0.0)));
+        __rtv_reflect(&ldx, &ldy, &ldz, nx, ny, nz, front);
+    } else {
+        double n2 = S[RT10_SURF_INDEX + wavelength_slot];
+        if (!(n2 > 0.0)) n2 = 1.0;
+        rtm2 tir;
+        __rtv_refract(&ldx, &ldy, &ldz, nx, ny, nz, *n, n2, live, &tir);
+        __rtv_kill(R, tir, RT10_STATUS_TIR);
+        *n = n2;
+    }
+    const rtm2 go = R->alive;
+    R->dx = rtv_select(go, rtv_add(rtv_add(rtv_mul(m0, ldx), rtv_mul(m1, ldy)), rtv_mul(m2, ldz)), R->dx);
+    R->dy = rtv_select(go, rtv_add(rtv_add(rtv_mul(m3, ldx), rtv_mul(m4, ldy)), rtv_mul(m5, ldz)), R->dy);
+    R->dz = rtv_select(go, rtv_add(rtv_add(rtv_mul(m6, ldx), rtv_mul(m7, ldy)), rtv_mul(m8, ldz)), R->dz);
+
+    const double th = S[RT10_SURF_THICKNESS];
+    if (th != 0.0) {
+        const rtv2 vth = rtv_splat(th);
+        R->px = rtv_select(go, rtv_add(R->px, rtv_mul(R->dx, vth)), R->px);
+        R->py = rtv_select(go, rtv_add(R->py, rtv_mul(R->dy, vth)), R->py);
+        R->pz = rtv_select(go, rtv_add(R->pz, rtv_mul(R->dz, vth)), R->pz);
+        *pending = th;
+    }
+}
+
+static inline int __rt10_bundle_args_ok(const double* bundle, int capacity, int count) {
+    if (!bundle || count < 0 || capacity < count) return 0;
+    return (capacity & 1) == 0;
+}
+
+/**
+ * SoA 光線バンドルの初期化: 方向を正規化し、opl=0 / alive=1 / status=OK に設定する。
+ * 不正な光線（方向ゼロ・非有限）は alive=0 / status=INVALID。
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_init_rt10(double* bundle, int capacity, int count) {
+    if (!__rt10_bundle_args_ok(bundle, capacity, count)) return -1;
+    for (int i = 0; i < capacity; i++) {
+        double dx = bundle[RT10_BUNDLE_DX * capacity + i];
+        double dy = bundle[RT10_BUNDLE_DY * capacity + i];
+        double dz = bundle[RT10_BUNDLE_DZ * capacity + i];
+        double l = sqrt(dx * dx + dy * dy + dz * dz);
+        int ok = (i < count) && l > 0.0 && isfinite(l) &&
+                 isfinite(bundle[RT10_BUNDLE_PX * capacity + i]) &&
+                 isfinite(bundle[RT10_BUNDLE_PY * capacity + i]) &&
+                 isfinite(bundle[RT10_BUNDLE_PZ * capacity + i]);
+        if (i >= count) {
+            // 余りレーンは無害な値で埋める（SIMD で読まれるため）
+            bundle[RT10_BUNDLE_PX * capacity + i] = 0.0;
+            bundle[RT10_BUNDLE_PY * capacity + i] = 0.0;
+            bundle[RT10_BUNDLE_PZ * capacity + i] = 0.0;
+            dx = 0.0; dy = 0.0; dz = 1.0; l = 1.0;
+        }
+        if (ok) {
+            bundle[RT10_BUNDLE_DX * capacity + i] = dx / l;
+            bundle[RT10_BUNDLE_DY * capacity + i] = dy / l;
+            bundle[RT10_BUNDLE_DZ * capacity + i] = dz / l;
+        } else if (i >= count) {
+            bundle[RT10_BUNDLE_DX * capacity + i] = dx;
+            bundle[RT10_BUNDLE_DY * capacity + i] = dy;
+            bundle[RT10_BUNDLE_DZ * capacity + i] = dz;
+        }
+        bundle[RT10_BUNDLE_OPL * capacity + i] = 0.0;
+        bundle[RT10_BUNDLE_ALIVE * capacity + i] = ok ? 1.0 : 0.0;
+        bundle[RT10_BUNDLE_STATUS * capacity + i] = ok ? RT10_STATUS_OK : RT10_STATUS_INVALID;
+    }
+    return 0;
+}
+
+/**
+ * バンドル版: 球面（頂点 z=0, 中心 z=R）との交点 t（近い側の正の解）。
+ * レーンは生存中のものだけ計算し、交点なし・終了レーンは NaN。
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_sphere_intersect(const double* bundle, int capacity, int count, double radius, double* t_out) {
+    if (!__rt10_bundle_args_ok(bundle, capacity, count) || !t_out) return -1;
+    const rtv2 zero = rtv_splat(0.0);
+    const rtv2 eps = rtv_splat(1e-10);
+    for (int i = 0; i < count; i += 2) {
+        rtv2_rays R;
+        __rtv_load_rays(bundle, capacity, i, count, &R);
+        const rtv2 ozc = rtv_sub(R.pz, rtv_splat(radius));
+        const rtv2 B = rtv_add(rtv_add(rtv_mul(R.px, R.dx), rtv_mul(R.py, R.dy)), rtv_mul(ozc, R.dz));
+        const rtv2 C = rtv_sub(rtv_add(rtv_add(rtv_mul(R.px, R.px), rtv_mul(R.py, R.py)), rtv_mul(ozc, ozc)), rtv_splat(radius * radius));
+        const rtv2 D = rtv_sub(rtv_mul(B, B), C); // |d| = 1
+        const rtm2 has = rtm_and(R.alive, rtv_le(zero, D));
+        const rtv2 sD = rtv_sqrt(rtv_select(has, D, zero));
+        const rtv2 t1 = rtv_sub(rtv_neg(B), sD);
+        const rtv2 t2 = rtv_sub(sD, B);
+        rtv2 t = rtv_select(rtv_gt(t1, eps), t1, rtv_select(rtv_gt(t2, eps), t2, rtv_splat(NAN)));
+        t = rtv_select(has, t, rtv_splat(NAN));
+        if (i + 1 < count) rtv_store(t_out + i, t);
+        else t_out[i] = rtv_lane(t, 0);
+    }
+    return 0;
+}
+
+/**
+ * バンドル版: 非球面（packed 面 1 枚分, RT10_SURF_*）との交点 t。ローカル座標前提。
+ * 交点なしのレーンは alive=0 / status=MISS に更新し、t は NaN。
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_intersect_aspheric_rt10(double* bundle, int capacity, int count, const double* surface,
+                                   int maxIter, double tol, double* t_out) {
+    if (!__rt10_bundle_args_ok(bundle, capacity, count) || !surface || !t_out) return -1;
+    if (!(maxIter > 0)) maxIter = 20;
+    if (!(tol > 0.0)) tol = 1e-7;
+    const int shape = __rt10_surface_shape(surface);
+    for (int i = 0; i < count; i += 2) {
+        rtv2_rays R;
+        __rtv_load_rays(bundle, capacity, i, count, &R);
+        rtv2 t = __rtv_intersect_curved(R.px, R.py, R.pz, R.dx, R.dy, R.dz, R.alive, surface, shape, maxIter, tol);
+        __rtv_kill(&R, rtm_andnot(rtm_make(1, 1), rtv_isfinite(t)), RT10_STATUS_MISS);
+        t = rtv_select(R.alive, t, rtv_splat(NAN));
+        __rtv_store_rays(bundle, capacity, i, count, &R);
+        if (i + 1 < count) rtv_store(t_out + i, t);
+        else t_out[i] = rtv_lane(t, 0);
+    }
+    return 0;
+}
+
+/**
+ * バンドル版: 現在位置（面上の交点, ローカル座標）での法線。SoA 出力 normals_out[c*capacity + i]。
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_surface_normal_rt10(const double* bundle, int capacity, int count, const double* surface, double* normals_out) {
+    if (!__rt10_bundle_args_ok(bundle, capacity, count) || !surface || !normals_out) return -1;
+    for (int i = 0; i < count; i += 2) {
+        rtv2_rays R;
+        __rtv_load_rays(bundle, capacity, i, count, &R);
+        rtv2 nx, ny, nz;
+        __rtv_normal(R.px, R.py, R.dx, R.dy, R.dz, surface, &nx, &ny, &nz);
+        rtv_store(normals_out + i, nx);
+        rtv_store(normals_out + capacity + i, ny);
+        rtv_store(normals_out + 2 * capacity + i, nz);
+    }
+    return 0;
+}
+
+/**
+ * バンドル版: 屈折。normals は SoA（bundle_surface_normal_rt10 の出力）。
+ * 全反射レーンは alive=0 / status=TIR。
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_refract(double* bundle, int capacity, int count, const double* normals, double n1, double n2) {
+    if (!__rt10_bundle_args_ok(bundle, capacity, count) || !normals || !(n2 > 0.0)) return -1;
+    for (int i = 0; i < count; i += 2) {
+        rtv2_rays R;
+        __rtv_load_rays(bundle, capacity, i, count, &R);
+        rtm2 tir;
+        __rtv_refract(&R.dx, &R.dy, &R.dz,
+                      rtv_load(normals + i), rtv_load(normals + capacity + i), rtv_load(normals + 2 * capacity + i),
+                      n1, n2, R.alive, &tir);
+        __rtv_kill(&R, tir, RT10_STATUS_TIR);
+        __rtv_store_rays(bundle, capacity, i, count, &R);
+    }
+    return 0;
+}
+
+typedef struct {
+    const double* surfaces;
+    int last;
+    double* bundle;
+    int capacity;
+    int count;
+    int wavelength_slot;
+    double n0;
+    int stop_surface;
+    int flags;
+    double* hits_out;
+    const unsigned char* shapes;    // __rt10_classify_surfaces（NULL = 面ごとに分類）
+} rt10_bundle_task;
+
+static void __rtv_trace_pairs(int begin, int end, void* ctx) {
+    const rt10_bundle_task* t = (const rt10_bundle_task*)ctx;
+    for (int p = begin; p < end; p++) {
+        const int i = p * 2;
+        rtv2_rays R;
+        __rtv_load_rays(t->bundle, t->capacity, i, t->count, &R);
+        double n = t->n0;
+        double pending = 0.0;
+        for (int s = 0; s <= t->last; s++) {
+            const double* S = t->surfaces + (size_t)s * RT10_SURF_STRIDE;
+            const int shape = t->shapes ? (int)t->shapes[s] : __rt10_surface_shape(S);
+            __rtv_trace_surface(S, s, shape, t->stop_surface, t->flags,
+                                t->wavelength_slot, &n, &pending, &R, t->hits_out, t->capacity, i);
+            if (!rtm_any(R.alive)) break;
+        }
+        __rtv_store_rays(t->bundle, t->capacity, i, t->count, &R);
+    }
+}
+
+/**
+ * SoA バンドル版のシステム一括追跡（trace_system_rt10 と同じ意味論, 2 レーン SIMD）
+ *
+ * @param bundle bundle_init_rt10 済みの SoA バンドル（終了時に最終位置・方向・光路長・状態が入る）
+ * @param hits_out 各面のグローバル交点（SoA: hits_out[(s*3 + c)*capacity + i], NULL可）。
+ *                 未到達・交点を持たない面は呼び出し前の値のまま。
+ * @return RT10_STATUS_OK で終了した光線数（引数不正時は -1）
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_bundle_rt10(const double* surfaces, int surface_count,
+                      double* bundle, int capacity, int count,
+                      int wavelength_slot, double n0,
+                      int stop_surface, int flags, double* hits_out) {
+    if (!surfaces || surface_count <= 0) return -1;
+    if (!__rt10_bundle_args_ok(bundle, capacity, count)) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    if (!(n0 > 0.0)) n0 = 1.0;
+
+    int last = surface_count - 1;
+    if (stop_surface >= 0 && stop_surface < last) last = stop_surface;
+
+    const double stat_start = __rt10_now_ms();
+    unsigned char shape_buf[RT10_SHAPE_CACHE];
+    rt10_bundle_task t = {
+        surfaces, last, bundle, capacity, count, wavelength_slot, n0, stop_surface, flags, hits_out,
+        __rt10_classify_surfaces(surfaces, surface_count, shape_buf)
+    };
+    // レーン対（2 光線）単位で分割。SoA の書き込み先はペアごとに独立。
+    coopt_parallel_for(0, (count + 1) / 2, RT10_PARALLEL_MIN_RAYS / 2, __rtv_trace_pairs, &t);
+
+    int okCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (bundle[RT10_BUNDLE_STATUS * capacity + i] == RT10_STATUS_OK) okCount++;
+    }
+    __rt10_stat_entry(RT10_STAT_ENTRY_BUNDLE, count, stat_start);
+    return okCount;
+}
+
+/*
+ * =============================================================================
+ * float32 プレビュー版（SoA バンドル, 4×f32 レーン）
+ * =============================================================================
+ *
+ * レイアウト図のドラッグ編集やスポット図の下書き表示向け。バンドルは trace_bundle_rt10 と
+ * 同じ成分並び（RT10_BUNDLE_*）の float 配列で、capacity は 4 の倍数であること。
+ * 面テーブルは double のまま受け取り、面ごとに float 定数へ落とす。
+ *
+ * - 球面・コーニックは閉形式、多項式非球面は float の Newton（初期値はベース二次曲面の解）。
+ *   収束しなかったレーンだけ double のスカラー版で解き直す（根の選択は double 版と同じ）。
+ * - 位置の分解能は float の丸め（|p| = 100 mm で約 1e-5 mm）、OPL も同程度。
+ *   波面評価や最適化には使わず、操作終了後に trace_bundle_rt10 で確定値を出すこと。
+ */
+#define RT10_F32_LANES       4
+
+#if defined(__wasm_simd128__)
+typedef v128_t rtf4;
+typedef v128_t rtf4m;
+static inline rtf4 rtf_load(const float* p) { return wasm_v128_load(p); }
+static inline void rtf_store(float* p, rtf4 a) { wasm_v128_store(p, a); }
+static inline rtf4 rtf_splat(float a) { return wasm_f32x4_splat(a); }
+static inline rtf4 rtf_add(rtf4 a, rtf4 b) { return wasm_f32x4_add(a, b); }
+static inline rtf4 rtf_sub(rtf4 a, rtf4 b) { return wasm_f32x4_sub(a, b); }
+static inline rtf4 rtf_mul(rtf4 a, rtf4 b) { return wasm_f32x4_mul(a, b); }
+static inline rtf4 rtf_div(rtf4 a, rtf4 b) { return wasm_f32x4_div(a, b); }
+static inline rtf4 rtf_sqrt(rtf4 a) { return wasm_f32x4_sqrt(a); }
+static inline rtf4 rtf_abs(rtf4 a) { return wasm_f32x4_abs(a); }
+static inline rtf4 rtf_neg(rtf4 a) { return wasm_f32x4_neg(a); }
+static inline rtf4m rtf_lt(rtf4 a, rtf4 b) { return wasm_f32x4_lt(a, b); }
+static inline rtf4m rtf_gt(rtf4 a, rtf4 b) { return wasm_f32x4_gt(a, b); }
+static inline rtf4m rtf_le(rtf4 a, rtf4 b) { return wasm_f32x4_le(a, b); }
+static inline rtf4m rtf_ne(rtf4 a, rtf4 b) { return wasm_f32x4_ne(a, b); }
+static inline rtf4m rtfm_and(rtf4m a, rtf4m b) { return wasm_v128_and(a, b); }
+static inline rtf4m rtfm_or(rtf4m a, rtf4m b) { return wasm_v128_or(a, b); }
+static inline rtf4m rtfm_andnot(rtf4m a, rtf4m b) { return wasm_v128_andnot(a, b); } // a & ~b
+static inline int rtfm_bits(rtf4m m) { return (int)wasm_i32x4_bitmask(m); }
+static inline rtf4m rtfm_from_bits(int b) { return wasm_i32x4_make((b & 1) ? -1 : 0, (b & 2) ? -1 : 0, (b & 4) ? -1 : 0, (b & 8) ? -1 : 0); }
+static inline rtf4 rtf_select(rtf4m m, rtf4 a, rtf4 b) { return wasm_v128_bitselect(a, b, m); } // m ? a : b
+#else
+typedef struct { float v[4]; } rtf4;
+typedef struct { int m[4]; } rtf4m;
+#define RTF_MAP(expr) do { for (int l_ = 0; l_ < 4; l_++) { r.v[l_] = (expr); } } while (0)
+#define RTFM_MAP(expr) do { for (int l_ = 0; l_ < 4; l_++) { r.m[l_] = (expr) ? 1 : 0; } } while (0)
+static inline rtf4 rtf_load(const float* p) { rtf4 r; RTF_MAP(p[l_]); return r; }
+static inline void rtf_store(float* p, rtf4 a) { for (int l = 0; l < 4; l++) p[l] = a.v[l]; }
+static inline rtf4 rtf_splat(float a) { rtf4 r; RTF_MAP(a); return r; }
+static inline rtf4 rtf_add(rtf4 a, rtf4 b) { rtf4 r; RTF_MAP(a.v[l_] + b.v[l_]); return r; }
+static inline rtf4 rtf_sub(rtf4 a, rtf4 b) { rtf4 r; RTF_MAP(a.v[l_] - b.v[l_]); return r; }
+static inline rtf4 rtf_mul(rtf4 a, rtf4 b) { rtf4 r; RTF_MAP(a.v[l_] * b.v[l_]); return r; }
+static inline rtf4 rtf_div(rtf4 a, rtf4 b) { rtf4 r; RTF_MAP(a.v[l_] / b.v[l_]); return r; }
+static inline rtf4 rtf_sqrt(rtf4 a) { rtf4 r; RTF_MAP(sqrtf(a.v[l_])); return r; }
+static inline rtf4 rtf_abs(rtf4 a) { rtf4 r; RTF_MAP(fabsf(a.v[l_])); return r; }
+static inline rtf4 rtf_neg(rtf4 a) { rtf4 r; RTF_MAP(-a.v[l_]); return r; }
+static inline rtf4m rtf_lt(rtf4 a, rtf4 b) { rtf4m r; RTFM_MAP(a.v[l_] < b.v[l_]); return r; }
+static inline rtf4m rtf_gt(rtf4 a, rtf4 b) { rtf4m r; RTFM_MAP(a.v[l_] > b.v[l_]); return r; }
+static inline rtf4m rtf_le(rtf4 a, rtf4 b) { rtf4m r; RTFM_MAP(a.v[l_] <= b.v[l_]); return r; }
+static inline rtf4m rtf_ne(rtf4 a, rtf4 b) { rtf4m r; RTFM_MAP(a.v[l_] != b.v[l_]); return r; }
+static inline rtf4m rtfm_and(rtf4m a, rtf4m b) { rtf4m r; RTFM_MAP(a.m[l_] && b.m[l_]); return r; }
+static inline rtf4m rtfm_or(rtf4m a, rtf4m b) { rtf4m r; RTFM_MAP(a.m[l_] || b.m[l_]); return r; }
+static inline rtf4m rtfm_andnot(rtf4m a, rtf4m b) { rtf4m r; RTFM_MAP(a.m[l_] && !b.m[l_]); return r; }
+static inline int rtfm_bits(rtf4m m) { return (m.m[0] ? 1 : 0) | (m.m[1] ? 2 : 0) | (m.m[2] ? 4 : 0) | (m.m[3] ? 8 : 0); }
+static inline rtf4m rtfm_from_bits(int b) { rtf4m r; RTFM_MAP(b & (1 << l_)); return r; }
+static inline rtf4 rtf_select(rtf4m m, rtf4 a, rtf4 b) { rtf4 r; RTF_MAP(m.m[l_] ? a.v[l_] : b.v[l_]); return r; }
+#undef RTF_MAP
+#undef RTFM_MAP
+#endif
+
+static inline rtf4m rtf_isfinite(rtf4 a) { return rtf_lt(rtf_abs(a), rtf_splat(INFINITY)); }
+
+// 4 レーン分の光線状態
+typedef struct {
+    rtf4 px, py, pz, dx, dy, dz, opl;
+    rtf4m alive;
+    rtf4 status;
+} rtf4_rays;
+
+static inline void __rtf_kill(rtf4_rays* R, rtf4m m, float status) {
+    m = rtfm_and(m, R->alive);
+    R->status = rtf_select(m, rtf_splat(status), R->status);
+    R->alive = rtfm_andnot(R->alive, m);
+}
+
+/** 4 レーンのサグ（__rtv_sag の float 版） */
+static inline rtf4 __rtf_sag(rtf4 r, rtf4 r2, float cv, float K, const float* c, int modeOdd) {
+    const rtf4 q = rtf_sub(rtf_splat(1.0f), rtf_mul(rtf_splat(K * cv * cv), r2));
+    const rtf4m ok = rtfm_and(rtf_isfinite(q), rtf_le(rtf_splat(0.0f), q));
+    const rtf4 base = rtf_div(rtf_mul(rtf_splat(cv), r2), rtf_add(rtf_splat(1.0f), rtf_sqrt(rtf_select(ok, q, rtf_splat(0.0f)))));
+    rtf4 p = rtf_splat(c[9]);
+    for (int i = 8; i >= 0; i--) p = rtf_add(rtf_splat(c[i]), rtf_mul(p, r2));
+    const rtf4 lead = modeOdd ? rtf_mul(r2, r) : rtf_mul(r2, r2);
+    const rtf4 out = rtf_add(base, rtf_mul(lead, p));
+    return rtf_select(rtfm_and(ok, rtf_isfinite(out)), out, rtf_splat(0.0f));
+}
+
+/** 4 レーンの dz/dr（__rtv_dzdr の float 版） */
+static inline rtf4 __rtf_dzdr(rtf4 r, rtf4 r2, float cv, float K, const float* c, int modeOdd) {
+    const rtf4 q = rtf_sub(rtf_splat(1.0f), rtf_mul(rtf_splat(K * cv * cv), r2));
+    const rtf4m ok = rtf_lt(rtf_splat(0.0f), q);
+    const rtf4 base = rtf_select(ok, rtf_div(rtf_mul(rtf_splat(cv), r), rtf_sqrt(rtf_select(ok, q, rtf_splat(1.0f)))), rtf_splat(cv));
+    const float k0 = modeOdd ? 3.0f : 4.0f;
+    rtf4 p = rtf_splat((k0 + 18.0f) * c[9]);
+    for (int i = 8; i >= 0; i--) p = rtf_add(rtf_splat((k0 + 2.0f * (float)i) * c[i]), rtf_mul(p, r2));
+    const rtf4 lead = modeOdd ? r2 : rtf_mul(r2, r);
+    return rtf_add(base, rtf_mul(lead, p));
+}
+
+/** 面 1 枚分の float 定数 */
+typedef struct {
+    float cv, K, semidia;
+    float coefs[10];
+    int modeOdd;
+} rtf_surface;
+
+static inline void __rtf_surface_of(const double* S, rtf_surface* F) {
+    const double radius = S[RT10_SURF_RADIUS];
+    F->cv = (isfinite(radius) && radius != 0.0) ? (float)(1.0 / radius) : 0.0f;
+    F->K = (float)(1.0 + S[RT10_SURF_CONIC]);
+    const double sd = S[RT10_SURF_SEMIDIA];
+    F->semidia = (sd > 0.0) ? (float)sd : INFINITY;
+    for (int i = 0; i < 10; i++) F->coefs[i] = (float)S[RT10_SURF_COEF + i];
+    F->modeOdd = (int)S[RT10_SURF_MODE_ODD];
+}
+
+/** 4 レーンのベース二次曲面交点（__rtv_intersect_quadric の float 版） */
+static inline rtf4 __rtf_intersect_quadric(rtf4 ox, rtf4 oy, rtf4 oz, rtf4 dx, rtf4 dy, rtf4 dz,
+                                           float semidia, float cv, float K, rtf4m* ok) {
+    const rtf4 c = rtf_splat(cv);
+    const rtf4 Kv = rtf_splat(K);
+    const rtf4 zero = rtf_splat(0.0f);
+    const rtf4 A = rtf_mul(c, rtf_add(rtf_add(rtf_mul(dx, dx), rtf_mul(dy, dy)), rtf_mul(Kv, rtf_mul(dz, dz))));
+    const rtf4 B = rtf_sub(rtf_mul(c, rtf_add(rtf_add(rtf_mul(ox, dx), rtf_mul(oy, dy)), rtf_mul(Kv, rtf_mul(oz, dz)))), dz);
+    const rtf4 C = rtf_sub(rtf_mul(c, rtf_add(rtf_add(rtf_mul(ox, ox), rtf_mul(oy, oy)), rtf_mul(Kv, rtf_mul(oz, oz)))),
+                           rtf_mul(rtf_splat(2.0f), oz));
+    const rtf4 D = rtf_sub(rtf_mul(B, B), rtf_mul(A, C));
+    const rtf4m hasRoot = rtf_le(zero, D);
+    const rtf4 sD = rtf_sqrt(rtf_select(hasRoot, D, zero));
+    const rtf4 q = rtf_neg(rtf_add(B, rtf_select(rtf_lt(B, zero), rtf_neg(sD), sD)));
+    const rtf4 roots[2] = { rtf_div(C, q), rtf_div(q, A) };
+    const rtf4 zmax = rtf_splat(1.0f + 1e-6f);
+    const rtf4 Kc = rtf_splat(K * cv);
+
+    rtf4m valid[2];
+    for (int i = 0; i < 2; i++) {
+        const rtf4 t = roots[i];
+        const rtf4 x = rtf_add(ox, rtf_mul(dx, t));
+        const rtf4 y = rtf_add(oy, rtf_mul(dy, t));
+        const rtf4 z = rtf_add(oz, rtf_mul(dz, t));
+        rtf4m v = rtfm_and(hasRoot, rtfm_and(rtf_isfinite(t), rtf_gt(t, zero)));
+        v = rtfm_and(v, rtf_le(rtf_mul(Kc, z), zmax));
+        if (isfinite(semidia)) {
+            v = rtfm_and(v, rtf_le(rtf_sqrt(rtf_add(rtf_mul(x, x), rtf_mul(y, y))), rtf_splat(semidia)));
+        }
+        valid[i] = v;
+    }
+    const rtf4m both = rtfm_and(valid[0], valid[1]);
+    const rtf4 tmin = rtf_select(rtf_lt(roots[1], roots[0]), roots[1], roots[0]);
+    *ok = rtfm_or(valid[0], valid[1]);
+    return rtf_select(both, tmin, rtf_select(valid[0], roots[0], roots[1]));
+}
+
+/**
+ * 4 レーンの曲面交点（ローカル座標）。解けなかったレーンは double のスカラー版で再探索する。
+ * @return t（交点なしのレーンは NaN）
+ */
+static inline rtf4 __rtf_intersect_curved(rtf4 ox, rtf4 oy, rtf4 oz, rtf4 dx, rtf4 dy, rtf4 dz,
+                                          rtf4m active, const double* S, const rtf_surface* F, int shape) {
+    const rtf4 zero = rtf_splat(0.0f);
+    rtf4m done;
+    rtf4 t;
+    if (shape == RT10_SHAPE_SPHERE || shape == RT10_SHAPE_CONIC) {
+        rtf4m ok;
+        t = __rtf_intersect_quadric(ox, oy, oz, dx, dy, dz, F->semidia, F->cv, F->K, &ok);
+        done = rtfm_and(active, ok);
+    } else {
+        rtf4m qOk;
+        const rtf4 tq = __rtf_intersect_quadric(ox, oy, oz, dx, dy, dz, INFINITY, F->cv, F->K, &qOk);
+        t = rtf_select(qOk, tq, rtf_div(rtf_neg(oz), dz));
+        rtf4m run = rtfm_and(active, rtfm_and(rtf_isfinite(t), rtf_gt(t, zero)));
+        done = rtfm_from_bits(0);
+        // float の丸め（|z| ~ 10 mm で 1e-6 mm）を見込んだ収束判定
+        const rtf4 tol = rtf_splat(1e-5f);
+        for (int it = 0; it < 12 && rtfm_bits(run); it++) {
+            const rtf4 x = rtf_add(ox, rtf_mul(dx, t));
+            const rtf4 y = rtf_add(oy, rtf_mul(dy, t));
+            const rtf4 z = rtf_add(oz, rtf_mul(dz, t));
+            const rtf4 r2 = rtf_add(rtf_mul(x, x), rtf_mul(y, y));
+            const rtf4 r = rtf_sqrt(r2);
+            const rtf4 Fz = rtf_sub(z, __rtf_sag(r, r2, F->cv, F->K, F->coefs, F->modeOdd));
+            const rtf4m conv = rtfm_and(run, rtf_lt(rtf_abs(Fz), tol));
+            if (rt10_stats_on) __rt10_stat_newton(it, __builtin_popcount((unsigned)rtfm_bits(conv)));
+            done = rtfm_or(done, conv);
+            run = rtfm_andnot(run, conv);
+            if (!rtfm_bits(run)) break;
+
+            const rtf4m rOk = rtf_gt(r, rtf_splat(1e-12f));
+            const rtf4 drdt = rtf_select(rOk, rtf_div(rtf_add(rtf_mul(x, dx), rtf_mul(y, dy)), rtf_select(rOk, r, rtf_splat(1.0f))), zero);
+            const rtf4 dzdr = rtf_select(rOk, __rtf_dzdr(r, r2, F->cv, F->K, F->coefs, F->modeOdd), zero);
+            const rtf4 dFdt = rtf_sub(dz, rtf_mul(dzdr, drdt));
+            const rtf4m stepOk = rtfm_and(rtf_isfinite(dFdt), rtf_gt(rtf_abs(dFdt), rtf_splat(1e-12f)));
+            run = rtfm_and(run, stepOk);
+            t = rtf_select(run, rtf_sub(t, rtf_div(Fz, rtf_select(stepOk, dFdt, rtf_splat(1.0f)))), t);
+            run = rtfm_and(run, rtfm_and(rtf_isfinite(t), rtf_gt(t, zero)));
+        }
+        if (isfinite(F->semidia)) {
+            const rtf4 x = rtf_add(ox, rtf_mul(dx, t));
+            const rtf4 y = rtf_add(oy, rtf_mul(dy, t));
+            const rtf4 r = rtf_sqrt(rtf_add(rtf_mul(x, x), rtf_mul(y, y)));
+            done = rtfm_and(done, rtf_le(r, rtf_splat(F->semidia)));
+        }
+    }
+
+    const int act = rtfm_bits(active);
+    const int redo = act & ~rtfm_bits(done);
+    if (act == 0xF && redo == 0) return t;
+
+    float tl[4], lox[4], loy[4], loz[4], ldx[4], ldy[4], ldz[4];
+    rtf_store(tl, t);
+    rtf_store(lox, ox); rtf_store(loy, oy); rtf_store(loz, oz);
+    rtf_store(ldx, dx); rtf_store(ldy, dy); rtf_store(ldz, dz);
+    const double radius = S[RT10_SURF_RADIUS];
+    const double conic = S[RT10_SURF_CONIC];
+    const double* coefs = S + RT10_SURF_COEF;
+    const int modeOdd = (int)S[RT10_SURF_MODE_ODD];
+    double semidia = S[RT10_SURF_SEMIDIA];
+    if (!(semidia > 0.0)) semidia = INFINITY;
+    for (int lane = 0; lane < 4; lane++) {
+        if (!(act & (1 << lane))) { tl[lane] = NAN; continue; }
+        if (!(redo & (1 << lane))) continue;
+        double ts = __rt10_intersect_shaped(shape, lox[lane], loy[lane], loz[lane], ldx[lane], ldy[lane], ldz[lane],
+                                            semidia, radius, conic, coefs, modeOdd, 20, 1e-7);
+        if (!(ts > 0.0) || !isfinite(ts)) {
+            ts = __rt10_intersect_fallback(lox[lane], loy[lane], loz[lane], ldx[lane], ldy[lane], ldz[lane],
+                                           semidia, radius, conic, coefs, modeOdd, 20, 1e-7);
+        }
+        tl[lane] = (float)ts;
+    }
+    return rtf_load(tl);
+}
+
+/** 4 レーンの局所法線（光線に対向する向き） */
+static inline void __rtf_normal(rtf4 hx, rtf4 hy, rtf4 dx, rtf4 dy, rtf4 dz, const rtf_surface* F, int shape,
+                                rtf4* nx, rtf4* ny, rtf4* nz) {
+    if (shape == RT10_SHAPE_PLANE) {
+        *nx = rtf_splat(0.0f);
+        *ny = rtf_splat(0.0f);
+        *nz = rtf_select(rtf_gt(dz, rtf_splat(0.0f)), rtf_splat(-1.0f), rtf_splat(1.0f));
+        return;
+    }
+    const rtf4 r2 = rtf_add(rtf_mul(hx, hx), rtf_mul(hy, hy));
+    const rtf4 r = rtf_sqrt(r2);
+    const rtf4m onAxis = rtf_lt(r, rtf_splat(1e-10f));
+    const rtf4 dzdr = __rtf_dzdr(r, r2, F->cv, F->K, F->coefs, F->modeOdd);
+    const rtf4 g = rtf_select(onAxis, rtf_splat(0.0f), rtf_div(rtf_neg(dzdr), rtf_select(onAxis, rtf_splat(1.0f), r)));
+    rtf4 ax = rtf_mul(g, hx), ay = rtf_mul(g, hy), az;
+    const rtf4 inv = rtf_div(rtf_splat(1.0f), rtf_sqrt(rtf_add(rtf_add(rtf_mul(ax, ax), rtf_mul(ay, ay)), rtf_splat(1.0f))));
+    ax = rtf_mul(ax, inv); ay = rtf_mul(ay, inv); az = inv;
+    const rtf4m flip = rtf_gt(rtf_add(rtf_add(rtf_mul(dx, ax), rtf_mul(dy, ay)), rtf_mul(dz, az)), rtf_splat(0.0f));
+    *nx = rtf_select(flip, rtf_neg(ax), ax);
+    *ny = rtf_select(flip, rtf_neg(ay), ay);
+    *nz = rtf_select(flip, rtf_neg(az), az);
+}
+
+static inline void __rtf_refract(rtf4* dx, rtf4* dy, rtf4* dz, rtf4 nx, rtf4 ny, rtf4 nz,
+                                 float eta, rtf4m active, rtf4m* tir) {
+    const rtf4 cosI = rtf_neg(rtf_add(rtf_add(rtf_mul(nx, *dx), rtf_mul(ny, *dy)), rtf_mul(nz, *dz)));
+    const rtf4 k = rtf_sub(rtf_splat(1.0f), rtf_mul(rtf_splat(eta * eta), rtf_sub(rtf_splat(1.0f), rtf_mul(cosI, cosI))));
+    const rtf4m bad = rtf_lt(k, rtf_splat(0.0f));
+    *tir = rtfm_and(active, bad);
+    const rtf4m go = rtfm_andnot(active, bad);
+    const rtf4 c2 = rtf_sub(rtf_mul(rtf_splat(eta), cosI), rtf_sqrt(rtf_select(bad, rtf_splat(0.0f), k)));
+    const rtf4 ox = rtf_add(rtf_mul(rtf_splat(eta), *dx), rtf_mul(c2, nx));
+    const rtf4 oy = rtf_add(rtf_mul(rtf_splat(eta), *dy), rtf_mul(c2, ny));
+    const rtf4 oz = rtf_add(rtf_mul(rtf_splat(eta), *dz), rtf_mul(c2, nz));
+    const rtf4 inv = rtf_div(rtf_splat(1.0f), rtf_sqrt(rtf_add(rtf_add(rtf_mul(ox, ox), rtf_mul(oy, oy)), rtf_mul(oz, oz))));
+    *dx = rtf_select(go, rtf_mul(ox, inv), *dx);
+    *dy = rtf_select(go, rtf_mul(oy, inv), *dy);
+    *dz = rtf_select(go, rtf_mul(oz, inv), *dz);
+}
+
+static inline void __rtf_reflect(rtf4* dx, rtf4* dy, rtf4* dz, rtf4 nx, rtf4 ny, rtf4 nz, rtf4m active) {
+    const rtf4 d2 = rtf_mul(rtf_splat(2.0f), rtf_add(rtf_add(rtf_mul(*dx, nx), rtf_mul(*dy, ny)), rtf_mul(*dz, nz)));
+    const rtf4 ox = rtf_sub(*dx, rtf_mul(d2, nx));
+    const rtf4 oy = rtf_sub(*dy, rtf_mul(d2, ny));
+    const rtf4 oz = rtf_sub(*dz, rtf_mul(d2, nz));
+    const rtf4 inv = rtf_div(rtf_splat(1.0f), rtf_sqrt(rtf_add(rtf_add(rtf_mul(ox, ox), rtf_mul(oy, oy)), rtf_mul(oz, oz))));
+    *dx = rtf_select(active, rtf_mul(ox, inv), *dx);
+    *dy = rtf_select(active, rtf_mul(oy, inv), *dy);
+    *dz = rtf_select(active, rtf_mul(oz, inv), *dz);
+}
+
+static inline rtf4m __rtf_tail_mask(int i, int count) {
+    const int n = count - i;
+    return rtfm_from_bits(n >= 4 ? 0xF : (n <= 0 ? 0 : (1 << n) - 1));
+}
+
+static inline void __rtf_load_rays(const float* b, int cap, int i, int count, rtf4_rays* R) {
+    R->px = rtf_load(b + RT10_BUNDLE_PX * cap + i);
+    R->py = rtf_load(b + RT10_BUNDLE_PY * cap + i);
+    R->pz = rtf_load(b + RT10_BUNDLE_PZ * cap + i);
+    R->dx = rtf_load(b + RT10_BUNDLE_DX * cap + i);
+    R->dy = rtf_load(b + RT10_BUNDLE_DY * cap + i);
+    R->dz = rtf_load(b + RT10_BUNDLE_DZ * cap + i);
+    R->opl = rtf_load(b + RT10_BUNDLE_OPL * cap + i);
+    R->status = rtf_load(b + RT10_BUNDLE_STATUS * cap + i);
+    R->alive = rtfm_and(__rtf_tail_mask(i, count), rtf_ne(rtf_load(b + RT10_BUNDLE_ALIVE * cap + i), rtf_splat(0.0f)));
+}
+
+static inline void __rtf_store_rays(float* b, int cap, int i, int count, const rtf4_rays* R) {
+    rtf_store(b + RT10_BUNDLE_PX * cap + i, R->px);
+    rtf_store(b + RT10_BUNDLE_PY * cap + i, R->py);
+    rtf_store(b + RT10_BUNDLE_PZ * cap + i, R->pz);
+    rtf_store(b + RT10_BUNDLE_DX * cap + i, R->dx);
+    rtf_store(b + RT10_BUNDLE_DY * cap + i, R->dy);
+    rtf_store(b + RT10_BUNDLE_DZ * cap + i, R->dz);
+    rtf_store(b + RT10_BUNDLE_OPL * cap + i, R->opl);
+    const rtf4m tail = __rtf_tail_mask(i, count);
+    const rtf4 aliveOld = rtf_load(b + RT10_BUNDLE_ALIVE * cap + i);
+    rtf_store(b + RT10_BUNDLE_ALIVE * cap + i, rtf_select(tail, rtf_select(R->alive, rtf_splat(1.0f), rtf_splat(0.0f)), aliveOld));
+    rtf_store(b + RT10_BUNDLE_STATUS * cap + i, R->status);
+}
+
+/**
+ * 1 面分の処理（4 レーン, float）。処理内容は __rtv_trace_surface と同一。
+ */
+static inline void __rtf_trace_surface(const double* S, int s, int shape, int stop_surface, int flags,
+                                       int wavelength_slot, double* n, float* pending, rtf4_rays* R,
+                                       float* hits_out, int cap, int i) {
+    const int kind = (int)S[RT10_SURF_KIND];
+    if (kind == RT10_KIND_COORD_BREAK) {
+        double nn = S[RT10_SURF_INDEX + wavelength_slot];
+        if (nn > 0.0) *n = nn;
+        return;
+    }
+    if (kind == RT10_KIND_OBJECT) {
+        const float th = (float)S[RT10_SURF_THICKNESS];
+        if (th != 0.0f) {
+            const rtf4 vth = rtf_splat(th);
+            R->px = rtf_select(R->alive, rtf_add(R->px, rtf_mul(R->dx, vth)), R->px);
+            R->py = rtf_select(R->alive, rtf_add(R->py, rtf_mul(R->dy, vth)), R->py);
+            R->pz = rtf_select(R->alive, rtf_add(R->pz, rtf_mul(R->dz, vth)), R->pz);
+            R->opl = rtf_select(R->alive, rtf_add(R->opl, rtf_splat((float)(*n * th))), R->opl);
+        }
+        return;
+    }
+    if (!rtfm_bits(R->alive)) return;
+
+    rtf_surface F;
+    __rtf_surface_of(S, &F);
+    const double* O = S + RT10_SURF_ORIGIN;
+    const double* M = S + RT10_SURF_ROT;
+    const rtf4 m0 = rtf_splat((float)M[0]), m1 = rtf_splat((float)M[1]), m2 = rtf_splat((float)M[2]);
+    const rtf4 m3 = rtf_splat((float)M[3]), m4 = rtf_splat((float)M[4]), m5 = rtf_splat((float)M[5]);
+    const rtf4 m6 = rtf_splat((float)M[6]), m7 = rtf_splat((float)M[7]), m8 = rtf_splat((float)M[8]);
+    const rtf4 o0 = rtf_splat((float)O[0]), o1 = rtf_splat((float)O[1]), o2 = rtf_splat((float)O[2]);
+
+    const rtf4 rx = rtf_sub(R->px, o0);
+    const rtf4 ry = rtf_sub(R->py, o1);
+    const rtf4 rz = rtf_sub(R->pz, o2);
+    const rtf4 lpx = rtf_add(rtf_add(rtf_mul(m0, rx), rtf_mul(m3, ry)), rtf_mul(m6, rz));
+    const rtf4 lpy = rtf_add(rtf_add(rtf_mul(m1, rx), rtf_mul(m4, ry)), rtf_mul(m7, rz));
+    const rtf4 lpz = rtf_add(rtf_add(rtf_mul(m2, rx), rtf_mul(m5, ry)), rtf_mul(m8, rz));
+    rtf4 ldx = rtf_add(rtf_add(rtf_mul(m0, R->dx), rtf_mul(m3, R->dy)), rtf_mul(m6, R->dz));
+    rtf4 ldy = rtf_add(rtf_add(rtf_mul(m1, R->dx), rtf_mul(m4, R->dy)), rtf_mul(m7, R->dz));
+    rtf4 ldz = rtf_add(rtf_add(rtf_mul(m2, R->dx), rtf_mul(m5, R->dy)), rtf_mul(m8, R->dz));
+
+    rtf4 t;
+    if (shape == RT10_SHAPE_PLANE) {
+        const rtf4 eps = rtf_splat(1e-9f);
+        __rtf_kill(R, rtf_lt(rtf_abs(ldz), eps), RT10_STATUS_MISS);
+        t = rtf_div(rtf_neg(lpz), rtf_select(R->alive, ldz, rtf_splat(1.0f)));
+        const rtf4 tiny = rtf_select(rtf_gt(ldz, rtf_splat(0.0f)), eps, rtf_neg(eps));
+        t = rtf_select(rtf_lt(rtf_abs(t), eps), tiny, t);
+    } else {
+        t = __rtf_intersect_curved(lpx, lpy, lpz, ldx, ldy, ldz, R->alive, S, &F, shape);
+        __rtf_kill(R, rtfm_andnot(rtfm_from_bits(0xF), rtf_isfinite(t)), RT10_STATUS_MISS);
+    }
+    if (!rtfm_bits(R->alive)) return;
+    t = rtf_select(R->alive, t, rtf_splat(0.0f));
+
+    const rtf4 hx = rtf_add(lpx, rtf_mul(ldx, t));
+    const rtf4 hy = rtf_add(lpy, rtf_mul(ldy, t));
+    const rtf4 hz = rtf_add(lpz, rtf_mul(ldz, t));
+
+    const int apKind = (int)S[RT10_SURF_AP_KIND];
+    if (s != stop_surface && apKind != RT10_AP_NONE) {
+        const rtf4 a = rtf_splat((float)S[RT10_SURF_AP_A]);
+        rtf4m out;
+        if (apKind == RT10_AP_RECT) {
+            out = rtfm_or(rtf_gt(rtf_abs(hx), a), rtf_gt(rtf_abs(hy), rtf_splat((float)S[RT10_SURF_AP_B])));
+        } else {
+            out = rtf_gt(rtf_sqrt(rtf_add(rtf_mul(hx, hx), rtf_mul(hy, hy))), a);
+        }
+        __rtf_kill(R, out, RT10_STATUS_BLOCKED);
+        if (!rtfm_bits(R->alive)) return;
+    }
+
+    const rtf4 gx = rtf_add(rtf_add(rtf_add(rtf_mul(m0, hx), rtf_mul(m1, hy)), rtf_mul(m2, hz)), o0);
+    const rtf4 gy = rtf_add(rtf_add(rtf_add(rtf_mul(m3, hx), rtf_mul(m4, hy)), rtf_mul(m5, hz)), o1);
+    const rtf4 gz = rtf_add(rtf_add(rtf_add(rtf_mul(m6, hx), rtf_mul(m7, hy)), rtf_mul(m8, hz)), o2);
+    const rtf4m live = R->alive;
+    R->px = rtf_select(live, gx, R->px);
+    R->py = rtf_select(live, gy, R->py);
+    R->pz = rtf_select(live, gz, R->pz);
+    R->opl = rtf_select(live, rtf_add(R->opl, rtf_mul(rtf_splat((float)*n), rtf_add(t, rtf_splat(*pending)))), R->opl);
+    *pending = 0.0f;
+
+    if (hits_out) {
+        float* H = hits_out + (size_t)s * 3 * (size_t)cap;
+        float lx[4], ly[4], lz[4];
+        rtf_store(lx, gx); rtf_store(ly, gy); rtf_store(lz, gz);
+        const int bits = rtfm_bits(live);
+        for (int lane = 0; lane < 4; lane++) {
+            if (!(bits & (1 << lane))) continue;
+            H[i + lane] = lx[lane];
+            H[cap + i + lane] = ly[lane];
+            H[2 * cap + i + lane] = lz[lane];
+        }
+    }
+
+    if ((flags & RT10_TRACE_HIT_ONLY) && s == stop_surface) return;
+
+    rtf4 nx, ny, nz;
+    __rtf_normal(hx, hy, ldx, ldy, ldz, &F, shape, &nx, &ny, &nz);
+    if (kind == RT10_KIND_MIRROR) {
+        const rtf4m front = rtfm_and(live, rtf_lt(rtf_add(rtf_add(rtf_mul(ldx, nx), rtf_mul(ldy, ny)), rtf_mul(ldz, nz)), rtf_splat(0.0f)));
+        __rtf_reflect(&ldx, &ldy, &ldz, nx, ny, nz, front);
+    } else {
+        double n2 = S[RT10_SURF_INDEX + wavelength_slot];
+        if (!(n2 > 0.0)) n2 = 1.0;
+        rtf4m tir;
+        __rtf_refract(&ldx, &ldy, &ldz, nx, ny, nz, (float)(*n / n2), live, &tir);
+        __rtf_kill(R, tir, RT10_STATUS_TIR);
+        *n = n2;
+    }
+    const rtf4m go = R->alive;
+    R->dx = rtf_select(go, rtf_add(rtf_add(rtf_mul(m0, ldx), rtf_mul(m1, ldy)), rtf_mul(m2, ldz)), R->dx);
+    R->dy = rtf_select(go, rtf_add(rtf_add(rtf_mul(m3, ldx), rtf_mul(m4, ldy)), rtf_mul(m5, ldz)), R->dy);
+    R->dz = rtf_select(go, rtf_add(rtf_add(rtf_mul(m6, ldx), rtf_mul(m7, ldy)), rtf_mul(m8, ldz)), R->dz);
+
+    const float th = (float)S[RT10_SURF_THICKNESS];
+    if (th != 0.0f) {
+        const rtf4 vth = rtf_splat(th);
+        R->px = rtf_select(go, rtf_add(R->px, rtf_mul(R->dx, vth)), R->px);
+        R->py = rtf_select(go, rtf_add(R->py, rtf_mul(R->dy, vth)), R->py);
+        R->pz = rtf_select(go, rtf_add(R->pz, rtf_mul(R->dz, vth)), R->pz);
+        *pending = th;
+    }
+}
+
+static inline int __rt10_bundle_f32_args_ok(const float* bundle, int capacity, int count) {
+    if (!bundle || count < 0 || capacity < count) return 0;
+    return (capacity % RT10_F32_LANES) == 0;
+}
+
+/**
+ * float32 バンドルの初期化（bundle_init_rt10 と同じ規則, capacity は 4 の倍数）
+ */
+EMSCRIPTEN_KEEPALIVE
+int bundle_init_rt10_f32(float* bundle, int capacity, int count) {
+    if (!__rt10_bundle_f32_args_ok(bundle, capacity, count)) return -1;
+    for (int i = 0; i < capacity; i++) {
+        float* px = bundle + RT10_BUNDLE_PX * capacity + i;
+        float* py = bundle + RT10_BUNDLE_PY * capacity + i;
+        float* pz = bundle + RT10_BUNDLE_PZ * capacity + i;
+        float* dx = bundle + RT10_BUNDLE_DX * capacity + i;
+        float* dy = bundle + RT10_BUNDLE_DY * capacity + i;
+        float* dz = bundle + RT10_BUNDLE_DZ * capacity + i;
+        int ok = 0;
+        if (i >= count) {
+            // 余りレーンは無害な値で埋める（SIMD で読まれるため）
+            *px = *py = *pz = 0.0f;
+            *dx = 0.0f; *dy = 0.0f; *dz = 1.0f;
+        } else {
+            const double l = sqrt((double)*dx * *dx + (double)*dy * *dy + (double)*dz * *dz);
+            ok = l > 0.0 && isfinite(l) && isfinite(*px) && isfinite(*py) && isfinite(*pz);
+            if (ok) {
+                *dx = (float)(*dx / l);
+                *dy = (float)(*dy / l);
+                *dz = (float)(*dz / l);
+            }
+        }
+        bundle[RT10_BUNDLE_OPL * capacity + i] = 0.0f;
+        bundle[RT10_BUNDLE_ALIVE * capacity + i] = ok ? 1.0f : 0.0f;
+        bundle[RT10_BUNDLE_STATUS * capacity + i] = (float)((ok || i >= count) ? RT10_STATUS_OK : RT10_STATUS_INVALID);
+    }
+    return 0;
+}
+
+typedef struct {
+    const double* surfaces;
+    int last;
+    float* bundle;
+    int capacity;
+    int count;
+    int wavelength_slot;
+    double n0;
+    int stop_surface;
+    int flags;
+    float* hits_out;
+    const unsigned char* shapes;
+} rt10_bundle_f32_task;
+
+static void __rtf_trace_quads(int begin, int end, void* ctx) {
+    const rt10_bundle_f32_task* t = (const rt10_bundle_f32_task*)ctx;
+    for (int q = begin; q < end; q++) {
+        const int i = q * RT10_F32_LANES;
+        rtf4_rays R;
+        __rtf_load_rays(t->bundle, t->capacity, i, t->count, &R);
+        double n = t->n0;
+        float pending = 0.0f;
+        for (int s = 0; s <= t->last; s++) {
+            const double* S = t->surfaces + (size_t)s * RT10_SURF_STRIDE;
+            const int shape = t->shapes ? (int)t->shapes[s] : __rt10_surface_shape(S);
+            __rtf_trace_surface(S, s, shape, t->stop_surface, t->flags,
+                                t->wavelength_slot, &n, &pending, &R, t->hits_out, t->capacity, i);
+            if (!rtfm_bits(R.alive)) break;
+        }
+        __rtf_store_rays(t->bundle, t->capacity, i, t->count, &R);
+    }
+}
+
+/**
+ * float32 プレビュー版のシステム一括追跡（trace_bundle_rt10 と同じ意味論, 4 レーン SIMD）
+ *
+ * @param bundle bundle_init_rt10_f32 済みの float SoA バンドル（capacity は 4 の倍数）
+ * @param hits_out 各面のグローバル交点（float, SoA: hits_out[(s*3 + c)*capacity + i], NULL可）
+ * その他の引数・戻り値は trace_bundle_rt10 と同じ。
+ */
+EMSCRIPTEN_KEEPALIVE
+int trace_bundle_rt10_f32(const double* surfaces, int surface_count,
+                          float* bundle, int capacity, int count,
+                          int wavelength_slot, double n0,
+                          int stop_surface, int flags, float* hits_out) {
+    if (!surfaces || surface_count <= 0) return -1;
+    if (!__rt10_bundle_f32_args_ok(bundle, capacity, count)) return -1;
+    if (wavelength_slot < 0 || wavelength_slot >= RT10_MAX_WAVELENGTHS) return -1;
+    if (!(n0 > 0.0)) n0 = 1.0;
+
+    int last = surface_count - 1;
+    if (stop_surface >= 0 && stop_surface < last) last = stop_surface;
+
+    const double stat_start = __rt10_now_ms();
+    unsigned char shape_buf[RT10_SHAPE_CACHE];
+    rt10_bundle_f32_task t = {
+        surfaces, last, bundle, capacity, count, wavelength_slot, n0, stop_surface, flags, hits_out,
+        __rt10_classify_surfaces(surfaces, surface_count, shape_buf)
+    };
+    coopt_parallel_for(0, (count + RT10_F32_LANES - 1) / RT10_F32_LANES,
+                       RT10_PARALLEL_MIN_RAYS / RT10_F32_LANES, __rtf_trace_quads, &t);
+
+    int okCount = 0;
+    for (int i = 0; i < count; i++) {
+        if (bundle[RT10_BUNDLE_STATUS * capacity + i] == (float)RT10_STATUS_OK) okCount++;
+    }
+    __rt10_stat_entry(RT10_STAT_ENTRY_BUNDLE_F32, count, stat_start);
+    return okCount;
+}
+
+EMSCRIPTEN_KEEPALIVE int rt10_f32_lanes(void) { return RT10_F32_LANES; }
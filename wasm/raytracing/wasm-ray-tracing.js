@@ -24,8 +24,15 @@ class WASMRayTracing {
             wasmCallsCount: 0,
             fallbackCallsCount: 0,
             totalWasmTime: 0,
-            totalFallbackTime: 0
+            totalFallbackTime: 0,
+            // 一括追跡（traceBundle）の精度別呼び出し回数
+            f32TraceCount: 0,
+            f64TraceCount: 0
         };
+
+        // 直前の traceBundle() の結果を作った精度（'f32' | 'f64' | null）
+        this.lastPrecision = null;
+        this.refineTimer = null;
     }
     
     /**
@@ -328,6 +335,114 @@ class WASMRayTracing {
     fallbackBatchAsphericSag(radiusArray, c, k, a4, a6, a8, a10) {
         return radiusArray.map(r => this.fallbackAsphericSag(r, c, k, a4, a6, a8, a10));
     }
+
+    /**
+     * float32 プレビュー版の一括追跡（_trace_bundle_rt10_f32）が使えるか
+     */
+    hasF32Trace() {
+        const m = this.wasmModule;
+        return !this.fallbackMode && !!m && !!m.HEAPF32 &&
+            typeof m._trace_bundle_rt10_f32 === 'function' && typeof m._bundle_init_rt10_f32 === 'function';
+    }
+
+    /**
+     * パック済み面テーブル（packOpticalSystemForWasm）で光線バンドルを一括追跡する
+     *
+     * @param {Float64Array} surfaces 面テーブル（RT10_LAYOUT.STRIDE × surfaceCount）
+     * @param {number} surfaceCount 面数
+     * @param {Float64Array} raysIn 光線ごとに [px,py,pz,dx,dy,dz]
+     * @param {Object} [options]
+     * @param {'f64'|'f32'} [options.precision='f64'] 'f32' はドラッグ中などのプレビュー用（丸め約 1e-5）
+     * @param {number} [options.slot=0] 屈折率スロット
+     * @param {number} [options.n0=1.0] 入射側媒質の屈折率
+     * @param {number} [options.stopSurface=-1] 評価面（-1 で最終面）
+     * @returns {{out: Float64Array, status: Int32Array, precision: 'f32'|'f64'}|null}
+     *   out は光線ごとに [px,py,pz,dx,dy,dz,opl]。WASM が古い・初期化前なら null
+     */
+    traceBundle(surfaces, surfaceCount, raysIn, options = {}) {
+        const m = this.wasmModule;
+        if (this.fallbackMode || !this.isInitialized || !m || typeof m._trace_bundle_rt10 !== 'function') return null;
+        const useF32 = options.precision === 'f32' && this.hasF32Trace();
+        const count = Math.floor(raysIn.length / 6);
+        const fields = typeof m._rt10_bundle_fields === 'function' ? m._rt10_bundle_fields() : 9;
+        const lanes = useF32 ? 4 : 2;
+        const cap = Math.max(lanes, Math.ceil(count / lanes) * lanes);
+        const bytes = useF32 ? 4 : 8;
+
+        const start = performance.now();
+        const surfPtr = m._malloc(surfaces.length * 8);
+        const bundlePtr = m._malloc(cap * fields * bytes);
+        if (!surfPtr || !bundlePtr) {
+            if (surfPtr) m._free(surfPtr);
+            if (bundlePtr) m._free(bundlePtr);
+            return null;
+        }
+        m.HEAPF64.set(surfaces, surfPtr >> 3);
+        const heap = useF32 ? m.HEAPF32 : m.HEAPF64;
+        const b = bundlePtr / bytes;
+        for (let k = 0; k < count; k++) {
+            for (let c = 0; c < 6; c++) heap[b + c * cap + k] = raysIn[k * 6 + c];
+        }
+
+        const slot = options.slot ?? 0;
+        const n0 = options.n0 ?? 1.0;
+        const stop = options.stopSurface ?? -1;
+        if (useF32) {
+            m._bundle_init_rt10_f32(bundlePtr, cap, count);
+            m._trace_bundle_rt10_f32(surfPtr, surfaceCount, bundlePtr, cap, count, slot, n0, stop, 0, 0);
+        } else {
+            m._bundle_init_rt10(bundlePtr, cap, count);
+            m._trace_bundle_rt10(surfPtr, surfaceCount, bundlePtr, cap, count, slot, n0, stop, 0, 0);
+        }
+
+        // 成分 0..6（位置・方向・OPL）と STATUS（成分 8）を読み出す
+        const view = useF32 ? m.HEAPF32 : m.HEAPF64;
+        const out = new Float64Array(count * 7);
+        const status = new Int32Array(count);
+        for (let k = 0; k < count; k++) {
+            for (let c = 0; c < 7; c++) out[k * 7 + c] = view[b + c * cap + k];
+            status[k] = view[b + 8 * cap + k] | 0;
+        }
+        m._free(surfPtr);
+        m._free(bundlePtr);
+
+        const precision = useF32 ? 'f32' : 'f64';
+        this.lastPrecision = precision;
+        if (useF32) this.stats.f32TraceCount++;
+        else this.stats.f64TraceCount++;
+        this.stats.wasmCallsCount++;
+        this.stats.totalWasmTime += performance.now() - start;
+        return { out, status, precision };
+    }
+
+    /**
+     * 操作中は float32 で即時に描画し、操作が止まったら double で確定値を出す
+     *
+     * trace(precision) は 'f32' / 'f64' を受け取り結果を返す関数（traceBundle / traceRaysBatch など）。
+     * onResult(result, precision) は毎回呼ばれ、最後に必ず 'f64' の結果で呼ばれる
+     * （f32 版が無いビルドでは最初から 'f64'）。
+     *
+     * @param {(precision: 'f32'|'f64') => any} trace
+     * @param {(result: any, precision: 'f32'|'f64') => void} onResult
+     * @param {Object} [options]
+     * @param {number} [options.idleMs=150] 最後の操作から double 追跡までの待ち時間
+     */
+    tracePreviewThenRefine(trace, onResult, options = {}) {
+        const idleMs = Number.isFinite(options.idleMs) ? options.idleMs : 150;
+        if (this.refineTimer) {
+            clearTimeout(this.refineTimer);
+            this.refineTimer = null;
+        }
+        if (!this.hasF32Trace()) {
+            onResult(trace('f64'), 'f64');
+            return;
+        }
+        onResult(trace('f32'), 'f32');
+        this.refineTimer = setTimeout(() => {
+            this.refineTimer = null;
+            onResult(trace('f64'), 'f64');
+        }, idleMs);
+    }
     
     /**
      * パフォーマンステスト
@@ -398,6 +513,10 @@ class WASMRayTracing {
      * リソースのクリーンアップ
      */
     cleanup() {
+        if (this.refineTimer) {
+            clearTimeout(this.refineTimer);
+            this.refineTimer = null;
+        }
         if (this.vectorBuffer) {
             this.wasmModule._free(this.vectorBuffer);
             this.vectorBuffer = null;
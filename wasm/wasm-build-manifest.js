@@ -0,0 +1,6 @@
+// Generated by scripts/write-wasm-build-manifest.sh (do not edit).
+// Optional WASM artefacts installed with this build; loaders skip the ones marked false.
+globalThis.__COOPT_WASM_BUILD_MANIFEST = Object.freeze({
+  psfThreads: false, // wasm/psf/psf-wasm-mt.js
+  rayTracingThreads: false // wasm/raytracing/ray-tracing-wasm-v3-mt.js
+});
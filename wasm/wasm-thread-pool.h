@@ -0,0 +1,193 @@
+/**
+ * WASM pthreads 用の固定ワーカープール（psf-wasm.c / ray-tracing-wasm.c 共通, header-only）
+ *
+ * - emcc -pthread でビルドすると __EMSCRIPTEN_PTHREADS__ が定義され、ワーカーを起動する。
+ *   ネイティブ検証では -pthread -DCOOPT_NATIVE_THREADS で同じ経路を使える。
+ * - それ以外のビルドでは coopt_parallel_for は呼び出しスレッドで逐次実行する
+ *   （単一スレッド版 wasm と同じ動作）。
+ * - ブラウザのメインスレッドから pthread_create するとイベントループに戻るまで起動しないため、
+ *   ワーカー数は -s PTHREAD_POOL_SIZE（事前生成数）以下に抑えること。
+ */
+
+#ifndef COOPT_WASM_THREAD_POOL_H
+#define COOPT_WASM_THREAD_POOL_H
+
+#if defined(__EMSCRIPTEN_PTHREADS__) || defined(COOPT_NATIVE_THREADS)
+#define COOPT_HAVE_THREADS 1
+#include <pthread.h>
+#if defined(__EMSCRIPTEN__)
+#include <emscripten/threading.h>
+#else
+#include <unistd.h>
+#endif
+#endif
+
+// 呼び出しスレッドを含む最大スレッド数（PTHREAD_POOL_SIZE = COOPT_POOL_MAX_THREADS でビルド）
+#define COOPT_POOL_MAX_THREADS 16
+
+typedef void (*coopt_range_fn)(int begin, int end, void* ctx);
+
+#ifdef COOPT_HAVE_THREADS
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cv;
+    pthread_cond_t done_cv;
+    pthread_t threads[COOPT_POOL_MAX_THREADS];
+    int worker_count;      // 起動済みワーカー数（呼び出しスレッドは含まない）
+    int requested;         // 要求スレッド数（0 = 自動）
+    int shutdown;
+    int busy;              // タスク実行中（入れ子・並行呼び出しは逐次実行）
+    unsigned generation;
+    coopt_range_fn fn;
+    void* ctx;
+    int begin, end, chunks;
+    int next_chunk;
+    int pending;
+} coopt_pool_t;
+
+static coopt_pool_t coopt_pool = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER,
+    {0}, 0, 0, 0, 0, 0u, NULL, NULL, 0, 0, 0, 0, 0
+};
+
+static inline int coopt_hw_threads(void) {
+#if defined(__EMSCRIPTEN__)
+    int n = emscripten_num_logical_cores();
+#else
+    int n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (n < 1) n = 1;
+    if (n > COOPT_POOL_MAX_THREADS) n = COOPT_POOL_MAX_THREADS;
+    return n;
+}
+
+// mutex 保持中に呼ぶ。残りチャンクを取り出して実行する。
+static inline void coopt_pool_run_chunks_locked(void) {
+    while (coopt_pool.next_chunk < coopt_pool.chunks) {
+        const int c = coopt_pool.next_chunk++;
+        const int n = coopt_pool.end - coopt_pool.begin;
+        const int b = coopt_pool.begin + (int)((long long)n * c / coopt_pool.chunks);
+        const int e = coopt_pool.begin + (int)((long long)n * (c + 1) / coopt_pool.chunks);
+        coopt_range_fn fn = coopt_pool.fn;
+        void* ctx = coopt_pool.ctx;
+        pthread_mutex_unlock(&coopt_pool.mutex);
+        if (e > b) fn(b, e, ctx);
+        pthread_mutex_lock(&coopt_pool.mutex);
+        if (--coopt_pool.pending == 0) pthread_cond_signal(&coopt_pool.done_cv);
+    }
+}
+
+static void* coopt_pool_worker(void* arg) {
+    (void)arg;
+    unsigned seen = 0;
+    pthread_mutex_lock(&coopt_pool.mutex);
+    seen = coopt_pool.generation;
+    while (!coopt_pool.shutdown) {
+        while (coopt_pool.generation == seen && !coopt_pool.shutdown) {
+            pthread_cond_wait(&coopt_pool.work_cv, &coopt_pool.mutex);
+        }
+        if (coopt_pool.shutdown) break;
+        seen = coopt_pool.generation;
+        coopt_pool_run_chunks_locked();
+    }
+    pthread_mutex_unlock(&coopt_pool.mutex);
+    return NULL;
+}
+
+static inline void coopt_pool_shutdown(void) {
+    pthread_mutex_lock(&coopt_pool.mutex);
+    const int count = coopt_pool.worker_count;
+    coopt_pool.shutdown = 1;
+    pthread_cond_broadcast(&coopt_pool.work_cv);
+    pthread_mutex_unlock(&coopt_pool.mutex);
+    for (int i = 0; i < count; i++) pthread_join(coopt_pool.threads[i], NULL);
+    pthread_mutex_lock(&coopt_pool.mutex);
+    coopt_pool.worker_count = 0;
+    coopt_pool.shutdown = 0;
+    pthread_mutex_unlock(&coopt_pool.mutex);
+}
+
+/**
+ * ワーカーを（再）起動する。threads は呼び出しスレッドを含む総数（<= 0 で論理コア数）。
+ * @return 実際のスレッド数
+ */
+static inline int coopt_pool_init(int threads) {
+    if (threads <= 0) threads = coopt_hw_threads();
+    if (threads > COOPT_POOL_MAX_THREADS) threads = COOPT_POOL_MAX_THREADS;
+    if (coopt_pool.worker_count == threads - 1) return threads;
+    if (coopt_pool.worker_count > 0) coopt_pool_shutdown();
+
+    pthread_mutex_lock(&coopt_pool.mutex);
+    coopt_pool.requested = threads;
+    int started = 0;
+    for (int i = 0; i < threads - 1; i++) {
+        if (pthread_create(&coopt_pool.threads[i], NULL, coopt_pool_worker, NULL) != 0) break;
+        started++;
+    }
+    coopt_pool.worker_count = started;
+    pthread_mutex_unlock(&coopt_pool.mutex);
+    return started + 1;
+}
+
+static inline int coopt_pool_thread_count(void) {
+    return coopt_pool.worker_count + 1;
+}
+
+/**
+ * [begin, end) をチャンクに分けて fn(b, e, ctx) を並列実行する（呼び出しスレッドも参加）。
+ * fn は互いに素な範囲だけを書き換えること。
+ */
+static inline void coopt_parallel_for(int begin, int end, int min_chunk, coopt_range_fn fn, void* ctx) {
+    const int n = end - begin;
+    if (n <= 0) return;
+    if (min_chunk < 1) min_chunk = 1;
+
+    pthread_mutex_lock(&coopt_pool.mutex);
+    if (coopt_pool.worker_count == 0 && coopt_pool.requested == 0) {
+        pthread_mutex_unlock(&coopt_pool.mutex);
+        coopt_pool_init(0);
+        pthread_mutex_lock(&coopt_pool.mutex);
+    }
+    const int threads = coopt_pool.worker_count + 1;
+    if (coopt_pool.busy || threads <= 1 || n < 2 * min_chunk) {
+        pthread_mutex_unlock(&coopt_pool.mutex);
+        fn(begin, end, ctx);
+        return;
+    }
+
+    // 負荷の偏り（口径外の行など）を吸収するため、スレッド数の 4 倍に分割する
+    int chunks = threads * 4;
+    if (chunks > n / min_chunk) chunks = n / min_chunk;
+    if (chunks < 1) chunks = 1;
+
+    coopt_pool.busy = 1;
+    coopt_pool.fn = fn;
+    coopt_pool.ctx = ctx;
+    coopt_pool.begin = begin;
+    coopt_pool.end = end;
+    coopt_pool.chunks = chunks;
+    coopt_pool.next_chunk = 0;
+    coopt_pool.pending = chunks;
+    coopt_pool.generation++;
+    pthread_cond_broadcast(&coopt_pool.work_cv);
+
+    coopt_pool_run_chunks_locked();
+    while (coopt_pool.pending > 0) pthread_cond_wait(&coopt_pool.done_cv, &coopt_pool.mutex);
+    coopt_pool.busy = 0;
+    pthread_mutex_unlock(&coopt_pool.mutex);
+}
+
+#else  // !COOPT_HAVE_THREADS
+
+static inline int coopt_pool_init(int threads) { (void)threads; return 1; }
+static inline int coopt_pool_thread_count(void) { return 1; }
+static inline void coopt_pool_shutdown(void) {}
+static inline void coopt_parallel_for(int begin, int end, int min_chunk, coopt_range_fn fn, void* ctx) {
+    (void)min_chunk;
+    if (end > begin) fn(begin, end, ctx);
+}
+
+#endif  // COOPT_HAVE_THREADS
+
+#endif  // COOPT_WASM_THREAD_POOL_H
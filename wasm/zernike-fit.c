@@ -0,0 +1,349 @@
+/**
+ * Zernike Fitting WebAssembly Kernel
+ * 重み付き最小二乗 Zernike フィット（evaluation/wavefront/zernike-fitting.js の高速版）
+ *
+ * 主要機能:
+ * - OSA/ANSI 単一添字 j = (n(n+2) + m) / 2、正規化 N = sqrt(2(n+1)/(1+δ_m0))（JS 版と同一）
+ * - 動径多項式は漸化式 R_n^m = ρ(R_{n-1}^{|m-1|} + R_{n-1}^{m+1}) - R_{n-2}^m（階乗和なし）
+ * - cos(mθ)/sin(mθ) は x/ρ, y/ρ からの Chebyshev 漸化式（atan2 なし）
+ * - 正規方程式 AᵀWA, AᵀWb を 1 回の走査で蓄積し、Cholesky で解く
+ * - 点は固定長ブロックごとに部分和を取り、ブロック順に足し合わせる（スレッド数によらず同じ結果）
+ *
+ * psf-wasm.c と同じモジュールにリンクされ、スレッドプールは psf_parallel_for 経由で共用する。
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten.h>
+#endif
+
+// psf-wasm.c（同じプールを使うための入口）
+void psf_parallel_for(int begin, int end, int min_chunk, void (*fn)(int, int, void*), void* ctx);
+
+// フィットのオプション（flags）
+#define ZF_SKIP_PISTON    1   // j=0 を系から除外（係数 0）
+#define ZF_SKIP_TILT      2   // j=1,2 を系から除外（係数 0）
+#define ZF_REMOVE_PISTON  4   // 解いた後に j=0 を 0 にする（残差にも反映）
+#define ZF_REMOVE_TILT    8   // 解いた後に j=1,2 を 0 にする
+
+#define ZF_MAX_ORDER      20
+#define ZF_MAX_TERMS      ((ZF_MAX_ORDER + 1) * (ZF_MAX_ORDER + 2) / 2)
+#define ZF_BLOCK_POINTS   2048
+
+// N_j = sqrt(2(n+1)/(1+δ_m0))
+static void zf_norm_table(int max_order, double* norm) {
+    int j = 0;
+    for (int n = 0; n <= max_order; n++) {
+        for (int m = -n; m <= n; m += 2, j++) norm[j] = sqrt((m == 0) ? (double)(n + 1) : 2.0 * (n + 1));
+    }
+}
+
+/**
+ * 1 点の全 Zernike 項（j = 0 .. (max_order+1)(max_order+2)/2 - 1）を評価
+ * @param norm 正規化係数（zf_norm_table）
+ * @param z 出力（項数）
+ */
+static void zf_eval_terms(double x, double y, int max_order, const double* norm, double* z) {
+    const double rho = sqrt(x * x + y * y);
+    // JS 版は atan2(0, 0) = 0 → cos = 1, sin = 0
+    const double c1 = (rho > 0.0) ? x / rho : 1.0;
+    const double s1 = (rho > 0.0) ? y / rho : 0.0;
+
+    // R[n][m]（n - m が奇数の要素は 0 として扱う）
+    double R[ZF_MAX_ORDER + 1][ZF_MAX_ORDER + 2];
+    double cm[ZF_MAX_ORDER + 1], sm[ZF_MAX_ORDER + 1];
+    cm[0] = 1.0;
+    sm[0] = 0.0;
+    for (int m = 1; m <= max_order; m++) {
+        cm[m] = cm[m - 1] * c1 - sm[m - 1] * s1;
+        sm[m] = sm[m - 1] * c1 + cm[m - 1] * s1;
+    }
+    // 漸化式が読むのは n - m が偶数の要素だけなので、0 初期化は不要
+    R[0][0] = 1.0;
+    if (max_order >= 1) R[1][1] = rho;
+    for (int n = 2; n <= max_order; n++) {
+        for (int m = n & 1; m <= n; m += 2) {
+            const double left = R[n - 1][m > 0 ? m - 1 : 1];
+            const double right = (m + 1 <= n - 1) ? R[n - 1][m + 1] : 0.0;
+            const double prev = (m <= n - 2) ? R[n - 2][m] : 0.0;
+            R[n][m] = rho * (left + right) - prev;
+        }
+    }
+
+    int j = 0;
+    for (int n = 0; n <= max_order; n++) {
+        for (int m = -n; m <= n; m += 2, j++) {
+            const int am = m < 0 ? -m : m;
+            z[j] = norm[j] * R[n][am] * (m >= 0 ? cm[am] : sm[am]);
+        }
+    }
+}
+
+typedef struct {
+    const double* x;
+    const double* y;
+    const double* opd;
+    const double* w;
+    int count;
+    int max_order;
+    int terms;          // 全項数
+    int active;         // 系に入る項数
+    const int* map;     // active 番目 → j
+    double epsilon;
+    const double* norm;     // zf_norm_table
+    const double* coeffs;   // 残差パス用（全項）
+    double* partial;    // ブロックごとの部分和
+    int stride;         // partial のブロックあたり要素数
+} zf_task;
+
+#define ZF_PANEL 8   // 8 点ずつ rank-8 更新（AᵀWA の読み書きを 1/8 に）
+
+// 正規方程式の部分和: partial[block] = { AᵀWA（上三角, active²）, AᵀWb（active）, 点数 }
+static void zf_accumulate_blocks(int begin, int end, void* ctx) {
+    zf_task* t = (zf_task*)ctx;
+    const int na = t->active;
+    double z[ZF_MAX_TERMS];
+    // panel[a][k] = Z_a(点 k), wpanel[a][k] = w_k · Z_a(点 k)
+    double panel[ZF_MAX_TERMS][ZF_PANEL];
+    double wpanel[ZF_MAX_TERMS][ZF_PANEL];
+    double wb[ZF_PANEL];
+    for (int blk = begin; blk < end; blk++) {
+        double* ata = t->partial + (size_t)blk * t->stride;
+        double* atb = ata + (size_t)na * na;
+        double* npts = atb + na;
+        memset(ata, 0, (size_t)t->stride * sizeof(double));
+        const int p0 = blk * ZF_BLOCK_POINTS;
+        const int p1 = (p0 + ZF_BLOCK_POINTS < t->count) ? p0 + ZF_BLOCK_POINTS : t->count;
+        int p = p0;
+        while (p < p1) {
+            // 有効点を最大 ZF_PANEL 個集める（不足分は 0 で埋める）
+            int k = 0;
+            for (; p < p1 && k < ZF_PANEL; p++) {
+                const double x = t->x[p], y = t->y[p];
+                const double rho = sqrt(x * x + y * y);
+                if (!(rho <= 1.0) || rho < t->epsilon || !isfinite(t->opd[p])) continue;
+                const double w = t->w ? t->w[p] : 1.0;
+                zf_eval_terms(x, y, t->max_order, t->norm, z);
+                for (int a = 0; a < na; a++) {
+                    const double v = z[t->map[a]];
+                    panel[a][k] = v;
+                    wpanel[a][k] = w * v;
+                }
+                wb[k] = w * t->opd[p];
+                k++;
+            }
+            if (k == 0) continue;
+            for (int a = 0; a < na; a++) {
+                for (int q = k; q < ZF_PANEL; q++) panel[a][q] = wpanel[a][q] = 0.0;
+            }
+            for (int q = k; q < ZF_PANEL; q++) wb[q] = 0.0;
+            npts[0] += k;
+            for (int a = 0; a < na; a++) {
+                const double* wa = wpanel[a];
+                double* dst = ata + (size_t)a * na;
+                for (int b = a; b < na; b++) {
+                    const double* pb = panel[b];
+                    double acc = 0.0;
+                    for (int q = 0; q < ZF_PANEL; q++) acc += wa[q] * pb[q];
+                    dst[b] += acc;
+                }
+                double acc = 0.0;
+                for (int q = 0; q < ZF_PANEL; q++) acc += wb[q] * panel[a][q];
+                atb[a] += acc;
+            }
+        }
+    }
+}
+
+// 残差の部分和: partial[block] = { Σ w r², min r, max r }
+static void zf_residual_blocks(int begin, int end, void* ctx) {
+    zf_task* t = (zf_task*)ctx;
+    double z[ZF_MAX_TERMS];
+    for (int blk = begin; blk < end; blk++) {
+        double* out = t->partial + (size_t)blk * 3;
+        double ss = 0.0, rmin = INFINITY, rmax = -INFINITY;
+        const int p0 = blk * ZF_BLOCK_POINTS;
+        const int p1 = (p0 + ZF_BLOCK_POINTS < t->count) ? p0 + ZF_BLOCK_POINTS : t->count;
+        for (int p = p0; p < p1; p++) {
+            const double x = t->x[p], y = t->y[p];
+            const double rho = sqrt(x * x + y * y);
+            if (!(rho <= 1.0) || rho < t->epsilon || !isfinite(t->opd[p])) continue;
+            const double w = t->w ? t->w[p] : 1.0;
+            zf_eval_terms(x, y, t->max_order, t->norm, z);
+            double fitted = 0.0;
+            for (int j = 0; j < t->terms; j++) fitted += t->coeffs[j] * z[j];
+            const double r = t->opd[p] - fitted;
+            ss += w * r * r;
+            if (r < rmin) rmin = r;
+            if (r > rmax) rmax = r;
+        }
+        out[0] = ss;
+        out[1] = rmin;
+        out[2] = rmax;
+    }
+}
+
+/**
+ * Cholesky 分解で対称正定値系を解く（上三角に格納された A を使用）
+ * JS 版 solveSymmetricSystem と同じく、非正のピボットは 0 とし対応する解も 0 にする。
+ */
+static void zf_cholesky_solve(const double* A, const double* b, int n, double* x) {
+    double* L = (double*)calloc((size_t)n * n, sizeof(double));
+    double* yv = (double*)calloc((size_t)n, sizeof(double));
+    if (!L || !yv) {
+        free(L); free(yv);
+        for (int i = 0; i < n; i++) x[i] = 0.0;
+        return;
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < j; k++) sum += L[i * n + k] * L[j * n + k];
+            const double aij = A[j * n + i];  // 上三角（j <= i）
+            if (i == j) {
+                const double d = aij - sum;
+                L[i * n + i] = sqrt(d > 0.0 ? d : 0.0);
+            } else if (L[j * n + j] != 0.0) {
+                L[i * n + j] = (aij - sum) / L[j * n + j];
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        double sum = 0.0;
+        for (int j = 0; j < i; j++) sum += L[i * n + j] * yv[j];
+        yv[i] = (L[i * n + i] != 0.0) ? (b[i] - sum) / L[i * n + i] : 0.0;
+    }
+    for (int i = n - 1; i >= 0; i--) {
+        double sum = 0.0;
+        for (int j = i + 1; j < n; j++) sum += L[j * n + i] * x[j];
+        x[i] = (L[i * n + i] != 0.0) ? (yv[i] - sum) / L[i * n + i] : 0.0;
+    }
+    free(L);
+    free(yv);
+}
+
+/**
+ * 重み付き最小二乗 Zernike フィット（点群入力）
+ * @param x, y 規格化瞳座標（単位円）
+ * @param opd OPD（任意単位, 係数も同じ単位）
+ * @param weight 重み（NULL なら 1）
+ * @param count 点数
+ * @param max_order 最大動径次数 n（<= ZF_MAX_ORDER）
+ * @param epsilon 中心遮蔽比（ρ < epsilon の点は除外）
+ * @param flags ZF_*
+ * @param coeffs_out 出力係数（(max_order+1)(max_order+2)/2, OSA/ANSI 順）
+ * @param stats_out 出力 [rms, pv, numPoints]（NULL 可）。rms = sqrt(Σ w r² / numPoints)
+ * @return 0: 成功 / -1: 失敗
+ */
+int zernike_fit_wasm(const double* x, const double* y, const double* opd, const double* weight, int count,
+                     int max_order, double epsilon, int flags, double* coeffs_out, double* stats_out) {
+    if (!x || !y || !opd || !coeffs_out || count < 0 || max_order < 0 || max_order > ZF_MAX_ORDER) return -1;
+    const int terms = (max_order + 1) * (max_order + 2) / 2;
+
+    int map[ZF_MAX_TERMS];
+    int na = 0;
+    for (int j = 0; j < terms; j++) {
+        if ((flags & ZF_SKIP_PISTON) && j == 0) continue;
+        if ((flags & ZF_SKIP_TILT) && (j == 1 || j == 2)) continue;
+        map[na++] = j;
+    }
+
+    const int blocks = (count + ZF_BLOCK_POINTS - 1) / ZF_BLOCK_POINTS;
+    const int stride = na * na + na + 1;
+    double* partial = (double*)malloc((size_t)(blocks > 0 ? blocks : 1) * (size_t)(stride > 3 ? stride : 3) * sizeof(double));
+    double* ata = (double*)calloc((size_t)stride, sizeof(double));
+    double* sol = (double*)calloc((size_t)(na > 0 ? na : 1), sizeof(double));
+    if (!partial || !ata || !sol) {
+        free(partial); free(ata); free(sol);
+        return -1;
+    }
+
+    double norm[ZF_MAX_TERMS];
+    zf_norm_table(max_order, norm);
+    zf_task t = { x, y, opd, weight, count, max_order, terms, na, map, epsilon, norm, NULL, partial, stride };
+    psf_parallel_for(0, blocks, 1, zf_accumulate_blocks, &t);
+    for (int blk = 0; blk < blocks; blk++) {
+        const double* src = partial + (size_t)blk * stride;
+        for (int i = 0; i < stride; i++) ata[i] += src[i];
+    }
+    const double* atb = ata + (size_t)na * na;
+    const double npts = ata[stride - 1];
+
+    for (int j = 0; j < terms; j++) coeffs_out[j] = 0.0;
+    if (na > 0 && npts > 0.0) {
+        zf_cholesky_solve(ata, atb, na, sol);
+        for (int a = 0; a < na; a++) coeffs_out[map[a]] = sol[a];
+    }
+    if ((flags & ZF_REMOVE_PISTON) && terms > 0) coeffs_out[0] = 0.0;
+    if ((flags & ZF_REMOVE_TILT) && terms > 2) {
+        coeffs_out[1] = 0.0;
+        coeffs_out[2] = 0.0;
+    }
+
+    if (stats_out) {
+        t.coeffs = coeffs_out;
+        psf_parallel_for(0, blocks, 1, zf_residual_blocks, &t);
+        double ss = 0.0, rmin = INFINITY, rmax = -INFINITY;
+        for (int blk = 0; blk < blocks; blk++) {
+            const double* src = partial + (size_t)blk * 3;
+            ss += src[0];
+            if (src[1] < rmin) rmin = src[1];
+            if (src[2] > rmax) rmax = src[2];
+        }
+        stats_out[0] = (npts > 0.0) ? sqrt(ss / npts) : 0.0;
+        stats_out[1] = (npts > 0.0) ? rmax - rmin : 0.0;
+        stats_out[2] = npts;
+    }
+
+    free(partial);
+    free(ata);
+    free(sol);
+    return 0;
+}
+
+typedef struct {
+    const double* coeffs;
+    const double* norm;
+    int terms;
+    int max_order;
+    const double* x;
+    const double* y;
+    double* out;
+} zf_reconstruct_task;
+
+static void zf_reconstruct_range(int begin, int end, void* ctx) {
+    zf_reconstruct_task* t = (zf_reconstruct_task*)ctx;
+    double z[ZF_MAX_TERMS];
+    for (int p = begin; p < end; p++) {
+        const double x = t->x[p], y = t->y[p];
+        if (!(x * x + y * y <= 1.0)) {
+            t->out[p] = 0.0;
+            continue;
+        }
+        zf_eval_terms(x, y, t->max_order, t->norm, z);
+        double v = 0.0;
+        for (int j = 0; j < t->terms; j++) v += t->coeffs[j] * z[j];
+        t->out[p] = v;
+    }
+}
+
+/**
+ * 係数から OPD を再構成（reconstructOPD の一括版, 単位円外は 0）
+ * @param coeffs OSA/ANSI 係数
+ * @param terms 係数の数（<= ZF_MAX_TERMS）
+ * @return 0: 成功 / -1: 失敗
+ */
+int zernike_reconstruct_wasm(const double* coeffs, int terms, const double* x, const double* y, int count, double* out) {
+    if (!coeffs || !x || !y || !out || count < 0 || terms < 0 || terms > ZF_MAX_TERMS) return -1;
+    // terms を含む最小の次数
+    int max_order = 0;
+    while ((max_order + 1) * (max_order + 2) / 2 < terms) max_order++;
+    double norm[ZF_MAX_TERMS];
+    zf_norm_table(max_order, norm);
+    zf_reconstruct_task t = { coeffs, norm, terms, max_order, x, y, out };
+    psf_parallel_for(0, count, 256, zf_reconstruct_range, &t);
+    return 0;
+}